@@ -15,6 +15,8 @@ namespace ngl
 		u32 calcFileSize(const char* filePath);
 
 		bool ReadFileToBuffer(const char* filePath, std::vector<u8>& out_data);
+		// ファイルの offset から size バイトを p_dst へ読み込む. 範囲がファイル外の場合はfalse.
+		bool ReadFileRange(const char* filePath, u64 offset, void* p_dst, u64 size);
 		bool WriteFileFromBuffer(const char* filePath, const void* data, size_t size);
 		bool WriteFileFromBuffer(const char* filePath, const std::vector<u8>& data);
 		u64 CalcFileHashFNV1a64(const char* filePath);
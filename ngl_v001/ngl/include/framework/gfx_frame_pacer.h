@@ -0,0 +1,93 @@
+﻿#pragma once
+
+//  gfx_frame_pacer.h
+//  GPUへSubmitしたフレームの同時実行数 (Frames In Flight) の管理とペーシング統計.
+//  デバイス非依存. Fenceの完了値取得と待機は利用側 (GraphicsFramework) のコールバックで行う.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+
+#include "util/types.h"
+
+namespace ngl::fwk
+{
+    // Frames In Flight の管理.
+    //  Submit毎にFenceへSignalした値 (submit_id) を記録し, 同時にGPU実行中となるフレーム数を上限以下に保つ.
+    //  submit_id は単調増加であること. 完了値が submit_id 以上になったフレームを完了とみなす.
+    //  WaitForSubmitSlot, OnSubmitted, WaitAll はSubmitを行う単一スレッド (RenderThread) から呼ぶ. 上限の変更と統計の取得は任意スレッドから可能.
+    class FramePacer
+    {
+    public:
+        // 内部バッファのサイズ. Frames In Flight の上限.
+        static constexpr u32 k_max_frames_in_flight = 4;
+
+        struct Statistics
+        {
+            u32     max_frames_in_flight = 0;
+            u32     num_frames_in_flight = 0;       // 直近のSubmit直後のGPU実行中フレーム数.
+            u64     num_frame = 0;
+            u64     num_wait = 0;                   // Submit前にGPU完了待ちが発生した回数.
+
+            u64     wait_micro_sec = 0;             // 直近フレームのSubmit前のGPU完了待ち時間.
+            double  avg_wait_micro_sec = 0.0;       // 指数移動平均.
+            u64     frame_interval_micro_sec = 0;   // 直近のSubmit間隔.
+            double  avg_frame_interval_micro_sec = 0.0;
+            double  frame_interval_jitter_micro_sec = 0.0;// Submit間隔の平均からの偏差の指数移動平均.
+            u64     max_frame_interval_micro_sec = 0;// 統計リセット以降の最大Submit間隔.
+        };
+
+        // Fenceの完了値を返す.
+        using GetCompletedFunction = std::function<u64()>;
+        // Fenceの完了値が value 以上になるまで待機する.
+        using WaitFunction = std::function<void(u64 value)>;
+
+        FramePacer() = default;
+        ~FramePacer() = default;
+
+        void SetFunction(const GetCompletedFunction& get_completed_function, const WaitFunction& wait_function);
+
+        // 同時にGPU実行中とするフレーム数の上限. [1, k_max_frames_in_flight] にクランプする. 次のWaitForSubmitSlotから反映.
+        void SetMaxFramesInFlight(u32 count);
+        u32 GetMaxFramesInFlight() const { return max_frames_in_flight_.load(); }
+
+        // フレームのSubmit前に呼ぶ. GPU実行中のフレーム数が上限未満になるまで古い順に完了を待機する. 戻り値は待機時間(マイクロ秒).
+        u64 WaitForSubmitSlot();
+        // フレームのSubmitとFenceへのSignal後に呼ぶ.
+        void OnSubmitted(u64 submit_id);
+        // Submit済みの全フレームの完了を待機.
+        void WaitAll();
+
+        // GPU実行中のフレーム数. 完了済みのものは取り除く.
+        u32 NumFramesInFlight();
+
+        Statistics GetStatistics() const;
+        void ResetStatistics();
+
+    private:
+        // 完了済みのフレームを先頭から取り除く.
+        void RetireCompleted();
+        void PopFront();
+
+        GetCompletedFunction    get_completed_function_ = {};
+        WaitFunction            wait_function_ = {};
+        std::atomic<u32>        max_frames_in_flight_ = 2;
+
+        // GPU実行中フレームのsubmit_idのリングバッファ. Submit順.
+        std::array<u64, k_max_frames_in_flight> inflight_id_ = {};
+        u32                                     inflight_head_ = 0;
+        u32                                     inflight_count_ = 0;
+
+        std::chrono::steady_clock::time_point   last_submit_time_ = {};
+        bool                                    has_last_submit_ = false;
+        u64                                     last_wait_micro_sec_ = 0;
+
+        mutable std::mutex  stat_mutex_ = {};
+        Statistics          stat_ = {};
+    };
+
+    // 偽のQueueによるFrames In Flight の待機とSubmit順序, 上限変更のテスト.
+    void TestFramePacer();
+}
@@ -15,6 +15,8 @@
 
 #include "gfx/rtg/graph_builder.h"
 
+#include "framework/gfx_frame_pacer.h"
+
 namespace ngl
 {
 	namespace platform
@@ -41,6 +43,10 @@ public:
 	{
 		// Enhanced Barrierサポート時に利用を要求するか.(Experimental: 非サポート時はLegacyにフォールバック)
 		bool require_enhanced_barrier = false;
+		// Bindlessマテリアル用のSRV領域を有効化するか.(ResourceBindingTier2以上が必要)
+		bool enable_bindless = false;
+		// 同時にGPU実行中とするフレーム数の上限. Swapchainのバッファ数以下にクランプされる.
+		u32 max_frames_in_flight = 2;
 	};
 
 	GraphicsFramework();
@@ -67,6 +73,12 @@ public:
 	// Submit済みのGPUタスクのすべての完了を待機.
 	void WaitAllGpuTask();
 
+	// 同時にGPU実行中とするフレーム数の上限. [1, Swapchainのバッファ数] にクランプ. 任意スレッドから変更可能で次のSubmitから反映.
+	void SetMaxFramesInFlight(u32 count);
+	u32 GetMaxFramesInFlight() const;
+	// Submit間隔やGPU完了待ちのペーシング統計.
+	FramePacer::Statistics GetFramePacerStatistics() const;
+
 private:
     void EmptyFrameProcessForDestroy();
 
@@ -78,6 +90,7 @@ public:
 		u64 wait_render_thread_micro_sec{};
 		u64 wait_gpu_fence_micro_sec{};
 		u64 wait_present_micro_sec{};
+		u32 num_frames_in_flight{};// Submit直後のGPU実行中フレーム数.
 
 		bool collected_cpu_render_thread{};// cpu render thread の情報集計が完了したか.
 	};
@@ -85,7 +98,7 @@ public:
 	Statistics GetStatistics(int history_index) const;
 	
 private:
-	// 内部用. フレームのCommandListのSubmit準備として, 以前のSubmitによるGPU処理完了を待機する. RenderThread.
+	// 内部用. フレームのCommandListのSubmit準備として, Frames In Flight の上限を超えないよう以前のSubmitによるGPU処理完了を待機する. RenderThread.
 	void ReadyToSubmit();
 	// 内部用. フレームのSwapchainのPresent. RenderThread.
 	void Present();
@@ -119,16 +132,9 @@ private:
 	// CommandQueue実行完了待機用オブジェクト
 	ngl::rhi::WaitOnFenceSignalDep				gpu_wait_signal_;
 	
-	// GPU待機用バッファの最大数. 内部バッファ確保のためのサイズ.
-	static constexpr int								k_gpu_work_queue_count_max = 4;
-	// SubmitしたGPUタスクのバッファリング待機用情報.
-	std::array<ngl::u64, k_gpu_work_queue_count_max>	inflight_gpu_work_id_{};
-	std::array<bool, k_gpu_work_queue_count_max>		inflight_gpu_work_id_enable_{};
-	// GPU側の待機キューの数. value =< バックバッファ数.
-	//	理想的にはバックバッファ数と同じ値だが, 現状RHIのガベージコレクションなどがGPU側1F遅れと想定しているため 1 を指定している.
-	//	ガベコレにGPUにSubmitしたフレームIDを識別して破棄する仕組みを入れれば最大限増加してパフォーマンス向上できると考えられる.
-	static constexpr ngl::u32							inflight_gpu_work_flip_count_ = 1;
-	ngl::u32											inflight_gpu_work_flip_ = 0;
+	// SubmitしたGPUタスクの Frames In Flight 管理. Fenceへは Device Frame Index をSignalする.
+	//	RHIのガベージコレクションやフレーム単位リソースはFenceの完了値で解放判定するため, 上限はSwapchainのバッファ数まで増加できる.
+	FramePacer									frame_pacer_{};
 	
 	// RenderThread.
 	ngl::thread::SingleJobThread				render_thread_;
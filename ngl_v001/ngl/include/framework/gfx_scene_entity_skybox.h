@@ -5,6 +5,8 @@
 #include "rhi/d3d12/resource_view.d3d12.h"
 #include "resource/resource_manager.h"
 
+#include "gfx/rendering/ibl_sh.h"
+
 
 
 namespace ngl::fwk
@@ -24,9 +26,8 @@ namespace ngl::fwk
         rhi::RefTextureDep src_cubemap_;
         rhi::RefSrvDep src_cubemap_plane_array_srv_;
 
-        // Sky Cubemapから畳み込みで生成されるDiffuse IBL Cubemap.
-        rhi::RefTextureDep ibl_diffuse_cubemap_;
-        rhi::RefSrvDep ibl_diffuse_cubemap_plane_array_srv_;
+        // PanoramaイメージからCPUで射影したDiffuse IBLの放射照度SH. E/π.
+        gfx::Sh9Rgb ibl_diffuse_irradiance_sh_;
         
         // Sky Cubemapから畳み込みで生成されるGGX Specular IBL Cubemap.
         rhi::RefTextureDep ibl_ggx_specular_cubemap_;
@@ -17,6 +17,16 @@ namespace gfx
 		ngl::math::Mat34 mtx_cofactor;// 法線変換用余因子行列. Align用にvec4*3としている. https://github.com/graphitemaster/normals_revisited .
 	};
 
+	// Mesh Shape Buffer. Shapeのロード時に一度だけ生成される.
+	struct ShapeInfo
+	{
+		// 量子化頂点フォーマットの逆量子化パラメータ. EMeshVertexFormat::FLOAT の場合は未使用.
+		ngl::math::Vec3 vtx_pos_dequant_scale;
+		uint32_t		vtx_format;// EMeshVertexFormat.
+		ngl::math::Vec3 vtx_pos_dequant_offset;
+		uint32_t		vtx_pad0;
+	};
+
 	struct CbSceneView
 	{
 		ngl::math::Mat34 cb_view_mtx;
@@ -125,6 +135,24 @@ namespace gfx
 		}
 	};
 
+	// Meshの頂点フォーマット.
+	//	QUANTIZED の場合のラスタライズ用頂点ストリーム.
+	//		POSITION : R16G16B16A16_UNORM. Shapeバウンズで正規化. wはBitangent符号.
+	//		NORMAL, TANGENT : R16G16_UNORM. Octahedron Encoding.
+	//		BINORMAL : ストリーム無し. NORMAL, TANGENT と符号から復元.
+	//		TEXCOORD : R16G16_FLOAT.
+	//		COLOR : FLOAT と同一.
+	struct EMeshVertexFormat
+	{
+		enum Type : int
+		{
+			FLOAT,
+			QUANTIZED,
+
+			_MAX,
+		};
+	};
+
 	// セマンティクス種別とインデックスからマッピングされたSlotインデックスの計算等を提供.
 	struct MeshVertexSemantic
 	{
@@ -0,0 +1,58 @@
+﻿/*
+    bindless_material_buffer.h
+*/
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "gfx/material/bindless_material_table.h"
+#include "rhi/d3d12/resource.d3d12.h"
+#include "rhi/d3d12/resource_view.d3d12.h"
+
+namespace ngl
+{
+namespace rhi
+{
+    class DeviceDep;
+}
+
+namespace gfx
+{
+    // BindlessMaterialTable のGPUバッファ.
+    //  GPUが参照中のバッファを書き換えないようにフレーム数分のUploadバッファを巡回し, 各バッファが最後に反映したリビジョン以降の更新範囲のみを書き込む.
+    class BindlessMaterialBuffer
+    {
+    public:
+        BindlessMaterialBuffer() = default;
+        ~BindlessMaterialBuffer();
+
+        bool Initialize(rhi::DeviceDep* p_device, const BindlessMaterialTable::Desc& desc);
+        void Finalize();
+
+        bool IsValid() const { return nullptr != p_device_; }
+
+        BindlessMaterialTable& GetTable() { return table_; }
+        const BindlessMaterialTable& GetTable() const { return table_; }
+
+        // 現在のフレーム用のマテリアルテーブルSRV. フレーム内の初回呼び出しで未反映の更新をバッファへ書き込む.
+        const rhi::ShaderResourceViewDep* GetFrameSrv();
+
+    private:
+        struct FrameBuffer
+        {
+            rhi::RefBufferDep   buffer = {};
+            rhi::RefSrvDep      srv = {};
+            u64                 uploaded_revision = 0;
+        };
+
+        rhi::DeviceDep*             p_device_ = {};
+        BindlessMaterialTable       table_;
+
+        std::mutex                  mutex_;
+        std::vector<FrameBuffer>    frame_buffer_;
+        u64                         last_update_frame_ = ~u64(0);
+        u32                         current_buffer_ = 0;
+    };
+}
+}
@@ -0,0 +1,102 @@
+﻿#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "util/types.h"
+
+namespace ngl
+{
+namespace gfx
+{
+    // Bindlessマテリアルのテクスチャ種別.
+    namespace EBindlessMaterialTexture
+    {
+        enum Type
+        {
+            BASE_COLOR,
+            NORMAL,
+            OCCLUSION,
+            ROUGHNESS,
+            METALNESS,
+
+            _MAX
+        };
+    }
+
+    // GPU上のマテリアルエントリ. シェーダ側の NglBindlessMaterialEntry (mtl_bindless_material.hlsli) と一致させる.
+    //  texture_index はBindless SRV配列上のインデックス.
+    struct BindlessMaterialEntry
+    {
+        u32 texture_index[EBindlessMaterialTexture::_MAX] = {};
+        u32 flags = 0;
+        u32 pad0 = 0;
+        u32 pad1 = 0;
+    };
+    static_assert(sizeof(BindlessMaterialEntry) == 32, "BindlessMaterialEntry size must match shader side.");
+
+    // Bindlessマテリアルテーブル. デバイス非依存.
+    //  マテリアル毎に不変のスロットを割り当て, エントリの更新をリビジョンで追跡する.
+    //  GPUバッファ側は自身が最後に反映したリビジョン以降の更新範囲のみを Pack する.
+    class BindlessMaterialTable
+    {
+    public:
+        static constexpr u32 k_invalid_slot = ~u32(0);
+        static constexpr u32 k_invalid_texture_index = ~u32(0);
+
+        struct Desc
+        {
+            u32 max_material = 4096;
+            // テクスチャ未設定時のインデックス. 種別毎のデフォルトテクスチャを指定する.
+            u32 default_texture_index[EBindlessMaterialTexture::_MAX] = {};
+        };
+
+        BindlessMaterialTable();
+        ~BindlessMaterialTable();
+
+        bool Initialize(const Desc& desc);
+        void Finalize();
+
+        // スロット確保. エントリはデフォルトテクスチャで初期化される. 空きが無い場合は k_invalid_slot.
+        u32 AllocateSlot();
+        // スロット解放. GPUバッファはフレーム毎に Pack したものを参照するため即時再利用してよい.
+        void FreeSlot(u32 slot);
+
+        // k_invalid_texture_index の場合はデフォルトテクスチャ.
+        void SetTexture(u32 slot, EBindlessMaterialTexture::Type type, u32 texture_index);
+        void SetFlags(u32 slot, u32 flags);
+
+        BindlessMaterialEntry GetEntry(u32 slot) const;
+
+        // 一度でも確保されたスロット数. GPUバッファはこの範囲を保持する.
+        u32 NumSlot() const;
+        u32 GetMaxMaterial() const { return desc_.max_material; }
+        // 更新毎に加算されるリビジョン.
+        u64 GetRevision() const;
+
+        // since_revision より後に更新されたスロット範囲 [out_begin, out_end). 更新が無い場合は false.
+        bool GetDirtyRange(u64 since_revision, u32& out_begin, u32& out_end) const;
+        // スロット範囲 [begin, end) のエントリを p_dst へ詰める. 書き込んだByteサイズを返す.
+        u32 Pack(void* p_dst, u32 dst_byte_size, u32 begin, u32 end) const;
+
+    private:
+        void MarkDirty(u32 slot);
+        BindlessMaterialEntry MakeDefaultEntry() const;
+
+    private:
+        mutable std::mutex                  mutex_;
+        Desc                                desc_ = {};
+
+        std::vector<BindlessMaterialEntry>  entry_array_;
+        // エントリ毎の最終更新リビジョン.
+        std::vector<u64>                    entry_revision_;
+        std::vector<u8>                     allocated_flag_;
+        std::vector<u32>                    free_slot_;
+        u32                                 num_slot_ = 0;
+        u64                                 revision_ = 0;
+    };
+
+    // スロットの安定性, デフォルトテクスチャ, 更新範囲追跡とPackのテスト.
+    void TestBindlessMaterialTable();
+}
+}
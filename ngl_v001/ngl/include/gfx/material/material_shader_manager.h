@@ -87,6 +87,8 @@ namespace gfx
         const ResShader* p_ps = {};
 
         MeshVertexSemanticSlotMask  vs_input_layout_mask = {};
+        // 頂点入力のフォーマット. InputLayoutのフォーマット決定に利用.
+        EMeshVertexFormat::Type     vs_input_format = EMeshVertexFormat::FLOAT;
     };
     // Pass Pso Creator Interface.
     //  Pass毎のPso生成クラスはこのクラスを継承する.
@@ -191,12 +193,12 @@ namespace gfx
         void Finalize();
 
         // マテリアルを構成するPassPsoセットを取得する. まだ生成されていない場合は内部で生成.
-        MaterialPsoSet GetMaterialPsoSet(const char* material_name, MeshVertexSemanticSlotMask vsin_slot);
+        MaterialPsoSet GetMaterialPsoSet(const char* material_name, MeshVertexSemanticSlotMask vsin_slot, EMeshVertexFormat::Type vsin_format = EMeshVertexFormat::FLOAT);
 
         const std::vector<std::string>& GetRegisteredPassNameList() const { return registered_pass_name_list_; }
     private:
         // マテリアル名と追加情報からPipeline生成またはCacheから取得.
-        rhi::GraphicsPipelineStateDep* CreateMaterialPipeline(const char* material_name, const char* pass_name, MeshVertexSemanticSlotMask vsin_slot);
+        rhi::GraphicsPipelineStateDep* CreateMaterialPipeline(const char* material_name, const char* pass_name, MeshVertexSemanticSlotMask vsin_slot, EMeshVertexFormat::Type vsin_format);
 
     private:
         void RegisterPassPsoCreator(const char* name, IMaterialPassPsoCreator* p_instance);
@@ -0,0 +1,234 @@
+﻿#pragma once
+
+#include <cfloat>
+#include <vector>
+
+#include "math/math.h"
+#include "util/types.h"
+
+namespace ngl
+{
+	namespace thread
+	{
+		class JobSystem;
+	}
+
+	namespace gfx
+	{
+		// 無効インデックス.
+		static constexpr u32 k_cpu_bvh_invalid_index = ~0u;
+
+		struct CpuBvhAabb
+		{
+			math::Vec3 bb_min = math::Vec3(FLT_MAX);
+			math::Vec3 bb_max = math::Vec3(-FLT_MAX);
+
+			bool IsValid() const { return bb_min.x <= bb_max.x && bb_min.y <= bb_max.y && bb_min.z <= bb_max.z; }
+			void Expand(const math::Vec3& p);
+			void Expand(const CpuBvhAabb& v);
+			math::Vec3 Center() const;
+			float SurfaceArea() const;
+		};
+
+		struct CpuBvhRay
+		{
+			math::Vec3	origin = {};
+			math::Vec3	direction = {};	// 正規化は不要. tはdirectionの長さ単位.
+			float		t_min = 0.0f;
+			float		t_max = FLT_MAX;
+		};
+
+		struct CpuBvhHit
+		{
+			float	t = FLT_MAX;
+			float	u = 0.0f;	// 重心座標. v1の重み.
+			float	v = 0.0f;	// 重心座標. v2の重み.
+			u32		instance_index = k_cpu_bvh_invalid_index;	// CpuBvhScene上のInstance. CpuBvhMesh単体の場合は無効.
+			u32		geometry_index = k_cpu_bvh_invalid_index;	// CpuBvhMeshのGeometry (MeshShapePart).
+			u32		primitive_index = k_cpu_bvh_invalid_index;	// Geometry内の三角形.
+
+			bool IsHit() const { return k_cpu_bvh_invalid_index != primitive_index; }
+		};
+
+		// 三角形の識別子.
+		struct CpuBvhPrimitiveId
+		{
+			u32 geometry_index = 0;
+			u32 primitive_index = 0;
+		};
+
+		// 視錐台. 各平面は dot(xyz, p) + w >= 0 を内側とする.
+		struct CpuBvhFrustum
+		{
+			math::Vec4 plane[6] = {};
+
+			// ViewProjection行列 (clip = view_proj * p) から平面を抽出する. D3DのクリップZ範囲 [0,1].
+			//	ReverseZや無限遠Farの場合も同じ領域を表す平面が得られる. 法線長が0の平面は常に内側となる.
+			static CpuBvhFrustum FromViewProjection(const math::Mat44& view_proj);
+		};
+
+		// 4分木ノード. 子のAABBをSoAで保持してSIMDで4つ同時に判定する.
+		struct alignas(16) CpuBvh4Node
+		{
+			float bb_min_x[4];
+			float bb_min_y[4];
+			float bb_min_z[4];
+			float bb_max_x[4];
+			float bb_max_y[4];
+			float bb_max_z[4];
+			// prim_count が0の場合は子ノードのインデックス, 1以上の場合はリーフで先頭プリミティブのインデックス.
+			//	空の子は k_cpu_bvh_invalid_index.
+			u32 child[4];
+			u32 prim_count[4];
+		};
+
+		// ビルド設定.
+		struct CpuBvhBuildDesc
+		{
+			// リーフの最大プリミティブ数.
+			u32 max_leaf_primitive = 4;
+			// SAHのビン数.
+			u32 num_bin = 16;
+			// このプリミティブ数以上の部分木はJobSystemで並列ビルドする.
+			u32 parallel_primitive_threshold = 16 * 1024;
+			// SAHのコスト. 交差判定コストに対するノード走査コストの比.
+			float traversal_cost = 1.0f;
+		};
+
+		// プリミティブAABB配列からの4分木BVH. CpuBvhMeshとCpuBvhSceneの共通部.
+		//	Binned SAHで2分木を構築し, 表面積の大きいノードから展開して4分木に変換する.
+		//	大きな部分木はJobSystemで並列にビルドする.
+		class CpuBvh4
+		{
+		public:
+			void Build(const std::vector<CpuBvhAabb>& prim_aabb_array, const CpuBvhBuildDesc& desc, thread::JobSystem* p_job_system);
+			void Clear();
+
+			bool IsValid() const { return !node_array_.empty(); }
+			u32 NumNode() const { return static_cast<u32>(node_array_.size()); }
+			const CpuBvhAabb& GetBounds() const { return bounds_; }
+
+			const std::vector<CpuBvh4Node>& GetNodeArray() const { return node_array_; }
+			// リーフ順に並べたプリミティブインデックス.
+			const std::vector<u32>& GetPrimitiveOrder() const { return prim_order_; }
+
+		private:
+			std::vector<CpuBvh4Node>	node_array_;
+			std::vector<u32>			prim_order_;
+			CpuBvhAabb					bounds_ = {};
+		};
+
+		// 三角形メッシュのBVH (BLAS相当).
+		//	MeshShapePart等の複数Geometryをまとめて1つのBVHとする.
+		//	デバイス非依存. ピッキングやオクルージョン判定, GPUレイトレースのリファレンス等に利用する.
+		class CpuBvhMesh
+		{
+		public:
+			struct GeometryInput
+			{
+				const math::Vec3*	position = nullptr;
+				u32					num_vertex = 0;
+				const u32*			index = nullptr;
+				u32					num_primitive = 0;
+			};
+
+			CpuBvhMesh();
+			~CpuBvhMesh();
+
+			bool Build(const GeometryInput* geometry_array, u32 num_geometry, const CpuBvhBuildDesc& desc = {}, thread::JobSystem* p_job_system = nullptr);
+
+			// 最近接交差. ヒットした場合は out_hit を更新して true.
+			//	out_hit.t より遠い交差は無視するため, 初期値の out_hit.t で探索範囲を制限できる.
+			bool Intersect(const CpuBvhRay& ray, CpuBvhHit& out_hit) const;
+			// 任意交差. 遮蔽判定用.
+			bool Occluded(const CpuBvhRay& ray) const;
+			// 4レイのパケット最近接交差. active_mask のビットが立っているレイのみ処理する.
+			//	戻り値はヒットしたレイのマスク.
+			u32 IntersectPacket4(const CpuBvhRay* ray4, CpuBvhHit* out_hit4, u32 active_mask = 0xf) const;
+
+			// AABBまたは視錐台と重なる三角形を収集する. 三角形のAABBによる保守的な判定.
+			void QueryAabb(const CpuBvhAabb& aabb, std::vector<CpuBvhPrimitiveId>& out_prim_array) const;
+			void QueryFrustum(const CpuBvhFrustum& frustum, std::vector<CpuBvhPrimitiveId>& out_prim_array) const;
+
+			bool IsValid() const { return bvh_.IsValid(); }
+			const CpuBvhAabb& GetBounds() const { return bvh_.GetBounds(); }
+			u32 NumNode() const { return bvh_.NumNode(); }
+			u32 NumPrimitive() const { return static_cast<u32>(prim_id_array_.size()); }
+
+		private:
+			CpuBvh4 bvh_ = {};
+
+			// リーフ順に並べ替えた三角形. v0, e1 = v1 - v0, e2 = v2 - v0.
+			std::vector<math::Vec3>			tri_v0_array_;
+			std::vector<math::Vec3>			tri_e1_array_;
+			std::vector<math::Vec3>			tri_e2_array_;
+			std::vector<CpuBvhPrimitiveId>	prim_id_array_;
+		};
+
+		// Instance BVH (TLAS相当). CpuBvhMeshを参照するInstanceの2レベルBVH.
+		class CpuBvhScene
+		{
+		public:
+			struct InstanceInput
+			{
+				const CpuBvhMesh*	mesh = nullptr;
+				math::Mat34			transform = {};
+			};
+
+			CpuBvhScene();
+			~CpuBvhScene();
+
+			// 参照するCpuBvhMeshはCpuBvhSceneより長く保持すること.
+			void Build(const std::vector<InstanceInput>& instance_array, const CpuBvhBuildDesc& desc = {}, thread::JobSystem* p_job_system = nullptr);
+
+			bool Intersect(const CpuBvhRay& ray, CpuBvhHit& out_hit) const;
+			bool Occluded(const CpuBvhRay& ray) const;
+			u32 IntersectPacket4(const CpuBvhRay* ray4, CpuBvhHit* out_hit4, u32 active_mask = 0xf) const;
+
+			// ワールド空間AABBがAABBまたは視錐台と重なるInstanceを収集する.
+			void QueryAabb(const CpuBvhAabb& aabb, std::vector<u32>& out_instance_array) const;
+			void QueryFrustum(const CpuBvhFrustum& frustum, std::vector<u32>& out_instance_array) const;
+
+			bool IsValid() const { return bvh_.IsValid(); }
+			const CpuBvhAabb& GetBounds() const { return bvh_.GetBounds(); }
+			u32 NumInstance() const { return static_cast<u32>(instance_array_.size()); }
+			const CpuBvhAabb& GetInstanceBounds(u32 instance_index) const { return instance_array_[instance_index].world_aabb; }
+
+		private:
+			struct Instance
+			{
+				const CpuBvhMesh*	mesh = nullptr;
+				math::Mat34			transform = {};
+				math::Mat34			inv_transform = {};
+				CpuBvhAabb			world_aabb = {};
+			};
+			CpuBvh4 bvh_ = {};
+			std::vector<Instance> instance_array_;
+		};
+
+
+		// 一次レイのベンチマーク.
+		struct CpuBvhBenchmarkDesc
+		{
+			math::Vec3	camera_pos = {};
+			math::Vec3	camera_right = math::Vec3(1.0f, 0.0f, 0.0f);
+			math::Vec3	camera_up = math::Vec3(0.0f, 1.0f, 0.0f);
+			math::Vec3	camera_forward = math::Vec3(0.0f, 0.0f, 1.0f);
+			float		fov_y = 1.0471975f;	// not half fov.
+			u32			width = 1280;
+			u32			height = 720;
+			// 繰り返し回数. 計測は合計時間から算出.
+			u32			num_iteration = 1;
+		};
+		struct CpuBvhBenchmarkResult
+		{
+			u64		num_ray = 0;
+			u64		num_hit = 0;
+			double	closest_mrays_per_sec = 0.0;	// 単一レイ最近接交差.
+			double	packet_mrays_per_sec = 0.0;		// 4レイパケット最近接交差.
+			double	occluded_mrays_per_sec = 0.0;	// 単一レイ任意交差.
+		};
+		// ピンホールカメラの一次レイで計測する. p_job_system が有効な場合は行単位で並列実行する.
+		CpuBvhBenchmarkResult RunCpuBvhBenchmark(const CpuBvhScene& scene, const CpuBvhBenchmarkDesc& desc, thread::JobSystem* p_job_system = nullptr);
+	}
+}
@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "gfx/game_scene.h"
+#include "gfx/raytrace/cpu_bvh.h"
+
+namespace ngl
+{
+	namespace gfx
+	{
+		class ResMeshData;
+
+		// SceneRepresentationからCpuBvhSceneを構築する.
+		//	ResMeshData毎にMeshShapePartの三角形をまとめたCpuBvhMeshを生成してキャッシュし, Mesh ProxyをInstanceとする.
+		//	CPU側の位置ストリームのみを参照するためGPU処理を必要としない.
+		class CpuBvhSceneBuilder
+		{
+		public:
+			CpuBvhSceneBuilder();
+			~CpuBvhSceneBuilder();
+
+			// p_job_system が有効な場合は大きな部分木を並列ビルドする.
+			void Build(const SceneRepresentation& scene, thread::JobSystem* p_job_system = nullptr, const CpuBvhBuildDesc& desc = {});
+			// キャッシュしたCpuBvhMeshを破棄する. ResMeshData破棄時等.
+			void ClearMeshCache();
+
+			const CpuBvhScene& GetScene() const { return scene_; }
+			// InstanceのMesh ProxyID. CpuBvhHit::instance_index から引く.
+			fwk::GfxSceneEntityId GetInstanceProxyId(u32 instance_index) const { return instance_proxy_id_array_[instance_index]; }
+			u32 NumMesh() const { return static_cast<u32>(mesh_map_.size()); }
+
+		private:
+			// ResMeshDataのアドレスで識別する. RtSceneManagerのBLASキャッシュと同様.
+			std::unordered_map<const ResMeshData*, std::unique_ptr<CpuBvhMesh>> mesh_map_;
+			std::vector<fwk::GfxSceneEntityId> instance_proxy_id_array_;
+			CpuBvhScene scene_ = {};
+		};
+	}
+}
@@ -18,6 +18,9 @@
 
 #include "gfx/resource/resource_mesh.h"
 #include "gfx/game_scene.h"
+#include "gfx/raytrace/rt_blas_build_scheduler.h"
+#include "gfx/raytrace/rt_shader_table_record.h"
+#include "gfx/raytrace/rt_tlas_instance_tracker.h"
 
 #include "resource/resource_manager.h"
 #include "gfx/resource/resource_shader.h"
@@ -45,6 +48,10 @@ namespace ngl
 
 		// Local Root Signature の各リソース数.
 		static constexpr uint32_t k_rt_local_descriptor_cbvsrvuav_table_size = 16;
+		// BLASのGeometry毎に確保するLocal Descriptor数. CBVテーブル(ダミー1), SRVテーブル(頂点, インデックス).
+		static constexpr uint32_t k_rt_blas_geometry_local_cbv_count = 1;
+		static constexpr uint32_t k_rt_blas_geometry_local_srv_count = 2;
+		static constexpr uint32_t k_rt_blas_geometry_local_descriptor_count = k_rt_blas_geometry_local_cbv_count + k_rt_blas_geometry_local_srv_count;
 
 
 
@@ -88,17 +95,33 @@ namespace ngl
 			~RtBlas();
 
 			// BLAS setup. 必要なBufferやViewの生成まで実行する. Buffer上にAccelerationStructureをビルドするのはBuild関数まで遅延する.
+			// Scratchは外部の共有プールから割り当てるためここでは確保しない.
 			// index_buffer : optional.
 			// bufferの管理責任は外部.
 			bool Setup(rhi::DeviceDep* p_device, const std::vector<RtBlasGeometryDesc>& geometry_desc_array);
 
 			// SetupAs... の情報を元に構造構築コマンドを発行する.
 			// Buildタイミングをコントロールするために分離している.
+			// scratch_address : 共有ScratchプールのGPUアドレス. 0の場合は専用Scratchを確保する.
+			// compacted_size_address : 0以外の場合はコンパクションサイズを書き出すUAVのGPUアドレス.
 			// MEMO. RenderDocでのLaunchはクラッシュするのでNsight推奨.
-			bool Build(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_command_list);
+			bool Build(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_command_list,
+				D3D12_GPU_VIRTUAL_ADDRESS scratch_address = 0, D3D12_GPU_VIRTUAL_ADDRESS compacted_size_address = 0);
+
+			// ビルド済みのBLASをコンパクションサイズのバッファへコピーして置き換える.
+			//	BLASのGPUアドレスが変わるため, 参照するTLASは再構築が必要.
+			bool Compact(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_command_list, u64 compacted_byte_size);
 
 			bool IsSetuped() const;
 			bool IsBuilt() const;
+			bool IsCompacted() const;
+
+			// Prebuild情報.
+			u64 GetScratchByteSize() const { return scratch_byte_size_; }
+			u64 GetResultMaxByteSize() const { return result_max_byte_size_; }
+			// 現在のBLASバッファサイズ. コンパクション後は縮小する.
+			u64 GetResultByteSize() const { return result_byte_size_; }
+			u32 GetPrimitiveCount() const { return primitive_count_; }
 
 			// BLAS Buffer.
 			rhi::BufferDep* GetBuffer();
@@ -115,6 +138,12 @@ namespace ngl
 
 		private:
 			bool is_built_ = false;
+			bool is_compacted_ = false;
+
+			u64 scratch_byte_size_ = 0;
+			u64 result_max_byte_size_ = 0;
+			u64 result_byte_size_ = 0;
+			u32 primitive_count_ = 0;
 
 			// リソースとして頂点バッファやインデックスバッファへアクセスをするために保持.
 			std::vector<RtBlasGeometryDesc> geometry_desc_array_;
@@ -129,11 +158,12 @@ namespace ngl
 
 
 			// built data.
-			rhi::RhiRef<rhi::BufferDep> scratch_;
 			rhi::RhiRef<rhi::BufferDep> main_;
 		};
 
 		// TLAS.
+		//	永続TLAS. Instanceスロット(RtTlasInstanceTracker)に対応するInstanceDescをDefaultHeapのバッファに保持し,
+		//	変更のあったスロット範囲のみアップロードしてRefit(ALLOW_UPDATE)またはフルビルドする.
 		class RtTlas
 		{
 		public:
@@ -143,25 +173,37 @@ namespace ngl
 				TLAS,
 			};
 
+			// 直近のUpdateの統計.
+			struct UpdateStatistics
+			{
+				ERtTlasBuildMode build_mode = ERtTlasBuildMode::None;
+				u32 num_instance = 0;		// スロット数 (空きスロットを含む).
+				u32 num_upload_instance = 0;
+				u32 upload_byte_size = 0;	// InstanceDescのアップロードサイズ.
+				u32 num_upload_range = 0;	// コピーコマンド数.
+				bool is_reallocated = false;	// バッファ再確保によるフルアップロード.
+			};
+
 			RtTlas();
 			~RtTlas();
 
-			// TLAS setup. 必要なBufferやViewの生成まで実行する. Buffer上にAccelerationStructureをビルドするのはBuild関数まで遅延する.
-			// index_buffer : optional.
+			// TLAS update. Instanceスロットの差分からInstanceDescのアップロード準備とビルドモードの決定をする. Buffer上にAccelerationStructureをビルドするのはBuild関数まで遅延する.
+			// blas_array : スロットのblas_indexで参照されるBLAS配列. 空きスロットは無効Instanceとなる.
 			// bufferの管理責任は外部.
-			bool Setup(rhi::DeviceDep* p_device, std::vector<RtBlas*>& blas_array,
-				const std::vector<uint32_t>& instance_geom_id_array,
-				const std::vector<math::Mat34>& instance_transform_array,
-				int hitgroup_count
+			bool Update(rhi::DeviceDep* p_device, const std::vector<RtBlas*>& blas_array,
+				const std::vector<RtTlasInstanceSlot>& slot_array,
+				const RtTlasInstanceUpdateResult& update_result
 			);
 
-			// SetupAs... の情報を元に構造構築コマンドを発行する.
+			// Update の情報を元にInstanceDescのコピーと構造構築コマンドを発行する.
 			// Buildタイミングをコントロールするために分離している.
 			// MEMO. RenderDocでのLaunchはクラッシュするのでNsight推奨.
 			bool Build(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_command_list);
 
 			bool IsSetuped() const;
 			bool IsBuilt() const;
+			// Updateで発行待ちのビルドがあるか.
+			bool IsBuildPending() const;
 
 			// Get AccelerationStructure Buffer.
 			rhi::BufferDep* GetBuffer();
@@ -171,6 +213,7 @@ namespace ngl
 			const rhi::ShaderResourceViewDep* GetSrv() const;
 
 
+			// Instance数. 空きスロットを含む. 空きスロットのBLASインデックスは k_rt_tlas_invalid_blas_index.
 			uint32_t NumInstance() const;
 			const std::vector<uint32_t>& GetInstanceBlasIndexArray() const;
 			const std::vector<math::Mat34>& GetInstanceTransformArray() const;
@@ -180,6 +223,12 @@ namespace ngl
 			uint32_t NumBlas() const;
 			const std::vector<RtBlas*>& GetBlasArray() const;
 
+			const UpdateStatistics& GetUpdateStatistics() const { return update_stat_; }
+
+		private:
+			// Instance容量に合わせたバッファ確保.
+			bool ReallocateBuffer(rhi::DeviceDep* p_device, uint32_t instance_capacity);
+
 		private:
 			bool is_built_ = false;
 
@@ -192,15 +241,30 @@ namespace ngl
 			std::vector<uint32_t> instance_hitgroup_index_offset_array_;
 
 			// build info.
-			// Setupでバッファや設定を登録される. これを用いてRenderThreadでCommandListにビルドタスクを発行する.
+			// Updateでバッファや設定を登録される. これを用いてRenderThreadでCommandListにビルドタスクを発行する.
 			D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS build_setup_info_ = {};
+			ERtTlasBuildMode pending_build_mode_ = ERtTlasBuildMode::None;
+
+			// InstanceDescのアップロード. upload_buffer_ の upload_src_offset からInstanceBufferの指定スロットへコピーする.
+			struct UploadRange
+			{
+				uint32_t src_byte_offset = 0;
+				uint32_t dst_byte_offset = 0;
+				uint32_t byte_size = 0;
+			};
+			std::vector<UploadRange> upload_range_array_;
+			rhi::RhiRef<rhi::BufferDep> upload_buffer_;
 
 			// built data.
+			uint32_t instance_capacity_ = 0;
 			rhi::RhiRef<rhi::BufferDep> instance_buffer_;
+			rhi::EResourceState instance_buffer_state_ = rhi::EResourceState::Common;
 			rhi::RhiRef<rhi::BufferDep> scratch_;
 			rhi::RhiRef<rhi::BufferDep> main_;
 			rhi::RhiRef<rhi::ShaderResourceViewDep> main_srv_;
 			int tlas_byte_size_ = 0;
+
+			UpdateStatistics update_stat_ = {};
 		};
 
 		
@@ -325,13 +389,36 @@ namespace ngl
 			RefRtDxrObjectHolder	ref_shader_object_set_;
 		};
 
+		// ShaderTable.
+		//	永続ShaderTable. HitgroupレコードはRtSceneManagerがBLAS毎に割り当てた範囲(RtHitgroupRecordAllocator)に配置し,
+		//	変更のあったBLASのレコードのみ書き直す.
+		//	GPUが参照中のバッファを書き換えないようにフレーム毎に別のバッファを使い回す. 容量拡張時の古いバッファはRhiRefで遅延破棄される.
 		class RtShaderTable
 		{
 		public:
+			// バッファ数. Frames In Flight の最大 (Swapchainのバッファ数 3) に書き込み中の1つを加える.
+			static constexpr uint32_t k_buffer_count = 4;
+
+			// 直近のUpdateの統計.
+			struct UpdateStatistics
+			{
+				u32 num_write_record = 0;	// 書き込んだHitgroupレコード数.
+				u32 num_write_slot = 0;		// 書き込んだBLASスロット数.
+				bool is_full_write = false;	// バッファ再確保や容量拡張による全体書き込み.
+			};
+
 			RtShaderTable() {}
 			~RtShaderTable() {}
 
+			// 今フレームのバッファを選択して変更のあったレコードを書き込む.
+			//	エントリとするRayGenシェーダ名を指定する. HitGroupやMissShaderはStateObjectに登録されているものがすべて利用される.
+			bool Update(rhi::DeviceDep* p_device, const class RtSceneManager& rt_scene, const RtStateObject& state_object, const char* raygen_name);
+			void Finalize();
+
+			const UpdateStatistics& GetUpdateStatistics() const { return update_stat_; }
 
+		public:
+			// 今フレームのバッファ.
 			rhi::RhiRef<rhi::BufferDep>	shader_table_;
 
 			uint32_t		table_entry_byte_size_ = 0;
@@ -341,15 +428,31 @@ namespace ngl
 			uint32_t		table_miss_count_ = 0;
 			uint32_t		table_hitgroup_offset_ = 0;
 			uint32_t		table_hitgroup_count_ = 0;
+
+		private:
+			// ShaderIdentifierのキャッシュ. StateObjectかRayGenが変わった場合のみ取得し直す.
+			bool UpdateShaderIdentifier(const RtStateObject& state_object, const char* raygen_name);
+
+		private:
+			using ShaderIdentifier = std::array<u8, D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES>;
+
+			struct TableBuffer
+			{
+				rhi::RhiRef<rhi::BufferDep>	buffer;
+				u32							byte_size = 0;
+				RtShaderTableWriteState		write_state = {};
+			};
+			std::array<TableBuffer, k_buffer_count> buffer_array_ = {};
+
+			const RtStateObject*			p_identifier_state_object_ = {};
+			std::string						identifier_raygen_name_ = {};
+			ShaderIdentifier				raygen_identifier_ = {};
+			std::vector<ShaderIdentifier>	miss_identifier_array_ = {};
+			std::vector<ShaderIdentifier>	hitgroup_identifier_array_ = {};
+
+			std::vector<u32>				dirty_slot_array_ = {};
+			UpdateStatistics				update_stat_ = {};
 		};
-		// 引数のTLASはSetupでRHIリソース確保等がされていれば良い(Build不要).
-		//	エントリとするRayGenシェーダ名を指定する. HitGroupやMissShaderはStateObjectに登録されているものがすべて利用される.
-		static bool CreateShaderTable(
-			RtShaderTable& out,
-			rhi::DeviceDep* p_device,
-			rhi::DynamicDescriptorStackAllocatorInterface& desc_alloc_interface,
-			const RtTlas& tlas, uint32_t tlas_hitgroup_count_max,
-			const RtStateObject& state_object, const char* raygen_name);
 
 
 		// Raytraceの基本部分を担当するクラス.
@@ -365,7 +468,7 @@ namespace ngl
 				const std::vector<RtShaderRegisterInfo>& shader_info_array,
 				uint32_t payload_byte_size = sizeof(float) * 4, uint32_t attribute_byte_size = sizeof(float) * 2, uint32_t max_trace_recursion = 1);
 			
-			// ShaderTable再生成等.
+			// ShaderTable更新等.
 			bool UpdateScene(class RtSceneManager* p_rt_scene, const char* ray_gen_name);
 			
 			struct DispatchRayParam
@@ -387,13 +490,12 @@ namespace ngl
 			RtShaderTable* GetShaderTable();
 
 		protected:
-			// UpdateSceneでのShaderTable再生成に伴う破棄処理.
+			// ShaderTableの破棄処理.
 			void DestroyShaderTable();
 		protected:
 			rhi::DeviceDep* p_device_ = {};
 
 			RtStateObject state_object_ = {};
-			rhi::DynamicDescriptorStackAllocatorInterface	desc_alloc_interface_ = {};
 			
 			RtShaderTable shader_table_ = {};
 
@@ -460,8 +562,8 @@ namespace ngl
 			};
 			void DispatchRay(rhi::GraphicsCommandListDep* p_command_list, const DispatchRayParam& param);
 
-			// TLAS他のリビルド. 破棄バッファリングの関係でRenderThread実行を想定.
-			void UpdateRtScene(rhi::DeviceDep* p_device, const SceneRepresentation& scene);
+			// BLASビルドキューの処理とTLAS他の更新. 破棄バッファリングの関係でRenderThread実行を想定.
+			void UpdateRtScene(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_command_list, const SceneRepresentation& scene);
 
 		public:
 			rhi::DynamicDescriptorStackAllocatorInterface& GetDynamicDescriptorAllocator() { return desc_alloc_interface_; }
@@ -470,12 +572,34 @@ namespace ngl
 			const RtTlas* GetSceneTlas() const;
 
 			int NumHitGroupCountMax() const;
+
+			// BLASスロット毎のHitgroupレコード割り当て. ShaderTableはこの配置でレコードを書き込む.
+			const RtHitgroupRecordAllocator& GetHitgroupRecordAllocator() const { return hitgroup_record_allocator_; }
+			// BLASスロットのGeometryに対応するLocalRootSignature用DescriptorTable (CBV, SRV).
+			bool GetBlasGeometryLocalDescriptor(u32 blas_index, u32 geometry_index, D3D12_GPU_DESCRIPTOR_HANDLE& out_cbv_table, D3D12_GPU_DESCRIPTOR_HANDLE& out_srv_table) const;
 			
 			rhi::ConstantBufferViewDep* GetSceneViewCbv();
 			const rhi::ConstantBufferViewDep* GetSceneViewCbv() const;
 
 			void SetCameraInfo(const math::Vec3& position, const math::Vec3& dir, const math::Vec3& up, float fov_y_radian, float aspect_ratio);
 
+			// 直近フレームのTLAS更新統計.
+			RtTlas::UpdateStatistics GetTlasUpdateStatistics() const;
+
+			// BLASメモリ統計.
+			struct BlasStatistics
+			{
+				u32 num_blas = 0;
+				u32 num_pending_build = 0;
+				u32 num_pending_compaction = 0;
+				u32 num_build_in_frame = 0;
+				u32 num_compaction_in_frame = 0;
+				u64 result_max_byte = 0;	// 全BLASのコンパクション前サイズ.
+				u64 result_byte = 0;		// 全BLASの現在のサイズ.
+				u64 scratch_pool_byte = 0;	// 共有Scratchプールのサイズ.
+			};
+			BlasStatistics GetBlasStatistics() const;
+
 		private:
 			bool is_initialized_ = false;
 			uint32_t frame_count_ = 0;
@@ -485,13 +609,42 @@ namespace ngl
 			// 動的更新でのBLAS管理.
 			std::vector<std::shared_ptr<RtBlas>> dynamic_scene_blas_array_;
 
-			// 動的更新TLAS.
+			// BLASビルドキュー. 共有Scratchプールから割り当てて予算内で複数ビルドし, 数フレーム後にコンパクションする.
+			void UpdateBlasBuild(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_command_list);
+			RtBlasBuildScheduler blas_build_scheduler_ = {};
+			rhi::RhiRef<rhi::BufferDep> blas_scratch_pool_;
+			// コンパクションサイズ書き出し先 (リング数 * フレーム毎ビルド数). UAV.
+			rhi::RhiRef<rhi::BufferDep> blas_postbuild_buffer_;
+			rhi::EResourceState blas_postbuild_buffer_state_ = rhi::EResourceState::Common;
+			// コンパクションサイズのリードバック. リング毎.
+			std::vector<rhi::RhiRef<rhi::BufferDep>> blas_postbuild_readback_;
+			BlasStatistics blas_stat_ = {};
+
+			// 動的更新TLAS. 永続で差分更新する.
 			std::shared_ptr<RtTlas> dynamic_tlas_ = {};
+			// TLAS Instanceスロット管理.
+			RtTlasInstanceTracker tlas_instance_tracker_ = {};
+			RtTlasInstanceUpdateResult tlas_instance_update_result_ = {};
+			std::vector<RtTlasInstanceInput> tlas_instance_input_array_ = {};
 			uint32_t hitgroup_count_max_ = 1;
+
+			// BLASスロット毎のHitgroupレコード割り当て. (Geometry数 * hitgroup_count_max_) の連続レコード.
+			RtHitgroupRecordAllocator hitgroup_record_allocator_ = {};
+			// BLASスロット毎のLocalRootSignature用Descriptor. BLASと同じ寿命で保持する.
+			//	Geometry毎に k_rt_blas_geometry_local_descriptor_count 個 (CBVテーブル, SRVテーブルの順).
+			void AllocateBlasLocalDescriptor(rhi::DeviceDep* p_device, u32 blas_index);
+			struct BlasLocalDescriptor
+			{
+				rhi::DynamicDescriptorAllocHandle	handle = {};
+				D3D12_GPU_DESCRIPTOR_HANDLE			h_gpu = {};
+			};
+			std::vector<BlasLocalDescriptor> blas_local_descriptor_array_;
+			u32 local_descriptor_stride_ = 0;
 			
 			rhi::DynamicDescriptorStackAllocatorInterface	desc_alloc_interface_ = {};
 
-			rhi::ConstantBufferPooledHandle				cbh_scene_view[2];
+			// 今フレームのSceneView定数バッファ. UpdateOnRenderで毎フレームPoolから確保する.
+			rhi::ConstantBufferPooledHandle				cbh_scene_view = {};
 
 			math::Vec3 camera_pos_ = {};
 			math::Vec3 camera_dir_ = {};
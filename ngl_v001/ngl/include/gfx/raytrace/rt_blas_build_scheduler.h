@@ -0,0 +1,104 @@
+﻿#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "util/types.h"
+
+namespace ngl
+{
+	namespace gfx
+	{
+		// BLASビルド要求.
+		struct RtBlasBuildRequest
+		{
+			u32 id = 0;					// 要求元の識別子.
+			u64 scratch_byte_size = 0;	// Prebuildで得たScratchサイズ.
+			u64 result_byte_size = 0;	// Prebuildで得たResultDataMaxSize.
+			u32 primitive_count = 0;	// ビルド時間の見積もり用.
+		};
+
+		// 今フレームでビルドするBLAS.
+		struct RtBlasBuildItem
+		{
+			u32 id = 0;
+			u64 scratch_offset = 0;				// 共有Scratchプール上のオフセット.
+			bool use_dedicated_scratch = false;	// プールに収まらないため専用Scratchを利用する.
+			u32 postbuild_index = 0;			// コンパクションサイズ書き出し先のインデックス (今フレームのリング内).
+		};
+
+		// 今フレームでコンパクション可能なBLAS. ringのpostbuild_indexにコンパクションサイズがリードバック済み.
+		struct RtBlasCompactionItem
+		{
+			u32 id = 0;
+			u32 ring_index = 0;
+			u32 postbuild_index = 0;
+			u64 build_frame_index = 0;	// ビルドを発行したデバイスフレームインデックス.
+		};
+
+		// BLASビルドのスケジューラ.
+		//	ビルド要求をFIFOで保持し, フレーム毎の予算 (ビルド数, 結果メモリ, プリミティブ数) 内でビルドするBLASを選択する.
+		//	Scratchは共有プールから線形に割り当て, フレーム毎にリセットする.
+		//	ビルド時に書き出したコンパクションサイズは, ビルドしたデバイスフレームのGPU完了後にリードバック済みとしてコンパクション対象を返す.
+		//	リングを一周してもGPUが未完了のリングは再利用せず, 完了までコンパクションとビルドを停止する.
+		//	デバイス非依存.
+		class RtBlasBuildScheduler
+		{
+		public:
+			// D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT.
+			static constexpr u64 k_scratch_alignment = 256;
+
+			struct Desc
+			{
+				// 共有Scratchプールのサイズ.
+				u64 scratch_pool_byte_size = 32ull * 1024 * 1024;
+				// フレーム毎のビルド数上限.
+				u32 max_build_per_frame = 32;
+				// フレーム毎のビルド結果メモリ上限 (ResultDataMaxSizeの合計).
+				u64 max_result_byte_per_frame = 128ull * 1024 * 1024;
+				// フレーム毎のプリミティブ数上限. GPUビルド時間の見積もり.
+				u32 max_primitive_per_frame = 4u * 1024 * 1024;
+				// コンパクションサイズのリードバックリング数. 少ないとGPU完了待ちでビルドが停止しやすくなる.
+				u32 readback_ring_count = 3;
+			};
+
+			RtBlasBuildScheduler();
+			~RtBlasBuildScheduler();
+
+			void Initialize(const Desc& desc);
+
+			void Enqueue(const RtBlasBuildRequest& request);
+
+			// フレーム開始.
+			//	frame_index : 今フレームのデバイスフレームインデックス (DeviceDep::GetDeviceFrameIndex).
+			//	completed_frame_index : GPUが処理を完了したフレームインデックス (DeviceDep::GetCompletedFrameIndex).
+			//	out_compaction : 今フレームのリングにリードバック済みのコンパクション対象. ビルドより先に処理すること.
+			//	out_build : 今フレームでビルドするBLAS. postbuild_indexは今フレームのリングに書き出す.
+			void BeginFrame(u64 frame_index, u64 completed_frame_index, std::vector<RtBlasCompactionItem>& out_compaction, std::vector<RtBlasBuildItem>& out_build);
+
+			// 今フレームのリングインデックス. BeginFrame後に有効.
+			u32 GetRingIndex() const { return ring_index_; }
+			u32 NumPendingBuild() const { return static_cast<u32>(pending_.size()); }
+			// ビルド済みでコンパクション待ちの数.
+			u32 NumPendingCompaction() const;
+			// 今フレームで使用したScratchプールのサイズ.
+			u64 GetFrameScratchUsage() const { return frame_scratch_usage_; }
+
+			const Desc& GetDesc() const { return desc_; }
+
+		private:
+			Desc desc_ = {};
+
+			std::deque<RtBlasBuildRequest> pending_;
+			// リング毎のリードバック待ち.
+			std::vector<std::vector<RtBlasCompactionItem>> inflight_;
+			u32 ring_index_ = 0;
+			// 使用したリングの数. GPU完了待ちで停止したフレームは進めない.
+			u64 frame_count_ = 0;
+			u64 frame_scratch_usage_ = 0;
+		};
+
+		// フレーム毎の予算, Scratchのアラインメントと再利用, GPU完了に基づくコンパクションのリードバックのテスト.
+		void TestRtBlasBuildScheduler();
+	}
+}
@@ -0,0 +1,128 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "util/types.h"
+
+namespace ngl
+{
+	namespace gfx
+	{
+		// 割り当て無しのレコードオフセット.
+		static constexpr u32 k_rt_hitgroup_record_invalid_offset = ~0u;
+
+		// ShaderTableのレイアウト計算用.
+		struct RtShaderTableLayoutDesc
+		{
+			u32 shader_identifier_byte_size = 32;	// D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES.
+			u32 record_param_byte_size = 0;			// ShaderIdentifierに続くLocalRootSignatureのパラメータサイズ.
+			u32 record_alignment = 32;				// D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT.
+			u32 table_alignment = 64;				// D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT.
+
+			u32 num_raygen = 1;
+			u32 num_miss = 0;
+			u32 hitgroup_record_capacity = 0;
+		};
+		// ShaderTableのレイアウト. RayGen, Miss, Hitgroupの各テーブルをtable_alignmentに揃えて配置する.
+		struct RtShaderTableLayout
+		{
+			u32 record_byte_size = 0;
+			u32 raygen_offset = 0;
+			u32 miss_offset = 0;
+			u32 miss_count = 0;
+			u32 hitgroup_offset = 0;
+			u32 hitgroup_capacity = 0;
+			u32 total_byte_size = 0;
+
+			u32 GetMissRecordOffset(u32 miss_index) const { return miss_offset + record_byte_size * miss_index; }
+			u32 GetHitgroupRecordOffset(u32 record_index) const { return hitgroup_offset + record_byte_size * record_index; }
+		};
+		RtShaderTableLayout ComputeShaderTableLayout(const RtShaderTableLayoutDesc& desc);
+
+
+		// Hitgroupレコードのスロット. BLAS毎に (Geometry数 * Hitgroup数) の連続レコードを割り当てる.
+		struct RtHitgroupRecordSlot
+		{
+			u32 record_offset = k_rt_hitgroup_record_invalid_offset;	// InstanceContributionToHitGroupIndex.
+			u32 record_count = 0;
+			u32 generation = 0;		// 割り当てや内容の変更毎に更新. ShaderTable側の書き直し判定に利用する.
+
+			bool IsValid() const { return k_rt_hitgroup_record_invalid_offset != record_offset; }
+		};
+
+		// Hitgroupレコードの割り当て.
+		//	スロット (BLASの永続インデックス) 毎に連続するレコード範囲を割り当て, 解放された範囲は結合して再利用する.
+		//	容量が不足した場合は拡張し, GetCapacityVersion を更新する.
+		//	デバイス非依存.
+		class RtHitgroupRecordAllocator
+		{
+		public:
+			struct Desc
+			{
+				u32		initial_capacity = 256;
+				// 容量拡張時の倍率.
+				float	grow_rate = 1.5f;
+			};
+
+			RtHitgroupRecordAllocator();
+			~RtHitgroupRecordAllocator();
+
+			void Initialize(const Desc& desc);
+
+			// スロットにレコードを割り当てる. 既に同数で割り当て済みの場合は何もしない.
+			u32 AllocateSlot(u32 slot_index, u32 record_count);
+			void FreeSlot(u32 slot_index);
+			// スロットの内容変更を通知する. 範囲はそのままで書き直し対象になる.
+			void InvalidateSlot(u32 slot_index);
+
+			u32 GetSlotRecordOffset(u32 slot_index) const;
+			const std::vector<RtHitgroupRecordSlot>& GetSlotArray() const { return slot_array_; }
+
+			u32 GetCapacity() const { return capacity_; }
+			// 容量拡張毎に更新.
+			u32 GetCapacityVersion() const { return capacity_version_; }
+			u32 NumAllocatedRecord() const { return num_allocated_record_; }
+
+		private:
+			u32 AllocateRange(u32 count);
+			void FreeRange(u32 offset, u32 count);
+
+		private:
+			Desc desc_ = {};
+
+			struct FreeBlock
+			{
+				u32 begin = 0;
+				u32 count = 0;
+			};
+			// 先頭位置でソート済みの空き範囲.
+			std::vector<FreeBlock> free_range_array_;
+			std::vector<RtHitgroupRecordSlot> slot_array_;
+
+			u32 capacity_ = 0;
+			u32 capacity_version_ = 0;
+			u32 num_allocated_record_ = 0;
+			u32 generation_ = 0;
+		};
+
+		// ShaderTableバッファ1つ分の書き込み状態.
+		//	スロット毎に書き込み済みの世代を保持し, 変更のあったスロットのみを書き直し対象とする.
+		class RtShaderTableWriteState
+		{
+		public:
+			// 書き直しが必要なスロットを収集して書き込み済みとする.
+			//	戻り値がtrueの場合はテーブル全体の書き直しが必要 (初回, 容量拡張, Reset後). その場合も有効なスロットは全て out_slot_array に含まれる.
+			bool CollectDirtySlot(const RtHitgroupRecordAllocator& allocator, std::vector<u32>& out_slot_array);
+			// 次回のCollectDirtySlotで全体を書き直す.
+			void Reset();
+
+		private:
+			bool is_written_ = false;
+			u32 capacity_version_ = 0;
+			std::vector<u32> written_generation_;
+		};
+
+		// レイアウト計算, Hitgroupレコードの割り当てと解放, 容量拡張, 書き直し対象スロットの収集のテスト.
+		void TestRtShaderTableRecord();
+	}
+}
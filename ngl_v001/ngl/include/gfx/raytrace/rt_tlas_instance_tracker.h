@@ -0,0 +1,126 @@
+﻿#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "math/math.h"
+#include "util/types.h"
+
+namespace ngl
+{
+	namespace gfx
+	{
+		// 空きスロットのBLASインデックス.
+		static constexpr u32 k_rt_tlas_invalid_blas_index = ~0u;
+
+		// TLAS構築モード.
+		enum class ERtTlasBuildMode : int
+		{
+			None,		// 変更なし. ビルド不要.
+			Refit,		// ALLOW_UPDATE による更新.
+			Rebuild,	// フルビルド.
+		};
+
+		// フレーム毎のInstance入力.
+		struct RtTlasInstanceInput
+		{
+			u64			key = 0;					// Instanceを識別する永続キー (ProxyID等).
+			u32			blas_index = 0;				// 参照BLAS.
+			u32			hitgroup_offset = 0;		// InstanceContributionToHitGroupIndex. BLAS毎に割り当てたHitgroupレコードの先頭 (RtHitgroupRecordAllocator).
+			math::Mat34	transform = {};
+		};
+
+		// Instanceスロット. TLASのInstanceDescと1:1に対応する.
+		struct RtTlasInstanceSlot
+		{
+			u64			key = 0;
+			u32			blas_index = k_rt_tlas_invalid_blas_index;	// 空きスロットは k_rt_tlas_invalid_blas_index.
+			u32			hitgroup_offset = 0;	// InstanceContributionToHitGroupIndex.
+			math::Mat34	transform = {};
+
+			bool IsValid() const { return k_rt_tlas_invalid_blas_index != blas_index; }
+		};
+
+		// アップロードが必要なスロット範囲.
+		struct RtTlasInstanceDirtyRange
+		{
+			u32 begin = 0;
+			u32 count = 0;
+		};
+
+		struct RtTlasInstanceUpdateResult
+		{
+			ERtTlasBuildMode build_mode = ERtTlasBuildMode::None;
+			std::vector<RtTlasInstanceDirtyRange> dirty_range_array;
+
+			u32 num_added = 0;
+			u32 num_removed = 0;
+			u32 num_moved = 0;
+			u32 num_dirty_slot = 0;	// dirty_range_array の合計スロット数.
+		};
+
+		// TLAS Instanceの差分管理.
+		//	Instance毎に永続スロットを割り当て, フレーム間の差分からアップロードが必要なスロット範囲とビルドモードを決定する.
+		//	Instanceの追加削除やBLASの変更はフルビルド, Transformのみの変更はRefitとする.
+		//	Refitを繰り返すとBVHの品質が劣化するため, Refit回数と移動量の累積が閾値を超えた場合もフルビルドとする.
+		//	デバイス非依存.
+		class RtTlasInstanceTracker
+		{
+		public:
+			struct Desc
+			{
+				// フルビルド無しで許容するRefit回数.
+				u32		max_refit_count = 120;
+				// Refit毎に (移動Instance数 / 有効Instance数) を累積し, この値を超えたらフルビルド.
+				//	全Instanceが移動するRefitを何回分許容するかに相当する.
+				float	refit_degrade_limit = 8.0f;
+				// 間隔がこのスロット数以下のDirty範囲は結合する. コピーコマンド数の削減用.
+				u32		dirty_range_merge_gap = 4;
+			};
+
+			RtTlasInstanceTracker();
+			~RtTlasInstanceTracker();
+
+			void Initialize(const Desc& desc);
+
+			// 今フレームのInstance配列から差分を計算する. keyは配列内で一意であること.
+			void Update(const std::vector<RtTlasInstanceInput>& instance_array, RtTlasInstanceUpdateResult& out_result);
+
+			// 次回Updateでの全スロットアップロードとフルビルドを要求. バッファ再生成時等に利用.
+			void RequestFullRebuild();
+
+			u32 NumSlot() const { return static_cast<u32>(slot_array_.size()); }
+			u32 NumValidInstance() const { return static_cast<u32>(key_to_slot_.size()); }
+			const std::vector<RtTlasInstanceSlot>& GetSlotArray() const { return slot_array_; }
+
+			// 最後のフルビルドからのRefit回数.
+			u32 GetRefitCount() const { return refit_count_; }
+			float GetRefitDegrade() const { return refit_degrade_; }
+
+		private:
+			u32 AllocSlot();
+			void FreeSlot(u32 slot);
+
+		private:
+			Desc desc_ = {};
+
+			std::vector<RtTlasInstanceSlot> slot_array_;
+			std::unordered_map<u64, u32> key_to_slot_;
+			// 空きスロット. 降順に保持して末尾から若い番号を取り出す.
+			std::vector<u32> free_slot_array_;
+
+			// 今フレームの入力に含まれたかの判定用.
+			std::vector<u32> slot_seen_frame_;
+			// アップロードが必要なスロット.
+			std::vector<u8> slot_dirty_;
+			u32 frame_ = 0;
+
+			u32 refit_count_ = 0;
+			float refit_degrade_ = 0.0f;
+			bool request_full_rebuild_ = true;
+		};
+
+		// スロットの再利用と切り詰め, Dirty範囲の結合, RefitとRebuildの判定のテスト.
+		void TestRtTlasInstanceTracker();
+	}
+}
@@ -7,6 +7,8 @@
 #include "rhi/d3d12/resource_view.d3d12.h"
 #include "util/singleton.h"
 
+#include "gfx/material/bindless_material_buffer.h"
+
 #include "resource/resource_manager.h"
 
 namespace ngl::gfx
@@ -38,6 +40,9 @@ namespace ngl::gfx
             res::ResourceHandle<ResTexture> tex_default_normal = {};
             
         } default_resource_;
+
+        // Bindlessマテリアルテーブル. DeviceのBindless有効時のみ初期化される.
+        BindlessMaterialBuffer bindless_material_buffer_;
     };
 
 }
@@ -0,0 +1,77 @@
+﻿/*
+    ibl_bake_cache.h
+    IBLの事前計算結果 (GGX Specular Cubemap Mipチェイン, DFG LUT, Diffuse放射照度SH) のキャッシュ.
+    ソースのコンテンツハッシュと計算パラメータをキーとしてファイルへ保存し, 次回以降のロードで畳み込み計算を省略する.
+    デバイス非依存.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "util/types.h"
+
+#include "gfx/rendering/ibl_sh.h"
+
+namespace ngl
+{
+namespace gfx
+{
+    // キャッシュするテクスチャ.
+    //  Subresource (D3D順. mip + array_index * mip_count) 毎に行間を詰めたピクセルを連続配置する. ブロック圧縮フォーマットは非対応.
+    struct IblBakeCacheTexture
+    {
+        u32 format = 0;         // rhi::EResourceFormat.
+        u32 width = 0;
+        u32 height = 0;
+        u32 array_size = 0;
+        u32 mip_count = 0;
+        u32 byte_per_pixel = 0;
+        std::vector<u8> pixel_memory = {};
+
+        u32 NumSubresource() const { return array_size * mip_count; }
+        u32 GetMipWidth(u32 mip) const { return (width >> mip) ? (width >> mip) : 1u; }
+        u32 GetMipHeight(u32 mip) const { return (height >> mip) ? (height >> mip) : 1u; }
+        u32 GetSubresourceRowPitch(u32 subresource) const { return GetMipWidth(subresource % mip_count) * byte_per_pixel; }
+        u64 GetSubresourceByteSize(u32 subresource) const { return static_cast<u64>(GetSubresourceRowPitch(subresource)) * GetMipHeight(subresource % mip_count); }
+        u64 GetSubresourceByteOffset(u32 subresource) const;
+        // 形状から計算したピクセルのバイト数.
+        u64 CalcTotalByteSize() const;
+
+        // 初期化してピクセルメモリを確保する.
+        void Initialize(u32 format, u32 width, u32 height, u32 array_size, u32 mip_count, u32 byte_per_pixel);
+        bool IsValid() const { return 0 < NumSubresource() && 0 < byte_per_pixel && pixel_memory.size() == CalcTotalByteSize(); }
+    };
+
+    struct IblBakeCacheData
+    {
+        Sh9Rgb                  diffuse_irradiance_sh = {};     // ConvolveSh9WithCosineLobe 適用済み.
+        IblBakeCacheTexture     ggx_specular_cubemap = {};
+        IblBakeCacheTexture     ggx_dfg_lut = {};
+    };
+
+    // キャッシュのキー.
+    struct IblBakeCacheKey
+    {
+        u64 src_hash = 0;                   // ソースファイルのコンテンツハッシュ.
+        u32 specular_resolution = 0;
+        u32 specular_mip_count = 0;
+        u32 specular_format = 0;
+        u32 dfg_lut_resolution = 0;
+        u32 dfg_lut_format = 0;
+        u32 prevent_aliasing_mode_specular = 0;
+    };
+    // キーからキャッシュのハッシュを計算する. src_hash が0の場合は0 (無効).
+    u64 CalcIblBakeCacheHash(const IblBakeCacheKey& key);
+    // ソースファイル名とハッシュからキャッシュファイルのパスを構築し, キャッシュディレクトリを作成する.
+    bool BuildIblBakeCachePath(const char* src_path, u64 cache_hash, std::string& out_path);
+
+    // キャッシュの保存.
+    bool SaveIblBakeCache(const char* cache_path, u64 cache_hash, const IblBakeCacheData& data);
+    // キャッシュのロード. ファイルが無い場合, バージョンやハッシュの不一致, サイズ不正の場合はfalse.
+    bool LoadIblBakeCache(const char* cache_path, u64 cache_hash, IblBakeCacheData& out_data);
+
+    // 保存とロードの往復, 不正なキャッシュの棄却のテスト.
+    void TestIblBakeCache();
+}
+}
@@ -0,0 +1,49 @@
+﻿/*
+    ibl_sh.h
+    HDRパノラマイメージからの L2 球面調和関数 (SH) 射影と, Diffuse IBL用の放射照度SH.
+    デバイス非依存.
+*/
+#pragma once
+
+#include "util/types.h"
+#include "math/math.h"
+
+namespace ngl
+{
+namespace thread
+{
+    class JobSystem;
+}
+
+namespace gfx
+{
+    // L2 SH 9係数のRGB.
+    //  係数の順序は (l,m) = (0,0), (1,-1), (1,0), (1,1), (2,-2), (2,-1), (2,0), (2,1), (2,2).
+    //  基底は Y-Up の実数SH. Y_1,-1 = y, Y_1,0 = z, Y_1,1 = x に比例する.
+    struct Sh9Rgb
+    {
+        static constexpr u32 k_num_coef = 9;
+
+        math::Vec3 coef[k_num_coef] = {};
+    };
+
+    // パノラマイメージの放射輝度をSHへ射影する. 行単位で分割してJobSystemで並列に積分し, 行内はSSEで4ピクセルずつ処理する.
+    //  p_rgba : R32G32B32A32_FLOAT のピクセル. row_pitch_byte は行のバイト数.
+    //  パノラマの方向はシェーダの CalcPanoramaTexcoordFromWorldSpaceRay と一致する. 立体角は行毎に厳密に計算する.
+    //  p_job_system が nullptr の場合はカレントスレッドで実行する.
+    void ProjectPanoramaToSh9(Sh9Rgb& out_radiance_sh, const float* p_rgba, u32 width, u32 height, u32 row_pitch_byte, thread::JobSystem* p_job_system = nullptr);
+
+    // ProjectPanoramaToSh9 の検証用リファレンス. ピクセル毎に方向と基底を倍精度で計算する単純な実装.
+    void ProjectPanoramaToSh9Reference(Sh9Rgb& out_radiance_sh, const float* p_rgba, u32 width, u32 height, u32 row_pitch_byte);
+
+    // 放射輝度SHとLambertの余弦ローブを畳み込み, 放射照度Eを円周率で除算した E/π のSHを返す.
+    //  従来の畳み込みCubemapと同じ値域で, 一様な放射輝度Lに対してLとなる.
+    Sh9Rgb ConvolveSh9WithCosineLobe(const Sh9Rgb& radiance_sh);
+
+    // 方向 dir (正規化済み) でSHを評価する.
+    math::Vec3 EvaluateSh9(const Sh9Rgb& sh, const math::Vec3& dir);
+
+    // 解析解とリファレンスとの比較, 並列実行の一致のテスト.
+    void TestIblSh();
+}
+}
@@ -3,9 +3,13 @@
 */
 #pragma once
 
+#include <functional>
+
 #include "math/math.h"
 
 #include "framework/gfx_scene.h"
+#include "gfx/rendering/parallel_draw_record.h"
+#include "gfx/rtg/rtg_common.h"
 
 namespace ngl
 {
@@ -37,5 +41,23 @@ namespace gfx
     void RenderMeshWithMaterial(
         rhi::GraphicsCommandListDep& command_list, const char* pass_name,
         fwk::GfxScene* gfx_scene, const std::vector<fwk::GfxSceneEntityId>& mesh_proxy_id_array, const RenderMeshResource& render_mesh_resource);
+    // mesh_proxy_id_array の [begin, end) の範囲のみ描画する. RootConstantで渡す描画インデックスは mesh_proxy_id_array 上のインデックスのまま.
+    void RenderMeshWithMaterial(
+        rhi::GraphicsCommandListDep& command_list, const char* pass_name,
+        fwk::GfxScene* gfx_scene, const std::vector<fwk::GfxSceneEntityId>& mesh_proxy_id_array, const RenderMeshResource& render_mesh_resource,
+        int begin, int end);
+
+    // Mesh毎の描画コストの見積り. Shape数 (DrawCall数).
+    void EstimateMeshDrawCost(fwk::GfxScene* gfx_scene, const std::vector<fwk::GfxSceneEntityId>& mesh_proxy_id_array, std::vector<u32>& out_draw_cost);
+
+    // 描画リストをコストで分割し, Taskの複数CommandListへ並列に記録する. 戻り値は使用したCommandList数.
+    //  command_list_allocator の first_command_list_index 番目から順にチャンク毎のCommandListを使う. 分割しない場合は first_command_list_index のみ.
+    //  p_job_system : RenderTaskGraphBuilder::GetExecuteJobSystem(). nullptr の場合は分割しない.
+    //  setup_function : チャンク毎のCommandListで描画前に呼ばれる. RenderTarget, Viewport等はCommandList間で引き継がれないため毎回設定する.
+    int RenderMeshWithMaterialParallel(
+        rtg::TaskGraphicsCommandListAllocator& command_list_allocator, int first_command_list_index,
+        thread::JobSystem* p_job_system, const DrawSplitDesc& split_desc,
+        const char* pass_name, fwk::GfxScene* gfx_scene, const std::vector<fwk::GfxSceneEntityId>& mesh_proxy_id_array, const RenderMeshResource& render_mesh_resource,
+        const std::function<void(rhi::GraphicsCommandListDep* command_list, int chunk_index)>& setup_function);
 }
 }
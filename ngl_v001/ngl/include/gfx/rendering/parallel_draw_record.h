@@ -0,0 +1,51 @@
+﻿/*
+    parallel_draw_record.h
+    描画リストの分割と複数CommandListへの並列記録.
+    デバイス非依存. 分割範囲の決定とJobSystem上での記録関数の実行のみを行い, CommandListの確保と描画状態の設定は利用側.
+*/
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "util/types.h"
+
+namespace ngl
+{
+namespace thread
+{
+    class JobSystem;
+}
+
+namespace gfx
+{
+    // 描画リスト上の範囲 [begin, end).
+    struct DrawChunkRange
+    {
+        int begin = 0;
+        int end = 0;
+
+        int Count() const { return end - begin; }
+    };
+
+    struct DrawSplitDesc
+    {
+        int max_chunk = 4;          // 分割数の上限. 1以下で分割無し.
+        u32 min_chunk_cost = 64;    // 1チャンク当たりの最小コスト. CommandListの追加と描画状態の再設定に見合わない細かな分割をしない.
+    };
+
+    // 描画リストを見積りコストが均等になるよう連続範囲のチャンクに分割する. 戻り値はチャンク数. 空のリストでは0.
+    //  draw_cost : 要素毎の見積りコスト. 単位は任意の相対値.
+    //  チャンクは元の順序を保つため, チャンク順に記録したCommandListを順に実行すれば単一CommandListと同じ描画順になる.
+    int SplitDrawListByCost(const std::vector<u32>& draw_cost, const DrawSplitDesc& desc, std::vector<DrawChunkRange>& out_chunk);
+
+    // num_chunk 個のチャンクの記録関数を並列実行し, 全ての完了を待つ. 呼び出しスレッドも記録に参加する.
+    //  未着手のチャンクは呼び出しスレッドが引き取るため, JobSystemのWorker上 (並列Executeされる RTG のRender Lambda等) から
+    //  同じJobSystemを指定して呼び出してもデッドロックしない. JobSystem::WaitAll は使わない.
+    //  p_job_system が nullptr の場合はカレントスレッドで順に実行する.
+    void ParallelRecordChunk(thread::JobSystem* p_job_system, int num_chunk, const std::function<void(int chunk_index)>& record_function);
+
+    // 分割の均等性と順序, Worker上からの入れ子の並列記録のテスト.
+    void TestParallelDrawRecord();
+}
+}
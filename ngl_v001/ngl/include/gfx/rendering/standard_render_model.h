@@ -3,6 +3,9 @@
 */
 #pragma once
 
+#include <array>
+
+#include "gfx/material/bindless_material_table.h"
 #include "gfx/material/material_shader_manager.h"
 #include "gfx/resource/resource_mesh.h"
 #include "gfx/resource/resource_texture.h"
@@ -48,7 +51,7 @@ namespace ngl
         {
         public:
             StandardRenderModel()  = default;
-            ~StandardRenderModel() = default;
+            ~StandardRenderModel();
 
             bool Initialize(rhi::DeviceDep* p_device, res::ResourceHandle<ResMeshData> res_mesh, std::shared_ptr<gfx::MeshData> override_mesh_shape_data, const char* material_name);
 
@@ -57,6 +60,14 @@ namespace ngl
 
             void DrawShape(rhi::GraphicsCommandListDep* p_command_list, int shape_index);
 
+            // Bindlessマテリアルテーブル上のShapeのマテリアルスロット. Bindless無効時は BindlessMaterialTable::k_invalid_slot.
+            u32 GetBindlessMaterialSlot(int shape_index) const;
+
+            // テクスチャストリーミングへ描画に必要なMipを要求. GameThread.
+            void RequestTextureStreaming(const math::Mat34& transform) const;
+            // Bindlessマテリアルテーブルのテクスチャインデックスをテクスチャの現在のViewへ更新. ストリーミングによるViewの切り替えを反映する. RenderThread.
+            void UpdateBindlessMaterialTexture();
+
         public:
             int NumShape() const
             {
@@ -84,8 +95,24 @@ namespace ngl
 
             std::vector<MaterialPsoSet> shape_mtl_pso_set_      = {};
             std::vector<StandardRenderMaterial> material_array_ = {};
+            // material_array_ と対応するBindlessマテリアルテーブルのスロット.
+            std::vector<u32> bindless_material_slot_ = {};
 
         private:
+            // テクスチャストリーミングの必要Mip推定用のShape毎の情報. ローカル空間.
+            struct TextureStreamingShapeInfo
+            {
+                math::Vec3 bounding_center = math::Vec3::Zero();
+                float bounding_radius = 0.0f;
+                // UV空間の長さ/ローカル空間の長さ. 0の場合は推定不可として最詳細Mipを要求する.
+                float uv_per_unit = 0.0f;
+            };
+            void SetupTextureStreamingShapeInfo();
+
+            std::vector<TextureStreamingShapeInfo> streaming_shape_info_ = {};
+            // bindless_material_slot_ に設定済みのテクスチャインデックス.
+            std::vector<std::array<u32, EBindlessMaterialTexture::_MAX>> bindless_texture_index_ = {};
+
             res::ResourceHandle<ResMeshData> res_mesh_          = {};
             // マテリアルはResourceを使いつつShape0を上書きするShape().
             std::shared_ptr<gfx::MeshData> override_mesh_shape_data_ = {};
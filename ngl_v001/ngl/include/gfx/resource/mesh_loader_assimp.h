@@ -23,6 +23,7 @@ namespace assimp
 	//	out_material_tex_set : Material情報.
 	//	out_shape_material_index : out_meshの内部Shape毎のMaterialIndex (out_material_tex_setの要素に対応).
 	//	out_shape_layouts : メッシュの形状レイアウト情報.
-	bool LoadMeshData(gfx::MeshData& out_mesh, std::vector<MaterialTextureSet>& out_material_tex_set, std::vector<int>& out_shape_material_index, std::vector<gfx::MeshShapeLayout>& out_shape_layouts, rhi::DeviceDep* p_device, const char* filename);
+	//	enable_vertex_quantize : 量子化頂点ストリームを生成してラスタライズ用頂点入力とする.
+	bool LoadMeshData(gfx::MeshData& out_mesh, std::vector<MaterialTextureSet>& out_material_tex_set, std::vector<int>& out_shape_material_index, std::vector<gfx::MeshShapeLayout>& out_shape_layouts, rhi::DeviceDep* p_device, const char* filename, bool enable_vertex_quantize = false);
 }
 }
\ No newline at end of file
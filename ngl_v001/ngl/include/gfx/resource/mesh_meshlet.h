@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "math/math.h"
+#include "util/types.h"
+
+namespace ngl
+{
+namespace gfx
+{
+    // Meshlet (クラスタ) 分割.
+    //  Shapeを頂点数, 三角形数の上限を持つクラスタに分割し, クラスタ毎のバウンディングスフィアと法線コーンを計算する.
+    //  クラスタ内のインデックスはローカル頂点番号の8bitで格納する.
+    //  デバイス非依存.
+
+    // Mesh Shader の一般的な上限に合わせた既定値. 三角形数は 124*3=372 byte で 4byte アラインに収まる値.
+    constexpr u32 k_meshlet_max_vertex = 64;
+    constexpr u32 k_meshlet_max_triangle = 124;
+
+    struct Meshlet
+    {
+        u32 vertex_offset = 0;      // MeshletShapeData::vertex_index の開始位置.
+        u32 triangle_offset = 0;    // MeshletShapeData::triangle_index の開始位置 (byte).
+        u32 vertex_count = 0;
+        u32 triangle_count = 0;
+    };
+
+    struct MeshletBounds
+    {
+        // バウンディングスフィア.
+        math::Vec3 center = {};
+        float radius = 0.0f;
+
+        // 法線コーン. 視点から apex への方向と axis の内積が cone_cutoff 以上であれば全三角形が裏向き.
+        //  法線のばらつきが大きく有効なコーンが得られない場合は cone_cutoff に 1より大きい値が入る.
+        math::Vec3 cone_apex = {};
+        float cone_cutoff = 0.0f;
+        math::Vec3 cone_axis = {};
+        float pad = 0.0f;
+    };
+
+    // 1Shape分のMeshlet情報.
+    struct MeshletShapeData
+    {
+        std::vector<Meshlet>        meshlet;
+        std::vector<MeshletBounds>  bounds;
+        std::vector<u32>            vertex_index;   // Meshletローカル頂点 -> Shape頂点.
+        std::vector<u8>             triangle_index; // Meshletローカル頂点番号. 三角形毎に3要素.
+    };
+
+    struct MeshletBuildStatistics
+    {
+        u32 meshlet_count = 0;
+        u32 vertex_count = 0;       // 全Meshletの頂点数合計 (Meshlet間の重複を含む).
+        u32 triangle_count = 0;
+        float vertex_fill = 0.0f;   // 頂点数 / (Meshlet数 * 頂点上限).
+        float triangle_fill = 0.0f; // 三角形数 / (Meshlet数 * 三角形上限).
+    };
+
+    // インデックス列をMeshletに分割する. Meshletのバウンディング情報も計算する.
+    //  インデックス順の局所性を利用するため, 頂点キャッシュ最適化済みのインデックスを入力すると効率が良い.
+    bool BuildMeshlets(MeshletShapeData& out_data, const u32* index, u32 index_count, const math::Vec3* position, u32 vertex_count,
+        u32 max_vertex = k_meshlet_max_vertex, u32 max_triangle = k_meshlet_max_triangle);
+
+    // Meshlet1つ分のバウンディングスフィアと法線コーンを計算.
+    MeshletBounds CalcMeshletBounds(const MeshletShapeData& data, u32 meshlet_index, const math::Vec3* position);
+
+    // 法線コーンによる裏面判定. trueであればMeshletの全三角形が view_pos から裏向き.
+    bool IsMeshletBackfacing(const MeshletBounds& bounds, const math::Vec3& view_pos);
+
+    MeshletBuildStatistics CalcMeshletStatistics(const MeshletShapeData& data, u32 max_vertex = k_meshlet_max_vertex, u32 max_triangle = k_meshlet_max_triangle);
+
+    // 上限の遵守, 全三角形の被覆, バウンディングスフィアの包含, 法線コーンの保守性のテスト.
+    void TestMeshletBuild();
+}
+}
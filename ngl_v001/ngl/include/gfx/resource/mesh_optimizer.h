@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "math/math.h"
+#include "util/types.h"
+
+namespace ngl
+{
+namespace gfx
+{
+    // インポート時のメッシュ最適化.
+    //  Post-Transform頂点キャッシュ向けのインデックス並べ替え (Tipsify),
+    //  オーバードロー低減のためのクラスタ並べ替え,
+    //  頂点フェッチ局所性のための頂点並べ替え.
+    //  デバイス非依存.
+
+    // 最適化と統計計測で想定する頂点キャッシュサイズ (FIFO).
+    constexpr u32 k_mesh_optimize_vertex_cache_size = 16;
+
+    struct MeshOptimizeOption
+    {
+        bool enable_vertex_cache = true;
+        bool enable_overdraw = true;
+        bool enable_vertex_fetch = true;
+        u32 cache_size = k_mesh_optimize_vertex_cache_size;
+    };
+
+    // 頂点ストリーム. 頂点並べ替えを全属性に適用するために利用.
+    struct MeshOptimizeVertexStream
+    {
+        void* data = nullptr;
+        u32 stride = 0;
+    };
+
+    struct MeshOptimizeStatistics
+    {
+        float acmr_before = 0.0f;   // Average Cache Miss Ratio (transformed vertex / triangle).
+        float acmr_after = 0.0f;
+        float atvr_before = 0.0f;   // Average Transformed Vertex Ratio (transformed vertex / vertex).
+        float atvr_after = 0.0f;
+    };
+
+    // FIFOキャッシュシミュレーションによる変換頂点数.
+    u32 CalcTransformedVertexCount(const u32* index, u32 index_count, u32 vertex_count, u32 cache_size);
+
+    // Tipsify によるインデックス並べ替え.
+    //  out_cluster_start : 任意. キャッシュが途切れる位置(Dead-end)で区切ったクラスタの開始三角形インデックス.
+    void OptimizeVertexCache(u32* out_index, const u32* index, u32 index_count, u32 vertex_count, u32 cache_size, std::vector<u32>* out_cluster_start);
+
+    // クラスタ単位でオーバードロー低減のために並べ替える. 外側を向いたクラスタを先に描画する.
+    void OptimizeOverdraw(u32* inout_index, u32 index_count, const math::Vec3* position, u32 vertex_count, const std::vector<u32>& cluster_start);
+
+    // インデックスの参照順で頂点を並べ替えるリマップテーブルを生成. out_remap[old_vertex] = new_vertex.
+    //  未参照の頂点は末尾に配置する.
+    void BuildVertexFetchRemap(u32* out_remap, const u32* index, u32 index_count, u32 vertex_count);
+    // リマップテーブルを頂点ストリームとインデックスに適用.
+    void ApplyVertexRemap(const u32* remap, u32 vertex_count, MeshOptimizeVertexStream* stream_array, u32 stream_count, u32* inout_index, u32 index_count);
+
+    // 1Shapeに対して有効な最適化をすべて適用する.
+    void OptimizeMeshShape(u32* inout_index, u32 index_count, u32 vertex_count, const math::Vec3* position,
+        MeshOptimizeVertexStream* stream_array, u32 stream_count, const MeshOptimizeOption& option, MeshOptimizeStatistics* out_stat);
+}
+}
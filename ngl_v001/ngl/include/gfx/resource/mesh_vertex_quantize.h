@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "math/math.h"
+#include "util/types.h"
+
+namespace ngl
+{
+namespace gfx
+{
+    // 頂点属性の量子化.
+    //  POSITION : Shapeのバウンズで正規化した16bit UNORM x3. wにBitangentの符号(0 or 1)を格納.
+    //  NORMAL, TANGENT : Octahedron Encodingによる16bit UNORM x2. シェーダ側の OctEncode/OctDecode (math_util.hlsli) と同一のマッピング.
+    //  TEXCOORD : half float x2.
+    //  BINORMAL はストリームを持たず NORMAL, TANGENT と符号から復元する.
+    //  デバイス非依存.
+
+    // R16G16B16A16_UNORM.
+    struct MeshQuantizedPosition
+    {
+        u16 x = 0;
+        u16 y = 0;
+        u16 z = 0;
+        u16 w = 0;
+    };
+    // R16G16_UNORM.
+    struct MeshQuantizedOct
+    {
+        u16 x = 0;
+        u16 y = 0;
+    };
+    // R16G16_FLOAT.
+    struct MeshQuantizedTexcoord
+    {
+        u16 x = 0;
+        u16 y = 0;
+    };
+
+    // 量子化入力. 無効なストリームはnullptr.
+    struct MeshQuantizeSource
+    {
+        u32 num_vertex = 0;
+        const math::Vec3* position = nullptr;
+        const math::Vec3* normal = nullptr;
+        const math::Vec3* tangent = nullptr;
+        const math::Vec3* binormal = nullptr;
+        std::vector<const math::Vec2*> texcoord;
+    };
+    // 量子化出力. 入力の有効なストリームに対応する出力先を設定する.
+    struct MeshQuantizeDestination
+    {
+        MeshQuantizedPosition* position = nullptr;
+        MeshQuantizedOct* normal = nullptr;
+        MeshQuantizedOct* tangent = nullptr;
+        std::vector<MeshQuantizedTexcoord*> texcoord;
+
+        // 逆量子化パラメータ. position = unorm * position_dequant_scale + position_dequant_offset.
+        math::Vec3 position_dequant_scale = math::Vec3(1.0f);
+        math::Vec3 position_dequant_offset = math::Vec3(0.0f);
+    };
+
+    // 量子化の誤差計測.
+    struct MeshQuantizeErrorStatistics
+    {
+        float max_position_error = 0.0f;        // 絶対誤差.
+        float max_position_error_ratio = 0.0f;  // バウンズの最大辺長に対する比.
+        float max_normal_error_deg = 0.0f;
+        float max_tangent_error_deg = 0.0f;
+        float max_binormal_error_deg = 0.0f;    // 復元したBinormalと元のBinormalの角度誤差.
+        float max_texcoord_error = 0.0f;
+    };
+
+    u16 FloatToHalf(float v);
+    float HalfToFloat(u16 v);
+
+    // 単位ベクトルのOctahedron Encoding. 量子化誤差が最小となるように丸め方向を選択する.
+    MeshQuantizedOct EncodeOctahedronUnorm16(const math::Vec3& n);
+    math::Vec3 DecodeOctahedronUnorm16(const MeshQuantizedOct& v);
+
+    // Bitangent符号. NORMAL x TANGENT とBINORMALが同じ向きであれば1, 逆向きであれば-1.
+    float CalcBitangentSign(const math::Vec3& normal, const math::Vec3& tangent, const math::Vec3& binormal);
+    // 符号を使ってBinormalを復元.
+    math::Vec3 ReconstructBinormal(const math::Vec3& normal, const math::Vec3& tangent, float bitangent_sign);
+
+    // Shapeの頂点ストリームを量子化.
+    void QuantizeVertexStreams(MeshQuantizeDestination& out_dst, const MeshQuantizeSource& src);
+    // 元のストリームと量子化済みストリームの誤差を計測.
+    MeshQuantizeErrorStatistics CalcQuantizeError(const MeshQuantizeSource& src, const MeshQuantizeDestination& dst);
+
+    math::Vec3 DequantizePosition(const MeshQuantizedPosition& v, const math::Vec3& dequant_scale, const math::Vec3& dequant_offset);
+
+    // 16bit位置, Octahedron法線/接線とBitangent符号, half UVの誤差範囲のテスト.
+    void TestMeshVertexQuantize();
+}
+}
@@ -16,8 +16,12 @@
 
 #include "resource/resource.h"
 
+#include "gfx/resource/upload_manager.h"
+
 // Mesh用セマンティクスマッピング等.
 #include "gfx/common_struct.h"
+#include "gfx/resource/mesh_meshlet.h"
+#include "gfx/resource/mesh_vertex_quantize.h"
 
 namespace ngl
 {
@@ -139,6 +143,15 @@ namespace ngl
 			math::Vec3* binormal_ = {};
 			std::vector<VertexColor*>	color_{};
 			std::vector<math::Vec2*>	texcoord_{};
+
+			// 量子化頂点ストリーム. position_q_ が有効な場合はラスタライズ用の頂点バッファとして量子化ストリームを利用する.
+			//	float側のストリームはCPUアクセスやレイトレース用に保持される.
+			MeshQuantizedPosition* position_q_ = {};
+			MeshQuantizedOct* normal_q_ = {};
+			MeshQuantizedOct* tangent_q_ = {};
+			std::vector<MeshQuantizedTexcoord*>	texcoord_q_{};
+			math::Vec3 position_dequant_scale_ = math::Vec3(1.0f);
+			math::Vec3 position_dequant_offset_ = math::Vec3(0.0f);
 		};
 
 		struct MeshShapeLayout
@@ -158,6 +171,15 @@ namespace ngl
 			std::array<int32_t, k_mesh_vertex_semantic_texcoord_max_count> offset_uv = {};
 
 			int32_t offset_index = -1;
+
+			// 量子化頂点ストリーム. vertex_format が EMeshVertexFormat::QUANTIZED の場合に有効.
+			int32_t vertex_format = EMeshVertexFormat::FLOAT;
+			int32_t offset_position_q = -1;
+			int32_t offset_normal_q = -1;
+			int32_t offset_tangent_q = -1;
+			std::array<int32_t, k_mesh_vertex_semantic_texcoord_max_count> offset_uv_q = {};
+			math::Vec3 position_dequant_scale = math::Vec3(1.0f);
+			math::Vec3 position_dequant_offset = math::Vec3(0.0f);
 		};
 
 		// Mesh Shape Data.
@@ -173,6 +195,8 @@ namespace ngl
 			}
 
             void Initialize(rhi::DeviceDep* p_device, const MeshShapeInitializeSourceData& init_source_data);
+            // 頂点とインデックスのアップロードのコピーがGPU完了済みで描画に利用可能か. 予算超過で後続フレームへ持ち越される場合がある.
+            bool IsUploadComplete() const { return UploadManager::Instance().IsUploadComplete(upload_ticket_); }
 
 
 			int num_vertex_ = 0;
@@ -186,10 +210,25 @@ namespace ngl
 			std::vector<MeshShapeVertexData<VertexColor>>	color_;
 			std::vector<MeshShapeVertexData<math::Vec2>>	texcoord_;
 
+			// 量子化頂点ストリーム. vertex_format_ が EMeshVertexFormat::QUANTIZED の場合はこちらが頂点入力にマッピングされる.
+			EMeshVertexFormat::Type vertex_format_ = EMeshVertexFormat::FLOAT;
+			MeshShapeVertexData<MeshQuantizedPosition> position_q_ = {};
+			MeshShapeVertexData<MeshQuantizedOct> normal_q_ = {};
+			MeshShapeVertexData<MeshQuantizedOct> tangent_q_ = {};
+			std::vector<MeshShapeVertexData<MeshQuantizedTexcoord>>	texcoord_q_;
+			math::Vec3 position_dequant_scale_ = math::Vec3(1.0f);
+			math::Vec3 position_dequant_offset_ = math::Vec3(0.0f);
+
+			// 逆量子化パラメータ等のShape毎の定数バッファ (ShapeInfo). ロード時に生成して描画時は参照のみ.
+			rhi::RefBufferDep	shape_info_buffer_ = {};
+			rhi::RefCbvDep		shape_info_cbv_ = {};
+
 
 			// バインド時等に効率的に設定するためのポインタ配列.
 			std::array<MeshShapeVertexDataBase*, MeshVertexSemantic::SemanticSlotMaxCount()> p_vtx_attr_mapping_ = {};
 			MeshVertexSemanticSlotMask	vtx_attr_mask_ = {};
+
+			UploadTicket	upload_ticket_ = 0;
 		};
 
 
@@ -214,6 +253,9 @@ namespace ngl
 
             // 各Shape情報.
 			std::vector<MeshShapePart> shape_array_;
+
+			// 各ShapeのMeshlet情報. インポート時に構築されメッシュキャッシュにベイクされる. 未構築の場合は空.
+			std::vector<MeshletShapeData> shape_meshlet_array_;
 		};
 
         // MeshShapeInitializeSourceDataからMeshDataを生成する. 内部に必要なメモリを別途確保する.
@@ -244,7 +286,8 @@ namespace ngl
 		public:
 			struct LoadDesc
 			{
-				int dummy;
+				// 量子化頂点フォーマットを有効化. ラスタライズ用の頂点バッファを量子化ストリームで生成する.
+				bool enable_vertex_quantize = false;
 			};
 
 			ResMeshData()
@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "math/math.h"
@@ -14,6 +16,9 @@
 
 #include "resource/resource.h"
 
+#include "gfx/resource/texture_streaming.h"
+#include "gfx/resource/upload_manager.h"
+
 
 namespace ngl
 {
@@ -21,9 +26,41 @@ namespace ngl
 	{
 		class IResourceRenderUpdater;
 	}
+	namespace directxtex
+	{
+		// 定義は gfx/resource/texture_cooker_directxtex.h.
+		enum class ETextureCookUsage : u32;
+	}
 	
 	namespace gfx
 	{
+		// アップロード元のピクセルデータとコピー先Textureのレイアウト. 書き込みまで要求側で保持する.
+		struct TextureUploadSource
+		{
+			std::vector<u8>									pixel_memory = {};
+			std::vector<rhi::TextureUploadSubresourceInfo>	subresource_info_array = {};
+			std::vector<rhi::TextureSubresourceLayoutInfo>	dst_layout = {};
+			u64												dst_byte_size = 0;
+		};
+		// Mip [top_mip, end_mip) の全Array要素のSubresourceを UploadManager 経由でアップロードする. 任意スレッド.
+		UploadTicket EnqueueTextureUpload(const rhi::RefTextureDep& texture, const std::shared_ptr<const TextureUploadSource>& source, u32 top_mip, u32 end_mip);
+
+		// ストリーミングテクスチャのMipの読み込み元. ピクセルはCPUに保持せず, 必要なMipのみCook済みキャッシュ(DDS)から読み込む.
+		struct TextureStreamingSource
+		{
+			std::string										cache_file_path = {};
+			rhi::TextureDep::Desc							desc = {};						// 全Mipを持つ場合のdesc.
+			std::vector<rhi::TextureUploadSubresourceInfo>	subresource_info_array = {};	// 全MipのSubresource. pixelsは無効.
+			std::vector<u64>								file_offset_array = {};			// Subresource毎のキャッシュファイル上のオフセット.
+		};
+		// ストリーミングテクスチャは常駐Mipのみを持つTextureとして生成する. 全Mipのdescから top_mip 以降のMipを持つdescを返す.
+		rhi::TextureDep::Desc MakeStreamingTextureDesc(const rhi::TextureDep::Desc& desc, u32 top_mip);
+		// 常駐Mipの変更. 全Mip基準で先頭Mipが dst_top_mip の dst_texture へ,
+		//	Mip [dst_top_mip, copy_top_mip) はキャッシュファイルから読み込んでアップロードし, Mip [copy_top_mip, mip_count) は先頭Mipが src_top_mip の src_texture からGPU上でコピーする.
+		//	copy_top_mip == dst_top_mip の場合は解放のためのコピーのみとなる. 任意スレッド.
+		UploadTicket EnqueueStreamingTextureUpdate(const rhi::RefTextureDep& dst_texture, u32 dst_top_mip, const rhi::RefTextureDep& src_texture, u32 src_top_mip, u32 copy_top_mip,
+			const std::shared_ptr<const TextureStreamingSource>& source);
+
 		class ResTexture : public res::Resource
 		{
 			NGL_RES_MEMBER_DECLARE(ResTextureData)
@@ -50,6 +87,11 @@ namespace ngl
 			struct LoadDesc
 			{
 				ECreateMode		mode = ECreateMode::FROM_FILE;// default.
+				// for FROM_FILE. テクスチャ用途. 既定の0はNoneでCookしない. None以外はMip生成とブロック圧縮(Cook)を行い, 結果をキャッシュする.
+				directxtex::ETextureCookUsage	cook_usage = {};
+				// Copy Queueの予算を経由せず, 最初のRenderThread処理でGraphics CommandListから全Mipをアップロードする. ストリーミング対象外.
+				//	アップロード未完了時の代替となるデフォルトテクスチャや, ロード直後にGPU処理で参照するテクスチャ用.
+				bool			upload_immediate = false;
 
 				FromDescData	from_desc = {}; // for FROM_DESC.
 			};
@@ -57,18 +99,31 @@ namespace ngl
 			ResTexture()
 			{
 			}
-			~ResTexture()
-			{
-			}
+			~ResTexture();
 
 			bool IsNeedRenderThreadInitialize() const override { return true; }
 			void RenderThreadInitialize(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_commandlist) override;
+			// アップロードのコピーがGPU完了済みで描画に利用可能か. 予算超過で後続フレームへ持ち越される場合があり, 未完了の間はデフォルトテクスチャで代替すること.
+			//	ストリーミング対象はMip Tailのアップロード完了で判定する. RenderThread.
+			bool IsUploadComplete() const { return UploadManager::Instance().IsUploadComplete(upload_ticket_); }
 
 			// 読み込んだイメージから生成したTextureやそのView等.
 			rhi::RefTextureDep			ref_texture_ = {};
 			rhi::RefSrvDep				ref_view_ = {};
 
 			
+			// テクスチャストリーミング. 無効IDの場合はロード時に全Mipをアップロードする.
+			//	有効な場合は ref_texture_ は常駐Mipのみを持ち, 常駐Mipの変化に応じて再生成した ref_texture_ と ref_view_ にRenderThreadで切り替えられる.
+			//	ref_texture_ のdescは常駐Mip基準となるため, 全Mipのサイズは streaming_source_ のdescを参照すること.
+			StreamingTextureId			streaming_id_ = k_invalid_streaming_texture_id;
+			// ストリーミングで後からMipを読み込むためのキャッシュファイル情報. ロード以降不変.
+			std::shared_ptr<const TextureStreamingSource>	streaming_source_ = {};
+
+			// UploadManager経由のアップロード要求のチケット. 即時アップロードの場合は0.
+			UploadTicket				upload_ticket_ = 0;
+			bool						is_upload_immediate_ = false;
+
+			
 			// Upload data.
 			std::vector<u8> upload_pixel_memory_ = {};
 			std::vector<rhi::TextureUploadSubresourceInfo> upload_subresource_info_array;
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "util/types.h"
+
+#include "DirectXTex.h"
+
+namespace ngl
+{
+namespace directxtex
+{
+	// テクスチャの用途. Cook時のMip生成フィルタとブロック圧縮フォーマットの選択に利用する.
+	enum class ETextureCookUsage : u32
+	{
+		None,		// Cookしない. ソースをそのままロード.
+		Albedo,		// sRGB空間のカラー. ガンマを考慮したMip生成 + BC7.
+		Normal,		// 接空間法線. XYのみ保持するBC5 (Zはシェーダで復元).
+		Linear,		// ORM等のリニアデータ. BC7.
+		Hdr,		// HDR環境マップ等の浮動小数点データ. BC6H.
+	};
+
+	struct TextureCookDesc
+	{
+		ETextureCookUsage	usage = ETextureCookUsage::None;
+		bool				generate_mip = true;
+		bool				compress = true;
+	};
+
+	// Cook結果の統計.
+	struct TextureCookStatistics
+	{
+		std::atomic<u64>	cook_count = 0;			// 実際にCookしたテクスチャ数.
+		std::atomic<u64>	cache_hit_count = 0;	// キャッシュから読み込んだテクスチャ数.
+		std::atomic<u64>	src_byte_size = 0;		// ソース(非圧縮, Mip込み)換算のバイト数.
+		std::atomic<u64>	cooked_byte_size = 0;	// Cook後のバイト数.
+		std::atomic<u64>	encode_pixel_count = 0;	// 圧縮したピクセル数.
+		std::atomic<u64>	encode_micro_sec = 0;	// 圧縮に要した時間.
+	};
+
+	// ソースイメージからMipチェインを生成してブロック圧縮する. デバイス非依存.
+	bool CookImageData(DirectX::ScratchImage& out_image_data, const DirectX::ScratchImage& src_image_data, const TextureCookDesc& desc);
+
+	// Cook済みキャッシュ(DDS)ファイル上のピクセルの位置. ストリーミングでMipをファイルから再読み込みするために利用する.
+	//	ピクセルはDDSヘッダの後に ScratchImage と同じ Array要素, Mip の順で詰めて格納される.
+	struct TextureCookCacheFile
+	{
+		std::string	path = {};
+		u64			pixel_byte_offset = 0;	// 先頭Subresourceのファイル上のオフセット.
+
+		bool IsValid() const { return !path.empty(); }
+	};
+
+	// ソースファイルのコンテンツハッシュでキャッシュを検索し, ヒットすればキャッシュ(DDS)をロード.
+	// ミスした場合はソースをロードしてCookし, キャッシュへ保存する.
+	//	p_out_cache_file : 有効な場合はキャッシュファイルの情報を返す. キャッシュを保存できなかった場合は無効.
+	bool LoadImageData_Cooked(DirectX::ScratchImage& image_data, DirectX::TexMetadata& meta_data, const char* filename, const TextureCookDesc& desc, TextureCookCacheFile* p_out_cache_file = nullptr);
+
+	// ソースファイルをCPUでピクセルを参照するための R32G32B32A32_FLOAT 非圧縮イメージとしてロードする. デバイス非依存.
+	bool LoadImageData_Float4(DirectX::ScratchImage& image_data, const char* filename);
+
+	// プロセス全体のCook統計.
+	TextureCookStatistics& GetTextureCookStatistics();
+	// Cook統計のログ出力.
+	void PrintTextureCookStatistics();
+
+	// 用途毎のMip生成と圧縮フォーマット, Cook設定の変更によるキャッシュミスのテスト.
+	void TestTextureCook();
+}
+}
@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "util/types.h"
+
+namespace ngl
+{
+namespace gfx
+{
+    using StreamingTextureId = u32;
+    constexpr StreamingTextureId k_invalid_streaming_texture_id = ~0u;
+
+    // ストリーミング対象テクスチャの登録情報.
+    struct StreamingTextureDesc
+    {
+        u32 width = 1;
+        u32 height = 1;
+        // Mip毎のバイトサイズ (全Array要素分). 要素数がMip数.
+        std::vector<u64> mip_byte_size = {};
+    };
+
+    // 実際のアップロード/解放を担当するバックエンド.
+    //  GPU実装とテスト用のモック実装を差し替え可能にするためのインターフェイス.
+    class ITextureStreamingBackend
+    {
+    public:
+        virtual ~ITextureStreamingBackend() {}
+
+        // Mip [new_top_mip, current_top_mip) の非同期アップロード要求.
+        //  完了したら TextureStreamingManager::NotifyUploadComplete を呼び出すこと.
+        //  falseを返した場合は要求が受け付けられなかったものとして次フレーム以降に再試行する.
+        virtual bool RequestUpload(StreamingTextureId id, u32 new_top_mip, u32 current_top_mip) = 0;
+        // Mip [current_top_mip, new_top_mip) の解放要求. 即時に完了したものとして扱う.
+        virtual void RequestEvict(StreamingTextureId id, u32 new_top_mip, u32 current_top_mip) = 0;
+    };
+
+    struct TextureStreamingConfig
+    {
+        // ストリーミングテクスチャ全体のメモリ予算.
+        u64 memory_budget_byte = 256ull * 1024 * 1024;
+        // 1フレームで要求するアップロードの最大バイト数.
+        u64 max_upload_byte_per_frame = 16ull * 1024 * 1024;
+        // 常駐させる低解像度側のMip数 (Mip Tail). このMipより粗いものは登録時から常に常駐.
+        u32 mip_tail_count = 4;
+    };
+
+    struct TextureStreamingStatistics
+    {
+        u64 resident_byte = 0;          // 常駐済みバイト数.
+        u64 pending_byte = 0;           // アップロード中のバイト数.
+        u64 upload_byte_this_frame = 0; // 今フレームで要求したアップロードバイト数.
+        u32 upload_request_count = 0;   // 今フレームのアップロード要求数.
+        u32 evict_count = 0;            // 今フレームで解放したMip数.
+        u32 waiting_request_count = 0;  // 予算やフレーム上限で保留になった要求数.
+        bool is_over_budget = false;    // Mip Tailだけで予算を超過しているなど, 予算内に収められなかった.
+    };
+
+    // テクスチャストリーミングのレジデンシ管理.
+    //  CPU側で推定した必要Mipを元に, 予算内で低解像度Mipから順に高解像度Mipをストリーミングする.
+    //  予算が不足する場合は長期間要求されていないテクスチャ(LRU)の高解像度Mipから解放する.
+    //  デバイス非依存で, 実際のアップロードは ITextureStreamingBackend に委譲する.
+    class TextureStreamingManager
+    {
+    public:
+        TextureStreamingManager() = default;
+        ~TextureStreamingManager() = default;
+
+        void Initialize(const TextureStreamingConfig& config, ITextureStreamingBackend* p_backend);
+        void Finalize();
+
+        // 登録. Mip Tailは常駐済みとして扱う (ロード時に同期でアップロードされている前提).
+        StreamingTextureId Register(const StreamingTextureDesc& desc);
+        void Unregister(StreamingTextureId id);
+
+        // 今フレームの必要Mipを要求. 同一フレームで複数回要求された場合は最も詳細なMipを採用.
+        void RequestMip(StreamingTextureId id, float required_mip);
+
+        // フレーム毎の更新. 要求の優先度付けと予算内でのアップロード/解放を行う.
+        void Update();
+
+        // バックエンドからのアップロード完了通知.
+        void NotifyUploadComplete(StreamingTextureId id, u32 top_mip);
+
+        // 予算の変更. 次のUpdateで予算内に収まるように解放される.
+        void SetMemoryBudget(u64 memory_budget_byte);
+
+        // Mip数に対するMip Tailの先頭. 登録時から常駐するMip.
+        u32 CalcTailTopMip(u32 mip_count) const;
+        // 常駐済みの最詳細Mip.
+        u32 GetResidentTopMip(StreamingTextureId id) const;
+        // 今フレームの要求Mip.
+        u32 GetRequestedTopMip(StreamingTextureId id) const;
+        bool IsPending(StreamingTextureId id) const;
+
+        const TextureStreamingStatistics& GetStatistics() const { return stat_; }
+        u64 GetFrameIndex() const { return frame_index_; }
+
+    public:
+        // 距離とUV密度から必要Mipを推定する.
+        //  texture_size : テクスチャのMip0の長辺ピクセル数.
+        //  uv_per_world_unit : ワールド単位長あたりのUV変化量 (メッシュのUV密度).
+        //  distance : カメラからの距離.
+        //  screen_height : 画面の縦ピクセル数.
+        //  fov_y_radian : 縦画角.
+        static float CalcRequiredMip(float texture_size, float uv_per_world_unit, float distance, float screen_height, float fov_y_radian);
+
+    private:
+        struct Entry
+        {
+            bool is_valid = false;
+            std::vector<u64> mip_byte_size = {};
+            u32 tail_top_mip = 0;       // Mip Tailの先頭 (常駐が保証される最詳細Mip).
+            u32 resident_top_mip = 0;   // 常駐済みの最詳細Mip.
+            u32 pending_top_mip = 0;    // アップロード中の最詳細Mip. 非アップロード中はresident_top_mipと同じ.
+            u32 requested_top_mip = 0;  // 今フレームの要求.
+            u64 last_request_frame = 0;
+        };
+
+        bool IsValidId(StreamingTextureId id) const;
+        u64 CalcMipRangeByte(const Entry& e, u32 top_mip, u32 end_mip) const;
+        // 指定バイト数を確保できるまで解放. 解放できた場合はtrue.
+        bool EvictForBudget(u64 require_byte, StreamingTextureId exclude_id);
+        void EvictTopMip(StreamingTextureId id);
+
+    private:
+        TextureStreamingConfig config_ = {};
+        ITextureStreamingBackend* p_backend_ = nullptr;
+
+        std::vector<Entry> entry_array_ = {};
+        std::vector<StreamingTextureId> free_id_array_ = {};
+
+        u64 frame_index_ = 1;
+        TextureStreamingStatistics stat_ = {};
+
+        // Update内の作業用.
+        std::vector<StreamingTextureId> work_candidate_ = {};
+    };
+
+    // モックバックエンドによる低解像度Mipからの段階的ロード, 要求の優先度, 予算超過時の解放順のテスト.
+    void TestTextureStreaming();
+}
+}
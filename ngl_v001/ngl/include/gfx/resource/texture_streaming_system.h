@@ -0,0 +1,98 @@
+﻿#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "util/types.h"
+#include "util/singleton.h"
+#include "math/math.h"
+
+#include "rhi/d3d12/device.d3d12.h"
+
+#include "gfx/resource/texture_streaming.h"
+#include "gfx/resource/upload_manager.h"
+
+namespace ngl
+{
+namespace gfx
+{
+    class ResTexture;
+
+    // TextureStreamingManager をResTextureへ接続する.
+    //  Mip Tail以外のMipはロード時にアップロードせず, 描画側からの必要Mip要求に応じて UploadManager 経由でストリーミングする.
+    //  ResTextureのTextureは常駐Mipのみを持つように再生成し, 新規Mipはキャッシュファイルから, 常駐済みMipは旧TextureからCopy Queueでコピーする.
+    //  解放も小さいTextureへのコピーで行うため, 旧Textureの破棄によりGPUメモリが返却される. テクスチャ毎に処理中の再生成は1つまで.
+    //  予算はストリーミングしたピクセルデータの常駐量に対して適用する.
+    class TextureStreamingSystem : public Singleton<TextureStreamingSystem>, private ITextureStreamingBackend
+    {
+    public:
+        // 必要Mipの推定に利用するビュー情報.
+        struct ViewParam
+        {
+            math::Vec3 camera_pos = math::Vec3::Zero();
+            float fov_y_radian = 1.0f;
+            float screen_height = 1080.0f;
+        };
+
+        bool Initialize(rhi::DeviceDep* p_device, const TextureStreamingConfig& config = {});
+        void Finalize();
+        bool IsValid() const { return nullptr != p_device_; }
+
+        // Mip Tailの先頭. ストリーミング対象のテクスチャはこのMip以降のみロード時にアップロードする.
+        u32 CalcTailTopMip(u32 mip_count) const;
+
+        // ResTextureの登録. ロード時の任意スレッド. ResTextureは破棄時に Unregister すること.
+        StreamingTextureId Register(ResTexture* p_texture);
+        void Unregister(StreamingTextureId id);
+
+        // 今フレームの必要Mipを要求. GameThread.
+        void RequestMip(StreamingTextureId id, float required_mip);
+
+        // 今フレームのビュー情報. GameThread.
+        void SetViewParam(const ViewParam& param) { view_param_ = param; }
+        const ViewParam& GetViewParam() const { return view_param_; }
+
+        // フレーム毎の更新. 要求の解決とTextureの再生成, 切り替えを発行する. GameThreadで描画対象の要求後に呼び出す.
+        void Update();
+
+        TextureStreamingStatistics GetStatistics() const;
+
+    private:
+        bool RequestUpload(StreamingTextureId id, u32 new_top_mip, u32 current_top_mip) override;
+        void RequestEvict(StreamingTextureId id, u32 new_top_mip, u32 current_top_mip) override;
+
+    private:
+        // テクスチャ毎の状態.
+        struct Entry
+        {
+            ResTexture* p_texture = {};
+            rhi::RefTextureDep latest_texture = {};     // 最新のTexture. 次の再生成のコピー元.
+            u32 latest_top_mip = 0;                     // latest_texture の先頭Mip (全Mip基準).
+
+            // 処理中の再生成.
+            UploadTicket ticket = 0;
+            rhi::RefTextureDep op_texture = {};
+            u32 op_top_mip = 0;
+            bool op_is_upload = false;
+        };
+        struct ViewUpdate
+        {
+            StreamingTextureId id = k_invalid_streaming_texture_id;
+            const ResTexture* p_texture = {};   // 実行までに登録解除とID再利用があった場合の判定用.
+            rhi::RefTextureDep texture = {};
+        };
+
+        // latest_texture から常駐Mipが top_mip のTextureへの再生成を要求する. copy_top_mip 以降は旧Textureからコピーする.
+        bool RequestRebuild(StreamingTextureId id, u32 top_mip, u32 copy_top_mip, bool is_upload);
+
+        rhi::DeviceDep* p_device_ = {};
+
+        // manager_ と登録テクスチャの保護. TextureとSRVの切り替えはRenderThreadでこのロック下で行う.
+        mutable std::mutex mutex_ = {};
+        TextureStreamingManager manager_ = {};
+        std::vector<Entry> entry_array_ = {};   // StreamingTextureId でアクセス.
+
+        ViewParam view_param_ = {};
+    };
+}
+}
@@ -0,0 +1,134 @@
+﻿#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "util/types.h"
+#include "util/singleton.h"
+
+#include "rhi/d3d12/device.d3d12.h"
+#include "rhi/d3d12/resource.d3d12.h"
+#include "rhi/d3d12/command_list.d3d12.h"
+
+#include "gfx/resource/upload_scheduler.h"
+
+namespace ngl
+{
+namespace gfx
+{
+    // アップロード要求の完了判定用. 要求順の通し番号. 0は無効 (常に完了扱い).
+    using UploadTicket = u64;
+
+    // メッシュやテクスチャのアップロードを集約する.
+    //  永続Mapした1つのステージングバッファからリング確保し, フレーム毎の予算内の要求をまとめてCopy QueueへSubmitする.
+    //  リング領域はCopy QueueのFence完了で回収する. 要求はSubmitしたコピーのFence完了をCPUで確認した時点で完了とし,
+    //  Graphics Queueは完了した要求のリソースのみ参照することでCopy Queueを待機せずに済ませる.
+    //  コピー先は Common ステートのリソースとする. Copy Queueでの暗黙の昇格と実行後の減衰により Common に戻る.
+    class UploadManager : public Singleton<UploadManager>
+    {
+    public:
+        struct Desc
+        {
+            UploadScheduler::Desc scheduler_desc = {};
+        };
+
+        // ステージング上の書き込み先 p_dst へ要求バイト数分のデータを書き込む. RenderThread.
+        using WriteFunction = std::function<void(u8* p_dst)>;
+        // p_src の src_offset に書き込まれたデータをコピー先へコピーするコマンドを記録する. RenderThread.
+        using CopyFunction = std::function<void(rhi::CommandListBaseDep* p_command_list, rhi::BufferDep* p_src, u64 src_offset)>;
+
+        struct Statistics
+        {
+            UploadSchedulerStatistics scheduler = {};
+            u64 ring_byte_size = 0;
+        };
+
+    public:
+        bool Initialize(rhi::DeviceDep* p_device, const Desc& desc = {});
+        // 未処理の要求は破棄する.
+        void Finalize();
+        bool IsValid() const { return nullptr != p_device_; }
+
+        // アップロード要求. 任意スレッド.
+        //  byte_size : ステージング上に確保するサイズ. alignment : ステージング上のアライメント (テクスチャは D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT).
+        //  byte_size が0の場合はGPU上のリソース間コピーのみの要求とし, 書き込み関数は呼ばれない. コピー関数の p_src は無効.
+        //  書き込み関数とコピー関数は予算内で選択されたフレームのRenderThreadで呼ばれるため, 参照するデータはキャプチャで保持すること.
+        UploadTicket Enqueue(u64 byte_size, u64 alignment, const WriteFunction& write_func, const CopyFunction& copy_func);
+        // Buffer全体へのアップロード要求. p_data は呼び出し時にコピーされる. 任意スレッド.
+        UploadTicket EnqueueBuffer(const rhi::RefBufferDep& dst, const void* p_data, u64 byte_size);
+
+        // 要求のコピーがGPU完了済みで, Graphics Queueのコマンドから参照可能か. 完了はFlushFrameで更新される. 任意スレッド.
+        bool IsUploadComplete(UploadTicket ticket) const { return ticket <= completed_ticket_.load(); }
+        // 最後に受け付けた要求のチケット. これ以前の要求は全てこのチケット以前に完了するため, 複数要求の完了判定に利用できる.
+        UploadTicket GetLastTicket() const { return last_ticket_.load(); }
+
+        // Fence完了したコピーの要求を完了とし, フレームの予算内の要求をステージングへ書き込んでCopy QueueへSubmitする. RenderThread.
+        void FlushFrame();
+        // Copy Queueの全完了をCPU待機し, Submit済みの要求を完了とする. RenderThread.
+        void WaitIdle();
+
+        // フレーム毎のアップロードバイト数上限. 任意スレッド. 次のFlushFrameから反映.
+        void SetMaxUploadBytePerFrame(u64 byte_size);
+        Statistics GetStatistics() const;
+
+    private:
+        struct Payload
+        {
+            UploadTicket ticket = 0;
+            u64 byte_size = 0;
+            u64 alignment = 0;
+            WriteFunction write_func = {};
+            CopyFunction copy_func = {};
+        };
+        // Submit済みでFence完了待ちのコピー.
+        //  コピー先を参照するコピー関数と専用Bufferは, GraphicsのGabageCollectorがCopy Queueの完了を知らないため完了まで保持する.
+        struct SubmittedBatch
+        {
+            u64 fence_value = 0;
+            UploadTicket last_ticket = 0;
+            std::vector<Payload> payload_array = {};
+            std::vector<rhi::RefBufferDep> dedicated_buffer_array = {};
+        };
+        struct PooledCommandList
+        {
+            std::unique_ptr<rhi::CopyCommandListDep> command_list = {};
+            u64 fence_value = 0;    // 最後にSubmitしたFence値.
+        };
+
+        rhi::CopyCommandListDep* GetFreeCommandList(u64 completed_fence_value);
+        // completed_fence_value までに完了したバッチの要求を完了とする.
+        void RetireSubmittedBatch(u64 completed_fence_value);
+        // 今フレームで選択した要求のうち begin 以降をSubmitせずに保留の先頭へ戻し, 次フレームで再試行する.
+        void RequeueWorkPayload(size_t begin);
+
+    private:
+        rhi::DeviceDep* p_device_ = {};
+        rhi::CopyCommandQueueDep copy_queue_ = {};
+        rhi::FenceDep copy_fence_ = {};
+        rhi::WaitOnFenceSignalDep copy_wait_signal_ = {};
+        u64 copy_fence_value_ = 0;
+        std::deque<SubmittedBatch> submitted_batch_ = {};
+
+        rhi::RefBufferDep ring_buffer_ = {};
+        u8* p_ring_memory_ = {};
+
+        // Enqueue, スケジューラ, 統計の保護.
+        mutable std::mutex mutex_ = {};
+        UploadScheduler scheduler_ = {};
+        std::deque<Payload> pending_payload_ = {};  // スケジューラの保留要求と同じ順序.
+        std::atomic<UploadTicket> last_ticket_ = 0;
+        // コピーがGPU完了した最後の要求. FIFOでSubmitするためこれ以前の要求も全て完了済み.
+        std::atomic<UploadTicket> completed_ticket_ = 0;
+
+        std::vector<PooledCommandList> command_list_pool_ = {};
+        // FlushFrameの作業用.
+        std::vector<UploadItem> work_item_ = {};
+        std::vector<Payload> work_payload_ = {};
+        std::vector<UploadRequest> work_requeue_ = {};
+    };
+}
+}
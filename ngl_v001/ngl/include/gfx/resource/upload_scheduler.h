@@ -0,0 +1,133 @@
+﻿#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "util/types.h"
+
+namespace ngl
+{
+namespace gfx
+{
+    // 永続Mapされたステージングバッファ上のリングアロケータ.
+    //  確保した領域はCloseでFence値を紐づけたバッチにまとめ, そのFence値の完了後にReclaimで古い順に解放する.
+    //  末尾に収まらない確保は先頭へ折り返し, 末尾の余りは折り返したバッチの使用量として扱う.
+    //  デバイス非依存.
+    class UploadRingAllocator
+    {
+    public:
+        UploadRingAllocator() = default;
+        ~UploadRingAllocator() = default;
+
+        void Initialize(u64 capacity_byte);
+
+        // 確保. 空きが不足する場合はfalse. alignment は2の冪.
+        bool Allocate(u64 byte_size, u64 alignment, u64& out_offset);
+        // 前回のClose以降の確保を fence_value の完了で解放するバッチとして閉じる.
+        void Close(u64 fence_value);
+        // completed_fence_value までに完了したバッチの領域を解放する.
+        void Reclaim(u64 completed_fence_value);
+
+        u64 GetCapacity() const { return capacity_; }
+        // 未解放のバイト数. アライメントと折り返しの余りを含む.
+        u64 GetUsedByte() const { return used_; }
+        // 未解放のバッチ数. Close前の確保は含まない.
+        u32 NumBatch() const { return static_cast<u32>(batch_.size()); }
+
+    private:
+        struct Batch
+        {
+            u64 end_offset = 0;     // バッチ末尾. 解放後の先頭位置.
+            u64 byte_size = 0;      // バッチの使用量.
+            u64 fence_value = 0;
+        };
+
+        u64 capacity_ = 0;
+        u64 head_ = 0;          // 未解放の最古の確保の先頭.
+        u64 tail_ = 0;          // 次の確保位置.
+        u64 used_ = 0;
+        u64 open_byte_ = 0;     // Close前の確保の使用量.
+        std::deque<Batch> batch_ = {};
+    };
+
+
+    // アップロード要求.
+    struct UploadRequest
+    {
+        u32 id = 0;             // 要求元の識別子.
+        u64 byte_size = 0;      // 0はステージングを利用しないGPU上のコピーのみの要求.
+        u64 alignment = 16;
+    };
+
+    // 今フレームでアップロードする要求.
+    struct UploadItem
+    {
+        u32 id = 0;
+        u64 ring_offset = 0;                // ステージングリング上のオフセット.
+        bool use_dedicated_buffer = false;  // リングに収まらないため専用のUploadバッファを利用する.
+    };
+
+    struct UploadSchedulerStatistics
+    {
+        u64 upload_byte_this_frame = 0;
+        u32 upload_count_this_frame = 0;
+        u32 dedicated_count_this_frame = 0;
+        u64 pending_byte = 0;           // 予算超過やリングの空き待ちで保留中のバイト数.
+        u32 pending_count = 0;
+        u64 ring_used_byte = 0;
+        u64 total_upload_byte = 0;
+    };
+
+    // アップロードのスケジューラ.
+    //  要求をFIFOで保持し, フレーム毎の予算 (バイト数, 要求数) とステージングリングの空き内でアップロードする要求を選択する.
+    //  フレームの最初の要求は予算を超えていても選択し, 大きな要求が滞留しないようにする.
+    //  リング容量を超える要求は専用バッファを利用する.
+    //  デバイス非依存.
+    class UploadScheduler
+    {
+    public:
+        struct Desc
+        {
+            // ステージングリングのサイズ.
+            u64 ring_byte_size = 64ull * 1024 * 1024;
+            // フレーム毎のアップロードバイト数上限.
+            u64 max_upload_byte_per_frame = 32ull * 1024 * 1024;
+            // フレーム毎のアップロード要求数上限.
+            u32 max_upload_per_frame = 1024;
+        };
+
+        UploadScheduler() = default;
+        ~UploadScheduler() = default;
+
+        void Initialize(const Desc& desc);
+
+        void Enqueue(const UploadRequest& request);
+        // 今フレームで選択したがSubmitできなかった要求を, 選択順のまま保留の先頭へ戻して次フレーム以降に再試行する.
+        //  選択時に確保したリング領域はEndFrameのFence値の完了で回収される.
+        void Requeue(const std::vector<UploadRequest>& request_array);
+
+        // フレーム開始. completed_fence_value までに完了したリング領域を回収し, 今フレームでアップロードする要求を選択する.
+        void BeginFrame(u64 completed_fence_value, std::vector<UploadItem>& out_item);
+        // 今フレームで選択した要求のコピー完了をSignalするFence値. BeginFrameで選択した要求が無い場合も呼んでよい.
+        void EndFrame(u64 submit_fence_value);
+
+        // フレーム毎のアップロードバイト数上限の変更. 次のBeginFrameから反映.
+        void SetMaxUploadBytePerFrame(u64 byte_size) { desc_.max_upload_byte_per_frame = byte_size; }
+
+        u32 NumPending() const { return static_cast<u32>(pending_.size()); }
+        const UploadSchedulerStatistics& GetStatistics() const { return stat_; }
+        const UploadRingAllocator& GetRing() const { return ring_; }
+        const Desc& GetDesc() const { return desc_; }
+
+    private:
+        Desc desc_ = {};
+        UploadRingAllocator ring_ = {};
+        std::deque<UploadRequest> pending_ = {};
+        u64 pending_byte_ = 0;
+        UploadSchedulerStatistics stat_ = {};
+    };
+
+    // リングの折り返しとFenceによる回収, 予算による選択のテスト.
+    void TestUploadScheduler();
+}
+}
@@ -106,6 +106,8 @@
 
 #include <unordered_map>
 #include <mutex>
+#include <atomic>
+#include <type_traits>
 
 #include "rtg_common.h"
 
@@ -117,6 +119,10 @@
 #include "resource/resource_manager.h"
 
 #include "rtg_command_list_pool.h"
+#include "rtg_gpu_timestamp_dep.h"
+#include "rtg_compile_cache.h"
+#include "rtg_node_schedule.h"
+#include "rtg_resource_pool.h"
 
 #include "thread/job_thread.h"
 
@@ -145,6 +151,13 @@ namespace ngl
 			// Type AsyncCompute.
 			ETaskType TaskType() const final
 			{ return ETaskType::COMPUTE; }
+
+			// AsyncComputeキューへ配置可能か. ManagerでAsyncCompute配置を有効にした場合, falseのNodeはGraphicsキューで実行される.
+			bool IsAsyncComputeEligible() const { return is_async_compute_eligible_; }
+		protected:
+			void SetAsyncComputeEligible(bool is_eligible){ is_async_compute_eligible_ = is_eligible; }
+		private:
+			bool is_async_compute_eligible_ = false;
 		};
 
 		
@@ -178,6 +191,8 @@ namespace ngl
 			{
 				// Compile前のRecordフェーズでのみ許可.
 				assert(IsRecordable());
+				// Nodeシーケンスは直列に確定する. Setupジョブ実行中は不可.
+				assert(!is_setup_job_running_);
 				
 				auto new_node = new TTaskNode();
 				node_sequence_.push_back(new_node);
@@ -223,6 +238,16 @@ namespace ngl
 			// Handleのリソース定義情報を取得.
 			RtgResourceDesc2D GetResourceHandleDesc(RtgResourceHandle handle) const;
 
+		public:
+			// TaskNodeのSetup処理をジョブとして登録する. 実行は ExecuteTaskNodeSetupJob.
+			//	Nodeの生成(AppendTaskNode)は呼び出し側で直列に済ませておき, Nodeシーケンス上の順序はここでは変化しない.
+			//	setup_function 内の CreateResource, RecordResourceAccess, RegisterTaskNodeRenderFunction はNode毎のローカル記録に書き込まれ, ExecuteTaskNodeSetupJob の完了時にNodeシーケンス順でマージされる.
+			void AddTaskNodeSetupJob(const ITaskNode* node, const std::function<void(void)>& setup_function);
+			// 登録済みのSetupジョブを実行してマージする. JobSystemが指定された場合は並列実行する.
+			//	同時に実行するSetup間では互いの出力ハンドルを参照できないため, 前段Nodeのハンドルを入力とするSetupは前段の実行後に登録する.
+			//	未実行のジョブが残っている場合はCompileで直列実行される.
+			void ExecuteTaskNodeSetupJob(thread::JobSystem* p_job_system = nullptr);
+
 		public:
 			// Graph実行.
 			// Compile済みのGraphを実行しCommandListを構築する. JobSystemが指定された場合は利用して並列実行する.
@@ -232,6 +257,12 @@ namespace ngl
 				RtgSubmitCommandSet* out_command_set,
 				thread::JobSystem* p_job_system = nullptr
 				);
+			// Execute中のRender Lambdaから利用可能なJobSystem. Executeに指定されたもので, シングルスレッド実行時はnullptr.
+			//	Lambda内でCommandListを分割して並列記録する用途. WaitAllはExecute側の待機と干渉するため gfx::ParallelRecordChunk 経由で利用する.
+			thread::JobSystem* GetExecuteJobSystem() const
+			{
+				return execute_job_system_;
+			}
 
 			// RtgのExecute() で構築して生成したComandListのSequenceをGPUへSubmitするヘルパー関数.
 			static void SubmitCommand(
@@ -263,6 +294,7 @@ namespace ngl
 			int res_base_width_ = static_cast<int>( static_cast<float>(k_base_height) * 16.0f/9.0f);
 			
 			std::vector<ITaskNode*> node_sequence_{};// Graph構成ノードシーケンス. 生成順がGPU実行順で, AsyncComputeもFenceで同期をする以外は同様.
+			std::vector<ITaskNode*> culled_node_array_{};// Compileでカリングされてシーケンスから除外されたノード. 破棄のために保持.
 			std::unordered_map<const ITaskNode*, TaskNodeRenderFunctionType_Graphics> node_function_graphics_{};// Node毎のRender処理Lambda登録用(Graphics Queue).
 			std::unordered_map<const ITaskNode*, TaskNodeRenderFunctionType_Compute> node_function_compute_{};// Node毎のRender処理Lambda登録用(Compute Queue).
 
@@ -280,6 +312,29 @@ namespace ngl
 				AccessTypeValue				access{};// あるNodeから上記Handleがどのアクセスタイプで利用されたか.
 			};
 			std::unordered_map<const ITaskNode*, std::vector<NodeHandleUsageInfo>> node_handle_usage_list_{};// Node毎のResourceHandleアクセス情報をまとめるMap.
+
+			// Setupジョブ毎のローカル記録. 並列Setup中はBuilder本体の代わりにここへ書き込む.
+			struct NodeSetupRecord
+			{
+				const RenderTaskGraphBuilder*	p_builder = nullptr;
+				const ITaskNode*				node = nullptr;
+				std::function<void(void)>		setup_function{};
+
+				std::vector<std::pair<RtgResourceHandleKeyType, RtgResourceDesc2D>>	created_resource{};
+				std::vector<NodeHandleUsageInfo>	handle_usage{};
+				std::function<void(rtg::RenderTaskGraphBuilder& builder, TaskGraphicsCommandListAllocator command_list_allocator)>	render_function_graphics{};
+				std::function<void(rtg::RenderTaskGraphBuilder& builder, TaskComputeCommandListAllocator command_list_allocator)>	render_function_compute{};
+			};
+			std::vector<NodeSetupRecord>	setup_job_array_{};
+			bool							is_setup_job_running_ = false;
+			// Execute中のみ有効.
+			thread::JobSystem*				execute_job_system_ = {};
+			// 実行中のSetupジョブの記録. ジョブを実行するスレッド毎.
+			static thread_local NodeSetupRecord*	s_current_setup_record_;
+			// 現在のスレッドで実行中のこのBuilderのSetupジョブの記録. Setupジョブ外ではnullptr.
+			NodeSetupRecord* GetCurrentSetupRecord() const;
+			// NodeのHandleアクセスをBuilder本体へ登録する.
+			void RegisterNodeHandleUsage(const ITaskNode& node, const RtgResourceHandle res_handle, const AccessTypeValue AccessType);
 			// ------------------------------------------------------------------------------------------------------------------------------------------------------
 			// Importリソース用のmap.
 			std::vector<ExternalResourceInfo>					imported_resource_ = {};
@@ -298,12 +353,7 @@ namespace ngl
 			// Compileで構築される情報.
 			struct CompiledBuilder
 			{
-				struct NodeDependency
-				{
-					int from = -1;
-					int to = -1;
-					int fence_id = -1;// Wait側に格納されるFence. Signal側はtoの指すIndexが持つこのIDを利用する.
-				};
+				using NodeDependency = RtgNodeDependency;
 
 				// Compileで構築される情報.
 				// Handleに割り当てられたリソースのPool上のIndex.
@@ -345,6 +395,8 @@ namespace ngl
 					rhi::EResourceState curr_ = {};
 				};
 			
+				// Sequence上のNode毎の実行Queue. ComputeのNodeもGraphicsに配置される場合がある.
+				std::vector<ETaskType>								node_queue_ = {};
 				// Queue違いのNode間のfence依存関係.
 				std::vector<NodeDependency>							node_dependency_fence_ = {};
 				// HandleからリニアインデックスへのMap.
@@ -363,6 +415,19 @@ namespace ngl
 			// グラフからリソース割当と状態遷移を確定.
 			// 現状はRenderThreadでCompileしてそのままRenderThreadで実行するというスタイルとする.
 			bool Compile(class RenderTaskGraphManager& manager);
+
+			// 出力に到達しないNodeをシーケンスから除外し, 残ったNodeの実行Queueを決定する.
+			void ScheduleNode();
+			// Compileキャッシュ用の正規化Graphを構築.
+			void BuildCanonicalGraph(RtgCanonicalGraph& out_graph) const;
+			// キャッシュされたスケジュールが現在のリソースプールと伝搬リソースの状態に適用可能か.
+			bool IsApplicableCompiledSchedule(const RtgCanonicalGraph& graph, const RtgCompiledSchedule& schedule) const;
+			// キャッシュされたスケジュールでCompile結果を構築する. ハンドルと外部リソース, 伝搬リソースの再バインドのみ.
+			void ApplyCompiledSchedule(const RtgCanonicalGraph& graph, const RtgCompiledSchedule& schedule);
+			// スケジュールのステート遷移をNode毎のHandle状態とリソースのキャッシュステートへ反映.
+			void ApplyResourceStateSchedule(const RtgCanonicalGraph& graph, const std::vector<RtgResourceStateSchedule>& resource_state, const std::vector<RtgAccessState>& access_state);
+			// 次フレームへ伝搬するハンドルの割当リソースをManagerに登録.
+			void PropagateCompiledResourceToNextFrame();
 			
 			// Sequence上でのノードの位置を返す.
 			int GetNodeSequencePosition(const ITaskNode* p_node) const;
@@ -396,13 +461,59 @@ namespace ngl
 			bool Init(rhi::DeviceDep* p_device, int job_thread_count = 8);
 
 			//	フレーム開始通知. Game-Render同期中に呼び出す.
-			//		内部リソースプールの中で一定フレームアクセスされていないものを破棄するなどの処理.
+			//		内部リソースプールの中で一定フレームアクセスされていないものや予算超過分を破棄するなどの処理.
 			void BeginFrame();
 
 			// builderをCompileしてリソース割当を確定する.
 			//	Compileしたbuilderは必ずExecuteする必要がある.
 			//	また, 複数のbuilderをCompileした場合はCompileした順序でExecuteが必要(確定したリソースの状態遷移コマンド実行を正しい順序で実行するために).
 			bool Compile(RenderTaskGraphBuilder& builder);
+
+			// TaskNode毎のGPUタイムスタンプ計測の初期化. Queueを利用するためInitとは別.
+			//	初期化後はExecuteでNode毎にタイムスタンプを記録し, 数フレーム後にGetGpuTimestampResultで結果を取得できる.
+			bool InitGpuTimestamp(rhi::GraphicsCommandQueueDep* p_graphics_queue, rhi::ComputeCommandQueueDep* p_compute_queue);
+			void SetGpuTimestampEnable(bool enable) { gpu_timestamp_tracker_.SetEnable(enable); }
+			bool IsGpuTimestampEnable() const { return gpu_timestamp_tracker_.IsValid() && gpu_timestamp_tracker_.IsEnable(); }
+			// 解決済みの最新フレームの結果.
+			const RtgGpuTimestampFrameResult& GetGpuTimestampResult() const { return gpu_timestamp_tracker_.GetLatestResult(); }
+
+			// Compile結果のキャッシュ. 同一構造のGraphはCompile済みのスケジュールを再利用する.
+			void SetCompileCacheEnable(bool enable) { compile_cache_.SetEnable(enable); }
+			bool IsCompileCacheEnable() const { return compile_cache_.IsEnable(); }
+			// ヒット時にも通常のCompileを実行してキャッシュとの一致を検証する. 結果は通常のCompileを採用する.
+			void SetCompileCacheVerifyEnable(bool enable) { compile_cache_.SetVerifyEnable(enable); }
+			bool IsCompileCacheVerifyEnable() const { return compile_cache_.IsVerifyEnable(); }
+			RtgCompileCache::Statistics GetCompileCacheStatistics() const { return compile_cache_.GetStatistics(); }
+
+			// 出力(外部リソース, 次フレームへの伝搬, 副作用指定のNode)に到達しないNodeをCompileで除外する.
+			void SetNodeCullingEnable(bool enable) { is_node_culling_enable_ = enable; }
+			bool IsNodeCullingEnable() const { return is_node_culling_enable_; }
+			// IComputeTaskNodeの自動Queue配置. 無効時は全てAsyncCompute, 有効時はAsyncCompute可能且つ負荷の見積りで有利なNodeのみAsyncCompute.
+			void SetAsyncComputePlacementEnable(bool enable) { is_async_compute_placement_enable_ = enable; }
+			bool IsAsyncComputePlacementEnable() const { return is_async_compute_placement_enable_; }
+			void SetAsyncComputePlacementDesc(const RtgQueuePlacementDesc& desc) { queue_placement_desc_ = desc; }
+			const RtgQueuePlacementDesc& GetAsyncComputePlacementDesc() const { return queue_placement_desc_; }
+			// Nodeスケジュールの前回フレームの統計.
+			struct NodeScheduleStatistics
+			{
+				u32 num_node = 0;
+				u32 num_culled = 0;
+				u32 num_compute = 0;
+				u32 num_async_compute = 0;
+			};
+			NodeScheduleStatistics GetNodeScheduleStatistics() const
+			{
+				std::scoped_lock lock(node_schedule_stat_mutex_);
+				return node_schedule_stat_prev_;
+			}
+
+			// 内部リソースプールのVRAM予算と未使用リソースの破棄設定.
+			void SetResourcePoolDesc(const RtgResourcePoolDesc& desc);
+			const RtgResourcePoolDesc& GetResourcePoolDesc() const { return resource_pool_.GetDesc(); }
+			// このフレームで未使用の内部リソースを target_bytes 以下になるまで破棄する. 解像度変更時等.
+			//	Compileと同じスレッドから呼び出す.
+			void TrimResourcePool(u64 target_bytes = 0);
+			RtgResourcePool::Statistics GetResourcePoolStatistics() const { return resource_pool_.GetStatistics(); }
 			
 		public:
 			// Builderが利用するCommandListをPoolから取得(Graphics).
@@ -415,6 +526,11 @@ namespace ngl
 			{
 				commandlist_pool_.GetFrameCommandList(out_ref);
 			}
+			// Builderが利用するCommandListをPoolから取得(Graphics Queueへ配置されたCompute).
+			void GetNewFrameCommandList(rhi::DirectComputeCommandListDep*& out_ref)
+			{
+				commandlist_pool_.GetFrameCommandList(out_ref);
+			}
 
 		public:
 			rhi::DeviceDep* GetDevice()
@@ -436,6 +552,8 @@ namespace ngl
 			void SetInternalResourceLastAccess(int resource_id, TaskStage last_access_stage);
 			// 割り当て済みリソース番号から内部リソースポインタ取得.
 			InternalResourceInstanceInfo* GetInternalResourcePtr(int resource_id);
+			// 内部リソースの実体を生成. resource_pool_ から呼ばれる.
+			bool CreateInternalResource(int resource_id, const RtgPoolResourceKey& key, u64& out_bytes);
 
 			// BuilderからハンドルとリソースIDを紐づけて次のフレームへ伝搬する.
 			void PropagateResourceToNextFrame(RtgResourceHandle handle, int resource_id);
@@ -448,8 +566,22 @@ namespace ngl
 			// 同一Manager下のBuilderのCompileは排他処理.
 			std::mutex	compile_mutex_ = {};
 			
-			// Compileで割り当てられるリソースのPool.
+			// Compileで割り当てられるリソースのPool. 要素の生成と破棄は resource_pool_ が管理し, インデックスはそのスロット番号.
 			std::vector<InternalResourceInstanceInfo> internal_resource_pool_ = {};
+			RtgResourcePool resource_pool_ = {};
+			// Poolリソースの生成毎のシリアル.
+			u64 internal_resource_serial_counter_ = 0;
+
+			// Compile結果のキャッシュ. compile_mutex_ 下で利用.
+			RtgCompileCache compile_cache_ = {};
+
+			// Nodeのカリングとキュー配置.
+			bool is_node_culling_enable_ = true;
+			bool is_async_compute_placement_enable_ = false;
+			RtgQueuePlacementDesc queue_placement_desc_ = {};
+			mutable std::mutex node_schedule_stat_mutex_ = {};
+			NodeScheduleStatistics node_schedule_stat_ = {};
+			NodeScheduleStatistics node_schedule_stat_prev_ = {};
 			
 			// 次のフレームへ伝搬するハンドルとリソースIDのMap.
 			std::unordered_map<RtgResourceHandleKeyType, int> propagate_next_handle_[2] = {};
@@ -458,14 +590,19 @@ namespace ngl
 			std::unordered_map<RtgResourceHandleKeyType, int> propagate_next_handle_temporal_ = {};
 			
 			pool::CommandListPool commandlist_pool_ = {};
+
+			// GPUタイムスタンプ. Trackerが参照するためバックエンドを先に宣言.
+			RtgGpuTimestampBackendDep	gpu_timestamp_backend_ = {};
+			RtgGpuTimestampTracker		gpu_timestamp_tracker_ = {};
 		private:
 			// JobSystem. 専用に内部で持っているが要検討.
 			thread::JobSystem	job_system_;
 		private:
 			// ユニークなハンドルIDを取得.
 			//	TODO. 64bit.
+			// 並列Setupから呼ばれるためスレッドセーフ.
 			static uint32_t GetNewHandleId();
-			static uint32_t	s_res_handle_id_counter_;// リソースハンドルユニークID. 生成のたびに加算しユニーク識別.
+			static std::atomic<uint32_t>	s_res_handle_id_counter_;// リソースハンドルユニークID. 生成のたびに加算しユニーク識別.
 		};
 		
 		// ------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -473,8 +610,8 @@ namespace ngl
 
 		// ------------------------------------------------------------------------------------------------------------------------------------------------------
 		template<typename COMMAND_LIST_TYPE>
-		TaskCommandListAllocator<COMMAND_LIST_TYPE>::TaskCommandListAllocator(std::vector<rhi::CommandListBaseDep*>* task_command_list_buffer, int user_command_list_offset, RenderTaskGraphManager* manager)
-			: command_list_array_(task_command_list_buffer), user_command_list_array_offset_(user_command_list_offset), manager_(manager)
+		TaskCommandListAllocator<COMMAND_LIST_TYPE>::TaskCommandListAllocator(std::vector<rhi::CommandListBaseDep*>* task_command_list_buffer, int user_command_list_offset, RenderTaskGraphManager* manager, bool use_graphics_queue)
+			: command_list_array_(task_command_list_buffer), user_command_list_array_offset_(user_command_list_offset), manager_(manager), use_graphics_queue_(use_graphics_queue)
 		{
 			assert(task_command_list_buffer && manager && "初期化引数エラー");
 		}
@@ -502,7 +639,24 @@ namespace ngl
 			{
 				// 指定の追加コマンドリストが未確保であればここで確保.
 				COMMAND_LIST_TYPE* new_command_list{};
-				manager_->GetNewFrameCommandList(new_command_list);
+				if constexpr (std::is_same_v<COMMAND_LIST_TYPE, rhi::ComputeCommandListDep>)
+				{
+					if(use_graphics_queue_)
+					{
+						// Graphics Queueへ配置されたComputeTaskはDirectタイプで確保.
+						rhi::DirectComputeCommandListDep* new_direct_command_list{};
+						manager_->GetNewFrameCommandList(new_direct_command_list);
+						new_command_list = new_direct_command_list;
+					}
+					else
+					{
+						manager_->GetNewFrameCommandList(new_command_list);
+					}
+				}
+				else
+				{
+					manager_->GetNewFrameCommandList(new_command_list);
+				}
 				// 自動的にBeginする.
 				new_command_list->Begin();
 				// 登録.
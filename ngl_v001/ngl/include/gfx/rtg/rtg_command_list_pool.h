@@ -24,6 +24,7 @@ namespace ngl::rtg
     {
         using GraphicsCommandListType = rhi::GraphicsCommandListDep;
         using ComputeCommandListType = rhi::ComputeCommandListDep;
+        using DirectComputeCommandListType = rhi::DirectComputeCommandListDep;
         
         template<typename T>
         struct CommandListTypeTraits;
@@ -62,6 +63,23 @@ namespace ngl::rtg
                 return true;
             }
         };
+        // Graphics Queue用のCompute.
+        template<> struct CommandListTypeTraits<DirectComputeCommandListType>
+        {
+            static constexpr int TypeIndex = 2; // Graphics Queue用ComputeのIndex定義.
+            
+            static bool Create(rhi::DeviceDep* p_device, rhi::RhiRef<DirectComputeCommandListType>& out_ref)
+            {
+                out_ref.Reset(new DirectComputeCommandListType());
+                if (!out_ref->Initialize(p_device))
+                {
+                    std::cout << "[ERROR] Direct Compute CommandList Initialize" << std::endl;
+                    assert(false);
+                    return false;
+                }
+                return true;
+            }
+        };
 
         template<typename T>
         struct PooledCommandListElem
@@ -70,13 +88,16 @@ namespace ngl::rtg
             
             rhi::RhiRef<T>  ref_commandlist  = {};      // rhi::RhiRef<CommandListType>.
 
-            // Poolから貸出可能になるまでのフレーム数. 0>=x で貸出可能.
+            // 貸出中か. 貸し出したフレームのGPU処理が完了するまで貸出中とする.
             //  tuple要素イテレートで処理するためにconstで変更可能とするmutable.
-            mutable  int    reusable_frame_count = 0;
+            mutable  bool   is_lent = false;
+            // 貸し出したフレームのインデックス.
+            u64             lent_frame_index = 0;
         };
 
         // CommandListPoolの管理.
-        //  Graphics, Compute等のタイプ別に内部にPoolしたCommandListを貸し出す, フレームカウントで再利用管理する.
+        //  Graphics, Compute等のタイプ別に内部にPoolしたCommandListを貸し出す, 貸し出したフレームのGPU処理の完了で再利用管理する.
+        //  Frames In Flight の数によらず, GPU実行中のフレームのCommandList (CommandAllocator) はResetしない.
         class CommandListPool
         {
         public:
@@ -93,9 +114,10 @@ namespace ngl::rtg
         private:
             using GraphicsCommandListPoolBuffer = std::vector<PooledCommandListElem<GraphicsCommandListType>>;
             using ComputeCommandListPoolBuffer = std::vector<PooledCommandListElem<ComputeCommandListType>>;
+            using DirectComputeCommandListPoolBuffer = std::vector<PooledCommandListElem<DirectComputeCommandListType>>;
 
             // Tupleでタイプ毎のBufferまとめて管理.
-            std::tuple<GraphicsCommandListPoolBuffer, ComputeCommandListPoolBuffer> typed_pool_list_;
+            std::tuple<GraphicsCommandListPoolBuffer, ComputeCommandListPoolBuffer, DirectComputeCommandListPoolBuffer> typed_pool_list_;
 
         private:
             rhi::DeviceDep* p_device_ = {};
@@ -114,15 +136,18 @@ namespace ngl::rtg
         {
             assert(p_device_);
 
+            // GPUが処理を完了したフレーム.
+            const u64 completed_frame_index = p_device_->GetCompletedFrameIndex();
+
             // TYpe別CommandListPoolの各要素を更新するLambda.
-            auto iterate_pool_elem = [](auto& typed_pool)
+            auto iterate_pool_elem = [completed_frame_index](auto& typed_pool)
             {
                 for(size_t i = 0; i < typed_pool.size(); ++i)
                 {
-                    // 再利用可能カウンタ更新.
-                    if(0 < typed_pool[i].reusable_frame_count)
+                    // 貸し出したフレームのGPU処理が完了していれば再利用可能.
+                    if(typed_pool[i].is_lent && typed_pool[i].lent_frame_index <= completed_frame_index)
                     {
-                        --typed_pool[i].reusable_frame_count;
+                        typed_pool[i].is_lent = false;
                     }
                 }
             };
@@ -150,7 +175,7 @@ namespace ngl::rtg
                 auto it_find = std::find_if(target_pool.begin(), target_pool.end(),
                     [](auto& e)
                     {
-                        return 0 >= e.reusable_frame_count;
+                        return !e.is_lent;
                     }
                 );
                 if(target_pool.end() != it_find)
@@ -177,8 +202,9 @@ namespace ngl::rtg
             }
             assert(lent_index < target_pool.size());
 
-            // BeginFrameでカウントダウンされて0で再利用可能. Render0->GPU1->Render2 で2F想定.
-            target_pool[lent_index].reusable_frame_count = 2;
+            // 今回フレームのGPU処理完了後のBeginFrameで再利用可能になる.
+            target_pool[lent_index].is_lent = true;
+            target_pool[lent_index].lent_frame_index = p_device_->GetDeviceFrameIndex();
             // 返却.
             ref_out = target_pool[lent_index].ref_commandlist.Get();
             
@@ -184,9 +184,18 @@ namespace ngl::rtg
 		virtual ETaskType TaskType() const = 0;
 	public:
 		const RtgNameType& GetDebugNodeName() const { return debug_node_name_; }
+		// 出力の利用に関係なく実行が必要なNodeか. falseの場合は書き込みが出力に到達しなければCompileでカリングされる.
+		bool IsSideEffect() const { return is_side_effect_; }
+		// GPU負荷の目安(相対値). AsyncComputeの配置判断に利用する.
+		float GetGpuCostHint() const { return gpu_cost_hint_; }
 	protected:
 		void SetDebugNodeName(const char* name){ debug_node_name_ = name; }
+		// RTG管理外のリソースへ書き込む等, RTGで記録していない副作用があるNodeは設定すること.
+		void SetSideEffect(bool is_side_effect){ is_side_effect_ = is_side_effect; }
+		void SetGpuCostHint(float cost_hint){ gpu_cost_hint_ = cost_hint; }
 		RtgNameType debug_node_name_{};
+		bool		is_side_effect_ = false;
+		float		gpu_cost_hint_ = 1.0f;
 	};
 
 
@@ -251,8 +260,8 @@ namespace ngl::rtg
 	// 内部リソースプール用.
 	struct InternalResourceInstanceInfo
 	{
-		// 未使用フレームカウンタ. 一定フレーム未使用だった内部リソースはPoolからの破棄をする.
-		int			unused_frame_counter_ = 0;
+		// 生成毎のシリアル. 同じPoolスロットに再生成されたリソースを区別する.
+		u64			serial_ = 0;
 		
 		TaskStage last_access_stage_ = {};// Compile中のシーケンス上でのこのリソースへ最後にアクセスしたタスクの情報. Compile完了後にリセットされる.
 			
@@ -331,13 +340,15 @@ namespace ngl::rtg
 		int NumAllocatedCommandList() const;
 		
 	public:
-		TaskCommandListAllocator(std::vector<rhi::CommandListBaseDep*>* task_command_list_buffer, int user_command_list_offset, RenderTaskGraphManager* manager);
+		// use_graphics_queue : Graphics Queueへ配置されたComputeTask用. Compute CommandListをDirectタイプで確保する.
+		TaskCommandListAllocator(std::vector<rhi::CommandListBaseDep*>* task_command_list_buffer, int user_command_list_offset, RenderTaskGraphManager* manager, bool use_graphics_queue = false);
 	private:
 		//	Task単位で確保するCommandListの登録先vector. 初期化時に自動解決ステート遷移コマンドを積み込んだCommandlistが一つ登録済みになる.
 		std::vector<rhi::CommandListBaseDep*>* command_list_array_{};
 		int user_command_list_array_offset_ = 0;
 		// 追加CommandList確保用にマネージャ参照.
 		RenderTaskGraphManager* manager_{};
+		bool use_graphics_queue_ = false;
 	};
 	using TaskGraphicsCommandListAllocator = TaskCommandListAllocator<rhi::GraphicsCommandListDep>;
 	using TaskComputeCommandListAllocator = TaskCommandListAllocator<rhi::ComputeCommandListDep>;
@@ -0,0 +1,201 @@
+﻿#pragma once
+
+//  rtg_compile_cache.h
+//  RenderTaskGraphのCompile結果キャッシュ.
+//  Graphをハンドル値に依存しない正規化表現 (RtgCanonicalGraph) に変換し, 同一構造のGraphではCompile済みのスケジュールを再利用する.
+//  Fence依存関係とリソースステート遷移の決定もここで行い, Compileとテストで共通に利用する.
+//  デバイス非依存. リソースの割当と適用可否の判定は RenderTaskGraphBuilder 側.
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "rhi/rhi.h"
+#include "util/types.h"
+
+namespace ngl::rtg
+{
+    // Queue違いのNode間のfence依存関係.
+    struct RtgNodeDependency
+    {
+        int from = -1;
+        int to = -1;
+        int fence_id = -1;// Wait側に格納されるFence. Signal側はtoの指すIndexが持つこのIDを利用する.
+
+        bool operator==(const RtgNodeDependency& v) const { return from == v.from && to == v.to && fence_id == v.fence_id; }
+    };
+
+    // ハンドルに割り当てられたリソース. 内部リソースプール又は外部リソースリストへの参照.
+    struct RtgResourceAssign
+    {
+        int     resource_id = -1;
+        bool    is_external = false;
+
+        bool IsValid() const { return 0 <= resource_id; }
+        u64 Key() const { return (static_cast<u64>(is_external) << 32) | static_cast<u32>(resource_id); }
+    };
+
+    // Nodeのアクセス時点でのリソースステート遷移.
+    struct RtgAccessState
+    {
+        rhi::EResourceState prev = {};
+        rhi::EResourceState curr = {};
+        bool                is_valid = false;// 割当が無効なハンドルへのアクセスは遷移無し.
+
+        bool operator==(const RtgAccessState& v) const { return is_valid == v.is_valid && (!is_valid || (prev == v.prev && curr == v.curr)); }
+    };
+    // Graph上の有効リソース毎のステート.
+    struct RtgResourceStateSchedule
+    {
+        RtgResourceAssign   resource = {};
+        u64                 resource_serial = 0;// 内部リソースの生成毎のシリアル. キャッシュ再利用時の同一性判定用.
+        rhi::EResourceState begin_state = {};
+        rhi::EResourceState end_state = {};
+    };
+
+    // Compileで確定するスケジュール. ハンドル, アクセスは RtgCanonicalGraph の線形インデックス順.
+    struct RtgCompiledSchedule
+    {
+        std::vector<RtgNodeDependency>          node_dependency = {};
+        std::vector<RtgResourceAssign>          handle_assign = {};
+        std::vector<RtgResourceStateSchedule>   resource_state = {};// ハンドル順での初出順.
+        std::vector<RtgAccessState>             access_state = {};
+    };
+    // 2つのスケジュールが同じFenceとステート遷移を発行するか. 内部リソースはIDではなくハンドル間の共有関係で比較する.
+    bool RtgIsEquivalentSchedule(const RtgCompiledSchedule& a, const RtgCompiledSchedule& b);
+
+
+    // ハンドル値に依存しないGraph表現.
+    //  ハンドルはNodeSequence上の初出順の線形インデックスに置き換えられ, 毎フレーム新規発行されるハンドルでも同じ構造なら同じシグネチャになる.
+    class RtgCanonicalGraph
+    {
+    public:
+        struct Access
+        {
+            int                 handle_index = -1;
+            int                 access_type = 0;
+            bool                is_write = false;
+            rhi::EResourceState state = {};// このアクセスで要求するステート.
+        };
+
+        void Reset();
+
+        // Nodeを末尾に追加.
+        int AddNode(bool is_compute);
+        // 末尾のNodeのアクセスを追加. 戻り値はハンドルの線形インデックス.
+        int AddAccess(u64 handle, int access_type, bool is_write, rhi::EResourceState state);
+        // 構造以外でCompile結果に影響する値 (リソース定義や外部リソースのステート等) をシグネチャに追加.
+        void AddSignature(u64 value);
+        // シグネチャのハッシュを確定する.
+        void Finalize();
+
+        int NumNode() const { return static_cast<int>(node_is_compute_.size()); }
+        int NumHandle() const { return static_cast<int>(handle_array_.size()); }
+        int NumAccess() const { return static_cast<int>(access_array_.size()); }
+
+        bool IsComputeNode(int node_index) const { return node_is_compute_[node_index]; }
+        // Nodeのアクセス範囲 [begin, end).
+        int GetNodeAccessBegin(int node_index) const { return node_access_offset_[node_index]; }
+        int GetNodeAccessEnd(int node_index) const { return (node_index + 1 < NumNode()) ? node_access_offset_[node_index + 1] : NumAccess(); }
+        const Access& GetAccess(int access_index) const { return access_array_[access_index]; }
+
+        u64 GetHandle(int handle_index) const { return handle_array_[handle_index]; }
+        const std::vector<u64>& GetHandleArray() const { return handle_array_; }
+        const std::unordered_map<u64, int>& GetHandleIndexMap() const { return handle_2_index_; }
+
+        u64 GetHash() const { return hash_; }
+        const std::vector<u64>& GetSignature() const { return signature_; }
+
+    private:
+        std::vector<u8>                 node_is_compute_ = {};
+        std::vector<int>                node_access_offset_ = {};
+        std::vector<Access>             access_array_ = {};
+        std::vector<u64>                handle_array_ = {};
+        std::unordered_map<u64, int>    handle_2_index_ = {};
+        std::vector<u64>                user_signature_ = {};
+
+        std::vector<u64>                signature_ = {};
+        u64                             hash_ = 0;
+    };
+
+    // Graphics-Compute間のFence依存関係を決定する.
+    void RtgScheduleNodeDependency(const RtgCanonicalGraph& graph, std::vector<RtgNodeDependency>& out_dependency);
+    // リソース割当済みのハンドルからステート遷移を決定する.
+    //  get_begin_state : 有効リソースのGraph開始時点のステート.
+    //  1つのNodeは同一リソースに対して最初のアクセスでのみ遷移する.
+    void RtgScheduleResourceState(const RtgCanonicalGraph& graph, const std::vector<RtgResourceAssign>& handle_assign,
+        const std::function<rhi::EResourceState(const RtgResourceAssign&)>& get_begin_state,
+        std::vector<RtgResourceStateSchedule>& out_resource_state, std::vector<RtgAccessState>& out_access_state);
+
+
+    // Compile済みスケジュールのキャッシュ.
+    //  シグネチャが一致したエントリを適用可否の判定付きで検索する. 同一シグネチャでもリソース割当の異なる複数エントリを保持できる(ヒストリバッファのフリップ等).
+    //  排他は利用側 (RenderTaskGraphManagerのCompile排他) の責任. 統計の取得のみ別スレッドから可能.
+    class RtgCompileCache
+    {
+    public:
+        struct Statistics
+        {
+            u64     num_compile = 0;
+            u64     num_hit = 0;
+            u64     num_miss = 0;
+            u64     num_reject = 0;         // シグネチャは一致したが現在のリソース状態に適用できなかった数.
+            u64     num_evict = 0;
+            u64     num_verify = 0;
+            u64     num_verify_mismatch = 0;
+            u32     num_entry = 0;
+
+            double  hit_time_ms = 0.0;      // ヒット時のCompile時間合計.
+            double  miss_time_ms = 0.0;     // ミス時のCompile時間合計.
+            double  saved_time_ms = 0.0;    // ヒットによって削減した時間の推定合計. ミス時の平均Compile時間との差.
+
+            double HitRate() const { return (0 < num_compile) ? static_cast<double>(num_hit) / static_cast<double>(num_compile) : 0.0; }
+        };
+
+        RtgCompileCache() = default;
+        ~RtgCompileCache() = default;
+
+        void SetEnable(bool enable) { is_enable_ = enable; }
+        bool IsEnable() const { return is_enable_; }
+        // ヒット時にも通常のCompileを実行してキャッシュと比較する検証モード.
+        void SetVerifyEnable(bool enable) { is_verify_enable_ = enable; }
+        bool IsVerifyEnable() const { return is_verify_enable_; }
+        void SetCapacity(u32 capacity);
+
+        // is_applicable で現在のリソース状態に適用可能と判定されたエントリを返す. 無ければnullptr.
+        //  戻り値は次の Store / Clear まで有効.
+        const RtgCompiledSchedule* Find(const RtgCanonicalGraph& graph, const std::function<bool(const RtgCompiledSchedule&)>& is_applicable);
+        // 登録. 同一シグネチャ且つ同一リソース割当のエントリは置き換え, 容量を超える場合は最も古く使われたエントリを破棄する.
+        void Store(const RtgCanonicalGraph& graph, const RtgCompiledSchedule& schedule);
+        void Clear();
+
+        // Compile1回分の結果を統計に記録.
+        void ReportCompile(bool is_hit, double elapsed_ms);
+        void ReportVerify(bool is_equivalent);
+
+        Statistics GetStatistics() const;
+
+    private:
+        struct Entry
+        {
+            u64                 hash = 0;
+            std::vector<u64>    signature = {};
+            RtgCompiledSchedule schedule = {};
+            u64                 last_use_tick = 0;
+        };
+
+        bool                is_enable_ = true;
+        bool                is_verify_enable_ = false;
+        u32                 capacity_ = 32;
+
+        std::vector<Entry>  entry_array_ = {};
+        u64                 tick_ = 0;
+
+        mutable std::mutex  stat_mutex_ = {};
+        Statistics          stat_ = {};
+    };
+
+    // 正規化, 依存関係とステート遷移の決定, キャッシュの再利用と適用可否, 等価判定のテスト.
+    void TestRtgCompileCache();
+}
@@ -0,0 +1,149 @@
+﻿#pragma once
+
+//  rtg_gpu_timestamp.h
+//  RenderTaskGraphのTaskNode毎のGPUタイムスタンプ計測.
+//  クエリ番号の割り当てと結果の集計を担当し, クエリの実体とリードバックはバックエンドに委譲する.
+//  デバイス非依存. D3D12実装は rtg_gpu_timestamp_dep.h.
+
+#include <mutex>
+#include <vector>
+
+#include "text/hash_text.h"
+#include "util/types.h"
+
+namespace ngl::rtg
+{
+    // タイムスタンプを記録するQueue.
+    enum class ERtgGpuTimestampQueue : int
+    {
+        Graphics = 0,
+        Compute,
+
+        _Max
+    };
+    static constexpr int k_rtg_gpu_timestamp_queue_count = static_cast<int>(ERtgGpuTimestampQueue::_Max);
+    // 割り当て無しのクエリ番号.
+    static constexpr u32 k_rtg_gpu_timestamp_invalid_query = ~0u;
+
+    // GPUタイムスタンプとCPU時刻の対応. Queue毎に周波数と基準が異なるため共通の時間軸に揃えるために利用する.
+    struct RtgGpuClockCalibration
+    {
+        u64 gpu_timestamp = 0;
+        u64 gpu_frequency = 0;      // [tick/sec].
+        u64 cpu_timestamp_ns = 0;   // gpu_timestamp と同時刻のCPU時刻[ns].
+    };
+
+    // クエリの実体とリードバックのバックエンド.
+    //  クエリはフレームスロット毎, Queue毎に NumQueryPerSlot() 個の番号を持つ.
+    class IRtgGpuTimestampBackend
+    {
+    public:
+        virtual ~IRtgGpuTimestampBackend() {}
+
+        // リードバックリングのフレームスロット数.
+        virtual u32 NumFrameSlot() const = 0;
+        // フレームスロット, Queue毎のクエリ数.
+        virtual u32 NumQueryPerSlot() const = 0;
+
+        // フレームスロットを新しいフレームの記録用にする.
+        virtual void ResetFrameSlot(u32 frame_slot) = 0;
+        // フレームスロットに記録したクエリの解決がGPU上で完了しているか.
+        virtual bool IsFrameSlotResolved(u32 frame_slot) = 0;
+        // 解決済みのタイムスタンプを読み出す.
+        virtual bool ReadTimestamp(u32 frame_slot, ERtgGpuTimestampQueue queue, u32 query_begin, u32 query_count, u64* out_timestamp) = 0;
+        virtual bool GetClockCalibration(ERtgGpuTimestampQueue queue, RtgGpuClockCalibration& out_calibration) = 0;
+    };
+
+    // TaskNode毎の計測結果. 時刻はフレームの最初のタイムスタンプ基準[ms].
+    struct RtgGpuTimestampNodeResult
+    {
+        text::HashText<64>      name = {};
+        ERtgGpuTimestampQueue   queue = ERtgGpuTimestampQueue::Graphics;
+        double                  begin_ms = 0.0;
+        double                  end_ms = 0.0;
+        double                  duration_ms = 0.0;
+    };
+    // フレームの計測結果.
+    struct RtgGpuTimestampFrameResult
+    {
+        bool    is_valid = false;
+        u64     frame_serial = 0;
+        std::vector<RtgGpuTimestampNodeResult> node_array = {};
+
+        // 最初のNodeの開始から最後のNodeの終了まで.
+        double  frame_span_ms = 0.0;
+        // Queue毎にいずれかのNodeを処理していた時間.
+        double  queue_busy_ms[k_rtg_gpu_timestamp_queue_count] = {};
+        // GraphicsとComputeが同時にNodeを処理していた時間.
+        double  queue_overlap_ms = 0.0;
+        // クエリ不足で計測できなかったNode数.
+        u32     num_dropped_node = 0;
+    };
+
+    // TaskNode毎のGPUタイムスタンプ管理.
+    //  BeginFrameで解決済みのフレームスロットを回収して結果を更新し, 次のフレームスロットを記録用にする.
+    //  結果はバックエンドのフレームスロット数分遅れて得られる.
+    class RtgGpuTimestampTracker
+    {
+    public:
+        RtgGpuTimestampTracker() = default;
+        ~RtgGpuTimestampTracker() = default;
+
+        // バックエンドはTrackerより長く保持すること.
+        void Initialize(IRtgGpuTimestampBackend* p_backend);
+        void Finalize();
+        bool IsValid() const { return nullptr != p_backend_; }
+
+        void SetEnable(bool enable) { is_enable_ = enable; }
+        bool IsEnable() const { return is_enable_; }
+
+        // フレーム開始. Game-Render同期中に呼び出す.
+        void BeginFrame();
+
+        // Nodeの開始と終了のクエリを割り当てる. 戻り値は開始クエリ番号で, 終了は+1.
+        //  無効時やクエリ不足の場合は k_rtg_gpu_timestamp_invalid_query.
+        u32 AllocateNodeQuery(ERtgGpuTimestampQueue queue, const char* node_name);
+        // 記録中のフレームスロット.
+        u32 GetCurrentFrameSlot() const { return current_slot_; }
+        // 記録中のフレームスロットで割り当て済みのクエリ数.
+        u32 NumAllocatedQuery(ERtgGpuTimestampQueue queue) const;
+
+        // 最新の計測結果.
+        const RtgGpuTimestampFrameResult& GetLatestResult() const { return latest_result_; }
+        // 解決が間に合わずに破棄したフレーム数.
+        u64 NumDroppedFrame() const { return num_dropped_frame_; }
+
+    private:
+        void CollectFrameSlot(u32 frame_slot);
+
+        struct NodeRecord
+        {
+            text::HashText<64>      name = {};
+            ERtgGpuTimestampQueue   queue = ERtgGpuTimestampQueue::Graphics;
+            u32                     query_index = 0;
+        };
+        struct FrameSlot
+        {
+            u64     frame_serial = 0;
+            bool    is_pending = false;     // 記録済みで未回収.
+            std::vector<NodeRecord> node_array = {};
+            u32     num_query[k_rtg_gpu_timestamp_queue_count] = {};
+            u32     num_dropped_node = 0;
+        };
+
+        IRtgGpuTimestampBackend*    p_backend_ = nullptr;
+        bool                        is_enable_ = true;
+
+        std::mutex                  mutex_ = {};
+        std::vector<FrameSlot>      slot_array_ = {};
+        u32                         current_slot_ = 0;
+        u64                         frame_serial_ = 0;
+        u64                         num_dropped_frame_ = 0;
+
+        RtgGpuTimestampFrameResult  latest_result_ = {};
+        std::vector<u64>            work_timestamp_[k_rtg_gpu_timestamp_queue_count] = {};
+    };
+
+    // 偽のバックエンドによるクエリ割り当て, リードバックリングの遅延, Node毎の時間とQueueの重なりのテスト.
+    void TestRtgGpuTimestamp();
+}
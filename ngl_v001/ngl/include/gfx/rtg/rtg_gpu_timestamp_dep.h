@@ -0,0 +1,65 @@
+﻿#pragma once
+
+//  rtg_gpu_timestamp_dep.h
+//  RtgGpuTimestampTrackerのD3D12バックエンド.
+//  Queue毎のTimestampQueryHeapとリードバックバッファのリングを持ち, 解決完了はQueue毎のFenceで判定する.
+
+#include <array>
+
+#include "gfx/rtg/rtg_gpu_timestamp.h"
+
+#include "rhi/d3d12/device.d3d12.h"
+#include "rhi/d3d12/command_list.d3d12.h"
+#include "rhi/d3d12/resource.d3d12.h"
+
+namespace ngl::rtg
+{
+    class RtgGpuTimestampBackendDep : public IRtgGpuTimestampBackend
+    {
+    public:
+        struct Desc
+        {
+            // リードバックリングのサイズ. GPUの遅延フレーム数より大きくする.
+            u32     num_frame_slot = 4;
+            // フレームスロット, Queue毎のクエリ数. Node毎に2つ使用する.
+            u32     num_query_per_slot = 512;
+        };
+
+        RtgGpuTimestampBackendDep() = default;
+        ~RtgGpuTimestampBackendDep();
+
+        bool Initialize(rhi::DeviceDep* p_device, rhi::GraphicsCommandQueueDep* p_graphics_queue, rhi::ComputeCommandQueueDep* p_compute_queue, const Desc& desc);
+        void Finalize();
+
+    public:
+        // IRtgGpuTimestampBackend.
+        u32 NumFrameSlot() const override { return desc_.num_frame_slot; }
+        u32 NumQueryPerSlot() const override { return desc_.num_query_per_slot; }
+        void ResetFrameSlot(u32 frame_slot) override;
+        bool IsFrameSlotResolved(u32 frame_slot) override;
+        bool ReadTimestamp(u32 frame_slot, ERtgGpuTimestampQueue queue, u32 query_begin, u32 query_count, u64* out_timestamp) override;
+        bool GetClockCalibration(ERtgGpuTimestampQueue queue, RtgGpuClockCalibration& out_calibration) override;
+
+    public:
+        // CommandListにタイムスタンプ書き込みを積む.
+        void WriteTimestamp(rhi::CommandListBaseDep* p_command_list, ERtgGpuTimestampQueue queue, u32 frame_slot, u32 query_index);
+        // CommandListにクエリのリードバックバッファへの解決を積む.
+        //  戻り値はこのCommandListの後にQueueでSignalするFence値. GetResolveFence() のFenceに対して発行する.
+        u64 ResolveTimestamp(rhi::CommandListBaseDep* p_command_list, ERtgGpuTimestampQueue queue, u32 frame_slot, u32 query_begin, u32 query_count);
+        rhi::RhiRef<rhi::FenceDep> GetResolveFence(ERtgGpuTimestampQueue queue) const { return resolve_fence_[static_cast<int>(queue)]; }
+
+    private:
+        struct QueueResource
+        {
+            Microsoft::WRL::ComPtr<ID3D12QueryHeap> query_heap = {};
+            rhi::RhiRef<rhi::BufferDep>             readback_buffer = {};
+            ID3D12CommandQueue*                     p_command_queue = nullptr;
+        };
+
+        Desc    desc_ = {};
+        std::array<QueueResource, k_rtg_gpu_timestamp_queue_count>              queue_resource_ = {};
+        std::array<rhi::RhiRef<rhi::FenceDep>, k_rtg_gpu_timestamp_queue_count> resolve_fence_ = {};
+        // フレームスロット, Queue毎の解決完了を示すFence値. 0は解決無し.
+        std::vector<std::array<u64, k_rtg_gpu_timestamp_queue_count>>          slot_resolve_fence_value_ = {};
+    };
+}
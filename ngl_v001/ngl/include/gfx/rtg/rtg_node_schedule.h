@@ -0,0 +1,49 @@
+﻿#pragma once
+
+//  rtg_node_schedule.h
+//  RenderTaskGraphのNodeカリングとキュー配置.
+//  RtgCanonicalGraph 上で決定する. デバイス非依存. Nodeの除外と配置の適用は RenderTaskGraphBuilder 側.
+
+#include <vector>
+
+#include "rtg_compile_cache.h"
+
+namespace ngl::rtg
+{
+    // Node毎のスケジュール用情報.
+    struct RtgNodeScheduleInfo
+    {
+        bool    is_compute = false;         // IComputeTaskNode派生.
+        bool    is_async_eligible = false;  // AsyncComputeキューへ配置可能.
+        bool    is_side_effect = false;     // 出力の利用に関係なく実行が必要.
+        float   cost_hint = 1.0f;           // GPU負荷の目安. 単位は任意の相対値.
+    };
+
+    // ハンドルのカリング上の扱い.
+    enum class ERtgHandleCullType : u8
+    {
+        Transient,  // Graph内で完結する. 後続の生存Nodeが参照しなければ書き込みは不要.
+        Output,     // 外部リソース. 書き込むNodeは生存.
+        Persistent, // 次フレームへ伝搬する. アクセスするNodeは生存.
+    };
+
+    // 出力に到達しないNodeを除外する. out_node_alive はNode毎の生存フラグ. 戻り値は生存Node数.
+    //  RTGで書き込みを記録していないNodeはRTG外のリソースへの副作用があり得るため生存とする.
+    //  生存Nodeがアクセスするハンドルは読み書きに関わらず前段の書き込みが必要とする(書き込みアクセスでも既存内容をロードし得るため).
+    int RtgCullNode(const RtgCanonicalGraph& graph, const std::vector<RtgNodeScheduleInfo>& node_info,
+        const std::vector<ERtgHandleCullType>& handle_cull_type, std::vector<u8>& out_node_alive);
+
+
+    struct RtgQueuePlacementDesc
+    {
+        float   fence_cost = 0.25f;// Queue間のFence1つ当たりのコスト. cost_hint と同じ単位.
+    };
+    // IComputeTaskNode のキュー配置を決定する. out_node_async はAsyncComputeキューへ配置するNode. 戻り値はその数.
+    //  依存関係で連結したAsyncCompute可能Nodeをまとめて配置することでQueue間Fenceを減らし,
+    //  Graphics側で並行実行できる負荷の見積りがFenceのコストを上回る場合のみAsyncComputeキューへ配置する. それ以外はGraphicsキュー.
+    int RtgAssignNodeQueue(const RtgCanonicalGraph& graph, const std::vector<RtgNodeScheduleInfo>& node_info,
+        const RtgQueuePlacementDesc& desc, std::vector<u8>& out_node_async);
+
+    // 合成GraphでのカリングとAsyncCompute配置のテスト.
+    void TestRtgNodeSchedule();
+}
@@ -0,0 +1,119 @@
+﻿#pragma once
+
+//  rtg_resource_pool.h
+//  RenderTaskGraphの内部リソースプールの管理方針.
+//  リソース定義のハッシュでバケットを引いて検索し, VRAM予算を超えた分は最後に利用されたフレームが古い順に破棄する.
+//  デバイス非依存. スロット番号のみを管理し, 実リソースの生成と破棄は利用側 (RenderTaskGraphManager) のコールバックで行う.
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "rhi/rhi.h"
+#include "util/types.h"
+
+namespace ngl::rtg
+{
+    // プールの検索キー. ResourceSearchKey のデバイス非依存表現.
+    struct RtgPoolResourceKey
+    {
+        rhi::EResourceFormat    format = {};
+        int                     width = 0;
+        int                     height = 0;
+        int                     usage = 0;// AccessTypeMask の組み合わせ.
+
+        bool operator==(const RtgPoolResourceKey& v) const { return format == v.format && width == v.width && height == v.height && usage == v.usage; }
+    };
+
+    struct RtgResourcePoolDesc
+    {
+        u64     budget_bytes = 512ull * 1024 * 1024;// プールのVRAM予算. 0は無制限.
+        int     max_unused_frame = 60;// この未使用フレーム数を超えたリソースは予算内でも破棄する.
+    };
+
+    // 内部リソースプール.
+    //  バケットは 形式とサイズ で分け, バケット内では用途が一致するもの, 次に用途を包含するものを優先して再利用する.
+    //  サイズの異なるリソースは再利用しない. 解像度変更後に旧サイズのリソースが使われ続けて残ることを防ぐ.
+    //  排他は利用側 (RenderTaskGraphManagerのCompile排他) の責任. 統計の取得のみ別スレッドから可能.
+    class RtgResourcePool
+    {
+    public:
+        struct Statistics
+        {
+            u64     pool_bytes = 0;
+            u64     peak_bytes = 0;
+            u64     budget_bytes = 0;
+            u32     num_resource = 0;
+
+            u64     num_hit = 0;
+            u64     num_miss = 0;
+            u64     num_evict = 0;          // 破棄の合計.
+            u64     num_evict_budget = 0;   // 予算超過による破棄.
+            u64     evict_bytes = 0;
+
+            double HitRate() const { return (0 < num_hit + num_miss) ? static_cast<double>(num_hit) / static_cast<double>(num_hit + num_miss) : 0.0; }
+        };
+
+        // 実リソースの生成. スロット番号に生成して確保サイズを返す. 失敗時はfalse.
+        using CreateFunction = std::function<bool(int slot, const RtgPoolResourceKey& key, u64& out_bytes)>;
+        // 実リソースの破棄.
+        using ReleaseFunction = std::function<void(int slot)>;
+        // 既存リソースの再利用可否. Compile中のアクセス期間の判定等.
+        using ReusableFunction = std::function<bool(int slot)>;
+
+        RtgResourcePool() = default;
+        ~RtgResourcePool() = default;
+
+        void SetFunction(const CreateFunction& create_function, const ReleaseFunction& release_function);
+        void SetDesc(const RtgResourcePoolDesc& desc);
+        const RtgResourcePoolDesc& GetDesc() const { return desc_; }
+
+        // keyを格納できる再利用可能なリソースを検索し, 無ければ生成する. 戻り値はスロット番号, 失敗時は-1.
+        //  生成で予算を超える場合はこのフレームで未使用のリソースを破棄する.
+        int Acquire(const RtgPoolResourceKey& key, const ReusableFunction& is_reusable);
+        // このフレームでの利用を記録する. このフレームで利用されたリソースは破棄されない.
+        void Touch(int slot);
+
+        // フレーム開始. keep_slot は前回フレームからの伝搬等でこのフレームでも利用するリソース.
+        //  長期未使用のリソースと予算超過分を破棄する.
+        void BeginFrame(const std::vector<int>& keep_slot);
+        // このフレームで未使用のリソースを target_bytes 以下になるまで古い順に破棄する. 解像度変更時等.
+        void Trim(u64 target_bytes);
+
+        bool IsValid(int slot) const { return 0 <= slot && slot < NumSlot() && slot_array_[slot].is_valid; }
+        int NumSlot() const { return static_cast<int>(slot_array_.size()); }
+
+        Statistics GetStatistics() const;
+
+    private:
+        struct Slot
+        {
+            RtgPoolResourceKey  key = {};
+            u64                 bytes = 0;
+            u64                 last_use_frame = 0;
+            bool                is_valid = false;
+        };
+        static u64 CalcBucketHash(const RtgPoolResourceKey& key);
+        void Evict(int slot, bool is_budget);
+        // このフレームで未使用のリソースを古い順に target_bytes 以下まで破棄.
+        void EvictLeastRecentlyUsed(u64 target_bytes, bool is_budget);
+        void UpdateStatistics();
+
+        RtgResourcePoolDesc     desc_ = {};
+        CreateFunction          create_function_ = {};
+        ReleaseFunction         release_function_ = {};
+
+        std::vector<Slot>                           slot_array_ = {};
+        std::vector<int>                            free_slot_ = {};
+        std::unordered_map<u64, std::vector<int>>   bucket_ = {};// 形式とサイズのハッシュからスロット.
+        u64                                         pool_bytes_ = 0;
+        u64                                         frame_ = 1;
+
+        mutable std::mutex  stat_mutex_ = {};
+        Statistics          stat_ = {};
+    };
+
+    // 偽のテクスチャ生成による検索, 予算とLRU破棄, 統計のテスト.
+    void TestRtgResourcePool();
+}
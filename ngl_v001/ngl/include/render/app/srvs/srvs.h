@@ -516,6 +516,8 @@ namespace ngl::render::app
                 return;
 
 			desc_ = desc;
+            // RTG管理外のVoxelバッファを更新するため, 出力の利用に関係なく実行する.
+            SetSideEffect(true);
 			
 			// Rtgリソースセットアップ.
 			{
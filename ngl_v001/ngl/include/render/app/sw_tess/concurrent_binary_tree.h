@@ -9,20 +9,29 @@
 #include <vector>
 #include <cstdint>
 
+namespace ngl::thread
+{
+    class JobSystem;
+}
+
 namespace ngl::render::app
 {
-    // 完全二分木ビットフィールド（32bit uint リーフ特化）
-    class ConcurrentBinaryTreeU32
+    // 完全二分木ビットフィールド.
+    //  リーフはLeafTypeのビットフィールドで, 内部ノードはuint32_tの部分木ビット数を保持する.
+    //  cbt_node_ は1ベースで [1]がルート, [packed_leaf_count_ + i] がリーフiのビット数.
+    template <typename LEAF_TYPE>
+    class ConcurrentBinaryTree
     {
-        using LeafType = uint32_t;
+    public:
+        using LeafType = LEAF_TYPE;
         static constexpr uint32_t LeafTypeBitWidth = sizeof(LeafType) * 8;
         static constexpr uint32_t LeafTypePackedIndexShift = ngl::MostSignificantBit32(LeafTypeBitWidth);
         static constexpr uint32_t LeafTypeBitLocalIndexMask = (1u << LeafTypePackedIndexShift) - 1;
         static constexpr uint32_t SumValueLocation = 1;
 
     public:
-        ConcurrentBinaryTreeU32()  = default;
-        ~ConcurrentBinaryTreeU32() = default;
+        ConcurrentBinaryTree()  = default;
+        ~ConcurrentBinaryTree() = default;
 
         void Initialize(uint32_t require_leaf_count);
         void Clear();
@@ -31,22 +40,32 @@ namespace ngl::render::app
         uint32_t GetBit(uint32_t index) const;
 
         uint32_t GetSum() const;
-        void SumReduction();
+        // リーフのビット数集計はSIMDで実行する.
+        //  p_job_system が有効で十分大きい木の場合は部分木毎に並列実行し, 上位の数段のみシリアルに集計する.
+        void SumReduction(thread::JobSystem* p_job_system = nullptr);
 
         // 下位から i番目 の 1 の位置を検索. SumReduction後に使用可能.
-        int Find_ith_Bit1(uint32_t i);
+        int Find_ith_Bit1(uint32_t i) const;
         // 下位から i番目 の 0 の位置を検索. SumReduction後に使用可能.
-        int Find_ith_Bit0(uint32_t i);
+        int Find_ith_Bit0(uint32_t i) const;
 
         uint32_t NumLeaf() const;
     
-        // テスト関数
-        static void Test();
+        // テスト関数. p_job_system が有効な場合は並列SumReductionもシリアル実行と比較する.
+        static void Test(thread::JobSystem* p_job_system = nullptr);
 
     private:
         std::vector<uint32_t> cbt_node_{};
+        std::vector<LeafType> cbt_leaf_{};
         uint32_t packed_leaf_count_{};
-        uint32_t packed_leaf_offset_{};
     };
 
+    // 32bit uint リーフ. GPU側のCBTと同じリーフ幅.
+    using ConcurrentBinaryTreeU32 = ConcurrentBinaryTree<uint32_t>;
+    // 64bit uint リーフ. 内部ノード数が半分になるため大きなプールのCPU処理向け.
+    using ConcurrentBinaryTreeU64 = ConcurrentBinaryTree<uint64_t>;
+
+    extern template class ConcurrentBinaryTree<uint32_t>;
+    extern template class ConcurrentBinaryTree<uint64_t>;
+
 }  // namespace ngl::render::app
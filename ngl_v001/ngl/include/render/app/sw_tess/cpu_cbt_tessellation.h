@@ -0,0 +1,145 @@
+﻿/*
+    cpu_cbt_tessellation.h
+    CBTテッセレーションのCPUリファレンス実装
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "math/math.h"
+#include "render/app/sw_tess/half_edge_mesh.h"
+#include "render/app/sw_tess/concurrent_binary_tree.h"
+
+namespace ngl::thread
+{
+    class JobSystem;
+}
+
+namespace ngl::render::app
+{
+    // Bisector Command ビットマスク. シェーダ側 cbt_tess_common.hlsli と一致させる.
+    static constexpr uint32_t k_bisector_cmd_twin_split           = (1 << 0);
+    static constexpr uint32_t k_bisector_cmd_prev_split           = (1 << 1);
+    static constexpr uint32_t k_bisector_cmd_next_split           = (1 << 2);
+    static constexpr uint32_t k_bisector_cmd_any_split            = (k_bisector_cmd_twin_split | k_bisector_cmd_prev_split | k_bisector_cmd_next_split);
+    static constexpr uint32_t k_bisector_cmd_boundary_merge       = (1 << 3);
+    static constexpr uint32_t k_bisector_cmd_interior_merge       = (1 << 4);
+    static constexpr uint32_t k_bisector_cmd_merge_representative = (1 << 5);
+    static constexpr uint32_t k_bisector_cmd_merge_consent        = (1 << 6);
+
+    // cbt_tess_* のComputeShaderと同じBisector分割統合パイプラインのCPU実装.
+    //  GPUのスレッド並列処理をindex_cache順の逐次処理に置き換えた決定的なリファレンスで, GPUテッセレーションの検証に利用する.
+    //  BisectorPool, index_cache, alloc_counter の扱いはGPU側と同一.
+    //  GPUではスレッドの実行順でアロケーション先が変わるためBisectorPool上のインデックスは一致しない. 比較は CollectBisectorKey で行う.
+    class CpuCbtTessellation
+    {
+    public:
+        // generate_command の評価パラメータ. CBTGpuResources::CBTConstants の対応する値と同じ意味.
+        struct UpdateParam
+        {
+            math::Mat34 object_to_world = math::Mat34::Identity();
+            math::Vec3 important_point{};
+            float tessellation_split_threshold = 0.1f;
+            float tessellation_merge_factor = 0.45f;
+            int32_t fixed_subdivision_level = -1; // 固定分割レベル（-1で無効、0以上で固定分割）
+        };
+        // 1回の更新結果.
+        struct UpdateStatistics
+        {
+            uint32_t active_bisector_count = 0;   // 更新後の有効Bisector数.
+            uint32_t split_count = 0;             // 分割されたBisector数.
+            uint32_t boundary_merge_count = 0;    // 境界統合数 (2 -> 1).
+            uint32_t interior_merge_count = 0;    // 内部統合数 (4 -> 2).
+            uint32_t max_depth = 0;               // 有効Bisectorの最大深さ.
+        };
+        // 構造の検証結果.
+        struct ValidationResult
+        {
+            uint32_t invalid_link_count = 0;      // 範囲外や未使用Bisectorを指すリンク数.
+            uint32_t unreciprocated_link_count = 0; // 相手側から同じ辺で参照されていないリンク数 (T-Junction).
+            uint32_t duplicate_bisector_count = 0;  // 同じ (depth, id) の有効Bisector数.
+            bool is_cbt_sum_match = true;         // CBTの合計値と有効ビット数が一致するか.
+            double area_error = 0.0;              // 有効Bisectorの面積合計と元メッシュの面積の相対誤差.
+
+            bool IsValid() const
+            {
+                return 0 == invalid_link_count && 0 == unreciprocated_link_count && 0 == duplicate_bisector_count && is_cbt_sum_match && 1e-3 > area_error;
+            }
+        };
+
+        CpuCbtTessellation()  = default;
+        ~CpuCbtTessellation() = default;
+
+        // CBTGpuResources::Initialize と同じ深さでプールを確保し, cbt_tess_init_leaf と同様にHalfEdge毎のBisectorで初期化する.
+        //  vertex_position は評価と検証で参照するため, CpuCbtTessellationより長く保持すること.
+        bool Initialize(const HalfEdgeMesh& half_edge_mesh, const math::Vec3* vertex_position, uint32_t vertex_count, uint32_t average_subdivision_level);
+        // 初期状態に戻す.
+        void Reset();
+
+        // 1フレーム分の更新. GPU側と同じ順にパスを実行する.
+        //  begin_update, cache_index, reset_command, generate_command, reserve_block, fill_new_block, update_neighbor, update_cbt_bitfield, sum_reduction.
+        //  p_job_system はSumReductionのみで利用する.
+        UpdateStatistics Update(const UpdateParam& param, thread::JobSystem* p_job_system = nullptr);
+
+        // リンクの相互参照と辺の一致, CBTの整合性, 面積を検証する.
+        ValidationResult Validate() const;
+
+        // 有効Bisectorの (depth << 32 | id) をソートして返す. GPUのBisectorPoolと順序非依存に比較するため.
+        void CollectBisectorKey(std::vector<uint64_t>& out_key_array) const;
+        static void CollectBisectorKey(const Bisector* bisector_pool, const int* active_index, uint32_t active_count, std::vector<uint64_t>& out_key_array);
+
+        // Bisectorの三角形頂点座標 (オブジェクト空間). GPU側のCalcBisectorAttributeMatrixと同じ計算.
+        void CalcBisectorPosition(const Bisector& bisector, math::Vec3 out_position[3]) const;
+
+        uint32_t GetActiveBisectorCount() const { return cbt_.GetSum(); }
+        uint32_t GetBisectorPoolMaxSize() const { return bisector_pool_max_size_; }
+        uint32_t GetMinimumTreeDepth() const { return cbt_mesh_minimum_tree_depth_; }
+        uint32_t GetTreeDepth() const { return cbt_tree_depth_; }
+        const std::vector<Bisector>& GetBisectorPool() const { return bisector_pool_; }
+        // 先頭から有効Bisector, 末尾から未使用Bisectorのインデックス. 直前のUpdate時点の内容.
+        const std::vector<int>& GetIndexCache() const { return index_cache_; }
+
+    private:
+        void CacheIndex();
+        void GenerateCommand(const UpdateParam& param);
+        void ReserveBlock();
+        void FillNewBlock();
+        void UpdateNeighbor();
+        void UpdateCbtBitfield(UpdateStatistics& out_stat);
+
+        // アロケーションカウンタの減算. GPU側のInterlockedAddによる確保と同じ判定.
+        bool TryReserve(int alloc_count, int& out_counter);
+
+    private:
+        std::vector<HalfEdge> half_edge_{};
+        const math::Vec3* vertex_position_ = nullptr;
+        uint32_t vertex_count_ = 0;
+
+        uint32_t cbt_mesh_minimum_tree_depth_ = 0;
+        uint32_t cbt_tree_depth_ = 0;
+        uint32_t bisector_pool_max_size_ = 0;
+        // 初期状態の面積合計.
+        double total_area_ = 0.0;
+
+        ConcurrentBinaryTreeU32 cbt_{};
+        std::vector<Bisector> bisector_pool_{};
+        std::vector<int> index_cache_{};
+        uint32_t active_bisector_count_ = 0;  // 更新開始時点の有効Bisector数.
+        int alloc_counter_ = 0;
+    };
+
+    // 格子メッシュでCPUリファレンスを固定分割と適応分割で更新し, 毎フレーム構造を検証する.
+    struct CpuCbtTessellationSelfTestResult
+    {
+        uint32_t frame_count = 0;
+        uint32_t invalid_frame_count = 0;       // 検証に失敗したフレーム数.
+        uint32_t max_active_bisector_count = 0;
+        uint32_t final_active_bisector_count = 0; // 最後に固定分割レベル0に戻した後の有効Bisector数. HalfEdge数と一致するはず.
+        uint32_t half_edge_count = 0;
+        double update_ms = 0.0;                 // Updateの平均時間.
+    };
+    CpuCbtTessellationSelfTestResult RunCpuCbtTessellationSelfTest(int grid_resolution, uint32_t average_subdivision_level, thread::JobSystem* p_job_system = nullptr);
+
+}  // namespace ngl::render::app
@@ -8,6 +8,11 @@
 #include <vector>
 #include <cstdint>
 
+namespace ngl::thread
+{
+    class JobSystem;
+}
+
 namespace ngl::render::app
 {
     // HalfEdge構造体の定義.
@@ -24,15 +29,52 @@ namespace ngl::render::app
     class HalfEdgeMesh
     {
     public:
+        // 構築時のエッジ統計.
+        struct BuildStatistics
+        {
+            int edge_count              = 0;  // 無向エッジ数.
+            int boundary_edge_count     = 0;  // HalfEdgeが1つのみの境界エッジ数.
+            int non_manifold_edge_count = 0;  // 3つ以上のHalfEdgeが共有, または同じ向きのHalfEdgeが共有する無向エッジ数.
+            int degenerate_edge_count   = 0;  // 始点と終点が同じ頂点の縮退エッジ数.
+        };
+
         HalfEdgeMesh()  = default;
         ~HalfEdgeMesh() = default;
 
         // IndexListからHalfEdge構造を生成する関数
-        void Initialize(const uint32_t* index_list, int index_count);
+        //  無向エッジ(min,max)キーをRadixSortして隣接するHalfEdgeを線形に対応付ける. p_job_system が有効な場合は並列実行.
+        //  非多様体エッジは向き毎に最後のHalfEdge同士のみTwinとし, 縮退エッジはTwin無しとする.
+        void Initialize(const uint32_t* index_list, int index_count, thread::JobSystem* p_job_system = nullptr);
+        // ハッシュマップによる従来の生成. 検証とベンチマーク用. BuildStatisticsは更新しない.
+        void InitializeReference(const uint32_t* index_list, int index_count);
+
+        const BuildStatistics& GetBuildStatistics() const { return build_stat_; }
 
         std::vector<HalfEdge> half_edge_;
+
+    private:
+        BuildStatistics build_stat_{};
     };
 
+    // HalfEdgeMesh構築のベンチマーク結果.
+    struct HalfEdgeMeshBenchmarkResult
+    {
+        int triangle_count        = 0;
+        double reference_ms       = 0.0;  // InitializeReference.
+        double sort_ms            = 0.0;  // Initialize (シングルスレッド).
+        double sort_parallel_ms   = 0.0;  // Initialize (JobSystem).
+        bool is_match             = false;  // 従来実装と結果が一致したか.
+        HalfEdgeMesh::BuildStatistics build_stat{};
+    };
+    // 従来実装とソートベース実装を計測して結果を比較する.
+    //  縮退エッジのみ従来実装が自身をTwinとするため, それを除いて比較する.
+    HalfEdgeMeshBenchmarkResult RunHalfEdgeMeshBenchmark(const uint32_t* index_list, int index_count, thread::JobSystem* p_job_system = nullptr);
+    // ベンチマーク用の格子メッシュ (resolution * resolution * 2 三角形) のIndexList生成.
+    void MakeHalfEdgeMeshBenchmarkGrid(int resolution, std::vector<uint32_t>& out_index_list);
+
+    // 境界, 非多様体, 縮退エッジを含むメッシュでソートベース実装のTwinを従来実装と比較するテスト.
+    void TestHalfEdgeMesh();
+
     // Bisector毎の分割統合に伴うアロケーション結果の保持サイズ. cpp/シェーダ側と一致させる.
     // 元論文では4だが, 現実装ではTwinペア分割制限により実際は2.
     #define BISECTOR_ALLOC_PTR_SIZE 4
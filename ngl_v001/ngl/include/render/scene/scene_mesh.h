@@ -75,6 +75,9 @@ namespace ngl::gfx::scene
                 game_update_callback_(arg);
             }
 
+            // 描画に必要なテクスチャMipをストリーミングへ要求.
+            model_.RequestTextureStreaming(transform_);
+
             // GfxScene上のSceneMesh Proxyの情報を更新するRenderCommandを登録. RenderThread実行されるGfxに安全に情報送付するためのもの.
             fwk::PushCommonRenderCommand([this](fwk::CommonRenderCommandArgRef arg)
                                          {
@@ -90,6 +93,9 @@ namespace ngl::gfx::scene
                     render_update_callback_(arg_render_update);
                 }
 
+                // ストリーミングで切り替わったテクスチャのViewをBindlessマテリアルテーブルへ反映.
+                model_.UpdateBindlessMaterialTexture();
+
                 // gfx_meshのproxyに描画用の情報を設定.
                 proxy->model_ = &model_;
                 proxy->transform_ = transform_;
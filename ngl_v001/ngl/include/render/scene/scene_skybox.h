@@ -1,6 +1,16 @@
 ﻿#pragma once
 
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "util/bit_operation.h"
+#include "file/file.h"
+#include "thread/job_thread.h"
 
 #include "framework/gfx_scene_entity_skybox.h"
 #include "framework/gfx_render_command_manager.h"
@@ -8,6 +18,9 @@
 
 #include "gfx/rtg/rtg_common.h"
 #include "gfx/rendering/global_render_resource.h"
+#include "gfx/rendering/ibl_bake_cache.h"
+#include "gfx/rendering/ibl_sh.h"
+#include "gfx/resource/texture_cooker_directxtex.h"
 #include "gfx/command_helper.h"
 
 #include "render/task/pass_common.h"
@@ -22,12 +35,18 @@ namespace ngl::gfx::scene
      * @class SceneSkyBox
      *
      * SceneSkyBoxクラスはスカイボックスの生成と初期化を担当し、主にパノラマテクスチャから生成します。
-     * パノラマからキューブマップを生成し、拡散畳み込みを行い、関連する描画やリソースタスクを
+     * パノラマからキューブマップを生成し、GGX Specularの畳み込みを行い、関連する描画やリソースタスクを
      * 管理する機能を提供します。
+     * Diffuse IBLはパノラマからCPUで射影した放射照度SHとします。
+     * 畳み込み結果はソースのコンテンツハッシュをキーとしてキャッシュし, 次回以降のロードでは畳み込みを省略します。
      */
     class SceneSkyBox
     {   
     public:
+        // IBLテクスチャのフォーマット. キャッシュはこのピクセルサイズで保存する.
+        static constexpr rhi::EResourceFormat k_ibl_texture_format = rhi::EResourceFormat::Format_R16G16B16A16_FLOAT;
+        static constexpr u32 k_ibl_texture_byte_per_pixel = 8;
+
         ~SceneSkyBox() = default;
         
         bool InitializeGfx(fwk::GfxScene* scene)
@@ -37,6 +56,8 @@ namespace ngl::gfx::scene
         }
         void FinalizeGfx()
         {
+            // 保存待ちのキャッシュは破棄.
+            ibl_bake_cache_readback_ = {};
             // Proxyの解放.
             gfx_skybox_entity_.Finalize();
         }
@@ -45,8 +66,11 @@ namespace ngl::gfx::scene
             assert(fwk::GfxSceneEntityId::IsValid(gfx_skybox_entity_.proxy_info_.proxy_id_));
             assert(gfx_skybox_entity_.proxy_info_.scene_);
 
+            // GPUでの畳み込み結果のReadbackが完了していればキャッシュへ保存.
+            UpdateIblBakeCacheSave();
+
             // GfxScene上のSkyBox Proxyの情報を更新するRenderCommand. ProxyはIDによってRenderPassからアクセス可能で, SkyBoxの描画パラメータ送付に利用される.
-            fwk::PushCommonRenderCommand([this](fwk::CommonRenderCommandArgRef arg)
+            fwk::PushCommonRenderCommand([this, irradiance_sh = ibl_diffuse_irradiance_sh_](fwk::CommonRenderCommandArgRef arg)
             {
                 // TODO. Entityが破棄されると即時Proxyが破棄されるため, 破棄フレームでもRenderThreadで安全にアクセスできるようにEntityの破棄リスト対応する必要がある.
                 auto* proxy = gfx_skybox_entity_.GetProxy();
@@ -59,10 +83,9 @@ namespace ngl::gfx::scene
                 proxy->src_cubemap_ = this->generated_cubemap_;
                 proxy->src_cubemap_plane_array_srv_ = this->generated_cubemap_plane_array_srv_;
 
-                // Sky Cubemapから畳み込みで生成されるDiffuse IBL Cubemap.
-                proxy->ibl_diffuse_cubemap_ = this->conv_diffuse_cubemap_;
-                proxy->ibl_diffuse_cubemap_plane_array_srv_ = this->conv_diffuse_cubemap_plane_array_srv_;
-                
+                // PanoramaからCPUで射影したDiffuse IBLの放射照度SH.
+                proxy->ibl_diffuse_irradiance_sh_ = irradiance_sh;
+
                 // Sky Cubemapから畳み込みで生成されるGGX Specular IBL Cubemap.
                 proxy->ibl_ggx_specular_cubemap_ = this->conv_ggx_specular_cubemap_;
                 proxy->ibl_ggx_specular_cubemap_plane_array_srv_ = this->conv_ggx_specular_cubemap_plane_array_srv_;
@@ -80,60 +103,9 @@ namespace ngl::gfx::scene
         
 
         // 現在のパラメータでIBL Cubemapを再計算する描画コマンドを発行する.
+        //  結果はReadbackしてキャッシュへ保存する.
         void RecalculateIblTexture()
         {
-            // Diffuse.
-            {
-                constexpr u32 k_cubemap_plane_count = 6;
-                
-                const rhi::EResourceState prev_state = conv_diffuse_cubemap_state_;
-                constexpr auto next_state = rhi::EResourceState::ShaderRead;
-                conv_diffuse_cubemap_state_ = next_state;
-                const auto prevent_aliasing_mode = prevent_aliasing_mode_diffuse_;
-                ngl::fwk::PushCommonRenderCommand([this, prev_state, next_state, prevent_aliasing_mode](ngl::fwk::CommonRenderCommandArgRef arg)
-                {
-                    auto& global_res = gfx::GlobalRenderResource::Instance();
-                    auto* command_list = arg.command_list;
-                    auto* device = command_list->GetDevice();
-                
-                    NGL_RHI_GPU_SCOPED_EVENT_MARKER(command_list, "RecalculateIblTexture_Diffuse")
-                
-                    // Diffuse IBL Cubemap畳み込み.
-                    {
-                        NGL_RHI_GPU_SCOPED_EVENT_MARKER(command_list, "Conv_Diffuse")
-
-                        struct CbConvCubemapDiffuse
-                        {
-                            // ソースのCubemapの解像度に対して畳み込みサンプリングのアンダーサンプリングを緩和するためにMipmapを利用する.
-                            u32 use_mip_to_prevent_undersampling;
-                        };
-                        auto cbh = device->GetConstantBufferPool()->Alloc(sizeof(CbConvCubemapDiffuse));
-                        if (auto* map_ptr = cbh->buffer.MapAs<CbConvCubemapDiffuse>())
-                        {
-                            map_ptr->use_mip_to_prevent_undersampling = prevent_aliasing_mode;// Mipによるエイリアシング抑制有効.
-                        
-                            cbh->buffer.Unmap();
-                        }
-                    
-                        // UAVステートへ.
-                       command_list->ResourceBarrier(conv_diffuse_cubemap_.Get(), prev_state, rhi::EResourceState::UnorderedAccess);
-                
-                       rhi::DescriptorSetDep descset{};
-                        pso_conv_cube_diffuse_->SetView(&descset, "cb_conv_cubemap_diffuse", &cbh->cbv);
-                       pso_conv_cube_diffuse_->SetView(&descset, "tex_cube", generated_cubemap_plane_array_srv_.Get());
-                       pso_conv_cube_diffuse_->SetView(&descset, "samp", global_res.default_resource_.sampler_linear_wrap.Get());
-                       pso_conv_cube_diffuse_->SetView(&descset, "uav_cubemap_as_array", conv_diffuse_cubemap_plane_array_uav_.Get());
-                        
-                       command_list->SetPipelineState(pso_conv_cube_diffuse_.Get());
-                       command_list->SetDescriptorSet(pso_conv_cube_diffuse_.Get(), &descset);
-                       pso_conv_cube_diffuse_->DispatchHelper(command_list, conv_diffuse_cubemap_->GetWidth(), conv_diffuse_cubemap_->GetHeight(), k_cubemap_plane_count);
-
-                       // UAVからSrvステートへ.
-                       command_list->ResourceBarrier(conv_diffuse_cubemap_.Get(), rhi::EResourceState::UnorderedAccess, next_state);
-                    }
-                });
-            }
-
             const u32 specular_ibl_mip_count = conv_ggx_specular_cubemap_->GetMipCount();
             // Specular.
             for (u32 mip_i = 0; mip_i < specular_ibl_mip_count; ++mip_i)
@@ -198,7 +170,9 @@ namespace ngl::gfx::scene
                 
                 });
             }
-            
+
+            // 畳み込み結果をキャッシュへ保存.
+            RequestIblBakeCacheSave();
         }
         
         bool SetupAsPanorama(rhi::DeviceDep* p_device, const char* sky_texture_file_path)
@@ -208,10 +182,18 @@ namespace ngl::gfx::scene
             gfx::ResTexture::LoadDesc desc{};
             {
                 desc.mode = gfx::ResTexture::ECreateMode::FROM_FILE;
+                // BC6Hへ圧縮したキャッシュを利用.
+                desc.cook_usage = directxtex::ETextureCookUsage::Hdr;
+                // ロード直後のCubemap生成で全Mipを参照するため, ストリーミングや予算による持ち越しをせずにアップロードする.
+                desc.upload_immediate = true;
             }
             // ソースのパノラマイメージロード.
             res_sky_texture_ = res_mgr.LoadResource<gfx::ResTexture>(p_device, sky_texture_file_path, &desc);
 
+            p_device_ = p_device;
+            sky_texture_file_path_ = sky_texture_file_path;
+            // IBLキャッシュのキーとするソースのコンテンツハッシュ.
+            ibl_src_hash_ = file::CalcFileHashFNV1a64(sky_texture_file_path);
 
             // 内部で生成するCubemap.
             auto FuncCreateCubemapResources = [p_device](
@@ -244,7 +226,7 @@ namespace ngl::gfx::scene
                 (*out_cubemap).Reset(new rhi::TextureDep());
                 {
                     rhi::TextureDep::Desc cubemap_desc{};
-                    rhi::TextureDep::Desc::InitializeAsCubemap(cubemap_desc, rhi::EResourceFormat::Format_R16G16B16A16_FLOAT, resolution, resolution, false, is_need_uav);
+                    rhi::TextureDep::Desc::InitializeAsCubemap(cubemap_desc, k_ibl_texture_format, resolution, resolution, false, is_need_uav);
                     // MipCount設定.
                     cubemap_desc.mip_count = gen_mip_count
                     ;
@@ -270,9 +252,6 @@ namespace ngl::gfx::scene
             // Panoramaから生成するCubemap. エイリアシング対策のためにMip生成.
             FuncCreateCubemapResources(512, 0, &generated_cubemap_, &generated_cubemap_plane_array_srv_, &generated_cubemap_plane_array_uav_);
 
-            // Diffuse Conv Cubemap. Mip無し. 最終的にはTextureではなくSHにしてしまいたい.
-            FuncCreateCubemapResources(64, 1, &conv_diffuse_cubemap_, &conv_diffuse_cubemap_plane_array_srv_, &conv_diffuse_cubemap_plane_array_uav_);
-            
             // GGX Specular Conv Cubemap. 全Miplevel.
             FuncCreateCubemapResources(512, 0, &conv_ggx_specular_cubemap_, &conv_ggx_specular_cubemap_plane_array_srv_, &conv_ggx_specular_cubemap_plane_array_uav_);
 
@@ -281,7 +260,7 @@ namespace ngl::gfx::scene
                 const int k_dfg_lut_resolution = 128;
                 conv_ggx_dfg_lut_.Reset(new rhi::TextureDep());
                 {
-                    const auto lut_format = rhi::EResourceFormat::Format_R16G16B16A16_FLOAT;
+                    const auto lut_format = k_ibl_texture_format;
                     //const auto lut_format = rhi::EResourceFormat::Format_R32G32B32A32_FLOAT;
                     //const auto lut_format = rhi::EResourceFormat::Format_R16G16_FLOAT;
                     //const auto lut_format = rhi::EResourceFormat::Format_R32G32_FLOAT;
@@ -323,24 +302,6 @@ namespace ngl::gfx::scene
                     pso_panorama_to_cube_ = pso_cache->GetOrCreate(p_device, pso_desc);
                 }
                 
-                pso_conv_cube_diffuse_.Reset(new rhi::ComputePipelineStateDep());
-                {
-                    gfx::ResShader::LoadDesc loaddesc{};
-                    {
-                        loaddesc.entry_point_name = "main";
-                        loaddesc.stage = ngl::rhi::EShaderStage::Compute;
-                        loaddesc.shader_model_version = "6_3";
-                    }
-                    auto res_shader = res_mgr.LoadResource<gfx::ResShader>(p_device,
-                                                NGL_RENDER_SHADER_PATH("ibl/conv_cubemap_diffuse_cs.hlsl"),
-                                                &loaddesc);
-                
-                    rhi::ComputePipelineStateDep::Desc pso_desc{};
-                    pso_desc.cs = &res_shader->data_;
-
-                    pso_conv_cube_diffuse_ = pso_cache->GetOrCreate(p_device, pso_desc);
-                }
-                
                 pso_conv_cube_ggx_specular_.Reset(new rhi::ComputePipelineStateDep());
                 {
                     gfx::ResShader::LoadDesc loaddesc{};
@@ -422,6 +383,29 @@ namespace ngl::gfx::scene
                 });
             }
 
+            // キャッシュがあればGGX Specular, DFG LUT, Diffuse SHをロードして畳み込みを省略する.
+            {
+                auto cache_data = std::make_shared<gfx::IblBakeCacheData>();
+                const u64 cache_hash = gfx::CalcIblBakeCacheHash(MakeIblBakeCacheKey());
+                std::string cache_path;
+                if (gfx::BuildIblBakeCachePath(sky_texture_file_path, cache_hash, cache_path)
+                    && gfx::LoadIblBakeCache(cache_path.c_str(), cache_hash, *cache_data)
+                    && IsCompatibleIblBakeCache(*cache_data))
+                {
+                    std::cout << "[SceneSkyBox] Load IBL bake cache: " << cache_path << std::endl;
+                    ibl_diffuse_irradiance_sh_ = cache_data->diffuse_irradiance_sh;
+                    UploadIblBakeCache(cache_data);
+                    return res_sky_texture_.IsValid();
+                }
+            }
+
+            // Diffuse IBL. パノラマの放射輝度をCPUでSHへ射影する.
+            if (!CalcPanoramaIrradianceSh(ibl_diffuse_irradiance_sh_, sky_texture_file_path))
+            {
+                std::cout << "[ERROR] SceneSkyBox: Failed to project panorama to SH." << std::endl;
+                ibl_diffuse_irradiance_sh_ = {};
+            }
+
             // DFG LUT生成.
             {
                 const rhi::EResourceState init_state = conv_ggx_dfg_lut_state_;
@@ -453,7 +437,7 @@ namespace ngl::gfx::scene
             }
 
 
-            // IBL DiffuseとSpecularを再計算.
+            // IBL Specularを計算.
             RecalculateIblTexture();
             
             return res_sky_texture_.IsValid();
@@ -468,13 +452,9 @@ namespace ngl::gfx::scene
         {
             return generated_cubemap_plane_array_srv_;
         }
-        rhi::RefTextureDep GetConvDiffuseCubemap() const
-        {
-            return conv_diffuse_cubemap_;
-        }
-        rhi::RefSrvDep GetConvDiffuseCubemapSrv() const
+        const gfx::Sh9Rgb& GetIblDiffuseIrradianceSh() const
         {
-            return conv_diffuse_cubemap_plane_array_srv_;
+            return ibl_diffuse_irradiance_sh_;
         }
         rhi::RefTextureDep GetConvGgxSpecularCubemap() const
         {
@@ -486,7 +466,7 @@ namespace ngl::gfx::scene
         }
         rhi::RefTextureDep GetConvGgxDfgLut() const
         {
-            return conv_diffuse_cubemap_;
+            return conv_ggx_dfg_lut_;
         }
         rhi::RefSrvDep GetConvGgxDfgLutSrv() const
         {
@@ -500,11 +480,249 @@ namespace ngl::gfx::scene
         }
 
     public:
-        void SetParam_PreventAliasingModeDiffuse(bool v){prevent_aliasing_mode_diffuse_ = v;}
-        bool GetParam_PreventAliasingModeDiffuse() const {return prevent_aliasing_mode_diffuse_;}
         void SetParam_PreventAliasingModeSpecular(bool v){prevent_aliasing_mode_specular_ = v;}
         bool GetParam_PreventAliasingModeSpecular() const {return prevent_aliasing_mode_specular_;}
 
+    private:
+        // キャッシュ保存のためのIBLテクスチャのReadback要求.
+        struct IblBakeCacheReadback
+        {
+            static constexpr u64 k_invalid_frame_index = ~0ull;
+
+            std::string cache_path = {};
+            u64 cache_hash = 0;
+            gfx::Sh9Rgb diffuse_irradiance_sh = {};
+
+            rhi::RefBufferDep buffer = {};
+            std::vector<rhi::TextureSubresourceLayoutInfo> specular_layout = {};
+            std::vector<rhi::TextureSubresourceLayoutInfo> dfg_lut_layout = {};
+            // コピーを記録したフレームのDeviceフレームインデックス. RenderThreadで記録される.
+            std::atomic<u64> recorded_frame_index = k_invalid_frame_index;
+        };
+
+        gfx::IblBakeCacheKey MakeIblBakeCacheKey() const
+        {
+            gfx::IblBakeCacheKey key{};
+            key.src_hash = ibl_src_hash_;
+            key.specular_resolution = conv_ggx_specular_cubemap_->GetWidth();
+            key.specular_mip_count = conv_ggx_specular_cubemap_->GetMipCount();
+            key.specular_format = static_cast<u32>(conv_ggx_specular_cubemap_->GetDesc().format);
+            key.dfg_lut_resolution = conv_ggx_dfg_lut_->GetWidth();
+            key.dfg_lut_format = static_cast<u32>(conv_ggx_dfg_lut_->GetDesc().format);
+            key.prevent_aliasing_mode_specular = prevent_aliasing_mode_specular_ ? 1u : 0u;
+            return key;
+        }
+
+        // キャッシュのテクスチャ形状が生成済みのテクスチャと一致するか.
+        bool IsCompatibleIblBakeCache(const gfx::IblBakeCacheData& data) const
+        {
+            auto is_compatible = [](const gfx::IblBakeCacheTexture& cache_texture, const rhi::TextureDep* p_texture)
+            {
+                return cache_texture.IsValid()
+                    && cache_texture.format == static_cast<u32>(p_texture->GetDesc().format)
+                    && cache_texture.width == p_texture->GetWidth()
+                    && cache_texture.height == p_texture->GetHeight()
+                    && cache_texture.mip_count == p_texture->GetMipCount()
+                    && static_cast<int>(cache_texture.NumSubresource()) == p_texture->NumSubresource()
+                    && cache_texture.byte_per_pixel == k_ibl_texture_byte_per_pixel;
+            };
+            return is_compatible(data.ggx_specular_cubemap, conv_ggx_specular_cubemap_.Get())
+                && is_compatible(data.ggx_dfg_lut, conv_ggx_dfg_lut_.Get());
+        }
+
+        // パノラマイメージをfloat4でロードし, 放射照度SHを計算する.
+        static bool CalcPanoramaIrradianceSh(gfx::Sh9Rgb& out_irradiance_sh, const char* sky_texture_file_path)
+        {
+            DirectX::ScratchImage image_data;
+            if (!directxtex::LoadImageData_Float4(image_data, sky_texture_file_path))
+                return false;
+            const DirectX::Image* p_image = image_data.GetImage(0, 0, 0);
+            if (!p_image || !p_image->pixels)
+                return false;
+
+            // 射影の並列化用. ロード中のみ利用する.
+            thread::JobSystem job_system;
+            job_system.Init(std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+
+            gfx::Sh9Rgb radiance_sh{};
+            gfx::ProjectPanoramaToSh9(radiance_sh, reinterpret_cast<const float*>(p_image->pixels),
+                static_cast<u32>(p_image->width), static_cast<u32>(p_image->height), static_cast<u32>(p_image->rowPitch), &job_system);
+            out_irradiance_sh = gfx::ConvolveSh9WithCosineLobe(radiance_sh);
+            return true;
+        }
+
+        // キャッシュのテクスチャを一時バッファ経由でコピーする. RenderThreadで実行.
+        static void CopyIblBakeCacheToTexture(rhi::GraphicsCommandListDep* command_list, rhi::TextureDep* p_texture,
+            rhi::EResourceState prev_state, rhi::EResourceState next_state, gfx::IblBakeCacheTexture& cache_texture)
+        {
+            auto* device = command_list->GetDevice();
+
+            u64 dst_byte_size = 0;
+            std::vector<rhi::TextureSubresourceLayoutInfo> dst_layout(p_texture->NumSubresource());
+            p_texture->GetSubresourceLayoutInfo(dst_layout.data(), dst_byte_size);
+
+            std::vector<rhi::TextureUploadSubresourceInfo> src_info(dst_layout.size());
+            for (u32 i = 0; i < static_cast<u32>(src_info.size()); ++i)
+            {
+                const u32 mip = i % cache_texture.mip_count;
+                src_info[i].array_index = static_cast<s32>(i / cache_texture.mip_count);
+                src_info[i].mip_index = static_cast<s32>(mip);
+                src_info[i].width = static_cast<s32>(cache_texture.GetMipWidth(mip));
+                src_info[i].height = static_cast<s32>(cache_texture.GetMipHeight(mip));
+                src_info[i].format = static_cast<rhi::EResourceFormat>(cache_texture.format);
+                src_info[i].rowPitch = static_cast<s32>(cache_texture.GetSubresourceRowPitch(i));
+                src_info[i].slicePitch = static_cast<s32>(cache_texture.GetSubresourceByteSize(i));
+                src_info[i].pixels = cache_texture.pixel_memory.data() + cache_texture.GetSubresourceByteOffset(i);
+            }
+
+            rhi::RefBufferDep upload_buffer = {};
+            u8* p_upload_memory = {};
+            res::ResourceManager::Instance().AllocTextureUploadIntermediateBufferMemory(upload_buffer, p_upload_memory, dst_byte_size, device);
+            if (!p_upload_memory)
+            {
+                std::cout << "[ERROR] Failed to AllocTextureUploadIntermediateBufferMemory." << std::endl;
+                assert(p_upload_memory);
+                return;
+            }
+            res::ResourceManager::Instance().CopyImageDataToUploadIntermediateBuffer(
+                p_upload_memory, dst_layout.data(), src_info.data(), static_cast<u32>(src_info.size()));
+
+            command_list->ResourceBarrier(p_texture, prev_state, rhi::EResourceState::CopyDst);
+            for (int subresource_index = 0; subresource_index < p_texture->NumSubresource(); ++subresource_index)
+            {
+                command_list->CopyTextureRegion(p_texture, subresource_index, upload_buffer.Get(), dst_layout[subresource_index]);
+            }
+            command_list->ResourceBarrier(p_texture, rhi::EResourceState::CopyDst, next_state);
+        }
+
+        // キャッシュからIBLテクスチャを復元する描画コマンドを発行する.
+        //  ProxyはIBLのSRVを初回フレームから参照するため, UploadManagerではなく後続の描画と同じGraphics Queueで順序付けしてコピーする.
+        void UploadIblBakeCache(std::shared_ptr<gfx::IblBakeCacheData> cache_data)
+        {
+            const rhi::EResourceState specular_prev_state = conv_ggx_specular_cubemap_state_;
+            const rhi::EResourceState dfg_lut_prev_state = conv_ggx_dfg_lut_state_;
+            constexpr auto next_state = rhi::EResourceState::ShaderRead;
+            conv_ggx_specular_cubemap_state_ = next_state;
+            conv_ggx_dfg_lut_state_ = next_state;
+            ngl::fwk::PushCommonRenderCommand([this, cache_data, specular_prev_state, dfg_lut_prev_state, next_state](ngl::fwk::CommonRenderCommandArgRef arg)
+            {
+                auto* command_list = arg.command_list;
+
+                NGL_RHI_GPU_SCOPED_EVENT_MARKER(command_list, "Upload_Ibl_Bake_Cache")
+
+                CopyIblBakeCacheToTexture(command_list, conv_ggx_specular_cubemap_.Get(), specular_prev_state, next_state, cache_data->ggx_specular_cubemap);
+                CopyIblBakeCacheToTexture(command_list, conv_ggx_dfg_lut_.Get(), dfg_lut_prev_state, next_state, cache_data->ggx_dfg_lut);
+            });
+        }
+
+        // 現在のIBLテクスチャをReadbackする描画コマンドを発行する. 保存はGPU完了後に UpdateIblBakeCacheSave で行う.
+        void RequestIblBakeCacheSave()
+        {
+            // Readback配置のアライメント. D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT.
+            constexpr u64 k_placement_alignment = 512;
+
+            auto readback = std::make_shared<IblBakeCacheReadback>();
+            readback->cache_hash = gfx::CalcIblBakeCacheHash(MakeIblBakeCacheKey());
+            if (!gfx::BuildIblBakeCachePath(sky_texture_file_path_.c_str(), readback->cache_hash, readback->cache_path))
+                return;
+            readback->diffuse_irradiance_sh = ibl_diffuse_irradiance_sh_;
+
+            u64 specular_byte_size = 0;
+            readback->specular_layout.resize(conv_ggx_specular_cubemap_->NumSubresource());
+            conv_ggx_specular_cubemap_->GetSubresourceLayoutInfo(readback->specular_layout.data(), specular_byte_size);
+            u64 dfg_lut_byte_size = 0;
+            readback->dfg_lut_layout.resize(conv_ggx_dfg_lut_->NumSubresource());
+            conv_ggx_dfg_lut_->GetSubresourceLayoutInfo(readback->dfg_lut_layout.data(), dfg_lut_byte_size);
+            // DFG LUTはSpecularの後ろに配置.
+            const u64 dfg_lut_base_offset = (specular_byte_size + k_placement_alignment - 1) / k_placement_alignment * k_placement_alignment;
+            for (auto& e : readback->dfg_lut_layout)
+                e.byte_offset += dfg_lut_base_offset;
+
+            readback->buffer.Reset(new rhi::BufferDep());
+            {
+                rhi::BufferDep::Desc buffer_desc{};
+                buffer_desc.heap_type = rhi::EResourceHeapType::Readback;
+                buffer_desc.initial_state = rhi::EResourceState::CopyDst;// ReadbackはCopyDest.
+                buffer_desc.element_byte_size = static_cast<u32>(dfg_lut_base_offset + dfg_lut_byte_size);
+                buffer_desc.element_count = 1;
+                if (!readback->buffer->Initialize(p_device_, buffer_desc))
+                {
+                    std::cout << "[ERROR] SceneSkyBox: Failed to create IBL readback buffer." << std::endl;
+                    return;
+                }
+            }
+
+            const rhi::EResourceState specular_state = conv_ggx_specular_cubemap_state_;
+            const rhi::EResourceState dfg_lut_state = conv_ggx_dfg_lut_state_;
+            ngl::fwk::PushCommonRenderCommand([this, readback, specular_state, dfg_lut_state](ngl::fwk::CommonRenderCommandArgRef arg)
+            {
+                auto* command_list = arg.command_list;
+                auto* device = command_list->GetDevice();
+
+                NGL_RHI_GPU_SCOPED_EVENT_MARKER(command_list, "Readback_Ibl_Bake_Cache")
+
+                auto copy_to_readback = [&](rhi::TextureDep* p_texture, rhi::EResourceState state, const std::vector<rhi::TextureSubresourceLayoutInfo>& layout)
+                {
+                    command_list->ResourceBarrier(p_texture, state, rhi::EResourceState::CopySrc);
+                    for (int subresource_index = 0; subresource_index < p_texture->NumSubresource(); ++subresource_index)
+                    {
+                        command_list->CopyTextureToBufferRegion(readback->buffer.Get(), layout[subresource_index], p_texture, subresource_index);
+                    }
+                    command_list->ResourceBarrier(p_texture, rhi::EResourceState::CopySrc, state);
+                };
+                copy_to_readback(conv_ggx_specular_cubemap_.Get(), specular_state, readback->specular_layout);
+                copy_to_readback(conv_ggx_dfg_lut_.Get(), dfg_lut_state, readback->dfg_lut_layout);
+
+                readback->recorded_frame_index = device->GetDeviceFrameIndex();
+            });
+            // 未完了の以前の要求は破棄して最新の結果のみ保存する.
+            ibl_bake_cache_readback_ = readback;
+        }
+
+        // Readbackが完了していればキャッシュファイルへ保存する. GameThreadで毎フレーム呼び出す.
+        void UpdateIblBakeCacheSave()
+        {
+            if (!ibl_bake_cache_readback_ || !p_device_)
+                return;
+            auto& readback = *ibl_bake_cache_readback_;
+            const u64 recorded_frame_index = readback.recorded_frame_index;
+            if (IblBakeCacheReadback::k_invalid_frame_index == recorded_frame_index || p_device_->GetCompletedFrameIndex() < recorded_frame_index)
+                return;
+
+            // Readback Buffer上のレイアウトから行間を詰めてキャッシュのテクスチャへ.
+            auto copy_from_readback = [](gfx::IblBakeCacheTexture& out_texture, const u8* p_readback, const rhi::TextureDep* p_texture, const std::vector<rhi::TextureSubresourceLayoutInfo>& layout)
+            {
+                const u32 mip_count = p_texture->GetMipCount();
+                out_texture.Initialize(static_cast<u32>(p_texture->GetDesc().format), p_texture->GetWidth(), p_texture->GetHeight(),
+                    static_cast<u32>(layout.size()) / mip_count, mip_count, k_ibl_texture_byte_per_pixel);
+                for (u32 i = 0; i < static_cast<u32>(layout.size()); ++i)
+                {
+                    const u32 row_byte = out_texture.GetSubresourceRowPitch(i);
+                    const u32 row_count = out_texture.GetMipHeight(i % mip_count);
+                    u8* p_dst = out_texture.pixel_memory.data() + out_texture.GetSubresourceByteOffset(i);
+                    for (u32 row = 0; row < row_count; ++row)
+                    {
+                        memcpy(p_dst + static_cast<u64>(row) * row_byte, p_readback + layout[i].byte_offset + static_cast<u64>(row) * layout[i].row_pitch, row_byte);
+                    }
+                }
+            };
+
+            if (const u8* p_readback = readback.buffer->MapAs<u8>())
+            {
+                gfx::IblBakeCacheData data{};
+                data.diffuse_irradiance_sh = readback.diffuse_irradiance_sh;
+                copy_from_readback(data.ggx_specular_cubemap, p_readback, conv_ggx_specular_cubemap_.Get(), readback.specular_layout);
+                copy_from_readback(data.ggx_dfg_lut, p_readback, conv_ggx_dfg_lut_.Get(), readback.dfg_lut_layout);
+                readback.buffer->Unmap();
+
+                if (gfx::SaveIblBakeCache(readback.cache_path.c_str(), readback.cache_hash, data))
+                    std::cout << "[SceneSkyBox] Save IBL bake cache: " << readback.cache_path << std::endl;
+                else
+                    std::cout << "[ERROR] SceneSkyBox: Failed to save IBL bake cache: " << readback.cache_path << std::endl;
+            }
+            ibl_bake_cache_readback_ = {};
+        }
+
     private:
         // Gfx用.
         fwk::GfxSceneEntitySkyBox gfx_skybox_entity_;
@@ -515,7 +733,6 @@ namespace ngl::gfx::scene
         res::ResourceHandle<gfx::ResTexture> res_sky_texture_;
 
 		rhi::RhiRef<rhi::ComputePipelineStateDep> pso_panorama_to_cube_;
-        rhi::RhiRef<rhi::ComputePipelineStateDep> pso_conv_cube_diffuse_;
         rhi::RhiRef<rhi::ComputePipelineStateDep> pso_conv_cube_ggx_specular_;
         rhi::RhiRef<rhi::ComputePipelineStateDep> pso_conv_dfg_lut_;
 
@@ -526,11 +743,8 @@ namespace ngl::gfx::scene
         rhi::EResourceState generated_cubemap_state_ = rhi::EResourceState::Common;
         
 
-        // Sky Cubemapから畳み込みで生成されるDiffuse IBL Cubemap.
-        rhi::RefTextureDep conv_diffuse_cubemap_;
-        rhi::RefUavDep conv_diffuse_cubemap_plane_array_uav_;
-        rhi::RefSrvDep conv_diffuse_cubemap_plane_array_srv_;
-        rhi::EResourceState conv_diffuse_cubemap_state_ = rhi::EResourceState::Common;
+        // PanoramaからCPUで射影したDiffuse IBLの放射照度SH. E/π.
+        gfx::Sh9Rgb ibl_diffuse_irradiance_sh_ = {};
         
         // Sky Cubemapから畳み込みで生成されるGGX Specular IBL Cubemap.
         rhi::RefTextureDep conv_ggx_specular_cubemap_;
@@ -546,7 +760,12 @@ namespace ngl::gfx::scene
 
         
         // IBLテクスチャ計算に関するパラメータ.
-        bool prevent_aliasing_mode_diffuse_ = true;
         bool prevent_aliasing_mode_specular_ = true;
+
+        // IBLキャッシュ.
+        rhi::DeviceDep* p_device_ = {};
+        std::string sky_texture_file_path_ = {};
+        u64 ibl_src_hash_ = 0;
+        std::shared_ptr<IblBakeCacheReadback> ibl_bake_cache_readback_ = {};
     };
 }
\ No newline at end of file
@@ -33,6 +33,8 @@ namespace ngl::render::task
 			rtg::RtgResourceHandle h_input_test, const SetupDesc& desc)
 		{
 			SetDebugNodeName("AsyncComputeTest");
+			// Queue自動配置時にAsyncComputeを許可.
+			SetAsyncComputeEligible(true);
 			desc_ = desc;
 			
 			// Rtgリソースセットアップ.
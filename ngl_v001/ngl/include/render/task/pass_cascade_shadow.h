@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <thread>
+#include <array>
 
 #include "pass_common.h"
 
@@ -84,6 +84,7 @@ namespace ngl::render::task
 			math::Vec3 directional_light_dir{};
 
 			bool		dbg_per_cascade_multithread = true;
+			gfx::DrawSplitDesc	draw_split{};// マルチスレッド実行時のMesh描画のCommandList分割.
 		} desc_{};
 		bool is_render_skip_debug_{};
 		
@@ -261,88 +262,87 @@ namespace ngl::render::task
 						return;
 					}
 
-					if(desc_.dbg_per_cascade_multithread)
+					// ハンドルからリソース取得. 必要なBarrierコマンドは外部で発行済である.
+					auto res_shadow_depth_atlas = builder.GetAllocatedResource(this, h_shadow_depth_atlas_);
+					assert(res_shadow_depth_atlas.tex_.IsValid() && res_shadow_depth_atlas.dsv_.IsValid());
+
+					// マルチスレッド実行ではMesh描画リストをコストで分割し, Cascadeと分割チャンクの組毎にCommandListへ並列記録する.
+					//	RtgのExecuteがシングルスレッド実行の場合はJobSystemが無いため1つのCommandListで順に実行する.
+					thread::JobSystem* p_job_system = (desc_.dbg_per_cascade_multithread)? builder.GetExecuteJobSystem() : nullptr;
+					std::vector<gfx::DrawChunkRange> chunk_array;
+					if(p_job_system)
 					{
-						// Cascade毎にマルチスレッド実行するためにCommandListを確保.
-						command_list_allocator.Alloc(csm_param_.k_cascade_count);
+						// 全Cascadeで同じ分割を利用する.
+						std::vector<u32> draw_cost;
+						gfx::EstimateMeshDrawCost(desc_.gfx_scene, *desc_.p_mesh_proxy_id_array, draw_cost);
+						gfx::SplitDrawListByCost(draw_cost, desc_.draw_split, chunk_array);
 					}
-					else
+					if(chunk_array.empty())
 					{
-						// シングルスレッド実行なので1つだけCommandList確保.
-						command_list_allocator.Alloc(1);
+						chunk_array.push_back({0, static_cast<int>(desc_.p_mesh_proxy_id_array->size())});
 					}
+					const int num_chunk = static_cast<int>(chunk_array.size());
+					const int num_record = (p_job_system)? (csm_param_.k_cascade_count * num_chunk) : 1;
+					command_list_allocator.Alloc(num_record);
 					
 					// マルチスレッドで複数CommandListを使うためScopedMakerでは対応できない. 直接適切なCommandListにMarkerをPushする.
 					command_list_allocator.GetOrCreate_Front()->BeginMarker("Shadow");
-						
-					// ハンドルからリソース取得. 必要なBarrierコマンドは外部で発行済である.
-					auto res_shadow_depth_atlas = builder.GetAllocatedResource(this, h_shadow_depth_atlas_);
-					assert(res_shadow_depth_atlas.tex_.IsValid() && res_shadow_depth_atlas.dsv_.IsValid());
 
 					// Atlas全域クリア.
 					command_list_allocator.GetOrCreate_Front()->ClearDepthTarget(res_shadow_depth_atlas.dsv_.Get(), 0.0f, 0, true, true);// とりあえずクリアだけ.ReverseZなので0クリア.
 
-					// Cascade単位のレンダリング.
-					auto render_per_cascade = [this, res_shadow_depth_atlas](int cascade_index, rhi::GraphicsCommandListDep* command_list, const rtg::RtgAllocatedResourceInfo& shadow_atlas)
+					// Cascade用の定数バッファ. 分割チャンク間で共有するため記録前に生成.
+					std::array<rhi::ConstantBufferPooledHandle, CascadeShadowMapParameter::k_cascade_count> shadow_cb_array;
+					for(int cascade_index = 0; cascade_index < csm_param_.k_cascade_count; ++cascade_index)
 					{
-						auto* thread_command_list = command_list;
-						
-						NGL_RHI_GPU_SCOPED_EVENT_MARKER(thread_command_list, text::FixedString<64>("Cascade_%d", cascade_index));
-
-						// D3D ValidationErrorになるため, CommandList毎に同じTarget設定コマンドを発行している.
-						thread_command_list->SetRenderTargets(nullptr, 0, shadow_atlas.dsv_.Get());
-							
-						// Cascade用の定数バッファを都度生成.
-						auto shadow_cb_h = thread_command_list->GetDevice()->GetConstantBufferPool()->Alloc(sizeof(SceneDirectionalShadowRenderInfo));
-						if (auto* mapped = shadow_cb_h->buffer.MapAs<SceneDirectionalShadowRenderInfo>())
+						shadow_cb_array[cascade_index] = command_list_allocator.GetOrCreate_Front()->GetDevice()->GetConstantBufferPool()->Alloc(sizeof(SceneDirectionalShadowRenderInfo));
+						if (auto* mapped = shadow_cb_array[cascade_index]->buffer.MapAs<SceneDirectionalShadowRenderInfo>())
 						{
-							const auto csm_info_index = cascade_index;
-								
-							assert(csm_info_index < csm_param_.k_cascade_count);// 不正なIndexでないか.
-							mapped->cb_shadow_view_mtx = csm_param_.light_view_mtx[csm_info_index];
-							mapped->cb_shadow_proj_mtx = csm_param_.light_ortho_mtx[csm_info_index];
-							mapped->cb_shadow_view_inv_mtx = ngl::math::Mat34::Inverse(csm_param_.light_view_mtx[csm_info_index]);
-							mapped->cb_shadow_proj_inv_mtx = ngl::math::Mat44::Inverse(csm_param_.light_ortho_mtx[csm_info_index]);
+							mapped->cb_shadow_view_mtx = csm_param_.light_view_mtx[cascade_index];
+							mapped->cb_shadow_proj_mtx = csm_param_.light_ortho_mtx[cascade_index];
+							mapped->cb_shadow_view_inv_mtx = ngl::math::Mat34::Inverse(csm_param_.light_view_mtx[cascade_index]);
+							mapped->cb_shadow_proj_inv_mtx = ngl::math::Mat44::Inverse(csm_param_.light_ortho_mtx[cascade_index]);
 							
-							shadow_cb_h->buffer.Unmap();
+							shadow_cb_array[cascade_index]->buffer.Unmap();
 						}
+					}
+
+					// Cascadeの描画リストの範囲をレンダリング.
+					auto render_cascade_chunk = [this, &res_shadow_depth_atlas, &shadow_cb_array](int cascade_index, const gfx::DrawChunkRange& chunk, rhi::GraphicsCommandListDep* command_list)
+					{
+						NGL_RHI_GPU_SCOPED_EVENT_MARKER(command_list, text::FixedString<64>("Cascade_%d", cascade_index));
+
+						// D3D ValidationErrorになるため, CommandList毎に同じTarget設定コマンドを発行している.
+						command_list->SetRenderTargets(nullptr, 0, res_shadow_depth_atlas.dsv_.Get());
 
 						const auto cascade_tile_w = csm_param_.cascade_tile_size_x[cascade_index];
 						const auto cascade_tile_h = csm_param_.cascade_tile_size_y[cascade_index];
 						const auto cascade_tile_offset_x = csm_param_.cascade_tile_offset_x[cascade_index];
 						const auto cascade_tile_offset_y = csm_param_.cascade_tile_offset_y[cascade_index];
-						ngl::gfx::helper::SetFullscreenViewportAndScissor(thread_command_list, cascade_tile_offset_x, cascade_tile_offset_y, cascade_tile_w, cascade_tile_h);
+						ngl::gfx::helper::SetFullscreenViewportAndScissor(command_list, cascade_tile_offset_x, cascade_tile_offset_y, cascade_tile_w, cascade_tile_h);
 
 						// Mesh Rendering.
 						gfx::RenderMeshResource render_mesh_res = {};
 						{
 							render_mesh_res.cbv_sceneview = {"cb_ngl_sceneview", &desc_.scene_cbv->cbv};
-							render_mesh_res.cbv_d_shadowview = {"cb_ngl_shadowview", &shadow_cb_h->cbv};
+							render_mesh_res.cbv_d_shadowview = {"cb_ngl_shadowview", &shadow_cb_array[cascade_index]->cbv};
 						}
 
-						ngl::gfx::RenderMeshWithMaterial(*thread_command_list, gfx::MaterialPassPsoCreator_d_shadow::k_name, desc_.gfx_scene, *desc_.p_mesh_proxy_id_array, render_mesh_res);
+						ngl::gfx::RenderMeshWithMaterial(*command_list, gfx::MaterialPassPsoCreator_d_shadow::k_name, desc_.gfx_scene, *desc_.p_mesh_proxy_id_array, render_mesh_res, chunk.begin, chunk.end);
 					};
 
-					if(desc_.dbg_per_cascade_multithread)
+					if(p_job_system)
 					{
-						// Cascade毎にマルチスレッド実行.
-					
-						// シンプルにstd::thread使用. 理想的には起動済みのJobSystemスレッドを利用したい.
-						// 0番以外を別スレッド実行.
-						std::vector<std::thread*> thread_array;
-						for(int cascade_index = 1; cascade_index < csm_param_.k_cascade_count; ++cascade_index)
+						// Cascadeとチャンクの組毎にマルチスレッド実行. CommandListはCascade順, チャンク順に並べて描画順を保つ.
+						std::vector<rhi::GraphicsCommandListDep*> command_list_array(num_record);
+						for(int record_index = 0; record_index < num_record; ++record_index)
 						{
-							thread_array.push_back( new std::thread( render_per_cascade, cascade_index, command_list_allocator.GetOrCreate(cascade_index), res_shadow_depth_atlas));
+							command_list_array[record_index] = command_list_allocator.GetOrCreate(record_index);
 						}
-						// 0番はカレントスレッドで実行.
-						constexpr  int cascade_index0 = 0;
-						std::invoke(render_per_cascade, cascade_index0, command_list_allocator.GetOrCreate(cascade_index0), res_shadow_depth_atlas);
-					
-						// thread完了待ち.
-						for(auto&& t : thread_array)
+						gfx::ParallelRecordChunk(p_job_system, num_record, [&](int record_index)
 						{
-							t->join();
-						}
+							render_cascade_chunk(record_index / num_chunk, chunk_array[record_index % num_chunk], command_list_array[record_index]);
+						});
 					}
 					else
 					{
@@ -351,7 +351,7 @@ namespace ngl::render::task
 						for(int cascade_index = 0; cascade_index < csm_param_.k_cascade_count; ++cascade_index)
 						{
 							// 先頭CommandListにすべてのレンダリングを実行.
-							render_per_cascade(cascade_index, command_list_allocator.GetOrCreate_Front(), res_shadow_depth_atlas);
+							render_cascade_chunk(cascade_index, chunk_array[0], command_list_allocator.GetOrCreate_Front());
 						}
 					}
 
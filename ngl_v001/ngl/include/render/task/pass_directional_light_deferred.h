@@ -238,6 +238,22 @@ namespace ngl::render::task
 
 						lighting_cbh->buffer.Unmap();
 					}
+
+					// Diffuse IBLの放射照度SH定数バッファ.
+					struct CbSkyIrradianceSh
+					{
+						math::Vec4 sh_coef[gfx::Sh9Rgb::k_num_coef];
+					};
+					auto sky_sh_cbh = gfx_commandlist->GetDevice()->GetConstantBufferPool()->Alloc(sizeof(CbSkyIrradianceSh));
+					if(auto* p_mapped = sky_sh_cbh->buffer.MapAs<CbSkyIrradianceSh>())
+					{
+						for(u32 i = 0; i < gfx::Sh9Rgb::k_num_coef; ++i)
+						{
+							const auto& coef = skybox_proxy->ibl_diffuse_irradiance_sh_.coef[i];
+							p_mapped->sh_coef[i] = math::Vec4(coef.x, coef.y, coef.z, 0.0f);
+						}
+						sky_sh_cbh->buffer.Unmap();
+					}
 					
 					// Viewport.
 					gfx::helper::SetFullscreenViewportAndScissor(gfx_commandlist, res_light.tex_->GetWidth(), res_light.tex_->GetHeight());
@@ -254,6 +270,7 @@ namespace ngl::render::task
 					pso_->SetView(&desc_set, "cb_ngl_sceneview", &desc_.scene_cbv->cbv);
 					pso_->SetView(&desc_set, "cb_ngl_shadowview", &desc_.ref_shadow_cbv->cbv);
 					pso_->SetView(&desc_set, "cb_ngl_lighting_pass", &lighting_cbh->cbv);
+					pso_->SetView(&desc_set, "cb_ngl_sky_irradiance_sh", &sky_sh_cbh->cbv);
 						
 					pso_->SetView(&desc_set, "tex_lineardepth", res_linear_depth.srv_.Get());
 					pso_->SetView(&desc_set, "tex_gbuffer0", res_gb0.srv_.Get());
@@ -267,7 +284,6 @@ namespace ngl::render::task
 					pso_->SetView(&desc_set, "tex_ssao", srv_ssao.Get());
 					pso_->SetView(&desc_set, "tex_bent_normal", srv_bent_normal.Get());
 
-					pso_->SetView(&desc_set, "tex_ibl_diffuse", skybox_proxy->ibl_diffuse_cubemap_plane_array_srv_.Get());
 					pso_->SetView(&desc_set, "tex_ibl_specular", skybox_proxy->ibl_ggx_specular_cubemap_plane_array_srv_.Get());
 					pso_->SetView(&desc_set, "tex_ibl_dfg", skybox_proxy->ibl_ggx_dfg_lut_srv_.Get());
 
@@ -34,6 +34,8 @@ namespace ngl::render::task
 			
 			fwk::GfxScene* gfx_scene{};
 			const std::vector<fwk::GfxSceneEntityId>* p_mesh_proxy_id_array{};
+
+			gfx::DrawSplitDesc draw_split{};// Mesh描画のCommandList分割.
 		} desc_{};
 		bool is_render_skip_debug_{};
 		
@@ -93,7 +95,8 @@ namespace ngl::render::task
 					}
 					command_list_allocator.Alloc(1);
 					auto gfx_commandlist = command_list_allocator.GetOrCreate(0);
-					NGL_RHI_GPU_SCOPED_EVENT_MARKER(gfx_commandlist, "GBuffer");
+					// Mesh描画は複数CommandListに分割される場合があるため, Markerは先頭と末尾のCommandListへ直接Pushする.
+					gfx_commandlist->BeginMarker("GBuffer");
 			
 					// ハンドルからリソース取得. 必要なBarrierコマンドは外部で発行済である.
 					auto res_depth = builder.GetAllocatedResource(this, h_depth_);
@@ -119,17 +122,21 @@ namespace ngl::render::task
 						res_velocity.rtv_.Get(),
 					};
 			
-					// Set RenderTarget.
-					gfx_commandlist->SetRenderTargets(p_targets, (int)std::size(p_targets), res_depth.dsv_.Get());
-					// Set Viewport and Scissor.
-					ngl::gfx::helper::SetFullscreenViewportAndScissor(gfx_commandlist, res_depth.tex_->GetWidth(), res_depth.tex_->GetHeight());
-
 					// Mesh Rendering.
 					gfx::RenderMeshResource render_mesh_res = {};
 					{
 						render_mesh_res.cbv_sceneview = {"cb_ngl_sceneview", &desc_.scene_cbv->cbv};
 					}
-					ngl::gfx::RenderMeshWithMaterial(*gfx_commandlist, gfx::MaterialPassPsoCreator_gbuffer::k_name, desc_.gfx_scene, *desc_.p_mesh_proxy_id_array, render_mesh_res);
+					ngl::gfx::RenderMeshWithMaterialParallel(command_list_allocator, 0, builder.GetExecuteJobSystem(), desc_.draw_split,
+						gfx::MaterialPassPsoCreator_gbuffer::k_name, desc_.gfx_scene, *desc_.p_mesh_proxy_id_array, render_mesh_res,
+						[&p_targets, &res_depth](rhi::GraphicsCommandListDep* chunk_commandlist, int chunk_index)
+						{
+							// CommandList毎にRenderTargetとViewportを設定.
+							chunk_commandlist->SetRenderTargets(p_targets, (int)std::size(p_targets), res_depth.dsv_.Get());
+							ngl::gfx::helper::SetFullscreenViewportAndScissor(chunk_commandlist, res_depth.tex_->GetWidth(), res_depth.tex_->GetHeight());
+						});
+
+					command_list_allocator.GetOrCreate_Back()->EndMarker();
 				}
 			);
 		}
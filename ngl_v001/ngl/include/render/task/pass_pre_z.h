@@ -31,6 +31,8 @@ namespace ngl::render::task
 
             fwk::GfxScene* gfx_scene{};
             const std::vector<fwk::GfxSceneEntityId>* p_mesh_proxy_id_array{};
+
+            gfx::DrawSplitDesc draw_split{};// Mesh描画のCommandList分割.
         } desc_{};
         bool is_render_skip_debug_{};
 			
@@ -55,20 +57,28 @@ namespace ngl::render::task
                     }
                     command_list_allocator.Alloc(1);
                     auto* commandlist = command_list_allocator.GetOrCreate(0);
-                    NGL_RHI_GPU_SCOPED_EVENT_MARKER(commandlist, "DepthPass");
+                    // Mesh描画は複数CommandListに分割される場合があるため, Markerは先頭と末尾のCommandListへ直接Pushする.
+                    commandlist->BeginMarker("DepthPass");
 						
                     auto res_depth = builder.GetAllocatedResource(this, h_depth_);
                     assert(res_depth.tex_.IsValid() && res_depth.dsv_.IsValid());
 
                     commandlist->ClearDepthTarget(res_depth.dsv_.Get(), 0.0f, 0, true, true);// とりあえずクリアだけ.ReverseZなので0クリア.
-                    commandlist->SetRenderTargets(nullptr, 0, res_depth.dsv_.Get());
-                    ngl::gfx::helper::SetFullscreenViewportAndScissor(commandlist, res_depth.tex_->GetWidth(), res_depth.tex_->GetHeight());
                     gfx::RenderMeshResource render_mesh_res = {};
                     {
                         render_mesh_res.cbv_sceneview = {"cb_ngl_sceneview", &desc_.scene_cbv->cbv};
                     }
                     
-                    ngl::gfx::RenderMeshWithMaterial(*commandlist, gfx::MaterialPassPsoCreator_depth::k_name, desc_.gfx_scene, *desc_.p_mesh_proxy_id_array, render_mesh_res);
+                    // 先頭チャンクはクリアと同じCommandListへ続けて記録.
+                    ngl::gfx::RenderMeshWithMaterialParallel(command_list_allocator, 0, builder.GetExecuteJobSystem(), desc_.draw_split,
+                        gfx::MaterialPassPsoCreator_depth::k_name, desc_.gfx_scene, *desc_.p_mesh_proxy_id_array, render_mesh_res,
+                        [&res_depth](rhi::GraphicsCommandListDep* chunk_commandlist, int chunk_index)
+                        {
+                            chunk_commandlist->SetRenderTargets(nullptr, 0, res_depth.dsv_.Get());
+                            ngl::gfx::helper::SetFullscreenViewportAndScissor(chunk_commandlist, res_depth.tex_->GetWidth(), res_depth.tex_->GetHeight());
+                        });
+
+                    command_list_allocator.GetOrCreate_Back()->EndMarker();
                 });
         }
     };
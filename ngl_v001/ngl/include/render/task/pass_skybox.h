@@ -132,6 +132,7 @@ namespace ngl::render::task
                     
                     rhi::ShaderResourceViewDep* cube_srv = skybox_proxy->src_cubemap_plane_array_srv_.Get();
                     bool is_panorama_mode = true;
+                    bool is_irradiance_sh_mode = false;
                     if (EDebugMode::SrcCubemap == setup_desc_.debug_mode)
                     {
                         cube_srv = skybox_proxy->src_cubemap_plane_array_srv_.Get();
@@ -139,8 +140,9 @@ namespace ngl::render::task
                     }
                     else if (EDebugMode::IblDiffuse == setup_desc_.debug_mode)
                     {
-                        cube_srv = skybox_proxy->ibl_diffuse_cubemap_plane_array_srv_.Get();
+                        // Diffuse IBLはCubemapではなく放射照度SHを評価して表示.
                         is_panorama_mode = false;
+                        is_irradiance_sh_mode = true;
                     }
                     else if (EDebugMode::IblSpecular == setup_desc_.debug_mode)
                     {
@@ -153,6 +155,8 @@ namespace ngl::render::task
                         float	exposure;
                         u32     panorama_mode;
                         float   debug_mip_bias;
+                        u32     irradiance_sh_mode;
+                        math::Vec4 irradiance_sh[gfx::Sh9Rgb::k_num_coef];
                     };
                     auto cbh = p_cb_pool->Alloc(sizeof(CbSkyBox));
                     if (auto map_ptr = cbh->buffer.MapAs<CbSkyBox>())
@@ -160,6 +164,12 @@ namespace ngl::render::task
                         map_ptr->exposure = 1.0f;
                         map_ptr->panorama_mode = is_panorama_mode;;
                         map_ptr->debug_mip_bias = setup_desc_.debug_mip_bias;
+                        map_ptr->irradiance_sh_mode = is_irradiance_sh_mode;
+                        for (u32 i = 0; i < gfx::Sh9Rgb::k_num_coef; ++i)
+                        {
+                            const auto& coef = skybox_proxy->ibl_diffuse_irradiance_sh_.coef[i];
+                            map_ptr->irradiance_sh[i] = math::Vec4(coef.x, coef.y, coef.z, 0.0f);
+                        }
                         
                         cbh->buffer.Unmap();
                     }
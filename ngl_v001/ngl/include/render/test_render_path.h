@@ -112,7 +112,9 @@ namespace ngl::test
 
         // デバッグ用設定.
         bool debug_multithread_render_pass       = true;
+        bool debug_multithread_setup_pass        = true;
         bool debug_multithread_cascade_shadow    = true;
+        int  debug_mesh_pass_max_split           = 4;// Mesh描画Pass (PreZ, GBuffer, Shadow) のCommandList分割数上限. 1以下で分割無し.
         bool debugview_halfdot_gray              = false;
         bool debugview_enable_feedback_blur_test = false;
         bool debugview_subview_result            = false;
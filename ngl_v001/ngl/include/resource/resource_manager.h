@@ -13,6 +13,7 @@
 #include "math/math.h"
 #include "util/noncopyable.h"
 #include "util/singleton.h"
+#include "util/time/profiler.h"
 
 #include "rhi/d3d12/device.d3d12.h"
 
@@ -127,6 +128,7 @@ namespace res
 	template<typename RES_TYPE>
 	ResourceHandle<RES_TYPE> ResourceManager::LoadResource(rhi::DeviceDep* p_device, const char* filename, typename RES_TYPE::LoadDesc* p_desc)
 	{
+		NGL_PROFILE_SCOPE("ResourceManager::LoadResource");
 		// 登録済みか検索.
 		auto exist_handle = FindHandle(RES_TYPE::k_resource_type_name, filename);
 		if (exist_handle.get())
@@ -143,10 +145,13 @@ namespace res
 
 
 		// Resourceタイプ別のロード処理.
-		if (!LoadResourceImpl(p_device, p_res, p_desc))
 		{
-			delete p_res;
-			return {};
+			NGL_PROFILE_SCOPE_DYNAMIC(filename);
+			if (!LoadResourceImpl(p_device, p_res, p_desc))
+			{
+				delete p_res;
+				return {};
+			}
 		}
 
 		// Handle生成.
@@ -0,0 +1,75 @@
+﻿#pragma once
+
+// bindless_descriptor_index_allocator.h
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "util/types.h"
+
+
+namespace ngl
+{
+namespace rhi
+{
+	// Bindless用Descriptor配列のインデックス管理. デバイス非依存.
+	//	確保したインデックスは解放されるまで不変. 解放はGPUが参照し得るフレームの完了後に再利用可能となる.
+	//	先頭の num_reserved 個は固定用途(デフォルトDescriptor等)として確保対象外とする.
+	class BindlessDescriptorIndexAllocator
+	{
+	public:
+		static constexpr u32 k_invalid_index = ~u32(0);
+
+		struct Statistics
+		{
+			u32		capacity = 0;
+			u32		num_allocated = 0;
+			u32		num_pending_free = 0;
+			u32		peak_allocated = 0;
+			u64		num_allocate_failed = 0;
+		};
+
+		BindlessDescriptorIndexAllocator();
+		~BindlessDescriptorIndexAllocator();
+
+		bool Initialize(u32 capacity, u32 num_reserved = 0);
+		void Finalize();
+
+		// 確保. 空きが無い場合は k_invalid_index.
+		u32 Allocate();
+		// 解放依頼. frame_index のフレームまでGPUから参照され得るとして, その完了後に再利用する.
+		void Free(u32 index, u64 frame_index);
+		// 完了フレームまでの解放依頼を再利用可能にする.
+		void ReadyToNewFrame(u64 completed_frame_index);
+
+		bool IsAllocated(u32 index) const;
+		u32 GetCapacity() const { return capacity_; }
+		Statistics GetStatistics() const;
+
+	private:
+		struct PendingFree
+		{
+			u64		frame_index = 0;
+			u32		index = 0;
+		};
+
+		mutable std::mutex		mutex_;
+
+		u32						capacity_ = 0;
+		u32						num_reserved_ = 0;
+		// 未使用領域の先頭. これ以降は一度も確保されていない.
+		u32						next_unused_ = 0;
+		std::vector<u32>		free_list_;
+		std::deque<PendingFree>	pending_free_;
+		std::vector<u8>			allocated_flag_;
+
+		u32						num_allocated_ = 0;
+		u32						peak_allocated_ = 0;
+		u64						num_allocate_failed_ = 0;
+	};
+
+	// インデックスの安定性, 遅延再利用, 容量超過のテスト.
+	void TestBindlessDescriptorIndexAllocator();
+}
+}
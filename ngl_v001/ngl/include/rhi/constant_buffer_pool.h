@@ -35,7 +35,9 @@ namespace rhi {
 
         void Initialize(rhi::DeviceDep* p_device);
         void Finalize();
-        void ReadyToNewFrame();
+        // frame_index : 新しいフレームのインデックス. completed_frame_index : GPUが処理を完了したフレームインデックス.
+        //  返却されたアイテムは返却時のフレームのGPU処理が完了してからPoolへ戻す.
+        void ReadyToNewFrame(u64 frame_index, u64 completed_frame_index);
 
     public:
         ConstantBufferPooledHandle Alloc(int byte_size);
@@ -7,6 +7,7 @@
 
 #include "rhi/rhi.h"
 #include "rhi/rhi_object_garbage_collect.h"
+#include "rhi/descriptor_table_cache.h"
 
 #include "rhi/d3d12/rhi_util.d3d12.h"
 #include "descriptor.d3d12.h"
@@ -105,6 +106,8 @@ namespace ngl
 		class GraphicsPipelineStateDep;
 		class ComputePipelineStateDep;
 
+		class RhiCommandStream;
+
 
 		class CommandListBaseDep : public RhiObjectBase
 		{
@@ -130,6 +133,8 @@ namespace ngl
 			void SetPipelineState(ComputePipelineStateDep* p_pso);
 			// Graphics/Compute共通のCompute用DescriptorSet設定実装.
 			void SetDescriptorSet(const ComputePipelineStateDep* p_pso, const DescriptorSetDep* p_desc_set);
+			// Graphics/Compute共通のCompute用RootConstant設定実装. シェーダが k_root_constant_register_space の cbuffer を宣言している場合のみ有効.
+			void SetRootConstant(const ComputePipelineStateDep* p_pso, const void* p_data, u32 byte_size);
 			
 			void Dispatch(u32 x, u32 y, u32 z);
 			void DispatchIndirect(BufferDep* p_arg_buffer);
@@ -142,6 +147,13 @@ namespace ngl
 				UINT num_postbuild_info_descs = 0,
 				const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC* p_postbuild_info_descs = nullptr);
 
+			// DXR: AccelerationStructure のコピー. コンパクション等に利用.
+			// ペンディングバリアを内部で自動フラッシュしてから実行する.
+			void CopyRaytracingAccelerationStructure(
+				D3D12_GPU_VIRTUAL_ADDRESS dst,
+				D3D12_GPU_VIRTUAL_ADDRESS src,
+				D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE mode);
+
 			// DXR: DispatchRays コマンドを発行.
 			// ペンディングバリアを内部で自動フラッシュしてから実行する.
 			void DispatchRays(const D3D12_DISPATCH_RAYS_DESC* p_desc);
@@ -151,10 +163,22 @@ namespace ngl
 			// ペンディングバリアを内部で自動フラッシュしてから実行する.
 			void CopyResource(const BufferDep* p_dst, const BufferDep* p_src);
 
+			// Buffer の指定範囲を別の Buffer へコピー.
+			// ペンディングバリアを内部で自動フラッシュしてから実行する.
+			void CopyBufferRegion(const BufferDep* p_dst, u64 dst_offset, const BufferDep* p_src, u64 src_offset, u64 byte_size);
+
 			// Upload Buffer のサブリソースデータを Texture の指定サブリソースへコピー.
 			// ペンディングバリアを内部で自動フラッシュしてから実行する.
 			void CopyTextureRegion(const TextureDep* p_dst, int dst_subresource, const BufferDep* p_src_buffer, const TextureSubresourceLayoutInfo& src_layout);
 
+			// Texture の指定サブリソースを Readback Buffer 上の dst_layout に従う位置へコピー. CopyTextureRegion の逆方向.
+			// ペンディングバリアを内部で自動フラッシュしてから実行する.
+			void CopyTextureToBufferRegion(const BufferDep* p_dst_buffer, const TextureSubresourceLayoutInfo& dst_layout, const TextureDep* p_src, int src_subresource);
+
+			// Texture の指定サブリソースを別の Texture の指定サブリソースへコピー. サブリソースのサイズとフォーマットは一致している必要がある.
+			// ペンディングバリアを内部で自動フラッシュしてから実行する.
+			void CopyTextureSubresource(const TextureDep* p_dst, int dst_subresource, const TextureDep* p_src, int src_subresource);
+
 			// UAV同期Barrier.
 			void ResourceUavBarrier(TextureDep* p_texture);
 			// UAV同期Barrier.
@@ -172,6 +196,17 @@ namespace ngl
 
 			DeviceDep* GetDevice() { return parent_device_; }
 			const Desc& GetDesc() const {return desc_;}
+
+			// コマンド記録先. DeviceのRhiCommandCaptureがキャプチャ中の場合にBeginで設定される.
+			RhiCommandStream* GetRecordStream() const { return p_record_stream_; }
+			// QueueへのSubmit時に解除される.
+			void ClearRecordStream() { p_record_stream_ = nullptr; }
+
+			// 冗長設定省略のために保持しているRootSignature, DescriptorHeap, RootDescriptorTableの設定状態を破棄する.
+			// 生のD3D12インターフェースでこれらを変更した場合は, 以降のSetDescriptorSetの前に呼び出すこと.
+			void InvalidateDescriptorBindingState();
+			// 記録中のDescriptorテーブルキャッシュ統計. EndでDeviceへ加算してリセットされる.
+			const DescriptorTableCache::Statistics& GetDescriptorTableCacheStatistics() const { return descriptor_table_cache_.GetStatistics(); }
 			
 		public:
 			// CommandListの標準Interfaceを取得.
@@ -315,16 +350,47 @@ namespace ngl
 				return p_command_list_.Get();
 			}
 			
+		protected:
+			// SetDescriptorSetでの1テーブル分の設定要求.
+			struct DescriptorTableRequest
+			{
+				u32	count = 0;
+				const D3D12_CPU_DESCRIPTOR_HANDLE* p_src_handle = nullptr;
+				int	table_index = -1;
+			};
+			// SamplerテーブルのFrameDescriptorを確保し, DescriptorHeapをCommandListへ設定してからテーブルを設定する.
+			//	Pageが切り替わるとHeapが変わるため, Heap設定を伴うこちらを先に実行する.
+			void CommitSamplerDescriptorTable(bool is_compute, const DescriptorTableRequest* p_request, u32 num_request);
+			// CbvSrvUavテーブルの設定. CommitSamplerDescriptorTableの後に呼び出す.
+			void CommitViewDescriptorTable(bool is_compute, const DescriptorTableRequest& request);
+			// Bindless SRV配列テーブルの設定. DeviceのBindless領域全体を指す.
+			void CommitBindlessDescriptorTable(bool is_compute, int table_index);
+			// RootConstantの設定. 範囲外の値は0.
+			void SetRootConstantImpl(bool is_compute, const void* p_pso, int param_index, u32 num_constant, const void* p_data, u32 byte_size);
+			// 直前と同じDescriptor範囲であれば設定を省略する.
+			void SetRootDescriptorTable(bool is_compute, int table_index, D3D12_GPU_DESCRIPTOR_HANDLE handle);
+			// RootSignature設定でRootDescriptorTableは未定義になるため設定状態を破棄.
+			void InvalidateRootDescriptorTableState(bool is_compute);
+
 		protected:
 			DeviceDep* parent_device_	= nullptr;
 			Desc		desc_ = {};
 			bool		is_open_ = false;// Begin,Closeの状態を保持.
+			RhiCommandStream*	p_record_stream_ = nullptr;
 
 			// Cvb Srv Uav用.
 			FrameCommandListDynamicDescriptorAllocatorInterface	frame_desc_interface_ = {};
 			// Sampler用.
 			FrameDescriptorHeapPageInterface	frame_desc_page_interface_for_sampler_ = {};
 
+			// 同一内容のDescriptorテーブルのコピーを省略するためのキャッシュ. Begin毎にリセット.
+			DescriptorTableCache	descriptor_table_cache_ = {};
+			// 設定済みのDescriptorHeap. [0]:CbvSrvUav, [1]:Sampler.
+			ID3D12DescriptorHeap*	bound_descriptor_heap_[2] = {};
+			// 設定済みのRootDescriptorTableのGPUハンドル. [0]:Graphics, [1]:Compute. 0は未設定.
+			static constexpr u32	k_max_tracked_root_table = 32;
+			u64						bound_root_table_[2][k_max_tracked_root_table] = {};
+
 			Microsoft::WRL::ComPtr<ID3D12CommandAllocator>		p_command_allocator_;
 
 			Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>	p_command_list_;
@@ -393,6 +459,26 @@ namespace ngl
 		public:
 			// 使用可能な機能はBほとんどBaseで実装.
 		};
+		// Copy CommandList. Copy Queue で実行するアップロード用.
+		// Copy Queue ではBarrierを記録できないため, コピー先は Common ステートのリソースとする (Copy Dst への暗黙の昇格と実行後のCommonへの減衰を利用).
+		class CopyCommandListDep : public CommandListBaseDep
+		{
+		public:
+			CopyCommandListDep() = default;
+			~CopyCommandListDep() = default;
+
+			bool Initialize(DeviceDep* p_device);
+		};
+		// Graphics Queue で実行する Compute CommandList.
+		// Compute用のTaskをGraphics Queueへ配置する場合に, Compute CommandListと同じ機能のみを公開した状態でDirectタイプとして生成する.
+		class DirectComputeCommandListDep : public ComputeCommandListDep
+		{
+		public:
+			DirectComputeCommandListDep() = default;
+			~DirectComputeCommandListDep() = default;
+
+			bool Initialize(DeviceDep* p_device);
+		};
 		
 		// Graphics CommandList.
 		class GraphicsCommandListDep : public CommandListBaseDep
@@ -414,6 +500,8 @@ namespace ngl
 			void SetPipelineState(GraphicsPipelineStateDep* p_pso);
 			using CommandListBaseDep::SetDescriptorSet;
 			void SetDescriptorSet(const GraphicsPipelineStateDep* p_pso, const DescriptorSetDep* p_desc_set);
+			using CommandListBaseDep::SetRootConstant;
+			void SetRootConstant(const GraphicsPipelineStateDep* p_pso, const void* p_data, u32 byte_size);
 
 
 			void SetPrimitiveTopology(EPrimitiveTopology topology);
@@ -366,8 +366,9 @@ namespace ngl
 			bool Initialize(DeviceDep* p_device, const Desc& desc);
 			void Finalize();
 
-			// frame_index はグローバルに加算され続けるインデックスであり, Deviceから供給される.
-			void ReadyToNewFrame(u32 frame_index);
+			// completed_frame_index はGPUが処理を完了したフレームインデックスであり, Deviceから供給される.
+			//	遅延解放リクエストのうち, このフレーム以下で解放されたものを実際に解放する.
+			void ReadyToNewFrame(u64 completed_frame_index);
 
 			// 確保.
 			DynamicDescriptorAllocHandle AllocateDescriptorArray(u32 count);
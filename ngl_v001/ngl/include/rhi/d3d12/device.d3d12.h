@@ -16,12 +16,16 @@
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <mutex>
 
 #include "platform/win/window.win.h"
 
 #include "rhi/rhi.h"
 #include "rhi/rhi_object_garbage_collect.h"
 #include "rhi/constant_buffer_pool.h"
+#include "rhi/rhi_command_capture.h"
+#include "rhi/descriptor_table_cache.h"
+#include "rhi/bindless_descriptor_index_allocator.h"
 
 #include "rhi/d3d12/rhi_util.d3d12.h"
 #include "descriptor.d3d12.h"
@@ -49,6 +53,7 @@ namespace ngl
 		class ComputeCommandListDep;
 		class GraphicsCommandQueueDep;
 		class ComputeCommandQueueDep;
+		class CopyCommandQueueDep;
 
 		class DeviceDep;
 		class PipelineStateObjectCacheDep;
@@ -85,6 +90,11 @@ namespace ngl
 				u32		pipeline_state_cache_compute_capacity = 512;
 				// Enhanced Barrierサポート時に利用を要求するか.(非サポート時はLegacyにフォールバック)
 				bool	require_enhanced_barrier = true;
+				// RHIオブジェクトの遅延破棄設定.
+				GabageCollector::Desc	gabage_collector_desc = {};
+				// Bindless SRV配列を有効化するか. DynamicDescriptorManager上に固定領域を確保する. 非サポート時は無効.
+				bool	enable_bindless = false;
+				u32		bindless_descriptor_count = 65536;
 			};
 
 			DeviceDep();
@@ -145,6 +155,13 @@ namespace ngl
 			
 			// Deviceが管理するグローバルなフレームインデックスを取得.
 			u64	 GetDeviceFrameIndex() const { return frame_index_; }
+			// GPUが処理を完了したフレームインデックス. ReadyToNewFrameで更新され, 常に現在のフレームインデックス未満.
+			//	フレーム単位でバッファリングするリソース (ConstantBuffer, FrameDescriptor, CommandList等) はこれ以下のフレームで使用したものを再利用できる.
+			u64	 GetCompletedFrameIndex() const { return completed_frame_index_; }
+
+			// GPUのフレーム完了を示すFenceを設定. Appがフレーム末尾でDeviceのフレームインデックスをSignalするFence.
+			//	設定するとRHIオブジェクトの遅延破棄がGPUの完了フレームに基づくようになる. 未設定の場合は固定の2フレーム遅延.
+			void SetFrameCompletionFence(FenceDep* p_fence) { p_frame_completion_fence_ = p_fence; }
 
 		public:
 			// RHIオブジェクトガベージコレクト関連.
@@ -152,6 +169,31 @@ namespace ngl
 			// RHIオブジェクトの参照ハンドルの破棄で呼び出されるオブジェクト破棄依頼関数.
 			void DestroyRhiObject(IRhiObject* p) override;
 
+			GabageCollector& GetGabageCollector() { return gb_; }
+			const GabageCollector& GetGabageCollector() const { return gb_; }
+
+		public:
+			// コマンドキャプチャ. CommandListの記録内容をフレーム単位でデバイス非依存のストリームに記録する.
+			RhiCommandCapture& GetCommandCapture() { return command_capture_; }
+			const RhiCommandCapture& GetCommandCapture() const { return command_capture_; }
+
+		public:
+			// Descriptorテーブルキャッシュ統計. CommandListのEndで加算され, ReadyToNewFrameで前フレーム分として確定する.
+			void AddDescriptorTableCacheStatistics(const DescriptorTableCache::Statistics& v);
+			const DescriptorTableCache::Statistics& GetDescriptorTableCacheStatistics() const { return descriptor_table_cache_statistics_; }
+
+		public:
+			// Bindless. 有効な場合, DynamicDescriptorManagerのHeap上の固定領域をシェーダのBindless SRV配列とする.
+			//	インデックス0はデフォルトDescriptor.
+			bool IsBindlessEnabled() const { return bindless_enabled_; }
+			// Descriptorを固定領域へコピーし, 解放まで不変のインデックスを返す. 失敗時は BindlessDescriptorIndexAllocator::k_invalid_index.
+			u32 AllocateBindlessDescriptor(D3D12_CPU_DESCRIPTOR_HANDLE src_cpu_handle);
+			// 現在のフレームまでGPUから参照され得るとして, 完了後に再利用される.
+			void DeallocateBindlessDescriptor(u32 index);
+			// シェーダのBindless SRV配列として設定するテーブル先頭.
+			D3D12_GPU_DESCRIPTOR_HANDLE GetBindlessDescriptorTableGpuHandle() const { return bindless_gpu_handle_start_; }
+			BindlessDescriptorIndexAllocator::Statistics GetBindlessDescriptorStatistics() const { return bindless_index_allocator_.GetStatistics(); }
+
 		private:
 			Desc	desc_ = {};
 
@@ -172,6 +214,7 @@ namespace ngl
 			Microsoft::WRL::ComPtr<DXGI_FACTORY_TYPE> p_factory_;
 
 			std::atomic_uint64_t frame_index_ = 0;
+			std::atomic_uint64_t completed_frame_index_ = 0;
 
 			u32	buffer_index_ = 0;
 
@@ -189,11 +232,25 @@ namespace ngl
 
 			// RHIオブジェクトガベージコレクト.
 			GabageCollector			gb_;
+			// GPUのフレーム完了Fence. 外部所有.
+			FenceDep*				p_frame_completion_fence_ = nullptr;
 
 			// ConstantBufferPool. フレームでの返却管理などのためにDeviceに持たせている.
 			ConstantBufferPool		cb_pool_{};
 
 			std::unique_ptr<PipelineStateObjectCacheDep>	p_pipeline_state_cache_{};
+
+			RhiCommandCapture		command_capture_{};
+
+			std::mutex							descriptor_table_cache_statistics_mutex_;
+			DescriptorTableCache::Statistics	descriptor_table_cache_statistics_accum_ = {};
+			DescriptorTableCache::Statistics	descriptor_table_cache_statistics_ = {};
+
+			bool								bindless_enabled_ = false;
+			BindlessDescriptorIndexAllocator	bindless_index_allocator_;
+			DynamicDescriptorAllocHandle		bindless_descriptor_handle_ = {};
+			D3D12_CPU_DESCRIPTOR_HANDLE			bindless_cpu_handle_start_ = {};
+			D3D12_GPU_DESCRIPTOR_HANDLE			bindless_gpu_handle_start_ = {};
 		};
 
 
@@ -216,8 +273,14 @@ namespace ngl
 			virtual void ExecuteCommandLists(unsigned int num_command_list, CommandListBaseDep** p_command_lists) = 0;
 			
 			ID3D12CommandQueue* GetD3D12CommandQueue();
+		protected:
+			// Submitされたコマンドリストの記録ストリームをキャプチャに通知する.
+			void NotifyExecuteToCapture(unsigned int num_command_list, CommandListBaseDep** p_command_lists);
+
 		protected:
 			Microsoft::WRL::ComPtr<ID3D12CommandQueue> p_command_queue_;
+			// RhiCommandCapture上のQueue種別. 0:Graphics, 1:Compute, 2:Copy.
+			u8	capture_queue_type_ = 0;
 		};
 		
 		// Graphics Command Queue.
@@ -251,6 +314,21 @@ namespace ngl
 		private:
 		};
 		
+		// Copy Command Queue.
+		// リソースのアップロード用. Graphics Queueとは別に実行され, 完了はFenceで同期する.
+		class CopyCommandQueueDep : public CommandQueueBaseDep
+		{
+		public:
+			CopyCommandQueueDep();
+			~CopyCommandQueueDep();
+
+			bool Initialize(DeviceDep* p_device);
+			void Finalize();
+
+			void ExecuteCommandLists(unsigned int num_command_list, CommandListBaseDep** p_command_lists) override;
+		private:
+		};
+		
 		
 		// フェンス
 		class FenceDep : public RhiObjectBase
@@ -236,8 +236,18 @@ namespace ngl
 			{
 				return view_;
 			}
+
+			// DeviceのBindless SRV配列へ登録する. Bindless無効時は何もせずfalse. 登録はFinalizeで解除される.
+			bool RegisterBindless();
+			// Bindless SRV配列上のインデックス. 未登録の場合は k_invalid_bindless_index.
+			u32 GetBindlessIndex() const
+			{
+				return bindless_index_;
+			}
+			static constexpr u32 k_invalid_bindless_index = ~u32(0);
 		private:
 			PersistentDescriptorInfo	view_ = {};
+			u32							bindless_index_ = k_invalid_bindless_index;
 		};
 
 	}
@@ -117,6 +117,8 @@ namespace rhi
 			ResourceViewName			name;
 			ERootParameterType			type = ERootParameterType::_Max;
 			s32							bind_point = -1;
+			// register space. 固定テーブルは0.
+			u32							register_space = 0;
 
 		};
 
@@ -235,6 +237,13 @@ namespace rhi
 			s8		cs_sampler_table	= -1;
 			s8		cs_uav_table		= -1;
 
+			// 何番目のDescriptorTableがBindless SRV配列(k_bindless_srv_register_space)のテーブルか. 全ステージ共通.
+			s8		bindless_srv_table	= -1;
+			// 何番目のRootParameterがRootConstant(k_root_constant_register_space)か. 全ステージ共通.
+			s8		root_constant_param	= -1;
+			// RootConstantの32bit値数.
+			u8		root_constant_count	= 0;
+
 		};	// struct InputIndex
 
 
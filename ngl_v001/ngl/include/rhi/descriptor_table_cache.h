@@ -0,0 +1,114 @@
+﻿#pragma once
+
+// descriptor_table_cache.h
+
+#include <vector>
+
+#include "util/types.h"
+
+
+namespace ngl
+{
+namespace rhi
+{
+	struct RhiCommandCaptureResult;
+
+	// Descriptorテーブルのキャッシュ. デバイス非依存.
+	//	コピー元CPUハンドル列とヒープ種別をキーとして, コピー済みの連続Descriptor範囲を保持する.
+	//	同一内容のテーブルは既存の範囲を再利用することで, FrameDescriptorの確保とCopyDescriptorsを省略する.
+	//	CommandListのBegin毎にResetして記録中のみ有効とする. 容量を超えた場合は全破棄する.
+	class DescriptorTableCache
+	{
+	public:
+		struct Desc
+		{
+			// エントリ数上限. 2の冪に切り上げる.
+			u32		max_entry = 1024;
+			// キーとして保持するハンドル数の上限.
+			u32		max_handle = 16 * 1024;
+		};
+
+		// コピー済みの範囲.
+		struct Range
+		{
+			u64		cpu_handle = 0;
+			u64		gpu_handle = 0;
+			// 範囲が属するHeapの識別子. Heapが切り替わった場合は無効.
+			u64		heap_id = 0;
+		};
+
+		struct Statistics
+		{
+			u64		num_lookup = 0;
+			u64		num_hit = 0;
+			u64		num_flush = 0;
+			// ヒットにより省略したDescriptorコピー数.
+			u64		num_saved_descriptor = 0;
+			// 直前と同じ範囲のためRootDescriptorTableの設定を省略した数.
+			u64		num_skipped_root_set = 0;
+
+			float HitRate() const { return (0 < num_lookup) ? static_cast<float>(num_hit) / static_cast<float>(num_lookup) : 0.0f; }
+			void Add(const Statistics& v);
+		};
+
+		DescriptorTableCache();
+		~DescriptorTableCache();
+
+		void Initialize(const Desc& desc);
+		// エントリの全破棄. 統計は保持する.
+		void Reset();
+
+		static u64 ComputeHash(u32 heap_type, const u64* p_handle, u32 count);
+
+		// 検索. heap_id が異なるエントリはヒットしない.
+		bool Find(u32 heap_type, const u64* p_handle, u32 count, u64 hash, u64 heap_id, Range& out_range);
+		// 登録. 同一キーが存在する場合は範囲を上書きする.
+		void Insert(u32 heap_type, const u64* p_handle, u32 count, u64 hash, const Range& range);
+
+		// RootDescriptorTable設定省略の計上.
+		void CountSkippedRootSet() { ++statistics_.num_skipped_root_set; }
+
+		const Statistics& GetStatistics() const { return statistics_; }
+		void ResetStatistics() { statistics_ = {}; }
+		u32 NumEntry() const { return num_entry_; }
+
+	private:
+		struct Entry
+		{
+			u64		hash = 0;
+			u32		handle_offset = 0;
+			u16		count = 0;
+			u8		heap_type = 0;
+			u8		is_valid = 0;
+			Range	range = {};
+		};
+		bool IsSameKey(const Entry& e, u32 heap_type, const u64* p_handle, u32 count, u64 hash) const;
+
+	private:
+		Desc				desc_ = {};
+		// オープンアドレス法(線形探索)のテーブル.
+		std::vector<Entry>	entry_array_;
+		u32					entry_mask_ = 0;
+		u32					num_entry_ = 0;
+		// キーのハンドル列.
+		std::vector<u64>	handle_pool_;
+
+		Statistics			statistics_ = {};
+	};
+
+
+	// キャプチャしたDescriptorテーブル設定列でのキャッシュ効果の計測. デバイス非依存.
+	//	RhiCommandStream の SetDescriptorTable を順に DescriptorTableCache へ通し, CommandList単位でリセットする.
+	struct DescriptorTableCacheReplayResult
+	{
+		u64		num_table = 0;
+		u64		num_descriptor = 0;
+		DescriptorTableCache::Statistics	statistics = {};
+		double	elapsed_ms = 0.0;
+	};
+	DescriptorTableCacheReplayResult ReplayDescriptorTableCache(const RhiCommandCaptureResult& capture, const DescriptorTableCache::Desc& desc, u32 num_iteration = 1);
+
+	// DescriptorTableCacheの一致判定, 容量超過時の破棄, 模擬フレームでのヒット率のテスト.
+	void TestDescriptorTableCache();
+}
+}
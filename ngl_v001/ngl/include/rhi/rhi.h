@@ -56,6 +56,14 @@ namespace ngl
 			return type_size[static_cast<u32>(type)];
 		}
 
+		// 固定テーブルは register space0 を利用する. 以下のspaceはシェーダが宣言した場合のみRootSignatureに追加される.
+		// Bindless SRV配列のregister space. 例 Texture2D tex_array[] : register(t0, space1).
+		static const u32 k_bindless_srv_register_space = 1;
+		// RootConstantのregister space. 例 ConstantBuffer<T> cb : register(b0, space2).
+		static const u32 k_root_constant_register_space = 2;
+		// RootConstantの最大32bit値数.
+		static const u32 k_max_root_constant_count = 16;
+
 
 		template<typename T0, typename T1>
 		static constexpr bool check_bits(T0 v0, T1 v1)
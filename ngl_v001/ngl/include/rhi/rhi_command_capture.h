@@ -0,0 +1,111 @@
+﻿#pragma once
+
+// rhi_command_capture.h
+//	実デバイスのCommandListとQueueへの発行内容をフレーム単位で RhiCommandStream に記録するキャプチャ.
+//	記録はD3D12バックエンドの CommandListBaseDep と CommandQueueBaseDep から行われ, 描画自体は通常通り実行される.
+//	結果のダンプ, 比較, 保存と読み込みはデバイス非依存.
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "util/types.h"
+#include "rhi/rhi_command_stream.h"
+
+
+namespace ngl
+{
+namespace rhi
+{
+	// CommandQueue上の記録イベント.
+	struct RhiCommandQueueEvent
+	{
+		enum class EType : u8
+		{
+			Execute,	// stream_index のCommandListをSubmit.
+			Signal,
+			Wait,
+		};
+		EType	type = EType::Execute;
+		u8		queue_type = 0;		// 0:Graphics, 1:Compute, 2:Copy.
+		u32		stream_index = 0;	// Execute.
+		u64		fence = 0;			// Signal/Wait. 確定後は通し番号.
+	};
+
+	// キャプチャ結果. Submit順のストリームとQueueイベント.
+	struct RhiCommandCaptureResult
+	{
+		bool	is_valid = false;
+		u64		begin_frame_index = 0;
+		u32		num_frame = 0;
+		std::vector<std::unique_ptr<RhiCommandStream>>	stream_array;
+		std::vector<RhiCommandQueueEvent>				queue_event_array;
+		RhiCommandStreamStatistics						statistics = {};
+		u32		num_object = 0;		// 参照された異なるオブジェクトの数.
+
+		void Reset();
+	};
+
+	void DumpRhiCommandCapture(const RhiCommandCaptureResult& result, std::ostream& os);
+	// Submit順にストリームとQueueイベントを比較する. 差異があれば out_stream_index と out_diff に最初の差異.
+	bool CompareRhiCommandCapture(const RhiCommandCaptureResult& a, const RhiCommandCaptureResult& b, u32& out_stream_index, RhiCommandStreamDiff& out_diff);
+	// バイナリ保存と読み込み. 回帰比較用.
+	bool SaveRhiCommandCapture(const RhiCommandCaptureResult& result, const char* file_path);
+	bool LoadRhiCommandCapture(const char* file_path, RhiCommandCaptureResult& out_result);
+
+
+	// フレーム単位のコマンドキャプチャ.
+	//	RequestCapture で要求すると次のフレーム開始から指定フレーム数の間, CommandListのBeginからEndまでを
+	//	RhiCommandStreamに記録し, QueueへのSubmitとSignal/Waitを順に記録する.
+	//	Submitされなかったストリームは結果に含まれない.
+	//	BeginCommandList, OnExecute, OnSignal, OnWait はRenderThreadや並列記録のWorkerから呼び出し可能.
+	//	ReadyToNewFrame はDeviceのフレーム開始同期で呼び出される.
+	class RhiCommandCapture
+	{
+	public:
+		RhiCommandCapture() = default;
+		~RhiCommandCapture() = default;
+
+		void RequestCapture(u32 num_frame = 1);
+		bool IsCapturing() const { return is_capturing_.load(std::memory_order_relaxed); }
+
+		// フレーム開始同期. キャプチャの開始と確定.
+		void ReadyToNewFrame(u64 frame_index);
+
+		// CommandListのBeginで記録先を取得. キャプチャ中でなければnullptr.
+		RhiCommandStream* BeginCommandList();
+		void OnExecute(u8 queue_type, const RhiCommandStream* p_stream);
+		void OnSignal(u8 queue_type, const void* p_fence);
+		void OnWait(u8 queue_type, const void* p_fence);
+
+		// 最後に確定したキャプチャ結果. ReadyToNewFrameで更新されるためメインスレッドから参照すること.
+		const RhiCommandCaptureResult& GetLatestResult() const { return latest_result_; }
+		u32 NumCapturedResult() const { return num_captured_result_; }
+
+	private:
+		void FinishCapture();
+
+	private:
+		std::atomic_bool	is_capturing_ = false;
+		u32					request_num_frame_ = 0;
+		u32					remain_num_frame_ = 0;
+
+		std::mutex			mutex_;
+		// 記録中のストリーム. Begin順.
+		std::vector<std::unique_ptr<RhiCommandStream>>	recording_stream_array_;
+		std::unordered_map<const RhiCommandStream*, u32>	stream_submit_index_;
+		RhiCommandCaptureResult		recording_result_;
+		// 確定時にSubmitされていなかったストリーム. CommandListが保持している可能性があるため次の確定まで解放を遅延する.
+		std::vector<std::unique_ptr<RhiCommandStream>>	retired_stream_array_;
+
+		RhiCommandCaptureResult		latest_result_;
+		u32							num_captured_result_ = 0;
+	};
+
+	// ストリームの記録と比較, 通し番号への置き換え, キャプチャのフレーム区切りとSubmit順, 保存と読み込みのテスト.
+	void TestRhiCommandCapture();
+}
+}
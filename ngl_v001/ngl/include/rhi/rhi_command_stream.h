@@ -0,0 +1,192 @@
+﻿#pragma once
+
+// rhi_command_stream.h
+//	CommandList 1つ分のコマンド列の記録形式. デバイス非依存.
+//	フレーム単位のキャプチャは rhi_command_capture.h.
+
+#include <array>
+#include <initializer_list>
+#include <ostream>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "util/types.h"
+
+
+namespace ngl
+{
+namespace rhi
+{
+	// 記録するコマンド種別.
+	enum class ERhiCommandOp : u8
+	{
+		Begin,
+		End,
+
+		SetGraphicsPipelineState,
+		SetComputePipelineState,
+		SetGraphicsDescriptorSet,
+		SetComputeDescriptorSet,
+		SetDescriptorTable,
+		SetRootConstant,
+		SetRenderTargets,
+		SetViewports,
+		SetScissor,
+		SetPrimitiveTopology,
+		SetVertexBuffers,
+		SetIndexBuffer,
+
+		DrawInstanced,
+		DrawIndexedInstanced,
+		DrawIndirect,
+		Dispatch,
+		DispatchIndirect,
+		DispatchRays,
+		BuildAccelerationStructure,
+		CopyAccelerationStructure,
+
+		CopyResource,
+		CopyBufferRegion,
+		CopyTextureRegion,
+
+		ClearRenderTarget,
+		ClearDepthTarget,
+
+		ResourceBarrier,
+		UavBarrier,
+
+		BeginMarker,
+		EndMarker,
+
+		_Max
+	};
+	static constexpr u32 k_rhi_command_op_count = static_cast<u32>(ERhiCommandOp::_Max);
+
+	const char* GetRhiCommandOpName(ERhiCommandOp op);
+
+	// SetDescriptorTable のパラメータ. 参照オブジェクトはテーブルのコピー元CPUハンドル列.
+	struct RhiCommandSetDescriptorTableParam
+	{
+		u32	root_parameter_index = 0;
+		u8	heap_type = 0;		// 0:CBV_SRV_UAV, 1:Sampler.
+		u8	is_compute = 0;
+		u16	padding = 0;
+	};
+
+
+	// コマンド種別毎の記録数.
+	struct RhiCommandStreamStatistics
+	{
+		std::array<u32, k_rhi_command_op_count> num_command = {};
+		u64	byte_size = 0;
+
+		u32 NumCommand(ERhiCommandOp op) const { return num_command[static_cast<u32>(op)]; }
+		u32 NumTotalCommand() const;
+		u32 NumDraw() const;
+		u32 NumDispatch() const;
+		u32 NumBarrier() const;
+		u32 NumCopy() const;
+		u32 NumPipelineStateChange() const;
+
+		void Add(const RhiCommandStreamStatistics& v);
+	};
+
+	// CommandList 1つ分のコマンドを詰めて記録するストリーム. デバイス非依存.
+	//	1コマンドは ヘッダ(4byte), 参照オブジェクト(u64 x num_object), パラメータ(4byte境界) の可変長.
+	//	参照オブジェクトは記録時はポインタ値で, RhiCommandCapture の確定時に出現順の通し番号へ置き換えられる.
+	//	これにより実行毎にアドレスが変わっても同じコマンド列であればバイト列が一致し, 回帰比較に利用できる.
+	class RhiCommandStream
+	{
+	public:
+		struct CommandHeader
+		{
+			u8	op = 0;
+			u8	num_object = 0;
+			u16	param_size = 0;	// パラメータ部のバイトサイズ (4byte境界).
+		};
+		// 読み出し時のコマンド.
+		struct CommandView
+		{
+			ERhiCommandOp	op = ERhiCommandOp::_Max;
+			u32				num_object = 0;
+			const u8*		p_object = nullptr;	// u64 x num_object. memcpyで読み出すこと.
+			u32				param_size = 0;
+			const u8*		p_param = nullptr;
+
+			u64 GetObject(u32 index) const;
+		};
+		static constexpr u32 k_max_param_size = 0xfffc;
+
+		RhiCommandStream() = default;
+
+		void Reset();
+
+		// 記録.
+		void Write(ERhiCommandOp op, const void* const* pp_object, u32 num_object, const void* p_param, u32 param_size);
+		void Write(ERhiCommandOp op)
+		{
+			Write(op, nullptr, 0, nullptr, 0);
+		}
+		template<typename T>
+		void Write(ERhiCommandOp op, std::initializer_list<const void*> object_list, const T& param)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			Write(op, object_list.begin(), static_cast<u32>(object_list.size()), &param, sizeof(T));
+		}
+		void Write(ERhiCommandOp op, std::initializer_list<const void*> object_list)
+		{
+			Write(op, object_list.begin(), static_cast<u32>(object_list.size()), nullptr, 0);
+		}
+		// 文字列パラメータ (Marker等).
+		void WriteString(ERhiCommandOp op, const char* str);
+
+		// 読み出し. func(const CommandView&).
+		template<typename FUNC>
+		void ForEach(FUNC&& func) const
+		{
+			size_t pos = 0;
+			while (pos + sizeof(CommandHeader) <= data_.size())
+			{
+				CommandView view = {};
+				pos = ReadCommand(pos, view);
+				func(view);
+			}
+		}
+
+		// 参照オブジェクトのポインタ値を通し番号に置き換える. table は複数ストリームで共有して同一オブジェクトを同じ番号にする.
+		void RemapObject(std::unordered_map<u64, u32>& table);
+		bool IsRemapped() const { return is_remapped_; }
+
+		const std::vector<u8>& GetData() const { return data_; }
+		u32 NumCommand() const { return num_command_; }
+		const RhiCommandStreamStatistics& GetStatistics() const { return statistics_; }
+
+		// シリアライズ済みデータから復元.
+		bool SetData(const u8* p_data, size_t size, bool is_remapped);
+
+	private:
+		size_t ReadCommand(size_t pos, CommandView& out_view) const;
+
+	private:
+		std::vector<u8>				data_;
+		u32							num_command_ = 0;
+		RhiCommandStreamStatistics	statistics_ = {};
+		bool						is_remapped_ = false;
+	};
+
+	// テキストダンプ. 差分ツールでの比較用.
+	void DumpRhiCommandStream(const RhiCommandStream& stream, std::ostream& os);
+
+	// 2つのストリームの比較結果.
+	struct RhiCommandStreamDiff
+	{
+		bool	is_equal = true;
+		// 最初に差異のあったコマンド番号. 一方が短い場合は短い側のコマンド数.
+		u32		command_index = 0;
+		ERhiCommandOp	op_a = ERhiCommandOp::_Max;
+		ERhiCommandOp	op_b = ERhiCommandOp::_Max;
+	};
+	RhiCommandStreamDiff CompareRhiCommandStream(const RhiCommandStream& a, const RhiCommandStream& b);
+}
+}
@@ -3,7 +3,11 @@
 // rhi_object_garbage_collect.h
 
 #include <atomic>
-#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "rhi/rhi_ref.h"
 
@@ -41,30 +45,88 @@ namespace rhi
 
 
 	// RHIオブジェクトを安全なタイミングまで遅延してから破棄をするためのクラス.
-	// 参照管理オブジェクトの破棄からDevice経由でPushされ, フレーム同期を挟んで2フレーム後に実際の破棄をする
-	//	(2フレームは GameThread->RenderThread->GPU という構成での最大を考慮)
+	//	参照管理オブジェクトの破棄からDevice経由で任意スレッドからEnqueueされる (Lock-Free Stackへの Push のみ).
+	//	フレーム開始同期で受付済みのオブジェクトに "参照し得る最後のフレーム番号" を付与して破棄待ちキューへ移し,
+	//	GPUの完了フレーム番号がそれに到達したものから破棄する.
+	//	1フレームの破棄数と時間には上限を設定でき, 超過分は次フレーム以降に持ち越す.
+	//	完了フレーム番号の供給元が無い場合は従来通り2フレーム遅延 (GameThread->RenderThread->GPU という構成での最大) とする.
 	class GabageCollector
 	{
 	public:
+		struct Desc
+		{
+			// 1フレームで破棄する最大数. 0で無制限.
+			u32		max_destroy_count_per_frame = 4096;
+			// 1フレームの破棄処理の最大時間(マイクロ秒). 0で無制限. バックグラウンド破棄時は無効.
+			u32		max_destroy_micro_sec_per_frame = 0;
+			// 破棄処理(delete)をバックグラウンドスレッドで実行する.
+			//	破棄されるオブジェクトのデストラクタがスレッドセーフである必要がある (Descriptorの解放等は排他されている).
+			bool	enable_background_destroy = false;
+		};
+
+		// フレーム毎の統計.
+		struct Statistics
+		{
+			u32		num_enqueued = 0;		// 前回のReadyToNewFrameからの受付数.
+			u32		num_destroyed = 0;		// 前回のExecuteでの破棄数 (バックグラウンド破棄時は依頼数).
+			u32		num_pending = 0;		// 破棄待ち数.
+			u32		num_deferred = 0;		// GPU完了済みだが上限により持ち越された数.
+		};
+
 		GabageCollector();
 		~GabageCollector();
 
-		bool Initialize();
+		bool Initialize(const Desc& desc);
+		// 全オブジェクトを即時破棄する. GPUの処理完了を待機してから呼び出すこと.
 		void Finalize();
 
 		// フレーム開始同期処理.
-		void ReadyToNewFrame();
+		//	retire_frame_index はここまでにEnqueueされたオブジェクトを参照し得る最後のフレーム番号.
+		void ReadyToNewFrame(u64 retire_frame_index);
 
 		// 破棄の実行.
-		void Execute();
+		//	completed_frame_index はGPUが処理を完了したフレーム番号. この番号以下を付与されたオブジェクトを破棄する.
+		void Execute(u64 completed_frame_index);
 
-		// 新規破棄オブジェクトのPush.
+		// 新規破棄オブジェクトのPush. 任意スレッドから呼び出し可能.
 		void Enqueue(IRhiObject* p_obj);
 
+		const Desc& GetDesc() const { return desc_; }
+		void SetDestroyBudget(u32 max_destroy_count_per_frame, u32 max_destroy_micro_sec_per_frame);
+		const Statistics& GetStatistics() const { return statistics_; }
+
 	private:
-		std::atomic_int	flip_index_ = 0;
+		void DestroyObjectArray(std::vector<IRhiObject*>& obj_array);
+		void WaitBackgroundDestroy();
+		void BackgroundThreadFunc();
 
-		std::array<RhiObjectGabageCollectStack, 3>	frame_stack_;
+	private:
+		Desc	desc_ = {};
+
+		// 任意スレッドからの受付.
+		RhiObjectGabageCollectStack		incoming_stack_;
+
+		// 破棄待ちオブジェクト. 付与フレーム番号の昇順.
+		struct PendingObject
+		{
+			IRhiObject*	p_obj = nullptr;
+			u64			retire_frame_index = 0;
+		};
+		std::deque<PendingObject>		pending_queue_;
+		std::vector<IRhiObject*>		destroy_array_;
+
+		Statistics	statistics_ = {};
+
+		// バックグラウンド破棄.
+		std::thread					background_thread_;
+		std::mutex					background_mutex_;
+		std::condition_variable		background_cv_;
+		std::vector<IRhiObject*>	background_destroy_array_;
+		bool						background_request_ = false;
+		bool						background_terminate_ = false;
 	};
+
+	// GabageCollectorの多数スレッドからのEnqueueと破棄タイミングのテスト.
+	void TestGabageCollector();
 }
 }
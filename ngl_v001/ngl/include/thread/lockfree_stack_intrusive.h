@@ -98,6 +98,24 @@ namespace thread
 
 			return old;
 		}
+		// 全要素を一括で取り出して func(T*) を呼び出す. 戻り値は要素数.
+		// 先頭の付け替えのみの単一のexchangeで取り出すため, 複数プロデューサーのPushと並行してもABA問題は発生しない.
+		// func内での要素の破棄や再Pushは可能 (次要素は呼び出し前に取得する).
+		template<typename FUNC>
+		unsigned int PopAll(FUNC&& func)
+		{
+			// memory_order_acquire: 取り出した全要素のPush前の変更が見えることを保証.
+			T* node = top_.exchange(nullptr, std::memory_order_acquire);
+			unsigned int count = 0;
+			while (nullptr != node)
+			{
+				T* next = node->next.load(std::memory_order_relaxed);
+				func(node);
+				node = next;
+				++count;
+			}
+			return count;
+		}
 	private:
 		std::atomic<T*> top_ = nullptr;
 	};
@@ -0,0 +1,274 @@
+﻿#pragma once
+
+#ifndef _NGL_UTIL_PROFILER_
+#define _NGL_UTIL_PROFILER_
+
+/*
+	CPUプロファイラ.
+
+	スレッド毎のロックフリーリングバッファ(SPSC)にZoneの開始/終了イベントを記録し,
+	EndFrameで回収して階層付きのZoneに復元する.
+		- Zone毎のフレーム単位の合計時間を集計し, 直近フレームのmin/avg/maxを取得できる.
+		- キャプチャ中のZoneはChrome Trace JSON (chrome://tracing, Perfetto) として出力できる.
+
+	NGL_PROFILER_ENABLE を 0 にするとマクロは空になる.
+	有効時も SetEnable(false) の間はZone毎にatomicのロード1回のみ.
+
+	時刻は std::chrono::steady_clock のナノ秒 (WindowsはQueryPerformanceCounter, Linuxはclock_gettime(CLOCK_MONOTONIC)).
+
+	使用例.
+		NGL_PROFILE_SCOPE("ShadowPass");
+		NGL_PROFILE_FUNCTION();
+		NGL_PROFILE_SCOPE_DYNAMIC(node->GetDebugNodeName().Get());	// 一時的な文字列. 内部でコピーを保持する.
+*/
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "util/types.h"
+#include "util/singleton.h"
+
+#ifndef NGL_PROFILER_ENABLE
+	#define NGL_PROFILER_ENABLE 1
+#endif
+
+namespace ngl
+{
+	namespace time
+	{
+		// プロファイラの時刻[ns].
+		u64 GetProfilerTick();
+
+		// 記録されたイベント.
+		struct ProfileEvent
+		{
+			const char*	name = nullptr;	// 文字列リテラルかInternNameで永続化した文字列.
+			u64			tick = 0;		// 最上位ビットが立っている場合は終了イベント.
+		};
+		static constexpr u64 k_profile_event_end_bit = u64(1) << 63;
+
+		// スレッド毎のイベントバッファ. 書き込みは所有スレッド, 読み出しはEndFrameを呼ぶスレッドのみ.
+		class ProfileThreadBuffer
+		{
+		public:
+			ProfileThreadBuffer(u32 thread_index, u32 capacity);
+
+			// 所有スレッドから呼び出す.
+			//	BeginはネストしているZoneの終了イベント分の空きを残して記録し, 記録できなかった場合は対応するEndも破棄する.
+			void Begin(const char* name);
+			void End();
+
+			// 回収側から呼び出す.
+			template<typename FUNC>
+			void Consume(FUNC func);
+
+			u32 GetThreadIndex() const { return thread_index_; }
+			u64 GetDroppedCount() const { return dropped_count_.load(std::memory_order_relaxed); }
+
+		private:
+			friend class Profiler;
+			bool Push(const ProfileEvent& e, u32 reserve);
+
+			std::string					thread_name_ = {};	// Profiler::thread_mutex_ で保護.
+			std::vector<ProfileEvent>	event_array_;
+			u32							mask_ = 0;
+			u32							thread_index_ = 0;
+
+			// 書き込み側のみが更新.
+			alignas(64) std::atomic<u32>	head_ = 0;
+			u32							open_depth_ = 0;	// 記録済みで終了していないZone数.
+			u32							skip_depth_ = 0;	// 破棄中のZone数.
+			std::atomic<u64>			dropped_count_ = 0;
+			// 読み出し側のみが更新.
+			alignas(64) std::atomic<u32>	tail_ = 0;
+		};
+
+		template<typename FUNC>
+		void ProfileThreadBuffer::Consume(FUNC func)
+		{
+			const u32 head = head_.load(std::memory_order_acquire);
+			u32 tail = tail_.load(std::memory_order_relaxed);
+			for (; tail != head; ++tail)
+			{
+				func(event_array_[tail & mask_]);
+			}
+			tail_.store(tail, std::memory_order_release);
+		}
+
+		// 完了したZone.
+		struct ProfileZone
+		{
+			const char*	name = nullptr;
+			u32			thread_index = 0;
+			u32			depth = 0;
+			u64			begin_tick = 0;
+			u64			end_tick = 0;
+		};
+
+		// Zone名毎のフレーム集計. 時間は1フレーム内の合計[ms].
+		struct ProfileZoneStatistics
+		{
+			const char*	name = nullptr;
+			u32			last_call_count = 0;	// 直近フレームの呼び出し回数.
+			double		last_ms = 0.0;
+			double		min_ms = 0.0;
+			double		avg_ms = 0.0;
+			double		max_ms = 0.0;
+			u32			num_frame = 0;			// 集計に含まれるフレーム数.
+		};
+
+		class Profiler : public Singleton<Profiler>
+		{
+			friend class Singleton<Profiler>;
+		public:
+			struct Desc
+			{
+				// スレッド毎のイベントバッファサイズ. 2の冪に切り上げ.
+				u32		thread_buffer_capacity = 64 * 1024;
+				// min/avg/maxの集計フレーム数.
+				u32		statistics_frame_count = 120;
+				// キャプチャで保持する最大Zone数.
+				u32		max_capture_zone = 4 * 1024 * 1024;
+			};
+
+			void Initialize(const Desc& desc);
+
+			// 実行時の有効化. 無効化してもZoneの途中で終了イベントが失われることはない.
+			void SetEnable(bool enable) { enable_.store(enable, std::memory_order_relaxed); }
+			bool IsEnable() const { return enable_.load(std::memory_order_relaxed); }
+
+			// 呼び出しスレッドの名前. Chrome Traceのスレッド名になる.
+			void SetThreadName(const char* name);
+			// 一時的な文字列を永続化する. 同じ内容には同じポインタを返す.
+			const char* InternName(std::string_view name);
+
+			void BeginZone(const char* name);
+			void EndZone();
+
+			// フレーム境界. 全スレッドのイベントを回収して集計する. 単一のスレッド(MainThread)から呼び出す.
+			void EndFrame();
+
+			// キャプチャ. 開始から停止までのZoneを保持する. 開始時に以前のキャプチャは破棄.
+			void BeginCapture();
+			void EndCapture();
+			bool IsCapturing() const { return is_capturing_; }
+			u32 NumCaptureZone() const { return static_cast<u32>(capture_zone_array_.size()); }
+			// キャプチャしたZoneをChrome Trace JSONで出力.
+			bool ExportChromeTrace(const char* file_path) const;
+			std::string ExportChromeTraceString() const;
+
+			// Zone名毎の集計. 名前順.
+			void GetStatistics(std::vector<ProfileZoneStatistics>& out_stat_array) const;
+			// 記録できずに破棄したイベント数.
+			u64 GetDroppedEventCount() const;
+			u64 GetFrameIndex() const { return frame_index_; }
+
+		private:
+			Profiler();
+			~Profiler();
+
+			ProfileThreadBuffer* GetThreadBuffer();
+			ProfileThreadBuffer* RegisterThread();
+			// スレッド終了時. バッファは次に登録されるスレッドで再利用する.
+			void UnregisterThread(ProfileThreadBuffer* p_buffer);
+			friend struct ProfileThreadBufferHolder;
+
+			struct ZoneAccumulate
+			{
+				u64		frame_tick = 0;
+				u32		frame_call_count = 0;
+				u32		last_call_count = 0;
+				// フレーム毎の合計[ns]の履歴. 循環.
+				std::vector<u64>	history;
+				u32		history_pos = 0;
+				u32		history_count = 0;
+			};
+			struct OpenZone
+			{
+				const char*	name = nullptr;
+				u64			begin_tick = 0;
+			};
+			struct CaptureFrame
+			{
+				u64	frame_index = 0;
+				u64	tick = 0;
+			};
+
+			Desc	desc_ = {};
+			std::atomic_bool	enable_ = false;
+
+			mutable std::mutex	thread_mutex_;
+			std::vector<std::unique_ptr<ProfileThreadBuffer>>	thread_buffer_array_;
+			std::vector<ProfileThreadBuffer*>					free_thread_buffer_array_;
+
+			std::mutex	intern_mutex_;
+			std::unordered_set<std::string>	intern_set_;
+
+			// 以下はEndFrameを呼ぶスレッドのみがアクセス.
+			std::vector<std::vector<OpenZone>>				thread_open_zone_stack_;
+			std::unordered_map<std::string_view, ZoneAccumulate>	zone_accumulate_;
+			u64		frame_index_ = 0;
+			bool	is_capturing_ = false;
+			std::vector<ProfileZone>	capture_zone_array_;
+			std::vector<CaptureFrame>	capture_frame_array_;
+		};
+
+		// スコープの開始から終了までのZone.
+		class ProfileScope
+		{
+		public:
+			explicit ProfileScope(const char* name)
+			{
+				if (Profiler::Instance().IsEnable())
+				{
+					is_active_ = true;
+					Profiler::Instance().BeginZone(name);
+				}
+			}
+			// 一時的な文字列の名前. 有効時のみInternNameで永続化する.
+			struct Dynamic {};
+			ProfileScope(Dynamic, std::string_view name)
+			{
+				if (Profiler::Instance().IsEnable())
+				{
+					is_active_ = true;
+					Profiler::Instance().BeginZone(Profiler::Instance().InternName(name));
+				}
+			}
+			~ProfileScope()
+			{
+				if (is_active_)
+					Profiler::Instance().EndZone();
+			}
+			ProfileScope(const ProfileScope&) = delete;
+			ProfileScope& operator=(const ProfileScope&) = delete;
+		private:
+			bool is_active_ = false;
+		};
+	}
+}
+
+#define NGL_PROFILE_CONCAT_IMPL(a, b) a##b
+#define NGL_PROFILE_CONCAT(a, b) NGL_PROFILE_CONCAT_IMPL(a, b)
+
+#if NGL_PROFILER_ENABLE
+	// nameは文字列リテラル等のプログラム終了まで有効な文字列.
+	#define NGL_PROFILE_SCOPE(name) ngl::time::ProfileScope NGL_PROFILE_CONCAT(ngl_profile_scope_, __LINE__)(name)
+	// nameは一時的な文字列.
+	#define NGL_PROFILE_SCOPE_DYNAMIC(name) ngl::time::ProfileScope NGL_PROFILE_CONCAT(ngl_profile_scope_, __LINE__)(ngl::time::ProfileScope::Dynamic{}, name)
+	#define NGL_PROFILE_FUNCTION() NGL_PROFILE_SCOPE(__FUNCTION__)
+	#define NGL_PROFILE_THREAD_NAME(name) ngl::time::Profiler::Instance().SetThreadName(name)
+#else
+	#define NGL_PROFILE_SCOPE(name)
+	#define NGL_PROFILE_SCOPE_DYNAMIC(name)
+	#define NGL_PROFILE_FUNCTION()
+	#define NGL_PROFILE_THREAD_NAME(name)
+#endif
+
+#endif // _NGL_UTIL_PROFILER_
@@ -7,6 +7,7 @@ namespace ngl
 {
 	namespace types
 	{
+#if defined(_MSC_VER)
 		typedef __int8			  s8;
 		typedef __int16			 s16;
 		typedef __int32			 s32;
@@ -15,6 +16,17 @@ namespace ngl
 		typedef unsigned __int16	u16;
 		typedef unsigned __int32	u32;
 		typedef unsigned __int64	u64;
+#else
+		// MSVC以外. __intNと同じ基本型.
+		typedef char				s8;
+		typedef short			   s16;
+		typedef int				 s32;
+		typedef long long		   s64;
+		typedef unsigned char	   u8;
+		typedef unsigned short	  u16;
+		typedef unsigned int		u32;
+		typedef unsigned long long  u64;
+#endif
 
 		typedef float			   f32;
 		typedef double			  f64;
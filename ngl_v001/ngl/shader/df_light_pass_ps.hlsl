@@ -47,7 +47,12 @@ Texture2D tex_bent_normal;// BentNormalテクスチャ.
 SamplerState samp;
 SamplerComparisonState samp_shadow;
 
-TextureCube tex_ibl_diffuse;
+// Diffuse IBLの放射照度SH. E/π.
+struct CbSkyIrradianceSh
+{
+	float4 sh_coef[9];
+};
+ConstantBuffer<CbSkyIrradianceSh> cb_ngl_sky_irradiance_sh;
 TextureCube tex_ibl_specular;
 Texture2D tex_ibl_dfg;
 
@@ -79,7 +84,7 @@ void EvalIblDiffuseStandard
 (
 	out float3 out_diffuse, out float3 out_specular,
 
-	TextureCube tex_cube_ibl_diffuse, TextureCube tex_cube_ibl_spacular, Texture2D tex_2d_specular_dfg, SamplerState samp, 
+	float4 ibl_diffuse_sh_coef[9], TextureCube tex_cube_ibl_spacular, Texture2D tex_2d_specular_dfg, SamplerState samp, 
 	float3 N, float3 V, 
 	float3 base_color, float roughness, float metalness
 )
@@ -96,7 +101,7 @@ void EvalIblDiffuseStandard
 
 	const float3 irradiance_specular = tex_cube_ibl_spacular.SampleLevel(samp, L_Reflect, ibl_specular_mip).rgb;
 	const float4 specular_dfg = tex_2d_specular_dfg.SampleLevel(samp, float2(saturate(dot(N, V)), roughness), 0);
-	const float3 irradiance_diffuse = tex_cube_ibl_diffuse.SampleLevel(samp, N, 0).rgb;
+	const float3 irradiance_diffuse = max(EvalSh9Rgb(ibl_diffuse_sh_coef, N), 0.0);
 
 	// FresnelでDiffuseとSpecularに分配.
 	out_diffuse = brdf_diffuse * irradiance_diffuse;
@@ -319,7 +324,7 @@ float4 main_ps(VS_OUTPUT input) : SV_TARGET
 	// IBL.
 	{
 		float3 ibl_diffuse, ibl_specular;
-		EvalIblDiffuseStandard(ibl_diffuse, ibl_specular, tex_ibl_diffuse, tex_ibl_specular, tex_ibl_dfg, samp, gb_normal_ws, V, gb_base_color, gb_roughness, gb_metalness);
+		EvalIblDiffuseStandard(ibl_diffuse, ibl_specular, cb_ngl_sky_irradiance_sh.sh_coef, tex_ibl_specular, tex_ibl_dfg, samp, gb_normal_ws, V, gb_base_color, gb_roughness, gb_metalness);
 
 		lit_color += (ibl_diffuse + ibl_specular) * cb_ngl_lighting_pass.sky_lit_intensity * sky_visibility * ssao_sample.a;
 	}
@@ -272,6 +272,21 @@ float2 CalcPanoramaTexcoordFromWorldSpaceRay(float3 ray_dir)
     return panorama_uv;
 }
 
+// L2 球面調和関数 9係数のRGBを方向 N で評価. 係数の順序と基底はC++側の gfx::Sh9Rgb と一致.
+float3 EvalSh9Rgb(float4 sh_coef[9], float3 N)
+{
+    float3 result = sh_coef[0].rgb * 0.282094792;
+    result += sh_coef[1].rgb * (0.488602512 * N.y);
+    result += sh_coef[2].rgb * (0.488602512 * N.z);
+    result += sh_coef[3].rgb * (0.488602512 * N.x);
+    result += sh_coef[4].rgb * (1.092548431 * N.x * N.y);
+    result += sh_coef[5].rgb * (1.092548431 * N.y * N.z);
+    result += sh_coef[6].rgb * (0.315391565 * (3.0 * N.z * N.z - 1.0));
+    result += sh_coef[7].rgb * (1.092548431 * N.x * N.z);
+    result += sh_coef[8].rgb * (0.546274215 * (N.x * N.x - N.y * N.y));
+    return result;
+}
+
 // CubemapのPlane[0,5]に対応する向きベクトルを取得.
 void GetCubemapPlaneAxis(int cube_plane_index, out float3 out_front, out float3 out_up, out float3 out_right)
 {
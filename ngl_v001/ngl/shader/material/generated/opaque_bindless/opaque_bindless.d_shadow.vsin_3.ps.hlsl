@@ -0,0 +1,6 @@
+#define NGL_VS_IN_POSITION0
+#define NGL_VS_IN_POSITION
+#define NGL_VS_IN_NORMAL0
+#define NGL_VS_IN_NORMAL
+#include "../../impl/opaque_bindless.hlsli"
+#include "../../pass/d_shadow.hlsli"
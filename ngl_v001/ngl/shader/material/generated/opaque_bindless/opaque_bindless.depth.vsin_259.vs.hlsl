@@ -0,0 +1,8 @@
+#define NGL_VS_IN_POSITION0
+#define NGL_VS_IN_POSITION
+#define NGL_VS_IN_NORMAL0
+#define NGL_VS_IN_NORMAL
+#define NGL_VS_IN_TEXCOORD0
+#define NGL_VS_IN_TEXCOORD
+#include "../../impl/opaque_bindless.hlsli"
+#include "../../pass/depth.hlsli"
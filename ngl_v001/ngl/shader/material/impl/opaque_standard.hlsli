@@ -42,7 +42,8 @@ SamplerState samp_default;
     {
         uint   vertex_id    :	SV_VertexID;
         
-        float3 pos		:	POSITION;
+        // float頂点はR32G32B32でwは1, 量子化頂点はR16G16B16A16_UNORMでwにBitangentの符号.
+        float4 pos		:	POSITION;
         // POSITION 以外はマテリアル毎に定義XMLで必要とするものを記述することでマクロ定義されて有効となる.
         #if defined(NGL_VS_IN_NORMAL)
             float3 normal	:	NORMAL;
@@ -71,16 +72,18 @@ SamplerState samp_default;
     {
         MaterialVertexAttributeData output = (MaterialVertexAttributeData)0;
         
-        output.pos = input.pos;
+        output.pos = input.pos.xyz;
+        output.pos_w = input.pos.w;
         
+        // 正規化はPass側で変換後に実行されるためここでは不要. 量子化頂点の復元もPass側で実行される.
         #if defined(NGL_VS_IN_NORMAL)
-            output.normal = normalize(input.normal);// TODO. コンバートあるいは読み込み時に正規化すればここの正規化は不要. 現状は簡易化のためここで実行.
+            output.normal = input.normal;
         #endif
         #if defined(NGL_VS_IN_TANGENT)
-            output.tangent = normalize(input.tangent);
+            output.tangent = input.tangent;
         #endif
         #if defined(NGL_VS_IN_BINORMAL)
-            output.binormal = normalize(input.binormal);
+            output.binormal = input.binormal;
         #endif
 
         #if defined(NGL_VS_IN_COLOR0)
@@ -131,7 +134,7 @@ MtlPsOutput MtlPsEntryPoint(MtlPsInput input)
     const float surface_optional = 0.0;
     const float material_id = 0.0;
 
-    #if defined(NGL_VS_IN_TANGENT0) && defined(NGL_VS_IN_BINORMAL0)
+    #if defined(NGL_VS_IN_TANGENT0)
         // TangentFrameがある場合はNormalMapping.
         const float3 normal_ws = input.tangent_ws * mtl_normal.x + input.binormal_ws * mtl_normal.y + input.normal_ws * mtl_normal.z;
     #else
@@ -0,0 +1,53 @@
+#ifndef NGL_SHADER_MTL_BINDLESS_MATERIAL_H
+#define NGL_SHADER_MTL_BINDLESS_MATERIAL_H
+
+/*
+    mtl_bindless_material.hlsli
+
+    Bindlessマテリアル用宣言.
+    テクスチャはDeviceのBindless SRV配列 (register space1) をマテリアルテーブルのインデックスで参照する.
+    マテリアルインデックスはDraw毎のRootConstant (register space2) で受け取るため, マテリアルのテクスチャ毎のDescriptorコピーが不要になる.
+
+    C++側の定義は BindlessMaterialEntry (gfx/material/bindless_material_table.h).
+*/
+
+
+// テクスチャ種別. EBindlessMaterialTexture と一致させる.
+#define NGL_BINDLESS_MATERIAL_TEXTURE_BASE_COLOR    0
+#define NGL_BINDLESS_MATERIAL_TEXTURE_NORMAL        1
+#define NGL_BINDLESS_MATERIAL_TEXTURE_OCCLUSION     2
+#define NGL_BINDLESS_MATERIAL_TEXTURE_ROUGHNESS     3
+#define NGL_BINDLESS_MATERIAL_TEXTURE_METALNESS     4
+#define NGL_BINDLESS_MATERIAL_TEXTURE_MAX           5
+
+// Bindless SRV配列. RootSignatureでは非有界テーブルとして扱われる.
+Texture2D ngl_bindless_texture2d[] : register(t0, space1);
+
+struct NglBindlessMaterialEntry
+{
+    uint texture_index[NGL_BINDLESS_MATERIAL_TEXTURE_MAX];
+    uint flags;
+    uint pad0;
+    uint pad1;
+};
+// マテリアルテーブル. 通常のSRVとして名前で設定される.
+StructuredBuffer<NglBindlessMaterialEntry> ngl_bindless_material_table;
+
+// Draw毎のRootConstant.
+struct NglBindlessDrawConstant
+{
+    uint material_index;
+    uint instance_index;
+};
+ConstantBuffer<NglBindlessDrawConstant> cb_ngl_bindless_draw : register(b0, space2);
+
+
+NglBindlessMaterialEntry NglGetBindlessMaterial()
+{
+    return ngl_bindless_material_table[cb_ngl_bindless_draw.material_index];
+}
+// マテリアルのテクスチャ取得. インデックスはDraw内で一様.
+#define NGL_BINDLESS_MATERIAL_TEXTURE(mtl_entry, texture_type) ngl_bindless_texture2d[(mtl_entry).texture_index[texture_type]]
+
+
+#endif
@@ -19,6 +19,18 @@ struct NglInstanceInfo
 // 後でCBではなく巨大なTransformBufferにするかも.
 ConstantBuffer<NglInstanceInfo> cb_ngl_instance;
 
+// Shape毎の情報. Shapeのロード時に生成された定数バッファ.
+struct NglShapeInfo
+{
+    // 頂点フォーマット. 0:float, 1:量子化 (EMeshVertexFormat).
+    //  量子化の場合 POSITION = unorm * vtx_pos_dequant_scale + vtx_pos_dequant_offset.
+    float3 vtx_pos_dequant_scale;
+    uint vtx_format;
+    float3 vtx_pos_dequant_offset;
+    uint vtx_pad0;
+};
+ConstantBuffer<NglShapeInfo> cb_ngl_shape;
+
 
 float3x4 NglGetInstanceTransform(int instance_id)
 {
@@ -30,6 +42,14 @@ float3x4 NglGetInstanceTransformCofactor(int instance_id)
     // 現状はCBだが, 後でIDから巨大なBuffer上の情報を取得する形式にしたい.
     return cb_ngl_instance.mtx_cofactor;
 }
+bool NglIsShapeVertexQuantized()
+{
+    return 1 == cb_ngl_shape.vtx_format;
+}
+float3 NglDequantizeShapeVertexPosition(float3 pos_unorm)
+{
+    return pos_unorm * cb_ngl_shape.vtx_pos_dequant_scale + cb_ngl_shape.vtx_pos_dequant_offset;
+}
 
 
 #endif
@@ -54,6 +54,8 @@ ConstantBuffer<SceneDirectionalShadowRenderInfo> cb_ngl_shadowview;
     struct MaterialVertexAttributeData
     {
         float3 pos;
+        // POSITION.w. 量子化頂点の場合はBitangentの符号 (0:-1, 1:+1). float頂点の場合は1.
+        float pos_w;
         
         float3 normal;
         float3 tangent;
@@ -74,6 +74,28 @@
     }
     */
 
+#include "../include/math_util.hlsli"
+
+// -------------------------------------------------------------------------------------------
+// 頂点属性の復元.
+//  量子化頂点の場合 POSITIONを逆量子化し, NORMAL, TANGENTをOctahedronから復元する.
+//  BINORMAL入力が無い場合は NORMAL, TANGENT と POSITION.w の符号から復元する.
+    void NglDecodeVertexAttribute(inout MaterialVertexAttributeData attr)
+    {
+        if(NglIsShapeVertexQuantized())
+        {
+            attr.pos = NglDequantizeShapeVertexPosition(attr.pos);
+            #if defined(NGL_VS_IN_NORMAL)
+                attr.normal = OctDecode(attr.normal.xy);
+            #endif
+            #if defined(NGL_VS_IN_TANGENT)
+                attr.tangent = OctDecode(attr.tangent.xy);
+            #endif
+        }
+        #if defined(NGL_VS_IN_NORMAL) && defined(NGL_VS_IN_TANGENT) && !defined(NGL_VS_IN_BINORMAL)
+            attr.binormal = cross(attr.normal, attr.tangent) * (attr.pos_w * 2.0 - 1.0);
+        #endif
+    }
 
 // -------------------------------------------------------------------------------------------
 // VS.  Pass共通コード. マテリアル固有コードやコールバックなどをでカスタマイズされる.
@@ -83,6 +105,7 @@
         //  VS_INPUTとそこから共通頂点データ取得をする関数MaterialCallback_GetVertexAttributeDataをマテリアル側で定義することで
         //  マテリアル毎に自由な頂点入力ができるようになっている.
         MaterialVertexAttributeData input_wrap = MaterialCallback_GetVertexAttributeData(input);
+        NglDecodeVertexAttribute(input_wrap);
         
         const float3x4 instance_mtx = NglGetInstanceTransform(0);
         const float3x4 instance_mtx_cofactor = NglGetInstanceTransformCofactor(0);
@@ -20,6 +20,9 @@ struct CbSkyBox
 	float	exposure;
 	uint	panorama_mode;
     float   debug_mip_bias;
+	uint	irradiance_sh_mode;
+	// Diffuse IBLの放射照度SH. irradiance_sh_mode で利用.
+	float4	irradiance_sh[9];
 };
 ConstantBuffer<CbSkyBox> cb_skybox;
 
@@ -36,7 +39,11 @@ float4 main_ps(VS_OUTPUT input) : SV_TARGET
 	float3 ray_ws = mul(cb_ngl_sceneview.cb_view_inv_mtx, float4(ray_vs, 0));
 
 	float4 tex_color = (float4)0;
-	if(0 == cb_skybox.panorama_mode)
+	if(0 != cb_skybox.irradiance_sh_mode)
+	{
+		tex_color = float4(max(EvalSh9Rgb(cb_skybox.irradiance_sh, normalize(ray_ws)), 0.0), 1.0);
+	}
+	else if(0 == cb_skybox.panorama_mode)
 	{
 		tex_color = tex_skybox_cube.SampleLevel(samp, ray_ws, cb_skybox.debug_mip_bias);
 	}
@@ -56,6 +56,20 @@ namespace ngl
 			return true;
 		}
 
+		bool ReadFileRange(const char* filePath, u64 offset, void* p_dst, u64 size)
+		{
+			if (!p_dst)
+				return false;
+
+			std::ifstream ifs(filePath, std::ios::binary);
+			if (!ifs)
+				return false;
+
+			ifs.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+			ifs.read(reinterpret_cast<char*>(p_dst), static_cast<std::streamsize>(size));
+			return ifs.good() && static_cast<u64>(ifs.gcount()) == size;
+		}
+
 		bool WriteFileFromBuffer(const char* filePath, const void* data, size_t size)
 		{
 			if (!data || size == 0)
@@ -0,0 +1,249 @@
+﻿
+#include "framework/gfx_frame_pacer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace ngl::fwk
+{
+    // 統計の指数移動平均の係数.
+    static constexpr double k_frame_pacer_stat_ema_rate = 0.1;
+
+    void FramePacer::SetFunction(const GetCompletedFunction& get_completed_function, const WaitFunction& wait_function)
+    {
+        get_completed_function_ = get_completed_function;
+        wait_function_ = wait_function;
+    }
+
+    void FramePacer::SetMaxFramesInFlight(u32 count)
+    {
+        max_frames_in_flight_ = std::clamp<u32>(count, 1, k_max_frames_in_flight);
+    }
+
+    void FramePacer::PopFront()
+    {
+        assert(0 < inflight_count_);
+        inflight_head_ = (inflight_head_ + 1) % k_max_frames_in_flight;
+        --inflight_count_;
+    }
+
+    void FramePacer::RetireCompleted()
+    {
+        if (0 >= inflight_count_)
+            return;
+        const u64 completed = get_completed_function_();
+        while (0 < inflight_count_ && inflight_id_[inflight_head_] <= completed)
+        {
+            PopFront();
+        }
+    }
+
+    u64 FramePacer::WaitForSubmitSlot()
+    {
+        assert(get_completed_function_ && wait_function_);
+
+        RetireCompleted();
+
+        // 今回のSubmitで上限を超えないよう, 古いフレームから完了を待機.
+        const u32 max_frames_in_flight = max_frames_in_flight_.load();
+        u64 wait_micro_sec = 0;
+        if (max_frames_in_flight <= inflight_count_)
+        {
+            const auto begin_time_point = std::chrono::steady_clock::now();
+            while (max_frames_in_flight <= inflight_count_)
+            {
+                wait_function_(inflight_id_[inflight_head_]);
+                PopFront();
+            }
+            wait_micro_sec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin_time_point).count();
+
+            std::scoped_lock<std::mutex> lock(stat_mutex_);
+            ++stat_.num_wait;
+        }
+        last_wait_micro_sec_ = wait_micro_sec;
+        return wait_micro_sec;
+    }
+
+    void FramePacer::OnSubmitted(u64 submit_id)
+    {
+        assert(k_max_frames_in_flight > inflight_count_ && "WaitForSubmitSlot が呼ばれていない.");
+        assert((0 >= inflight_count_ || inflight_id_[(inflight_head_ + inflight_count_ - 1) % k_max_frames_in_flight] < submit_id) && "submit_id が単調増加でない.");
+
+        inflight_id_[(inflight_head_ + inflight_count_) % k_max_frames_in_flight] = submit_id;
+        ++inflight_count_;
+
+        const auto now = std::chrono::steady_clock::now();
+        std::scoped_lock<std::mutex> lock(stat_mutex_);
+        stat_.max_frames_in_flight = max_frames_in_flight_.load();
+        stat_.num_frames_in_flight = inflight_count_;
+        stat_.wait_micro_sec = last_wait_micro_sec_;
+        stat_.avg_wait_micro_sec = (0 == stat_.num_frame) ?
+            static_cast<double>(last_wait_micro_sec_) : (stat_.avg_wait_micro_sec + (static_cast<double>(last_wait_micro_sec_) - stat_.avg_wait_micro_sec) * k_frame_pacer_stat_ema_rate);
+        if (has_last_submit_)
+        {
+            const u64 interval = std::chrono::duration_cast<std::chrono::microseconds>(now - last_submit_time_).count();
+            const bool is_first_interval = (0.0 >= stat_.avg_frame_interval_micro_sec);
+            const double deviation = std::abs(static_cast<double>(interval) - stat_.avg_frame_interval_micro_sec);
+            stat_.frame_interval_micro_sec = interval;
+            stat_.avg_frame_interval_micro_sec = is_first_interval ?
+                static_cast<double>(interval) : (stat_.avg_frame_interval_micro_sec + (static_cast<double>(interval) - stat_.avg_frame_interval_micro_sec) * k_frame_pacer_stat_ema_rate);
+            if (!is_first_interval)
+                stat_.frame_interval_jitter_micro_sec += (deviation - stat_.frame_interval_jitter_micro_sec) * k_frame_pacer_stat_ema_rate;
+            stat_.max_frame_interval_micro_sec = std::max(stat_.max_frame_interval_micro_sec, interval);
+        }
+        ++stat_.num_frame;
+        last_submit_time_ = now;
+        has_last_submit_ = true;
+    }
+
+    void FramePacer::WaitAll()
+    {
+        while (0 < inflight_count_)
+        {
+            wait_function_(inflight_id_[inflight_head_]);
+            PopFront();
+        }
+    }
+
+    u32 FramePacer::NumFramesInFlight()
+    {
+        RetireCompleted();
+        return inflight_count_;
+    }
+
+    FramePacer::Statistics FramePacer::GetStatistics() const
+    {
+        std::scoped_lock<std::mutex> lock(stat_mutex_);
+        return stat_;
+    }
+
+    void FramePacer::ResetStatistics()
+    {
+        std::scoped_lock<std::mutex> lock(stat_mutex_);
+        stat_ = {};
+        has_last_submit_ = false;
+    }
+
+
+    void TestFramePacer()
+    {
+        bool is_ok = true;
+
+        // 偽のQueue. 待機はその値までGPUが完了したものとして扱う.
+        struct FakeQueue
+        {
+            u64                 completed = 0;
+            std::vector<u64>    wait_value = {};
+        };
+        {
+            FakeQueue queue = {};
+            FramePacer pacer;
+            pacer.SetFunction([&queue]() { return queue.completed; },
+                [&queue](u64 value) { queue.wait_value.push_back(value); queue.completed = std::max(queue.completed, value); });
+
+            // 上限2. 2フレーム目までは待機無し, 3フレーム目で1フレーム目の完了を待つ.
+            pacer.SetMaxFramesInFlight(2);
+            pacer.WaitForSubmitSlot(); pacer.OnSubmitted(1);
+            pacer.WaitForSubmitSlot(); pacer.OnSubmitted(2);
+            is_ok &= queue.wait_value.empty() && (2 == pacer.NumFramesInFlight());
+            pacer.WaitForSubmitSlot(); pacer.OnSubmitted(3);
+            is_ok &= (std::vector<u64>{ 1 } == queue.wait_value);
+
+            // GPUが先行して完了したフレームは待機せずに取り除かれる.
+            queue.completed = 2;
+            pacer.WaitForSubmitSlot(); pacer.OnSubmitted(4);
+            is_ok &= (1 == queue.wait_value.size()) && (2 == pacer.NumFramesInFlight());
+
+            // 上限を下げると次のSubmit前に超過分を待機する.
+            pacer.SetMaxFramesInFlight(1);
+            pacer.WaitForSubmitSlot();
+            is_ok &= (std::vector<u64>{ 1, 3, 4 } == queue.wait_value) && (0 == pacer.NumFramesInFlight());
+            pacer.OnSubmitted(5);
+
+            // クランプ.
+            pacer.SetMaxFramesInFlight(0);
+            is_ok &= (1 == pacer.GetMaxFramesInFlight());
+            pacer.SetMaxFramesInFlight(100);
+            is_ok &= (FramePacer::k_max_frames_in_flight == pacer.GetMaxFramesInFlight());
+
+            pacer.WaitAll();
+            is_ok &= (5 == queue.completed) && (0 == pacer.NumFramesInFlight());
+
+            const auto stat = pacer.GetStatistics();
+            is_ok &= (5 == stat.num_frame) && (2 == stat.num_wait);
+        }
+
+        // 別スレッドのGPUを模したQueue. Submit順に一定時間で完了する.
+        {
+            constexpr u32 k_max_in_flight = 3;
+            constexpr u64 k_num_frame = 40;
+
+            std::mutex                  mutex;
+            std::condition_variable     cv;
+            std::deque<u64>             gpu_queue;
+            u64                         gpu_completed = 0;
+            bool                        terminate = false;
+
+            std::thread gpu_thread([&]()
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                for (;;)
+                {
+                    cv.wait(lock, [&]() { return terminate || !gpu_queue.empty(); });
+                    if (gpu_queue.empty())
+                        break;
+                    const u64 id = gpu_queue.front();
+                    lock.unlock();
+                    std::this_thread::sleep_for(std::chrono::microseconds(500));
+                    lock.lock();
+                    gpu_queue.pop_front();
+                    gpu_completed = id;
+                    cv.notify_all();
+                }
+            });
+
+            FramePacer pacer;
+            pacer.SetFunction([&]() { std::scoped_lock<std::mutex> lock(mutex); return gpu_completed; },
+                [&](u64 value) { std::unique_lock<std::mutex> lock(mutex); cv.wait(lock, [&]() { return value <= gpu_completed; }); });
+            pacer.SetMaxFramesInFlight(k_max_in_flight);
+
+            u32 max_observed_in_flight = 0;
+            for (u64 frame = 1; frame <= k_num_frame; ++frame)
+            {
+                pacer.WaitForSubmitSlot();
+                {
+                    std::scoped_lock<std::mutex> lock(mutex);
+                    // Submit時点でGPU実行中のフレーム数は上限未満.
+                    is_ok &= (frame - 1 - gpu_completed) < k_max_in_flight;
+                    gpu_queue.push_back(frame);
+                    cv.notify_all();
+                }
+                pacer.OnSubmitted(frame);
+                max_observed_in_flight = std::max(max_observed_in_flight, pacer.GetStatistics().num_frames_in_flight);
+            }
+            pacer.WaitAll();
+            {
+                std::scoped_lock<std::mutex> lock(mutex);
+                is_ok &= (k_num_frame == gpu_completed);
+                terminate = true;
+                cv.notify_all();
+            }
+            gpu_thread.join();
+
+            // CPUの方が速いため上限まで先行している.
+            is_ok &= (k_max_in_flight == max_observed_in_flight);
+            const auto stat = pacer.GetStatistics();
+            is_ok &= (k_num_frame == stat.num_frame) && (0 < stat.num_wait) && (0.0 < stat.avg_frame_interval_micro_sec);
+        }
+
+        std::cout << "[TestFramePacer]";
+        std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+        assert(is_ok);
+    }
+}
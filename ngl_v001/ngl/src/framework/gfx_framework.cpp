@@ -1,6 +1,7 @@
 ﻿
 #include "framework/gfx_framework.h"
 
+#include <algorithm>
 #include <chrono>
 
 #include "rhi/d3d12/command_list.d3d12.h"
@@ -13,12 +14,16 @@
 
 // gfx 共通リソース.
 #include "gfx/rendering/global_render_resource.h"
+// メッシュやテクスチャのアップロード.
+#include "gfx/resource/upload_manager.h"
+#include "gfx/resource/texture_streaming_system.h"
 
 #include "platform/window.h"
 
 
 // Imgui.
 #include "imgui/imgui_interface.h"
+#include "util/time/profiler.h"
 
 namespace ngl::fwk
 {
@@ -55,6 +60,7 @@ namespace ngl::fwk
                 device_desc.pipeline_state_cache_graphics_capacity = 512;
                 device_desc.pipeline_state_cache_compute_capacity = 512;
                 device_desc.require_enhanced_barrier = desc.require_enhanced_barrier;
+                device_desc.enable_bindless = desc.enable_bindless;
             }
             if (!device_.Initialize(p_window_, device_desc))
 			{
@@ -68,9 +74,8 @@ namespace ngl::fwk
 				MessageBoxA(p_window_->Dep().GetWindowHandle(), "Raytracing is not supported on this device.", "Info", MB_OK);
 			}
 
-			// GpuWorkId管理バッファサイズチェック.
-			assert(k_gpu_work_queue_count_max > device_.GetDesc().swapchain_buffer_count);
-			assert(device_.GetDesc().swapchain_buffer_count >= inflight_gpu_work_flip_count_);
+			// Frames In Flight 管理バッファサイズチェック.
+			assert(FramePacer::k_max_frames_in_flight >= device_.GetDesc().swapchain_buffer_count);
 
 		}
 		// graphics queue.
@@ -112,10 +117,44 @@ namespace ngl::fwk
 			std::cout << "[ERROR] Initialize Fence" << std::endl;
 			return false;
 		}
+		// フレーム末尾でDeviceのフレームインデックスをSignalするため, RHIオブジェクトの遅延破棄の完了判定に利用する.
+		device_.SetFrameCompletionFence(&gpu_wait_fence_);
+		// Frames In Flight 管理.
+		{
+			frame_pacer_.SetFunction(
+				[this]() { return gpu_wait_fence_.GetD3D12Fence()->GetCompletedValue(); },
+				[this](u64 value) { gpu_wait_signal_.Wait(&gpu_wait_fence_, value); });
+			SetMaxFramesInFlight(desc.max_frames_in_flight);
+		}
+
+		// アップロード管理. リソースのロードより先に初期化する.
+		if (!ngl::gfx::UploadManager::Instance().Initialize(&device_))
+		{
+			std::cout << "[ERROR] Initialize Upload Manager" << std::endl;
+			return false;
+		}
+		// テクスチャストリーミング. UploadManager経由でアップロードする.
+		if (!ngl::gfx::TextureStreamingSystem::Instance().Initialize(&device_))
+		{
+			std::cout << "[ERROR] Initialize Texture Streaming System" << std::endl;
+			return false;
+		}
 
 		// RTGマネージャ初期化.
 		{
 			rtg_manager_.Init(&device_, 4);
+			// TaskNode毎のGPUタイムスタンプ計測.
+			if(!rtg_manager_.InitGpuTimestamp(&graphics_queue_, &compute_queue_))
+			{
+				std::cout << "[ERROR] Initialize Rtg Gpu Timestamp" << std::endl;
+			}
+		}
+
+		// プロファイラのスレッド名.
+		{
+			NGL_PROFILE_THREAD_NAME("MainThread");
+			render_thread_.Begin([]{ NGL_PROFILE_THREAD_NAME("RenderThread"); });
+			render_thread_.Wait();
 		}
 
 		// デフォルトテクスチャ等の簡易アクセス用クラス初期化.
@@ -164,8 +203,13 @@ namespace ngl::fwk
 		// リソースマネージャから全て破棄.
 		ngl::res::ResourceManager::Instance().ReleaseCacheAll();
 
+		// テクスチャストリーミング.
+		ngl::gfx::TextureStreamingSystem::Instance().Finalize();
+		// アップロード管理. 未処理の要求を破棄し, ステージングバッファは以降の空回しで破棄される.
+		ngl::gfx::UploadManager::Instance().Finalize();
+
         // ガベコレを完全に完了させるための空回し.
-        for(int i = 0; i < k_gpu_work_queue_count_max; ++i)
+        for(u32 i = 0; i < FramePacer::k_max_frames_in_flight; ++i)
         {
             EmptyFrameProcessForDestroy();
         }
@@ -190,9 +234,12 @@ namespace ngl::fwk
 	{
 		const std::chrono::system_clock::time_point begin_time_point_wait_render_thread = std::chrono::system_clock::now();
 		{
+			NGL_PROFILE_SCOPE("GraphicsFramework::WaitRenderThread");
 			// RenderThread完了待機.
 			render_thread_.Wait();
 		}
+		// RenderThread停止中にプロファイラのフレーム境界処理.
+		ngl::time::Profiler::Instance().EndFrame();
 		const auto wait_render_thread_micro_sec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now()-begin_time_point_wait_render_thread).count(); 
 		
 		
@@ -227,6 +274,7 @@ namespace ngl::fwk
 						stat->app_render_func_micro_sec = stat_on_render_.app_render_func_micro_sec;
 						stat->wait_gpu_fence_micro_sec = stat_on_render_.wait_gpu_fence_micro_sec;
 						stat->wait_present_micro_sec = stat_on_render_.wait_present_micro_sec;
+						stat->num_frames_in_flight = stat_on_render_.num_frames_in_flight;
 
 						// Render Threadの情報格納完了したことを保存.
 						stat->collected_cpu_render_thread = true;
@@ -243,6 +291,7 @@ namespace ngl::fwk
 		// RenderThreadにシステム処理とAPp描画Lambdaを実行させる.
 		render_thread_.Begin([this, app_render_func]
 		{
+			NGL_PROFILE_SCOPE("GraphicsFramework::FrameRender");
 			{
 				stat_on_render_={};
 				stat_on_render_.device_frame_index = device_.GetDeviceFrameIndex();
@@ -257,12 +306,15 @@ namespace ngl::fwk
 				// PushCommonRenderCommandで積み込まれた描画スレッドコマンドを実行. ResourceのRenderThread処理もこの仕組みに登録される.
 				GfxRenderCommandManager::Instance().Execute(p_system_frame_begin_command_list_);
 			}
+			// 予算内のアップロードをCopy QueueへSubmit. 上記のRenderThread処理で要求されたものを含む.
+			ngl::gfx::UploadManager::Instance().FlushFrame();
 			
 			// アプリケーション側のRender処理.
 			RtgFrameRenderSubmitCommandBuffer app_rtg_command_list_set{};
 			const std::chrono::system_clock::time_point begin_time_point_app_render_func = std::chrono::system_clock::now();
             if(app_render_func)
 			{
+				NGL_PROFILE_SCOPE("GraphicsFramework::AppRender");
 				app_render_func(app_rtg_command_list_set);
 			}
 			stat_on_render_.app_render_func_micro_sec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now()-begin_time_point_app_render_func).count(); 
@@ -292,17 +344,10 @@ namespace ngl::fwk
 	void GraphicsFramework::ReadyToSubmit()
 	{
 		// ------------------------------------------------------------------------------------------
-		// 今回フレームのコマンドをGPUにSubmitする前に前回のGPU処理完了待機.
-		// GPU側にN個のキューを想定している場合は今回使用するキューのタスク完了を待つ(現状は1つ).
-		if (inflight_gpu_work_id_enable_[inflight_gpu_work_flip_])
+		// 今回フレームのコマンドをGPUにSubmitする前に, GPU実行中のフレーム数が上限未満になるまで古いフレームの完了を待機.
 		{
-			const std::chrono::system_clock::time_point begin_time_point = std::chrono::system_clock::now();
-			
-			// 今回のGPUタスク待機バッファの完了を待機.
-			gpu_wait_signal_.Wait(&gpu_wait_fence_, inflight_gpu_work_id_[inflight_gpu_work_flip_]);
-			inflight_gpu_work_id_enable_[inflight_gpu_work_flip_] = false;
-			
-			stat_on_render_.wait_gpu_fence_micro_sec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now()-begin_time_point).count(); 
+			NGL_PROFILE_SCOPE("GraphicsFramework::WaitGpu");
+			stat_on_render_.wait_gpu_fence_micro_sec = frame_pacer_.WaitForSubmitSlot();
 		}
 		// ------------------------------------------------------------------------------------------
 
@@ -320,6 +365,7 @@ namespace ngl::fwk
 	void GraphicsFramework::Present()
 	{
 		const std::chrono::system_clock::time_point begin_time_point = std::chrono::system_clock::now();
+		NGL_PROFILE_SCOPE("GraphicsFramework::Present");
 
 #if 1
 		UINT presentFlags = DXGI_PRESENT_ALLOW_TEARING;
@@ -335,27 +381,33 @@ namespace ngl::fwk
 	{
 		const auto submit_gpu_work_id = device_.GetDeviceFrameIndex();
 
-		// 今回のGPUタスクの待機用シグナル発行とそのバッファリング.
-		inflight_gpu_work_id_[inflight_gpu_work_flip_] = submit_gpu_work_id;
+		// 今回のGPUタスクの待機用シグナル発行と Frames In Flight への登録.
 		graphics_queue_.Signal(&gpu_wait_fence_, submit_gpu_work_id);
-		inflight_gpu_work_id_enable_[inflight_gpu_work_flip_] = true;
+		frame_pacer_.OnSubmitted(submit_gpu_work_id);
 
-		inflight_gpu_work_flip_ = (inflight_gpu_work_flip_ + 1) % inflight_gpu_work_flip_count_;
+		stat_on_render_.num_frames_in_flight = frame_pacer_.GetStatistics().num_frames_in_flight;
 	}
 
 	// Submit済みのGPUタスクのすべての完了を待機.
 	void GraphicsFramework::WaitAllGpuTask()
 	{
 		// SubmitしたすべてのGPUタスクの完了待ち.
-		for (ngl::u32 gpu_work_offset = 0; gpu_work_offset < inflight_gpu_work_flip_count_; ++gpu_work_offset)
-		{
-			const auto gpu_work_index = (inflight_gpu_work_flip_ + gpu_work_offset) % inflight_gpu_work_flip_count_;
-			if (inflight_gpu_work_id_enable_[gpu_work_index])
-			{
-				gpu_wait_signal_.Wait(&gpu_wait_fence_, inflight_gpu_work_id_[gpu_work_index]);
-				inflight_gpu_work_id_enable_[gpu_work_index] = false;
-			}
-		}
+		frame_pacer_.WaitAll();
+	}
+
+	void GraphicsFramework::SetMaxFramesInFlight(u32 count)
+	{
+		// Swapchainのバッファ数を超えて先行してもPresentでブロックされるだけのため制限する.
+		const u32 swapchain_buffer_count = std::max<u32>(device_.GetDesc().swapchain_buffer_count, 1);
+		frame_pacer_.SetMaxFramesInFlight(std::min(count, swapchain_buffer_count));
+	}
+	u32 GraphicsFramework::GetMaxFramesInFlight() const
+	{
+		return frame_pacer_.GetMaxFramesInFlight();
+	}
+	FramePacer::Statistics GraphicsFramework::GetFramePacerStatistics() const
+	{
+		return frame_pacer_.GetStatistics();
 	}
 
 
@@ -0,0 +1,92 @@
+﻿/*
+    bindless_material_buffer.cpp
+*/
+
+#include "gfx/material/bindless_material_buffer.h"
+
+#include "rhi/d3d12/device.d3d12.h"
+
+namespace ngl
+{
+namespace gfx
+{
+    BindlessMaterialBuffer::~BindlessMaterialBuffer()
+    {
+        Finalize();
+    }
+
+    bool BindlessMaterialBuffer::Initialize(rhi::DeviceDep* p_device, const BindlessMaterialTable::Desc& desc)
+    {
+        if (!p_device || !table_.Initialize(desc))
+            return false;
+
+        // GPUから参照され得る最大フレーム数 + 書き込み中の1.
+        const u32 num_buffer = p_device->GetDesc().swapchain_buffer_count + 1;
+        frame_buffer_.resize(num_buffer);
+        for (auto& e : frame_buffer_)
+        {
+            rhi::BufferDep::Desc buffer_desc = {};
+            buffer_desc.element_byte_size = sizeof(BindlessMaterialEntry);
+            buffer_desc.element_count = desc.max_material;
+            buffer_desc.bind_flag = rhi::ResourceBindFlag::ShaderResource;
+            buffer_desc.heap_type = rhi::EResourceHeapType::Upload;
+            buffer_desc.initial_state = rhi::EResourceState::General;
+
+            e.buffer.Reset(new rhi::BufferDep());
+            if (!e.buffer->Initialize(p_device, buffer_desc, "BindlessMaterialTable"))
+            {
+                assert(false);
+                return false;
+            }
+            e.srv.Reset(new rhi::ShaderResourceViewDep());
+            if (!e.srv->InitializeAsStructured(p_device, e.buffer.Get(), buffer_desc.element_byte_size, 0, buffer_desc.element_count))
+            {
+                assert(false);
+                return false;
+            }
+            e.uploaded_revision = 0;
+        }
+
+        p_device_ = p_device;
+        last_update_frame_ = ~u64(0);
+        current_buffer_ = 0;
+        return true;
+    }
+
+    void BindlessMaterialBuffer::Finalize()
+    {
+        frame_buffer_.clear();
+        table_.Finalize();
+        p_device_ = {};
+    }
+
+    const rhi::ShaderResourceViewDep* BindlessMaterialBuffer::GetFrameSrv()
+    {
+        if (!p_device_)
+            return nullptr;
+
+        std::scoped_lock lock(mutex_);
+        const u64 frame_index = p_device_->GetDeviceFrameIndex();
+        if (last_update_frame_ != frame_index)
+        {
+            last_update_frame_ = frame_index;
+            current_buffer_ = static_cast<u32>(frame_index % frame_buffer_.size());
+
+            auto& e = frame_buffer_[current_buffer_];
+            u32 begin = 0, end = 0;
+            // リビジョン取得を先に行い, 以降の更新は次回反映とする.
+            const u64 revision = table_.GetRevision();
+            if (table_.GetDirtyRange(e.uploaded_revision, begin, end))
+            {
+                if (auto* p_mapped = e.buffer->MapAs<BindlessMaterialEntry>())
+                {
+                    table_.Pack(p_mapped + begin, (table_.GetMaxMaterial() - begin) * static_cast<u32>(sizeof(BindlessMaterialEntry)), begin, end);
+                    e.buffer->Unmap();
+                }
+            }
+            e.uploaded_revision = revision;
+        }
+        return frame_buffer_[current_buffer_].srv.Get();
+    }
+}
+}
@@ -0,0 +1,257 @@
+﻿
+#include "gfx/material/bindless_material_table.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+namespace ngl
+{
+namespace gfx
+{
+    BindlessMaterialTable::BindlessMaterialTable()
+    {
+    }
+    BindlessMaterialTable::~BindlessMaterialTable()
+    {
+        Finalize();
+    }
+
+    bool BindlessMaterialTable::Initialize(const Desc& desc)
+    {
+        if (0 == desc.max_material)
+        {
+            assert(false);
+            return false;
+        }
+
+        std::scoped_lock lock(mutex_);
+        desc_ = desc;
+        entry_array_.assign(desc_.max_material, MakeDefaultEntry());
+        entry_revision_.assign(desc_.max_material, 0);
+        allocated_flag_.assign(desc_.max_material, 0);
+        free_slot_.clear();
+        num_slot_ = 0;
+        revision_ = 0;
+        return true;
+    }
+    void BindlessMaterialTable::Finalize()
+    {
+        std::scoped_lock lock(mutex_);
+        entry_array_.clear();
+        entry_revision_.clear();
+        allocated_flag_.clear();
+        free_slot_.clear();
+        num_slot_ = 0;
+    }
+
+    u32 BindlessMaterialTable::AllocateSlot()
+    {
+        std::scoped_lock lock(mutex_);
+
+        u32 slot = k_invalid_slot;
+        if (!free_slot_.empty())
+        {
+            slot = free_slot_.back();
+            free_slot_.pop_back();
+        }
+        else if (num_slot_ < desc_.max_material)
+        {
+            slot = num_slot_++;
+        }
+        else
+        {
+            return k_invalid_slot;
+        }
+
+        allocated_flag_[slot] = 1;
+        entry_array_[slot] = MakeDefaultEntry();
+        MarkDirty(slot);
+        return slot;
+    }
+
+    void BindlessMaterialTable::FreeSlot(u32 slot)
+    {
+        std::scoped_lock lock(mutex_);
+        if (slot >= num_slot_ || !allocated_flag_[slot])
+        {
+            assert(false);
+            return;
+        }
+        allocated_flag_[slot] = 0;
+        // 解放後に参照されても破綻しないようにデフォルトへ戻す.
+        entry_array_[slot] = MakeDefaultEntry();
+        MarkDirty(slot);
+        free_slot_.push_back(slot);
+    }
+
+    void BindlessMaterialTable::SetTexture(u32 slot, EBindlessMaterialTexture::Type type, u32 texture_index)
+    {
+        std::scoped_lock lock(mutex_);
+        if (slot >= num_slot_ || !allocated_flag_[slot] || EBindlessMaterialTexture::_MAX <= type)
+        {
+            assert(false);
+            return;
+        }
+        const u32 v = (k_invalid_texture_index != texture_index) ? texture_index : desc_.default_texture_index[type];
+        if (entry_array_[slot].texture_index[type] == v)
+            return;
+        entry_array_[slot].texture_index[type] = v;
+        MarkDirty(slot);
+    }
+
+    void BindlessMaterialTable::SetFlags(u32 slot, u32 flags)
+    {
+        std::scoped_lock lock(mutex_);
+        if (slot >= num_slot_ || !allocated_flag_[slot])
+        {
+            assert(false);
+            return;
+        }
+        if (entry_array_[slot].flags == flags)
+            return;
+        entry_array_[slot].flags = flags;
+        MarkDirty(slot);
+    }
+
+    BindlessMaterialEntry BindlessMaterialTable::GetEntry(u32 slot) const
+    {
+        std::scoped_lock lock(mutex_);
+        if (slot >= num_slot_)
+            return MakeDefaultEntry();
+        return entry_array_[slot];
+    }
+
+    u32 BindlessMaterialTable::NumSlot() const
+    {
+        std::scoped_lock lock(mutex_);
+        return num_slot_;
+    }
+    u64 BindlessMaterialTable::GetRevision() const
+    {
+        std::scoped_lock lock(mutex_);
+        return revision_;
+    }
+
+    bool BindlessMaterialTable::GetDirtyRange(u64 since_revision, u32& out_begin, u32& out_end) const
+    {
+        std::scoped_lock lock(mutex_);
+        out_begin = 0;
+        out_end = 0;
+        if (since_revision >= revision_)
+            return false;
+
+        u32 begin = num_slot_;
+        u32 end = 0;
+        for (u32 i = 0; i < num_slot_; ++i)
+        {
+            if (since_revision < entry_revision_[i])
+            {
+                begin = std::min(begin, i);
+                end = i + 1;
+            }
+        }
+        if (begin >= end)
+            return false;
+
+        out_begin = begin;
+        out_end = end;
+        return true;
+    }
+
+    u32 BindlessMaterialTable::Pack(void* p_dst, u32 dst_byte_size, u32 begin, u32 end) const
+    {
+        std::scoped_lock lock(mutex_);
+        end = std::min(end, num_slot_);
+        if (!p_dst || begin >= end)
+            return 0;
+
+        const u32 byte_size = (end - begin) * static_cast<u32>(sizeof(BindlessMaterialEntry));
+        if (dst_byte_size < byte_size)
+        {
+            assert(false);
+            return 0;
+        }
+        std::memcpy(p_dst, &entry_array_[begin], byte_size);
+        return byte_size;
+    }
+
+    void BindlessMaterialTable::MarkDirty(u32 slot)
+    {
+        entry_revision_[slot] = ++revision_;
+    }
+
+    BindlessMaterialEntry BindlessMaterialTable::MakeDefaultEntry() const
+    {
+        BindlessMaterialEntry entry = {};
+        std::copy(std::begin(desc_.default_texture_index), std::end(desc_.default_texture_index), std::begin(entry.texture_index));
+        return entry;
+    }
+
+
+    void TestBindlessMaterialTable()
+    {
+        bool is_ok = true;
+
+        BindlessMaterialTable::Desc desc = {};
+        desc.max_material = 64;
+        for (u32 i = 0; i < EBindlessMaterialTexture::_MAX; ++i)
+            desc.default_texture_index[i] = 100 + i;
+
+        BindlessMaterialTable table;
+        is_ok &= table.Initialize(desc);
+
+        // 確保直後はデフォルトテクスチャ. 未設定指定でもデフォルトに戻る.
+        const u32 slot_a = table.AllocateSlot();
+        const u32 slot_b = table.AllocateSlot();
+        is_ok &= (0 == slot_a) && (1 == slot_b);
+        is_ok &= (100 == table.GetEntry(slot_a).texture_index[EBindlessMaterialTexture::BASE_COLOR]);
+        table.SetTexture(slot_b, EBindlessMaterialTexture::NORMAL, 7);
+        is_ok &= (7 == table.GetEntry(slot_b).texture_index[EBindlessMaterialTexture::NORMAL]);
+        table.SetTexture(slot_b, EBindlessMaterialTexture::NORMAL, BindlessMaterialTable::k_invalid_texture_index);
+        is_ok &= (101 == table.GetEntry(slot_b).texture_index[EBindlessMaterialTexture::NORMAL]);
+
+        // 更新範囲の追跡. 反映済みリビジョン以降に更新したスロットのみが範囲に入る.
+        u32 begin = 0, end = 0;
+        for (u32 i = 0; i < 30; ++i)
+            table.AllocateSlot();
+        u64 uploaded_revision = table.GetRevision();
+        is_ok &= !table.GetDirtyRange(uploaded_revision, begin, end);
+
+        table.SetTexture(5, EBindlessMaterialTexture::ROUGHNESS, 20);
+        table.SetFlags(12, 3);
+        is_ok &= table.GetDirtyRange(uploaded_revision, begin, end) && (5 == begin) && (13 == end);
+        // 同じ値の設定は更新扱いにしない.
+        const u64 revision_before = table.GetRevision();
+        table.SetFlags(12, 3);
+        is_ok &= (revision_before == table.GetRevision());
+
+        // Pack. GPUレイアウトとしてそのまま参照できること.
+        {
+            std::vector<BindlessMaterialEntry> gpu_buffer(table.GetMaxMaterial());
+            const u32 byte_size = table.Pack(&gpu_buffer[begin], static_cast<u32>((gpu_buffer.size() - begin) * sizeof(BindlessMaterialEntry)), begin, end);
+            is_ok &= ((end - begin) * sizeof(BindlessMaterialEntry) == byte_size);
+            is_ok &= (20 == gpu_buffer[5].texture_index[EBindlessMaterialTexture::ROUGHNESS]) && (3 == gpu_buffer[12].flags);
+            // 範囲外は書き込まれない.
+            is_ok &= (0 == gpu_buffer[4].texture_index[0]) && (0 == gpu_buffer[13].texture_index[0]);
+        }
+
+        // 解放したスロットはデフォルトに戻り, 再利用される. 他スロットは不変.
+        uploaded_revision = table.GetRevision();
+        table.FreeSlot(5);
+        is_ok &= table.GetDirtyRange(uploaded_revision, begin, end) && (5 == begin) && (6 == end);
+        is_ok &= (103 == table.GetEntry(5).texture_index[EBindlessMaterialTexture::ROUGHNESS]);
+        is_ok &= (5 == table.AllocateSlot());
+        is_ok &= (3 == table.GetEntry(12).flags);
+
+        // 容量超過.
+        while (BindlessMaterialTable::k_invalid_slot != table.AllocateSlot()) {}
+        is_ok &= (desc.max_material == table.NumSlot());
+
+        std::cout << "[TestBindlessMaterialTable] slot=" << table.NumSlot() << " revision=" << table.GetRevision();
+        std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+        assert(is_ok);
+    }
+}
+}
@@ -99,6 +99,8 @@ namespace gfx
         rhi::RhiRef<rhi::GraphicsPipelineStateDep> ref_pso = {};
         // 頂点シェーダが要求するInputSemanticsMask.
         MeshVertexSemanticSlotMask vs_in_slot_mask = {};
+        // 頂点入力のフォーマット.
+        EMeshVertexFormat::Type vs_in_format = EMeshVertexFormat::FLOAT;
     };
     struct MaterialPassPsoSet
     {
@@ -115,7 +117,7 @@ namespace gfx
             pso_lib.clear();
         }
 
-        int FindMatching(const char* pass_name, MeshVertexSemanticSlotMask vs_in_slot) const
+        int FindMatching(const char* pass_name, MeshVertexSemanticSlotMask vs_in_slot, EMeshVertexFormat::Type vs_in_format) const
         {
 #if 1
             // 完全一致ではなくても, vs_in_slotのスロットをなるべく使用するものを選択する.
@@ -126,6 +128,9 @@ namespace gfx
                 const auto& e = pso_lib[i];
                 if(e->pass_name != pass_name)
                     continue;
+                // InputLayoutのフォーマットが異なるため頂点フォーマットは一致が必要.
+                if(e->vs_in_format != vs_in_format)
+                    continue;
                 
                 const auto match_mask = (e->vs_in_slot_mask.mask & vs_in_slot.mask);
                 // 少なくともシェーダ側が要求するマスクがvs_in_slot側にあるものだけ通過する.
@@ -146,6 +151,8 @@ namespace gfx
                 const auto& e = pso_lib[i];
                 if(e->pass_name != pass_name)
                     continue;
+                if(e->vs_in_format != vs_in_format)
+                    continue;
                 if(e->vs_in_slot_mask.mask != vs_in_slot.mask)
                     continue;
 
@@ -424,12 +431,12 @@ namespace gfx
         registered_pass_name_list_.push_back(name);
     }
 
-    MaterialPsoSet MaterialShaderManager::GetMaterialPsoSet(const char* material_name, MeshVertexSemanticSlotMask vsin_slot)
+    MaterialPsoSet MaterialShaderManager::GetMaterialPsoSet(const char* material_name, MeshVertexSemanticSlotMask vsin_slot, EMeshVertexFormat::Type vsin_format)
     {
         MaterialPsoSet ret = {};
         for(int pass_i = 0; pass_i < registered_pass_name_list_.size(); ++pass_i)
         {
-            if(auto* p_pso = CreateMaterialPipeline(material_name, registered_pass_name_list_[pass_i].c_str(), vsin_slot))
+            if(auto* p_pso = CreateMaterialPipeline(material_name, registered_pass_name_list_[pass_i].c_str(), vsin_slot, vsin_format))
             {
                 ret.pass_name_list.push_back(registered_pass_name_list_[pass_i]);
                 ret.p_pso_list.push_back(p_pso);
@@ -442,7 +449,7 @@ namespace gfx
         return ret;
     }
     // マテリアル名と追加情報からPipeline生成またはCacheから取得.
-    rhi::GraphicsPipelineStateDep* MaterialShaderManager::CreateMaterialPipeline(const char* material_name, const char* pass_name, MeshVertexSemanticSlotMask vsin_slot)
+    rhi::GraphicsPipelineStateDep* MaterialShaderManager::CreateMaterialPipeline(const char* material_name, const char* pass_name, MeshVertexSemanticSlotMask vsin_slot, EMeshVertexFormat::Type vsin_format)
     {
         // 無効なPassの場合はnullptr.
         if(registered_pass_pso_creator_map_.end() == registered_pass_pso_creator_map_.find(pass_name))
@@ -480,7 +487,7 @@ namespace gfx
             std::lock_guard<std::mutex> lock(p_mtl_pso_set->pso_lib_mutex_);
 
             // 生成済みMaterialPsoSetから検索. vs_inの完全一致だと用意されていないシェーダのvs_inパターンが足りないため, 可能な限り一致するものを検索する.
-            int find_match_pso_index = p_mtl_pso_set->FindMatching(pass_name, vsin_slot);
+            int find_match_pso_index = p_mtl_pso_set->FindMatching(pass_name, vsin_slot, vsin_format);
             if(0 <= find_match_pso_index)
             {
                 // Cacheにあれば即座に返却.
@@ -503,6 +510,7 @@ namespace gfx
 
                         // InputLayoutMask.
                         pso_desc.vs_input_layout_mask = shader_set->vs_in_slot_mask;
+                        pso_desc.vs_input_format = vsin_format;
                         // TODO. option.
                     }
                     // Passに対応したCreatorで生成.
@@ -522,6 +530,7 @@ namespace gfx
                     new_elem->pass_name = pass_name;
                     new_elem->ref_pso = ref_pso;
                     new_elem->vs_in_slot_mask = vs_require_input_mask;
+                    new_elem->vs_in_format = vsin_format;
                 }
                 // 返却.
                 return new_elem->ref_pso.Get();
@@ -530,9 +539,9 @@ namespace gfx
     }
 
     // VS Input Semantic MaskからInputElementを生成.
-    //  本来は対応するMeshのSemanticに対応するBufferのFormatを参照すべきだが, とりあえずSemantic毎に固定されているものとして記述.
+    //  本来は対応するMeshのSemanticに対応するBufferのFormatを参照すべきだが, とりあえずSemantic毎と頂点フォーマット毎に固定されているものとして記述.
     template<typename INPUT_ELEMENT_ARRAY>
-    void SetupInputElementArrayDefault(INPUT_ELEMENT_ARRAY& inout_input_elem_data, int& out_num_element, MeshVertexSemanticSlotMask vs_input_mask)
+    void SetupInputElementArrayDefault(INPUT_ELEMENT_ARRAY& inout_input_elem_data, int& out_num_element, MeshVertexSemanticSlotMask vs_input_mask, EMeshVertexFormat::Type vs_input_format)
     {
         int elem_index = 0;
         auto mask = vs_input_mask.mask;
@@ -549,31 +558,33 @@ namespace gfx
                 inout_input_elem_data[elem_index].element_offset = 0;// 非Interleavedなバッファ前提なのでオフセット無し.
 
                 // TODO. formatはMesh側から引かないとわからないが,とりあえず固定パターン.
+                const bool is_quantized = EMeshVertexFormat::QUANTIZED == vs_input_format;
                 switch(semantic_type)
                 {
                 case ngl::gfx::EMeshVertexSemanticKind::POSITION:
                     {
-                        inout_input_elem_data[elem_index].format = ngl::rhi::EResourceFormat::Format_R32G32B32_FLOAT;
+                        inout_input_elem_data[elem_index].format = (is_quantized)? ngl::rhi::EResourceFormat::Format_R16G16B16A16_UNORM : ngl::rhi::EResourceFormat::Format_R32G32B32_FLOAT;
                         break;
                     }
                 case ngl::gfx::EMeshVertexSemanticKind::NORMAL:
                     {
-                        inout_input_elem_data[elem_index].format = ngl::rhi::EResourceFormat::Format_R32G32B32_FLOAT;
+                        inout_input_elem_data[elem_index].format = (is_quantized)? ngl::rhi::EResourceFormat::Format_R16G16_UNORM : ngl::rhi::EResourceFormat::Format_R32G32B32_FLOAT;
                         break;
                     }
                 case ngl::gfx::EMeshVertexSemanticKind::TANGENT:
                     {
-                        inout_input_elem_data[elem_index].format = ngl::rhi::EResourceFormat::Format_R32G32B32_FLOAT;
+                        inout_input_elem_data[elem_index].format = (is_quantized)? ngl::rhi::EResourceFormat::Format_R16G16_UNORM : ngl::rhi::EResourceFormat::Format_R32G32B32_FLOAT;
                         break;
                     }
                 case ngl::gfx::EMeshVertexSemanticKind::BINORMAL:
                     {
+                        // 量子化フォーマットではストリームが無いためシェーダ側で要求されないが, 要求された場合はfloatとする.
                         inout_input_elem_data[elem_index].format = ngl::rhi::EResourceFormat::Format_R32G32B32_FLOAT;
                         break;
                     }
                 case ngl::gfx::EMeshVertexSemanticKind::TEXCOORD:
                     {
-                        inout_input_elem_data[elem_index].format = ngl::rhi::EResourceFormat::Format_R32G32_FLOAT;
+                        inout_input_elem_data[elem_index].format = (is_quantized)? ngl::rhi::EResourceFormat::Format_R16G16_FLOAT : ngl::rhi::EResourceFormat::Format_R32G32_FLOAT;
                         break;
                     }
                 case ngl::gfx::EMeshVertexSemanticKind::COLOR:
@@ -613,7 +624,7 @@ namespace gfx
         std::array<ngl::rhi::InputElement, 16> input_elem_data;// 最大数は適当.
         {
             int elem_index = 0;
-            SetupInputElementArrayDefault(input_elem_data, elem_index, pass_pso_desc.vs_input_layout_mask);
+            SetupInputElementArrayDefault(input_elem_data, elem_index, pass_pso_desc.vs_input_layout_mask, pass_pso_desc.vs_input_format);
 
             desc.input_layout.p_input_elements = input_elem_data.data();
             desc.input_layout.num_elements = static_cast<ngl::u32>(elem_index);
@@ -649,7 +660,7 @@ namespace gfx
         std::array<ngl::rhi::InputElement, 16> input_elem_data;// 最大数は適当.
         {
             int elem_index = 0;
-            SetupInputElementArrayDefault(input_elem_data, elem_index, pass_pso_desc.vs_input_layout_mask);
+            SetupInputElementArrayDefault(input_elem_data, elem_index, pass_pso_desc.vs_input_layout_mask, pass_pso_desc.vs_input_format);
 
             desc.input_layout.p_input_elements = input_elem_data.data();
             desc.input_layout.num_elements = static_cast<ngl::u32>(elem_index);
@@ -676,7 +687,7 @@ namespace gfx
         std::array<ngl::rhi::InputElement, 16> input_elem_data;// 最大数は適当.
         {
             int elem_index = 0;
-            SetupInputElementArrayDefault(input_elem_data, elem_index, pass_pso_desc.vs_input_layout_mask);
+            SetupInputElementArrayDefault(input_elem_data, elem_index, pass_pso_desc.vs_input_layout_mask, pass_pso_desc.vs_input_format);
 
             desc.input_layout.p_input_elements = input_elem_data.data();
             desc.input_layout.num_elements = static_cast<ngl::u32>(elem_index);
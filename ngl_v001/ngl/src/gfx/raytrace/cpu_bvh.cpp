@@ -0,0 +1,1159 @@
+﻿#include "gfx/raytrace/cpu_bvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include <xmmintrin.h>
+
+#include "thread/job_thread.h"
+#include "util/bit_operation.h"
+
+namespace ngl
+{
+	namespace gfx
+	{
+		void CpuBvhAabb::Expand(const math::Vec3& p)
+		{
+			bb_min = math::Vec3(std::min(bb_min.x, p.x), std::min(bb_min.y, p.y), std::min(bb_min.z, p.z));
+			bb_max = math::Vec3(std::max(bb_max.x, p.x), std::max(bb_max.y, p.y), std::max(bb_max.z, p.z));
+		}
+		void CpuBvhAabb::Expand(const CpuBvhAabb& v)
+		{
+			bb_min = math::Vec3(std::min(bb_min.x, v.bb_min.x), std::min(bb_min.y, v.bb_min.y), std::min(bb_min.z, v.bb_min.z));
+			bb_max = math::Vec3(std::max(bb_max.x, v.bb_max.x), std::max(bb_max.y, v.bb_max.y), std::max(bb_max.z, v.bb_max.z));
+		}
+		math::Vec3 CpuBvhAabb::Center() const
+		{
+			return (bb_min + bb_max) * 0.5f;
+		}
+		float CpuBvhAabb::SurfaceArea() const
+		{
+			if (!IsValid())
+				return 0.0f;
+			const math::Vec3 e = bb_max - bb_min;
+			return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+		}
+
+		CpuBvhFrustum CpuBvhFrustum::FromViewProjection(const math::Mat44& view_proj)
+		{
+			const auto& m = view_proj.m;
+			const auto Row = [&m](int r) { return math::Vec4(m[r][0], m[r][1], m[r][2], m[r][3]); };
+			const auto Add = [](const math::Vec4& a, const math::Vec4& b) { return math::Vec4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); };
+			const auto Sub = [](const math::Vec4& a, const math::Vec4& b) { return math::Vec4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); };
+
+			CpuBvhFrustum out = {};
+			out.plane[0] = Add(Row(3), Row(0));	// left.
+			out.plane[1] = Sub(Row(3), Row(0));	// right.
+			out.plane[2] = Add(Row(3), Row(1));	// bottom.
+			out.plane[3] = Sub(Row(3), Row(1));	// top.
+			out.plane[4] = Row(2);				// z >= 0.
+			out.plane[5] = Sub(Row(3), Row(2));	// z <= w.
+			for (auto& p : out.plane)
+			{
+				const float len = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+				if (0.0f < len)
+				{
+					const float inv = 1.0f / len;
+					p = math::Vec4(p.x * inv, p.y * inv, p.z * inv, p.w * inv);
+				}
+			}
+			return out;
+		}
+
+		namespace
+		{
+			// 2分木の部分木の最大深度. 超える場合は中央値分割として深度を抑える.
+			//	走査スタックサイズの上限保証用.
+			constexpr u32 k_max_sah_depth = 48;
+			// 走査スタックサイズ.
+			constexpr u32 k_traverse_stack_size = 512;
+
+			struct BuildNode
+			{
+				CpuBvhAabb aabb = {};
+				u32 left = k_cpu_bvh_invalid_index;
+				u32 right = k_cpu_bvh_invalid_index;
+				u32 first = 0;
+				u32 count = 0;	// 1以上でリーフ.
+
+				bool IsLeaf() const { return 0 < count; }
+			};
+
+			struct BuildTask
+			{
+				u32 node_index = 0;
+				u32 begin = 0;
+				u32 end = 0;
+				u32 depth = 0;
+			};
+
+			struct BuildContext
+			{
+				const std::vector<CpuBvhAabb>* prim_aabb = nullptr;
+				std::vector<math::Vec3> centroid;
+				u32* prim_index = nullptr;
+				CpuBvhBuildDesc desc = {};
+			};
+
+			float Axis(const math::Vec3& v, int axis)
+			{
+				return (0 == axis) ? v.x : ((1 == axis) ? v.y : v.z);
+			}
+
+			// [begin, end) をノード化する. defer_task が有効な場合は閾値未満の部分木をタスクとして後回しにする.
+			u32 BuildRecursive(BuildContext& ctx, std::vector<BuildNode>& nodes, u32 begin, u32 end, u32 depth, std::vector<BuildTask>* defer_task)
+			{
+				const u32 node_index = static_cast<u32>(nodes.size());
+				nodes.push_back({});
+
+				const u32 count = end - begin;
+				CpuBvhAabb aabb = {};
+				CpuBvhAabb centroid_aabb = {};
+				for (u32 i = begin; i < end; ++i)
+				{
+					const u32 prim = ctx.prim_index[i];
+					aabb.Expand((*ctx.prim_aabb)[prim]);
+					centroid_aabb.Expand(ctx.centroid[prim]);
+				}
+				nodes[node_index].aabb = aabb;
+
+				if (defer_task && count < ctx.desc.parallel_primitive_threshold)
+				{
+					defer_task->push_back({ node_index, begin, end, depth });
+					return node_index;
+				}
+
+				const auto MakeLeaf = [&]()
+				{
+					nodes[node_index].first = begin;
+					nodes[node_index].count = count;
+					return node_index;
+				};
+				if (1 >= count)
+					return MakeLeaf();
+
+				// Binned SAH. 全軸で評価する.
+				const u32 num_bin = std::clamp(ctx.desc.num_bin, 2u, 64u);
+				int best_axis = -1;
+				u32 best_split = 0;
+				float best_cost = FLT_MAX;
+				if (k_max_sah_depth > depth)
+				{
+					CpuBvhAabb bin_aabb[64];
+					u32 bin_count[64];
+					float right_area[64];
+					u32 right_count[64];
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						const float c_min = Axis(centroid_aabb.bb_min, axis);
+						const float extent = Axis(centroid_aabb.bb_max, axis) - c_min;
+						if (!(0.0f < extent))
+							continue;
+						const float scale = static_cast<float>(num_bin) / extent;
+
+						for (u32 b = 0; b < num_bin; ++b)
+						{
+							bin_aabb[b] = {};
+							bin_count[b] = 0;
+						}
+						for (u32 i = begin; i < end; ++i)
+						{
+							const u32 prim = ctx.prim_index[i];
+							const u32 b = std::min(num_bin - 1, static_cast<u32>((Axis(ctx.centroid[prim], axis) - c_min) * scale));
+							bin_aabb[b].Expand((*ctx.prim_aabb)[prim]);
+							++bin_count[b];
+						}
+
+						// 右側から累積.
+						{
+							CpuBvhAabb acc = {};
+							u32 acc_count = 0;
+							for (u32 b = num_bin - 1; 0 < b; --b)
+							{
+								acc.Expand(bin_aabb[b]);
+								acc_count += bin_count[b];
+								right_area[b] = acc.SurfaceArea();
+								right_count[b] = acc_count;
+							}
+						}
+						// 左側から累積してbの手前で分割した場合のコスト.
+						{
+							CpuBvhAabb acc = {};
+							u32 acc_count = 0;
+							for (u32 b = 1; b < num_bin; ++b)
+							{
+								acc.Expand(bin_aabb[b - 1]);
+								acc_count += bin_count[b - 1];
+								if (0 == acc_count || 0 == right_count[b])
+									continue;
+								const float cost = acc.SurfaceArea() * static_cast<float>(acc_count) + right_area[b] * static_cast<float>(right_count[b]);
+								if (cost < best_cost)
+								{
+									best_cost = cost;
+									best_axis = axis;
+									best_split = b;
+								}
+							}
+						}
+					}
+				}
+
+				u32 mid = begin;
+				if (0 <= best_axis)
+				{
+					const float area = aabb.SurfaceArea();
+					const float split_cost = ctx.desc.traversal_cost + ((0.0f < area) ? (best_cost / area) : 0.0f);
+					const float leaf_cost = static_cast<float>(count);
+					if (count <= ctx.desc.max_leaf_primitive && leaf_cost <= split_cost)
+						return MakeLeaf();
+
+					const float c_min = Axis(centroid_aabb.bb_min, best_axis);
+					const float scale = static_cast<float>(num_bin) / (Axis(centroid_aabb.bb_max, best_axis) - c_min);
+					const u32* split_pos = std::partition(ctx.prim_index + begin, ctx.prim_index + end, [&](u32 prim)
+						{
+							const u32 b = std::min(num_bin - 1, static_cast<u32>((Axis(ctx.centroid[prim], best_axis) - c_min) * scale));
+							return b < best_split;
+						});
+					mid = static_cast<u32>(split_pos - ctx.prim_index);
+				}
+				else if (count <= ctx.desc.max_leaf_primitive)
+				{
+					return MakeLeaf();
+				}
+
+				if (begin == mid || end == mid)
+				{
+					// SAHで分割できない場合 (重心が同一, 深度超過) は最長軸の中央値で分割.
+					const math::Vec3 extent = centroid_aabb.IsValid() ? (centroid_aabb.bb_max - centroid_aabb.bb_min) : math::Vec3(0.0f);
+					const int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : ((extent.y >= extent.z) ? 1 : 2);
+					mid = begin + count / 2;
+					std::nth_element(ctx.prim_index + begin, ctx.prim_index + mid, ctx.prim_index + end, [&](u32 a, u32 b)
+						{
+							return Axis(ctx.centroid[a], axis) < Axis(ctx.centroid[b], axis);
+						});
+				}
+
+				const u32 left = BuildRecursive(ctx, nodes, begin, mid, depth + 1, defer_task);
+				const u32 right = BuildRecursive(ctx, nodes, mid, end, depth + 1, defer_task);
+				nodes[node_index].left = left;
+				nodes[node_index].right = right;
+				return node_index;
+			}
+
+			// 2分木から4分木へ変換. 表面積の大きい内部ノードから展開して子を最大4つ集める.
+			u32 CollapseToBvh4(const std::vector<BuildNode>& nodes, u32 node_index, std::vector<CpuBvh4Node>& out_node_array)
+			{
+				const u32 out_index = static_cast<u32>(out_node_array.size());
+				out_node_array.push_back({});
+
+				u32 cand[4] = {};
+				u32 num_cand = 0;
+				if (nodes[node_index].IsLeaf())
+				{
+					cand[num_cand++] = node_index;
+				}
+				else
+				{
+					cand[num_cand++] = nodes[node_index].left;
+					cand[num_cand++] = nodes[node_index].right;
+					while (4 > num_cand)
+					{
+						int open = -1;
+						float open_area = -1.0f;
+						for (u32 i = 0; i < num_cand; ++i)
+						{
+							const auto& n = nodes[cand[i]];
+							if (n.IsLeaf())
+								continue;
+							const float area = n.aabb.SurfaceArea();
+							if (open_area < area)
+							{
+								open_area = area;
+								open = static_cast<int>(i);
+							}
+						}
+						if (0 > open)
+							break;
+						const auto& n = nodes[cand[open]];
+						cand[open] = n.left;
+						cand[num_cand++] = n.right;
+					}
+				}
+
+				CpuBvh4Node node4 = {};
+				for (u32 i = 0; i < 4; ++i)
+				{
+					node4.bb_min_x[i] = node4.bb_min_y[i] = node4.bb_min_z[i] = FLT_MAX;
+					node4.bb_max_x[i] = node4.bb_max_y[i] = node4.bb_max_z[i] = -FLT_MAX;
+					node4.child[i] = k_cpu_bvh_invalid_index;
+					node4.prim_count[i] = 0;
+				}
+				for (u32 i = 0; i < num_cand; ++i)
+				{
+					const auto& n = nodes[cand[i]];
+					node4.bb_min_x[i] = n.aabb.bb_min.x;
+					node4.bb_min_y[i] = n.aabb.bb_min.y;
+					node4.bb_min_z[i] = n.aabb.bb_min.z;
+					node4.bb_max_x[i] = n.aabb.bb_max.x;
+					node4.bb_max_y[i] = n.aabb.bb_max.y;
+					node4.bb_max_z[i] = n.aabb.bb_max.z;
+					if (n.IsLeaf())
+					{
+						node4.child[i] = n.first;
+						node4.prim_count[i] = n.count;
+					}
+					else
+					{
+						node4.child[i] = CollapseToBvh4(nodes, cand[i], out_node_array);
+					}
+				}
+				out_node_array[out_index] = node4;
+				return out_index;
+			}
+
+
+			// ゼロ除算を避けた逆数.
+			float SafeRcp(float v)
+			{
+				constexpr float k_eps = 1e-20f;
+				if (std::fabs(v) < k_eps)
+					v = std::copysign(k_eps, v);
+				return 1.0f / v;
+			}
+
+			struct RayPrecalc
+			{
+				__m128 ox, oy, oz;
+				__m128 idx, idy, idz;
+				__m128 t_min;
+
+				explicit RayPrecalc(const CpuBvhRay& ray)
+				{
+					ox = _mm_set1_ps(ray.origin.x);
+					oy = _mm_set1_ps(ray.origin.y);
+					oz = _mm_set1_ps(ray.origin.z);
+					idx = _mm_set1_ps(SafeRcp(ray.direction.x));
+					idy = _mm_set1_ps(SafeRcp(ray.direction.y));
+					idz = _mm_set1_ps(SafeRcp(ray.direction.z));
+					t_min = _mm_set1_ps(ray.t_min);
+				}
+			};
+
+			// 1レイと4つの子AABBの判定. ヒットした子のビットマスクを返す.
+			int IntersectNode4(const CpuBvh4Node& node, const RayPrecalc& r, float t_max, __m128& out_t_near)
+			{
+				const __m128 tx0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bb_min_x), r.ox), r.idx);
+				const __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bb_max_x), r.ox), r.idx);
+				const __m128 ty0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bb_min_y), r.oy), r.idy);
+				const __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bb_max_y), r.oy), r.idy);
+				const __m128 tz0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bb_min_z), r.oz), r.idz);
+				const __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bb_max_z), r.oz), r.idz);
+
+				const __m128 t_near = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1)), _mm_max_ps(_mm_min_ps(tz0, tz1), r.t_min));
+				const __m128 t_far = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1)), _mm_min_ps(_mm_max_ps(tz0, tz1), _mm_set1_ps(t_max)));
+				out_t_near = t_near;
+				return _mm_movemask_ps(_mm_cmple_ps(t_near, t_far));
+			}
+
+			// 4レイと1つの子AABBの判定. ヒットしたレイのビットマスクを返す.
+			struct RayPacketPrecalc
+			{
+				__m128 ox, oy, oz;
+				__m128 idx, idy, idz;
+				__m128 t_min;
+
+				explicit RayPacketPrecalc(const CpuBvhRay* ray4)
+				{
+					ox = _mm_setr_ps(ray4[0].origin.x, ray4[1].origin.x, ray4[2].origin.x, ray4[3].origin.x);
+					oy = _mm_setr_ps(ray4[0].origin.y, ray4[1].origin.y, ray4[2].origin.y, ray4[3].origin.y);
+					oz = _mm_setr_ps(ray4[0].origin.z, ray4[1].origin.z, ray4[2].origin.z, ray4[3].origin.z);
+					idx = _mm_setr_ps(SafeRcp(ray4[0].direction.x), SafeRcp(ray4[1].direction.x), SafeRcp(ray4[2].direction.x), SafeRcp(ray4[3].direction.x));
+					idy = _mm_setr_ps(SafeRcp(ray4[0].direction.y), SafeRcp(ray4[1].direction.y), SafeRcp(ray4[2].direction.y), SafeRcp(ray4[3].direction.y));
+					idz = _mm_setr_ps(SafeRcp(ray4[0].direction.z), SafeRcp(ray4[1].direction.z), SafeRcp(ray4[2].direction.z), SafeRcp(ray4[3].direction.z));
+					t_min = _mm_setr_ps(ray4[0].t_min, ray4[1].t_min, ray4[2].t_min, ray4[3].t_min);
+				}
+			};
+			int IntersectPacketChild(const CpuBvh4Node& node, int i, const RayPacketPrecalc& r, const float* t_max4, float& out_min_t_near)
+			{
+				const __m128 tx0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bb_min_x[i]), r.ox), r.idx);
+				const __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bb_max_x[i]), r.ox), r.idx);
+				const __m128 ty0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bb_min_y[i]), r.oy), r.idy);
+				const __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bb_max_y[i]), r.oy), r.idy);
+				const __m128 tz0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bb_min_z[i]), r.oz), r.idz);
+				const __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bb_max_z[i]), r.oz), r.idz);
+
+				const __m128 t_near = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1)), _mm_max_ps(_mm_min_ps(tz0, tz1), r.t_min));
+				const __m128 t_far = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1)), _mm_min_ps(_mm_max_ps(tz0, tz1), _mm_loadu_ps(t_max4)));
+				const int mask = _mm_movemask_ps(_mm_cmple_ps(t_near, t_far));
+
+				alignas(16) float t_near_array[4];
+				_mm_store_ps(t_near_array, t_near);
+				out_min_t_near = FLT_MAX;
+				for (int k = 0; k < 4; ++k)
+				{
+					if (mask & (1 << k))
+						out_min_t_near = std::min(out_min_t_near, t_near_array[k]);
+				}
+				return mask;
+			}
+
+			// AABBと4つの子AABBの重なり判定.
+			int OverlapNode4(const CpuBvh4Node& node, const CpuBvhAabb& aabb)
+			{
+				__m128 m = _mm_cmple_ps(_mm_load_ps(node.bb_min_x), _mm_set1_ps(aabb.bb_max.x));
+				m = _mm_and_ps(m, _mm_cmple_ps(_mm_load_ps(node.bb_min_y), _mm_set1_ps(aabb.bb_max.y)));
+				m = _mm_and_ps(m, _mm_cmple_ps(_mm_load_ps(node.bb_min_z), _mm_set1_ps(aabb.bb_max.z)));
+				m = _mm_and_ps(m, _mm_cmpge_ps(_mm_load_ps(node.bb_max_x), _mm_set1_ps(aabb.bb_min.x)));
+				m = _mm_and_ps(m, _mm_cmpge_ps(_mm_load_ps(node.bb_max_y), _mm_set1_ps(aabb.bb_min.y)));
+				m = _mm_and_ps(m, _mm_cmpge_ps(_mm_load_ps(node.bb_max_z), _mm_set1_ps(aabb.bb_min.z)));
+				return _mm_movemask_ps(m);
+			}
+			// 視錐台と4つの子AABBの判定. 各平面について法線方向の最遠頂点が外側なら除外.
+			int OverlapNode4(const CpuBvh4Node& node, const CpuBvhFrustum& frustum)
+			{
+				__m128 m = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (const auto& p : frustum.plane)
+				{
+					const __m128 px = _mm_load_ps((0.0f <= p.x) ? node.bb_max_x : node.bb_min_x);
+					const __m128 py = _mm_load_ps((0.0f <= p.y) ? node.bb_max_y : node.bb_min_y);
+					const __m128 pz = _mm_load_ps((0.0f <= p.z) ? node.bb_max_z : node.bb_min_z);
+					const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(p.x)), _mm_mul_ps(py, _mm_set1_ps(p.y))),
+						_mm_add_ps(_mm_mul_ps(pz, _mm_set1_ps(p.z)), _mm_set1_ps(p.w)));
+					m = _mm_and_ps(m, _mm_cmpge_ps(d, _mm_setzero_ps()));
+				}
+				return _mm_movemask_ps(m);
+			}
+			bool OverlapAabb(const CpuBvhAabb& a, const CpuBvhAabb& b)
+			{
+				return a.bb_min.x <= b.bb_max.x && a.bb_min.y <= b.bb_max.y && a.bb_min.z <= b.bb_max.z
+					&& a.bb_max.x >= b.bb_min.x && a.bb_max.y >= b.bb_min.y && a.bb_max.z >= b.bb_min.z;
+			}
+			bool OverlapAabb(const CpuBvhAabb& a, const CpuBvhFrustum& frustum)
+			{
+				for (const auto& p : frustum.plane)
+				{
+					const float px = (0.0f <= p.x) ? a.bb_max.x : a.bb_min.x;
+					const float py = (0.0f <= p.y) ? a.bb_max.y : a.bb_min.y;
+					const float pz = (0.0f <= p.z) ? a.bb_max.z : a.bb_min.z;
+					if (0.0f > px * p.x + py * p.y + pz * p.z + p.w)
+						return false;
+				}
+				return true;
+			}
+
+
+			// 最大4要素のt_nearの降順ソート.
+			template<typename T>
+			void SortFarToNear(T* entry, u32 count)
+			{
+				for (u32 i = 1; i < count; ++i)
+				{
+					const T e = entry[i];
+					u32 k = i;
+					for (; 0 < k && entry[k - 1].t_near < e.t_near; --k)
+						entry[k] = entry[k - 1];
+					entry[k] = e;
+				}
+			}
+
+			// 単一レイ走査. leaf_func(first, count, io_t_max) はヒットした場合に io_t_max を更新して true を返す.
+			//	k_any_hit の場合は最初のヒットで終了する.
+			template<bool k_any_hit, typename LeafFunc>
+			bool TraverseRay(const std::vector<CpuBvh4Node>& node_array, const CpuBvhRay& ray, float& io_t_max, LeafFunc&& leaf_func)
+			{
+				if (node_array.empty())
+					return false;
+
+				struct StackEntry
+				{
+					u32 node;
+					float t_near;
+				};
+				StackEntry stack[k_traverse_stack_size];
+				u32 sp = 0;
+				stack[sp++] = { 0, ray.t_min };
+
+				const RayPrecalc r(ray);
+				bool is_hit = false;
+				while (0 < sp)
+				{
+					const StackEntry e = stack[--sp];
+					if (e.t_near > io_t_max)
+						continue;
+
+					const CpuBvh4Node& node = node_array[e.node];
+					__m128 t_near4;
+					int mask = IntersectNode4(node, r, io_t_max, t_near4);
+					alignas(16) float t_near_array[4];
+					_mm_store_ps(t_near_array, t_near4);
+
+					StackEntry inner[4];
+					u32 num_inner = 0;
+					for (; 0 != mask; mask &= mask - 1)
+					{
+						const u32 i = static_cast<u32>(LeastSignificantBit32(static_cast<u32>(mask)));
+						if (k_cpu_bvh_invalid_index == node.child[i])
+							continue;
+						if (0 < node.prim_count[i])
+						{
+							if (leaf_func(node.child[i], node.prim_count[i], io_t_max))
+							{
+								is_hit = true;
+								if constexpr (k_any_hit)
+									return true;
+							}
+						}
+						else
+						{
+							inner[num_inner++] = { node.child[i], t_near_array[i] };
+						}
+					}
+					// 近い子が先に取り出されるよう遠い順に積む.
+					SortFarToNear(inner, num_inner);
+					assert(sp + num_inner <= k_traverse_stack_size);
+					for (u32 i = 0; i < num_inner; ++i)
+						stack[sp++] = inner[i];
+				}
+				return is_hit;
+			}
+
+			// 4レイパケット走査. 子毎に4レイを同時に判定し, ヒットしたレイのマスクを伴って降りる.
+			//	leaf_func(first, count, ray_mask, io_t_max4) はヒットしたレイのマスクを返す.
+			template<typename LeafFunc>
+			u32 TraversePacket4(const std::vector<CpuBvh4Node>& node_array, const CpuBvhRay* ray4, u32 active_mask, float* io_t_max4, LeafFunc&& leaf_func)
+			{
+				if (node_array.empty() || 0 == active_mask)
+					return 0;
+
+				struct StackEntry
+				{
+					u32 node;
+					u32 mask;
+					float t_near;
+				};
+				StackEntry stack[k_traverse_stack_size];
+				u32 sp = 0;
+				stack[sp++] = { 0, active_mask, 0.0f };
+
+				const RayPacketPrecalc r(ray4);
+				u32 hit_mask = 0;
+				while (0 < sp)
+				{
+					const StackEntry e = stack[--sp];
+					const CpuBvh4Node& node = node_array[e.node];
+
+					StackEntry inner[4];
+					u32 num_inner = 0;
+					for (int i = 0; i < 4; ++i)
+					{
+						if (k_cpu_bvh_invalid_index == node.child[i])
+							continue;
+						float min_t_near;
+						const u32 mask = static_cast<u32>(IntersectPacketChild(node, i, r, io_t_max4, min_t_near)) & e.mask;
+						if (0 == mask)
+							continue;
+						if (0 < node.prim_count[i])
+							hit_mask |= leaf_func(node.child[i], node.prim_count[i], mask, io_t_max4);
+						else
+							inner[num_inner++] = { node.child[i], mask, min_t_near };
+					}
+					SortFarToNear(inner, num_inner);
+					assert(sp + num_inner <= k_traverse_stack_size);
+					for (u32 i = 0; i < num_inner; ++i)
+						stack[sp++] = inner[i];
+				}
+				return hit_mask;
+			}
+
+			// 重なり判定走査. leaf_func(first, count).
+			template<typename QueryType, typename LeafFunc>
+			void TraverseOverlap(const std::vector<CpuBvh4Node>& node_array, const QueryType& query, LeafFunc&& leaf_func)
+			{
+				if (node_array.empty())
+					return;
+
+				u32 stack[k_traverse_stack_size];
+				u32 sp = 0;
+				stack[sp++] = 0;
+				while (0 < sp)
+				{
+					const CpuBvh4Node& node = node_array[stack[--sp]];
+					for (int mask = OverlapNode4(node, query); 0 != mask; mask &= mask - 1)
+					{
+						const u32 i = static_cast<u32>(LeastSignificantBit32(static_cast<u32>(mask)));
+						if (k_cpu_bvh_invalid_index == node.child[i])
+							continue;
+						if (0 < node.prim_count[i])
+						{
+							leaf_func(node.child[i], node.prim_count[i]);
+						}
+						else
+						{
+							assert(sp < k_traverse_stack_size);
+							stack[sp++] = node.child[i];
+						}
+					}
+				}
+			}
+
+
+			// Moller-Trumbore. 両面判定.
+			bool IntersectTriangle(const CpuBvhRay& ray, const math::Vec3& v0, const math::Vec3& e1, const math::Vec3& e2, float t_max, float& out_t, float& out_u, float& out_v)
+			{
+				const math::Vec3 p = math::Vec3::Cross(ray.direction, e2);
+				const float det = math::Vec3::Dot(e1, p);
+				if (0.0f == det)
+					return false;
+				const float inv_det = 1.0f / det;
+				const math::Vec3 s = ray.origin - v0;
+				const float u = math::Vec3::Dot(s, p) * inv_det;
+				if (0.0f > u || 1.0f < u)
+					return false;
+				const math::Vec3 q = math::Vec3::Cross(s, e1);
+				const float v = math::Vec3::Dot(ray.direction, q) * inv_det;
+				if (0.0f > v || 1.0f < u + v)
+					return false;
+				const float t = math::Vec3::Dot(e2, q) * inv_det;
+				if (ray.t_min > t || t_max <= t)
+					return false;
+				out_t = t;
+				out_u = u;
+				out_v = v;
+				return true;
+			}
+
+			math::Vec3 TransformPoint(const math::Mat34& m, const math::Vec3& p)
+			{
+				return math::Vec3(
+					m.m[0][0] * p.x + m.m[0][1] * p.y + m.m[0][2] * p.z + m.m[0][3],
+					m.m[1][0] * p.x + m.m[1][1] * p.y + m.m[1][2] * p.z + m.m[1][3],
+					m.m[2][0] * p.x + m.m[2][1] * p.y + m.m[2][2] * p.z + m.m[2][3]);
+			}
+			math::Vec3 TransformVector(const math::Mat34& m, const math::Vec3& v)
+			{
+				return math::Vec3(
+					m.m[0][0] * v.x + m.m[0][1] * v.y + m.m[0][2] * v.z,
+					m.m[1][0] * v.x + m.m[1][1] * v.y + m.m[1][2] * v.z,
+					m.m[2][0] * v.x + m.m[2][1] * v.y + m.m[2][2] * v.z);
+			}
+			// Instance空間へのレイ変換. directionは正規化しないためtはワールド空間と共通.
+			CpuBvhRay TransformRay(const math::Mat34& inv_transform, const CpuBvhRay& ray)
+			{
+				CpuBvhRay out = ray;
+				out.origin = TransformPoint(inv_transform, ray.origin);
+				out.direction = TransformVector(inv_transform, ray.direction);
+				return out;
+			}
+		}
+
+
+		void CpuBvh4::Clear()
+		{
+			node_array_.clear();
+			prim_order_.clear();
+			bounds_ = {};
+		}
+
+		void CpuBvh4::Build(const std::vector<CpuBvhAabb>& prim_aabb_array, const CpuBvhBuildDesc& desc, thread::JobSystem* p_job_system)
+		{
+			Clear();
+			const u32 num_prim = static_cast<u32>(prim_aabb_array.size());
+			if (0 == num_prim)
+				return;
+
+			BuildContext ctx = {};
+			ctx.prim_aabb = &prim_aabb_array;
+			ctx.desc = desc;
+			ctx.desc.max_leaf_primitive = std::max(1u, desc.max_leaf_primitive);
+			ctx.desc.parallel_primitive_threshold = std::max(ctx.desc.max_leaf_primitive + 1, desc.parallel_primitive_threshold);
+			ctx.centroid.resize(num_prim);
+			prim_order_.resize(num_prim);
+			for (u32 i = 0; i < num_prim; ++i)
+			{
+				ctx.centroid[i] = prim_aabb_array[i].Center();
+				prim_order_[i] = i;
+			}
+			ctx.prim_index = prim_order_.data();
+
+			std::vector<BuildNode> build_node_array;
+			build_node_array.reserve(num_prim * 2);
+			if (p_job_system && ctx.desc.parallel_primitive_threshold <= num_prim)
+			{
+				// 上位を逐次分割し, 閾値未満の部分木を並列ビルドしてから結合する.
+				//	各タスクはprim_orderの互いに素な範囲のみを並べ替える.
+				std::vector<BuildTask> task_array;
+				BuildRecursive(ctx, build_node_array, 0, num_prim, 0, &task_array);
+
+				std::vector<std::vector<BuildNode>> task_node_array(task_array.size());
+				for (size_t i = 0; i < task_array.size(); ++i)
+				{
+					p_job_system->Add([&ctx, &task_array, &task_node_array, i]()
+						{
+							const auto& task = task_array[i];
+							task_node_array[i].reserve((task.end - task.begin) * 2);
+							BuildRecursive(ctx, task_node_array[i], task.begin, task.end, task.depth, nullptr);
+						});
+				}
+				p_job_system->WaitAll();
+
+				// 部分木のルートをプレースホルダノードに書き込み, 残りを末尾に追加する.
+				for (size_t i = 0; i < task_array.size(); ++i)
+				{
+					const auto& local = task_node_array[i];
+					const u32 base = static_cast<u32>(build_node_array.size());
+					const auto Remap = [base](BuildNode n)
+					{
+						if (!n.IsLeaf())
+						{
+							n.left = base + n.left - 1;
+							n.right = base + n.right - 1;
+						}
+						return n;
+					};
+					build_node_array[task_array[i].node_index] = Remap(local[0]);
+					for (size_t k = 1; k < local.size(); ++k)
+						build_node_array.push_back(Remap(local[k]));
+				}
+			}
+			else
+			{
+				BuildRecursive(ctx, build_node_array, 0, num_prim, 0, nullptr);
+			}
+
+			bounds_ = build_node_array[0].aabb;
+			node_array_.reserve(build_node_array.size() / 2 + 1);
+			CollapseToBvh4(build_node_array, 0, node_array_);
+		}
+
+
+		CpuBvhMesh::CpuBvhMesh()
+		{
+		}
+		CpuBvhMesh::~CpuBvhMesh()
+		{
+		}
+
+		bool CpuBvhMesh::Build(const GeometryInput* geometry_array, u32 num_geometry, const CpuBvhBuildDesc& desc, thread::JobSystem* p_job_system)
+		{
+			bvh_.Clear();
+			tri_v0_array_.clear();
+			tri_e1_array_.clear();
+			tri_e2_array_.clear();
+			prim_id_array_.clear();
+
+			u32 num_prim = 0;
+			for (u32 gi = 0; gi < num_geometry; ++gi)
+			{
+				if (!geometry_array[gi].position || !geometry_array[gi].index)
+					continue;
+				num_prim += geometry_array[gi].num_primitive;
+			}
+			if (0 == num_prim)
+				return false;
+
+			std::vector<CpuBvhAabb> prim_aabb_array;
+			std::vector<CpuBvhPrimitiveId> prim_id_array;
+			prim_aabb_array.reserve(num_prim);
+			prim_id_array.reserve(num_prim);
+			for (u32 gi = 0; gi < num_geometry; ++gi)
+			{
+				const auto& g = geometry_array[gi];
+				if (!g.position || !g.index)
+					continue;
+				for (u32 pi = 0; pi < g.num_primitive; ++pi)
+				{
+					CpuBvhAabb aabb = {};
+					for (u32 k = 0; k < 3; ++k)
+					{
+						const u32 vi = g.index[pi * 3 + k];
+						assert(vi < g.num_vertex);
+						aabb.Expand(g.position[vi]);
+					}
+					prim_aabb_array.push_back(aabb);
+					prim_id_array.push_back({ gi, pi });
+				}
+			}
+
+			bvh_.Build(prim_aabb_array, desc, p_job_system);
+
+			// リーフ順に三角形を並べ替えて走査時のメモリアクセスを連続化する.
+			const auto& order = bvh_.GetPrimitiveOrder();
+			tri_v0_array_.resize(num_prim);
+			tri_e1_array_.resize(num_prim);
+			tri_e2_array_.resize(num_prim);
+			prim_id_array_.resize(num_prim);
+			for (u32 i = 0; i < num_prim; ++i)
+			{
+				const auto id = prim_id_array[order[i]];
+				const auto& g = geometry_array[id.geometry_index];
+				const math::Vec3 p0 = g.position[g.index[id.primitive_index * 3 + 0]];
+				const math::Vec3 p1 = g.position[g.index[id.primitive_index * 3 + 1]];
+				const math::Vec3 p2 = g.position[g.index[id.primitive_index * 3 + 2]];
+				tri_v0_array_[i] = p0;
+				tri_e1_array_[i] = p1 - p0;
+				tri_e2_array_[i] = p2 - p0;
+				prim_id_array_[i] = id;
+			}
+			return true;
+		}
+
+		bool CpuBvhMesh::Intersect(const CpuBvhRay& ray, CpuBvhHit& out_hit) const
+		{
+			float t_max = std::min(ray.t_max, out_hit.t);
+			u32 hit_prim = k_cpu_bvh_invalid_index;
+			float hit_u = 0.0f, hit_v = 0.0f;
+			TraverseRay<false>(bvh_.GetNodeArray(), ray, t_max, [&](u32 first, u32 count, float& io_t_max)
+				{
+					bool is_hit = false;
+					for (u32 i = first; i < first + count; ++i)
+					{
+						float t, u, v;
+						if (IntersectTriangle(ray, tri_v0_array_[i], tri_e1_array_[i], tri_e2_array_[i], io_t_max, t, u, v))
+						{
+							io_t_max = t;
+							hit_prim = i;
+							hit_u = u;
+							hit_v = v;
+							is_hit = true;
+						}
+					}
+					return is_hit;
+				});
+			if (k_cpu_bvh_invalid_index == hit_prim)
+				return false;
+
+			out_hit.t = t_max;
+			out_hit.u = hit_u;
+			out_hit.v = hit_v;
+			out_hit.geometry_index = prim_id_array_[hit_prim].geometry_index;
+			out_hit.primitive_index = prim_id_array_[hit_prim].primitive_index;
+			return true;
+		}
+
+		bool CpuBvhMesh::Occluded(const CpuBvhRay& ray) const
+		{
+			float t_max = ray.t_max;
+			return TraverseRay<true>(bvh_.GetNodeArray(), ray, t_max, [&](u32 first, u32 count, float& io_t_max)
+				{
+					for (u32 i = first; i < first + count; ++i)
+					{
+						float t, u, v;
+						if (IntersectTriangle(ray, tri_v0_array_[i], tri_e1_array_[i], tri_e2_array_[i], io_t_max, t, u, v))
+							return true;
+					}
+					return false;
+				});
+		}
+
+		u32 CpuBvhMesh::IntersectPacket4(const CpuBvhRay* ray4, CpuBvhHit* out_hit4, u32 active_mask) const
+		{
+			alignas(16) float t_max4[4];
+			u32 hit_prim[4];
+			float hit_u[4], hit_v[4];
+			for (int k = 0; k < 4; ++k)
+			{
+				// 非アクティブなレイは範囲を負にして判定から除外.
+				t_max4[k] = (active_mask & (1u << k)) ? std::min(ray4[k].t_max, out_hit4[k].t) : -FLT_MAX;
+				hit_prim[k] = k_cpu_bvh_invalid_index;
+			}
+
+			const u32 hit_mask = TraversePacket4(bvh_.GetNodeArray(), ray4, active_mask, t_max4, [&](u32 first, u32 count, u32 ray_mask, float* io_t_max4)
+				{
+					u32 leaf_hit_mask = 0;
+					for (; 0 != ray_mask; ray_mask &= ray_mask - 1)
+					{
+						const int k = LeastSignificantBit32(ray_mask);
+						for (u32 i = first; i < first + count; ++i)
+						{
+							float t, u, v;
+							if (IntersectTriangle(ray4[k], tri_v0_array_[i], tri_e1_array_[i], tri_e2_array_[i], io_t_max4[k], t, u, v))
+							{
+								io_t_max4[k] = t;
+								hit_prim[k] = i;
+								hit_u[k] = u;
+								hit_v[k] = v;
+								leaf_hit_mask |= (1u << k);
+							}
+						}
+					}
+					return leaf_hit_mask;
+				});
+
+			for (int k = 0; k < 4; ++k)
+			{
+				if (!(hit_mask & (1u << k)))
+					continue;
+				out_hit4[k].t = t_max4[k];
+				out_hit4[k].u = hit_u[k];
+				out_hit4[k].v = hit_v[k];
+				out_hit4[k].geometry_index = prim_id_array_[hit_prim[k]].geometry_index;
+				out_hit4[k].primitive_index = prim_id_array_[hit_prim[k]].primitive_index;
+			}
+			return hit_mask;
+		}
+
+		void CpuBvhMesh::QueryAabb(const CpuBvhAabb& aabb, std::vector<CpuBvhPrimitiveId>& out_prim_array) const
+		{
+			TraverseOverlap(bvh_.GetNodeArray(), aabb, [&](u32 first, u32 count)
+				{
+					for (u32 i = first; i < first + count; ++i)
+					{
+						CpuBvhAabb tri_aabb = {};
+						tri_aabb.Expand(tri_v0_array_[i]);
+						tri_aabb.Expand(tri_v0_array_[i] + tri_e1_array_[i]);
+						tri_aabb.Expand(tri_v0_array_[i] + tri_e2_array_[i]);
+						if (OverlapAabb(tri_aabb, aabb))
+							out_prim_array.push_back(prim_id_array_[i]);
+					}
+				});
+		}
+		void CpuBvhMesh::QueryFrustum(const CpuBvhFrustum& frustum, std::vector<CpuBvhPrimitiveId>& out_prim_array) const
+		{
+			TraverseOverlap(bvh_.GetNodeArray(), frustum, [&](u32 first, u32 count)
+				{
+					for (u32 i = first; i < first + count; ++i)
+					{
+						CpuBvhAabb tri_aabb = {};
+						tri_aabb.Expand(tri_v0_array_[i]);
+						tri_aabb.Expand(tri_v0_array_[i] + tri_e1_array_[i]);
+						tri_aabb.Expand(tri_v0_array_[i] + tri_e2_array_[i]);
+						if (OverlapAabb(tri_aabb, frustum))
+							out_prim_array.push_back(prim_id_array_[i]);
+					}
+				});
+		}
+
+
+		CpuBvhScene::CpuBvhScene()
+		{
+		}
+		CpuBvhScene::~CpuBvhScene()
+		{
+		}
+
+		void CpuBvhScene::Build(const std::vector<InstanceInput>& instance_array, const CpuBvhBuildDesc& desc, thread::JobSystem* p_job_system)
+		{
+			bvh_.Clear();
+			instance_array_.clear();
+			instance_array_.reserve(instance_array.size());
+
+			std::vector<CpuBvhAabb> prim_aabb_array;
+			prim_aabb_array.reserve(instance_array.size());
+			for (const auto& e : instance_array)
+			{
+				assert(e.mesh);
+				Instance inst = {};
+				inst.mesh = e.mesh;
+				inst.transform = e.transform;
+				inst.inv_transform = math::Mat34::Inverse(e.transform);
+
+				// ローカルAABBの8頂点を変換したワールドAABB.
+				const CpuBvhAabb& local = e.mesh->GetBounds();
+				if (local.IsValid())
+				{
+					for (int c = 0; c < 8; ++c)
+					{
+						const math::Vec3 p((c & 1) ? local.bb_max.x : local.bb_min.x, (c & 2) ? local.bb_max.y : local.bb_min.y, (c & 4) ? local.bb_max.z : local.bb_min.z);
+						inst.world_aabb.Expand(TransformPoint(e.transform, p));
+					}
+				}
+				instance_array_.push_back(inst);
+				prim_aabb_array.push_back(inst.world_aabb);
+			}
+
+			// Instance単位のリーフとする.
+			CpuBvhBuildDesc instance_desc = desc;
+			instance_desc.max_leaf_primitive = 1;
+			bvh_.Build(prim_aabb_array, instance_desc, p_job_system);
+		}
+
+		bool CpuBvhScene::Intersect(const CpuBvhRay& ray, CpuBvhHit& out_hit) const
+		{
+			float t_max = std::min(ray.t_max, out_hit.t);
+			const auto& order = bvh_.GetPrimitiveOrder();
+			return TraverseRay<false>(bvh_.GetNodeArray(), ray, t_max, [&](u32 first, u32 count, float& io_t_max)
+				{
+					bool is_hit = false;
+					for (u32 i = first; i < first + count; ++i)
+					{
+						const u32 inst_index = order[i];
+						const auto& inst = instance_array_[inst_index];
+						CpuBvhRay local_ray = TransformRay(inst.inv_transform, ray);
+						local_ray.t_max = io_t_max;
+						if (inst.mesh->Intersect(local_ray, out_hit))
+						{
+							out_hit.instance_index = inst_index;
+							io_t_max = out_hit.t;
+							is_hit = true;
+						}
+					}
+					return is_hit;
+				});
+		}
+
+		bool CpuBvhScene::Occluded(const CpuBvhRay& ray) const
+		{
+			float t_max = ray.t_max;
+			const auto& order = bvh_.GetPrimitiveOrder();
+			return TraverseRay<true>(bvh_.GetNodeArray(), ray, t_max, [&](u32 first, u32 count, float& io_t_max)
+				{
+					for (u32 i = first; i < first + count; ++i)
+					{
+						const auto& inst = instance_array_[order[i]];
+						CpuBvhRay local_ray = TransformRay(inst.inv_transform, ray);
+						local_ray.t_max = io_t_max;
+						if (inst.mesh->Occluded(local_ray))
+							return true;
+					}
+					return false;
+				});
+		}
+
+		u32 CpuBvhScene::IntersectPacket4(const CpuBvhRay* ray4, CpuBvhHit* out_hit4, u32 active_mask) const
+		{
+			alignas(16) float t_max4[4];
+			for (int k = 0; k < 4; ++k)
+				t_max4[k] = (active_mask & (1u << k)) ? std::min(ray4[k].t_max, out_hit4[k].t) : -FLT_MAX;
+
+			const auto& order = bvh_.GetPrimitiveOrder();
+			return TraversePacket4(bvh_.GetNodeArray(), ray4, active_mask, t_max4, [&](u32 first, u32 count, u32 ray_mask, float* io_t_max4)
+				{
+					u32 leaf_hit_mask = 0;
+					for (u32 i = first; i < first + count; ++i)
+					{
+						const u32 inst_index = order[i];
+						const auto& inst = instance_array_[inst_index];
+						CpuBvhRay local_ray4[4];
+						for (int k = 0; k < 4; ++k)
+						{
+							local_ray4[k] = TransformRay(inst.inv_transform, ray4[k]);
+							local_ray4[k].t_max = io_t_max4[k];
+						}
+						const u32 mask = inst.mesh->IntersectPacket4(local_ray4, out_hit4, ray_mask);
+						for (u32 m = mask; 0 != m; m &= m - 1)
+						{
+							const int k = LeastSignificantBit32(m);
+							out_hit4[k].instance_index = inst_index;
+							io_t_max4[k] = out_hit4[k].t;
+						}
+						leaf_hit_mask |= mask;
+					}
+					return leaf_hit_mask;
+				});
+		}
+
+		void CpuBvhScene::QueryAabb(const CpuBvhAabb& aabb, std::vector<u32>& out_instance_array) const
+		{
+			const auto& order = bvh_.GetPrimitiveOrder();
+			TraverseOverlap(bvh_.GetNodeArray(), aabb, [&](u32 first, u32 count)
+				{
+					for (u32 i = first; i < first + count; ++i)
+						out_instance_array.push_back(order[i]);
+				});
+		}
+		void CpuBvhScene::QueryFrustum(const CpuBvhFrustum& frustum, std::vector<u32>& out_instance_array) const
+		{
+			const auto& order = bvh_.GetPrimitiveOrder();
+			TraverseOverlap(bvh_.GetNodeArray(), frustum, [&](u32 first, u32 count)
+				{
+					for (u32 i = first; i < first + count; ++i)
+						out_instance_array.push_back(order[i]);
+				});
+		}
+
+
+		CpuBvhBenchmarkResult RunCpuBvhBenchmark(const CpuBvhScene& scene, const CpuBvhBenchmarkDesc& desc, thread::JobSystem* p_job_system)
+		{
+			CpuBvhBenchmarkResult result = {};
+			if (!scene.IsValid() || 0 == desc.width || 0 == desc.height)
+				return result;
+
+			// パケットは2x2ピクセル単位とするため偶数に切り上げ.
+			const u32 width = (desc.width + 1) & ~1u;
+			const u32 height = (desc.height + 1) & ~1u;
+			const float tan_half_fov = std::tan(desc.fov_y * 0.5f);
+			const float aspect = static_cast<float>(width) / static_cast<float>(height);
+			const auto MakeRay = [&](u32 x, u32 y)
+			{
+				const float ndc_x = ((static_cast<float>(x) + 0.5f) / static_cast<float>(width) * 2.0f - 1.0f) * tan_half_fov * aspect;
+				const float ndc_y = (1.0f - (static_cast<float>(y) + 0.5f) / static_cast<float>(height) * 2.0f) * tan_half_fov;
+				CpuBvhRay ray = {};
+				ray.origin = desc.camera_pos;
+				ray.direction = desc.camera_forward + desc.camera_right * ndc_x + desc.camera_up * ndc_y;
+				return ray;
+			};
+
+			// 2行単位でタスク化.
+			const u32 num_row_pair = height / 2;
+			const auto Run = [&](const auto& row_pair_func) -> double
+			{
+				const auto begin = std::chrono::high_resolution_clock::now();
+				for (u32 it = 0; it < std::max(1u, desc.num_iteration); ++it)
+				{
+					if (p_job_system)
+					{
+						for (u32 y = 0; y < num_row_pair; ++y)
+							p_job_system->Add([&row_pair_func, y]() { row_pair_func(y); });
+						p_job_system->WaitAll();
+					}
+					else
+					{
+						for (u32 y = 0; y < num_row_pair; ++y)
+							row_pair_func(y);
+					}
+				}
+				const auto end = std::chrono::high_resolution_clock::now();
+				return std::chrono::duration<double>(end - begin).count();
+			};
+
+			const u64 num_ray = static_cast<u64>(width) * height * std::max(1u, desc.num_iteration);
+			result.num_ray = static_cast<u64>(width) * height;
+
+			std::atomic<u64> num_hit = 0;
+			const double closest_sec = Run([&](u32 y2)
+				{
+					u64 local_hit = 0;
+					for (u32 y = y2 * 2; y < y2 * 2 + 2; ++y)
+					{
+						for (u32 x = 0; x < width; ++x)
+						{
+							CpuBvhHit hit = {};
+							if (scene.Intersect(MakeRay(x, y), hit))
+								++local_hit;
+						}
+					}
+					num_hit += local_hit;
+				});
+			result.num_hit = num_hit / std::max(1u, desc.num_iteration);
+
+			const double packet_sec = Run([&](u32 y2)
+				{
+					for (u32 x = 0; x < width; x += 2)
+					{
+						const CpuBvhRay ray4[4] = { MakeRay(x, y2 * 2), MakeRay(x + 1, y2 * 2), MakeRay(x, y2 * 2 + 1), MakeRay(x + 1, y2 * 2 + 1) };
+						CpuBvhHit hit4[4] = {};
+						scene.IntersectPacket4(ray4, hit4);
+					}
+				});
+
+			const double occluded_sec = Run([&](u32 y2)
+				{
+					for (u32 y = y2 * 2; y < y2 * 2 + 2; ++y)
+					{
+						for (u32 x = 0; x < width; ++x)
+							scene.Occluded(MakeRay(x, y));
+					}
+				});
+
+			const auto ToMrays = [num_ray](double sec) { return (0.0 < sec) ? (static_cast<double>(num_ray) / sec * 1e-6) : 0.0; };
+			result.closest_mrays_per_sec = ToMrays(closest_sec);
+			result.packet_mrays_per_sec = ToMrays(packet_sec);
+			result.occluded_mrays_per_sec = ToMrays(occluded_sec);
+			return result;
+		}
+	}
+}
@@ -0,0 +1,76 @@
+﻿#include "gfx/raytrace/cpu_bvh_scene_builder.h"
+
+#include "framework/gfx_scene_entity_mesh.h"
+#include "gfx/resource/resource_mesh.h"
+
+namespace ngl
+{
+	namespace gfx
+	{
+		CpuBvhSceneBuilder::CpuBvhSceneBuilder()
+		{
+		}
+		CpuBvhSceneBuilder::~CpuBvhSceneBuilder()
+		{
+		}
+
+		void CpuBvhSceneBuilder::ClearMeshCache()
+		{
+			scene_ = {};
+			instance_proxy_id_array_.clear();
+			mesh_map_.clear();
+		}
+
+		void CpuBvhSceneBuilder::Build(const SceneRepresentation& scene, thread::JobSystem* p_job_system, const CpuBvhBuildDesc& desc)
+		{
+			instance_proxy_id_array_.clear();
+			if (!scene.gfx_scene_)
+			{
+				scene_.Build({}, desc, p_job_system);
+				return;
+			}
+
+			std::vector<CpuBvhScene::InstanceInput> instance_array;
+			instance_array.reserve(scene.mesh_proxy_id_array_.size());
+			auto* proxy_buffer = scene.gfx_scene_->GetEntityProxyBuffer<fwk::GfxSceneEntityMesh>();
+			for (const auto& proxy_id : scene.mesh_proxy_id_array_)
+			{
+				const auto* proxy = proxy_buffer->proxy_buffer_[proxy_id.GetIndex()];
+				if (!proxy || !proxy->model_)
+					continue;
+				const ResMeshData* p_mesh = proxy->model_->GetResMeshData();
+				if (!p_mesh)
+					continue;
+
+				auto find_it = mesh_map_.find(p_mesh);
+				if (mesh_map_.end() == find_it)
+				{
+					// MeshShapePart毎にGeometryとする. 量子化メッシュでもfloatの位置ストリームはCPU側に保持されている.
+					std::vector<CpuBvhMesh::GeometryInput> geom_array;
+					for (const auto& shape : p_mesh->data_.shape_array_)
+					{
+						CpuBvhMesh::GeometryInput geom = {};
+						geom.position = shape.position_.GetTypedRawDataPtr();
+						geom.num_vertex = static_cast<u32>(shape.num_vertex_);
+						geom.index = shape.index_.GetTypedRawDataPtr();
+						geom.num_primitive = static_cast<u32>(shape.num_primitive_);
+						geom_array.push_back(geom);
+					}
+					auto bvh_mesh = std::make_unique<CpuBvhMesh>();
+					bvh_mesh->Build(geom_array.data(), static_cast<u32>(geom_array.size()), desc, p_job_system);
+					find_it = mesh_map_.insert({ p_mesh, std::move(bvh_mesh) }).first;
+				}
+				if (!find_it->second->IsValid())
+					continue;
+
+				CpuBvhScene::InstanceInput inst = {};
+				inst.mesh = find_it->second.get();
+				inst.transform = proxy->transform_;
+				instance_array.push_back(inst);
+				instance_proxy_id_array_.push_back(proxy_id);
+			}
+
+			scene_.Build(instance_array, desc, p_job_system);
+		}
+	}
+}
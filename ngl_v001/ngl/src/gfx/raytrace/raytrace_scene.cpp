@@ -94,7 +94,7 @@ namespace ngl
 			// ここで設定した情報はそのままBuildで利用される.
 			build_setup_info_ = {};
 			build_setup_info_.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-			build_setup_info_.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE;
+			build_setup_info_.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION;// 静的GeometryのためTrace高速設定とコンパクション許可.
 			build_setup_info_.NumDescs = static_cast<uint32_t>(geom_desc_array_.size());
 			build_setup_info_.pGeometryDescs = geom_desc_array_.data();
 			build_setup_info_.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL; // BLAS.
@@ -103,21 +103,17 @@ namespace ngl
 			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO build_info = {};
 			p_device->GetD3D12DeviceForDxr()->GetRaytracingAccelerationStructurePrebuildInfo(&build_setup_info_, &build_info);
 
-			// PreBuild情報からバッファ生成
-			// Scratch Buffer.
-			rhi::BufferDep::Desc scratch_desc = {};
-			scratch_desc.bind_flag = rhi::ResourceBindFlag::UnorderedAccess;
-			scratch_desc.initial_state = rhi::EResourceState::Common;// UnorderedAccessだとValidationエラー.
-			scratch_desc.heap_type = rhi::EResourceHeapType::Default;
-			scratch_desc.element_count = 1;
-			scratch_desc.element_byte_size = (u32)build_info.ScratchDataSizeInBytes;
-			scratch_.Reset(new rhi::BufferDep());
-			if (!scratch_->Initialize(p_device, scratch_desc))
+			scratch_byte_size_ = build_info.ScratchDataSizeInBytes;
+			result_max_byte_size_ = build_info.ResultDataMaxSizeInBytes;
+			result_byte_size_ = build_info.ResultDataMaxSizeInBytes;
+			primitive_count_ = 0;
+			for (const auto& geom_desc : geom_desc_array_)
 			{
-				std::cout << "[ERROR] Initialize Rt Scratch Buffer." << std::endl;
-				assert(false);
-				return false;
+				primitive_count_ += (0 < geom_desc.Triangles.IndexCount) ? (geom_desc.Triangles.IndexCount / 3) : (geom_desc.Triangles.VertexCount / 3);
 			}
+
+			// PreBuild情報からバッファ生成
+			// Scratchはビルド時に共有プールから割り当てる.
 			// Main Buffer.
 			rhi::BufferDep::Desc main_desc = {};
 			main_desc.bind_flag = rhi::ResourceBindFlag::UnorderedAccess;
@@ -141,7 +137,8 @@ namespace ngl
 		// Setup の情報を元に構造構築コマンドを発行する.
 		// Buildタイミングをコントロールするために分離している.
 		// MEMO. RenderDocでのLaunchはクラッシュするのでNsight推奨.
-		bool RtBlas::Build(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_command_list)
+		bool RtBlas::Build(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_command_list,
+			D3D12_GPU_VIRTUAL_ADDRESS scratch_address, D3D12_GPU_VIRTUAL_ADDRESS compacted_size_address)
 		{
 			assert(p_device);
 			assert(p_command_list);
@@ -159,6 +156,26 @@ namespace ngl
 			// BLAS Build (Triangle Geometry).
 			if (ESetupType::BLAS_TRIANGLE == setup_type_)
 			{
+				// 共有Scratchが指定されない場合は専用Scratchを確保. RhiRefによりGPU完了後に遅延破棄される.
+				rhi::RhiRef<rhi::BufferDep> dedicated_scratch;
+				if (0 == scratch_address)
+				{
+					rhi::BufferDep::Desc scratch_desc = {};
+					scratch_desc.bind_flag = rhi::ResourceBindFlag::UnorderedAccess;
+					scratch_desc.initial_state = rhi::EResourceState::Common;// UnorderedAccessだとValidationエラー.
+					scratch_desc.heap_type = rhi::EResourceHeapType::Default;
+					scratch_desc.element_count = 1;
+					scratch_desc.element_byte_size = (u32)scratch_byte_size_;
+					dedicated_scratch.Reset(new rhi::BufferDep());
+					if (!dedicated_scratch->Initialize(p_device, scratch_desc))
+					{
+						std::cout << "[ERROR] Initialize Rt Scratch Buffer." << std::endl;
+						assert(false);
+						return false;
+					}
+					scratch_address = dedicated_scratch->GetD3D12Resource()->GetGPUVirtualAddress();
+				}
+
 				// Setupで準備した情報からASをビルドするコマンドを発行.
 				// Build後は入力に利用したVertexBufferやIndexBufferは不要となるとのこと.
 
@@ -166,8 +183,16 @@ namespace ngl
 				D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC build_desc = {};
 				build_desc.Inputs = build_setup_info_;
 				build_desc.DestAccelerationStructureData = main_->GetD3D12Resource()->GetGPUVirtualAddress();
-				build_desc.ScratchAccelerationStructureData = scratch_->GetD3D12Resource()->GetGPUVirtualAddress();
-				p_command_list->BuildRaytracingAccelerationStructure(&build_desc);
+				build_desc.ScratchAccelerationStructureData = scratch_address;
+
+				// コンパクションサイズの書き出し.
+				D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postbuild_desc = {};
+				postbuild_desc.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE;
+				postbuild_desc.DestBuffer = compacted_size_address;
+				if (0 != compacted_size_address)
+					p_command_list->BuildRaytracingAccelerationStructure(&build_desc, 1, &postbuild_desc);
+				else
+					p_command_list->BuildRaytracingAccelerationStructure(&build_desc);
 
 				// UAV Barrier変更.
 				p_command_list->ResourceUavBarrier(main_.Get());
@@ -176,6 +201,48 @@ namespace ngl
 			is_built_ = true;
 			return true;
 		}
+
+		bool RtBlas::Compact(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_command_list, u64 compacted_byte_size)
+		{
+			assert(p_device);
+			assert(p_command_list);
+
+			if (!is_built_ || is_compacted_)
+				return false;
+			// 不正値や縮小しない場合はそのまま.
+			if (0 == compacted_byte_size || result_byte_size_ <= compacted_byte_size)
+			{
+				is_compacted_ = true;
+				return false;
+			}
+
+			rhi::BufferDep::Desc compact_desc = {};
+			compact_desc.bind_flag = rhi::ResourceBindFlag::UnorderedAccess;
+			compact_desc.initial_state = rhi::EResourceState::RaytracingAccelerationStructure;
+			compact_desc.heap_type = rhi::EResourceHeapType::Default;
+			compact_desc.element_count = 1;
+			compact_desc.element_byte_size = (u32)compacted_byte_size;
+			rhi::RhiRef<rhi::BufferDep> compacted;
+			compacted.Reset(new rhi::BufferDep());
+			if (!compacted->Initialize(p_device, compact_desc))
+			{
+				std::cout << "[ERROR] Initialize Rt Compacted Buffer." << std::endl;
+				assert(false);
+				return false;
+			}
+
+			p_command_list->CopyRaytracingAccelerationStructure(
+				compacted->GetD3D12Resource()->GetGPUVirtualAddress(),
+				main_->GetD3D12Resource()->GetGPUVirtualAddress(),
+				D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT);
+			p_command_list->ResourceUavBarrier(compacted.Get());
+
+			// 旧バッファはRhiRefによりGPU完了後に遅延破棄される.
+			main_ = compacted;
+			result_byte_size_ = compacted_byte_size;
+			is_compacted_ = true;
+			return true;
+		}
 		bool RtBlas::IsSetuped() const
 		{
 			return ESetupType::NONE != setup_type_;
@@ -184,6 +251,10 @@ namespace ngl
 		{
 			return is_built_;
 		}
+		bool RtBlas::IsCompacted() const
+		{
+			return is_compacted_;
+		}
 
 		rhi::BufferDep* RtBlas::GetBuffer()
 		{
@@ -214,86 +285,16 @@ namespace ngl
 		RtTlas::~RtTlas()
 		{
 		}
-		// TLAS setup.
-		// index_buffer : optional.
-		// bufferの管理責任は外部.
-		bool RtTlas::Setup(rhi::DeviceDep* p_device, std::vector<RtBlas*>& blas_array,
-			const std::vector<uint32_t>& instance_geom_id_array,
-			const std::vector<math::Mat34>& instance_transform_array,
-			int hitgroup_count
-		)
-		{
-			if (is_built_)
-				return false;
-
-			if (0 >= blas_array.size())
-			{
-				assert(false);
-				return false;
-			}
-			if (0 >= instance_transform_array.size())
-			{
-				assert(false);
-				return false;
-			}
-
-			setup_type_ = ESetupType::TLAS;
 
-
-
-			std::vector<int> id_remap;
-			id_remap.resize(blas_array.size());
-
-			// 有効でSetup済みのBLASのみ収集.
-			blas_array_.clear();
-			for (int i = 0; i < blas_array.size(); ++i)
-			{
-				auto& e = blas_array[i];
-
-				if (nullptr != e && e->IsSetuped())
-				{
-					blas_array_.push_back(e);
-					id_remap[i] = static_cast<int>(blas_array_.size() - 1);
-				}
-				else
-				{
-					id_remap[i] = -1;
-				}
-			}
-
-			{
-				instance_blas_id_array_.clear();
-				transform_array_.clear();
-
-				int instance_contribution_to_hitgroup = 0;
-				// 参照BLASが有効なInstanceのみ収集.
-				for (int i = 0; i < instance_geom_id_array.size(); ++i)
-				{
-					if (id_remap.size() <= instance_geom_id_array[i])
-						continue;
-					const int blas_id =  id_remap[instance_geom_id_array[i]];
-					if (0 > blas_id)
-						continue;
-
-					
-					instance_blas_id_array_.push_back(blas_id);
-					
-					instance_hitgroup_index_offset_array_.push_back(instance_contribution_to_hitgroup);
-					instance_contribution_to_hitgroup += blas_array[blas_id]->NumGeometry() * hitgroup_count;
-
-					transform_array_.push_back(instance_transform_array[i]);
-				}
-			}
-
-			assert(0 < blas_array_.size());
-			assert(0 < instance_blas_id_array_.size());
-
-			// Instance Desc Buffer.
-			const uint32_t num_instance_total = (uint32_t)transform_array_.size();
+		// Instance容量に合わせたバッファ確保.
+		//	ASとScratchは容量分のInstance数で確保し, 容量内のInstance増減ではバッファを作り直さない.
+		bool RtTlas::ReallocateBuffer(rhi::DeviceDep* p_device, uint32_t instance_capacity)
+		{
+			// Instance Desc Buffer. 差分アップロードのためDefaultHeapに永続で保持する.
 			rhi::BufferDep::Desc instance_buffer_desc = {};
-			instance_buffer_desc.heap_type = rhi::EResourceHeapType::Upload;// CPUからアップロードするInstanceDataのため.
-			instance_buffer_desc.initial_state = rhi::EResourceState::General;// UploadヒープのためにGeneral.
-			instance_buffer_desc.element_count = num_instance_total;// Instance数を確保.
+			instance_buffer_desc.heap_type = rhi::EResourceHeapType::Default;
+			instance_buffer_desc.initial_state = rhi::EResourceState::Common;// DefaultHeapのBufferはCommon開始.
+			instance_buffer_desc.element_count = instance_capacity;
 			instance_buffer_desc.element_byte_size = sizeof(D3D12_RAYTRACING_INSTANCE_DESC);
 			instance_buffer_.Reset(new rhi::BufferDep());
 			if (!instance_buffer_->Initialize(p_device, instance_buffer_desc))
@@ -302,55 +303,29 @@ namespace ngl
 				assert(false);
 				return false;
 			}
-			// Instance情報をBufferに書き込み.
-			if (D3D12_RAYTRACING_INSTANCE_DESC* mapped = (D3D12_RAYTRACING_INSTANCE_DESC*)instance_buffer_->Map())
-			{
-				//int instance_contribution_to_hitgroup = 0;
-				for (auto inst_i = 0; inst_i < transform_array_.size(); ++inst_i)
-				{
-					// 一応ID入れておく
-					mapped[inst_i].InstanceID = inst_i;
+			instance_buffer_state_ = rhi::EResourceState::Common;
 
-					// このInstanceのHitGroupを示すベースインデックス. Instanceのマテリアル情報に近い.
-					// DXRではTraceRay()でHitGroupIndex計算時にInstanceに対する乗算パラメータが無いため, Instance毎のHitGroupIndexContributionにHitGroup数を考慮した絶対インデックス指定が必要.
-					mapped[inst_i].InstanceContributionToHitGroupIndex = instance_hitgroup_index_offset_array_[inst_i];// instance_contribution_to_hitgroup;
-					
-					mapped[inst_i].Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-					mapped[inst_i].InstanceMask = ~0u;// 0xff;
-					
-					// InstanceのBLASを設定.
-					mapped[inst_i].AccelerationStructure = blas_array_[instance_blas_id_array_[inst_i]]->GetBuffer()->GetD3D12Resource()->GetGPUVirtualAddress();
-
-					// InstanceのTransform.
-					memcpy(mapped[inst_i].Transform, &transform_array_[inst_i], sizeof(mapped[inst_i].Transform));
-				}
-				instance_buffer_->Unmap();
-			}
-
-
-
-			// ここで設定した情報はそのままBuildで利用される.
-			build_setup_info_ = {};
-			build_setup_info_.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-			build_setup_info_.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;// TLASはTrace高速設定.
-			build_setup_info_.NumDescs = num_instance_total;// Instance Desc Bufferの要素数を指定.
-			build_setup_info_.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL; // TLAS.
-			// input情報にInstanceBufferセット.
-			build_setup_info_.InstanceDescs = instance_buffer_->GetD3D12Resource()->GetGPUVirtualAddress();
+			// 容量分のInstance数でPrebuild.
+			D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS prebuild_setup_info = {};
+			prebuild_setup_info.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+			prebuild_setup_info.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
+			prebuild_setup_info.NumDescs = instance_capacity;
+			prebuild_setup_info.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+			prebuild_setup_info.InstanceDescs = instance_buffer_->GetD3D12Resource()->GetGPUVirtualAddress();
 
 			// Prebuildで必要なサイズ取得.
 			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO build_info = {};
-			p_device->GetD3D12DeviceForDxr()->GetRaytracingAccelerationStructurePrebuildInfo(&build_setup_info_, &build_info);
+			p_device->GetD3D12DeviceForDxr()->GetRaytracingAccelerationStructurePrebuildInfo(&prebuild_setup_info, &build_info);
 
 			// PreBuild情報からバッファ生成
 			tlas_byte_size_ = (int)build_info.ResultDataMaxSizeInBytes;
-			// Scratch Buffer.
+			// Scratch Buffer. フルビルドとUpdateで共用するため大きい方.
 			rhi::BufferDep::Desc scratch_desc = {};
 			scratch_desc.bind_flag = rhi::ResourceBindFlag::UnorderedAccess;
 			scratch_desc.initial_state = rhi::EResourceState::Common;// UnorderedAccessだとValidationエラー.
 			scratch_desc.heap_type = rhi::EResourceHeapType::Default;
 			scratch_desc.element_count = 1;
-			scratch_desc.element_byte_size = (u32)build_info.ScratchDataSizeInBytes;
+			scratch_desc.element_byte_size = (u32)std::max(build_info.ScratchDataSizeInBytes, build_info.UpdateScratchDataSizeInBytes);
 			scratch_.Reset(new rhi::BufferDep());
 			if (!scratch_->Initialize(p_device, scratch_desc))
 			{
@@ -381,12 +356,161 @@ namespace ngl
 				return false;
 			}
 
-			// 実際にscratch_descとmain_descでASをビルドするのはCommandListにタスクとして発行するため分離する.
+			instance_capacity_ = instance_capacity;
+			return true;
+		}
+
+		// TLAS update.
+		// bufferの管理責任は外部.
+		bool RtTlas::Update(rhi::DeviceDep* p_device, const std::vector<RtBlas*>& blas_array,
+			const std::vector<RtTlasInstanceSlot>& slot_array,
+			const RtTlasInstanceUpdateResult& update_result
+		)
+		{
+			update_stat_ = {};
+			update_stat_.num_instance = static_cast<u32>(slot_array.size());
+
+			// 有効なInstanceが無い場合は前回の状態を維持する.
+			if (0 >= slot_array.size())
+				return false;
+
+			ERtTlasBuildMode build_mode = update_result.build_mode;
+			// 前回のビルドが未発行の場合は差分が失われるためフルアップロードとする.
+			bool upload_all = (ERtTlasBuildMode::None != pending_build_mode_);
+
+			// 容量不足であれば再確保してフルアップロード.
+			if (instance_capacity_ < slot_array.size())
+			{
+				const uint32_t new_capacity = std::max(64u, static_cast<uint32_t>(slot_array.size() + slot_array.size() / 2));
+				if (!ReallocateBuffer(p_device, new_capacity))
+					return false;
+				upload_all = true;
+				update_stat_.is_reallocated = true;
+			}
+			if (upload_all)
+				build_mode = ERtTlasBuildMode::Rebuild;
+
+			if (ERtTlasBuildMode::None == build_mode)
+				return true;
+
+			setup_type_ = ESetupType::TLAS;
+
+			// 参照用情報の更新. 空きスロットは無効Instance.
+			blas_array_ = blas_array;
+			instance_blas_id_array_.resize(slot_array.size());
+			transform_array_.resize(slot_array.size());
+			instance_hitgroup_index_offset_array_.resize(slot_array.size());
+			for (size_t i = 0; i < slot_array.size(); ++i)
+			{
+				const auto& slot = slot_array[i];
+				const bool is_valid = slot.IsValid() && (slot.blas_index < blas_array_.size()) && blas_array_[slot.blas_index] && blas_array_[slot.blas_index]->IsSetuped();
+				instance_blas_id_array_[i] = (is_valid) ? slot.blas_index : k_rt_tlas_invalid_blas_index;
+				transform_array_[i] = slot.transform;
+				instance_hitgroup_index_offset_array_[i] = slot.hitgroup_offset;
+			}
+
+			// アップロード範囲.
+			upload_range_array_.clear();
+			uint32_t upload_instance_count = 0;
+			if (upload_all)
+			{
+				upload_range_array_.push_back({ 0, 0, static_cast<uint32_t>(slot_array.size() * sizeof(D3D12_RAYTRACING_INSTANCE_DESC)) });
+				upload_instance_count = static_cast<uint32_t>(slot_array.size());
+			}
+			else
+			{
+				for (const auto& r : update_result.dirty_range_array)
+				{
+					upload_range_array_.push_back({
+						static_cast<uint32_t>(upload_instance_count * sizeof(D3D12_RAYTRACING_INSTANCE_DESC)),
+						static_cast<uint32_t>(r.begin * sizeof(D3D12_RAYTRACING_INSTANCE_DESC)),
+						static_cast<uint32_t>(r.count * sizeof(D3D12_RAYTRACING_INSTANCE_DESC)) });
+					upload_instance_count += r.count;
+				}
+			}
+
+			// 変更のあったInstanceDescのみUploadBufferに書き込み. UploadBufferはフレーム毎の一時バッファとしてRhiRefで遅延破棄される.
+			upload_buffer_ = {};
+			if (0 < upload_instance_count)
+			{
+				rhi::BufferDep::Desc upload_desc = {};
+				upload_desc.heap_type = rhi::EResourceHeapType::Upload;// CPUからアップロードするInstanceDataのため.
+				upload_desc.initial_state = rhi::EResourceState::General;// UploadヒープのためにGeneral.
+				upload_desc.element_count = upload_instance_count;
+				upload_desc.element_byte_size = sizeof(D3D12_RAYTRACING_INSTANCE_DESC);
+				upload_buffer_.Reset(new rhi::BufferDep());
+				if (!upload_buffer_->Initialize(p_device, upload_desc))
+				{
+					std::cout << "[ERROR] Initialize Rt Instance Upload Buffer." << std::endl;
+					assert(false);
+					return false;
+				}
+
+				if (D3D12_RAYTRACING_INSTANCE_DESC* mapped = (D3D12_RAYTRACING_INSTANCE_DESC*)upload_buffer_->Map())
+				{
+					uint32_t write_i = 0;
+					for (const auto& r : upload_range_array_)
+					{
+						const uint32_t begin = r.dst_byte_offset / sizeof(D3D12_RAYTRACING_INSTANCE_DESC);
+						const uint32_t count = r.byte_size / sizeof(D3D12_RAYTRACING_INSTANCE_DESC);
+						for (uint32_t inst_i = begin; inst_i < begin + count; ++inst_i, ++write_i)
+						{
+							auto& desc = mapped[write_i];
+							desc = {};
+
+							const uint32_t blas_id = instance_blas_id_array_[inst_i];
+							if (k_rt_tlas_invalid_blas_index == blas_id)
+							{
+								// 空きスロット. BLASがnullのInstanceは無効Instanceとして扱われる.
+								desc.InstanceMask = 0;
+								desc.AccelerationStructure = 0;
+								continue;
+							}
+
+							// 一応ID入れておく
+							desc.InstanceID = inst_i;
+
+							// このInstanceのHitGroupを示すベースインデックス. Instanceのマテリアル情報に近い.
+							// DXRではTraceRay()でHitGroupIndex計算時にInstanceに対する乗算パラメータが無いため, Instance毎のHitGroupIndexContributionにHitGroup数を考慮した絶対インデックス指定が必要.
+							desc.InstanceContributionToHitGroupIndex = instance_hitgroup_index_offset_array_[inst_i];
+
+							desc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
+							desc.InstanceMask = ~0u;// 0xff;
+
+							// InstanceのBLASを設定.
+							desc.AccelerationStructure = blas_array_[blas_id]->GetBuffer()->GetD3D12Resource()->GetGPUVirtualAddress();
+
+							// InstanceのTransform.
+							memcpy(desc.Transform, &transform_array_[inst_i], sizeof(desc.Transform));
+						}
+					}
+					upload_buffer_->Unmap();
+				}
+			}
+			update_stat_.build_mode = build_mode;
+			update_stat_.num_upload_instance = upload_instance_count;
+			update_stat_.upload_byte_size = static_cast<u32>(upload_instance_count * sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+			update_stat_.num_upload_range = static_cast<u32>(upload_range_array_.size());
+
+			// ここで設定した情報はそのままBuildで利用される.
+			build_setup_info_ = {};
+			build_setup_info_.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+			build_setup_info_.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;// TLASはTrace高速設定. Refitのため更新を許可.
+			if (ERtTlasBuildMode::Refit == build_mode)
+				build_setup_info_.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+			build_setup_info_.NumDescs = static_cast<uint32_t>(slot_array.size());// スロット数を指定.
+			build_setup_info_.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL; // TLAS.
+			// input情報にInstanceBufferセット.
+			build_setup_info_.InstanceDescs = instance_buffer_->GetD3D12Resource()->GetGPUVirtualAddress();
+
+			pending_build_mode_ = build_mode;
+
+			// 実際にInstanceDescのコピーとASのビルドをするのはCommandListにタスクとして発行するため分離する.
 
 			return true;
 		}
 
-		// Setup の情報を元に構造構築コマンドを発行する.
+		// Update の情報を元にInstanceDescのコピーと構造構築コマンドを発行する.
 		// Buildタイミングをコントロールするために分離している.
 		// MEMO. RenderDocでのLaunchはクラッシュするのでNsight推奨.
 		bool RtTlas::Build(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_command_list)
@@ -394,7 +518,7 @@ namespace ngl
 			assert(p_device);
 			assert(p_command_list);
 
-			if (is_built_)
+			if (ERtTlasBuildMode::None == pending_build_mode_)
 				return false;
 
 			if (!IsSetuped())
@@ -407,19 +531,39 @@ namespace ngl
 			// TLAS Build .
 			if (ESetupType::TLAS == setup_type_)
 			{
+				// 変更のあったInstanceDescのみコピー.
+				if (upload_buffer_.IsValid() && 0 < upload_range_array_.size())
+				{
+					p_command_list->ResourceBarrier(instance_buffer_.Get(), instance_buffer_state_, rhi::EResourceState::CopyDst);
+					for (const auto& r : upload_range_array_)
+					{
+						p_command_list->CopyBufferRegion(instance_buffer_.Get(), r.dst_byte_offset, upload_buffer_.Get(), r.src_byte_offset, r.byte_size);
+					}
+					// ASビルド入力はNON_PIXEL_SHADER_RESOURCEを含む読み取りステート.
+					p_command_list->ResourceBarrier(instance_buffer_.Get(), rhi::EResourceState::CopyDst, rhi::EResourceState::General);
+					instance_buffer_state_ = rhi::EResourceState::General;
+				}
+				upload_buffer_ = {};
+				upload_range_array_.clear();
+
 				// ASビルドコマンドを発行.
-				// 
-				// Builld.
+				// Refitの場合は自身をソースとしてインプレース更新.
 				D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC build_desc = {};
 				build_desc.Inputs = build_setup_info_;
 				build_desc.DestAccelerationStructureData = main_->GetD3D12Resource()->GetGPUVirtualAddress();
 				build_desc.ScratchAccelerationStructureData = scratch_->GetD3D12Resource()->GetGPUVirtualAddress();
+				if (ERtTlasBuildMode::Refit == pending_build_mode_)
+				{
+					assert(is_built_);
+					build_desc.SourceAccelerationStructureData = main_->GetD3D12Resource()->GetGPUVirtualAddress();
+				}
 				p_command_list->BuildRaytracingAccelerationStructure(&build_desc);
 
 				// UAV Barrier.
 				p_command_list->ResourceUavBarrier(main_.Get());
 			}
 
+			pending_build_mode_ = ERtTlasBuildMode::None;
 			is_built_ = true;
 			return true;
 		}
@@ -431,6 +575,10 @@ namespace ngl
 		{
 			return is_built_;
 		}
+		bool RtTlas::IsBuildPending() const
+		{
+			return ERtTlasBuildMode::None != pending_build_mode_;
+		}
 		rhi::BufferDep* RtTlas::GetBuffer()
 		{
 			return main_.Get();
@@ -1249,218 +1397,202 @@ namespace ngl
 		// -------------------------------------------------------------------------------
 
 
-		// per_entry_descriptor_param_count が0だとAlignmentエラーになるため注意.
-		// BLAS内Geometryは個別のShaderRecordを持つ(multiplier_for_subgeometry_index = 1)
-		bool CreateShaderTable(RtShaderTable& out, rhi::DeviceDep* p_device,
-			rhi::DynamicDescriptorStackAllocatorInterface& desc_alloc_interface,
-			const RtTlas& tlas,
-			uint32_t tlas_hitgroup_count_max,
-			const RtStateObject& state_object, const char* raygen_name)
+		void RtShaderTable::Finalize()
 		{
-			out = {};
+			for (auto& e : buffer_array_)
+			{
+				e = {};
+			}
+			shader_table_ = {};
+			p_identifier_state_object_ = {};
+			identifier_raygen_name_.clear();
+		}
 
-			// ダミー用のcbv, srv, uav用デフォルトDescriptor取得.
-			auto def_descriptor = p_device->GetPersistentDescriptorAllocator()->GetDefaultPersistentDescriptor();
+		bool RtShaderTable::UpdateShaderIdentifier(const RtStateObject& state_object, const char* raygen_name)
+		{
+			if (p_identifier_state_object_ == &state_object && identifier_raygen_name_ == raygen_name)
+				return true;
 
+			Microsoft::WRL::ComPtr<ID3D12StateObjectProperties> p_rt_so_prop;
+			if (FAILED(state_object.GetStateObject()->QueryInterface(IID_PPV_ARGS(&p_rt_so_prop))))
+			{
+				assert(false);
+				return false;
+			}
+			auto func_get_identifier = [&p_rt_so_prop](const char* name, ShaderIdentifier& out)
+			{
+				const void* p_identifier = p_rt_so_prop->GetShaderIdentifier(str_to_wstr(name).c_str());
+				if (!p_identifier)
+					return false;
+				memcpy(out.data(), p_identifier, out.size());
+				return true;
+			};
 
-			// NOTE. 固定のDescriptorTableで CVBとSRVの2テーブルをLocalRootSignatureのリソースとして定義している.
-			const uint32_t per_entry_descriptor_table_count = 2;
-			
-			const auto num_instance = tlas.NumInstance();
-			uint32_t num_all_instance_geometry = 0;
+			if (!func_get_identifier(raygen_name, raygen_identifier_))
 			{
-				const auto& instance_blas_index_array = tlas.GetInstanceBlasIndexArray();
-				const auto& blas_array = tlas.GetBlasArray();
-				for (auto i = 0u; i < num_instance; ++i)
-				{
-					num_all_instance_geometry += blas_array[instance_blas_index_array[i]]->NumGeometry();
-				}
+				assert(false);
+				return false;
+			}
+			// 初期化時にSOに登録したMissShaderを全て設定.
+			miss_identifier_array_.clear();
+			for (int mi = 0; mi < state_object.NumMissShader(); ++mi)
+			{
+				ShaderIdentifier identifier;
+				if (func_get_identifier(state_object.GetMissShaderName(mi), identifier))
+					miss_identifier_array_.push_back(identifier);
 			}
+			hitgroup_identifier_array_.resize(state_object.NumHitGroup());
+			for (int hi = 0; hi < state_object.NumHitGroup(); ++hi)
+			{
+				const char* hitgroup_name = state_object.GetHitgroupName(hi);
+				assert(nullptr != hitgroup_name);
+				func_get_identifier(hitgroup_name, hitgroup_identifier_array_[hi]);
+			}
+
+			p_identifier_state_object_ = &state_object;
+			identifier_raygen_name_ = raygen_name;
+
+			// 全バッファを書き直し.
+			for (auto& e : buffer_array_)
+			{
+				e.write_state.Reset();
+			}
+			return true;
+		}
+
+		// per_entry_descriptor_param_count が0だとAlignmentエラーになるため注意.
+		// BLAS内Geometryは個別のShaderRecordを持つ(multiplier_for_subgeometry_index = 1)
+		bool RtShaderTable::Update(rhi::DeviceDep* p_device, const RtSceneManager& rt_scene, const RtStateObject& state_object, const char* raygen_name)
+		{
+			update_stat_ = {};
 
 			// Shader Table.
 			// TODO. ASのインスタンス毎のマテリアルシェーダ情報からStateObjectのShaderIdentifierを取得してテーブルを作る.
 			// https://github.com/Monsho/D3D12Samples/blob/95d1c3703cdcab816bab0b5dcf1a1e42377ab803/Sample013/src/main.cpp
 			// https://github.com/microsoft/DirectX-Specs/blob/master/d3d/Raytracing.md#shader-tables
+			if (!UpdateShaderIdentifier(state_object, raygen_name))
+				return false;
 
-			constexpr uint32_t k_shader_identifier_byte_size = D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES;
-			// Table一つにつきベースのGPU Descriptor Handleを書き込むためのサイズ計算.
-			const uint32_t shader_record_resource_byte_size = sizeof(D3D12_GPU_DESCRIPTOR_HANDLE) * per_entry_descriptor_table_count;
-
-			const uint32_t shader_record_byte_size = rhi::align_to(D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT, k_shader_identifier_byte_size + shader_record_resource_byte_size);
-
-			// 現状は全Instanceが別Table.
-			// RayGenは一つ.
-			constexpr uint32_t num_raygen = 1;
-			// Missは複数登録可能とする.
-			const uint32_t num_miss = state_object.NumMissShader();
-			// HitGroup.
-			const uint32_t hit_group_count = state_object.NumHitGroup();
-			// 現在の実装ではTLAS側のInstance毎のHitgroupIndex決定時に最大Hitgroup数が必要なため, 実際のShaderTable側のHitgroup数はそれよりも多くなることは許可されない.
-			assert(hit_group_count <= tlas_hitgroup_count_max);
-			
-			// Hitgroupのrecordは全Instanceの全Geometry*Hitgourp数としている.
-			const uint32_t table_hitgroup_count = (num_all_instance_geometry * tlas_hitgroup_count_max);
-			const uint32_t shader_table_byte_size = shader_record_byte_size * (num_raygen + num_miss + table_hitgroup_count);
-
-
-			// あとで書き込み位置調整に使うので保存.
-			out.table_entry_byte_size_ = shader_record_byte_size;
+			const uint32_t hitgroup_count_max = rt_scene.NumHitGroupCountMax();
+			const uint32_t hit_group_count = static_cast<uint32_t>(hitgroup_identifier_array_.size());
+			// 現在の実装ではBLAS毎のHitgroupレコード割り当て時に最大Hitgroup数が必要なため, 実際のShaderTable側のHitgroup数はそれよりも多くなることは許可されない.
+			assert(hit_group_count <= hitgroup_count_max);
 
-			// バッファ確保.
-			rhi::BufferDep::Desc rt_shader_table_desc = {};
-			rt_shader_table_desc.element_count = 1;
-			rt_shader_table_desc.element_byte_size = shader_table_byte_size;
-			rt_shader_table_desc.heap_type = rhi::EResourceHeapType::Upload;// CPUから直接書き込むため.
-			rt_shader_table_desc.initial_state = rhi::EResourceState::General;// UploadヒープのためGeneral.
-			out.shader_table_.Reset(new rhi::BufferDep());
-			if (!out.shader_table_->Initialize(p_device, rt_shader_table_desc))
-			{
-				assert(false);
-				return false;
-			}
+			const auto& record_allocator = rt_scene.GetHitgroupRecordAllocator();
 
-			// レコード書き込み.
-			if (auto* mapped = static_cast<uint8_t*>(out.shader_table_->Map()))
-			{
-				Microsoft::WRL::ComPtr<ID3D12StateObjectProperties> p_rt_so_prop;
-				if (FAILED(state_object.GetStateObject()->QueryInterface(IID_PPV_ARGS(&p_rt_so_prop))))
+			// NOTE. 固定のDescriptorTableで CVBとSRVの2テーブルをLocalRootSignatureのリソースとして定義している.
+			constexpr uint32_t per_entry_descriptor_table_count = 2;
+			RtShaderTableLayoutDesc layout_desc = {};
+			layout_desc.shader_identifier_byte_size = D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES;
+			// Table一つにつきベースのGPU Descriptor Handleを書き込むためのサイズ.
+			layout_desc.record_param_byte_size = sizeof(D3D12_GPU_DESCRIPTOR_HANDLE) * per_entry_descriptor_table_count;
+			layout_desc.record_alignment = D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT;
+			layout_desc.table_alignment = D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT;
+			layout_desc.num_raygen = 1;
+			layout_desc.num_miss = static_cast<uint32_t>(miss_identifier_array_.size());
+			// Hitgroupのrecordは割り当て容量分. 未割り当てのレコードはどのInstanceからも参照されない.
+			layout_desc.hitgroup_record_capacity = record_allocator.GetCapacity();
+			const RtShaderTableLayout layout = ComputeShaderTableLayout(layout_desc);
+
+			// 今フレームのバッファ. GPUが参照中の可能性がある前フレームまでのバッファは書き換えない.
+			auto& table_buffer = buffer_array_[p_device->GetDeviceFrameIndex() % k_buffer_count];
+			if (!table_buffer.buffer.IsValid() || table_buffer.byte_size < layout.total_byte_size)
+			{
+				rhi::BufferDep::Desc rt_shader_table_desc = {};
+				rt_shader_table_desc.element_count = 1;
+				rt_shader_table_desc.element_byte_size = layout.total_byte_size;
+				rt_shader_table_desc.heap_type = rhi::EResourceHeapType::Upload;// CPUから直接書き込むため.
+				rt_shader_table_desc.initial_state = rhi::EResourceState::General;// UploadヒープのためGeneral.
+				// 古いバッファはRhiRefの参照が外れた時点でGabageCollectorにより遅延破棄される.
+				table_buffer.buffer.Reset(new rhi::BufferDep());
+				if (!table_buffer.buffer->Initialize(p_device, rt_shader_table_desc))
 				{
 					assert(false);
+					table_buffer = {};
+					return false;
 				}
+				table_buffer.byte_size = layout.total_byte_size;
+				table_buffer.write_state.Reset();
+			}
 
-				uint32_t table_cnt = 0;
+			// 書き込みが必要なBLASスロット.
+			const bool is_full_write = table_buffer.write_state.CollectDirtySlot(record_allocator, dirty_slot_array_);
+			update_stat_.is_full_write = is_full_write;
 
-				// raygen
-				out.table_raygen_offset_ = (shader_record_byte_size * table_cnt);
+			if (is_full_write || !dirty_slot_array_.empty())
+			{
+				auto* mapped = static_cast<uint8_t*>(table_buffer.buffer->Map());
+				if (!mapped)
 				{
-					{
-						memcpy(mapped + out.table_raygen_offset_, p_rt_so_prop->GetShaderIdentifier(str_to_wstr(raygen_name).c_str()), D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
-
-						// TODO. Local Root Signature で設定するリソースがある場合はここでGPU Descriptor Handleを書き込む.
-					}
-					++table_cnt;
+					assert(false);
+					return false;
 				}
 
-				out.table_miss_offset_ = (shader_record_byte_size * table_cnt);
-
-				// 初期化時にSOに登録したMissShaderを全て設定.
-				for(uint32_t mi = 0; mi < num_miss; ++mi)
+				if (is_full_write)
 				{
-					const void* shader_identifire = p_rt_so_prop->GetShaderIdentifier(str_to_wstr(state_object.GetMissShaderName(mi)).c_str());
-					if(shader_identifire)
+					// raygen
+					// TODO. Local Root Signature で設定するリソースがある場合はここでGPU Descriptor Handleを書き込む.
+					memcpy(mapped + layout.raygen_offset, raygen_identifier_.data(), raygen_identifier_.size());
+					// miss
+					for (uint32_t mi = 0; mi < layout.miss_count; ++mi)
 					{
-						memcpy(mapped + (shader_record_byte_size * table_cnt), shader_identifire, D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
-						++table_cnt;
+						memcpy(mapped + layout.GetMissRecordOffset(mi), miss_identifier_array_[mi].data(), miss_identifier_array_[mi].size());
 					}
 				}
 
 				// HitGroup
-				/// マテリアル分存在するHitGroupは連続領域でInstanceに指定したインデックスでアクセスされるためここ以降に順序に気をつけて書き込み.
-				// InstanceのBLASに複数のGeometryが含まれる場合はここでその分のrecordが書き込まれる.
-
-				const auto table_hitgroup_offset = shader_record_byte_size * table_cnt;
-				for (uint32_t inst_i = 0u; inst_i < num_instance; ++inst_i)
-				{
-					// 内部Geometry毎にRecord.
-					const auto& blas_index = tlas.GetInstanceBlasIndexArray()[inst_i];
-					const auto& blas = tlas.GetBlasArray()[blas_index];
-
-					const auto hitgroup_table_index_offset = tlas.GetInstanceHitgroupIndexOffsetArray()[inst_i];
-					
-					for (uint32_t geom_i = 0; geom_i < blas->NumGeometry(); ++geom_i)
+				//	BLASスロット毎に割り当てられた連続レコードに Geometry * hitgroup_count_max + Hitgroup の順で書き込む.
+				//	InstanceContributionToHitGroupIndex にはスロットの先頭レコードが設定される.
+				const auto& slot_array = record_allocator.GetSlotArray();
+				for (const auto slot_index : dirty_slot_array_)
+				{
+					const auto& slot = slot_array[slot_index];
+					const uint32_t num_geometry = slot.record_count / hitgroup_count_max;
+					for (uint32_t geom_i = 0; geom_i < num_geometry; ++geom_i)
 					{
+						// 固定LocalRootSigにより
+						//	DescriptorTable0 -> b1000からCBV最大16
+						//	DescriptorTable1 -> t1000からSRV最大16
+						// というレイアウトで登録する.
+						D3D12_GPU_DESCRIPTOR_HANDLE cbv_table = {};
+						D3D12_GPU_DESCRIPTOR_HANDLE srv_table = {};
+						if (!rt_scene.GetBlasGeometryLocalDescriptor(slot_index, geom_i, cbv_table, srv_table))
+						{
+							assert(false);
+							continue;
+						}
+
 						// Geometry毎に連続領域にHitGroup書き込み. ShaderObject側のHitGroup定義主導でTable作成.
-						for(uint32_t hitgroup_index = 0; hitgroup_index < hit_group_count; ++hitgroup_index)
+						for (uint32_t hitgroup_index = 0; hitgroup_index < hit_group_count; ++hitgroup_index)
 						{
-							const auto inst_geom_hitgroup_table_index =  hitgroup_table_index_offset + (geom_i * tlas_hitgroup_count_max) + hitgroup_index;
-							
-							const char* hitgroup_name = state_object.GetHitgroupName(hitgroup_index);
-							assert(nullptr != hitgroup_name);
-							
-							auto* geom_hit_group_name = hitgroup_name;
-							
-							// hitGroup
-							{
-								// 固定LocalRootSigにより
-								//	DescriptorTable0 -> b1000からCBV最大16
-								//	DescriptorTable1 -> t1000からSRV最大16
-								// というレイアウトで登録する.
-
-								// Entry毎のSrvセットアップ.
-								int l_srv_count = 0;
-								std::array<D3D12_CPU_DESCRIPTOR_HANDLE, k_rt_local_descriptor_cbvsrvuav_table_size> l_srv_handles;
-								{
-									const auto geom_data = blas->GetGeometryData(geom_i);
-									assert(geom_data.vertex_srv);
-									assert(geom_data.index_srv);
-
-									l_srv_handles[l_srv_count++] = geom_data.vertex_srv->GetView().cpu_handle;
-									l_srv_handles[l_srv_count++] = geom_data.index_srv->GetView().cpu_handle;
-								}
-
-								// Entry毎のCbvセットアップ.
-								int l_cbv_count = 0;
-								std::array<D3D12_CPU_DESCRIPTOR_HANDLE, k_rt_local_descriptor_cbvsrvuav_table_size> l_cbv_handles;
-								{
-									// TODO.
-								}
-
-
-								DescriptorHandleSet desc_handle_srv;
-								DescriptorHandleSet desc_handle_cbv;
-								// 描画用HeapにDescriptorコピー.
-								{
-									const auto desc_stride = desc_alloc_interface.GetManager()->GetHandleIncrementSize();
-									auto func_get_offseted_desc_handle = [](const D3D12_CPU_DESCRIPTOR_HANDLE& h_cpu, uint32_t offset)
-									{
-										D3D12_CPU_DESCRIPTOR_HANDLE ret = h_cpu;
-										ret.ptr += offset;
-										return ret;
-									};
-
-									// 少なくとも1つは確保する.
-									const bool result_alloc_desc_srv = desc_alloc_interface.Allocate(std::max(l_srv_count, 1), desc_handle_srv.h_cpu, desc_handle_srv.h_gpu);
-									assert(result_alloc_desc_srv);
-									// 有効なViewをコピー.
-									for (int l_srv_i = 0; l_srv_i < l_srv_count; ++l_srv_i)
-									{
-										p_device->GetD3D12Device()->CopyDescriptorsSimple(1, func_get_offseted_desc_handle(desc_handle_srv.h_cpu, desc_stride * l_srv_i), l_srv_handles[l_srv_i], D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-									}
-
-									// 少なくとも1つは確保する.
-									const bool result_alloc_desc_cbv = desc_alloc_interface.Allocate(std::max(l_cbv_count, 1), desc_handle_cbv.h_cpu, desc_handle_cbv.h_gpu);
-									assert(result_alloc_desc_cbv);
-									// 有効なViewをコピー.
-									for (int l_cbv_i = 0; l_cbv_i < l_cbv_count; ++l_cbv_i)
-									{
-										p_device->GetD3D12Device()->CopyDescriptorsSimple(1, func_get_offseted_desc_handle(desc_handle_cbv.h_cpu, desc_stride * l_cbv_i), l_cbv_handles[l_cbv_i], D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-									}
-								}
-
-								// 書き込み
-							
-								// Shader Identifier
-								memcpy(mapped + (table_hitgroup_offset + shader_record_byte_size * inst_geom_hitgroup_table_index), p_rt_so_prop->GetShaderIdentifier(str_to_wstr(geom_hit_group_name).c_str()), D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
-							
-								auto record_res_offset = (table_hitgroup_offset + shader_record_byte_size * inst_geom_hitgroup_table_index) + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES;
-
-								// CBV Table
-								memcpy(mapped + record_res_offset, &desc_handle_cbv.h_gpu, sizeof(D3D12_GPU_DESCRIPTOR_HANDLE));
-								record_res_offset += sizeof(D3D12_GPU_DESCRIPTOR_HANDLE);
-
-								// SRV Table
-								memcpy(mapped + record_res_offset, &desc_handle_srv.h_gpu, sizeof(D3D12_GPU_DESCRIPTOR_HANDLE));
-								record_res_offset += sizeof(D3D12_GPU_DESCRIPTOR_HANDLE);
-							}
+							const uint32_t record_index = slot.record_offset + (geom_i * hitgroup_count_max) + hitgroup_index;
+							auto record_offset = layout.GetHitgroupRecordOffset(record_index);
+
+							// Shader Identifier
+							memcpy(mapped + record_offset, hitgroup_identifier_array_[hitgroup_index].data(), D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+							record_offset += D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES;
+							// CBV Table
+							memcpy(mapped + record_offset, &cbv_table, sizeof(D3D12_GPU_DESCRIPTOR_HANDLE));
+							record_offset += sizeof(D3D12_GPU_DESCRIPTOR_HANDLE);
+							// SRV Table
+							memcpy(mapped + record_offset, &srv_table, sizeof(D3D12_GPU_DESCRIPTOR_HANDLE));
+
+							++update_stat_.num_write_record;
 						}
-						
 					}
 				}
-				out.table_hitgroup_offset_ = table_hitgroup_offset;
-				out.table_hitgroup_count_ = table_hitgroup_count;
+				update_stat_.num_write_slot = static_cast<u32>(dirty_slot_array_.size());
 
-				out.shader_table_->Unmap();
+				table_buffer.buffer->Unmap();
 			}
+
+			shader_table_ = table_buffer.buffer;
+			table_entry_byte_size_ = layout.record_byte_size;
+			table_raygen_offset_ = layout.raygen_offset;
+			table_miss_offset_ = layout.miss_offset;
+			table_miss_count_ = layout.miss_count;
+			table_hitgroup_offset_ = layout.hitgroup_offset;
+			table_hitgroup_count_ = layout.hitgroup_capacity;
 			return true;
 		}
 		// -------------------------------------------------------------------------------
@@ -1479,16 +1611,6 @@ namespace ngl
 			p_device_ = p_device;
 			assert(p_device_);
 
-			// Descriptor確保用Interface初期化.
-			{
-				rhi::DynamicDescriptorStackAllocatorInterface::Desc descriptor_interface_desc = {};
-				if (!desc_alloc_interface_.Initialize(p_device_->GeDynamicDescriptorManager(), descriptor_interface_desc))
-				{
-					assert(false);
-					return false;
-				}
-			}
-
 			// StateObject.
 			if (!state_object_.Initialize(p_device_, shader_info_array, payload_byte_size, attribute_byte_size, max_trace_recursion))
 			{
@@ -1500,30 +1622,21 @@ namespace ngl
 		}
 		void RtPassCore::DestroyShaderTable()
 		{
-			// ShaderTableに利用したDynamicDescriptorを安全に破棄.
-			desc_alloc_interface_.DeallocateDeferred((u32)desc_alloc_interface_.GetManager()->GetDevice()->GetDeviceFrameIndex());
-
-			// shader table解放.
-			shader_table_ = {};
+			// shader table解放. バッファはRhiRefで遅延破棄される.
+			shader_table_.Finalize();
 		}
 		bool RtPassCore::UpdateScene(RtSceneManager* p_rt_scene, const char* ray_gen_name)
 		{
-			// Scene用にShaderTable生成.
+			// Scene用にShaderTable更新.
 			assert(p_device_);
 			assert(p_rt_scene);
 			assert(p_rt_scene->GetSceneTlas());
 
 			p_rt_scene_ = p_rt_scene;
 
-			// 古いShaderTableを破棄.
-			DestroyShaderTable();
-
-			// ShaderTable生成. Local Resource等の設定.
-			if (!CreateShaderTable(shader_table_,
-				p_device_,
-				desc_alloc_interface_,
-				*p_rt_scene->GetSceneTlas(), p_rt_scene->NumHitGroupCountMax(),
-				state_object_, ray_gen_name))
+			// ShaderTable更新. 変更のあったBLASのHitgroupレコードのみ書き込む.
+			//	Local ResourceのDescriptorはRtSceneManagerがBLAS毎に永続で保持している.
+			if (!shader_table_.Update(p_device_, *p_rt_scene, state_object_, ray_gen_name))
 			{
 				assert(false);
 				return false;
@@ -1734,6 +1847,19 @@ namespace ngl
 		{
 			// 内部で使用しているDescriptorのDeallocをDescriptorAllocatorInterfaceの解放より先に明示的に実行.
 			dynamic_tlas_.reset();
+
+			// BLAS毎のLocal Descriptorを遅延解放.
+			if (is_initialized_)
+			{
+				auto* p_desc_manager = desc_alloc_interface_.GetManager();
+				const auto frame_index = (u32)p_desc_manager->GetDevice()->GetDeviceFrameIndex();
+				for (auto& e : blas_local_descriptor_array_)
+				{
+					if (e.handle.IsValid())
+						p_desc_manager->DeallocateDeferred(e.handle, frame_index);
+				}
+				blas_local_descriptor_array_.clear();
+			}
 		}
 		bool RtSceneManager::Initialize(rhi::DeviceDep* p_device, int hitgroup_count_max)
 		{
@@ -1752,17 +1878,78 @@ namespace ngl
 				desc_alloc_interface_.Initialize(p_device->GeDynamicDescriptorManager(), descriptor_interface_desc);
 			}
 
-			// SceneView定数バッファ.
-			for (auto i = 0; i < std::size(cbh_scene_view); ++i)
+			// TLAS Instance管理.
+			{
+				RtTlasInstanceTracker::Desc tracker_desc = {};
+				tlas_instance_tracker_.Initialize(tracker_desc);
+			}
+
+			// BLAS毎のHitgroupレコード割り当て.
+			{
+				RtHitgroupRecordAllocator::Desc record_alloc_desc = {};
+				hitgroup_record_allocator_.Initialize(record_alloc_desc);
+			}
+
+			// BLASビルドキュー.
 			{
-				cbh_scene_view[i] = p_device->GetConstantBufferPool()->Alloc(sizeof(CbSceneView));
+				RtBlasBuildScheduler::Desc scheduler_desc = {};
+				blas_build_scheduler_.Initialize(scheduler_desc);
+				const auto& desc = blas_build_scheduler_.GetDesc();
+
+				// 共有Scratchプール.
+				rhi::BufferDep::Desc scratch_desc = {};
+				scratch_desc.bind_flag = rhi::ResourceBindFlag::UnorderedAccess;
+				scratch_desc.initial_state = rhi::EResourceState::Common;// UnorderedAccessだとValidationエラー.
+				scratch_desc.heap_type = rhi::EResourceHeapType::Default;
+				scratch_desc.element_count = 1;
+				scratch_desc.element_byte_size = (u32)desc.scratch_pool_byte_size;
+				blas_scratch_pool_.Reset(new rhi::BufferDep());
+				if (!blas_scratch_pool_->Initialize(p_device, scratch_desc))
+				{
+					std::cout << "[ERROR] Initialize Rt Blas Scratch Pool." << std::endl;
+					assert(false);
+					return false;
+				}
+
+				// コンパクションサイズ書き出し先. リング毎にフレーム最大ビルド数分.
+				rhi::BufferDep::Desc postbuild_desc = {};
+				postbuild_desc.bind_flag = rhi::ResourceBindFlag::UnorderedAccess;
+				postbuild_desc.initial_state = rhi::EResourceState::Common;
+				postbuild_desc.heap_type = rhi::EResourceHeapType::Default;
+				postbuild_desc.element_count = desc.readback_ring_count * desc.max_build_per_frame;
+				postbuild_desc.element_byte_size = sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC);
+				blas_postbuild_buffer_.Reset(new rhi::BufferDep());
+				if (!blas_postbuild_buffer_->Initialize(p_device, postbuild_desc))
+				{
+					std::cout << "[ERROR] Initialize Rt Blas Postbuild Buffer." << std::endl;
+					assert(false);
+					return false;
+				}
+				blas_postbuild_buffer_state_ = rhi::EResourceState::Common;
+
+				blas_postbuild_readback_.resize(desc.readback_ring_count);
+				for (auto& e : blas_postbuild_readback_)
+				{
+					rhi::BufferDep::Desc readback_desc = {};
+					readback_desc.initial_state = rhi::EResourceState::CopyDst;
+					readback_desc.heap_type = rhi::EResourceHeapType::Readback;
+					readback_desc.element_count = desc.max_build_per_frame;
+					readback_desc.element_byte_size = sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC);
+					e.Reset(new rhi::BufferDep());
+					if (!e->Initialize(p_device, readback_desc))
+					{
+						std::cout << "[ERROR] Initialize Rt Blas Readback Buffer." << std::endl;
+						assert(false);
+						return false;
+					}
+				}
 			}
 
 			is_initialized_ = true;
 			return true;
 		}
 
-		void RtSceneManager::UpdateRtScene(rhi::DeviceDep* p_device, const SceneRepresentation& scene)
+		void RtSceneManager::UpdateRtScene(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_command_list, const SceneRepresentation& scene)
 		{
 			if(!is_initialized_)
 				return;
@@ -1791,6 +1978,14 @@ namespace ngl
 			{
 				auto* p_mesh = e;
 
+				// 頂点データのアップロードが完了していないメッシュはBLASを構築せずTLASにも含めない.
+				if (mesh_to_blas_id_.end() == mesh_to_blas_id_.find(p_mesh)
+					&& !std::all_of(p_mesh->data_.shape_array_.begin(), p_mesh->data_.shape_array_.end(), [](const MeshShapePart& shape) { return shape.IsUploadComplete(); }))
+				{
+					scene_mesh_blas_id_array.push_back(-1);
+					continue;
+				}
+
 				// BLASが存在しない場合.
 				if (mesh_to_blas_id_.end() == mesh_to_blas_id_.find(p_mesh))
 				{
@@ -1828,7 +2023,20 @@ namespace ngl
 					}
 
 					// Setup.
-					new_blas->Setup(p_device, blas_geom_desc_arrray);
+					if (new_blas->Setup(p_device, blas_geom_desc_arrray))
+					{
+						// Hitgroupレコードの割り当てとLocal Descriptorの準備. ShaderTableはこのスロットのレコードのみ書き込む.
+						hitgroup_record_allocator_.AllocateSlot(static_cast<u32>(empty_index), new_blas->NumGeometry() * hitgroup_count_max_);
+						AllocateBlasLocalDescriptor(p_device, static_cast<u32>(empty_index));
+
+						// ビルドキューへ登録.
+						RtBlasBuildRequest build_req = {};
+						build_req.id = static_cast<u32>(empty_index);
+						build_req.scratch_byte_size = new_blas->GetScratchByteSize();
+						build_req.result_byte_size = new_blas->GetResultMaxByteSize();
+						build_req.primitive_count = new_blas->GetPrimitiveCount();
+						blas_build_scheduler_.Enqueue(build_req);
+					}
 				}
 
 				scene_mesh_blas_id_array.push_back(mesh_to_blas_id_[p_mesh]);
@@ -1839,29 +2047,130 @@ namespace ngl
 			// 
 
 
-			// TLAS Setup.
+			// BLASのビルドとコンパクション.
+			UpdateBlasBuild(p_device, p_command_list);
+
+			// TLAS Instance. BLASインデックスはdynamic_scene_blas_array_上の永続インデックス.
+			tlas_instance_input_array_.clear();
+			tlas_instance_input_array_.reserve(scene.mesh_proxy_id_array_.size());
+			for (auto i = 0; i < scene.mesh_proxy_id_array_.size(); ++i)
+			{
+				auto* proxy = proxy_buffer->proxy_buffer_[scene.mesh_proxy_id_array_[i].GetIndex()];
+				const int blas_id = scene_mesh_blas_id_array[scene_inst_mesh_id_array[i]];
+				// ビルド待ちのBLASを参照するInstanceはビルド完了までTLASに含めない.
+				if (0 > blas_id || !dynamic_scene_blas_array_[blas_id]->IsBuilt())
+					continue;
+
+				RtTlasInstanceInput inst = {};
+				inst.key = scene.mesh_proxy_id_array_[i].data;// ProxyIDで永続スロットを割り当て.
+				inst.blas_index = static_cast<uint32_t>(blas_id);
+				inst.hitgroup_offset = hitgroup_record_allocator_.GetSlotRecordOffset(static_cast<u32>(blas_id));
+				inst.transform = proxy->transform_;
+				tlas_instance_input_array_.push_back(inst);
+			}
+
+			// 前フレームとの差分からアップロード範囲とビルドモードを決定.
+			tlas_instance_tracker_.Update(tlas_instance_input_array_, tlas_instance_update_result_);
+
 			std::vector<RtBlas*> scene_blas_array;
-			std::vector<math::Mat34> scene_inst_transform_array;
-			std::vector<uint32_t> scene_inst_blas_id_array;
-			for (auto e : scene_mesh_blas_id_array)
+			scene_blas_array.reserve(dynamic_scene_blas_array_.size());
+			for (auto& e : dynamic_scene_blas_array_)
 			{
-				scene_blas_array.push_back(dynamic_scene_blas_array_[e].get());
+				scene_blas_array.push_back(e.get());
 			}
-			for (auto i = 0; i < scene.mesh_proxy_id_array_.size(); ++i)
+
+			// 永続TLAS. 内部のRHIオブジェクトは全てRhiRef管理で安全に遅延破棄されるはず.
+			if (!dynamic_tlas_)
 			{
-				auto* proxy = proxy_buffer->proxy_buffer_[scene.mesh_proxy_id_array_[i].GetIndex()];
-				scene_inst_transform_array.push_back(proxy->transform_);
-				
-				scene_inst_blas_id_array.push_back(scene_inst_mesh_id_array[i]);
+				dynamic_tlas_.reset(new RtTlas());
 			}
+			// TLAS Update.
+			dynamic_tlas_->Update(p_device, scene_blas_array, tlas_instance_tracker_.GetSlotArray(), tlas_instance_update_result_);
+		}
+
+		// BLASビルドキューの処理.
+		//	GPU完了済みのフレームでビルドしたBLASのコンパクションサイズをリードバックしてコンパクションし,
+		//	予算内で選択されたBLASを共有Scratchプールでビルドする.
+		void RtSceneManager::UpdateBlasBuild(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_command_list)
+		{
+			std::vector<RtBlasCompactionItem> compaction_array;
+			std::vector<RtBlasBuildItem> build_array;
+			blas_build_scheduler_.BeginFrame(p_device->GetDeviceFrameIndex(), p_device->GetCompletedFrameIndex(), compaction_array, build_array);
+
+			const auto& desc = blas_build_scheduler_.GetDesc();
+			const u32 ring_index = blas_build_scheduler_.GetRingIndex();
+			constexpr u32 k_postbuild_elem_size = sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC);
+
+			blas_stat_.num_compaction_in_frame = 0;
+			blas_stat_.num_build_in_frame = static_cast<u32>(build_array.size());
 
-			// 新規TLAS. DynamicTlasSet内部のRHIオブジェクトは全てRhiRef管理で安全に遅延破棄されるはず.
-			dynamic_tlas_.reset(new RtTlas());
-			// TLAS Setup.
-			if (!dynamic_tlas_->Setup(p_device, scene_blas_array, scene_inst_blas_id_array, scene_inst_transform_array, hitgroup_count_max_))
+			// コンパクション. このリングのリードバックはGetCompletedFrameIndex以前のフレームで書き込まれGPU完了済み.
+			if (0 < compaction_array.size())
 			{
-				assert(false);
+				if (const auto* mapped = static_cast<const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC*>(blas_postbuild_readback_[ring_index]->Map()))
+				{
+					for (const auto& e : compaction_array)
+					{
+						auto& blas = dynamic_scene_blas_array_[e.id];
+						if (!blas)
+							continue;
+						if (blas->Compact(p_device, p_command_list, mapped[e.postbuild_index].CompactedSizeInBytes))
+							++blas_stat_.num_compaction_in_frame;
+					}
+					blas_postbuild_readback_[ring_index]->Unmap();
+				}
+				// BLASのアドレスが変わったためTLASのInstanceDescを全て書き直してフルビルド.
+				if (0 < blas_stat_.num_compaction_in_frame)
+					tlas_instance_tracker_.RequestFullRebuild();
 			}
+
+			// ビルド.
+			if (0 < build_array.size())
+			{
+				const auto scratch_base = blas_scratch_pool_->GetD3D12Resource()->GetGPUVirtualAddress();
+				const auto postbuild_base = blas_postbuild_buffer_->GetD3D12Resource()->GetGPUVirtualAddress() + static_cast<u64>(ring_index) * desc.max_build_per_frame * k_postbuild_elem_size;
+
+				if (rhi::EResourceState::UnorderedAccess != blas_postbuild_buffer_state_)
+				{
+					p_command_list->ResourceBarrier(blas_postbuild_buffer_.Get(), blas_postbuild_buffer_state_, rhi::EResourceState::UnorderedAccess);
+					blas_postbuild_buffer_state_ = rhi::EResourceState::UnorderedAccess;
+				}
+				// 前フレームのビルドとのScratchプール共有のため同期.
+				p_command_list->ResourceUavBarrier(blas_scratch_pool_.Get());
+
+				// 同一フレーム内のビルドはScratch領域が重ならないためバリア無しで連続発行できる.
+				for (const auto& e : build_array)
+				{
+					auto& blas = dynamic_scene_blas_array_[e.id];
+					if (!blas)
+						continue;
+					const D3D12_GPU_VIRTUAL_ADDRESS scratch_address = (e.use_dedicated_scratch) ? 0 : (scratch_base + e.scratch_offset);
+					blas->Build(p_device, p_command_list, scratch_address, postbuild_base + static_cast<u64>(e.postbuild_index) * k_postbuild_elem_size);
+				}
+
+				// コンパクションサイズをリードバックバッファへコピー.
+				p_command_list->ResourceBarrier(blas_postbuild_buffer_.Get(), blas_postbuild_buffer_state_, rhi::EResourceState::CopySrc);
+				blas_postbuild_buffer_state_ = rhi::EResourceState::CopySrc;
+				p_command_list->CopyBufferRegion(blas_postbuild_readback_[ring_index].Get(), 0,
+					blas_postbuild_buffer_.Get(), static_cast<u64>(ring_index) * desc.max_build_per_frame * k_postbuild_elem_size,
+					static_cast<u64>(build_array.size()) * k_postbuild_elem_size);
+			}
+
+			// 統計.
+			blas_stat_.num_blas = 0;
+			blas_stat_.result_max_byte = 0;
+			blas_stat_.result_byte = 0;
+			for (const auto& e : dynamic_scene_blas_array_)
+			{
+				if (!e)
+					continue;
+				++blas_stat_.num_blas;
+				blas_stat_.result_max_byte += e->GetResultMaxByteSize();
+				blas_stat_.result_byte += e->GetResultByteSize();
+			}
+			blas_stat_.num_pending_build = blas_build_scheduler_.NumPendingBuild();
+			blas_stat_.num_pending_compaction = blas_build_scheduler_.NumPendingCompaction();
+			blas_stat_.scratch_pool_byte = desc.scratch_pool_byte_size;
 		}
 
 		void RtSceneManager::UpdateOnRender(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_command_list, const SceneRepresentation& scene)
@@ -1874,22 +2183,13 @@ namespace ngl
 
 			// 動的Scene.
 			{
-				// ASのセットアップやShaderTable構築等.
-				UpdateRtScene(p_device, scene);
-				
-				// BLASのビルドが必要なものをビルド.
-				for (auto& e : dynamic_scene_blas_array_)
-				{
-					if (e.get() && e->IsSetuped() && !e->IsBuilt())
-					{
-						e->Build(p_device, p_command_list);
-					}
-				}
+				// ASのセットアップやBLASのビルド等.
+				UpdateRtScene(p_device, p_command_list, scene);
 
-				// TLAS ビルド.
+				// TLAS ビルド. 変更があった場合のみRefitまたはフルビルド.
 				if (dynamic_tlas_.get() && 
 					dynamic_tlas_->IsSetuped() &&
-					!dynamic_tlas_->IsBuilt()
+					dynamic_tlas_->IsBuildPending()
 					)
 				{
 					dynamic_tlas_->Build(p_device, p_command_list);
@@ -1926,10 +2226,12 @@ namespace ngl
 				s_scene_prev_view_proj_initialized = true;
 			}
 
-			// 定数バッファ更新.
+			// 定数バッファ更新. フレーム毎にPoolから確保し, 前フレームのものはGPU完了後にPoolへ戻る.
+			//	Frames In Flight 数によらずGPU実行中のフレームが参照するバッファを上書きしない.
+			cbh_scene_view = p_device->GetConstantBufferPool()->Alloc(sizeof(CbSceneView));
+			if (cbh_scene_view)
 			{
-				const auto cb_index = frame_count_ % std::size(cbh_scene_view);
-				if (auto* mapped = static_cast<CbSceneView*>(cbh_scene_view[cb_index]->buffer.Map()))
+				if (auto* mapped = static_cast<CbSceneView*>(cbh_scene_view->buffer.Map()))
 				{
 					mapped->cb_view_mtx = view_mat;
 					mapped->cb_proj_mtx = proj_mat;
@@ -1941,7 +2243,7 @@ namespace ngl
 
 					mapped->cb_ndc_z_to_view_z_coef = ndc_z_to_view_z_coef;
 
-					cbh_scene_view[cb_index]->buffer.Unmap();
+					cbh_scene_view->buffer.Unmap();
 				}
 			}
 
@@ -1963,26 +2265,108 @@ namespace ngl
 			return dynamic_tlas_.get();
 		}
 		
+		RtTlas::UpdateStatistics RtSceneManager::GetTlasUpdateStatistics() const
+		{
+			if (!is_initialized_ || !dynamic_tlas_)
+				return {};
+			return dynamic_tlas_->GetUpdateStatistics();
+		}
+
+		RtSceneManager::BlasStatistics RtSceneManager::GetBlasStatistics() const
+		{
+			if (!is_initialized_)
+				return {};
+			return blas_stat_;
+		}
+
 		int RtSceneManager::NumHitGroupCountMax() const
 		{
 			return hitgroup_count_max_;
 		}
+
+		// BLASのGeometry毎にLocalRootSignature用のDescriptorTableを確保して頂点とインデックスのSRVをコピーする.
+		//	ShaderTableの書き直しの度にDescriptorをコピーしないようにBLASと同じ寿命で保持する.
+		void RtSceneManager::AllocateBlasLocalDescriptor(rhi::DeviceDep* p_device, u32 blas_index)
+		{
+			if (blas_local_descriptor_array_.size() <= blas_index)
+				blas_local_descriptor_array_.resize(blas_index + 1);
+
+			auto* p_desc_manager = desc_alloc_interface_.GetManager();
+			auto& local_desc = blas_local_descriptor_array_[blas_index];
+			if (local_desc.handle.IsValid())
+			{
+				// スロット再利用時は古いDescriptorを遅延解放.
+				p_desc_manager->DeallocateDeferred(local_desc.handle, (u32)p_device->GetDeviceFrameIndex());
+				local_desc = {};
+			}
+
+			auto& blas = dynamic_scene_blas_array_[blas_index];
+			const u32 num_geometry = blas->NumGeometry();
+			if (0 == num_geometry)
+				return;
+
+			local_desc.handle = p_desc_manager->AllocateDescriptorArray(num_geometry * k_rt_blas_geometry_local_descriptor_count);
+			if (!local_desc.handle.IsValid())
+			{
+				assert(false);
+				return;
+			}
+			D3D12_CPU_DESCRIPTOR_HANDLE h_cpu = {};
+			p_desc_manager->GetDescriptor(local_desc.handle, h_cpu, local_desc.h_gpu);
+
+			const auto desc_stride = p_desc_manager->GetHandleIncrementSize();
+			local_descriptor_stride_ = desc_stride;
+			// ダミー用のcbv, srv, uav用デフォルトDescriptor.
+			const auto def_descriptor = p_device->GetPersistentDescriptorAllocator()->GetDefaultPersistentDescriptor();
+			for (u32 geom_i = 0; geom_i < num_geometry; ++geom_i)
+			{
+				const auto geom_data = blas->GetGeometryData(geom_i);
+				assert(geom_data.vertex_srv);
+				assert(geom_data.index_srv);
+
+				const std::array<D3D12_CPU_DESCRIPTOR_HANDLE, k_rt_blas_geometry_local_descriptor_count> src_handles =
+				{
+					// CBV Table. 固定LocalRootSignatureはCBVテーブルを持つが, HitGroupシェーダは Local CBV を参照しない (Geometry毎のデータは頂点とインデックスのSRVのみ).
+					//	テーブルの先頭を有効なDescriptorにするためのダミーで, 意図したもの.
+					def_descriptor.cpu_handle,
+					// SRV Table.
+					geom_data.vertex_srv->GetView().cpu_handle,
+					geom_data.index_srv->GetView().cpu_handle,
+				};
+				for (u32 i = 0; i < k_rt_blas_geometry_local_descriptor_count; ++i)
+				{
+					D3D12_CPU_DESCRIPTOR_HANDLE dst = h_cpu;
+					dst.ptr += desc_stride * (geom_i * k_rt_blas_geometry_local_descriptor_count + i);
+					p_device->GetD3D12Device()->CopyDescriptorsSimple(1, dst, src_handles[i], D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+				}
+			}
+		}
+
+		bool RtSceneManager::GetBlasGeometryLocalDescriptor(u32 blas_index, u32 geometry_index, D3D12_GPU_DESCRIPTOR_HANDLE& out_cbv_table, D3D12_GPU_DESCRIPTOR_HANDLE& out_srv_table) const
+		{
+			if (blas_local_descriptor_array_.size() <= blas_index || !blas_local_descriptor_array_[blas_index].handle.IsValid())
+				return false;
+
+			out_cbv_table = blas_local_descriptor_array_[blas_index].h_gpu;
+			out_cbv_table.ptr += local_descriptor_stride_ * (geometry_index * k_rt_blas_geometry_local_descriptor_count);
+			out_srv_table = out_cbv_table;
+			out_srv_table.ptr += local_descriptor_stride_ * k_rt_blas_geometry_local_cbv_count;
+			return true;
+		}
 		
 		rhi::ConstantBufferViewDep* RtSceneManager::GetSceneViewCbv()
 		{
 			if(!is_initialized_)
 				return nullptr;
 			
-			const auto cb_index = frame_count_ % std::size(cbh_scene_view);
-			return (cbh_scene_view[cb_index]->buffer.IsValid())? &cbh_scene_view[cb_index]->cbv : nullptr;
+			return (cbh_scene_view && cbh_scene_view->buffer.IsValid())? &cbh_scene_view->cbv : nullptr;
 		}
 		const rhi::ConstantBufferViewDep* RtSceneManager::GetSceneViewCbv() const
 		{
 			if(!is_initialized_)
 				return nullptr;
 			
-			const auto cb_index = frame_count_ % std::size(cbh_scene_view);
-			return (cbh_scene_view[cb_index]->buffer.IsValid())? &cbh_scene_view[cb_index]->cbv : nullptr;
+			return (cbh_scene_view && cbh_scene_view->buffer.IsValid())? &cbh_scene_view->cbv : nullptr;
 		}
 
 		void RtSceneManager::DispatchRay(rhi::GraphicsCommandListDep* p_command_list, const DispatchRayParam& param)
@@ -1990,8 +2374,6 @@ namespace ngl
 			if(!is_initialized_)
 				return;
 			
-			const auto cb_index = frame_count_ % std::size(cbh_scene_view);
-
 			rhi::DeviceDep* p_device = p_command_list->GetDevice();
 			auto* d3d_device = p_device->GetD3D12Device();
 			auto* d3d_command_list = p_command_list->GetD3D12GraphicsCommandList4();
@@ -2003,6 +2385,8 @@ namespace ngl
 
 			// Bind the root signature
 			d3d_command_list->SetComputeRootSignature(param.p_state_object->GetGlobalRootSignature());
+			// RootSignatureとDescriptorHeapを直接変更するため, CommandListが保持する設定状態を破棄.
+			p_command_list->InvalidateDescriptorBindingState();
 			// State.
 			d3d_command_list->SetPipelineState1(param.p_state_object->GetStateObject());
 
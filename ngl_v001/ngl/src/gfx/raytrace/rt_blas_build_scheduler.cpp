@@ -0,0 +1,270 @@
+﻿#include "gfx/raytrace/rt_blas_build_scheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace ngl
+{
+	namespace gfx
+	{
+		namespace
+		{
+			u64 AlignUp(u64 v, u64 align)
+			{
+				return (v + align - 1) & ~(align - 1);
+			}
+		}
+
+		RtBlasBuildScheduler::RtBlasBuildScheduler()
+		{
+		}
+		RtBlasBuildScheduler::~RtBlasBuildScheduler()
+		{
+		}
+
+		void RtBlasBuildScheduler::Initialize(const Desc& desc)
+		{
+			desc_ = desc;
+			desc_.max_build_per_frame = std::max(1u, desc_.max_build_per_frame);
+			desc_.readback_ring_count = std::max(1u, desc_.readback_ring_count);
+
+			pending_.clear();
+			inflight_.clear();
+			inflight_.resize(desc_.readback_ring_count);
+			ring_index_ = 0;
+			frame_count_ = 0;
+			frame_scratch_usage_ = 0;
+		}
+
+		void RtBlasBuildScheduler::Enqueue(const RtBlasBuildRequest& request)
+		{
+			pending_.push_back(request);
+		}
+
+		u32 RtBlasBuildScheduler::NumPendingCompaction() const
+		{
+			u32 count = 0;
+			for (const auto& e : inflight_)
+				count += static_cast<u32>(e.size());
+			return count;
+		}
+
+		void RtBlasBuildScheduler::BeginFrame(u64 frame_index, u64 completed_frame_index, std::vector<RtBlasCompactionItem>& out_compaction, std::vector<RtBlasBuildItem>& out_build)
+		{
+			out_compaction.clear();
+			out_build.clear();
+			frame_scratch_usage_ = 0;
+
+			ring_index_ = static_cast<u32>(frame_count_ % desc_.readback_ring_count);
+
+			// このリングに前回ビルドしたフレームがGPU未完了ならリードバックもリングの再利用もできないため, 今フレームは停止して次フレームで同じリングを再試行する.
+			//	同一リングのビルドは全て同一フレームで発行されている.
+			if (!inflight_[ring_index_].empty() && completed_frame_index < inflight_[ring_index_].front().build_frame_index)
+				return;
+			++frame_count_;
+
+			// GPU完了済みのフレームでビルドしたBLASはリードバック済み.
+			out_compaction.swap(inflight_[ring_index_]);
+			inflight_[ring_index_].clear();
+
+			// 予算内でFIFO順にビルド対象を選択.
+			//	進行を保証するため, 先頭の要求は予算を超えていても1つはビルドする.
+			u64 scratch_offset = 0;
+			u64 result_byte = 0;
+			u64 primitive_count = 0;
+			while (!pending_.empty() && out_build.size() < desc_.max_build_per_frame)
+			{
+				const auto& req = pending_.front();
+				const bool is_first = out_build.empty();
+
+				if (!is_first)
+				{
+					if (desc_.max_result_byte_per_frame < result_byte + req.result_byte_size)
+						break;
+					if (desc_.max_primitive_per_frame < primitive_count + req.primitive_count)
+						break;
+				}
+
+				RtBlasBuildItem item = {};
+				item.id = req.id;
+				item.postbuild_index = static_cast<u32>(out_build.size());
+
+				const u64 aligned_offset = AlignUp(scratch_offset, k_scratch_alignment);
+				if (desc_.scratch_pool_byte_size < req.scratch_byte_size)
+				{
+					// プールに収まらない要求は専用Scratchで単独ビルド.
+					if (!is_first)
+						break;
+					item.use_dedicated_scratch = true;
+				}
+				else if (desc_.scratch_pool_byte_size < aligned_offset + req.scratch_byte_size)
+				{
+					// 今フレームのプール残量不足.
+					break;
+				}
+				else
+				{
+					item.scratch_offset = aligned_offset;
+					scratch_offset = aligned_offset + req.scratch_byte_size;
+				}
+
+				result_byte += req.result_byte_size;
+				primitive_count += req.primitive_count;
+
+				out_build.push_back(item);
+				inflight_[ring_index_].push_back({ item.id, ring_index_, item.postbuild_index, frame_index });
+				pending_.pop_front();
+
+				if (item.use_dedicated_scratch)
+					break;
+			}
+			frame_scratch_usage_ = scratch_offset;
+		}
+
+		void TestRtBlasBuildScheduler()
+		{
+			bool is_ok = true;
+
+			RtBlasBuildScheduler::Desc desc = {};
+			desc.scratch_pool_byte_size = 4096;
+			desc.max_build_per_frame = 3;
+			desc.max_result_byte_per_frame = 1000;
+			desc.max_primitive_per_frame = 500;
+			desc.readback_ring_count = 3;
+			RtBlasBuildScheduler scheduler;
+			scheduler.Initialize(desc);
+
+			const auto Enqueue = [&scheduler](u32 id, u64 scratch, u64 result, u32 primitive)
+			{
+				RtBlasBuildRequest req = {};
+				req.id = id;
+				req.scratch_byte_size = scratch;
+				req.result_byte_size = result;
+				req.primitive_count = primitive;
+				scheduler.Enqueue(req);
+			};
+			std::vector<RtBlasCompactionItem> compaction;
+			std::vector<RtBlasBuildItem> build;
+			// GPUは2フレーム遅れで完了する.
+			u64 frame_index = 10;
+			u64 gpu_latency = 2;
+			const auto BeginFrame = [&]()
+			{
+				++frame_index;
+				scheduler.BeginFrame(frame_index, frame_index - gpu_latency, compaction, build);
+			};
+			const auto IsBuildId = [&build](std::initializer_list<u32> expect)
+			{
+				if (expect.size() != build.size())
+					return false;
+				u32 i = 0;
+				for (const auto id : expect)
+				{
+					if (id != build[i].id || i != build[i].postbuild_index)
+						return false;
+					++i;
+				}
+				return true;
+			};
+			const auto IsCompactionId = [&compaction](std::initializer_list<u32> expect, u32 ring_index)
+			{
+				if (expect.size() != compaction.size())
+					return false;
+				u32 i = 0;
+				for (const auto id : expect)
+				{
+					// ビルド時のリングとpostbuild_indexを保持している.
+					if (id != compaction[i].id || ring_index != compaction[i].ring_index || i != compaction[i].postbuild_index)
+						return false;
+					++i;
+				}
+				return true;
+			};
+
+			// ビルド数の上限とScratchのアラインメント. Scratchはフレーム毎に先頭から再利用する.
+			for (u32 id = 0; id < 5; ++id)
+				Enqueue(id, 100, 10, 10);
+			BeginFrame();
+			is_ok &= (0 == scheduler.GetRingIndex()) && compaction.empty() && IsBuildId({0, 1, 2});
+			is_ok &= (0 == build[0].scratch_offset) && (256 == build[1].scratch_offset) && (512 == build[2].scratch_offset);
+			is_ok &= (612 == scheduler.GetFrameScratchUsage()) && (2 == scheduler.NumPendingBuild());
+			BeginFrame();
+			is_ok &= (1 == scheduler.GetRingIndex()) && compaction.empty() && IsBuildId({3, 4});
+			is_ok &= (0 == build[0].scratch_offset) && (256 == build[1].scratch_offset) && (356 == scheduler.GetFrameScratchUsage());
+			is_ok &= (5 == scheduler.NumPendingCompaction());
+
+			// コンパクションサイズはビルドしたフレームのGPU完了後, リングが一周した時点でリードバック済みとなる.
+			BeginFrame();
+			is_ok &= (2 == scheduler.GetRingIndex()) && compaction.empty() && build.empty() && (0 == scheduler.GetFrameScratchUsage());
+			BeginFrame();
+			is_ok &= (0 == scheduler.GetRingIndex()) && IsCompactionId({0, 1, 2}, 0) && (11 == compaction[0].build_frame_index) && (2 == scheduler.NumPendingCompaction());
+			BeginFrame();
+			is_ok &= (1 == scheduler.GetRingIndex()) && IsCompactionId({3, 4}, 1) && (0 == scheduler.NumPendingCompaction());
+
+			// 結果メモリの予算. 先頭は予算を超えていてもビルドする.
+			Enqueue(10, 16, 600, 1);
+			Enqueue(11, 16, 600, 1);
+			Enqueue(12, 16, 5000, 1);
+			BeginFrame();
+			is_ok &= IsBuildId({10});
+			BeginFrame();
+			is_ok &= IsBuildId({11});
+			BeginFrame();
+			is_ok &= IsBuildId({12});
+
+			// プリミティブ数の予算.
+			Enqueue(20, 16, 1, 300);
+			Enqueue(21, 16, 1, 300);
+			BeginFrame();
+			is_ok &= IsBuildId({20});
+			BeginFrame();
+			is_ok &= IsBuildId({21});
+
+			// Scratchプールの残量不足は次フレームへ. アラインメント込みで判定する.
+			Enqueue(30, 3000, 1, 1);
+			Enqueue(31, 1000, 1, 1);
+			Enqueue(32, 1000, 1, 1);
+			BeginFrame();
+			is_ok &= IsBuildId({30, 31}) && (3072 == build[1].scratch_offset) && !build[1].use_dedicated_scratch;
+			is_ok &= (4072 == scheduler.GetFrameScratchUsage()) && (scheduler.GetFrameScratchUsage() <= desc.scratch_pool_byte_size);
+			BeginFrame();
+			is_ok &= IsBuildId({32}) && (0 == build[0].scratch_offset);
+
+			// プールに収まらない要求は専用Scratchで単独ビルド. 先頭でなければ次フレームへ.
+			Enqueue(40, 16, 1, 1);
+			Enqueue(41, 10000, 1, 1);
+			Enqueue(42, 16, 1, 1);
+			BeginFrame();
+			is_ok &= IsBuildId({40}) && !build[0].use_dedicated_scratch;
+			BeginFrame();
+			is_ok &= IsBuildId({41}) && build[0].use_dedicated_scratch && (0 == scheduler.GetFrameScratchUsage());
+			BeginFrame();
+			is_ok &= IsBuildId({42});
+
+			// GPUがリング数以上遅延した場合はリングを再利用せず, コンパクションもビルドも停止する.
+			Enqueue(50, 16, 1, 1);
+			Enqueue(51, 16, 1, 1);
+			Enqueue(52, 16, 1, 1);
+			gpu_latency = 5;
+			BeginFrame();
+			const u32 stall_ring = scheduler.GetRingIndex();
+			is_ok &= compaction.empty() && build.empty() && (3 == scheduler.NumPendingBuild());
+			BeginFrame();
+			is_ok &= (stall_ring == scheduler.GetRingIndex()) && compaction.empty() && build.empty() && (3 == scheduler.NumPendingBuild());
+			// GPUが追いつくと停止したリングから再開する.
+			gpu_latency = 1;
+			BeginFrame();
+			is_ok &= (stall_ring == scheduler.GetRingIndex()) && IsCompactionId({40}, stall_ring) && IsBuildId({50, 51, 52});
+
+			// 全てのビルドはGPU完了後にコンパクション対象となる.
+			for (u32 i = 0; i < desc.readback_ring_count; ++i)
+				BeginFrame();
+			is_ok &= (0 == scheduler.NumPendingBuild()) && (0 == scheduler.NumPendingCompaction());
+
+			std::cout << "[TestRtBlasBuildScheduler]";
+			std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+			assert(is_ok);
+		}
+	}
+}
@@ -0,0 +1,311 @@
+﻿#include "gfx/raytrace/rt_shader_table_record.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace ngl
+{
+	namespace gfx
+	{
+		namespace
+		{
+			u32 AlignUp(u32 v, u32 align)
+			{
+				return (0 == align) ? v : ((v + align - 1) / align * align);
+			}
+		}
+
+		RtShaderTableLayout ComputeShaderTableLayout(const RtShaderTableLayoutDesc& desc)
+		{
+			RtShaderTableLayout out = {};
+			out.record_byte_size = AlignUp(desc.shader_identifier_byte_size + desc.record_param_byte_size, desc.record_alignment);
+
+			u32 offset = 0;
+			out.raygen_offset = offset;
+			offset = AlignUp(offset + out.record_byte_size * desc.num_raygen, desc.table_alignment);
+
+			out.miss_offset = offset;
+			out.miss_count = desc.num_miss;
+			offset = AlignUp(offset + out.record_byte_size * desc.num_miss, desc.table_alignment);
+
+			out.hitgroup_offset = offset;
+			out.hitgroup_capacity = desc.hitgroup_record_capacity;
+			offset += out.record_byte_size * desc.hitgroup_record_capacity;
+
+			out.total_byte_size = offset;
+			return out;
+		}
+
+
+		RtHitgroupRecordAllocator::RtHitgroupRecordAllocator()
+		{
+		}
+		RtHitgroupRecordAllocator::~RtHitgroupRecordAllocator()
+		{
+		}
+
+		void RtHitgroupRecordAllocator::Initialize(const Desc& desc)
+		{
+			desc_ = desc;
+			desc_.grow_rate = std::max(1.0f, desc_.grow_rate);
+
+			free_range_array_.clear();
+			slot_array_.clear();
+			capacity_ = desc_.initial_capacity;
+			++capacity_version_;
+			num_allocated_record_ = 0;
+			if (0 < capacity_)
+				free_range_array_.push_back({ 0, capacity_ });
+		}
+
+		u32 RtHitgroupRecordAllocator::AllocateRange(u32 count)
+		{
+			// First-fit.
+			for (size_t i = 0; i < free_range_array_.size(); ++i)
+			{
+				auto& r = free_range_array_[i];
+				if (count <= r.count)
+				{
+					const u32 offset = r.begin;
+					r.begin += count;
+					r.count -= count;
+					if (0 == r.count)
+						free_range_array_.erase(free_range_array_.begin() + i);
+					return offset;
+				}
+			}
+
+			// 容量拡張. 末尾の空き範囲に続けて確保する.
+			const u32 tail_free = (!free_range_array_.empty() && free_range_array_.back().begin + free_range_array_.back().count == capacity_) ? free_range_array_.back().count : 0;
+			const u32 required = capacity_ - tail_free + count;
+			const u32 new_capacity = std::max(required, static_cast<u32>(static_cast<float>(capacity_) * desc_.grow_rate));
+			FreeRange(capacity_, new_capacity - capacity_);
+			capacity_ = new_capacity;
+			++capacity_version_;
+			return AllocateRange(count);
+		}
+
+		void RtHitgroupRecordAllocator::FreeRange(u32 offset, u32 count)
+		{
+			if (0 == count)
+				return;
+			auto it = std::lower_bound(free_range_array_.begin(), free_range_array_.end(), offset, [](const FreeBlock& r, u32 v) { return r.begin < v; });
+			it = free_range_array_.insert(it, { offset, count });
+
+			// 後方と結合.
+			auto next = it + 1;
+			if (free_range_array_.end() != next && it->begin + it->count == next->begin)
+			{
+				it->count += next->count;
+				free_range_array_.erase(next);
+			}
+			// 前方と結合.
+			if (free_range_array_.begin() != it)
+			{
+				auto prev = it - 1;
+				if (prev->begin + prev->count == it->begin)
+				{
+					prev->count += it->count;
+					free_range_array_.erase(it);
+				}
+			}
+		}
+
+		u32 RtHitgroupRecordAllocator::AllocateSlot(u32 slot_index, u32 record_count)
+		{
+			if (slot_array_.size() <= slot_index)
+				slot_array_.resize(slot_index + 1);
+
+			auto& slot = slot_array_[slot_index];
+			if (slot.IsValid() && slot.record_count == record_count)
+				return slot.record_offset;
+
+			FreeSlot(slot_index);
+			if (0 == record_count)
+				return k_rt_hitgroup_record_invalid_offset;
+
+			auto& new_slot = slot_array_[slot_index];
+			new_slot.record_offset = AllocateRange(record_count);
+			new_slot.record_count = record_count;
+			new_slot.generation = ++generation_;
+			num_allocated_record_ += record_count;
+			return new_slot.record_offset;
+		}
+
+		void RtHitgroupRecordAllocator::FreeSlot(u32 slot_index)
+		{
+			if (slot_array_.size() <= slot_index)
+				return;
+			auto& slot = slot_array_[slot_index];
+			if (!slot.IsValid())
+				return;
+
+			FreeRange(slot.record_offset, slot.record_count);
+			num_allocated_record_ -= slot.record_count;
+			slot.record_offset = k_rt_hitgroup_record_invalid_offset;
+			slot.record_count = 0;
+			slot.generation = ++generation_;
+		}
+
+		void RtHitgroupRecordAllocator::InvalidateSlot(u32 slot_index)
+		{
+			if (slot_array_.size() <= slot_index)
+				return;
+			slot_array_[slot_index].generation = ++generation_;
+		}
+
+		u32 RtHitgroupRecordAllocator::GetSlotRecordOffset(u32 slot_index) const
+		{
+			if (slot_array_.size() <= slot_index)
+				return k_rt_hitgroup_record_invalid_offset;
+			return slot_array_[slot_index].record_offset;
+		}
+
+
+		bool RtShaderTableWriteState::CollectDirtySlot(const RtHitgroupRecordAllocator& allocator, std::vector<u32>& out_slot_array)
+		{
+			out_slot_array.clear();
+
+			const auto& slot_array = allocator.GetSlotArray();
+			const bool is_full = !is_written_ || (capacity_version_ != allocator.GetCapacityVersion());
+			if (is_full)
+			{
+				written_generation_.assign(slot_array.size(), 0);
+				capacity_version_ = allocator.GetCapacityVersion();
+				is_written_ = true;
+			}
+			else if (written_generation_.size() < slot_array.size())
+			{
+				written_generation_.resize(slot_array.size(), 0);
+			}
+
+			for (u32 i = 0; i < slot_array.size(); ++i)
+			{
+				const auto& slot = slot_array[i];
+				if (!is_full && written_generation_[i] == slot.generation)
+					continue;
+				written_generation_[i] = slot.generation;
+				// 解放済みスロットは参照するInstanceが無いため書き込み不要.
+				if (slot.IsValid())
+					out_slot_array.push_back(i);
+			}
+			return is_full;
+		}
+
+		void RtShaderTableWriteState::Reset()
+		{
+			is_written_ = false;
+			written_generation_.clear();
+		}
+
+		void TestRtShaderTableRecord()
+		{
+			bool is_ok = true;
+
+			// レイアウト. 各テーブルの先頭はtable_alignment, レコードはrecord_alignmentに揃う.
+			{
+				RtShaderTableLayoutDesc desc = {};
+				desc.record_param_byte_size = 8;
+				desc.num_miss = 2;
+				desc.hitgroup_record_capacity = 10;
+				const auto layout = ComputeShaderTableLayout(desc);
+				is_ok &= (64 == layout.record_byte_size) && (0 == layout.raygen_offset) && (64 == layout.miss_offset) && (192 == layout.hitgroup_offset);
+				is_ok &= (192 + 64 * 10 == layout.total_byte_size) && (192 + 64 * 3 == layout.GetHitgroupRecordOffset(3)) && (128 == layout.GetMissRecordOffset(1));
+
+				desc.record_param_byte_size = 0;
+				const auto layout_no_param = ComputeShaderTableLayout(desc);
+				is_ok &= (32 == layout_no_param.record_byte_size) && (64 == layout_no_param.miss_offset) && (128 == layout_no_param.hitgroup_offset);
+			}
+
+			RtHitgroupRecordAllocator::Desc desc = {};
+			desc.initial_capacity = 8;
+			desc.grow_rate = 1.5f;
+			RtHitgroupRecordAllocator allocator;
+			allocator.Initialize(desc);
+
+			// 有効なスロットの範囲が容量内で重ならず, 割り当て数と一致する.
+			const auto IsConsistent = [&allocator]()
+			{
+				std::vector<u8> used(allocator.GetCapacity(), 0);
+				u32 num_record = 0;
+				for (const auto& slot : allocator.GetSlotArray())
+				{
+					if (!slot.IsValid())
+						continue;
+					if (allocator.GetCapacity() < slot.record_offset + slot.record_count)
+						return false;
+					for (u32 i = 0; i < slot.record_count; ++i)
+					{
+						if (used[slot.record_offset + i])
+							return false;
+						used[slot.record_offset + i] = 1;
+					}
+					num_record += slot.record_count;
+				}
+				return num_record == allocator.NumAllocatedRecord();
+			};
+
+			RtShaderTableWriteState write_state_a;
+			RtShaderTableWriteState write_state_b;
+			std::vector<u32> dirty_slot;
+
+			// 割り当て. 同数の再割り当ては範囲と世代を維持する.
+			is_ok &= (0 == allocator.AllocateSlot(0, 3)) && (3 == allocator.AllocateSlot(1, 2)) && (5 == allocator.AllocateSlot(2, 2));
+			const u32 gen0 = allocator.GetSlotArray()[0].generation;
+			is_ok &= (0 == allocator.AllocateSlot(0, 3)) && (gen0 == allocator.GetSlotArray()[0].generation);
+			is_ok &= (7 == allocator.NumAllocatedRecord()) && IsConsistent();
+			const u32 capacity_version0 = allocator.GetCapacityVersion();
+
+			// 初回は全体の書き直し.
+			is_ok &= write_state_a.CollectDirtySlot(allocator, dirty_slot) && (std::vector<u32>{0, 1, 2} == dirty_slot);
+			is_ok &= !write_state_a.CollectDirtySlot(allocator, dirty_slot) && dirty_slot.empty();
+
+			// 解放した範囲は先頭から再利用される. 解放済みスロットは書き込み対象に含まない.
+			allocator.FreeSlot(1);
+			is_ok &= (3 == allocator.AllocateSlot(3, 1)) && (6 == allocator.NumAllocatedRecord());
+			is_ok &= !write_state_a.CollectDirtySlot(allocator, dirty_slot) && (std::vector<u32>{3} == dirty_slot);
+
+			// 内容変更の通知は範囲を維持したまま書き直し対象になる.
+			allocator.InvalidateSlot(2);
+			is_ok &= (5 == allocator.GetSlotRecordOffset(2));
+			is_ok &= !write_state_a.CollectDirtySlot(allocator, dirty_slot) && (std::vector<u32>{2} == dirty_slot);
+
+			// 空き [4,5) と [7,8) に収まらないため拡張. 末尾の空きに続けて確保する.
+			is_ok &= (7 == allocator.AllocateSlot(4, 2));
+			is_ok &= (12 == allocator.GetCapacity()) && (capacity_version0 != allocator.GetCapacityVersion()) && IsConsistent();
+			// 容量拡張後はバッファ再生成のため全体の書き直し.
+			is_ok &= write_state_a.CollectDirtySlot(allocator, dirty_slot) && (std::vector<u32>{0, 2, 3, 4} == dirty_slot);
+
+			// 隣接する空き範囲は結合されて大きな要求に再利用される. [4,5) + [5,7).
+			allocator.FreeSlot(2);
+			is_ok &= (4 == allocator.AllocateSlot(5, 3)) && IsConsistent();
+
+			// レコード数の変更は再割り当て. [0,3) に収まらないため拡張する.
+			const u32 capacity_version1 = allocator.GetCapacityVersion();
+			is_ok &= (9 == allocator.AllocateSlot(0, 4)) && (18 == allocator.GetCapacity()) && (capacity_version1 != allocator.GetCapacityVersion());
+			is_ok &= IsConsistent() && (10 == allocator.NumAllocatedRecord());
+
+			// 別バッファの書き込み状態は独立. 前回の書き込み以降の変更をまとめて収集する.
+			is_ok &= write_state_b.CollectDirtySlot(allocator, dirty_slot) && (std::vector<u32>{0, 3, 4, 5} == dirty_slot);
+			is_ok &= write_state_a.CollectDirtySlot(allocator, dirty_slot) && (std::vector<u32>{0, 3, 4, 5} == dirty_slot);
+			allocator.InvalidateSlot(3);
+			is_ok &= !write_state_a.CollectDirtySlot(allocator, dirty_slot) && (std::vector<u32>{3} == dirty_slot);
+			allocator.InvalidateSlot(4);
+			is_ok &= !write_state_b.CollectDirtySlot(allocator, dirty_slot) && (std::vector<u32>{3, 4} == dirty_slot);
+
+			// Reset後は全体の書き直し.
+			write_state_b.Reset();
+			is_ok &= write_state_b.CollectDirtySlot(allocator, dirty_slot) && (std::vector<u32>{0, 3, 4, 5} == dirty_slot);
+
+			// 0個の割り当ては解放と同じ.
+			is_ok &= (k_rt_hitgroup_record_invalid_offset == allocator.AllocateSlot(5, 0)) && !allocator.GetSlotArray()[5].IsValid();
+			is_ok &= (k_rt_hitgroup_record_invalid_offset == allocator.GetSlotRecordOffset(100));
+			is_ok &= IsConsistent() && (7 == allocator.NumAllocatedRecord());
+
+			std::cout << "[TestRtShaderTableRecord]";
+			std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+			assert(is_ok);
+		}
+	}
+}
@@ -0,0 +1,370 @@
+﻿#include "gfx/raytrace/rt_tlas_instance_tracker.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+
+namespace ngl
+{
+	namespace gfx
+	{
+		RtTlasInstanceTracker::RtTlasInstanceTracker()
+		{
+		}
+		RtTlasInstanceTracker::~RtTlasInstanceTracker()
+		{
+		}
+
+		void RtTlasInstanceTracker::Initialize(const Desc& desc)
+		{
+			desc_ = desc;
+
+			slot_array_.clear();
+			key_to_slot_.clear();
+			free_slot_array_.clear();
+			slot_seen_frame_.clear();
+			slot_dirty_.clear();
+			frame_ = 0;
+
+			refit_count_ = 0;
+			refit_degrade_ = 0.0f;
+			request_full_rebuild_ = true;
+		}
+
+		void RtTlasInstanceTracker::RequestFullRebuild()
+		{
+			request_full_rebuild_ = true;
+		}
+
+		u32 RtTlasInstanceTracker::AllocSlot()
+		{
+			if (!free_slot_array_.empty())
+			{
+				const u32 slot = free_slot_array_.back();
+				free_slot_array_.pop_back();
+				return slot;
+			}
+			const u32 slot = static_cast<u32>(slot_array_.size());
+			slot_array_.push_back({});
+			slot_seen_frame_.push_back(0);
+			slot_dirty_.push_back(0);
+			return slot;
+		}
+		void RtTlasInstanceTracker::FreeSlot(u32 slot)
+		{
+			slot_array_[slot] = {};
+			slot_dirty_[slot] = 1;
+			// 降順を維持して挿入.
+			const auto pos = std::lower_bound(free_slot_array_.begin(), free_slot_array_.end(), slot, std::greater<u32>());
+			free_slot_array_.insert(pos, slot);
+		}
+
+		void RtTlasInstanceTracker::Update(const std::vector<RtTlasInstanceInput>& instance_array, RtTlasInstanceUpdateResult& out_result)
+		{
+			out_result.build_mode = ERtTlasBuildMode::None;
+			out_result.dirty_range_array.clear();
+			out_result.num_added = 0;
+			out_result.num_removed = 0;
+			out_result.num_moved = 0;
+			out_result.num_dirty_slot = 0;
+
+			// 0は未参照扱いとするため1から.
+			++frame_;
+			if (0 == frame_)
+			{
+				std::fill(slot_seen_frame_.begin(), slot_seen_frame_.end(), 0u);
+				frame_ = 1;
+			}
+
+			bool need_rebuild = request_full_rebuild_;
+
+			// 追加と変更.
+			for (const auto& e : instance_array)
+			{
+				auto find_it = key_to_slot_.find(e.key);
+				if (key_to_slot_.end() == find_it)
+				{
+					const u32 slot = AllocSlot();
+					key_to_slot_[e.key] = slot;
+
+					auto& s = slot_array_[slot];
+					s.key = e.key;
+					s.blas_index = e.blas_index;
+					s.hitgroup_offset = e.hitgroup_offset;
+					s.transform = e.transform;
+
+					slot_seen_frame_[slot] = frame_;
+					slot_dirty_[slot] = 1;
+					++out_result.num_added;
+					need_rebuild = true;
+					continue;
+				}
+
+				const u32 slot = find_it->second;
+				// keyの重複.
+				assert(slot_seen_frame_[slot] != frame_);
+				slot_seen_frame_[slot] = frame_;
+
+				auto& s = slot_array_[slot];
+				if (s.blas_index != e.blas_index)
+				{
+					// BLAS参照の変更はUpdateで扱わずフルビルド.
+					s.blas_index = e.blas_index;
+					slot_dirty_[slot] = 1;
+					need_rebuild = true;
+				}
+				if (s.hitgroup_offset != e.hitgroup_offset)
+				{
+					// Hitgroupレコードの再割り当て. InstanceDescの書き換えのみでRefit可能.
+					s.hitgroup_offset = e.hitgroup_offset;
+					slot_dirty_[slot] = 1;
+				}
+				if (0 != std::memcmp(&s.transform, &e.transform, sizeof(s.transform)))
+				{
+					s.transform = e.transform;
+					slot_dirty_[slot] = 1;
+					++out_result.num_moved;
+				}
+			}
+
+			// 削除.
+			for (auto it = key_to_slot_.begin(); it != key_to_slot_.end();)
+			{
+				if (slot_seen_frame_[it->second] != frame_)
+				{
+					FreeSlot(it->second);
+					it = key_to_slot_.erase(it);
+					++out_result.num_removed;
+					need_rebuild = true;
+				}
+				else
+				{
+					++it;
+				}
+			}
+
+			// 末尾の空きスロットは切り詰めてInstance数を縮める.
+			if (!slot_array_.empty() && !slot_array_.back().IsValid())
+			{
+				while (!slot_array_.empty() && !slot_array_.back().IsValid())
+				{
+					slot_array_.pop_back();
+					slot_seen_frame_.pop_back();
+					slot_dirty_.pop_back();
+				}
+				const u32 num_slot = static_cast<u32>(slot_array_.size());
+				free_slot_array_.erase(std::remove_if(free_slot_array_.begin(), free_slot_array_.end(), [num_slot](u32 v) { return num_slot <= v; }), free_slot_array_.end());
+			}
+
+			if (request_full_rebuild_)
+			{
+				std::fill(slot_dirty_.begin(), slot_dirty_.end(), u8(1));
+			}
+
+			// Dirty範囲の収集. 近接する範囲は結合する.
+			for (u32 i = 0; i < slot_dirty_.size(); ++i)
+			{
+				if (!slot_dirty_[i])
+					continue;
+				if (!out_result.dirty_range_array.empty())
+				{
+					auto& tail = out_result.dirty_range_array.back();
+					const u32 tail_end = tail.begin + tail.count;
+					if (i <= tail_end + desc_.dirty_range_merge_gap)
+					{
+						tail.count = i + 1 - tail.begin;
+						continue;
+					}
+				}
+				out_result.dirty_range_array.push_back({ i, 1 });
+			}
+			for (const auto& r : out_result.dirty_range_array)
+				out_result.num_dirty_slot += r.count;
+			std::fill(slot_dirty_.begin(), slot_dirty_.end(), u8(0));
+
+			// ビルドモード決定.
+			if (!need_rebuild && !out_result.dirty_range_array.empty())
+			{
+				++refit_count_;
+				if (0 < key_to_slot_.size())
+					refit_degrade_ += static_cast<float>(out_result.num_moved) / static_cast<float>(key_to_slot_.size());
+
+				// Refitによる品質劣化の見積もりが閾値を超えたらフルビルド.
+				if (desc_.max_refit_count < refit_count_ || desc_.refit_degrade_limit < refit_degrade_)
+					need_rebuild = true;
+			}
+
+			if (need_rebuild)
+			{
+				out_result.build_mode = ERtTlasBuildMode::Rebuild;
+				refit_count_ = 0;
+				refit_degrade_ = 0.0f;
+				request_full_rebuild_ = false;
+			}
+			else if (!out_result.dirty_range_array.empty())
+			{
+				out_result.build_mode = ERtTlasBuildMode::Refit;
+			}
+		}
+
+		void TestRtTlasInstanceTracker()
+		{
+			bool is_ok = true;
+
+			RtTlasInstanceTracker::Desc desc = {};
+			desc.max_refit_count = 3;
+			desc.refit_degrade_limit = 1.5f;
+			desc.dirty_range_merge_gap = 1;
+			RtTlasInstanceTracker tracker;
+			tracker.Initialize(desc);
+
+			// key -> 入力. キー順に配列化して渡す.
+			std::map<u64, RtTlasInstanceInput> scene;
+			const auto AddInstance = [&scene](u64 key, u32 blas_index)
+			{
+				RtTlasInstanceInput e = {};
+				e.key = key;
+				e.blas_index = blas_index;
+				e.transform = math::Mat34::Identity();
+				scene[key] = e;
+			};
+			const auto Move = [&scene](u64 key, float x)
+			{
+				scene[key].transform.SetColumn3(math::Vec3(x, 0.0f, 0.0f));
+			};
+			RtTlasInstanceUpdateResult result = {};
+			const auto UpdateScene = [&]()
+			{
+				std::vector<RtTlasInstanceInput> input;
+				for (const auto& e : scene)
+					input.push_back(e.second);
+				tracker.Update(input, result);
+			};
+			const auto SlotOf = [&tracker](u64 key)
+			{
+				const auto& slot_array = tracker.GetSlotArray();
+				for (u32 i = 0; i < slot_array.size(); ++i)
+				{
+					if (slot_array[i].IsValid() && key == slot_array[i].key)
+						return i;
+				}
+				return ~0u;
+			};
+			const auto IsRange = [&result](std::initializer_list<RtTlasInstanceDirtyRange> expect)
+			{
+				if (expect.size() != result.dirty_range_array.size())
+					return false;
+				u32 i = 0;
+				for (const auto& r : expect)
+				{
+					if (r.begin != result.dirty_range_array[i].begin || r.count != result.dirty_range_array[i].count)
+						return false;
+					++i;
+				}
+				return true;
+			};
+
+			// 初回は全スロットのフルビルド. key 10..17 -> スロット 0..7.
+			for (u64 key = 10; key < 18; ++key)
+				AddInstance(key, static_cast<u32>(key % 3));
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::Rebuild == result.build_mode) && (8 == result.num_added) && IsRange({ {0, 8} });
+			is_ok &= (8 == tracker.NumSlot()) && (8 == tracker.NumValidInstance());
+			for (u64 key = 10; key < 18; ++key)
+				is_ok &= (static_cast<u32>(key - 10) == SlotOf(key));
+
+			// 変更なし.
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::None == result.build_mode) && result.dirty_range_array.empty();
+
+			// Transformのみの変更はRefit. 間隔1以下の範囲は結合する. スロット 1,3 -> [1,4), スロット 6 は別範囲.
+			Move(11, 1.0f);
+			Move(13, 1.0f);
+			Move(16, 1.0f);
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::Refit == result.build_mode) && (3 == result.num_moved);
+			is_ok &= IsRange({ {1, 3}, {6, 1} }) && (4 == result.num_dirty_slot);
+			is_ok &= (1 == tracker.GetRefitCount());
+
+			// 削除はフルビルド. スロットは空きとして残り, 空きスロットもアップロード対象.
+			scene.erase(12);
+			scene.erase(15);
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::Rebuild == result.build_mode) && (2 == result.num_removed);
+			is_ok &= IsRange({ {2, 1}, {5, 1} });
+			is_ok &= (8 == tracker.NumSlot()) && (6 == tracker.NumValidInstance()) && !tracker.GetSlotArray()[2].IsValid();
+			is_ok &= (0 == tracker.GetRefitCount());
+
+			// 追加は若い番号の空きスロットから再利用する.
+			AddInstance(20, 0);
+			AddInstance(21, 0);
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::Rebuild == result.build_mode) && (2 == result.num_added);
+			is_ok &= (2 == SlotOf(20)) && (5 == SlotOf(21)) && (8 == tracker.NumSlot());
+
+			// 末尾の空きスロットは切り詰める. 途中の空きスロットは維持.
+			scene.erase(13);	// スロット3.
+			scene.erase(17);	// スロット7.
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::Rebuild == result.build_mode) && (7 == tracker.NumSlot()) && (6 == tracker.NumValidInstance());
+			scene.erase(16);	// スロット6. 切り詰めで空きリストからも除かれる.
+			UpdateScene();
+			is_ok &= (6 == tracker.NumSlot()) && (5 == tracker.NumValidInstance());
+			AddInstance(22, 1);
+			AddInstance(23, 1);
+			UpdateScene();
+			is_ok &= (3 == SlotOf(22)) && (6 == SlotOf(23)) && (7 == tracker.NumSlot());
+			for (const auto& r : result.dirty_range_array)
+				is_ok &= (r.begin + r.count <= tracker.NumSlot());
+
+			// BLASの変更はフルビルド, Hitgroupオフセットのみの変更はRefit.
+			scene[10].blas_index = 2;
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::Rebuild == result.build_mode) && IsRange({ {0, 1} });
+			scene[10].hitgroup_offset = 4;
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::Refit == result.build_mode) && IsRange({ {0, 1} }) && (0 == result.num_moved);
+			is_ok &= (4 == tracker.GetSlotArray()[0].hitgroup_offset);
+
+			// Refit回数の上限. 直前のRefitを含めて3回まではRefit, 4回目でフルビルド.
+			Move(10, 2.0f);
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::Refit == result.build_mode);
+			Move(10, 3.0f);
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::Refit == result.build_mode) && (3 == tracker.GetRefitCount());
+			Move(10, 4.0f);
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::Rebuild == result.build_mode) && (0 == tracker.GetRefitCount());
+
+			// 移動量の累積. 全Instanceの移動は1回で1.0の劣化とし, 上限1.5を超える2回目でフルビルド.
+			for (auto& e : scene)
+				e.second.transform.SetColumn3(math::Vec3(0.0f, 5.0f, 0.0f));
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::Refit == result.build_mode) && (1.0f == tracker.GetRefitDegrade());
+			for (auto& e : scene)
+				e.second.transform.SetColumn3(math::Vec3(0.0f, 6.0f, 0.0f));
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::Rebuild == result.build_mode) && (0.0f == tracker.GetRefitDegrade());
+
+			// フルビルド要求は変更が無くても全スロットをアップロードしてフルビルド.
+			tracker.RequestFullRebuild();
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::Rebuild == result.build_mode) && IsRange({ {0, tracker.NumSlot()} });
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::None == result.build_mode);
+
+			// 全削除.
+			scene.clear();
+			UpdateScene();
+			is_ok &= (ERtTlasBuildMode::Rebuild == result.build_mode) && (0 == tracker.NumSlot()) && (0 == tracker.NumValidInstance());
+
+			std::cout << "[TestRtTlasInstanceTracker]";
+			std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+			assert(is_ok);
+		}
+	}
+}
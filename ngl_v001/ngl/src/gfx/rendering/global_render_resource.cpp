@@ -15,6 +15,8 @@ namespace ngl::gfx
             ResTexture::LoadDesc load_desc = {};
             {
                 load_desc.mode = ResTexture::FROM_DESC;
+                // アップロード未完了のテクスチャの代替として参照されるため予算を経由せずにアップロードする.
+                load_desc.upload_immediate = true;
                 load_desc.from_desc.type = rhi::ETextureType::Texture2D;
                 load_desc.from_desc.format = rhi::EResourceFormat::Format_R8G8B8A8_UNORM;
                 load_desc.from_desc.width = 64;
@@ -152,12 +154,30 @@ namespace ngl::gfx
 
             default_resource_.tex_default_normal = CreateRuntimeDefaultTexture(p_device_,"default_normal", math::Vec4(0.5f, 0.5f, 1.0f, 1.0f));
         }
+
+        // Bindlessマテリアルテーブル. テクスチャ未設定時はStandardRenderModelと同じデフォルトテクスチャを参照する.
+        if (p_device_->IsBindlessEnabled())
+        {
+            BindlessMaterialTable::Desc table_desc = {};
+            table_desc.default_texture_index[EBindlessMaterialTexture::BASE_COLOR] = default_resource_.tex_white->ref_view_->GetBindlessIndex();
+            table_desc.default_texture_index[EBindlessMaterialTexture::NORMAL] = default_resource_.tex_default_normal->ref_view_->GetBindlessIndex();
+            table_desc.default_texture_index[EBindlessMaterialTexture::OCCLUSION] = default_resource_.tex_white->ref_view_->GetBindlessIndex();
+            table_desc.default_texture_index[EBindlessMaterialTexture::ROUGHNESS] = default_resource_.tex_white->ref_view_->GetBindlessIndex();
+            table_desc.default_texture_index[EBindlessMaterialTexture::METALNESS] = default_resource_.tex_black->ref_view_->GetBindlessIndex();
+            if (!bindless_material_buffer_.Initialize(p_device_, table_desc))
+            {
+                std::cout << "[ERROR] Initialize BindlessMaterialBuffer" << std::endl;
+                assert(false);
+                return false;
+            }
+        }
         
         return true;
     }
     
     void GlobalRenderResource::Finalize()
     {
+        bindless_material_buffer_.Finalize();
         default_resource_ = {};
     }
 }
@@ -0,0 +1,327 @@
+﻿/*
+    ibl_bake_cache.cpp
+*/
+
+#include "gfx/rendering/ibl_bake_cache.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <type_traits>
+
+#include "file/file.h"
+
+namespace ngl
+{
+namespace gfx
+{
+    namespace
+    {
+        constexpr u32 k_ibl_bake_cache_magic = 0x4c42494e;  // 'NIBL'
+        constexpr u32 k_ibl_bake_cache_version = 1;
+        // テクスチャキャッシュと同じディレクトリに配置.
+        constexpr const char* k_ibl_bake_cache_dir = "../ngl/data/cache";
+
+        constexpr u64 k_fnv_prime_64 = 1099511628211ULL;
+
+        // テクスチャ形状の妥当性チェックの上限.
+        constexpr u32 k_max_texture_resolution = 16384;
+        constexpr u32 k_max_texture_array_size = 2048;
+        constexpr u32 k_max_texture_mip_count = 15;
+        constexpr u32 k_max_byte_per_pixel = 16;
+
+        struct FileHeader
+        {
+            u32     magic = k_ibl_bake_cache_magic;
+            u32     version = k_ibl_bake_cache_version;
+            u64     cache_hash = 0;
+            float   diffuse_irradiance_sh[Sh9Rgb::k_num_coef][3] = {};
+            u32     reserved = 0;
+        };
+        struct FileTextureHeader
+        {
+            u32     format = 0;
+            u32     width = 0;
+            u32     height = 0;
+            u32     array_size = 0;
+            u32     mip_count = 0;
+            u32     byte_per_pixel = 0;
+            u64     byte_size = 0;
+        };
+        static_assert(std::is_trivially_copyable_v<FileHeader> && std::is_trivially_copyable_v<FileTextureHeader>);
+
+        template<typename T>
+        void AppendValue(std::vector<u8>& out, const T& v)
+        {
+            const auto pos = out.size();
+            out.resize(pos + sizeof(T));
+            std::memcpy(out.data() + pos, &v, sizeof(T));
+        }
+        template<typename T>
+        bool ReadValue(const std::vector<u8>& data, size_t& offset, T& out_v)
+        {
+            if (data.size() < offset + sizeof(T))
+                return false;
+            std::memcpy(&out_v, data.data() + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
+        }
+
+        void AppendTexture(std::vector<u8>& out, const IblBakeCacheTexture& tex)
+        {
+            FileTextureHeader header = {};
+            header.format = tex.format;
+            header.width = tex.width;
+            header.height = tex.height;
+            header.array_size = tex.array_size;
+            header.mip_count = tex.mip_count;
+            header.byte_per_pixel = tex.byte_per_pixel;
+            header.byte_size = tex.pixel_memory.size();
+            AppendValue(out, header);
+            out.insert(out.end(), tex.pixel_memory.begin(), tex.pixel_memory.end());
+        }
+        bool ReadTexture(const std::vector<u8>& data, size_t& offset, IblBakeCacheTexture& out_tex)
+        {
+            FileTextureHeader header = {};
+            if (!ReadValue(data, offset, header))
+                return false;
+            if (0 == header.width || k_max_texture_resolution < header.width || 0 == header.height || k_max_texture_resolution < header.height ||
+                0 == header.array_size || k_max_texture_array_size < header.array_size ||
+                0 == header.mip_count || k_max_texture_mip_count < header.mip_count ||
+                0 == header.byte_per_pixel || k_max_byte_per_pixel < header.byte_per_pixel)
+                return false;
+
+            IblBakeCacheTexture tex = {};
+            tex.format = header.format;
+            tex.width = header.width;
+            tex.height = header.height;
+            tex.array_size = header.array_size;
+            tex.mip_count = header.mip_count;
+            tex.byte_per_pixel = header.byte_per_pixel;
+            if (tex.CalcTotalByteSize() != header.byte_size || data.size() < offset + header.byte_size)
+                return false;
+            tex.pixel_memory.assign(data.begin() + offset, data.begin() + offset + header.byte_size);
+            offset += header.byte_size;
+
+            out_tex = std::move(tex);
+            return true;
+        }
+    }
+
+    u64 IblBakeCacheTexture::GetSubresourceByteOffset(u32 subresource) const
+    {
+        u64 offset = 0;
+        for (u32 i = 0; i < subresource; ++i)
+            offset += GetSubresourceByteSize(i);
+        return offset;
+    }
+    u64 IblBakeCacheTexture::CalcTotalByteSize() const
+    {
+        return GetSubresourceByteOffset(NumSubresource());
+    }
+    void IblBakeCacheTexture::Initialize(u32 _format, u32 _width, u32 _height, u32 _array_size, u32 _mip_count, u32 _byte_per_pixel)
+    {
+        format = _format;
+        width = _width;
+        height = _height;
+        array_size = _array_size;
+        mip_count = _mip_count;
+        byte_per_pixel = _byte_per_pixel;
+        pixel_memory.assign(CalcTotalByteSize(), 0);
+    }
+
+    u64 CalcIblBakeCacheHash(const IblBakeCacheKey& key)
+    {
+        if (0 == key.src_hash)
+            return 0;
+
+        // ソースのコンテンツハッシュにバージョンと計算パラメータを混ぜ込む.
+        const u32 option_bits[] =
+        {
+            k_ibl_bake_cache_version,
+            key.specular_resolution,
+            key.specular_mip_count,
+            key.specular_format,
+            key.dfg_lut_resolution,
+            key.dfg_lut_format,
+            key.prevent_aliasing_mode_specular,
+        };
+        u64 hash = key.src_hash;
+        for (const auto v : option_bits)
+        {
+            hash ^= static_cast<u64>(v);
+            hash *= k_fnv_prime_64;
+        }
+        return hash;
+    }
+
+    bool BuildIblBakeCachePath(const char* src_path, u64 cache_hash, std::string& out_path)
+    {
+        if (!src_path || 0 == cache_hash)
+            return false;
+
+        std::filesystem::path cache_dir(k_ibl_bake_cache_dir);
+        std::error_code ec;
+        std::filesystem::create_directories(cache_dir, ec);
+        if (ec)
+            return false;
+
+        std::string base_name = std::filesystem::path(src_path).filename().string();
+        if (base_name.empty())
+            base_name = "sky";
+        for (char& ch : base_name)
+        {
+            if (ch < 32 || ch == '<' || ch == '>' || ch == ':' || ch == '"' || ch == '/' || ch == '\\' || ch == '|' || ch == '?' || ch == '*' || ch == '.' || ch == ' ')
+                ch = '_';
+        }
+        char hash_text[32] = {};
+        std::snprintf(hash_text, sizeof(hash_text), "%016llx", static_cast<unsigned long long>(cache_hash));
+        out_path = (cache_dir / (base_name + "_" + hash_text + ".iblcache")).string();
+        return true;
+    }
+
+    bool SaveIblBakeCache(const char* cache_path, u64 cache_hash, const IblBakeCacheData& data)
+    {
+        if (!cache_path || 0 == cache_hash || !data.ggx_specular_cubemap.IsValid() || !data.ggx_dfg_lut.IsValid())
+            return false;
+
+        FileHeader header = {};
+        header.cache_hash = cache_hash;
+        for (u32 k = 0; k < Sh9Rgb::k_num_coef; ++k)
+        {
+            header.diffuse_irradiance_sh[k][0] = data.diffuse_irradiance_sh.coef[k].x;
+            header.diffuse_irradiance_sh[k][1] = data.diffuse_irradiance_sh.coef[k].y;
+            header.diffuse_irradiance_sh[k][2] = data.diffuse_irradiance_sh.coef[k].z;
+        }
+
+        std::vector<u8> file_data;
+        file_data.reserve(sizeof(FileHeader) + sizeof(FileTextureHeader) * 2 + data.ggx_specular_cubemap.pixel_memory.size() + data.ggx_dfg_lut.pixel_memory.size());
+        AppendValue(file_data, header);
+        AppendTexture(file_data, data.ggx_specular_cubemap);
+        AppendTexture(file_data, data.ggx_dfg_lut);
+
+        return file::WriteFileFromBuffer(cache_path, file_data);
+    }
+
+    bool LoadIblBakeCache(const char* cache_path, u64 cache_hash, IblBakeCacheData& out_data)
+    {
+        if (!cache_path || 0 == cache_hash)
+            return false;
+
+        std::vector<u8> file_data;
+        if (!file::ReadFileToBuffer(cache_path, file_data))
+            return false;
+
+        size_t offset = 0;
+        FileHeader header = {};
+        if (!ReadValue(file_data, offset, header))
+            return false;
+        if (k_ibl_bake_cache_magic != header.magic || k_ibl_bake_cache_version != header.version || cache_hash != header.cache_hash)
+            return false;
+
+        IblBakeCacheData data = {};
+        for (u32 k = 0; k < Sh9Rgb::k_num_coef; ++k)
+            data.diffuse_irradiance_sh.coef[k] = math::Vec3(header.diffuse_irradiance_sh[k][0], header.diffuse_irradiance_sh[k][1], header.diffuse_irradiance_sh[k][2]);
+        if (!ReadTexture(file_data, offset, data.ggx_specular_cubemap) || !ReadTexture(file_data, offset, data.ggx_dfg_lut))
+            return false;
+        // 末尾の余剰も不正.
+        if (file_data.size() != offset)
+            return false;
+
+        out_data = std::move(data);
+        return true;
+    }
+
+
+    void TestIblBakeCache()
+    {
+        bool is_ok = true;
+
+        IblBakeCacheData src = {};
+        for (u32 k = 0; k < Sh9Rgb::k_num_coef; ++k)
+            src.diffuse_irradiance_sh.coef[k] = math::Vec3(static_cast<float>(k), static_cast<float>(k) * 0.5f, -static_cast<float>(k));
+        src.ggx_specular_cubemap.Initialize(10, 8, 8, 6, 4, 8);
+        src.ggx_dfg_lut.Initialize(10, 4, 4, 1, 1, 8);
+        for (size_t i = 0; i < src.ggx_specular_cubemap.pixel_memory.size(); ++i)
+            src.ggx_specular_cubemap.pixel_memory[i] = static_cast<u8>(i * 7 + 3);
+        for (size_t i = 0; i < src.ggx_dfg_lut.pixel_memory.size(); ++i)
+            src.ggx_dfg_lut.pixel_memory[i] = static_cast<u8>(i * 13 + 1);
+
+        // Subresourceの配置. 6面 x 4Mip (8,4,2,1).
+        is_ok &= (24 == src.ggx_specular_cubemap.NumSubresource());
+        is_ok &= ((8 * 8 + 4 * 4 + 2 * 2 + 1) * 8 == src.ggx_specular_cubemap.GetSubresourceByteOffset(4));
+        is_ok &= (4 * 8 == src.ggx_specular_cubemap.GetSubresourceRowPitch(5));
+        is_ok &= ((8 * 8 + 4 * 4 + 2 * 2 + 1) * 8 * 6 == src.ggx_specular_cubemap.pixel_memory.size());
+
+        // ハッシュはパラメータで変化し, ソースハッシュ無しは無効.
+        {
+            IblBakeCacheKey key = {};
+            key.src_hash = 0x1234;
+            key.specular_resolution = 512;
+            const u64 hash = CalcIblBakeCacheHash(key);
+            key.prevent_aliasing_mode_specular = 1;
+            is_ok &= (0 != hash) && (hash != CalcIblBakeCacheHash(key));
+            key.src_hash = 0;
+            is_ok &= (0 == CalcIblBakeCacheHash(key));
+        }
+
+        const std::string path = (std::filesystem::temp_directory_path() / "ngl_test_ibl_bake_cache.iblcache").string();
+        const u64 hash = 0x0123456789abcdefull;
+        is_ok &= SaveIblBakeCache(path.c_str(), hash, src);
+
+        // 往復.
+        {
+            IblBakeCacheData dst = {};
+            is_ok &= LoadIblBakeCache(path.c_str(), hash, dst);
+            for (u32 k = 0; k < Sh9Rgb::k_num_coef; ++k)
+            {
+                is_ok &= (src.diffuse_irradiance_sh.coef[k].x == dst.diffuse_irradiance_sh.coef[k].x);
+                is_ok &= (src.diffuse_irradiance_sh.coef[k].z == dst.diffuse_irradiance_sh.coef[k].z);
+            }
+            is_ok &= (src.ggx_specular_cubemap.pixel_memory == dst.ggx_specular_cubemap.pixel_memory) && (6 == dst.ggx_specular_cubemap.array_size) && (4 == dst.ggx_specular_cubemap.mip_count);
+            is_ok &= (src.ggx_dfg_lut.pixel_memory == dst.ggx_dfg_lut.pixel_memory) && (10 == dst.ggx_dfg_lut.format);
+        }
+        // ハッシュ不一致.
+        {
+            IblBakeCacheData dst = {};
+            is_ok &= !LoadIblBakeCache(path.c_str(), hash + 1, dst);
+        }
+        // 切り詰め, 末尾の余剰, マジック破損.
+        {
+            std::vector<u8> file_data;
+            is_ok &= file::ReadFileToBuffer(path.c_str(), file_data);
+
+            IblBakeCacheData dst = {};
+            std::vector<u8> broken(file_data.begin(), file_data.end() - 1);
+            is_ok &= file::WriteFileFromBuffer(path.c_str(), broken) && !LoadIblBakeCache(path.c_str(), hash, dst);
+
+            broken = file_data;
+            broken.push_back(0);
+            is_ok &= file::WriteFileFromBuffer(path.c_str(), broken) && !LoadIblBakeCache(path.c_str(), hash, dst);
+
+            broken = file_data;
+            broken[0] ^= 0xff;
+            is_ok &= file::WriteFileFromBuffer(path.c_str(), broken) && !LoadIblBakeCache(path.c_str(), hash, dst);
+        }
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        // ファイル無し.
+        {
+            IblBakeCacheData dst = {};
+            is_ok &= !LoadIblBakeCache(path.c_str(), hash, dst);
+        }
+        // 不正なデータは保存しない.
+        {
+            IblBakeCacheData invalid = src;
+            invalid.ggx_dfg_lut.pixel_memory.pop_back();
+            is_ok &= !SaveIblBakeCache(path.c_str(), hash, invalid);
+        }
+
+        std::cout << "[TestIblBakeCache]";
+        std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+        assert(is_ok);
+    }
+}
+}
@@ -0,0 +1,349 @@
+﻿/*
+    ibl_sh.cpp
+*/
+
+#include "gfx/rendering/ibl_sh.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <xmmintrin.h>
+
+#include "gfx/rendering/parallel_draw_record.h"
+#include "thread/job_thread.h"
+
+namespace ngl
+{
+namespace gfx
+{
+    namespace
+    {
+        constexpr double k_sh_pi = 3.14159265358979323846;
+
+        // 実数SH基底の定数.
+        constexpr float k_sh_y00 = 0.282094792f;    // 1/(2*sqrt(π))
+        constexpr float k_sh_y1 = 0.488602512f;     // sqrt(3/(4π))
+        constexpr float k_sh_y2_mn = 1.092548431f;  // sqrt(15/(4π))
+        constexpr float k_sh_y20 = 0.315391565f;    // sqrt(5/(16π))
+        constexpr float k_sh_y22 = 0.546274215f;    // sqrt(15/(16π))
+
+        // 余弦ローブとの畳み込み係数 A_l を円周率で除算したもの. A_0 = π, A_1 = 2π/3, A_2 = π/4.
+        constexpr float k_sh_cosine_lobe_band[3] = { 1.0f, 2.0f / 3.0f, 0.25f };
+
+        // 1スレッドが積分する最小の行数.
+        constexpr u32 k_sh_min_row_per_chunk = 8;
+
+        template<typename T>
+        void EvalSh9Basis(T out_basis[Sh9Rgb::k_num_coef], T x, T y, T z)
+        {
+            out_basis[0] = T(k_sh_y00);
+            out_basis[1] = T(k_sh_y1) * y;
+            out_basis[2] = T(k_sh_y1) * z;
+            out_basis[3] = T(k_sh_y1) * x;
+            out_basis[4] = T(k_sh_y2_mn) * x * y;
+            out_basis[5] = T(k_sh_y2_mn) * y * z;
+            out_basis[6] = T(k_sh_y20) * (T(3) * z * z - T(1));
+            out_basis[7] = T(k_sh_y2_mn) * x * z;
+            out_basis[8] = T(k_sh_y22) * (x * x - y * y);
+        }
+
+        // パノラマの行 y の中心の天頂角と, 行の1ピクセル当たりの立体角.
+        void CalcPanoramaRow(double& out_theta, double& out_solid_angle, u32 y, u32 width, u32 height)
+        {
+            const double theta0 = k_sh_pi * static_cast<double>(y) / static_cast<double>(height);
+            const double theta1 = k_sh_pi * static_cast<double>(y + 1) / static_cast<double>(height);
+            out_theta = k_sh_pi * (static_cast<double>(y) + 0.5) / static_cast<double>(height);
+            out_solid_angle = (std::cos(theta0) - std::cos(theta1)) * (2.0 * k_sh_pi / static_cast<double>(width));
+        }
+        // パノラマの列 x の中心の方位角. CalcPanoramaTexcoordFromWorldSpaceRay の u = atan2(-x, -z)/(2π) + 0.5 の逆変換.
+        double CalcPanoramaColumnPhi(u32 x, u32 width)
+        {
+            return ((static_cast<double>(x) + 0.5) / static_cast<double>(width) - 0.5) * (2.0 * k_sh_pi);
+        }
+
+        float HorizontalSum(__m128 v)
+        {
+            alignas(16) float e[4];
+            _mm_store_ps(e, v);
+            return (e[0] + e[1]) + (e[2] + e[3]);
+        }
+    }
+
+    void ProjectPanoramaToSh9(Sh9Rgb& out_radiance_sh, const float* p_rgba, u32 width, u32 height, u32 row_pitch_byte, thread::JobSystem* p_job_system)
+    {
+        out_radiance_sh = {};
+        if (!p_rgba || 0 == width || 0 == height)
+            return;
+        assert(width * sizeof(float) * 4 <= row_pitch_byte);
+
+        // 列毎の方位角. 全行で共有する.
+        std::vector<float> column_sin_phi(width);
+        std::vector<float> column_cos_phi(width);
+        for (u32 x = 0; x < width; ++x)
+        {
+            const double phi = CalcPanoramaColumnPhi(x, width);
+            column_sin_phi[x] = static_cast<float>(std::sin(phi));
+            column_cos_phi[x] = static_cast<float>(std::cos(phi));
+        }
+
+        // 行をチャンクに分割. チャンク毎の部分和を固定順で合算するため結果はスケジューリングに依らない.
+        const u32 num_thread = p_job_system ? std::max(1u, std::thread::hardware_concurrency()) : 1u;
+        const u32 num_chunk = std::clamp((height + k_sh_min_row_per_chunk - 1) / k_sh_min_row_per_chunk, 1u, num_thread * 4);
+        std::vector<std::array<double, Sh9Rgb::k_num_coef * 3>> chunk_sum(num_chunk);
+
+        const auto* p_row_base = reinterpret_cast<const u8*>(p_rgba);
+        ParallelRecordChunk(p_job_system, static_cast<int>(num_chunk), [&](int chunk_index)
+        {
+            auto& sum = chunk_sum[chunk_index];
+            sum.fill(0.0);
+
+            const u32 row_begin = static_cast<u32>(static_cast<u64>(height) * chunk_index / num_chunk);
+            const u32 row_end = static_cast<u32>(static_cast<u64>(height) * (chunk_index + 1) / num_chunk);
+            for (u32 y = row_begin; y < row_end; ++y)
+            {
+                double theta, solid_angle;
+                CalcPanoramaRow(theta, solid_angle, y, width, height);
+                const float sin_theta = static_cast<float>(std::sin(theta));
+                const float cos_theta = static_cast<float>(std::cos(theta));
+                const float* p_row = reinterpret_cast<const float*>(p_row_base + static_cast<u64>(row_pitch_byte) * y);
+
+                // 行内は立体角が一定のため, 放射輝度と基底の積を行毎に積算してから立体角を乗じる.
+                //  acc[coef*3 + channel].
+                __m128 acc[Sh9Rgb::k_num_coef * 3];
+                for (auto& e : acc)
+                    e = _mm_setzero_ps();
+
+                const __m128 v_sin_theta = _mm_set1_ps(sin_theta);
+                const __m128 v_dir_y = _mm_set1_ps(cos_theta);
+                const __m128 v_zero = _mm_setzero_ps();
+                u32 x = 0;
+                for (; x + 4 <= width; x += 4)
+                {
+                    // RGBA 4ピクセルを R, G, B のベクトルへ転置.
+                    __m128 c0 = _mm_loadu_ps(p_row + x * 4 + 0);
+                    __m128 c1 = _mm_loadu_ps(p_row + x * 4 + 4);
+                    __m128 c2 = _mm_loadu_ps(p_row + x * 4 + 8);
+                    __m128 c3 = _mm_loadu_ps(p_row + x * 4 + 12);
+                    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+                    const __m128 dir_x = _mm_sub_ps(v_zero, _mm_mul_ps(v_sin_theta, _mm_loadu_ps(&column_sin_phi[x])));
+                    const __m128 dir_z = _mm_sub_ps(v_zero, _mm_mul_ps(v_sin_theta, _mm_loadu_ps(&column_cos_phi[x])));
+
+                    __m128 basis[Sh9Rgb::k_num_coef];
+                    basis[0] = _mm_set1_ps(k_sh_y00);
+                    basis[1] = _mm_mul_ps(_mm_set1_ps(k_sh_y1), v_dir_y);
+                    basis[2] = _mm_mul_ps(_mm_set1_ps(k_sh_y1), dir_z);
+                    basis[3] = _mm_mul_ps(_mm_set1_ps(k_sh_y1), dir_x);
+                    basis[4] = _mm_mul_ps(_mm_set1_ps(k_sh_y2_mn), _mm_mul_ps(dir_x, v_dir_y));
+                    basis[5] = _mm_mul_ps(_mm_set1_ps(k_sh_y2_mn), _mm_mul_ps(v_dir_y, dir_z));
+                    basis[6] = _mm_mul_ps(_mm_set1_ps(k_sh_y20), _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(3.0f), _mm_mul_ps(dir_z, dir_z)), _mm_set1_ps(1.0f)));
+                    basis[7] = _mm_mul_ps(_mm_set1_ps(k_sh_y2_mn), _mm_mul_ps(dir_x, dir_z));
+                    basis[8] = _mm_mul_ps(_mm_set1_ps(k_sh_y22), _mm_sub_ps(_mm_mul_ps(dir_x, dir_x), _mm_mul_ps(v_dir_y, v_dir_y)));
+
+                    for (u32 k = 0; k < Sh9Rgb::k_num_coef; ++k)
+                    {
+                        acc[k * 3 + 0] = _mm_add_ps(acc[k * 3 + 0], _mm_mul_ps(basis[k], c0));
+                        acc[k * 3 + 1] = _mm_add_ps(acc[k * 3 + 1], _mm_mul_ps(basis[k], c1));
+                        acc[k * 3 + 2] = _mm_add_ps(acc[k * 3 + 2], _mm_mul_ps(basis[k], c2));
+                    }
+                }
+
+                float row_sum[Sh9Rgb::k_num_coef * 3];
+                for (u32 i = 0; i < Sh9Rgb::k_num_coef * 3; ++i)
+                    row_sum[i] = HorizontalSum(acc[i]);
+
+                // 4の倍数に満たない末尾.
+                for (; x < width; ++x)
+                {
+                    float basis[Sh9Rgb::k_num_coef];
+                    EvalSh9Basis(basis, -sin_theta * column_sin_phi[x], cos_theta, -sin_theta * column_cos_phi[x]);
+                    const float* p_pixel = p_row + x * 4;
+                    for (u32 k = 0; k < Sh9Rgb::k_num_coef; ++k)
+                    {
+                        row_sum[k * 3 + 0] += basis[k] * p_pixel[0];
+                        row_sum[k * 3 + 1] += basis[k] * p_pixel[1];
+                        row_sum[k * 3 + 2] += basis[k] * p_pixel[2];
+                    }
+                }
+
+                for (u32 i = 0; i < Sh9Rgb::k_num_coef * 3; ++i)
+                    sum[i] += static_cast<double>(row_sum[i]) * solid_angle;
+            }
+        });
+
+        std::array<double, Sh9Rgb::k_num_coef * 3> total = {};
+        for (const auto& sum : chunk_sum)
+        {
+            for (u32 i = 0; i < Sh9Rgb::k_num_coef * 3; ++i)
+                total[i] += sum[i];
+        }
+        for (u32 k = 0; k < Sh9Rgb::k_num_coef; ++k)
+            out_radiance_sh.coef[k] = math::Vec3(static_cast<float>(total[k * 3 + 0]), static_cast<float>(total[k * 3 + 1]), static_cast<float>(total[k * 3 + 2]));
+    }
+
+    void ProjectPanoramaToSh9Reference(Sh9Rgb& out_radiance_sh, const float* p_rgba, u32 width, u32 height, u32 row_pitch_byte)
+    {
+        out_radiance_sh = {};
+        if (!p_rgba || 0 == width || 0 == height)
+            return;
+
+        double total[Sh9Rgb::k_num_coef * 3] = {};
+        for (u32 y = 0; y < height; ++y)
+        {
+            const float* p_row = reinterpret_cast<const float*>(reinterpret_cast<const u8*>(p_rgba) + static_cast<u64>(row_pitch_byte) * y);
+            for (u32 x = 0; x < width; ++x)
+            {
+                double theta, solid_angle;
+                CalcPanoramaRow(theta, solid_angle, y, width, height);
+                const double phi = CalcPanoramaColumnPhi(x, width);
+
+                double basis[Sh9Rgb::k_num_coef];
+                EvalSh9Basis(basis, -std::sin(theta) * std::sin(phi), std::cos(theta), -std::sin(theta) * std::cos(phi));
+                for (u32 k = 0; k < Sh9Rgb::k_num_coef; ++k)
+                {
+                    for (u32 c = 0; c < 3; ++c)
+                        total[k * 3 + c] += basis[k] * static_cast<double>(p_row[x * 4 + c]) * solid_angle;
+                }
+            }
+        }
+        for (u32 k = 0; k < Sh9Rgb::k_num_coef; ++k)
+            out_radiance_sh.coef[k] = math::Vec3(static_cast<float>(total[k * 3 + 0]), static_cast<float>(total[k * 3 + 1]), static_cast<float>(total[k * 3 + 2]));
+    }
+
+    Sh9Rgb ConvolveSh9WithCosineLobe(const Sh9Rgb& radiance_sh)
+    {
+        constexpr u32 k_coef_band[Sh9Rgb::k_num_coef] = { 0, 1, 1, 1, 2, 2, 2, 2, 2 };
+        Sh9Rgb irradiance_sh = {};
+        for (u32 k = 0; k < Sh9Rgb::k_num_coef; ++k)
+            irradiance_sh.coef[k] = radiance_sh.coef[k] * k_sh_cosine_lobe_band[k_coef_band[k]];
+        return irradiance_sh;
+    }
+
+    math::Vec3 EvaluateSh9(const Sh9Rgb& sh, const math::Vec3& dir)
+    {
+        float basis[Sh9Rgb::k_num_coef];
+        EvalSh9Basis(basis, dir.x, dir.y, dir.z);
+        math::Vec3 result = math::Vec3::Zero();
+        for (u32 k = 0; k < Sh9Rgb::k_num_coef; ++k)
+            result += sh.coef[k] * basis[k];
+        return result;
+    }
+
+
+    void TestIblSh()
+    {
+        bool is_ok = true;
+
+        // パノラマの生成. func(dir) が放射輝度.
+        const auto MakePanorama = [](std::vector<float>& out_pixel, u32 width, u32 height, const auto& func)
+        {
+            out_pixel.assign(static_cast<size_t>(width) * height * 4, 0.0f);
+            for (u32 y = 0; y < height; ++y)
+            {
+                const double theta = k_sh_pi * (static_cast<double>(y) + 0.5) / static_cast<double>(height);
+                for (u32 x = 0; x < width; ++x)
+                {
+                    const double phi = CalcPanoramaColumnPhi(x, width);
+                    const math::Vec3 dir(static_cast<float>(-std::sin(theta) * std::sin(phi)), static_cast<float>(std::cos(theta)), static_cast<float>(-std::sin(theta) * std::cos(phi)));
+                    const math::Vec3 radiance = func(dir, x, y);
+                    float* p = &out_pixel[(static_cast<size_t>(y) * width + x) * 4];
+                    p[0] = radiance.x;
+                    p[1] = radiance.y;
+                    p[2] = radiance.z;
+                    p[3] = 1.0f;
+                }
+            }
+        };
+        const auto IsNear = [](const math::Vec3& a, const math::Vec3& b, float tolerance)
+        {
+            return std::abs(a.x - b.x) <= tolerance && std::abs(a.y - b.y) <= tolerance && std::abs(a.z - b.z) <= tolerance;
+        };
+        const math::Vec3 test_dir[] =
+        {
+            math::Vec3(1.0f, 0.0f, 0.0f), math::Vec3(-1.0f, 0.0f, 0.0f),
+            math::Vec3(0.0f, 1.0f, 0.0f), math::Vec3(0.0f, -1.0f, 0.0f),
+            math::Vec3(0.0f, 0.0f, 1.0f), math::Vec3(0.0f, 0.0f, -1.0f),
+            math::Vec3::Normalize(math::Vec3(0.3f, -0.6f, 0.74f)),
+        };
+
+        thread::JobSystem job_system;
+        job_system.Init(4);
+
+        // 一様な放射輝度. E/π は放射輝度と一致する.
+        {
+            const math::Vec3 radiance(1.0f, 2.0f, 3.0f);
+            std::vector<float> pixel;
+            MakePanorama(pixel, 64, 32, [&](const math::Vec3&, u32, u32) { return radiance; });
+
+            Sh9Rgb sh;
+            ProjectPanoramaToSh9(sh, pixel.data(), 64, 32, 64 * sizeof(float) * 4, &job_system);
+            const Sh9Rgb irradiance_sh = ConvolveSh9WithCosineLobe(sh);
+            for (const auto& dir : test_dir)
+                is_ok &= IsNear(EvaluateSh9(irradiance_sh, dir), radiance, 2e-3f);
+        }
+
+        // 一次の放射輝度 L = a + b*dot(dir, d). 余弦ローブとの畳み込みの解析解は E/π = a + (2/3)*b*dot(n, d).
+        {
+            const math::Vec3 d = math::Vec3::Normalize(math::Vec3(0.3f, 0.8f, -0.5f));
+            const math::Vec3 a(2.0f, 1.0f, 0.5f);
+            const math::Vec3 b(1.0f, 0.5f, 0.25f);
+            std::vector<float> pixel;
+            MakePanorama(pixel, 128, 64, [&](const math::Vec3& dir, u32, u32) { return a + b * math::Vec3::Dot(dir, d); });
+
+            Sh9Rgb sh;
+            ProjectPanoramaToSh9(sh, pixel.data(), 128, 64, 128 * sizeof(float) * 4, &job_system);
+            const Sh9Rgb irradiance_sh = ConvolveSh9WithCosineLobe(sh);
+            for (const auto& dir : test_dir)
+                is_ok &= IsNear(EvaluateSh9(irradiance_sh, dir), a + b * (2.0f / 3.0f) * math::Vec3::Dot(dir, d), 5e-3f);
+        }
+
+        // 高輝度の太陽を含む乱数パノラマ. 幅を4の倍数以外としてSSEの末尾処理を含める. リファレンスと比較.
+        {
+            constexpr u32 k_width = 203;
+            constexpr u32 k_height = 101;
+            // 行をパディングしたレイアウト.
+            constexpr u32 k_row_pitch_byte = (k_width + 3) * sizeof(float) * 4;
+            u32 rand_state = 12345u;
+            const auto Rand01 = [&rand_state]()
+            {
+                rand_state = rand_state * 1664525u + 1013904223u;
+                return static_cast<float>(rand_state >> 8) / static_cast<float>(1u << 24);
+            };
+            const math::Vec3 sun_dir = math::Vec3::Normalize(math::Vec3(-0.4f, 0.7f, 0.2f));
+            std::vector<float> packed_pixel;
+            MakePanorama(packed_pixel, k_width, k_height, [&](const math::Vec3& dir, u32, u32)
+            {
+                const float sun = (0.995f < math::Vec3::Dot(dir, sun_dir)) ? 5000.0f : 0.0f;
+                return math::Vec3(Rand01() * 2.0f + sun, Rand01() + sun * 0.9f, Rand01() * 0.5f + sun * 0.8f);
+            });
+            std::vector<float> pixel(static_cast<size_t>(k_row_pitch_byte / sizeof(float)) * k_height, -1.0f);
+            for (u32 y = 0; y < k_height; ++y)
+                std::copy_n(&packed_pixel[static_cast<size_t>(y) * k_width * 4], k_width * 4, &pixel[static_cast<size_t>(y) * (k_row_pitch_byte / sizeof(float))]);
+
+            Sh9Rgb sh_ref, sh_serial, sh_parallel;
+            ProjectPanoramaToSh9Reference(sh_ref, pixel.data(), k_width, k_height, k_row_pitch_byte);
+            ProjectPanoramaToSh9(sh_serial, pixel.data(), k_width, k_height, k_row_pitch_byte, nullptr);
+            ProjectPanoramaToSh9(sh_parallel, pixel.data(), k_width, k_height, k_row_pitch_byte, &job_system);
+
+            float max_abs_coef = 0.0f;
+            for (const auto& c : sh_ref.coef)
+                max_abs_coef = std::max({ max_abs_coef, std::abs(c.x), std::abs(c.y), std::abs(c.z) });
+            const float tolerance = max_abs_coef * 1e-5f;
+            for (u32 k = 0; k < Sh9Rgb::k_num_coef; ++k)
+            {
+                is_ok &= IsNear(sh_serial.coef[k], sh_ref.coef[k], tolerance);
+                is_ok &= IsNear(sh_parallel.coef[k], sh_ref.coef[k], tolerance);
+            }
+        }
+
+        std::cout << "[TestIblSh]";
+        std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+        assert(is_ok);
+    }
+}
+}
@@ -7,6 +7,7 @@
 #include "gfx/common_struct.h"
 #include "gfx/material/material_shader_manager.h"
 #include "gfx/rendering/global_render_resource.h"
+#include "gfx/rtg/graph_builder.h"
 #include "rhi/d3d12/command_list.d3d12.h"
 #include "rhi/d3d12/shader.d3d12.h"
 
@@ -17,12 +18,21 @@ namespace ngl
         void RenderMeshWithMaterial(rhi::GraphicsCommandListDep& command_list,
                                 const char* pass_name, fwk::GfxScene* gfx_scene, const std::vector<fwk::GfxSceneEntityId>& mesh_proxy_id_array, const RenderMeshResource& render_mesh_resource)
         {
+            RenderMeshWithMaterial(command_list, pass_name, gfx_scene, mesh_proxy_id_array, render_mesh_resource, 0, static_cast<int>(mesh_proxy_id_array.size()));
+        }
+
+        void RenderMeshWithMaterial(rhi::GraphicsCommandListDep& command_list,
+                                const char* pass_name, fwk::GfxScene* gfx_scene, const std::vector<fwk::GfxSceneEntityId>& mesh_proxy_id_array, const RenderMeshResource& render_mesh_resource,
+                                int begin, int end)
+        {
+            assert(0 <= begin && begin <= end && end <= static_cast<int>(mesh_proxy_id_array.size()));
+
             auto default_white_tex_srv  = GlobalRenderResource::Instance().default_resource_.tex_white->ref_view_;
             auto default_black_tex_srv  = GlobalRenderResource::Instance().default_resource_.tex_black->ref_view_;
             auto default_normal_tex_srv = GlobalRenderResource::Instance().default_resource_.tex_default_normal->ref_view_;
 
             auto* mesh_proxy_buffer = gfx_scene->GetEntityProxyBuffer<fwk::GfxSceneEntityMesh>();
-            for (int mesh_comp_i = 0; mesh_comp_i < mesh_proxy_id_array.size(); ++mesh_comp_i)
+            for (int mesh_comp_i = begin; mesh_comp_i < end; ++mesh_comp_i)
             {
                 const auto proxy_id = mesh_proxy_id_array[mesh_comp_i];
                 assert(fwk::GfxSceneEntityId::IsValid(proxy_id));
@@ -42,6 +52,10 @@ namespace ngl
                 const auto shape_count = model->NumShape();
                 for (int shape_i = 0; shape_i < shape_count; ++shape_i)
                 {
+                    // 頂点データのアップロードが予算超過で持ち越されているShapeは描画しない.
+                    if (!model->GetShape(shape_i)->IsUploadComplete())
+                        continue;
+
                     // Shapeに対応したMaterial Pass Psoを取得.
                     const auto&& pso = model->shape_mtl_pso_set_[shape_i].GetPassPso(pass_name);
 
@@ -58,6 +72,8 @@ namespace ngl
                         }
 
                         pso->SetView(&desc_set, "cb_ngl_instance", &mesh_instance_cbh->cbv);
+                        // 逆量子化パラメータはShapeのロード時に生成済みの定数バッファを参照する.
+                        pso->SetView(&desc_set, "cb_ngl_shape", model->GetShape(shape_i)->shape_info_cbv_.Get());
 
                         // モデルのマテリアル/モデル固有リソースのDescriptorSetの設定
                         BindModelResourceOptionCallbackArg bind_model_resource_option_callback_arg;
@@ -71,6 +87,13 @@ namespace ngl
                         command_list.SetPipelineState(pso);
                         // DescriptorSetでViewを設定.
                         command_list.SetDescriptorSet(pso, &desc_set);
+
+                        // Bindlessマテリアルはマテリアルインデックスのみを RootConstant で渡す. インスタンス情報は現状 cb_ngl_instance のまま.
+                        if (0 <= pso->GetPipelineResourceViewLayout()->GetResourceTable().root_constant_param)
+                        {
+                            const u32 draw_constant[] = { model->GetBindlessMaterialSlot(shape_i), static_cast<u32>(mesh_comp_i) };
+                            command_list.SetRootConstant(pso, draw_constant, sizeof(draw_constant));
+                        }
                     }
 
                     // Geometry.
@@ -79,5 +102,58 @@ namespace ngl
             }
         }
 
+        void EstimateMeshDrawCost(fwk::GfxScene* gfx_scene, const std::vector<fwk::GfxSceneEntityId>& mesh_proxy_id_array, std::vector<u32>& out_draw_cost)
+        {
+            out_draw_cost.resize(mesh_proxy_id_array.size());
+
+            auto* mesh_proxy_buffer = gfx_scene->GetEntityProxyBuffer<fwk::GfxSceneEntityMesh>();
+            for (int mesh_comp_i = 0; mesh_comp_i < mesh_proxy_id_array.size(); ++mesh_comp_i)
+            {
+                const auto proxy_id = mesh_proxy_id_array[mesh_comp_i];
+                assert(fwk::GfxSceneEntityId::IsValid(proxy_id));
+
+                const auto* model = mesh_proxy_buffer->proxy_buffer_[proxy_id.GetIndex()]->model_;
+                // Shape毎にPso, DescriptorSet設定とDrawを発行する. InstanceInfo確保分を1つとして加算.
+                out_draw_cost[mesh_comp_i] = static_cast<u32>(model->NumShape()) + 1;
+            }
+        }
+
+        int RenderMeshWithMaterialParallel(
+            rtg::TaskGraphicsCommandListAllocator& command_list_allocator, int first_command_list_index,
+            thread::JobSystem* p_job_system, const DrawSplitDesc& split_desc,
+            const char* pass_name, fwk::GfxScene* gfx_scene, const std::vector<fwk::GfxSceneEntityId>& mesh_proxy_id_array, const RenderMeshResource& render_mesh_resource,
+            const std::function<void(rhi::GraphicsCommandListDep* command_list, int chunk_index)>& setup_function)
+        {
+            // 分割. JobSystem無しの場合は単一CommandListで順に記録するのと同じになるため分割しない.
+            std::vector<DrawChunkRange> chunk_array;
+            if (p_job_system && 1 < split_desc.max_chunk)
+            {
+                std::vector<u32> draw_cost;
+                EstimateMeshDrawCost(gfx_scene, mesh_proxy_id_array, draw_cost);
+                SplitDrawListByCost(draw_cost, split_desc, chunk_array);
+            }
+            if (chunk_array.empty())
+            {
+                chunk_array.push_back({ 0, static_cast<int>(mesh_proxy_id_array.size()) });
+            }
+            const int num_chunk = static_cast<int>(chunk_array.size());
+
+            // CommandListはカレントスレッドで先に確保しておく. 記録スレッドはそれぞれ自身のCommandListのみ触る.
+            command_list_allocator.Alloc(first_command_list_index + num_chunk);
+            std::vector<rhi::GraphicsCommandListDep*> command_list_array(num_chunk);
+            for (int chunk_i = 0; chunk_i < num_chunk; ++chunk_i)
+            {
+                command_list_array[chunk_i] = command_list_allocator.GetOrCreate(first_command_list_index + chunk_i);
+            }
+
+            ParallelRecordChunk(p_job_system, num_chunk, [&](int chunk_i)
+            {
+                auto* command_list = command_list_array[chunk_i];
+                setup_function(command_list, chunk_i);
+                RenderMeshWithMaterial(*command_list, pass_name, gfx_scene, mesh_proxy_id_array, render_mesh_resource, chunk_array[chunk_i].begin, chunk_array[chunk_i].end);
+            });
+            return num_chunk;
+        }
+
     }  // namespace gfx
 }  // namespace ngl
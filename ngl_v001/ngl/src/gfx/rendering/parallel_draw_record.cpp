@@ -0,0 +1,198 @@
+﻿/*
+    parallel_draw_record.cpp
+*/
+
+#include "gfx/rendering/parallel_draw_record.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+#include "thread/job_thread.h"
+
+namespace ngl
+{
+    namespace gfx
+    {
+        int SplitDrawListByCost(const std::vector<u32>& draw_cost, const DrawSplitDesc& desc, std::vector<DrawChunkRange>& out_chunk)
+        {
+            out_chunk.clear();
+            const int num_draw = static_cast<int>(draw_cost.size());
+            if (0 >= num_draw)
+                return 0;
+
+            u64 total_cost = 0;
+            for (const auto cost : draw_cost)
+                total_cost += cost;
+
+            // コストから分割数を決定. 要素数以上には分割しない.
+            const u64 min_chunk_cost = std::max<u64>(desc.min_chunk_cost, 1);
+            const u64 num_by_cost = std::max<u64>(total_cost / min_chunk_cost, 1);
+            const int num_chunk = static_cast<int>(std::min<u64>(num_by_cost, static_cast<u64>(std::max(std::min(desc.max_chunk, num_draw), 1))));
+
+            int begin = 0;
+            u64 acc_cost = 0;
+            for (int chunk_i = 0; chunk_i < num_chunk; ++chunk_i)
+            {
+                int end = num_draw;
+                if (chunk_i + 1 < num_chunk)
+                {
+                    // 累積コストがチャンク境界の目標値に最も近くなる位置で区切る. 後続チャンクに最低1要素を残す.
+                    const u64 target_cost = total_cost * (chunk_i + 1) / num_chunk;
+                    const int max_end = num_draw - (num_chunk - 1 - chunk_i);
+
+                    end = begin + 1;
+                    acc_cost += draw_cost[begin];
+                    while (end < max_end && acc_cost < target_cost)
+                    {
+                        const u64 next_cost = acc_cost + draw_cost[end];
+                        if (next_cost > target_cost && (next_cost - target_cost) >= (target_cost - acc_cost))
+                            break;
+                        acc_cost = next_cost;
+                        ++end;
+                    }
+                }
+                out_chunk.push_back({ begin, end });
+                begin = end;
+            }
+            return num_chunk;
+        }
+
+        void ParallelRecordChunk(thread::JobSystem* p_job_system, int num_chunk, const std::function<void(int chunk_index)>& record_function)
+        {
+            if (!p_job_system || 1 >= num_chunk)
+            {
+                for (int chunk_i = 0; chunk_i < num_chunk; ++chunk_i)
+                    record_function(chunk_i);
+                return;
+            }
+
+            // Jobは呼び出し元の完了後に実行される場合があるため状態は共有で保持する. その時点では未着手チャンクが無く記録関数は参照しない.
+            struct SharedState
+            {
+                std::atomic_int next_chunk = 0;
+                std::atomic_int num_complete = 0;
+                int num_chunk = 0;
+                const std::function<void(int)>* p_record_function = {};
+
+                std::mutex              mutex = {};
+                std::condition_variable condition = {};
+            };
+            auto state = std::make_shared<SharedState>();
+            state->num_chunk = num_chunk;
+            state->p_record_function = &record_function;
+
+            auto run_chunk = [](SharedState* p_state)
+            {
+                for (;;)
+                {
+                    const int chunk_i = p_state->next_chunk.fetch_add(1);
+                    if (chunk_i >= p_state->num_chunk)
+                        break;
+
+                    (*p_state->p_record_function)(chunk_i);
+
+                    if (p_state->num_chunk == p_state->num_complete.fetch_add(1) + 1)
+                    {
+                        std::scoped_lock<std::mutex> lock(p_state->mutex);
+                        p_state->condition.notify_all();
+                    }
+                }
+            };
+
+            // 呼び出しスレッドの分を除いてJobを登録.
+            for (int job_i = 1; job_i < num_chunk; ++job_i)
+            {
+                p_job_system->Add([state, run_chunk]() { run_chunk(state.get()); });
+            }
+            run_chunk(state.get());
+
+            // 他スレッドが実行中のチャンクの完了待ち.
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->condition.wait(lock, [&state]() { return state->num_chunk <= state->num_complete.load(); });
+        }
+
+
+        void TestParallelDrawRecord()
+        {
+            bool is_ok = true;
+
+            // 均等なコストは均等に分割.
+            std::vector<DrawChunkRange> chunk;
+            {
+                std::vector<u32> cost(100, 10);
+                DrawSplitDesc desc = {};
+                desc.max_chunk = 4;
+                desc.min_chunk_cost = 1;
+                is_ok &= (4 == SplitDrawListByCost(cost, desc, chunk));
+                for (int i = 0; i < static_cast<int>(chunk.size()); ++i)
+                    is_ok &= (i * 25 == chunk[i].begin) && (25 == chunk[i].Count());
+            }
+            // 偏ったコスト. 連続で全要素を覆い, 累積コストが境界の目標値に最も近い位置で区切る.
+            {
+                std::vector<u32> cost = { 1, 1, 1, 1, 100, 1, 1, 1, 50, 50, 1, 1 };
+                DrawSplitDesc desc = {};
+                desc.max_chunk = 3;
+                desc.min_chunk_cost = 1;
+                is_ok &= (3 == SplitDrawListByCost(cost, desc, chunk));
+                int expect_begin = 0;
+                for (const auto& c : chunk)
+                {
+                    is_ok &= (expect_begin == c.begin) && (0 < c.Count());
+                    expect_begin = c.end;
+                }
+                is_ok &= (static_cast<int>(cost.size()) == expect_begin);
+                is_ok &= (5 == chunk[0].end) && (9 == chunk[1].end);
+            }
+            // 最小コスト未満は分割しない. 要素数以上には分割しない. 空リスト.
+            {
+                DrawSplitDesc desc = {};
+                desc.max_chunk = 8;
+                desc.min_chunk_cost = 64;
+                is_ok &= (1 == SplitDrawListByCost(std::vector<u32>(10, 5), desc, chunk)) && (10 == chunk[0].end);
+                is_ok &= (2 == SplitDrawListByCost(std::vector<u32>(2, 1000), desc, chunk));
+                is_ok &= (0 == SplitDrawListByCost({}, desc, chunk)) && chunk.empty();
+                desc.max_chunk = 0;
+                is_ok &= (1 == SplitDrawListByCost(std::vector<u32>(10, 1000), desc, chunk));
+            }
+
+            // 並列記録. 全チャンクが1回ずつ実行される. Worker上から同じJobSystemで入れ子に呼び出してもデッドロックしない.
+            {
+                constexpr int k_num_outer = 6;
+                constexpr int k_num_chunk = 16;
+                thread::JobSystem job_system;
+                job_system.Init(2);
+
+                std::vector<std::atomic_int> record_count(k_num_outer * k_num_chunk);
+                for (auto& c : record_count)
+                    c = 0;
+                for (int outer_i = 0; outer_i < k_num_outer; ++outer_i)
+                {
+                    job_system.Add([&job_system, &record_count, outer_i]()
+                    {
+                        ParallelRecordChunk(&job_system, k_num_chunk, [&record_count, outer_i](int chunk_i)
+                        {
+                            record_count[outer_i * k_num_chunk + chunk_i] += 1;
+                        });
+                    });
+                }
+                job_system.WaitAll();
+                for (const auto& c : record_count)
+                    is_ok &= (1 == c.load());
+
+                // JobSystem無しは順に実行.
+                std::vector<int> order;
+                ParallelRecordChunk(nullptr, 4, [&order](int chunk_i) { order.push_back(chunk_i); });
+                is_ok &= (std::vector<int>{ 0, 1, 2, 3 } == order);
+            }
+
+            std::cout << "[TestParallelDrawRecord]";
+            std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+            assert(is_ok);
+        }
+    }  // namespace gfx
+}  // namespace ngl
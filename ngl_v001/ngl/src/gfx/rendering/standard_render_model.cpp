@@ -5,13 +5,35 @@
 
 #include "gfx/material/material_shader_manager.h"
 #include "gfx/rendering/global_render_resource.h"
+#include "gfx/resource/texture_cooker_directxtex.h"
+#include "gfx/resource/texture_streaming_system.h"
 #include "resource/resource_manager.h"
+#include "rhi/d3d12/shader.d3d12.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 namespace ngl::gfx
 {
 
     // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 
+    StandardRenderModel::~StandardRenderModel()
+    {
+        // Bindlessマテリアルテーブルのスロット返却. 先にGlobalRenderResourceが終了している場合は不要.
+        auto& bindless_material_buffer = GlobalRenderResource::Instance().bindless_material_buffer_;
+        if (bindless_material_buffer.IsValid())
+        {
+            for (const auto slot : bindless_material_slot_)
+            {
+                if (BindlessMaterialTable::k_invalid_slot != slot)
+                    bindless_material_buffer.GetTable().FreeSlot(slot);
+            }
+        }
+        bindless_material_slot_.clear();
+    }
+
     bool StandardRenderModel::Initialize(rhi::DeviceDep* p_device, res::ResourceHandle<ResMeshData> res_mesh, std::shared_ptr<gfx::MeshData> override_mesh_shape_data, const char* material_name)
     {
         auto& res_manager = ngl::res::ResourceManager::Instance();
@@ -24,22 +46,59 @@ namespace ngl::gfx
         material_array_.resize(res_mesh_->material_data_array_.size());
         for (int i = 0; i < material_array_.size(); ++i)
         {
-            ResTexture::LoadDesc load_desc = {};
+            // 用途毎にCook(Mip生成+ブロック圧縮)してロード.
+            ResTexture::LoadDesc load_desc_albedo = {};
+            load_desc_albedo.cook_usage = directxtex::ETextureCookUsage::Albedo;
+            ResTexture::LoadDesc load_desc_normal = {};
+            load_desc_normal.cook_usage = directxtex::ETextureCookUsage::Normal;
+            ResTexture::LoadDesc load_desc_linear = {};
+            load_desc_linear.cook_usage = directxtex::ETextureCookUsage::Linear;
 
             if (0 < res_mesh_->material_data_array_[i].tex_basecolor.Length())
-                material_array_[i].tex_basecolor = res_manager.LoadResource<ResTexture>(p_device, res_mesh_->material_data_array_[i].tex_basecolor.Get(), &load_desc);
+                material_array_[i].tex_basecolor = res_manager.LoadResource<ResTexture>(p_device, res_mesh_->material_data_array_[i].tex_basecolor.Get(), &load_desc_albedo);
 
             if (0 < res_mesh_->material_data_array_[i].tex_normal.Length())
-                material_array_[i].tex_normal = res_manager.LoadResource<ResTexture>(p_device, res_mesh_->material_data_array_[i].tex_normal.Get(), &load_desc);
+                material_array_[i].tex_normal = res_manager.LoadResource<ResTexture>(p_device, res_mesh_->material_data_array_[i].tex_normal.Get(), &load_desc_normal);
 
             if (0 < res_mesh_->material_data_array_[i].tex_occlusion.Length())
-                material_array_[i].tex_occlusion = res_manager.LoadResource<ResTexture>(p_device, res_mesh_->material_data_array_[i].tex_occlusion.Get(), &load_desc);
+                material_array_[i].tex_occlusion = res_manager.LoadResource<ResTexture>(p_device, res_mesh_->material_data_array_[i].tex_occlusion.Get(), &load_desc_linear);
 
             if (0 < res_mesh_->material_data_array_[i].tex_roughness.Length())
-                material_array_[i].tex_roughness = res_manager.LoadResource<ResTexture>(p_device, res_mesh_->material_data_array_[i].tex_roughness.Get(), &load_desc);
+                material_array_[i].tex_roughness = res_manager.LoadResource<ResTexture>(p_device, res_mesh_->material_data_array_[i].tex_roughness.Get(), &load_desc_linear);
 
             if (0 < res_mesh_->material_data_array_[i].tex_metalness.Length())
-                material_array_[i].tex_metalness = res_manager.LoadResource<ResTexture>(p_device, res_mesh_->material_data_array_[i].tex_metalness.Get(), &load_desc);
+                material_array_[i].tex_metalness = res_manager.LoadResource<ResTexture>(p_device, res_mesh_->material_data_array_[i].tex_metalness.Get(), &load_desc_linear);
+        }
+
+        // Bindless有効時はマテリアル毎にテーブルのスロットを確保し, 標準不透明マテリアルをBindless版に置き換える.
+        //  テクスチャのBindlessインデックスはストリーミングでViewが切り替わるため UpdateBindlessMaterialTexture でRenderThreadから設定する.
+        //  設定されるまで, 及びテクスチャのアップロード完了まではインデックス未割当となりテーブルのデフォルトテクスチャを参照する.
+        auto& bindless_material_buffer = GlobalRenderResource::Instance().bindless_material_buffer_;
+        if (bindless_material_buffer.IsValid())
+        {
+            auto& table = bindless_material_buffer.GetTable();
+
+            bool is_all_slot_valid = true;
+            bindless_material_slot_.resize(material_array_.size(), BindlessMaterialTable::k_invalid_slot);
+            bindless_texture_index_.resize(material_array_.size());
+            for (int i = 0; i < material_array_.size(); ++i)
+            {
+                bindless_texture_index_[i].fill(BindlessMaterialTable::k_invalid_texture_index);
+
+                const u32 slot = table.AllocateSlot();
+                bindless_material_slot_[i] = slot;
+                if (BindlessMaterialTable::k_invalid_slot == slot)
+                {
+                    is_all_slot_valid = false;
+                    continue;
+                }
+            }
+
+            // テーブルが溢れた場合は従来のDescriptorTable経由のマテリアルのまま.
+            if (is_all_slot_valid && 0 == std::strcmp(material_name, "opaque_standard"))
+            {
+                material_name = "opaque_bindless";
+            }
         }
 
         // 標準不透明マテリアルでShape毎のマテリアルPsoを準備.
@@ -52,14 +111,158 @@ namespace ngl::gfx
         }
         for (int i = 0; i < shape_array->size(); ++i)
         {
-            shape_mtl_pso_set_.push_back(MaterialShaderManager::Instance().GetMaterialPsoSet(material_name, (*shape_array)[i].vtx_attr_mask_));
+            shape_mtl_pso_set_.push_back(MaterialShaderManager::Instance().GetMaterialPsoSet(material_name, (*shape_array)[i].vtx_attr_mask_, (*shape_array)[i].vertex_format_));
         }
 
+        SetupTextureStreamingShapeInfo();
+
         return true;
     }
 
+    void StandardRenderModel::SetupTextureStreamingShapeInfo()
+    {
+        streaming_shape_info_.clear();
+        streaming_shape_info_.resize(NumShape());
+        for (int shape_i = 0; shape_i < NumShape(); ++shape_i)
+        {
+            const MeshShapePart* shape = GetShape(shape_i);
+            const math::Vec3* p_pos = shape->position_.GetTypedRawDataPtr();
+            const u32* p_index = shape->index_.GetTypedRawDataPtr();
+            if (!p_pos || 0 >= shape->num_vertex_)
+                continue;
+
+            // バウンディングスフィアはAABB中心から.
+            math::Vec3 aabb_min = p_pos[0];
+            math::Vec3 aabb_max = p_pos[0];
+            for (int vi = 1; vi < shape->num_vertex_; ++vi)
+            {
+                aabb_min = math::Vec3(std::min(aabb_min.x, p_pos[vi].x), std::min(aabb_min.y, p_pos[vi].y), std::min(aabb_min.z, p_pos[vi].z));
+                aabb_max = math::Vec3(std::max(aabb_max.x, p_pos[vi].x), std::max(aabb_max.y, p_pos[vi].y), std::max(aabb_max.z, p_pos[vi].z));
+            }
+            auto& info = streaming_shape_info_[shape_i];
+            info.bounding_center = (aabb_min + aabb_max) * 0.5f;
+            for (int vi = 0; vi < shape->num_vertex_; ++vi)
+            {
+                info.bounding_radius = std::max(info.bounding_radius, (p_pos[vi] - info.bounding_center).Length());
+            }
+
+            // UV0の面積とジオメトリ面積の比からUV密度を推定. 大きいShapeは間引いてサンプリングする.
+            const math::Vec2* p_uv = (0 < shape->texcoord_.size()) ? shape->texcoord_[0].GetTypedRawDataPtr() : nullptr;
+            if (!p_uv || !p_index || 0 >= shape->num_primitive_)
+                continue;
+            constexpr int k_max_sample_triangle = 4096;
+            const int tri_step = std::max(1, shape->num_primitive_ / k_max_sample_triangle);
+            double sum_uv_area = 0.0;
+            double sum_pos_area = 0.0;
+            for (int ti = 0; ti < shape->num_primitive_; ti += tri_step)
+            {
+                const u32 i0 = p_index[ti * 3 + 0];
+                const u32 i1 = p_index[ti * 3 + 1];
+                const u32 i2 = p_index[ti * 3 + 2];
+                sum_pos_area += 0.5 * math::Vec3::Cross(p_pos[i1] - p_pos[i0], p_pos[i2] - p_pos[i0]).Length();
+                const math::Vec2 uv_e0 = p_uv[i1] - p_uv[i0];
+                const math::Vec2 uv_e1 = p_uv[i2] - p_uv[i0];
+                sum_uv_area += 0.5 * std::abs(uv_e0.x * uv_e1.y - uv_e0.y * uv_e1.x);
+            }
+            if (0.0 < sum_pos_area && 0.0 < sum_uv_area)
+            {
+                info.uv_per_unit = static_cast<float>(std::sqrt(sum_uv_area / sum_pos_area));
+            }
+        }
+    }
+
+    void StandardRenderModel::RequestTextureStreaming(const math::Mat34& transform) const
+    {
+        auto& streaming_system = TextureStreamingSystem::Instance();
+        if (!streaming_system.IsValid())
+            return;
+        const auto& view = streaming_system.GetViewParam();
+
+        // 非一様スケールは最大軸で近似.
+        const float scale = std::max({transform.GetColumn0().Length(), transform.GetColumn1().Length(), transform.GetColumn2().Length(), 1e-6f});
+        for (int shape_i = 0; shape_i < NumShape() && shape_i < static_cast<int>(streaming_shape_info_.size()); ++shape_i)
+        {
+            if (res_mesh_->shape_material_index_array_.size() <= static_cast<size_t>(shape_i))
+                break;
+            const auto mat_index = res_mesh_->shape_material_index_array_[shape_i];
+            if (0 > mat_index || material_array_.size() <= static_cast<size_t>(mat_index))
+                continue;
+
+            const auto& info = streaming_shape_info_[shape_i];
+            const math::Vec3 center_ws = transform * info.bounding_center;
+            const float distance = std::max((center_ws - view.camera_pos).Length() - info.bounding_radius * scale, 0.1f);
+
+            const auto& mat = material_array_[mat_index];
+            for (const auto* p_tex : {&mat.tex_basecolor, &mat.tex_normal, &mat.tex_occlusion, &mat.tex_roughness, &mat.tex_metalness})
+            {
+                if (!p_tex->IsValid() || k_invalid_streaming_texture_id == (*p_tex)->streaming_id_)
+                    continue;
+                // ref_texture_ は常駐Mipのみのため, 全Mipのdescを参照する.
+                const auto& tex_desc = (*p_tex)->streaming_source_->desc;
+                const float required_mip = (0.0f < info.uv_per_unit) ?
+                    TextureStreamingManager::CalcRequiredMip(static_cast<float>(std::max(tex_desc.width, tex_desc.height)), info.uv_per_unit / scale, distance, view.screen_height, view.fov_y_radian) : 0.0f;
+                streaming_system.RequestMip((*p_tex)->streaming_id_, required_mip);
+            }
+        }
+    }
+
+    void StandardRenderModel::UpdateBindlessMaterialTexture()
+    {
+        auto& bindless_material_buffer = GlobalRenderResource::Instance().bindless_material_buffer_;
+        if (!bindless_material_buffer.IsValid())
+            return;
+        auto& table = bindless_material_buffer.GetTable();
+        // アップロード未完了のテクスチャは内容が不定のため未割当とし, テーブルのデフォルトテクスチャを参照させる.
+        auto GetBindlessIndex = [](const res::ResourceHandle<ResTexture>& tex)
+        {
+            return (tex.IsValid() && tex->IsUploadComplete()) ? tex->ref_view_->GetBindlessIndex() : BindlessMaterialTable::k_invalid_texture_index;
+        };
+
+        for (size_t i = 0; i < material_array_.size() && i < bindless_material_slot_.size(); ++i)
+        {
+            const u32 slot = bindless_material_slot_[i];
+            if (BindlessMaterialTable::k_invalid_slot == slot)
+                continue;
+
+            const auto& mat = material_array_[i];
+            const std::array<u32, EBindlessMaterialTexture::_MAX> texture_index = {
+                GetBindlessIndex(mat.tex_basecolor), GetBindlessIndex(mat.tex_normal), GetBindlessIndex(mat.tex_occlusion), GetBindlessIndex(mat.tex_roughness), GetBindlessIndex(mat.tex_metalness)};
+            // 変化したものだけテーブルへ反映.
+            for (u32 type = 0; type < EBindlessMaterialTexture::_MAX; ++type)
+            {
+                if (texture_index[type] == bindless_texture_index_[i][type])
+                    continue;
+                table.SetTexture(slot, static_cast<EBindlessMaterialTexture::Type>(type), texture_index[type]);
+                bindless_texture_index_[i][type] = texture_index[type];
+            }
+        }
+    }
+
+    u32 StandardRenderModel::GetBindlessMaterialSlot(int shape_index) const
+    {
+        if (0 > shape_index || res_mesh_->shape_material_index_array_.size() <= static_cast<size_t>(shape_index))
+            return BindlessMaterialTable::k_invalid_slot;
+        const auto shape_mat_index = res_mesh_->shape_material_index_array_[shape_index];
+        if (0 > shape_mat_index || bindless_material_slot_.size() <= static_cast<size_t>(shape_mat_index))
+            return BindlessMaterialTable::k_invalid_slot;
+        return bindless_material_slot_[shape_mat_index];
+    }
+
     void StandardRenderModel::BindModelResourceCallback(BindModelResourceOptionCallbackArgRef arg)
     {
+        // Bindlessマテリアルはテクスチャをマテリアルテーブル経由で参照するため, テクスチャ毎のView設定は不要.
+        if (0 <= arg.pso->GetPipelineResourceViewLayout()->GetResourceTable().bindless_srv_table)
+        {
+            arg.pso->SetView(arg.desc_set, "samp_default", GlobalRenderResource::Instance().default_resource_.sampler_linear_wrap.Get());
+            arg.pso->SetView(arg.desc_set, "ngl_bindless_material_table", GlobalRenderResource::Instance().bindless_material_buffer_.GetFrameSrv());
+
+            if (bind_model_resource_option_callback_)
+            {
+                bind_model_resource_option_callback_(arg);
+            }
+            return;
+        }
+
         auto default_white_tex_srv  = GlobalRenderResource::Instance().default_resource_.tex_white->ref_view_;
         auto default_black_tex_srv  = GlobalRenderResource::Instance().default_resource_.tex_black->ref_view_;
         auto default_normal_tex_srv = GlobalRenderResource::Instance().default_resource_.tex_default_normal->ref_view_;
@@ -70,11 +273,16 @@ namespace ngl::gfx
         arg.pso->SetView(arg.desc_set, "samp_default", GlobalRenderResource::Instance().default_resource_.sampler_linear_wrap.Get());
         // テクスチャ設定テスト. このあたりはDescriptorSetDepに事前にセットしておきたい.
         {
-            auto tex_basecolor = (mat_data.tex_basecolor.IsValid()) ? mat_data.tex_basecolor->ref_view_ : default_white_tex_srv;
-            auto tex_normal    = (mat_data.tex_normal.IsValid()) ? mat_data.tex_normal->ref_view_ : default_normal_tex_srv;
-            auto tex_occlusion = (mat_data.tex_occlusion.IsValid()) ? mat_data.tex_occlusion->ref_view_ : default_white_tex_srv;
-            auto tex_roughness = (mat_data.tex_roughness.IsValid()) ? mat_data.tex_roughness->ref_view_ : default_white_tex_srv;
-            auto tex_metalness = (mat_data.tex_metalness.IsValid()) ? mat_data.tex_metalness->ref_view_ : default_black_tex_srv;
+            // アップロード未完了のテクスチャは内容が不定のためデフォルトテクスチャで代替する.
+            auto SelectView = [](const res::ResourceHandle<ResTexture>& tex, const rhi::RefSrvDep& default_srv)
+            {
+                return (tex.IsValid() && tex->IsUploadComplete()) ? tex->ref_view_ : default_srv;
+            };
+            auto tex_basecolor = SelectView(mat_data.tex_basecolor, default_white_tex_srv);
+            auto tex_normal    = SelectView(mat_data.tex_normal, default_normal_tex_srv);
+            auto tex_occlusion = SelectView(mat_data.tex_occlusion, default_white_tex_srv);
+            auto tex_roughness = SelectView(mat_data.tex_roughness, default_white_tex_srv);
+            auto tex_metalness = SelectView(mat_data.tex_metalness, default_black_tex_srv);
 
             arg.pso->SetView(arg.desc_set, "tex_basecolor", tex_basecolor.Get());
             arg.pso->SetView(arg.desc_set, "tex_occlusion", tex_occlusion.Get());
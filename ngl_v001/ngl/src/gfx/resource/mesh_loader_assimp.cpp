@@ -1,9 +1,15 @@
 ﻿
 #include "gfx/resource/mesh_loader_assimp.h"
 
+#include <chrono>
 #include <numeric>
 
 #include "math/math.h"
+#include "thread/job_thread.h"
+
+#include "gfx/resource/mesh_meshlet.h"
+#include "gfx/resource/mesh_optimizer.h"
+#include "gfx/resource/mesh_vertex_quantize.h"
 
 // rhi
 #include "rhi/d3d12/resource.d3d12.h"
@@ -35,7 +41,7 @@ namespace ngl
             std::vector<MaterialTextureSet>& out_material_tex_set,
             std::vector<int>& out_shape_material_index,
             std::vector<gfx::MeshShapeLayout>& out_shape_layouts,
-            rhi::DeviceDep* p_device, const char* filename)
+            rhi::DeviceDep* p_device, const char* filename, bool enable_vertex_quantize)
         {
             // ReadFileで読み込まれたメモリ等はAssimp::Importerインスタンスの寿命でクリーンアップされる.
 
@@ -145,6 +151,34 @@ namespace ngl
                         info.offset_uv[ci]      = info.total_size_in_byte + total_size_in_byte;
                         info.total_size_in_byte = CalcAlignedSize(info.total_size_in_byte, vtx_align) + num_vertex * sizeof(ngl::math::Vec2);
                     }
+                    // 量子化ストリーム. float側のストリームも保持する.
+                    info.offset_position_q = -1;
+                    info.offset_normal_q   = -1;
+                    info.offset_tangent_q  = -1;
+                    info.offset_uv_q.fill(-1);
+                    if (enable_vertex_quantize)
+                    {
+                        info.vertex_format = gfx::EMeshVertexFormat::QUANTIZED;
+
+                        info.offset_position_q  = info.total_size_in_byte + total_size_in_byte;
+                        info.total_size_in_byte = CalcAlignedSize(info.total_size_in_byte, vtx_align) + num_position * sizeof(ngl::gfx::MeshQuantizedPosition);
+                        if (0 < num_normal)
+                        {
+                            info.offset_normal_q    = info.total_size_in_byte + total_size_in_byte;
+                            info.total_size_in_byte = CalcAlignedSize(info.total_size_in_byte, vtx_align) + num_normal * sizeof(ngl::gfx::MeshQuantizedOct);
+                        }
+                        if (0 < num_tangent)
+                        {
+                            info.offset_tangent_q   = info.total_size_in_byte + total_size_in_byte;
+                            info.total_size_in_byte = CalcAlignedSize(info.total_size_in_byte, vtx_align) + num_tangent * sizeof(ngl::gfx::MeshQuantizedOct);
+                        }
+                        for (auto ci = 0; ci < num_uv_ch; ++ci)
+                        {
+                            info.offset_uv_q[ci]    = info.total_size_in_byte + total_size_in_byte;
+                            info.total_size_in_byte = CalcAlignedSize(info.total_size_in_byte, vtx_align) + num_vertex * sizeof(ngl::gfx::MeshQuantizedTexcoord);
+                        }
+                    }
+
                     // Index.
                     info.offset_index       = info.total_size_in_byte + total_size_in_byte;
                     info.total_size_in_byte = CalcAlignedSize(info.total_size_in_byte, vtx_align) + num_prim * sizeof(uint32_t) * 3;
@@ -263,6 +297,21 @@ namespace ngl
                     }
                     
                     init_data.index_ = (uint32_t*)&ptr[info.offset_index];
+
+                    // 量子化ストリーム. 内容は最適化後に生成する.
+                    if (0 <= info.offset_position_q)
+                        init_data.position_q_ = (ngl::gfx::MeshQuantizedPosition*)&ptr[info.offset_position_q];
+                    if (0 <= info.offset_normal_q)
+                        init_data.normal_q_ = (ngl::gfx::MeshQuantizedOct*)&ptr[info.offset_normal_q];
+                    if (0 <= info.offset_tangent_q)
+                        init_data.tangent_q_ = (ngl::gfx::MeshQuantizedOct*)&ptr[info.offset_tangent_q];
+                    if (0 <= info.offset_position_q)
+                    {
+                        for (int ci = 0; ci < info.num_uv_ch; ++ci)
+                        {
+                            init_data.texcoord_q_.push_back((ngl::gfx::MeshQuantizedTexcoord*)&ptr[info.offset_uv_q[ci]]);
+                        }
+                    }
                 }
 
                 // データコピー.
@@ -323,6 +372,191 @@ namespace ngl
                 }
             }
 
+            // Shape毎の並列実行.
+            const auto ParallelForShape = [&offset_info](const auto& func)
+            {
+                const int num_thread = std::min(static_cast<int>(offset_info.size()), std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+                if (1 < num_thread)
+                {
+                    thread::JobSystem job_system;
+                    job_system.Init(num_thread);
+                    for (int i = 0; i < offset_info.size(); ++i)
+                    {
+                        job_system.Add([&func, i]() { func(i); });
+                    }
+                    job_system.WaitAll();
+                }
+                else
+                {
+                    for (int i = 0; i < offset_info.size(); ++i)
+                        func(i);
+                }
+            };
+
+            // 頂点キャッシュ/オーバードロー/頂点フェッチ最適化. Shape毎に並列実行.
+            //  結果はraw_data_mem_に反映されるためメッシュキャッシュにもベイクされる.
+            {
+                std::vector<gfx::MeshOptimizeStatistics> shape_stat(offset_info.size());
+                auto OptimizeShape = [&init_source_data, &shape_stat](int i)
+                {
+                    auto& init_data = init_source_data[i];
+                    std::vector<gfx::MeshOptimizeVertexStream> stream_array;
+                    stream_array.push_back({init_data.position_, sizeof(ngl::math::Vec3)});
+                    stream_array.push_back({init_data.normal_, sizeof(ngl::math::Vec3)});
+                    stream_array.push_back({init_data.tangent_, sizeof(ngl::math::Vec3)});
+                    stream_array.push_back({init_data.binormal_, sizeof(ngl::math::Vec3)});
+                    for (auto* p : init_data.color_)
+                        stream_array.push_back({p, sizeof(ngl::gfx::VertexColor)});
+                    for (auto* p : init_data.texcoord_)
+                        stream_array.push_back({p, sizeof(ngl::math::Vec2)});
+
+                    gfx::OptimizeMeshShape(init_data.index_, init_data.num_primitive_ * 3, init_data.num_vertex_, init_data.position_,
+                        stream_array.data(), static_cast<u32>(stream_array.size()), gfx::MeshOptimizeOption{}, &shape_stat[i]);
+                };
+
+                ParallelForShape(OptimizeShape);
+
+                // 統計. 三角形数, 頂点数で重み付けした平均.
+                double total_tri = 0.0, total_vtx = 0.0;
+                double acmr_before = 0.0, acmr_after = 0.0, atvr_before = 0.0, atvr_after = 0.0;
+                for (int i = 0; i < offset_info.size(); ++i)
+                {
+                    const double num_tri = offset_info[i].num_primitive;
+                    const double num_vtx = offset_info[i].num_vertex;
+                    acmr_before += shape_stat[i].acmr_before * num_tri;
+                    acmr_after += shape_stat[i].acmr_after * num_tri;
+                    atvr_before += shape_stat[i].atvr_before * num_vtx;
+                    atvr_after += shape_stat[i].atvr_after * num_vtx;
+                    total_tri += num_tri;
+                    total_vtx += num_vtx;
+                }
+                if (0.0 < total_tri && 0.0 < total_vtx)
+                {
+                    std::cout << "[MeshOptimize] " << filename
+                              << " ACMR " << (acmr_before / total_tri) << " -> " << (acmr_after / total_tri)
+                              << ", ATVR " << (atvr_before / total_vtx) << " -> " << (atvr_after / total_vtx) << std::endl;
+                }
+            }
+
+            // 頂点属性の量子化. 最適化による頂点並べ替え後のfloatストリームから生成する.
+            if (enable_vertex_quantize)
+            {
+                std::vector<gfx::MeshQuantizeErrorStatistics> shape_error(offset_info.size());
+                auto QuantizeShape = [&init_source_data, &offset_info, &shape_error](int i)
+                {
+                    auto& init_data = init_source_data[i];
+
+                    gfx::MeshQuantizeSource src = {};
+                    src.num_vertex = init_data.num_vertex_;
+                    src.position = init_data.position_;
+                    src.normal = init_data.normal_;
+                    src.tangent = init_data.tangent_;
+                    src.binormal = init_data.binormal_;
+                    for (auto* p : init_data.texcoord_)
+                        src.texcoord.push_back(p);
+
+                    gfx::MeshQuantizeDestination dst = {};
+                    dst.position = init_data.position_q_;
+                    dst.normal = init_data.normal_q_;
+                    dst.tangent = init_data.tangent_q_;
+                    dst.texcoord = init_data.texcoord_q_;
+
+                    gfx::QuantizeVertexStreams(dst, src);
+                    shape_error[i] = gfx::CalcQuantizeError(src, dst);
+
+                    init_data.position_dequant_scale_ = dst.position_dequant_scale;
+                    init_data.position_dequant_offset_ = dst.position_dequant_offset;
+                    offset_info[i].position_dequant_scale = dst.position_dequant_scale;
+                    offset_info[i].position_dequant_offset = dst.position_dequant_offset;
+                };
+                ParallelForShape(QuantizeShape);
+
+                // 統計. ラスタライズ用頂点バッファのサイズと最大誤差. COLORは共通のため除外.
+                //  量子化時もfloatのPOSITIONはレイトレース用にGPUへ生成するため, GPUメモリはその分を加算する.
+                u64 float_byte = 0, quantized_fetch_byte = 0, quantized_gpu_byte = 0;
+                gfx::MeshQuantizeErrorStatistics max_error = {};
+                for (int i = 0; i < offset_info.size(); ++i)
+                {
+                    const auto& init_data = init_source_data[i];
+                    const u64 num_vtx = init_data.num_vertex_;
+                    const u64 num_uv = init_data.texcoord_.size();
+
+                    u64 float_stride = sizeof(ngl::math::Vec3) + num_uv * sizeof(ngl::math::Vec2);
+                    u64 quantized_stride = sizeof(ngl::gfx::MeshQuantizedPosition) + num_uv * sizeof(ngl::gfx::MeshQuantizedTexcoord);
+                    if (init_data.normal_)
+                    {
+                        float_stride += sizeof(ngl::math::Vec3);
+                        quantized_stride += sizeof(ngl::gfx::MeshQuantizedOct);
+                    }
+                    if (init_data.tangent_)
+                    {
+                        float_stride += sizeof(ngl::math::Vec3);
+                        quantized_stride += sizeof(ngl::gfx::MeshQuantizedOct);
+                    }
+                    if (init_data.binormal_)
+                        float_stride += sizeof(ngl::math::Vec3);
+
+                    float_byte += float_stride * num_vtx;
+                    quantized_fetch_byte += quantized_stride * num_vtx;
+                    quantized_gpu_byte += (quantized_stride + sizeof(ngl::math::Vec3)) * num_vtx;
+
+                    const auto& e = shape_error[i];
+                    max_error.max_position_error_ratio = std::max(max_error.max_position_error_ratio, e.max_position_error_ratio);
+                    max_error.max_normal_error_deg = std::max(max_error.max_normal_error_deg, e.max_normal_error_deg);
+                    max_error.max_tangent_error_deg = std::max(max_error.max_tangent_error_deg, e.max_tangent_error_deg);
+                    max_error.max_binormal_error_deg = std::max(max_error.max_binormal_error_deg, e.max_binormal_error_deg);
+                    max_error.max_texcoord_error = std::max(max_error.max_texcoord_error, e.max_texcoord_error);
+                }
+                if (0 < float_byte)
+                {
+                    std::cout << "[MeshQuantize] " << filename
+                              << " vertex fetch " << (float_byte / 1024) << " KB -> " << (quantized_fetch_byte / 1024) << " KB"
+                              << " (" << (100.0 * quantized_fetch_byte / float_byte) << "%)"
+                              << ", gpu vertex memory " << (float_byte / 1024) << " KB -> " << (quantized_gpu_byte / 1024) << " KB" << std::endl;
+                    std::cout << "[MeshQuantize] " << filename
+                              << " max error position " << max_error.max_position_error_ratio << " (ratio to bounds)"
+                              << ", normal " << max_error.max_normal_error_deg << " deg"
+                              << ", tangent " << max_error.max_tangent_error_deg << " deg"
+                              << ", binormal " << max_error.max_binormal_error_deg << " deg"
+                              << ", uv " << max_error.max_texcoord_error << std::endl;
+                }
+            }
+
+            // Meshlet構築. 最適化済みのインデックス順を利用する.
+            {
+                const auto time_begin = std::chrono::high_resolution_clock::now();
+
+                out_mesh.shape_meshlet_array_.clear();
+                out_mesh.shape_meshlet_array_.resize(offset_info.size());
+                auto BuildShapeMeshlet = [&init_source_data, &out_mesh](int i)
+                {
+                    const auto& init_data = init_source_data[i];
+                    gfx::BuildMeshlets(out_mesh.shape_meshlet_array_[i], init_data.index_, init_data.num_primitive_ * 3, init_data.position_, init_data.num_vertex_);
+                };
+                ParallelForShape(BuildShapeMeshlet);
+
+                const auto time_end = std::chrono::high_resolution_clock::now();
+
+                // 統計. 全Shapeの合計から充填率を計算.
+                gfx::MeshletBuildStatistics total_stat = {};
+                for (const auto& meshlet_data : out_mesh.shape_meshlet_array_)
+                {
+                    const auto stat = gfx::CalcMeshletStatistics(meshlet_data);
+                    total_stat.meshlet_count += stat.meshlet_count;
+                    total_stat.vertex_count += stat.vertex_count;
+                    total_stat.triangle_count += stat.triangle_count;
+                }
+                if (0 < total_stat.meshlet_count)
+                {
+                    const double vertex_fill = static_cast<double>(total_stat.vertex_count) / (static_cast<double>(total_stat.meshlet_count) * gfx::k_meshlet_max_vertex);
+                    const double triangle_fill = static_cast<double>(total_stat.triangle_count) / (static_cast<double>(total_stat.meshlet_count) * gfx::k_meshlet_max_triangle);
+                    std::cout << "[Meshlet] " << filename
+                              << " meshlet " << total_stat.meshlet_count
+                              << ", fill vertex " << (vertex_fill * 100.0) << "% triangle " << (triangle_fill * 100.0) << "%"
+                              << ", build " << std::chrono::duration<double, std::milli>(time_end - time_begin).count() << " ms" << std::endl;
+                }
+            }
+
             // Create Rhi.
             //    init_source_data を元にメッシュ初期化.
             for (int i = 0; i < offset_info.size(); ++i)
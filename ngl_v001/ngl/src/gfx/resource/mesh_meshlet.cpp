@@ -0,0 +1,424 @@
+﻿
+#include "gfx/resource/mesh_meshlet.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <tuple>
+
+namespace ngl
+{
+namespace gfx
+{
+    namespace
+    {
+        // 法線コーンが無効な場合の cutoff. 内積は1を超えないため裏面判定が常に偽になる.
+        constexpr float k_meshlet_cone_cutoff_disabled = 2.0f;
+        // 法線のばらつきの許容. コーン半角が約84度を超える場合はコーンを無効とする.
+        constexpr float k_meshlet_cone_min_dot = 0.1f;
+
+        // テスト用の閉じたUV球. インデックスは三角形単位で決定的にシャッフルする.
+        void MakeTestSphere(std::vector<math::Vec3>& out_position, std::vector<u32>& out_index, u32 slice, u32 stack)
+        {
+            out_position.clear();
+            out_index.clear();
+            for (u32 j = 0; j <= stack; ++j)
+            {
+                const float theta = math::k_pi_f * static_cast<float>(j) / static_cast<float>(stack);
+                for (u32 i = 0; i < slice; ++i)
+                {
+                    const float phi = 2.0f * math::k_pi_f * static_cast<float>(i) / static_cast<float>(slice);
+                    out_position.push_back(math::Vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+                }
+            }
+            for (u32 j = 0; j < stack; ++j)
+            {
+                for (u32 i = 0; i < slice; ++i)
+                {
+                    const u32 v00 = j * slice + i;
+                    const u32 v01 = j * slice + (i + 1) % slice;
+                    const u32 v10 = (j + 1) * slice + i;
+                    const u32 v11 = (j + 1) * slice + (i + 1) % slice;
+                    // 極では片方の三角形が縮退する. 縮退三角形も被覆の対象.
+                    out_index.insert(out_index.end(), {v00, v01, v10});
+                    out_index.insert(out_index.end(), {v01, v11, v10});
+                }
+            }
+
+            u32 seed = 12345;
+            const u32 triangle_count = static_cast<u32>(out_index.size() / 3);
+            for (u32 t = triangle_count - 1; 0 < t; --t)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                const u32 r = (seed >> 8) % (t + 1);
+                for (u32 k = 0; k < 3; ++k)
+                    std::swap(out_index[t * 3 + k], out_index[r * 3 + k]);
+            }
+        }
+
+        // 巡回を正規化した三角形. 巻き順は保持する.
+        std::tuple<u32, u32, u32> MakeTriangleKey(u32 i0, u32 i1, u32 i2)
+        {
+            if (i1 < i0 && i1 <= i2)
+                return {i1, i2, i0};
+            if (i2 < i0 && i2 < i1)
+                return {i2, i0, i1};
+            return {i0, i1, i2};
+        }
+    }
+
+    bool BuildMeshlets(MeshletShapeData& out_data, const u32* index, u32 index_count, const math::Vec3* position, u32 vertex_count,
+        u32 max_vertex, u32 max_triangle)
+    {
+        out_data = {};
+
+        const u32 triangle_count = index_count / 3;
+        // ローカルインデックスは8bit.
+        if (3 > max_vertex || 256 < max_vertex || 0 == max_triangle)
+            return false;
+        if (0 == triangle_count || 0 == vertex_count)
+            return true;
+
+        // 頂点 -> 三角形 の隣接情報 (CSR).
+        std::vector<u32> adj_offset(vertex_count + 1, 0);
+        for (u32 i = 0; i < triangle_count * 3; ++i)
+            ++adj_offset[index[i] + 1];
+        for (u32 v = 0; v < vertex_count; ++v)
+            adj_offset[v + 1] += adj_offset[v];
+        std::vector<u32> adj_triangle(triangle_count * 3);
+        {
+            std::vector<u32> fill(adj_offset.begin(), adj_offset.end() - 1);
+            for (u32 t = 0; t < triangle_count; ++t)
+            {
+                for (u32 k = 0; k < 3; ++k)
+                    adj_triangle[fill[index[t * 3 + k]]++] = t;
+            }
+        }
+
+        constexpr u8 k_not_in_meshlet = 0xff;
+        std::vector<u8> local_index(vertex_count, k_not_in_meshlet);
+        std::vector<bool> triangle_used(triangle_count, false);
+
+        Meshlet cur = {};
+        const auto FlushMeshlet = [&]()
+        {
+            if (0 == cur.triangle_count)
+                return;
+            for (u32 i = 0; i < cur.vertex_count; ++i)
+                local_index[out_data.vertex_index[cur.vertex_offset + i]] = k_not_in_meshlet;
+            out_data.meshlet.push_back(cur);
+
+            cur = {};
+            cur.vertex_offset = static_cast<u32>(out_data.vertex_index.size());
+            cur.triangle_offset = static_cast<u32>(out_data.triangle_index.size());
+        };
+        const auto CountNewVertex = [&](u32 t)
+        {
+            u32 count = 0;
+            for (u32 k = 0; k < 3; ++k)
+                count += (k_not_in_meshlet == local_index[index[t * 3 + k]]) ? 1 : 0;
+            return count;
+        };
+        const auto AppendTriangle = [&](u32 t)
+        {
+            for (u32 k = 0; k < 3; ++k)
+            {
+                const u32 v = index[t * 3 + k];
+                if (k_not_in_meshlet == local_index[v])
+                {
+                    local_index[v] = static_cast<u8>(cur.vertex_count);
+                    out_data.vertex_index.push_back(v);
+                    ++cur.vertex_count;
+                }
+                out_data.triangle_index.push_back(local_index[v]);
+            }
+            ++cur.triangle_count;
+            triangle_used[t] = true;
+        };
+
+        // 貪欲法.
+        //  現在のMeshletの頂点に隣接する未使用三角形から追加頂点数が最小のものを選ぶ. 同数の場合はインデックス順を優先.
+        //  隣接候補が無い場合はインデックス順で次の未使用三角形から再開する.
+        u32 scan_cursor = 0;
+        u32 remain = triangle_count;
+        while (0 < remain)
+        {
+            u32 best_triangle = ~0u;
+            u32 best_new_vertex = 4;
+            for (u32 i = 0; i < cur.vertex_count && 0 != best_new_vertex; ++i)
+            {
+                const u32 v = out_data.vertex_index[cur.vertex_offset + i];
+                for (u32 a = adj_offset[v]; a < adj_offset[v + 1]; ++a)
+                {
+                    const u32 t = adj_triangle[a];
+                    if (triangle_used[t])
+                        continue;
+                    const u32 new_vertex = CountNewVertex(t);
+                    if (new_vertex < best_new_vertex || (new_vertex == best_new_vertex && t < best_triangle))
+                    {
+                        best_new_vertex = new_vertex;
+                        best_triangle = t;
+                    }
+                }
+            }
+
+            if (~0u == best_triangle)
+            {
+                while (triangle_used[scan_cursor])
+                    ++scan_cursor;
+                best_triangle = scan_cursor;
+                best_new_vertex = CountNewVertex(best_triangle);
+            }
+
+            if (cur.vertex_count + best_new_vertex > max_vertex || cur.triangle_count + 1 > max_triangle)
+            {
+                // 収まらないため確定して新しいMeshletを開始.
+                //  新しいMeshletはインデックス順で次の未使用三角形から開始し, 頂点キャッシュ最適化による局所性を利用する.
+                FlushMeshlet();
+                continue;
+            }
+
+            AppendTriangle(best_triangle);
+            --remain;
+        }
+        FlushMeshlet();
+
+        out_data.bounds.resize(out_data.meshlet.size());
+        for (u32 i = 0; i < out_data.meshlet.size(); ++i)
+            out_data.bounds[i] = CalcMeshletBounds(out_data, i, position);
+
+        return true;
+    }
+
+    MeshletBounds CalcMeshletBounds(const MeshletShapeData& data, u32 meshlet_index, const math::Vec3* position)
+    {
+        MeshletBounds bounds = {};
+        bounds.cone_cutoff = k_meshlet_cone_cutoff_disabled;
+
+        const Meshlet& m = data.meshlet[meshlet_index];
+        if (0 == m.vertex_count)
+            return bounds;
+
+        const u32* vtx = data.vertex_index.data() + m.vertex_offset;
+        const u8* tri = data.triangle_index.data() + m.triangle_offset;
+
+        // バウンディングスフィア. AABB中心から最遠点までの距離.
+        {
+            math::Vec3 aabb_min = position[vtx[0]];
+            math::Vec3 aabb_max = position[vtx[0]];
+            for (u32 i = 1; i < m.vertex_count; ++i)
+            {
+                const math::Vec3& p = position[vtx[i]];
+                aabb_min = math::Vec3(std::min(aabb_min.x, p.x), std::min(aabb_min.y, p.y), std::min(aabb_min.z, p.z));
+                aabb_max = math::Vec3(std::max(aabb_max.x, p.x), std::max(aabb_max.y, p.y), std::max(aabb_max.z, p.z));
+            }
+            bounds.center = (aabb_min + aabb_max) * 0.5f;
+            float radius_sq = 0.0f;
+            for (u32 i = 0; i < m.vertex_count; ++i)
+                radius_sq = std::max(radius_sq, math::Vec3::LengthSq(position[vtx[i]] - bounds.center));
+            bounds.radius = std::sqrt(radius_sq);
+        }
+
+        // 法線コーン.
+        //  軸は三角形法線の平均. 半角は軸と各法線の最小内積から求める.
+        //  apex は全三角形の平面の裏側に位置するように軸上を後退させた点.
+        {
+            std::vector<math::Vec3> tri_normal;
+            tri_normal.reserve(m.triangle_count);
+            math::Vec3 axis = math::Vec3::Zero();
+            for (u32 t = 0; t < m.triangle_count; ++t)
+            {
+                const math::Vec3& p0 = position[vtx[tri[t * 3 + 0]]];
+                const math::Vec3& p1 = position[vtx[tri[t * 3 + 1]]];
+                const math::Vec3& p2 = position[vtx[tri[t * 3 + 2]]];
+                const math::Vec3 n = math::Vec3::Cross(p1 - p0, p2 - p0);
+                const float len = math::Vec3::Length(n);
+                // 縮退三角形は判定に影響しないため除外.
+                if (0.0f >= len)
+                {
+                    tri_normal.push_back(math::Vec3::Zero());
+                    continue;
+                }
+                tri_normal.push_back(n / len);
+                axis += tri_normal.back();
+            }
+
+            const float axis_len = math::Vec3::Length(axis);
+            if (0.0f >= axis_len)
+                return bounds;
+            axis = axis / axis_len;
+
+            float min_dot = 1.0f;
+            for (const auto& n : tri_normal)
+            {
+                if (0.0f == math::Vec3::LengthSq(n))
+                    continue;
+                min_dot = std::min(min_dot, math::Vec3::Dot(axis, n));
+            }
+            if (k_meshlet_cone_min_dot >= min_dot)
+                return bounds;
+
+            float max_t = 0.0f;
+            for (u32 t = 0; t < m.triangle_count; ++t)
+            {
+                const math::Vec3& n = tri_normal[t];
+                if (0.0f == math::Vec3::LengthSq(n))
+                    continue;
+                const math::Vec3& p0 = position[vtx[tri[t * 3 + 0]]];
+                // apex = center - axis * t が三角形平面上となる t. min_dot > 0 より分母は正.
+                const float tt = math::Vec3::Dot(bounds.center - p0, n) / math::Vec3::Dot(axis, n);
+                max_t = std::max(max_t, tt);
+            }
+
+            bounds.cone_axis = axis;
+            bounds.cone_apex = bounds.center - axis * max_t;
+            bounds.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+        }
+
+        return bounds;
+    }
+
+    bool IsMeshletBackfacing(const MeshletBounds& bounds, const math::Vec3& view_pos)
+    {
+        const math::Vec3 dir = bounds.cone_apex - view_pos;
+        const float len = math::Vec3::Length(dir);
+        if (0.0f >= len)
+            return false;
+        return math::Vec3::Dot(dir, bounds.cone_axis) >= bounds.cone_cutoff * len;
+    }
+
+    MeshletBuildStatistics CalcMeshletStatistics(const MeshletShapeData& data, u32 max_vertex, u32 max_triangle)
+    {
+        MeshletBuildStatistics stat = {};
+        stat.meshlet_count = static_cast<u32>(data.meshlet.size());
+        for (const auto& m : data.meshlet)
+        {
+            stat.vertex_count += m.vertex_count;
+            stat.triangle_count += m.triangle_count;
+        }
+        if (0 < stat.meshlet_count)
+        {
+            stat.vertex_fill = static_cast<float>(stat.vertex_count) / static_cast<float>(stat.meshlet_count * max_vertex);
+            stat.triangle_fill = static_cast<float>(stat.triangle_count) / static_cast<float>(stat.meshlet_count * max_triangle);
+        }
+        return stat;
+    }
+
+    void TestMeshletBuild()
+    {
+        bool is_ok = true;
+
+        std::vector<math::Vec3> position;
+        std::vector<u32> index;
+        MakeTestSphere(position, index, 48, 24);
+        const u32 triangle_count = static_cast<u32>(index.size() / 3);
+
+        std::vector<std::tuple<u32, u32, u32>> src_triangle;
+        for (u32 t = 0; t < triangle_count; ++t)
+            src_triangle.push_back(MakeTriangleKey(index[t * 3 + 0], index[t * 3 + 1], index[t * 3 + 2]));
+        std::sort(src_triangle.begin(), src_triangle.end());
+
+        // 不正な上限.
+        {
+            MeshletShapeData data;
+            is_ok &= !BuildMeshlets(data, index.data(), static_cast<u32>(index.size()), position.data(), static_cast<u32>(position.size()), 2, 16);
+            is_ok &= !BuildMeshlets(data, index.data(), static_cast<u32>(index.size()), position.data(), static_cast<u32>(position.size()), 257, 16);
+            is_ok &= !BuildMeshlets(data, index.data(), static_cast<u32>(index.size()), position.data(), static_cast<u32>(position.size()), 64, 0);
+        }
+
+        // 既定の上限と, 頂点上限/三角形上限がそれぞれ先に効く小さい上限.
+        const u32 limit_table[][2] = { {k_meshlet_max_vertex, k_meshlet_max_triangle}, {16, 64}, {64, 8} };
+        for (const auto& limit : limit_table)
+        {
+            const u32 max_vertex = limit[0];
+            const u32 max_triangle = limit[1];
+
+            MeshletShapeData data;
+            is_ok &= BuildMeshlets(data, index.data(), static_cast<u32>(index.size()), position.data(), static_cast<u32>(position.size()), max_vertex, max_triangle);
+            is_ok &= (data.meshlet.size() == data.bounds.size()) && (0 < data.meshlet.size());
+
+            std::vector<std::tuple<u32, u32, u32>> dst_triangle;
+            for (u32 mi = 0; mi < data.meshlet.size(); ++mi)
+            {
+                const Meshlet& m = data.meshlet[mi];
+                const MeshletBounds& b = data.bounds[mi];
+
+                // 上限.
+                is_ok &= (0 < m.vertex_count) && (m.vertex_count <= max_vertex);
+                is_ok &= (0 < m.triangle_count) && (m.triangle_count <= max_triangle);
+                is_ok &= (m.vertex_offset + m.vertex_count <= data.vertex_index.size());
+                is_ok &= (m.triangle_offset + m.triangle_count * 3 <= data.triangle_index.size());
+                if (!is_ok)
+                    break;
+
+                // ローカル頂点の重複なし.
+                std::vector<u32> local_vtx(data.vertex_index.begin() + m.vertex_offset, data.vertex_index.begin() + m.vertex_offset + m.vertex_count);
+                std::sort(local_vtx.begin(), local_vtx.end());
+                is_ok &= (std::adjacent_find(local_vtx.begin(), local_vtx.end()) == local_vtx.end());
+
+                // バウンディングスフィアが全頂点を含む.
+                for (u32 i = 0; i < m.vertex_count; ++i)
+                {
+                    const math::Vec3& p = position[data.vertex_index[m.vertex_offset + i]];
+                    is_ok &= (math::Vec3::Length(p - b.center) <= b.radius * 1.0001f + 1e-6f);
+                }
+
+                for (u32 t = 0; t < m.triangle_count; ++t)
+                {
+                    const u8* tri = data.triangle_index.data() + m.triangle_offset + t * 3;
+                    is_ok &= (tri[0] < m.vertex_count) && (tri[1] < m.vertex_count) && (tri[2] < m.vertex_count);
+                    if (!is_ok)
+                        break;
+                    const u32* vtx = data.vertex_index.data() + m.vertex_offset;
+                    dst_triangle.push_back(MakeTriangleKey(vtx[tri[0]], vtx[tri[1]], vtx[tri[2]]));
+                }
+            }
+
+            // 入力の全三角形をちょうど1回ずつ, 巻き順を保って被覆する.
+            std::sort(dst_triangle.begin(), dst_triangle.end());
+            is_ok &= (src_triangle == dst_triangle);
+
+            // 統計.
+            const auto stat = CalcMeshletStatistics(data, max_vertex, max_triangle);
+            is_ok &= (stat.meshlet_count == data.meshlet.size()) && (stat.triangle_count == triangle_count);
+            is_ok &= (0.0f < stat.vertex_fill && stat.vertex_fill <= 1.0f) && (0.0f < stat.triangle_fill && stat.triangle_fill <= 1.0f);
+
+            // 法線コーンが保守的. 裏面と判定されたMeshletの非縮退三角形は全て視点から裏向き.
+            u32 num_culled = 0;
+            for (u32 view_i = 0; view_i < 64; ++view_i)
+            {
+                const float a = 0.7f * static_cast<float>(view_i);
+                const float dist = 1.5f + 0.25f * static_cast<float>(view_i % 8);
+                const math::Vec3 view_pos = math::Vec3(std::cos(a) * std::cos(a * 0.37f), std::sin(a * 0.37f), std::sin(a) * std::cos(a * 0.37f)) * dist;
+                for (u32 mi = 0; mi < data.meshlet.size(); ++mi)
+                {
+                    if (!IsMeshletBackfacing(data.bounds[mi], view_pos))
+                        continue;
+                    ++num_culled;
+
+                    const Meshlet& m = data.meshlet[mi];
+                    const u32* vtx = data.vertex_index.data() + m.vertex_offset;
+                    const u8* tri = data.triangle_index.data() + m.triangle_offset;
+                    for (u32 t = 0; t < m.triangle_count; ++t)
+                    {
+                        const math::Vec3& p0 = position[vtx[tri[t * 3 + 0]]];
+                        const math::Vec3& p1 = position[vtx[tri[t * 3 + 1]]];
+                        const math::Vec3& p2 = position[vtx[tri[t * 3 + 2]]];
+                        const math::Vec3 n = math::Vec3::Cross(p1 - p0, p2 - p0);
+                        if (0.0f >= math::Vec3::Length(n))
+                            continue;
+                        is_ok &= (math::Vec3::Dot(view_pos - p0, n) <= 1e-5f);
+                    }
+                }
+            }
+            // 球の裏側のMeshletは判定されるはず.
+            is_ok &= (0 < num_culled);
+        }
+
+        std::cout << "[TestMeshletBuild]";
+        std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+        assert(is_ok);
+    }
+}
+}
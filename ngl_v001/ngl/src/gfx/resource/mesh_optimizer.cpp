@@ -0,0 +1,304 @@
+﻿
+#include "gfx/resource/mesh_optimizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace ngl
+{
+namespace gfx
+{
+    u32 CalcTransformedVertexCount(const u32* index, u32 index_count, u32 vertex_count, u32 cache_size)
+    {
+        // FIFOキャッシュ. 頂点毎にキャッシュへ入った時刻を保持し, 現在時刻との差がキャッシュサイズ以内ならヒット.
+        std::vector<u32> cache_time(vertex_count, 0);
+        u32 time = cache_size + 1;
+        u32 transformed = 0;
+        for (u32 i = 0; i < index_count; ++i)
+        {
+            const u32 v = index[i];
+            if (time - cache_time[v] > cache_size)
+            {
+                cache_time[v] = time;
+                ++time;
+                ++transformed;
+            }
+        }
+        return transformed;
+    }
+
+    // Tipsify.
+    //  Sander, Nehab, Barczak. "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (2007).
+    void OptimizeVertexCache(u32* out_index, const u32* index, u32 index_count, u32 vertex_count, u32 cache_size, std::vector<u32>* out_cluster_start)
+    {
+        const u32 triangle_count = index_count / 3;
+        if (out_cluster_start)
+            out_cluster_start->clear();
+        if (0 == triangle_count || 0 == vertex_count)
+            return;
+
+        // 頂点->三角形の隣接をCSR形式で構築.
+        std::vector<u32> live_count(vertex_count, 0);
+        for (u32 i = 0; i < triangle_count * 3; ++i)
+            ++live_count[index[i]];
+        std::vector<u32> adjacency_offset(vertex_count + 1, 0);
+        for (u32 v = 0; v < vertex_count; ++v)
+            adjacency_offset[v + 1] = adjacency_offset[v] + live_count[v];
+        std::vector<u32> adjacency(triangle_count * 3);
+        {
+            std::vector<u32> fill = adjacency_offset;
+            for (u32 t = 0; t < triangle_count; ++t)
+            {
+                for (u32 k = 0; k < 3; ++k)
+                {
+                    const u32 v = index[t * 3 + k];
+                    adjacency[fill[v]++] = t;
+                }
+            }
+        }
+
+        std::vector<u32> cache_time(vertex_count, 0);
+        std::vector<u8> emitted(triangle_count, 0);
+        std::vector<u32> dead_end_stack;
+        dead_end_stack.reserve(index_count);
+        std::vector<u32> candidate;
+        candidate.reserve(64);
+
+        u32 time = cache_size + 1;
+        u32 cursor = 0;
+        u32 out_triangle = 0;
+        s64 fanning = 0;
+        bool is_cluster_head = true;
+
+        // Dead-endスタックから, なければ入力順に未処理三角形を持つ頂点を探す.
+        auto SkipDeadEnd = [&]() -> s64
+        {
+            while (!dead_end_stack.empty())
+            {
+                const u32 d = dead_end_stack.back();
+                dead_end_stack.pop_back();
+                if (0 < live_count[d])
+                    return d;
+            }
+            while (cursor < vertex_count)
+            {
+                if (0 < live_count[cursor])
+                    return cursor;
+                ++cursor;
+            }
+            return -1;
+        };
+
+        while (0 <= fanning)
+        {
+            const u32 f = static_cast<u32>(fanning);
+            candidate.clear();
+
+            if (is_cluster_head && out_cluster_start)
+                out_cluster_start->push_back(out_triangle);
+            is_cluster_head = false;
+
+            for (u32 a = adjacency_offset[f]; a < adjacency_offset[f + 1]; ++a)
+            {
+                const u32 t = adjacency[a];
+                if (emitted[t])
+                    continue;
+                emitted[t] = 1;
+                for (u32 k = 0; k < 3; ++k)
+                {
+                    const u32 v = index[t * 3 + k];
+                    out_index[out_triangle * 3 + k] = v;
+                    dead_end_stack.push_back(v);
+                    candidate.push_back(v);
+                    --live_count[v];
+                    if (time - cache_time[v] > cache_size)
+                    {
+                        cache_time[v] = time;
+                        ++time;
+                    }
+                }
+                ++out_triangle;
+            }
+
+            // 次のFanning頂点選択. 次の処理後もキャッシュに残っている見込みがある頂点のうち最も古いもの.
+            s64 best = -1;
+            s64 best_priority = -1;
+            for (const u32 v : candidate)
+            {
+                if (0 >= live_count[v])
+                    continue;
+                s64 priority = 0;
+                if (static_cast<s64>(time - cache_time[v]) + 2 * static_cast<s64>(live_count[v]) <= static_cast<s64>(cache_size))
+                    priority = time - cache_time[v];
+                if (priority > best_priority)
+                {
+                    best_priority = priority;
+                    best = v;
+                }
+            }
+            if (0 > best)
+            {
+                // 局所的な候補が無い場合はキャッシュが途切れるためクラスタ境界とする.
+                best = SkipDeadEnd();
+                is_cluster_head = true;
+            }
+            fanning = best;
+        }
+        assert(out_triangle == triangle_count);
+    }
+
+    void OptimizeOverdraw(u32* inout_index, u32 index_count, const math::Vec3* position, u32 vertex_count, const std::vector<u32>& cluster_start)
+    {
+        const u32 triangle_count = index_count / 3;
+        const u32 cluster_count = static_cast<u32>(cluster_start.size());
+        if (1 >= cluster_count || !position)
+            return;
+
+        // メッシュ中心.
+        math::Vec3 mesh_center = math::Vec3::Zero();
+        {
+            double area_sum = 0.0;
+            math::Vec3d center_sum = math::Vec3d::Zero();
+            for (u32 t = 0; t < triangle_count; ++t)
+            {
+                const math::Vec3& p0 = position[inout_index[t * 3 + 0]];
+                const math::Vec3& p1 = position[inout_index[t * 3 + 1]];
+                const math::Vec3& p2 = position[inout_index[t * 3 + 2]];
+                const double area = math::Vec3::Length(math::Vec3::Cross(p1 - p0, p2 - p0));
+                const math::Vec3 c = (p0 + p1 + p2) / 3.0f;
+                center_sum += math::Vec3d(c.x * area, c.y * area, c.z * area);
+                area_sum += area;
+            }
+            if (0.0 < area_sum)
+                mesh_center = math::Vec3(static_cast<float>(center_sum.x / area_sum), static_cast<float>(center_sum.y / area_sum), static_cast<float>(center_sum.z / area_sum));
+        }
+
+        // クラスタ毎の中心と法線からオクルージョン指標を計算. dot(中心 - メッシュ中心, 法線) が大きいクラスタは外側を向いており他を遮蔽しやすい.
+        std::vector<float> sort_key(cluster_count, 0.0f);
+        for (u32 ci = 0; ci < cluster_count; ++ci)
+        {
+            const u32 begin = cluster_start[ci];
+            const u32 end = (ci + 1 < cluster_count) ? cluster_start[ci + 1] : triangle_count;
+
+            math::Vec3 area_normal = math::Vec3::Zero();
+            math::Vec3 center = math::Vec3::Zero();
+            float area_sum = 0.0f;
+            for (u32 t = begin; t < end; ++t)
+            {
+                const math::Vec3& p0 = position[inout_index[t * 3 + 0]];
+                const math::Vec3& p1 = position[inout_index[t * 3 + 1]];
+                const math::Vec3& p2 = position[inout_index[t * 3 + 2]];
+                const math::Vec3 n = math::Vec3::Cross(p1 - p0, p2 - p0);
+                const float area = math::Vec3::Length(n);
+                area_normal += n;
+                center += (p0 + p1 + p2) * (area / 3.0f);
+                area_sum += area;
+            }
+            if (0.0f < area_sum)
+            {
+                center /= area_sum;
+                const float normal_len = math::Vec3::Length(area_normal);
+                if (0.0f < normal_len)
+                    sort_key[ci] = math::Vec3::Dot(center - mesh_center, area_normal / normal_len);
+            }
+        }
+
+        std::vector<u32> cluster_order(cluster_count);
+        std::iota(cluster_order.begin(), cluster_order.end(), 0u);
+        std::stable_sort(cluster_order.begin(), cluster_order.end(), [&sort_key](u32 a, u32 b) { return sort_key[a] > sort_key[b]; });
+
+        std::vector<u32> src(inout_index, inout_index + triangle_count * 3);
+        u32 out_triangle = 0;
+        for (const u32 ci : cluster_order)
+        {
+            const u32 begin = cluster_start[ci];
+            const u32 end = (ci + 1 < cluster_count) ? cluster_start[ci + 1] : triangle_count;
+            memcpy(inout_index + out_triangle * 3, src.data() + begin * 3, sizeof(u32) * 3 * (end - begin));
+            out_triangle += end - begin;
+        }
+    }
+
+    void BuildVertexFetchRemap(u32* out_remap, const u32* index, u32 index_count, u32 vertex_count)
+    {
+        constexpr u32 k_unassigned = ~0u;
+        std::fill(out_remap, out_remap + vertex_count, k_unassigned);
+
+        u32 next = 0;
+        for (u32 i = 0; i < index_count; ++i)
+        {
+            const u32 v = index[i];
+            if (k_unassigned == out_remap[v])
+                out_remap[v] = next++;
+        }
+        // 未参照頂点は末尾へ.
+        for (u32 v = 0; v < vertex_count; ++v)
+        {
+            if (k_unassigned == out_remap[v])
+                out_remap[v] = next++;
+        }
+    }
+
+    void ApplyVertexRemap(const u32* remap, u32 vertex_count, MeshOptimizeVertexStream* stream_array, u32 stream_count, u32* inout_index, u32 index_count)
+    {
+        std::vector<u8> work;
+        for (u32 si = 0; si < stream_count; ++si)
+        {
+            auto& stream = stream_array[si];
+            if (!stream.data || 0 == stream.stride)
+                continue;
+
+            u8* data = static_cast<u8*>(stream.data);
+            work.assign(data, data + static_cast<size_t>(stream.stride) * vertex_count);
+            for (u32 v = 0; v < vertex_count; ++v)
+            {
+                memcpy(data + static_cast<size_t>(remap[v]) * stream.stride, work.data() + static_cast<size_t>(v) * stream.stride, stream.stride);
+            }
+        }
+        for (u32 i = 0; i < index_count; ++i)
+        {
+            inout_index[i] = remap[inout_index[i]];
+        }
+    }
+
+    void OptimizeMeshShape(u32* inout_index, u32 index_count, u32 vertex_count, const math::Vec3* position,
+        MeshOptimizeVertexStream* stream_array, u32 stream_count, const MeshOptimizeOption& option, MeshOptimizeStatistics* out_stat)
+    {
+        const u32 triangle_count = index_count / 3;
+        if (0 == triangle_count || 0 == vertex_count)
+            return;
+
+        if (out_stat)
+        {
+            const u32 transformed = CalcTransformedVertexCount(inout_index, index_count, vertex_count, option.cache_size);
+            out_stat->acmr_before = static_cast<float>(transformed) / static_cast<float>(triangle_count);
+            out_stat->atvr_before = static_cast<float>(transformed) / static_cast<float>(vertex_count);
+        }
+
+        if (option.enable_vertex_cache)
+        {
+            std::vector<u32> cluster_start;
+            std::vector<u32> optimized(index_count);
+            OptimizeVertexCache(optimized.data(), inout_index, index_count, vertex_count, option.cache_size, option.enable_overdraw ? &cluster_start : nullptr);
+            memcpy(inout_index, optimized.data(), sizeof(u32) * index_count);
+
+            if (option.enable_overdraw)
+                OptimizeOverdraw(inout_index, index_count, position, vertex_count, cluster_start);
+        }
+
+        if (option.enable_vertex_fetch)
+        {
+            std::vector<u32> remap(vertex_count);
+            BuildVertexFetchRemap(remap.data(), inout_index, index_count, vertex_count);
+            ApplyVertexRemap(remap.data(), vertex_count, stream_array, stream_count, inout_index, index_count);
+        }
+
+        if (out_stat)
+        {
+            const u32 transformed = CalcTransformedVertexCount(inout_index, index_count, vertex_count, option.cache_size);
+            out_stat->acmr_after = static_cast<float>(transformed) / static_cast<float>(triangle_count);
+            out_stat->atvr_after = static_cast<float>(transformed) / static_cast<float>(vertex_count);
+        }
+    }
+}
+}
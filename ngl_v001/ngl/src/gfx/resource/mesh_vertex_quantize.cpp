@@ -0,0 +1,448 @@
+﻿
+#include "gfx/resource/mesh_vertex_quantize.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace ngl
+{
+namespace gfx
+{
+    namespace
+    {
+        constexpr float k_unorm16_max = 65535.0f;
+
+        u16 FloatToUnorm16(float v)
+        {
+            v = std::clamp(v, 0.0f, 1.0f);
+            return static_cast<u16>(v * k_unorm16_max + 0.5f);
+        }
+        float Unorm16ToFloat(u16 v)
+        {
+            return static_cast<float>(v) / k_unorm16_max;
+        }
+
+        math::Vec3 NormalizeOrDefault(const math::Vec3& v, const math::Vec3& default_dir)
+        {
+            const float len = math::Vec3::Length(v);
+            return (0.0f < len) ? (v / len) : default_dir;
+        }
+
+        float CalcAngleDegree(const math::Vec3& a, const math::Vec3& b)
+        {
+            // 微小角ではacosの精度が不足するためatan2で求める.
+            return std::atan2(math::Vec3::Length(math::Vec3::Cross(a, b)), math::Vec3::Dot(a, b)) * (180.0f / math::k_pi_f);
+        }
+    }
+
+    u16 FloatToHalf(float v)
+    {
+        u32 f = 0;
+        memcpy(&f, &v, sizeof(f));
+
+        const u32 sign = (f >> 16) & 0x8000;
+        const u32 abs_f = f & 0x7fffffff;
+        // Inf, NaN.
+        if (0x7f800000 <= abs_f)
+            return static_cast<u16>(sign | 0x7c00 | ((0x7f800000 < abs_f) ? 0x200 : 0));
+
+        const int exponent = static_cast<int>(abs_f >> 23) - 127 + 15;
+        u32 mantissa = abs_f & 0x7fffff;
+        // Overflow.
+        if (31 <= exponent)
+            return static_cast<u16>(sign | 0x7c00);
+        // Denormal. 最近接偶数丸め.
+        if (0 >= exponent)
+        {
+            if (-10 > exponent)
+                return static_cast<u16>(sign);
+            mantissa |= 0x800000;
+            const u32 shift = static_cast<u32>(14 - exponent);
+            u32 h = mantissa >> shift;
+            const u32 rem = mantissa & ((1u << shift) - 1);
+            const u32 half = 1u << (shift - 1);
+            if (rem > half || (rem == half && (h & 1)))
+                ++h;
+            return static_cast<u16>(sign | h);
+        }
+        // Normal. 最近接偶数丸め. 仮数の繰り上がりは指数部に伝搬する.
+        u32 h = (static_cast<u32>(exponent) << 10) | (mantissa >> 13);
+        const u32 rem = mantissa & 0x1fff;
+        if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+            ++h;
+        return static_cast<u16>(sign | h);
+    }
+
+    float HalfToFloat(u16 v)
+    {
+        const u32 sign = static_cast<u32>(v & 0x8000) << 16;
+        const u32 exponent = (v >> 10) & 0x1f;
+        const u32 mantissa = v & 0x3ff;
+
+        u32 f = 0;
+        if (0 == exponent)
+        {
+            // Zero, Denormal.
+            const float denormal = std::ldexp(static_cast<float>(mantissa), -24);
+            return sign ? -denormal : denormal;
+        }
+        else if (31 == exponent)
+        {
+            f = sign | 0x7f800000 | (mantissa << 13);
+        }
+        else
+        {
+            f = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+        }
+        float ret = 0.0f;
+        memcpy(&ret, &f, sizeof(ret));
+        return ret;
+    }
+
+    MeshQuantizedOct EncodeOctahedronUnorm16(const math::Vec3& n)
+    {
+        // math_util.hlsli OctEncode と同一のマッピング.
+        const math::Vec3 dir = NormalizeOrDefault(n, math::Vec3(0.0f, 0.0f, 1.0f));
+        const float l1 = std::abs(dir.x) + std::abs(dir.y) + std::abs(dir.z);
+        float ox = dir.x / l1;
+        float oy = dir.y / l1;
+        if (0.0f > dir.z)
+        {
+            const float wx = (1.0f - std::abs(oy)) * ((0.0f <= ox) ? 1.0f : -1.0f);
+            const float wy = (1.0f - std::abs(ox)) * ((0.0f <= oy) ? 1.0f : -1.0f);
+            ox = wx;
+            oy = wy;
+        }
+        const float u = std::clamp(ox * 0.5f + 0.5f, 0.0f, 1.0f);
+        const float v = std::clamp(oy * 0.5f + 0.5f, 0.0f, 1.0f);
+
+        // 切り捨て/切り上げの組み合わせから復元誤差が最小のものを選択.
+        const u32 base_x = static_cast<u32>(std::floor(u * k_unorm16_max));
+        const u32 base_y = static_cast<u32>(std::floor(v * k_unorm16_max));
+        MeshQuantizedOct best = {};
+        float best_dot = -2.0f;
+        for (u32 dy = 0; dy < 2; ++dy)
+        {
+            for (u32 dx = 0; dx < 2; ++dx)
+            {
+                MeshQuantizedOct cand = {};
+                cand.x = static_cast<u16>(std::min(base_x + dx, 0xffffu));
+                cand.y = static_cast<u16>(std::min(base_y + dy, 0xffffu));
+                const float d = math::Vec3::Dot(dir, DecodeOctahedronUnorm16(cand));
+                if (best_dot < d)
+                {
+                    best_dot = d;
+                    best = cand;
+                }
+            }
+        }
+        return best;
+    }
+
+    math::Vec3 DecodeOctahedronUnorm16(const MeshQuantizedOct& v)
+    {
+        // math_util.hlsli OctDecode と同一.
+        const float fx = Unorm16ToFloat(v.x) * 2.0f - 1.0f;
+        const float fy = Unorm16ToFloat(v.y) * 2.0f - 1.0f;
+        math::Vec3 n(fx, fy, 1.0f - std::abs(fx) - std::abs(fy));
+        const float t = std::clamp(-n.z, 0.0f, 1.0f);
+        n.x += (0.0f <= n.x) ? -t : t;
+        n.y += (0.0f <= n.y) ? -t : t;
+        return math::Vec3::Normalize(n);
+    }
+
+    float CalcBitangentSign(const math::Vec3& normal, const math::Vec3& tangent, const math::Vec3& binormal)
+    {
+        return (0.0f <= math::Vec3::Dot(math::Vec3::Cross(normal, tangent), binormal)) ? 1.0f : -1.0f;
+    }
+
+    math::Vec3 ReconstructBinormal(const math::Vec3& normal, const math::Vec3& tangent, float bitangent_sign)
+    {
+        return NormalizeOrDefault(math::Vec3::Cross(normal, tangent) * bitangent_sign, math::Vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    math::Vec3 DequantizePosition(const MeshQuantizedPosition& v, const math::Vec3& dequant_scale, const math::Vec3& dequant_offset)
+    {
+        return math::Vec3(Unorm16ToFloat(v.x), Unorm16ToFloat(v.y), Unorm16ToFloat(v.z)) * dequant_scale + dequant_offset;
+    }
+
+    void QuantizeVertexStreams(MeshQuantizeDestination& out_dst, const MeshQuantizeSource& src)
+    {
+        const u32 num_vertex = src.num_vertex;
+
+        if (src.position && out_dst.position)
+        {
+            // バウンズで正規化.
+            math::Vec3 bound_min = (0 < num_vertex) ? src.position[0] : math::Vec3::Zero();
+            math::Vec3 bound_max = bound_min;
+            for (u32 i = 1; i < num_vertex; ++i)
+            {
+                const math::Vec3& p = src.position[i];
+                bound_min = math::Vec3(std::min(bound_min.x, p.x), std::min(bound_min.y, p.y), std::min(bound_min.z, p.z));
+                bound_max = math::Vec3(std::max(bound_max.x, p.x), std::max(bound_max.y, p.y), std::max(bound_max.z, p.z));
+            }
+            out_dst.position_dequant_offset = bound_min;
+            out_dst.position_dequant_scale = bound_max - bound_min;
+
+            const math::Vec3 extent = out_dst.position_dequant_scale;
+            const math::Vec3 inv_extent(
+                (0.0f < extent.x) ? 1.0f / extent.x : 0.0f,
+                (0.0f < extent.y) ? 1.0f / extent.y : 0.0f,
+                (0.0f < extent.z) ? 1.0f / extent.z : 0.0f);
+            for (u32 i = 0; i < num_vertex; ++i)
+            {
+                const math::Vec3 local = (src.position[i] - bound_min) * inv_extent;
+                auto& q = out_dst.position[i];
+                q.x = FloatToUnorm16(local.x);
+                q.y = FloatToUnorm16(local.y);
+                q.z = FloatToUnorm16(local.z);
+
+                // wにBitangent符号. 1 -> 1.0, -1 -> 0.0.
+                float sign = 1.0f;
+                if (src.normal && src.tangent && src.binormal)
+                    sign = CalcBitangentSign(src.normal[i], src.tangent[i], src.binormal[i]);
+                q.w = (0.0f < sign) ? 0xffff : 0;
+            }
+        }
+
+        if (src.normal && out_dst.normal)
+        {
+            for (u32 i = 0; i < num_vertex; ++i)
+                out_dst.normal[i] = EncodeOctahedronUnorm16(src.normal[i]);
+        }
+        if (src.tangent && out_dst.tangent)
+        {
+            for (u32 i = 0; i < num_vertex; ++i)
+                out_dst.tangent[i] = EncodeOctahedronUnorm16(src.tangent[i]);
+        }
+
+        const size_t num_texcoord = std::min(src.texcoord.size(), out_dst.texcoord.size());
+        for (size_t ci = 0; ci < num_texcoord; ++ci)
+        {
+            if (!src.texcoord[ci] || !out_dst.texcoord[ci])
+                continue;
+            for (u32 i = 0; i < num_vertex; ++i)
+            {
+                out_dst.texcoord[ci][i].x = FloatToHalf(src.texcoord[ci][i].x);
+                out_dst.texcoord[ci][i].y = FloatToHalf(src.texcoord[ci][i].y);
+            }
+        }
+    }
+
+    MeshQuantizeErrorStatistics CalcQuantizeError(const MeshQuantizeSource& src, const MeshQuantizeDestination& dst)
+    {
+        MeshQuantizeErrorStatistics stat = {};
+        const u32 num_vertex = src.num_vertex;
+
+        if (src.position && dst.position)
+        {
+            for (u32 i = 0; i < num_vertex; ++i)
+            {
+                const math::Vec3 d = DequantizePosition(dst.position[i], dst.position_dequant_scale, dst.position_dequant_offset) - src.position[i];
+                stat.max_position_error = std::max(stat.max_position_error, std::max(std::abs(d.x), std::max(std::abs(d.y), std::abs(d.z))));
+            }
+            const math::Vec3& extent = dst.position_dequant_scale;
+            const float max_extent = std::max(extent.x, std::max(extent.y, extent.z));
+            stat.max_position_error_ratio = (0.0f < max_extent) ? stat.max_position_error / max_extent : 0.0f;
+        }
+
+        if (src.normal && dst.normal)
+        {
+            for (u32 i = 0; i < num_vertex; ++i)
+            {
+                const math::Vec3 n = NormalizeOrDefault(src.normal[i], math::Vec3(0.0f, 0.0f, 1.0f));
+                stat.max_normal_error_deg = std::max(stat.max_normal_error_deg, CalcAngleDegree(n, DecodeOctahedronUnorm16(dst.normal[i])));
+            }
+        }
+        if (src.tangent && dst.tangent)
+        {
+            for (u32 i = 0; i < num_vertex; ++i)
+            {
+                const math::Vec3 t = NormalizeOrDefault(src.tangent[i], math::Vec3(0.0f, 0.0f, 1.0f));
+                stat.max_tangent_error_deg = std::max(stat.max_tangent_error_deg, CalcAngleDegree(t, DecodeOctahedronUnorm16(dst.tangent[i])));
+            }
+        }
+        if (src.binormal && dst.normal && dst.tangent && dst.position)
+        {
+            for (u32 i = 0; i < num_vertex; ++i)
+            {
+                const float sign = (0 != dst.position[i].w) ? 1.0f : -1.0f;
+                const math::Vec3 b = NormalizeOrDefault(src.binormal[i], math::Vec3(0.0f, 1.0f, 0.0f));
+                const math::Vec3 rb = ReconstructBinormal(DecodeOctahedronUnorm16(dst.normal[i]), DecodeOctahedronUnorm16(dst.tangent[i]), sign);
+                stat.max_binormal_error_deg = std::max(stat.max_binormal_error_deg, CalcAngleDegree(b, rb));
+            }
+        }
+
+        const size_t num_texcoord = std::min(src.texcoord.size(), dst.texcoord.size());
+        for (size_t ci = 0; ci < num_texcoord; ++ci)
+        {
+            if (!src.texcoord[ci] || !dst.texcoord[ci])
+                continue;
+            for (u32 i = 0; i < num_vertex; ++i)
+            {
+                const float ex = std::abs(HalfToFloat(dst.texcoord[ci][i].x) - src.texcoord[ci][i].x);
+                const float ey = std::abs(HalfToFloat(dst.texcoord[ci][i].y) - src.texcoord[ci][i].y);
+                stat.max_texcoord_error = std::max(stat.max_texcoord_error, std::max(ex, ey));
+            }
+        }
+
+        return stat;
+    }
+
+    void TestMeshVertexQuantize()
+    {
+        bool is_ok = true;
+
+        u32 seed = 7;
+        const auto Rand01 = [&seed]()
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<float>(seed >> 8) / static_cast<float>(1u << 24);
+        };
+        const auto RandUnit = [&Rand01]()
+        {
+            // 棄却法で球面上の一様分布.
+            for (;;)
+            {
+                const math::Vec3 v(Rand01() * 2.0f - 1.0f, Rand01() * 2.0f - 1.0f, Rand01() * 2.0f - 1.0f);
+                const float len = math::Vec3::Length(v);
+                if (0.01f < len && len <= 1.0f)
+                    return v / len;
+            }
+        };
+
+        // 頂点データ. Octahedronの頂点や辺上などの境界の方向を含める.
+        std::vector<math::Vec3> normal = {
+            math::Vec3(1.0f, 0.0f, 0.0f), math::Vec3(-1.0f, 0.0f, 0.0f), math::Vec3(0.0f, 1.0f, 0.0f), math::Vec3(0.0f, -1.0f, 0.0f),
+            math::Vec3(0.0f, 0.0f, 1.0f), math::Vec3(0.0f, 0.0f, -1.0f),
+            math::Vec3::Normalize(math::Vec3(1.0f, 1.0f, 0.0f)), math::Vec3::Normalize(math::Vec3(-1.0f, 0.0f, -1.0f)), math::Vec3::Normalize(math::Vec3(1.0f, -1.0f, -1.0f)),
+        };
+        constexpr u32 k_num_vertex = 4096;
+        while (normal.size() < k_num_vertex)
+            normal.push_back(RandUnit());
+
+        std::vector<math::Vec3> position(k_num_vertex);
+        std::vector<math::Vec3> tangent(k_num_vertex);
+        std::vector<math::Vec3> binormal(k_num_vertex);
+        std::vector<math::Vec2> texcoord(k_num_vertex);
+        std::vector<float> bitangent_sign(k_num_vertex);
+        for (u32 i = 0; i < k_num_vertex; ++i)
+        {
+            // 軸毎にスケールの異なるバウンズ.
+            position[i] = math::Vec3(Rand01() * 8.0f - 3.0f, Rand01() * 0.5f, Rand01() * 200.0f - 100.0f);
+
+            // 法線に直交する接線と, 符号付きの従法線.
+            math::Vec3 t = math::Vec3::Cross(normal[i], RandUnit());
+            while (1e-3f > math::Vec3::Length(t))
+                t = math::Vec3::Cross(normal[i], RandUnit());
+            tangent[i] = math::Vec3::Normalize(t);
+            bitangent_sign[i] = (0.5f > Rand01()) ? 1.0f : -1.0f;
+            binormal[i] = math::Vec3::Cross(normal[i], tangent[i]) * bitangent_sign[i];
+
+            texcoord[i] = math::Vec2(Rand01() * 8.0f - 4.0f, Rand01());
+        }
+        // halfで正確に表現できる値.
+        texcoord[0] = math::Vec2(0.0f, 1.0f);
+        texcoord[1] = math::Vec2(0.5f, -2.0f);
+
+        std::vector<MeshQuantizedPosition> position_q(k_num_vertex);
+        std::vector<MeshQuantizedOct> normal_q(k_num_vertex);
+        std::vector<MeshQuantizedOct> tangent_q(k_num_vertex);
+        std::vector<MeshQuantizedTexcoord> texcoord_q(k_num_vertex);
+
+        MeshQuantizeSource src = {};
+        src.num_vertex = k_num_vertex;
+        src.position = position.data();
+        src.normal = normal.data();
+        src.tangent = tangent.data();
+        src.binormal = binormal.data();
+        src.texcoord.push_back(texcoord.data());
+        MeshQuantizeDestination dst = {};
+        dst.position = position_q.data();
+        dst.normal = normal_q.data();
+        dst.tangent = tangent_q.data();
+        dst.texcoord.push_back(texcoord_q.data());
+        QuantizeVertexStreams(dst, src);
+
+        // 位置. 軸毎にバウンズの辺長/65535 の半分以内.
+        {
+            const math::Vec3 extent = dst.position_dequant_scale;
+            for (u32 i = 0; i < k_num_vertex; ++i)
+            {
+                const math::Vec3 p = DequantizePosition(position_q[i], dst.position_dequant_scale, dst.position_dequant_offset);
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    const float bound = 0.5f * extent.Component(axis) / k_unorm16_max + 1e-5f * extent.Component(axis) + 1e-6f;
+                    is_ok &= (std::abs(p.Component(axis) - position[i].Component(axis)) <= bound);
+                }
+            }
+        }
+        // 法線と接線. 16bit Octahedronで0.01度以内.
+        //  従法線は復元に使う符号が一致し, 法線と接線の誤差分のみ.
+        constexpr float k_oct_error_deg = 0.01f;
+        for (u32 i = 0; i < k_num_vertex; ++i)
+        {
+            is_ok &= (CalcAngleDegree(normal[i], DecodeOctahedronUnorm16(normal_q[i])) <= k_oct_error_deg);
+            is_ok &= (CalcAngleDegree(tangent[i], DecodeOctahedronUnorm16(tangent_q[i])) <= k_oct_error_deg);
+
+            const float sign = (0 != position_q[i].w) ? 1.0f : -1.0f;
+            is_ok &= (sign == bitangent_sign[i]);
+            is_ok &= (CalcBitangentSign(normal[i], tangent[i], binormal[i]) == bitangent_sign[i]);
+            const math::Vec3 rb = ReconstructBinormal(DecodeOctahedronUnorm16(normal_q[i]), DecodeOctahedronUnorm16(tangent_q[i]), sign);
+            is_ok &= (CalcAngleDegree(binormal[i], rb) <= 2.0f * k_oct_error_deg);
+        }
+        // UV. halfの丸め誤差 (仮数10bit) 以内. 表現可能な値は誤差無し.
+        for (u32 i = 0; i < k_num_vertex; ++i)
+        {
+            const float u = HalfToFloat(texcoord_q[i].x);
+            const float v = HalfToFloat(texcoord_q[i].y);
+            is_ok &= (std::abs(u - texcoord[i].x) <= std::abs(texcoord[i].x) * (1.0f / 2048.0f) + 1e-7f);
+            is_ok &= (std::abs(v - texcoord[i].y) <= std::abs(texcoord[i].y) * (1.0f / 2048.0f) + 1e-7f);
+        }
+        is_ok &= (0.0f == HalfToFloat(texcoord_q[0].x)) && (1.0f == HalfToFloat(texcoord_q[0].y));
+        is_ok &= (0.5f == HalfToFloat(texcoord_q[1].x)) && (-2.0f == HalfToFloat(texcoord_q[1].y));
+        // NaN以外の全halfの往復.
+        for (u32 h = 0; h <= 0xffff; ++h)
+        {
+            const bool is_nan = (0x7c00 == (h & 0x7c00)) && (0 != (h & 0x03ff));
+            if (!is_nan)
+                is_ok &= (FloatToHalf(HalfToFloat(static_cast<u16>(h))) == static_cast<u16>(h));
+        }
+
+        // 誤差統計が個別の検証と一致する範囲.
+        {
+            const auto stat = CalcQuantizeError(src, dst);
+            is_ok &= (stat.max_position_error_ratio <= 1.0f / k_unorm16_max);
+            is_ok &= (stat.max_normal_error_deg <= k_oct_error_deg) && (stat.max_tangent_error_deg <= k_oct_error_deg);
+            is_ok &= (stat.max_binormal_error_deg <= 2.0f * k_oct_error_deg);
+            is_ok &= (stat.max_texcoord_error <= 4.0f / 2048.0f);
+        }
+
+        // バウンズが平面に縮退したShapeは縮退軸を誤差無く復元する.
+        {
+            std::vector<math::Vec3> flat_position = { math::Vec3(0.0f, 2.0f, 0.0f), math::Vec3(1.0f, 2.0f, 0.0f), math::Vec3(0.0f, 2.0f, 1.0f) };
+            std::vector<MeshQuantizedPosition> flat_q(flat_position.size());
+            MeshQuantizeSource flat_src = {};
+            flat_src.num_vertex = static_cast<u32>(flat_position.size());
+            flat_src.position = flat_position.data();
+            MeshQuantizeDestination flat_dst = {};
+            flat_dst.position = flat_q.data();
+            QuantizeVertexStreams(flat_dst, flat_src);
+            for (size_t i = 0; i < flat_position.size(); ++i)
+            {
+                const math::Vec3 p = DequantizePosition(flat_q[i], flat_dst.position_dequant_scale, flat_dst.position_dequant_offset);
+                is_ok &= (2.0f == p.y) && (flat_position[i].x == p.x) && (flat_position[i].z == p.z);
+                // 従法線が無い場合の符号は正.
+                is_ok &= (0xffff == flat_q[i].w);
+            }
+        }
+
+        std::cout << "[TestMeshVertexQuantize]";
+        std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+        assert(is_ok);
+    }
+}
+}
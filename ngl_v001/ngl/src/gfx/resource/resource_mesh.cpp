@@ -2,6 +2,7 @@
 #include "gfx/resource/resource_mesh.h"
 
 #include "resource/resource_manager.h"
+#include "gfx/resource/upload_manager.h"
 
 namespace ngl
 {
@@ -35,30 +36,6 @@ namespace gfx
             return false;
         }
 
-        // Upload用Bufferが必要な場合は一時生成.
-        rhi::RefBufferDep upload_buffer = {};
-        if (initial_data)
-        {
-            upload_buffer.Reset(new rhi::BufferDep());
-
-            auto upload_desc          = buffer_desc;
-            upload_desc.heap_type     = ngl::rhi::EResourceHeapType::Upload;
-            upload_desc.initial_state = ngl::rhi::EResourceState::General;  // UploadHeapはGenericRead.
-
-            if (!upload_buffer->Initialize(p_device, upload_desc))
-            {
-                assert(false);
-                return false;
-            }
-
-            // 初期データのコピー.
-            if (void* mapped = upload_buffer->Map())
-            {
-                memcpy(mapped, initial_data, element_size_in_byte * element_count);
-                upload_buffer->Unmap();
-            }
-        }
-
         rhi::BufferDep* p_buffer = p_mesh_geom_buffer->rhi_buffer_.Get();
         // Viewの生成. 引数で生成対象ポインタを指定された要素のみ.
         bool result = true;
@@ -69,6 +46,8 @@ namespace gfx
                 assert(false);
                 result = false;
             }
+            // Bindless有効時は頂点バッファSRVにも不変のインデックスを割り当てる.
+            p_out_view->RegisterBindless();
         }
         if (p_out_vbv)
         {
@@ -89,29 +68,12 @@ namespace gfx
             }
         }
 
-        // UploadBufferからコピーするコマンドを発行. 適切に遅延破棄させるため個々のRefをコピーキャプチャ.
-        auto req_buffer = p_mesh_geom_buffer->rhi_buffer_;
-        auto req_init_state = p_mesh_geom_buffer->rhi_init_state_;
-        fwk::PushCommonRenderCommand([upload_buffer, req_buffer, req_init_state](fwk::CommonRenderCommandArgRef arg)
+        // 初期データはUploadManagerのステージングリング経由でCopy Queueからコピーする. 初期ステートがCommonのためBarrierは不要.
+        //  UploadManagerが初期データをコピーして保持するため, 元データの寿命はここまででよい.
+        if (initial_data)
         {
-            arg.command_list->GetDevice();
-            auto p_commandlist = arg.command_list;
-
-            // バッファ自体が生成されていなければ終了.
-            if (!upload_buffer.IsValid() || !req_buffer->GetD3D12Resource())
-                return;
-
-            // Init Upload Buffer から DefaultHeapのBufferへコピー. StateはGeneral想定.
-            // 生成時のロジックで指定したステート. Bufferの初期ステートはDefaultHeapの場合?はCommonでないとValidationErrorとされるようになったので注意.
-            const rhi::EResourceState buffer_state = req_init_state;
-
-            auto ref_buffer = req_buffer;
-            p_commandlist->ResourceBarrier(ref_buffer.Get(), buffer_state, rhi::EResourceState::CopyDst);
-            p_commandlist->CopyResource(ref_buffer.Get(), upload_buffer.Get());
-            p_commandlist->ResourceBarrier(ref_buffer.Get(), rhi::EResourceState::CopyDst, buffer_state);
-
-            // upload bufferは一時バッファとして作ってRefとしているので自動的に解放される.
-        });
+            UploadManager::Instance().EnqueueBuffer(p_mesh_geom_buffer->rhi_buffer_, initial_data, static_cast<u64>(element_size_in_byte) * element_count);
+        }
 
         return result;
     }
@@ -125,6 +87,30 @@ namespace gfx
         num_vertex_ = init_source_data.num_vertex_;
         num_primitive_ = init_source_data.num_primitive_;
 
+        // 量子化ストリームがある場合はラスタライズ用の頂点入力を量子化ストリームにする.
+        vertex_format_ = (init_source_data.position_q_) ? EMeshVertexFormat::QUANTIZED : EMeshVertexFormat::FLOAT;
+        position_dequant_scale_ = init_source_data.position_dequant_scale_;
+        position_dequant_offset_ = init_source_data.position_dequant_offset_;
+        const bool is_quantized = EMeshVertexFormat::QUANTIZED == vertex_format_;
+
+        // 量子化ストリームのバッファ生成とSlotマッピング.
+        auto SetupQuantizedStream = [this, p_device](MeshShapeVertexDataBase* p_stream, void* raw_ptr, rhi::EResourceFormat format, int element_size_in_byte,
+            EMeshVertexSemanticKind::Type semantic, int semantic_index)
+        {
+            p_stream->raw_ptr_ = raw_ptr;
+
+            CreateShapeDataRhiBuffer(
+                p_stream,
+                p_stream->rhi_srv.Get(),
+                p_stream->rhi_vbv_.Get(),
+                nullptr,
+                p_device, ngl::rhi::ResourceBindFlag::VertexBuffer, format, element_size_in_byte, num_vertex_,
+                p_stream->raw_ptr_);
+
+            p_vtx_attr_mapping_[gfx::MeshVertexSemantic::SemanticSlot(semantic, semantic_index)] = p_stream;
+            vtx_attr_mask_.AddSlot(semantic, semantic_index);
+        };
+
         // Vertex Attribute.
         {
             position_.raw_ptr_ = init_source_data.position_;
@@ -138,14 +124,25 @@ namespace gfx
                 position_.raw_ptr_);
 
             // Slotマッピング.
-            p_vtx_attr_mapping_[gfx::MeshVertexSemantic::SemanticSlot(gfx::EMeshVertexSemanticKind::POSITION)] = &position_;
-            vtx_attr_mask_.AddSlot(gfx::EMeshVertexSemanticKind::POSITION);
+            //  量子化時もfloatのバッファはレイトレースやCompute等のSRV用に生成する.
+            if (is_quantized)
+            {
+                SetupQuantizedStream(&position_q_, init_source_data.position_q_, rhi::EResourceFormat::Format_R16G16B16A16_UNORM, sizeof(MeshQuantizedPosition),
+                    gfx::EMeshVertexSemanticKind::POSITION, 0);
+            }
+            else
+            {
+                p_vtx_attr_mapping_[gfx::MeshVertexSemantic::SemanticSlot(gfx::EMeshVertexSemanticKind::POSITION)] = &position_;
+                vtx_attr_mask_.AddSlot(gfx::EMeshVertexSemanticKind::POSITION);
+            }
         }
 
         if (init_source_data.normal_)
         {
             normal_.raw_ptr_ = init_source_data.normal_;
-
+        }
+        if (init_source_data.normal_ && !is_quantized)
+        {
             CreateShapeDataRhiBuffer(
                 &normal_,
                 normal_.rhi_srv.Get(),
@@ -164,7 +161,9 @@ namespace gfx
         if (init_source_data.tangent_)
         {
             tangent_.raw_ptr_ = init_source_data.tangent_;
-
+        }
+        if (init_source_data.tangent_ && !is_quantized)
+        {
             CreateShapeDataRhiBuffer(
                 &tangent_,
                 tangent_.rhi_srv.Get(),
@@ -183,7 +182,9 @@ namespace gfx
         if (init_source_data.binormal_)
         {
             binormal_.raw_ptr_ = init_source_data.binormal_;
-
+        }
+        if (init_source_data.binormal_ && !is_quantized)
+        {
             CreateShapeDataRhiBuffer(
                 &binormal_,
                 binormal_.rhi_srv.Get(),
@@ -199,6 +200,17 @@ namespace gfx
             p_vtx_attr_mapping_[gfx::MeshVertexSemantic::SemanticSlot(gfx::EMeshVertexSemanticKind::BINORMAL)] = &binormal_;
             vtx_attr_mask_.AddSlot(gfx::EMeshVertexSemanticKind::BINORMAL);
         }
+        // 量子化時のBINORMALはNORMAL, TANGENTとPOSITION.wの符号からシェーダで復元するためストリームを持たない.
+        if (is_quantized && init_source_data.normal_q_)
+        {
+            SetupQuantizedStream(&normal_q_, init_source_data.normal_q_, rhi::EResourceFormat::Format_R16G16_UNORM, sizeof(MeshQuantizedOct),
+                gfx::EMeshVertexSemanticKind::NORMAL, 0);
+        }
+        if (is_quantized && init_source_data.tangent_q_)
+        {
+            SetupQuantizedStream(&tangent_q_, init_source_data.tangent_q_, rhi::EResourceFormat::Format_R16G16_UNORM, sizeof(MeshQuantizedOct),
+                gfx::EMeshVertexSemanticKind::TANGENT, 0);
+        }
 
         // SRGBかLinearで問題になるかもしれない. 現状はとりあえずLinear扱い.
         color_.resize(init_source_data.color_.size());
@@ -225,6 +237,8 @@ namespace gfx
         for (int ci = 0; ci < init_source_data.texcoord_.size(); ++ci)
         {
             texcoord_[ci].raw_ptr_ = init_source_data.texcoord_[ci];
+            if (is_quantized)
+                continue;
 
             CreateShapeDataRhiBuffer(
                 &texcoord_[ci],
@@ -241,6 +255,15 @@ namespace gfx
             p_vtx_attr_mapping_[gfx::MeshVertexSemantic::SemanticSlot(gfx::EMeshVertexSemanticKind::TEXCOORD, ci)] = &texcoord_[ci];
             vtx_attr_mask_.AddSlot(gfx::EMeshVertexSemanticKind::TEXCOORD, ci);
         }
+        if (is_quantized)
+        {
+            texcoord_q_.resize(init_source_data.texcoord_q_.size());
+            for (int ci = 0; ci < init_source_data.texcoord_q_.size(); ++ci)
+            {
+                SetupQuantizedStream(&texcoord_q_[ci], init_source_data.texcoord_q_[ci], rhi::EResourceFormat::Format_R16G16_FLOAT, sizeof(MeshQuantizedTexcoord),
+                    gfx::EMeshVertexSemanticKind::TEXCOORD, ci);
+            }
+        }
 
         // Index.
         {
@@ -254,6 +277,33 @@ namespace gfx
                 p_device, ngl::rhi::ResourceBindFlag::IndexBuffer, rhi::EResourceFormat::Format_R32_UINT, sizeof(uint32_t), num_primitive_ * 3,
                 index_.raw_ptr_);
         }
+
+        // Shape毎の定数バッファ. 描画毎の確保を避けるためロード時に一度だけ生成してアップロードする.
+        {
+            ShapeInfo shape_info = {};
+            shape_info.vtx_pos_dequant_scale = position_dequant_scale_;
+            shape_info.vtx_format = static_cast<uint32_t>(vertex_format_);
+            shape_info.vtx_pos_dequant_offset = position_dequant_offset_;
+            shape_info.vtx_pad0 = 0;
+
+            rhi::BufferDep::Desc cb_desc = {};
+            cb_desc.SetupAsConstantBuffer(sizeof(ShapeInfo));
+            cb_desc.heap_type = rhi::EResourceHeapType::Default;
+            cb_desc.initial_state = rhi::EResourceState::Common;
+            shape_info_buffer_.Reset(new rhi::BufferDep());
+            if (!shape_info_buffer_->Initialize(p_device, cb_desc))
+            {
+                assert(false);
+            }
+            shape_info_cbv_.Reset(new rhi::ConstantBufferViewDep());
+            rhi::ConstantBufferViewDep::Desc cbv_desc = {};
+            shape_info_cbv_->Initialize(shape_info_buffer_.Get(), cbv_desc);
+
+            UploadManager::Instance().EnqueueBuffer(shape_info_buffer_, &shape_info, sizeof(shape_info));
+        }
+
+        // 全ストリームのアップロード要求の後. 以前の要求は全てこのチケット以前に完了する.
+        upload_ticket_ = UploadManager::Instance().GetLastTicket();
     }
 
     /*
@@ -461,6 +511,23 @@ namespace gfx
             if (0 <= layout.offset_index)
                 init_data.index_ = reinterpret_cast<uint32_t*>(base_ptr + layout.offset_index);
 
+            if (EMeshVertexFormat::QUANTIZED == layout.vertex_format)
+            {
+                if (0 <= layout.offset_position_q)
+                    init_data.position_q_ = reinterpret_cast<MeshQuantizedPosition*>(base_ptr + layout.offset_position_q);
+                if (0 <= layout.offset_normal_q)
+                    init_data.normal_q_ = reinterpret_cast<MeshQuantizedOct*>(base_ptr + layout.offset_normal_q);
+                if (0 <= layout.offset_tangent_q)
+                    init_data.tangent_q_ = reinterpret_cast<MeshQuantizedOct*>(base_ptr + layout.offset_tangent_q);
+                for (int ci = 0; ci < layout.num_uv_ch; ++ci)
+                {
+                    if (0 <= layout.offset_uv_q[ci])
+                        init_data.texcoord_q_.push_back(reinterpret_cast<MeshQuantizedTexcoord*>(base_ptr + layout.offset_uv_q[ci]));
+                }
+                init_data.position_dequant_scale_ = layout.position_dequant_scale;
+                init_data.position_dequant_offset_ = layout.position_dequant_offset;
+            }
+
             out_mesh.shape_array_[shape_i].Initialize(p_device, init_data);
         }
 
@@ -2,6 +2,13 @@
 #include "gfx/resource/resource_texture.h"
 
 #include "resource/resource_manager.h"
+#include "file/file.h"
+#include "gfx/resource/upload_manager.h"
+#include "gfx/resource/texture_streaming_system.h"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
 
 
 #include <direct.h>
@@ -10,9 +17,179 @@ namespace ngl
 {
 	namespace gfx
 	{
+		UploadTicket EnqueueTextureUpload(const rhi::RefTextureDep& texture, const std::shared_ptr<const TextureUploadSource>& source, u32 top_mip, u32 end_mip)
+		{
+			assert(texture.IsValid() && source);
+			const u32 mip_count = texture->GetDesc().mip_count;
+			const u32 num_subresource = static_cast<u32>(source->dst_layout.size());
+			assert(source->subresource_info_array.size() == num_subresource);
+			if (mip_count <= top_mip || end_mip <= top_mip)
+				return 0;
+
+			// 対象Mipの全Array要素のSubresourceを抽出し, ステージング上のレイアウトを詰めて再配置する.
+			struct UploadRange
+			{
+				std::vector<u32>								subresource_index = {};
+				std::vector<rhi::TextureSubresourceLayoutInfo>	layout = {};
+				std::vector<rhi::TextureUploadSubresourceInfo>	info = {};
+			};
+			auto range = std::make_shared<UploadRange>();
+			u64 byte_size = 0;
+			for (u32 subresource_index = 0; subresource_index < num_subresource; ++subresource_index)
+			{
+				const u32 mip = subresource_index % mip_count;
+				if (mip < top_mip || end_mip <= mip)
+					continue;
+
+				const u64 src_begin = source->dst_layout[subresource_index].byte_offset;
+				const u64 src_end = (subresource_index + 1 < num_subresource) ? source->dst_layout[subresource_index + 1].byte_offset : source->dst_byte_size;
+
+				auto layout = source->dst_layout[subresource_index];
+				layout.byte_offset = (byte_size + (D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1)) & ~static_cast<u64>(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+				byte_size = layout.byte_offset + (src_end - src_begin);
+
+				range->subresource_index.push_back(subresource_index);
+				range->layout.push_back(layout);
+				range->info.push_back(source->subresource_info_array[subresource_index]);
+			}
+			if (range->subresource_index.empty())
+				return 0;
+
+			return UploadManager::Instance().Enqueue(byte_size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT,
+				[source, range](u8* p_dst)
+				{
+					// 確保した一時バッファメモリにレイアウトに則ってアップロード用テクスチャデータをコピー. ピクセルは source が保持する.
+					res::ResourceManager::Instance().CopyImageDataToUploadIntermediateBuffer(
+						p_dst,
+						range->layout.data(), range->info.data(), static_cast<s32>(range->info.size()));
+				},
+				[range, texture](rhi::CommandListBaseDep* p_command_list, rhi::BufferDep* p_src, u64 src_offset)
+				{
+					for (size_t i = 0; i < range->subresource_index.size(); ++i)
+					{
+						// レイアウトのオフセットはステージング上の確保位置からの相対.
+						auto src_layout = range->layout[i];
+						src_layout.byte_offset += src_offset;
+						p_command_list->CopyTextureRegion(texture.Get(), range->subresource_index[i], p_src, src_layout);
+					}
+				});
+		}
+
+		rhi::TextureDep::Desc MakeStreamingTextureDesc(const rhi::TextureDep::Desc& desc, u32 top_mip)
+		{
+			assert(top_mip < static_cast<u32>(desc.mip_count));
+			rhi::TextureDep::Desc out_desc = desc;
+			out_desc.width = std::max(1u, desc.width >> top_mip);
+			out_desc.height = std::max(1u, desc.height >> top_mip);
+			out_desc.mip_count = desc.mip_count - top_mip;
+			return out_desc;
+		}
+
+		UploadTicket EnqueueStreamingTextureUpdate(const rhi::RefTextureDep& dst_texture, u32 dst_top_mip, const rhi::RefTextureDep& src_texture, u32 src_top_mip, u32 copy_top_mip,
+			const std::shared_ptr<const TextureStreamingSource>& source)
+		{
+			assert(dst_texture.IsValid() && src_texture.IsValid() && source);
+			assert(dst_top_mip <= copy_top_mip && src_top_mip <= copy_top_mip);
+			const u32 mip_count = static_cast<u32>(source->desc.mip_count);
+			const u32 array_size = static_cast<u32>(source->desc.array_size);
+			const u32 dst_mip_count = mip_count - dst_top_mip;
+			const u32 src_mip_count = mip_count - src_top_mip;
+			assert(dst_texture->GetDesc().mip_count == dst_mip_count && src_texture->GetDesc().mip_count == src_mip_count);
+
+			std::vector<rhi::TextureSubresourceLayoutInfo> dst_layout(dst_texture->NumSubresource());
+			u64 dst_byte_size = 0;
+			dst_texture->GetSubresourceLayoutInfo(dst_layout.data(), dst_byte_size);
+
+			// キャッシュファイルから読み込むSubresourceと, 旧TextureからコピーするSubresource.
+			struct UpdateRange
+			{
+				std::vector<u32>								upload_subresource_index = {};	// dst_texture上.
+				std::vector<u32>								upload_source_index = {};		// source上 (全Mip基準).
+				std::vector<rhi::TextureSubresourceLayoutInfo>	upload_layout = {};
+				std::vector<std::pair<u32, u32>>				copy_subresource_index = {};	// dst_texture上, src_texture上.
+			};
+			auto range = std::make_shared<UpdateRange>();
+			u64 byte_size = 0;
+			for (u32 array_index = 0; array_index < array_size; ++array_index)
+			{
+				for (u32 mip = dst_top_mip; mip < mip_count; ++mip)
+				{
+					const u32 dst_subresource_index = (mip - dst_top_mip) + array_index * dst_mip_count;
+					if (copy_top_mip <= mip)
+					{
+						range->copy_subresource_index.push_back({ dst_subresource_index, (mip - src_top_mip) + array_index * src_mip_count });
+						continue;
+					}
+
+					const u32 source_index = mip + array_index * mip_count;
+					auto layout = dst_layout[dst_subresource_index];
+					layout.byte_offset = (byte_size + (D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1)) & ~static_cast<u64>(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+					byte_size = layout.byte_offset + static_cast<u64>(layout.row_pitch) * (source->subresource_info_array[source_index].slicePitch / source->subresource_info_array[source_index].rowPitch);
+
+					range->upload_subresource_index.push_back(dst_subresource_index);
+					range->upload_source_index.push_back(source_index);
+					range->upload_layout.push_back(layout);
+				}
+			}
+
+			return UploadManager::Instance().Enqueue(byte_size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT,
+				[source, range](u8* p_dst)
+				{
+					// 必要なMipのみキャッシュファイルから読み込む. 選択されたフレームのRenderThreadで読み込むため, 読み込み量はアップロード予算で制限される.
+					std::vector<u8> pixel_memory;
+					std::vector<rhi::TextureUploadSubresourceInfo> info(range->upload_source_index.size());
+					for (size_t i = 0; i < range->upload_source_index.size(); ++i)
+					{
+						info[i] = source->subresource_info_array[range->upload_source_index[i]];
+						const size_t offset = pixel_memory.size();
+						pixel_memory.resize(offset + info[i].slicePitch);
+						if (!file::ReadFileRange(source->cache_file_path.c_str(), source->file_offset_array[range->upload_source_index[i]], pixel_memory.data() + offset, info[i].slicePitch))
+						{
+							std::cout << "[ERROR] EnqueueStreamingTextureUpdate: Failed to read " << source->cache_file_path << std::endl;
+						}
+					}
+					size_t offset = 0;
+					for (auto& e : info)
+					{
+						e.pixels = pixel_memory.data() + offset;
+						offset += e.slicePitch;
+					}
+					res::ResourceManager::Instance().CopyImageDataToUploadIntermediateBuffer(
+						p_dst,
+						range->upload_layout.data(), info.data(), static_cast<s32>(info.size()));
+				},
+				[range, dst_texture, src_texture](rhi::CommandListBaseDep* p_command_list, rhi::BufferDep* p_src, u64 src_offset)
+				{
+					for (size_t i = 0; i < range->upload_subresource_index.size(); ++i)
+					{
+						// レイアウトのオフセットはステージング上の確保位置からの相対.
+						auto src_layout = range->upload_layout[i];
+						src_layout.byte_offset += src_offset;
+						p_command_list->CopyTextureRegion(dst_texture.Get(), range->upload_subresource_index[i], p_src, src_layout);
+					}
+					// 常駐済みのMipは旧TextureからGPU上でコピーする. Copy QueueではどちらもCommonからの暗黙の昇格で扱う.
+					for (const auto& e : range->copy_subresource_index)
+					{
+						p_command_list->CopyTextureSubresource(dst_texture.Get(), e.first, src_texture.Get(), e.second);
+					}
+				});
+		}
+
+		ResTexture::~ResTexture()
+		{
+			if (k_invalid_streaming_texture_id != streaming_id_)
+			{
+				TextureStreamingSystem::Instance().Unregister(streaming_id_);
+			}
+		}
+
 		void ResTexture::RenderThreadInitialize(rhi::DeviceDep* p_device, rhi::GraphicsCommandListDep* p_commandlist)
 		{
 			assert(ref_texture_.IsValid());
+
+			// ストリーミング対象はロード時にMip Tailのアップロードを要求済み.
+			if (streaming_source_)
+				return;
 			
 			const rhi::TextureDep::Desc& dst_desc = ref_texture_->GetDesc();
 			// ロードしたMetadataから取得したSubresource数と一致しないのであればどこか間違っている.
@@ -23,6 +200,25 @@ namespace ngl
 			dst_layout.resize(ref_texture_->NumSubresource());
 			// Subresourceのレイアウト情報を取得.
 			ref_texture_->GetSubresourceLayoutInfo(dst_layout.data(), dst_byte_size);
+
+			// 初期ステートがCommonの場合はUploadManagerのステージングリング経由でCopy Queueからコピーする.
+			//	Copy Queueでの Copy Dst への暗黙の昇格と実行後の Common への減衰によりBarrierは不要.
+			//	完了は upload_ticket_ で判定する. 即時アップロード指定の場合は以下のGraphics CommandListでのコピー.
+			if (rhi::EResourceState::Common == dst_desc.initial_state && UploadManager::Instance().IsValid() && !is_upload_immediate_)
+			{
+				// CPU側のアップロード用データは書き込みまで要求側で保持する. vectorのムーブではピクセルメモリは再配置されない.
+				auto source = std::make_shared<TextureUploadSource>();
+				source->pixel_memory = std::move(upload_pixel_memory_);
+				source->subresource_info_array = std::move(upload_subresource_info_array);
+				source->dst_layout = std::move(dst_layout);
+				source->dst_byte_size = dst_byte_size;
+
+				upload_ticket_ = EnqueueTextureUpload(ref_texture_, source, 0, dst_desc.mip_count);
+
+				this->upload_subresource_info_array = {};
+				this->upload_pixel_memory_ = {};
+				return;
+			}
 			
 			rhi::RefBufferDep temporal_upload_buffer = {};
 			u8* p_upload_buffer_memory = {};
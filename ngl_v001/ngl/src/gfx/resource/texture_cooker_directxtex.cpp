@@ -0,0 +1,483 @@
+﻿
+#include "gfx/resource/texture_cooker_directxtex.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "file/file.h"
+#include "gfx/resource/texture_loader_directxtex.h"
+
+
+namespace ngl
+{
+namespace directxtex
+{
+    namespace
+    {
+        constexpr u32 k_texture_cook_version = 1;
+        // メッシュキャッシュと同じディレクトリに配置.
+        constexpr const char* k_texture_cache_dir = "../ngl/data/cache";
+
+        constexpr u64 k_fnv_prime_64 = 1099511628211ULL;
+
+        // ソースのコンテンツハッシュにCook設定を混ぜ込む.
+        u64 CalcCookHash(u64 src_hash, const TextureCookDesc& desc)
+        {
+            const u32 option_bits[] =
+            {
+                k_texture_cook_version,
+                static_cast<u32>(desc.usage),
+                desc.generate_mip ? 1u : 0u,
+                desc.compress ? 1u : 0u,
+            };
+            u64 hash = src_hash;
+            for (const auto v : option_bits)
+            {
+                hash ^= static_cast<u64>(v);
+                hash *= k_fnv_prime_64;
+            }
+            return hash;
+        }
+
+        bool BuildTextureCachePath(const char* src_path, u64 cook_hash, std::filesystem::path& out_path)
+        {
+            if (!src_path || cook_hash == 0)
+                return false;
+
+            std::filesystem::path cache_dir(k_texture_cache_dir);
+            std::error_code ec;
+            std::filesystem::create_directories(cache_dir, ec);
+            if (ec)
+                return false;
+
+            std::string base_name = std::filesystem::path(src_path).filename().string();
+            if (base_name.empty())
+                base_name = "texture";
+            for (char& ch : base_name)
+            {
+                if (ch < 32 || ch == '<' || ch == '>' || ch == ':' || ch == '"' || ch == '/' || ch == '\\' || ch == '|' || ch == '?' || ch == '*' || ch == '.' || ch == ' ')
+                    ch = '_';
+            }
+            char hash_text[32] = {};
+            std::snprintf(hash_text, sizeof(hash_text), "%016llx", static_cast<unsigned long long>(cook_hash));
+            out_path = cache_dir / (base_name + "_" + hash_text + ".texcache.dds");
+            return true;
+        }
+
+        // 用途毎の圧縮フォーマット. sRGBフォーマットのソースはそのままsRGBで保持する.
+        DXGI_FORMAT SelectCompressFormat(ETextureCookUsage usage, DXGI_FORMAT src_format)
+        {
+            switch (usage)
+            {
+            case ETextureCookUsage::Albedo:
+                return DirectX::IsSRGB(src_format) ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+            case ETextureCookUsage::Normal:
+                return DXGI_FORMAT_BC5_UNORM;
+            case ETextureCookUsage::Linear:
+                return DXGI_FORMAT_BC7_UNORM;
+            case ETextureCookUsage::Hdr:
+                return DXGI_FORMAT_BC6H_UF16;
+            default:
+                return DXGI_FORMAT_UNKNOWN;
+            }
+        }
+
+        // 用途毎のMip生成フィルタ. Albedoはリニア空間でフィルタしてからsRGBへ戻す.
+        DirectX::TEX_FILTER_FLAGS SelectMipFilter(ETextureCookUsage usage)
+        {
+            if (ETextureCookUsage::Albedo == usage)
+                return DirectX::TEX_FILTER_BOX | DirectX::TEX_FILTER_SRGB;
+            return DirectX::TEX_FILTER_BOX;
+        }
+
+        bool IsExtension(const char* filename, const char* ext)
+        {
+            std::string file_ext = std::filesystem::path(filename).extension().string();
+            std::transform(file_ext.begin(), file_ext.end(), file_ext.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+            return file_ext == ext;
+        }
+
+        // ソースロード. 読み込み関数はデバイスを利用しないためnullptr.
+        bool LoadSourceImageData(DirectX::ScratchImage& image_data, DirectX::TexMetadata& meta_data, const char* filename)
+        {
+            if (IsExtension(filename, ".dds"))
+                return LoadImageData_DDS(image_data, meta_data, nullptr, filename);
+            if (IsExtension(filename, ".hdr"))
+                return LoadImageData_HDR(image_data, meta_data, nullptr, filename);
+            return LoadImageData_WIC(image_data, meta_data, nullptr, filename);
+        }
+
+        bool CopyScratchImage(DirectX::ScratchImage& dst, const DirectX::ScratchImage& src)
+        {
+            if (FAILED(dst.Initialize(src.GetMetadata())))
+                return false;
+            memcpy(dst.GetPixels(), src.GetPixels(), src.GetPixelsSize());
+            return true;
+        }
+    }
+
+    TextureCookStatistics& GetTextureCookStatistics()
+    {
+        static TextureCookStatistics s_stat = {};
+        return s_stat;
+    }
+
+    void PrintTextureCookStatistics()
+    {
+        const auto& stat = GetTextureCookStatistics();
+        const double src_mb = static_cast<double>(stat.src_byte_size) / (1024.0 * 1024.0);
+        const double cooked_mb = static_cast<double>(stat.cooked_byte_size) / (1024.0 * 1024.0);
+        const double encode_sec = static_cast<double>(stat.encode_micro_sec) * 1e-6;
+        const double mpix_per_sec = (0.0 < encode_sec) ? (static_cast<double>(stat.encode_pixel_count) * 1e-6 / encode_sec) : 0.0;
+
+        std::cout << "[TextureCook] cooked " << stat.cook_count << ", cache hit " << stat.cache_hit_count
+                  << ", " << src_mb << " MB -> " << cooked_mb << " MB (saved " << (src_mb - cooked_mb) << " MB)"
+                  << ", encode " << mpix_per_sec << " MPix/s" << std::endl;
+    }
+
+    bool CookImageData(DirectX::ScratchImage& out_image_data, const DirectX::ScratchImage& src_image_data, const TextureCookDesc& desc)
+    {
+        const DirectX::TexMetadata& src_meta = src_image_data.GetMetadata();
+        const bool is_src_compressed = DirectX::IsCompressed(src_meta.format);
+
+        // Mipチェイン生成. ソースがすでにMipを持つ場合や圧縮済みの場合はそのまま.
+        DirectX::ScratchImage mip_chain = {};
+        const DirectX::ScratchImage* p_work = &src_image_data;
+        if (desc.generate_mip && !is_src_compressed && 1 >= src_meta.mipLevels && !src_meta.IsVolumemap())
+        {
+            if (SUCCEEDED(DirectX::GenerateMipMaps(src_image_data.GetImages(), src_image_data.GetImageCount(), src_meta, SelectMipFilter(desc.usage), 0, mip_chain)))
+            {
+                p_work = &mip_chain;
+            }
+            else
+            {
+                std::cout << "[WARNING][CookImageData] GenerateMipMaps failed." << std::endl;
+            }
+        }
+
+        const DirectX::TexMetadata& work_meta = p_work->GetMetadata();
+        const DXGI_FORMAT compress_format = SelectCompressFormat(desc.usage, work_meta.format);
+        // BCフォーマットはMip0が4の倍数である必要がある.
+        const bool can_compress = desc.compress && !is_src_compressed && (DXGI_FORMAT_UNKNOWN != compress_format) && (0 == (work_meta.width & 3)) && (0 == (work_meta.height & 3));
+        if (!can_compress)
+        {
+            if (p_work == &mip_chain)
+            {
+                out_image_data = std::move(mip_chain);
+                return true;
+            }
+            return CopyScratchImage(out_image_data, src_image_data);
+        }
+
+        // ブロック圧縮. TEX_COMPRESS_PARALLEL でDirectXTex内部のOpenMPによるマルチスレッドSIMDエンコードを有効化.
+        const auto encode_begin = std::chrono::steady_clock::now();
+        const DirectX::TEX_COMPRESS_FLAGS compress_flags = DirectX::TEX_COMPRESS_PARALLEL;
+        if (FAILED(DirectX::Compress(p_work->GetImages(), p_work->GetImageCount(), work_meta, compress_format, compress_flags, DirectX::TEX_THRESHOLD_DEFAULT, out_image_data)))
+        {
+            std::cout << "[WARNING][CookImageData] Compress failed." << std::endl;
+            if (p_work == &mip_chain)
+            {
+                out_image_data = std::move(mip_chain);
+                return true;
+            }
+            return CopyScratchImage(out_image_data, src_image_data);
+        }
+        const auto encode_end = std::chrono::steady_clock::now();
+
+        // 統計.
+        {
+            u64 pixel_count = 0;
+            for (size_t i = 0; i < p_work->GetImageCount(); ++i)
+            {
+                pixel_count += static_cast<u64>(p_work->GetImages()[i].width) * static_cast<u64>(p_work->GetImages()[i].height);
+            }
+            auto& stat = GetTextureCookStatistics();
+            stat.encode_pixel_count += pixel_count;
+            stat.encode_micro_sec += static_cast<u64>(std::chrono::duration_cast<std::chrono::microseconds>(encode_end - encode_begin).count());
+        }
+        return true;
+    }
+
+    bool LoadImageData_Cooked(DirectX::ScratchImage& image_data, DirectX::TexMetadata& meta_data, const char* filename, const TextureCookDesc& desc, TextureCookCacheFile* p_out_cache_file)
+    {
+        assert(ETextureCookUsage::None != desc.usage);
+
+        image_data = {};
+        meta_data = {};
+        if (p_out_cache_file)
+            *p_out_cache_file = {};
+
+        // ピクセルはDDSファイルの末尾に詰めて格納されている.
+        const auto SetCacheFile = [&image_data, p_out_cache_file](const std::filesystem::path& path, u64 file_byte_size)
+        {
+            if (p_out_cache_file && image_data.GetPixelsSize() <= file_byte_size)
+            {
+                p_out_cache_file->path = path.string();
+                p_out_cache_file->pixel_byte_offset = file_byte_size - image_data.GetPixelsSize();
+            }
+        };
+
+        auto& stat = GetTextureCookStatistics();
+
+        const u64 src_hash = file::CalcFileHashFNV1a64(filename);
+        if (0 == src_hash)
+            return false;
+        const u64 cook_hash = CalcCookHash(src_hash, desc);
+
+        std::filesystem::path cache_path;
+        const bool is_valid_cache_path = BuildTextureCachePath(filename, cook_hash, cache_path);
+        if (is_valid_cache_path)
+        {
+            // キャッシュ検索.
+            std::vector<u8> cache_data;
+            if (file::ReadFileToBuffer(cache_path.string().c_str(), cache_data))
+            {
+                if (SUCCEEDED(DirectX::LoadFromDDSMemory(cache_data.data(), cache_data.size(), DirectX::DDS_FLAGS_NONE, &meta_data, image_data)))
+                {
+                    ++stat.cache_hit_count;
+                    SetCacheFile(cache_path, cache_data.size());
+                    return true;
+                }
+            }
+        }
+
+        // ソースロード.
+        DirectX::ScratchImage src_image_data;
+        DirectX::TexMetadata src_meta_data;
+        if (!LoadSourceImageData(src_image_data, src_meta_data, filename))
+            return false;
+
+        const u64 encode_pixel_count_begin = stat.encode_pixel_count;
+        const u64 encode_micro_sec_begin = stat.encode_micro_sec;
+        if (!CookImageData(image_data, src_image_data, desc))
+            return false;
+        meta_data = image_data.GetMetadata();
+
+        // 統計とログ.
+        {
+            // ソース側は非圧縮でMipを含めた場合のサイズで比較する.
+            u64 src_byte_size = 0;
+            {
+                const DirectX::TexMetadata& m = image_data.GetMetadata();
+                for (size_t item = 0; item < m.arraySize; ++item)
+                {
+                    for (size_t mip = 0; mip < m.mipLevels; ++mip)
+                    {
+                        size_t row_pitch = 0, slice_pitch = 0;
+                        const size_t w = std::max<size_t>(1, m.width >> mip);
+                        const size_t h = std::max<size_t>(1, m.height >> mip);
+                        if (SUCCEEDED(DirectX::ComputePitch(src_meta_data.format, w, h, row_pitch, slice_pitch)))
+                            src_byte_size += slice_pitch * std::max<size_t>(1, m.depth >> mip);
+                    }
+                }
+            }
+            const u64 cooked_byte_size = image_data.GetPixelsSize();
+            ++stat.cook_count;
+            stat.src_byte_size += src_byte_size;
+            stat.cooked_byte_size += cooked_byte_size;
+
+            const u64 encode_pixel_count = stat.encode_pixel_count - encode_pixel_count_begin;
+            const u64 encode_micro_sec = stat.encode_micro_sec - encode_micro_sec_begin;
+            const double mpix_per_sec = (0 < encode_micro_sec) ? (static_cast<double>(encode_pixel_count) / static_cast<double>(encode_micro_sec)) : 0.0;
+            std::cout << "[TextureCook] " << filename << " : " << (src_byte_size / 1024) << " KB -> " << (cooked_byte_size / 1024) << " KB"
+                      << " (mip " << meta_data.mipLevels << ", encode " << mpix_per_sec << " MPix/s)" << std::endl;
+        }
+
+        // キャッシュ保存.
+        if (is_valid_cache_path)
+        {
+            DirectX::Blob blob;
+            if (SUCCEEDED(DirectX::SaveToDDSMemory(image_data.GetImages(), image_data.GetImageCount(), meta_data, DirectX::DDS_FLAGS_NONE, blob)))
+            {
+                if (file::WriteFileFromBuffer(cache_path.string().c_str(), blob.GetBufferPointer(), blob.GetBufferSize()))
+                    SetCacheFile(cache_path, blob.GetBufferSize());
+            }
+        }
+
+        return true;
+    }
+
+    bool LoadImageData_Float4(DirectX::ScratchImage& image_data, const char* filename)
+    {
+        image_data = {};
+
+        DirectX::ScratchImage src_image_data;
+        DirectX::TexMetadata src_meta_data;
+        if (!LoadSourceImageData(src_image_data, src_meta_data, filename))
+            return false;
+
+        constexpr DXGI_FORMAT k_float4_format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+        if (k_float4_format == src_meta_data.format)
+        {
+            image_data = std::move(src_image_data);
+            return true;
+        }
+        if (DirectX::IsCompressed(src_meta_data.format))
+            return SUCCEEDED(DirectX::Decompress(src_image_data.GetImages(), src_image_data.GetImageCount(), src_meta_data, k_float4_format, image_data));
+        return SUCCEEDED(DirectX::Convert(src_image_data.GetImages(), src_image_data.GetImageCount(), src_meta_data, k_float4_format, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, image_data));
+    }
+
+    void TestTextureCook()
+    {
+        bool is_ok = true;
+
+        // 64x64のグラデーション. Mipは7段.
+        constexpr u32 k_size = 64;
+        constexpr size_t k_mip_count = 7;
+        const auto GenerateImage = [](DirectX::ScratchImage& out_image, DXGI_FORMAT format) -> bool
+        {
+            if (FAILED(out_image.Initialize2D(format, k_size, k_size, 1, 1)))
+                return false;
+            const DirectX::Image* p_image = out_image.GetImage(0, 0, 0);
+            for (u32 y = 0; y < k_size; ++y)
+            {
+                u8* p_row = p_image->pixels + p_image->rowPitch * y;
+                for (u32 x = 0; x < k_size; ++x)
+                {
+                    if (DXGI_FORMAT_R32G32B32A32_FLOAT == format)
+                    {
+                        float* p_pixel = reinterpret_cast<float*>(p_row) + x * 4;
+                        p_pixel[0] = static_cast<float>(x) * 0.25f;
+                        p_pixel[1] = static_cast<float>(y) * 0.25f;
+                        p_pixel[2] = 1.0f;
+                        p_pixel[3] = 1.0f;
+                    }
+                    else
+                    {
+                        u8* p_pixel = p_row + x * 4;
+                        p_pixel[0] = static_cast<u8>(x * 4);
+                        p_pixel[1] = static_cast<u8>(y * 4);
+                        p_pixel[2] = static_cast<u8>((x ^ y) * 4);
+                        p_pixel[3] = 255;
+                    }
+                }
+            }
+            return true;
+        };
+
+        // 用途毎のMip生成と圧縮フォーマット.
+        {
+            struct CookCase
+            {
+                ETextureCookUsage usage;
+                DXGI_FORMAT src_format;
+                DXGI_FORMAT expect_format;
+            };
+            const CookCase cook_case[] =
+            {
+                { ETextureCookUsage::None, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM },
+                { ETextureCookUsage::Albedo, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, DXGI_FORMAT_BC7_UNORM_SRGB },
+                { ETextureCookUsage::Albedo, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_BC7_UNORM },
+                { ETextureCookUsage::Normal, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_BC5_UNORM },
+                { ETextureCookUsage::Linear, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_BC7_UNORM },
+                { ETextureCookUsage::Hdr, DXGI_FORMAT_R32G32B32A32_FLOAT, DXGI_FORMAT_BC6H_UF16 },
+            };
+            for (const auto& e : cook_case)
+            {
+                DirectX::ScratchImage src_image;
+                is_ok &= GenerateImage(src_image, e.src_format);
+
+                TextureCookDesc desc = {};
+                desc.usage = e.usage;
+                DirectX::ScratchImage cooked_image;
+                is_ok &= CookImageData(cooked_image, src_image, desc);
+                is_ok &= (k_mip_count == cooked_image.GetMetadata().mipLevels) && (e.expect_format == cooked_image.GetMetadata().format);
+
+                // Mip生成と圧縮の無効化.
+                desc.generate_mip = false;
+                desc.compress = false;
+                DirectX::ScratchImage raw_image;
+                is_ok &= CookImageData(raw_image, src_image, desc);
+                is_ok &= (1 == raw_image.GetMetadata().mipLevels) && (e.src_format == raw_image.GetMetadata().format);
+            }
+        }
+
+        // Cook設定の変更はキャッシュミスとなり再Cookする. 同一設定はキャッシュヒット.
+        {
+            const std::filesystem::path src_path = std::filesystem::path(k_texture_cache_dir) / "test_texture_cook_src.dds";
+            std::error_code ec;
+            std::filesystem::create_directories(src_path.parent_path(), ec);
+
+            DirectX::ScratchImage src_image;
+            is_ok &= GenerateImage(src_image, DXGI_FORMAT_R8G8B8A8_UNORM);
+            is_ok &= SUCCEEDED(DirectX::SaveToDDSFile(src_image.GetImages(), src_image.GetImageCount(), src_image.GetMetadata(), DirectX::DDS_FLAGS_NONE, src_path.wstring().c_str()));
+
+            TextureCookDesc desc_a = {};
+            desc_a.usage = ETextureCookUsage::Linear;
+            TextureCookDesc desc_b = desc_a;
+            desc_b.usage = ETextureCookUsage::Normal;
+            TextureCookDesc desc_c = desc_a;
+            desc_c.generate_mip = false;
+
+            // 前回実行のキャッシュを削除.
+            const u64 src_hash = file::CalcFileHashFNV1a64(src_path.string().c_str());
+            is_ok &= (0 != src_hash);
+            std::vector<std::filesystem::path> cache_path_array;
+            for (const auto* p_desc : { &desc_a, &desc_b, &desc_c })
+            {
+                std::filesystem::path cache_path;
+                if (BuildTextureCachePath(src_path.string().c_str(), CalcCookHash(src_hash, *p_desc), cache_path))
+                {
+                    std::filesystem::remove(cache_path, ec);
+                    cache_path_array.push_back(cache_path);
+                }
+            }
+            // Cook設定毎に異なるキャッシュとなる.
+            is_ok &= (3 == cache_path_array.size()) && (cache_path_array[0] != cache_path_array[1]) && (cache_path_array[0] != cache_path_array[2]);
+
+            const auto& stat = GetTextureCookStatistics();
+            const auto LoadCooked = [&src_path](const TextureCookDesc& desc, DirectX::TexMetadata& out_meta) -> bool
+            {
+                DirectX::ScratchImage image;
+                return LoadImageData_Cooked(image, out_meta, src_path.string().c_str(), desc);
+            };
+            DirectX::TexMetadata meta = {};
+            const u64 cook_count_begin = stat.cook_count;
+            const u64 cache_hit_count_begin = stat.cache_hit_count;
+
+            is_ok &= LoadCooked(desc_a, meta) && (DXGI_FORMAT_BC7_UNORM == meta.format) && (k_mip_count == meta.mipLevels);
+            is_ok &= (cook_count_begin + 1 == stat.cook_count) && (cache_hit_count_begin == stat.cache_hit_count);
+            is_ok &= LoadCooked(desc_a, meta) && (DXGI_FORMAT_BC7_UNORM == meta.format) && (k_mip_count == meta.mipLevels);
+            is_ok &= (cook_count_begin + 1 == stat.cook_count) && (cache_hit_count_begin + 1 == stat.cache_hit_count);
+            is_ok &= LoadCooked(desc_b, meta) && (DXGI_FORMAT_BC5_UNORM == meta.format);
+            is_ok &= (cook_count_begin + 2 == stat.cook_count) && (cache_hit_count_begin + 1 == stat.cache_hit_count);
+            is_ok &= LoadCooked(desc_c, meta) && (1 == meta.mipLevels);
+            is_ok &= (cook_count_begin + 3 == stat.cook_count) && (cache_hit_count_begin + 1 == stat.cache_hit_count);
+
+            // キャッシュファイル上のピクセル位置. Cook時とキャッシュヒット時のどちらも, その位置から読み込んだ全Mipがロード結果と一致する.
+            const auto IsCacheFilePixelMatch = [&src_path, &desc_a, &cache_path_array]() -> bool
+            {
+                DirectX::ScratchImage image;
+                DirectX::TexMetadata image_meta = {};
+                TextureCookCacheFile cache_file = {};
+                if (!LoadImageData_Cooked(image, image_meta, src_path.string().c_str(), desc_a, &cache_file))
+                    return false;
+                if (!cache_file.IsValid() || std::filesystem::path(cache_file.path) != cache_path_array[0])
+                    return false;
+                std::vector<u8> file_pixel(image.GetPixelsSize());
+                if (!file::ReadFileRange(cache_file.path.c_str(), cache_file.pixel_byte_offset, file_pixel.data(), file_pixel.size()))
+                    return false;
+                return 0 == memcmp(file_pixel.data(), image.GetPixels(), file_pixel.size());
+            };
+            std::filesystem::remove(cache_path_array[0], ec);
+            is_ok &= IsCacheFilePixelMatch() && (cook_count_begin + 4 == stat.cook_count);
+            is_ok &= IsCacheFilePixelMatch() && (cache_hit_count_begin + 2 == stat.cache_hit_count);
+
+            for (const auto& e : cache_path_array)
+                std::filesystem::remove(e, ec);
+            std::filesystem::remove(src_path, ec);
+        }
+
+        std::cout << "[TestTextureCook]";
+        std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+        assert(is_ok);
+    }
+}
+}
@@ -0,0 +1,445 @@
+﻿
+#include "gfx/resource/texture_streaming.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <utility>
+
+namespace ngl
+{
+namespace gfx
+{
+    void TextureStreamingManager::Initialize(const TextureStreamingConfig& config, ITextureStreamingBackend* p_backend)
+    {
+        assert(p_backend);
+        config_ = config;
+        p_backend_ = p_backend;
+
+        entry_array_.clear();
+        free_id_array_.clear();
+        frame_index_ = 1;
+        stat_ = {};
+    }
+    void TextureStreamingManager::Finalize()
+    {
+        entry_array_.clear();
+        free_id_array_.clear();
+        p_backend_ = nullptr;
+        stat_ = {};
+    }
+
+    bool TextureStreamingManager::IsValidId(StreamingTextureId id) const
+    {
+        return (id < entry_array_.size()) && entry_array_[id].is_valid;
+    }
+
+    u64 TextureStreamingManager::CalcMipRangeByte(const Entry& e, u32 top_mip, u32 end_mip) const
+    {
+        u64 total = 0;
+        for (u32 mip = top_mip; mip < end_mip && mip < e.mip_byte_size.size(); ++mip)
+            total += e.mip_byte_size[mip];
+        return total;
+    }
+
+    StreamingTextureId TextureStreamingManager::Register(const StreamingTextureDesc& desc)
+    {
+        assert(0 < desc.mip_byte_size.size());
+
+        StreamingTextureId id = k_invalid_streaming_texture_id;
+        if (!free_id_array_.empty())
+        {
+            id = free_id_array_.back();
+            free_id_array_.pop_back();
+        }
+        else
+        {
+            id = static_cast<StreamingTextureId>(entry_array_.size());
+            entry_array_.push_back({});
+        }
+
+        const u32 mip_count = static_cast<u32>(desc.mip_byte_size.size());
+        auto& e = entry_array_[id];
+        e = {};
+        e.is_valid = true;
+        e.mip_byte_size = desc.mip_byte_size;
+        e.tail_top_mip = CalcTailTopMip(mip_count);
+        e.resident_top_mip = e.tail_top_mip;
+        e.pending_top_mip = e.tail_top_mip;
+        e.requested_top_mip = e.tail_top_mip;
+        e.last_request_frame = frame_index_;
+
+        stat_.resident_byte += CalcMipRangeByte(e, e.tail_top_mip, mip_count);
+        return id;
+    }
+
+    void TextureStreamingManager::Unregister(StreamingTextureId id)
+    {
+        if (!IsValidId(id))
+            return;
+
+        auto& e = entry_array_[id];
+        const u32 mip_count = static_cast<u32>(e.mip_byte_size.size());
+        stat_.resident_byte -= CalcMipRangeByte(e, e.resident_top_mip, mip_count);
+        stat_.pending_byte -= CalcMipRangeByte(e, e.pending_top_mip, e.resident_top_mip);
+
+        e = {};
+        free_id_array_.push_back(id);
+    }
+
+    void TextureStreamingManager::RequestMip(StreamingTextureId id, float required_mip)
+    {
+        if (!IsValidId(id))
+            return;
+
+        auto& e = entry_array_[id];
+        // Mip Tailより粗い要求はMip Tailに丸める.
+        const u32 mip = std::min(static_cast<u32>(std::max(0.0f, std::floor(required_mip))), e.tail_top_mip);
+        if (e.last_request_frame != frame_index_)
+        {
+            e.requested_top_mip = mip;
+            e.last_request_frame = frame_index_;
+        }
+        else
+        {
+            e.requested_top_mip = std::min(e.requested_top_mip, mip);
+        }
+    }
+
+    void TextureStreamingManager::SetMemoryBudget(u64 memory_budget_byte)
+    {
+        config_.memory_budget_byte = memory_budget_byte;
+    }
+
+    void TextureStreamingManager::EvictTopMip(StreamingTextureId id)
+    {
+        auto& e = entry_array_[id];
+        assert(e.resident_top_mip < e.tail_top_mip);
+        assert(e.resident_top_mip == e.pending_top_mip);
+
+        const u32 new_top_mip = e.resident_top_mip + 1;
+        p_backend_->RequestEvict(id, new_top_mip, e.resident_top_mip);
+
+        stat_.resident_byte -= e.mip_byte_size[e.resident_top_mip];
+        e.resident_top_mip = new_top_mip;
+        e.pending_top_mip = new_top_mip;
+        ++stat_.evict_count;
+    }
+
+    bool TextureStreamingManager::EvictForBudget(u64 require_byte, StreamingTextureId exclude_id)
+    {
+        while (stat_.resident_byte + stat_.pending_byte + require_byte > config_.memory_budget_byte)
+        {
+            // 解放対象の選択.
+            //  1. 今フレーム要求されているが要求以上のMipが常駐しているもの (超過分).
+            //  2. 今フレーム要求されていないもののうち, 最後の要求が最も古いもの (LRU).
+            StreamingTextureId victim = k_invalid_streaming_texture_id;
+            bool victim_is_excess = false;
+            u64 victim_last_request = ~0ull;
+            for (StreamingTextureId id = 0; id < entry_array_.size(); ++id)
+            {
+                const auto& e = entry_array_[id];
+                if (!e.is_valid || id == exclude_id)
+                    continue;
+                if (e.pending_top_mip != e.resident_top_mip || e.resident_top_mip >= e.tail_top_mip)
+                    continue;
+
+                const bool is_requested = (e.last_request_frame == frame_index_);
+                const bool is_excess = is_requested && (e.resident_top_mip < e.requested_top_mip);
+                if (is_requested && !is_excess)
+                    continue;
+
+                if (is_excess)
+                {
+                    if (!victim_is_excess)
+                    {
+                        victim = id;
+                        victim_is_excess = true;
+                    }
+                }
+                else if (!victim_is_excess && e.last_request_frame < victim_last_request)
+                {
+                    victim = id;
+                    victim_last_request = e.last_request_frame;
+                }
+            }
+
+            if (k_invalid_streaming_texture_id == victim)
+                return false;
+            EvictTopMip(victim);
+        }
+        return true;
+    }
+
+    void TextureStreamingManager::Update()
+    {
+        assert(p_backend_);
+
+        stat_.upload_byte_this_frame = 0;
+        stat_.upload_request_count = 0;
+        stat_.evict_count = 0;
+        stat_.waiting_request_count = 0;
+
+        // 予算変更などで超過している場合は先に予算内に収める.
+        EvictForBudget(0, k_invalid_streaming_texture_id);
+
+        // 今フレーム要求があり, 常駐Mipが不足しているものを候補にする.
+        work_candidate_.clear();
+        for (StreamingTextureId id = 0; id < entry_array_.size(); ++id)
+        {
+            const auto& e = entry_array_[id];
+            if (!e.is_valid || e.last_request_frame != frame_index_)
+                continue;
+            if (e.pending_top_mip != e.resident_top_mip)
+                continue;// アップロード中.
+            if (e.requested_top_mip < e.resident_top_mip)
+                work_candidate_.push_back(id);
+        }
+
+        // 優先度: 要求に対する不足Mip数が大きいものから. 各テクスチャは1フレームで1段ずつ要求するため, 全体で低解像度側から順に埋まる.
+        std::sort(work_candidate_.begin(), work_candidate_.end(), [this](StreamingTextureId a, StreamingTextureId b)
+        {
+            const auto& ea = entry_array_[a];
+            const auto& eb = entry_array_[b];
+            const u32 deficit_a = ea.resident_top_mip - ea.requested_top_mip;
+            const u32 deficit_b = eb.resident_top_mip - eb.requested_top_mip;
+            if (deficit_a != deficit_b)
+                return deficit_a > deficit_b;
+            // 同じ不足数なら粗いMipが不足しているもの(次のアップロードが小さいもの)を優先.
+            if (ea.resident_top_mip != eb.resident_top_mip)
+                return ea.resident_top_mip > eb.resident_top_mip;
+            return a < b;
+        });
+
+        for (const auto id : work_candidate_)
+        {
+            auto& e = entry_array_[id];
+            const u32 next_top_mip = e.resident_top_mip - 1;
+            const u64 upload_byte = e.mip_byte_size[next_top_mip];
+
+            // フレーム毎のアップロード上限. 1件目は上限を超える大きさでも許可する.
+            if (0 < stat_.upload_byte_this_frame && stat_.upload_byte_this_frame + upload_byte > config_.max_upload_byte_per_frame)
+            {
+                ++stat_.waiting_request_count;
+                continue;
+            }
+            // メモリ予算.
+            if (!EvictForBudget(upload_byte, id))
+            {
+                ++stat_.waiting_request_count;
+                continue;
+            }
+            if (!p_backend_->RequestUpload(id, next_top_mip, e.resident_top_mip))
+            {
+                ++stat_.waiting_request_count;
+                continue;
+            }
+
+            e.pending_top_mip = next_top_mip;
+            stat_.pending_byte += upload_byte;
+            stat_.upload_byte_this_frame += upload_byte;
+            ++stat_.upload_request_count;
+        }
+
+        stat_.is_over_budget = (stat_.resident_byte + stat_.pending_byte > config_.memory_budget_byte);
+
+        ++frame_index_;
+    }
+
+    void TextureStreamingManager::NotifyUploadComplete(StreamingTextureId id, u32 top_mip)
+    {
+        if (!IsValidId(id))
+            return;
+
+        auto& e = entry_array_[id];
+        // Unregister後に同じIDが再利用された場合などの不一致は無視.
+        if (e.pending_top_mip != top_mip || top_mip >= e.resident_top_mip)
+            return;
+
+        const u64 byte = CalcMipRangeByte(e, top_mip, e.resident_top_mip);
+        stat_.pending_byte -= byte;
+        stat_.resident_byte += byte;
+        e.resident_top_mip = top_mip;
+    }
+
+    u32 TextureStreamingManager::CalcTailTopMip(u32 mip_count) const
+    {
+        return (mip_count > config_.mip_tail_count) ? (mip_count - config_.mip_tail_count) : 0;
+    }
+    u32 TextureStreamingManager::GetResidentTopMip(StreamingTextureId id) const
+    {
+        return IsValidId(id) ? entry_array_[id].resident_top_mip : 0;
+    }
+    u32 TextureStreamingManager::GetRequestedTopMip(StreamingTextureId id) const
+    {
+        return IsValidId(id) ? entry_array_[id].requested_top_mip : 0;
+    }
+    bool TextureStreamingManager::IsPending(StreamingTextureId id) const
+    {
+        return IsValidId(id) && (entry_array_[id].pending_top_mip != entry_array_[id].resident_top_mip);
+    }
+
+    float TextureStreamingManager::CalcRequiredMip(float texture_size, float uv_per_world_unit, float distance, float screen_height, float fov_y_radian)
+    {
+        if (0.0f >= distance || 0.0f >= screen_height)
+            return 0.0f;
+
+        // 距離distanceでのワールド単位長あたりの画面ピクセル数.
+        const float pixel_per_world_unit = screen_height / (2.0f * distance * std::tan(fov_y_radian * 0.5f));
+        // ワールド単位長あたりのテクセル数.
+        const float texel_per_world_unit = texture_size * uv_per_world_unit;
+        if (0.0f >= pixel_per_world_unit || 0.0f >= texel_per_world_unit)
+            return 0.0f;
+
+        return std::max(0.0f, std::log2(texel_per_world_unit / pixel_per_world_unit));
+    }
+
+    namespace
+    {
+        // 要求を記録するだけのバックエンド. 完了はテスト側から通知する.
+        class MockTextureStreamingBackend : public ITextureStreamingBackend
+        {
+        public:
+            bool RequestUpload(StreamingTextureId id, u32 new_top_mip, u32 /*current_top_mip*/) override
+            {
+                upload_array.push_back({ id, new_top_mip });
+                return true;
+            }
+            void RequestEvict(StreamingTextureId id, u32 new_top_mip, u32 /*current_top_mip*/) override
+            {
+                evict_array.push_back({ id, new_top_mip });
+            }
+            // 受け付けたアップロードを全て完了させる.
+            void CompleteAll(TextureStreamingManager& manager)
+            {
+                for (const auto& e : upload_array)
+                    manager.NotifyUploadComplete(e.first, e.second);
+                upload_array.clear();
+            }
+
+            std::vector<std::pair<StreamingTextureId, u32>> upload_array;
+            std::vector<std::pair<StreamingTextureId, u32>> evict_array;
+        };
+    }
+
+    void TestTextureStreaming()
+    {
+        bool is_ok = true;
+
+        // 8Mip. Mip0が最大で, Mip毎に1/4.
+        StreamingTextureDesc desc = {};
+        for (u32 mip = 0; mip < 8; ++mip)
+            desc.mip_byte_size.push_back(16ull << (2 * (7 - mip)));
+        constexpr u64 k_tail_byte = 1024 + 256 + 64 + 16;
+        constexpr u64 k_mip3_byte = 4096;
+
+        // 低解像度Mipから1段ずつロードする.
+        {
+            MockTextureStreamingBackend backend;
+            TextureStreamingManager manager;
+            manager.Initialize({ ~0ull, ~0ull, 4 }, &backend);
+
+            const auto id = manager.Register(desc);
+            is_ok &= (4 == manager.CalcTailTopMip(8)) && (4 == manager.GetResidentTopMip(id));
+            is_ok &= (k_tail_byte == manager.GetStatistics().resident_byte);
+
+            for (u32 expect_mip = 4; expect_mip-- > 0;)
+            {
+                manager.RequestMip(id, 0.0f);
+                manager.Update();
+                is_ok &= (1 == backend.upload_array.size()) && (id == backend.upload_array[0].first) && (expect_mip == backend.upload_array[0].second);
+                is_ok &= manager.IsPending(id);
+
+                // アップロード中は次の要求を出さない.
+                manager.RequestMip(id, 0.0f);
+                manager.Update();
+                is_ok &= (1 == backend.upload_array.size());
+
+                backend.CompleteAll(manager);
+                is_ok &= (expect_mip == manager.GetResidentTopMip(id)) && !manager.IsPending(id);
+            }
+            is_ok &= (0 == manager.GetStatistics().pending_byte);
+            u64 total_byte = 0;
+            for (auto byte : desc.mip_byte_size)
+                total_byte += byte;
+            is_ok &= (total_byte == manager.GetStatistics().resident_byte);
+        }
+
+        // 要求に対する不足Mip数が大きいものを優先する.
+        {
+            MockTextureStreamingBackend backend;
+            TextureStreamingManager manager;
+            manager.Initialize({ ~0ull, k_mip3_byte, 4 }, &backend);
+
+            const auto id_a = manager.Register(desc);
+            const auto id_b = manager.Register(desc);
+
+            // 不足数はBが1, Aが4. フレーム上限で1件のみ.
+            manager.RequestMip(id_b, 3.0f);
+            manager.RequestMip(id_a, 0.0f);
+            manager.Update();
+            is_ok &= (1 == backend.upload_array.size()) && (id_a == backend.upload_array[0].first);
+            is_ok &= (1 == manager.GetStatistics().waiting_request_count);
+            backend.CompleteAll(manager);
+
+            // 上限を超える大きさでも1件目は許可し, 不足数の大きいAを優先し続ける.
+            manager.RequestMip(id_b, 3.0f);
+            manager.RequestMip(id_a, 0.0f);
+            manager.Update();
+            is_ok &= (1 == backend.upload_array.size()) && (id_a == backend.upload_array[0].first) && (2 == backend.upload_array[0].second);
+            backend.CompleteAll(manager);
+
+            // Aの要求が無くなればBが選ばれる.
+            manager.RequestMip(id_b, 3.0f);
+            manager.Update();
+            is_ok &= (1 == backend.upload_array.size()) && (id_b == backend.upload_array[0].first);
+        }
+
+        // 予算超過時は要求以上に常駐している超過分, 次に最後の要求が古いもの(LRU)から解放する.
+        {
+            MockTextureStreamingBackend backend;
+            TextureStreamingManager manager;
+            manager.Initialize({ k_tail_byte * 4 + k_mip3_byte * 3, ~0ull, 4 }, &backend);
+
+            const auto id_a = manager.Register(desc);
+            const auto id_b = manager.Register(desc);
+            const auto id_c = manager.Register(desc);
+            const auto id_d = manager.Register(desc);
+
+            // D, A, B の順に要求してMip3まで常駐させ, 予算を使い切る.
+            for (const auto id : { id_d, id_a, id_b })
+            {
+                manager.RequestMip(id, 3.0f);
+                manager.Update();
+                backend.CompleteAll(manager);
+            }
+            is_ok &= (k_tail_byte * 4 + k_mip3_byte * 3 == manager.GetStatistics().resident_byte);
+            is_ok &= backend.evict_array.empty();
+
+            // Bは要求以上に常駐しているため, より古いA,Dよりも先に解放される.
+            manager.RequestMip(id_b, 4.0f);
+            manager.RequestMip(id_c, 3.0f);
+            manager.Update();
+            is_ok &= (1 == backend.evict_array.size()) && (id_b == backend.evict_array[0].first) && (4 == backend.evict_array[0].second);
+            is_ok &= (1 == backend.upload_array.size()) && (id_c == backend.upload_array[0].first);
+            backend.CompleteAll(manager);
+
+            // 超過分が無ければ最後の要求が最も古いDから. 今フレーム要求されたCは解放しない.
+            manager.RequestMip(id_c, 3.0f);
+            manager.RequestMip(id_b, 3.0f);
+            manager.Update();
+            is_ok &= (2 == backend.evict_array.size()) && (id_d == backend.evict_array[1].first);
+            is_ok &= (1 == backend.upload_array.size()) && (id_b == backend.upload_array[0].first);
+            backend.CompleteAll(manager);
+
+            is_ok &= (3 == manager.GetResidentTopMip(id_a)) && (3 == manager.GetResidentTopMip(id_b)) && (3 == manager.GetResidentTopMip(id_c)) && (4 == manager.GetResidentTopMip(id_d));
+            is_ok &= !manager.GetStatistics().is_over_budget;
+        }
+
+        std::cout << "[TestTextureStreaming]";
+        std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+        assert(is_ok);
+    }
+}
+}
@@ -0,0 +1,204 @@
+﻿#include "gfx/resource/texture_streaming_system.h"
+
+#include <cassert>
+#include <iostream>
+
+#include "gfx/resource/resource_texture.h"
+#include "framework/gfx_render_command_manager.h"
+
+namespace ngl
+{
+namespace gfx
+{
+    bool TextureStreamingSystem::Initialize(rhi::DeviceDep* p_device, const TextureStreamingConfig& config)
+    {
+        assert(p_device);
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        manager_.Initialize(config, this);
+        p_device_ = p_device;
+        return true;
+    }
+    void TextureStreamingSystem::Finalize()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        manager_.Finalize();
+        entry_array_.clear();
+        p_device_ = nullptr;
+    }
+
+    u32 TextureStreamingSystem::CalcTailTopMip(u32 mip_count) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return manager_.CalcTailTopMip(mip_count);
+    }
+
+    StreamingTextureId TextureStreamingSystem::Register(ResTexture* p_texture)
+    {
+        assert(p_texture && p_texture->ref_texture_.IsValid() && p_texture->streaming_source_);
+        // ref_texture_ はMip Tailのみのため, 全Mipのdescを利用する.
+        const auto& tex_desc = p_texture->streaming_source_->desc;
+        const u32 mip_count = static_cast<u32>(tex_desc.mip_count);
+
+        StreamingTextureDesc desc = {};
+        desc.width = static_cast<u32>(tex_desc.width);
+        desc.height = static_cast<u32>(tex_desc.height);
+        desc.mip_byte_size.resize(mip_count, 0);
+        for (const auto& info : p_texture->streaming_source_->subresource_info_array)
+        {
+            desc.mip_byte_size[info.mip_index] += static_cast<u64>(info.slicePitch);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!IsValid())
+            return k_invalid_streaming_texture_id;
+
+        const StreamingTextureId id = manager_.Register(desc);
+        if (entry_array_.size() <= id)
+            entry_array_.resize(id + 1);
+        auto& e = entry_array_[id];
+        e = {};
+        e.p_texture = p_texture;
+        // 登録時のTextureはMip Tailのみ. Mip Tailのアップロード完了までは再生成のコピー元にしないため処理中として扱う.
+        e.latest_texture = p_texture->ref_texture_;
+        e.latest_top_mip = manager_.GetResidentTopMip(id);
+        e.ticket = p_texture->upload_ticket_;
+        return id;
+    }
+    void TextureStreamingSystem::Unregister(StreamingTextureId id)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Finalize後に破棄されたResTextureからの呼び出しは無視.
+        if (entry_array_.size() <= id)
+            return;
+
+        manager_.Unregister(id);
+        // 処理中の再生成はUploadManagerの要求がTextureを保持するため, ここでは参照を外すのみ.
+        entry_array_[id] = {};
+    }
+
+    void TextureStreamingSystem::RequestMip(StreamingTextureId id, float required_mip)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entry_array_.size() <= id)
+            return;
+        manager_.RequestMip(id, required_mip);
+    }
+
+    void TextureStreamingSystem::Update()
+    {
+        std::vector<ViewUpdate> view_update = {};
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!IsValid())
+                return;
+
+            // GPUでのコピーが完了した再生成を反映する. 新しいTextureへ切り替え, アップロードであれば常駐扱いにする.
+            auto& upload_manager = UploadManager::Instance();
+            for (StreamingTextureId id = 0; id < static_cast<StreamingTextureId>(entry_array_.size()); ++id)
+            {
+                auto& e = entry_array_[id];
+                if (!e.p_texture || 0 == e.ticket || !upload_manager.IsUploadComplete(e.ticket))
+                    continue;
+                if (e.op_texture.IsValid())
+                {
+                    if (e.op_is_upload)
+                        manager_.NotifyUploadComplete(id, e.op_top_mip);
+                    e.latest_texture = e.op_texture;
+                    e.latest_top_mip = e.op_top_mip;
+                    view_update.push_back({ id, e.p_texture, e.latest_texture });
+                }
+                e.ticket = 0;
+                e.op_texture = {};
+            }
+
+            // 要求の解決. RequestUpload/RequestEvict がこの中から呼ばれる.
+            manager_.Update();
+
+            // 解放された常駐Mipを除いたTextureへ再生成する. 旧Textureは切り替え後に参照が無くなった時点で破棄され, メモリが返却される.
+            for (StreamingTextureId id = 0; id < static_cast<StreamingTextureId>(entry_array_.size()); ++id)
+            {
+                const auto& e = entry_array_[id];
+                if (!e.p_texture || 0 != e.ticket)
+                    continue;
+                const u32 resident_top_mip = manager_.GetResidentTopMip(id);
+                if (e.latest_top_mip < resident_top_mip)
+                    RequestRebuild(id, resident_top_mip, resident_top_mip, false);
+            }
+        }
+
+        if (view_update.empty())
+            return;
+
+        fwk::PushCommonRenderCommand([this, view_update](fwk::CommonRenderCommandArgRef arg)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto* p_device = arg.command_list->GetDevice();
+                for (const auto& e : view_update)
+                {
+                    // 実行までに破棄, または別のTextureへの切り替えが完了していれば反映しない.
+                    if (entry_array_.size() <= e.id || entry_array_[e.id].p_texture != e.p_texture || entry_array_[e.id].latest_texture.Get() != e.texture.Get())
+                        continue;
+
+                    ResTexture* p_texture = entry_array_[e.id].p_texture;
+                    const auto& tex_desc = e.texture->GetDesc();
+
+                    rhi::RefSrvDep view(new rhi::ShaderResourceViewDep());
+                    if (!view->InitializeAsTexture(p_device, e.texture.Get(), 0, static_cast<u32>(tex_desc.mip_count), 0, static_cast<u32>(tex_desc.array_size)))
+                    {
+                        std::cout << "[ERROR] TextureStreamingSystem InitializeAsTexture." << std::endl;
+                        continue;
+                    }
+                    view->RegisterBindless();
+                    // 旧Texture, 旧Viewは参照が無くなった時点で遅延破棄される.
+                    p_texture->ref_texture_ = e.texture;
+                    p_texture->ref_view_ = view;
+                }
+            });
+    }
+
+    TextureStreamingStatistics TextureStreamingSystem::GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return manager_.GetStatistics();
+    }
+
+    bool TextureStreamingSystem::RequestUpload(StreamingTextureId id, u32 new_top_mip, u32 current_top_mip)
+    {
+        // manager_.Update() からロック下で呼ばれる. 処理中の再生成がある場合は完了まで待機させる.
+        return RequestRebuild(id, new_top_mip, current_top_mip, true);
+    }
+    void TextureStreamingSystem::RequestEvict(StreamingTextureId /*id*/, u32 /*new_top_mip*/, u32 /*current_top_mip*/)
+    {
+        // 処理中の再生成と重ならないよう, 小さいTextureへの再生成は Update で常駐Mipの変化から発行する.
+    }
+
+    bool TextureStreamingSystem::RequestRebuild(StreamingTextureId id, u32 top_mip, u32 copy_top_mip, bool is_upload)
+    {
+        if (entry_array_.size() <= id)
+            return false;
+        auto& e = entry_array_[id];
+        if (!e.p_texture || !e.p_texture->streaming_source_ || 0 != e.ticket)
+            return false;
+        assert(e.latest_top_mip <= copy_top_mip);
+
+        const auto& source = e.p_texture->streaming_source_;
+        rhi::RefTextureDep texture(new rhi::TextureDep());
+        if (!texture->Initialize(p_device_, MakeStreamingTextureDesc(source->desc, top_mip)))
+        {
+            std::cout << "[ERROR] TextureStreamingSystem Texture Initialize." << std::endl;
+            return false;
+        }
+        const UploadTicket ticket = EnqueueStreamingTextureUpdate(texture, top_mip, e.latest_texture, e.latest_top_mip, copy_top_mip, source);
+        if (0 == ticket)
+            return false;
+
+        e.ticket = ticket;
+        e.op_texture = texture;
+        e.op_top_mip = top_mip;
+        e.op_is_upload = is_upload;
+        return true;
+    }
+}
+}
@@ -0,0 +1,301 @@
+﻿#include "gfx/resource/upload_manager.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+#include "util/time/profiler.h"
+
+namespace ngl
+{
+namespace gfx
+{
+    bool UploadManager::Initialize(rhi::DeviceDep* p_device, const Desc& desc)
+    {
+        assert(p_device);
+        assert(desc.scheduler_desc.ring_byte_size <= 0xffffffffu && "BufferDescのサイズはu32.");
+
+        if (!copy_queue_.Initialize(p_device))
+        {
+            std::cout << "[ERROR] Initialize Copy Command Queue" << std::endl;
+            return false;
+        }
+        if (!copy_fence_.Initialize(p_device))
+        {
+            std::cout << "[ERROR] Initialize Copy Fence" << std::endl;
+            return false;
+        }
+
+        // 永続Mapのステージングリング.
+        {
+            ring_buffer_.Reset(new rhi::BufferDep());
+            rhi::BufferDep::Desc ring_desc = {};
+            ring_desc.heap_type = rhi::EResourceHeapType::Upload;
+            ring_desc.initial_state = rhi::EResourceState::General;// UploadHeapはGenericRead.
+            ring_desc.element_byte_size = static_cast<u32>(desc.scheduler_desc.ring_byte_size);
+            ring_desc.element_count = 1;
+            if (!ring_buffer_->Initialize(p_device, ring_desc))
+            {
+                std::cout << "[ERROR] Initialize Upload Ring Buffer" << std::endl;
+                ring_buffer_ = {};
+                return false;
+            }
+            p_ring_memory_ = ring_buffer_->MapAs<u8>();
+        }
+
+        {
+            std::scoped_lock<std::mutex> lock(mutex_);
+            scheduler_.Initialize(desc.scheduler_desc);
+            pending_payload_.clear();
+        }
+        copy_fence_value_ = 0;
+        submitted_batch_.clear();
+        last_ticket_ = 0;
+        completed_ticket_ = 0;
+
+        p_device_ = p_device;
+        return true;
+    }
+
+    void UploadManager::Finalize()
+    {
+        if (!p_device_)
+            return;
+
+        WaitIdle();
+
+        {
+            std::scoped_lock<std::mutex> lock(mutex_);
+            pending_payload_.clear();
+            scheduler_.Initialize(scheduler_.GetDesc());
+        }
+        submitted_batch_.clear();
+        command_list_pool_.clear();
+        work_payload_.clear();
+
+        if (ring_buffer_.IsValid())
+        {
+            ring_buffer_->Unmap();
+            ring_buffer_ = {};
+        }
+        p_ring_memory_ = {};
+        p_device_ = {};
+    }
+
+    UploadTicket UploadManager::Enqueue(u64 byte_size, u64 alignment, const WriteFunction& write_func, const CopyFunction& copy_func)
+    {
+        // 終了処理後の要求は破棄.
+        if (!p_device_ || !copy_func)
+            return 0;
+
+        std::scoped_lock<std::mutex> lock(mutex_);
+        const UploadTicket ticket = last_ticket_.load() + 1;
+
+        UploadRequest req = {};
+        req.id = static_cast<u32>(ticket);
+        req.byte_size = byte_size;
+        req.alignment = alignment;
+        scheduler_.Enqueue(req);
+        pending_payload_.push_back({ ticket, byte_size, alignment, write_func, copy_func });
+
+        last_ticket_ = ticket;
+        return ticket;
+    }
+
+    UploadTicket UploadManager::EnqueueBuffer(const rhi::RefBufferDep& dst, const void* p_data, u64 byte_size)
+    {
+        if (!dst.IsValid() || !p_data || 0 == byte_size)
+            return 0;
+
+        // 要求元のデータは実際の書き込みまでに破棄され得るためコピーして保持する.
+        auto data = std::make_shared<std::vector<u8>>(static_cast<const u8*>(p_data), static_cast<const u8*>(p_data) + byte_size);
+        return Enqueue(byte_size, 16,
+            [data](u8* p_dst)
+            {
+                memcpy(p_dst, data->data(), data->size());
+            },
+            [dst, byte_size](rhi::CommandListBaseDep* p_command_list, rhi::BufferDep* p_src, u64 src_offset)
+            {
+                p_command_list->CopyBufferRegion(dst.Get(), 0, p_src, src_offset, byte_size);
+            });
+    }
+
+    rhi::CopyCommandListDep* UploadManager::GetFreeCommandList(u64 completed_fence_value)
+    {
+        for (auto& e : command_list_pool_)
+        {
+            if (e.fence_value <= completed_fence_value)
+                return e.command_list.get();
+        }
+        PooledCommandList new_elem = {};
+        new_elem.command_list.reset(new rhi::CopyCommandListDep());
+        if (!new_elem.command_list->Initialize(p_device_))
+        {
+            std::cout << "[ERROR] Initialize Copy Command List" << std::endl;
+            return nullptr;
+        }
+        command_list_pool_.push_back(std::move(new_elem));
+        return command_list_pool_.back().command_list.get();
+    }
+
+    void UploadManager::RetireSubmittedBatch(u64 completed_fence_value)
+    {
+        while (!submitted_batch_.empty() && submitted_batch_.front().fence_value <= completed_fence_value)
+        {
+            if (0 != submitted_batch_.front().last_ticket)
+                completed_ticket_ = submitted_batch_.front().last_ticket;
+            // コピー先と専用Bufferの参照を解放.
+            submitted_batch_.pop_front();
+        }
+    }
+
+    void UploadManager::RequeueWorkPayload(size_t begin)
+    {
+        if (work_payload_.size() <= begin)
+            return;
+
+        work_requeue_.clear();
+        for (size_t i = begin; i < work_payload_.size(); ++i)
+            work_requeue_.push_back({ static_cast<u32>(work_payload_[i].ticket), work_payload_[i].byte_size, work_payload_[i].alignment });
+
+        std::scoped_lock<std::mutex> lock(mutex_);
+        scheduler_.Requeue(work_requeue_);
+        pending_payload_.insert(pending_payload_.begin(),
+            std::make_move_iterator(work_payload_.begin() + begin), std::make_move_iterator(work_payload_.end()));
+        work_payload_.resize(begin);
+    }
+
+    void UploadManager::FlushFrame()
+    {
+        if (!p_device_)
+            return;
+
+        NGL_PROFILE_SCOPE("UploadManager::FlushFrame");
+
+        const u64 completed_fence_value = copy_fence_.GetD3D12Fence()->GetCompletedValue();
+        RetireSubmittedBatch(completed_fence_value);
+
+        // 予算内の要求を選択. 書き込みとコマンド記録はロック外で行う.
+        work_payload_.clear();
+        {
+            std::scoped_lock<std::mutex> lock(mutex_);
+            scheduler_.BeginFrame(completed_fence_value, work_item_);
+            for (const auto& item : work_item_)
+            {
+                assert(!pending_payload_.empty() && static_cast<u32>(pending_payload_.front().ticket) == item.id);
+                work_payload_.push_back(std::move(pending_payload_.front()));
+                pending_payload_.pop_front();
+            }
+        }
+        if (work_item_.empty())
+            return;
+
+        auto* p_command_list = GetFreeCommandList(completed_fence_value);
+        if (!p_command_list)
+        {
+            RequeueWorkPayload(0);
+            return;
+        }
+
+        SubmittedBatch batch = {};
+
+        p_command_list->Begin();
+        size_t submit_count = 0;
+        for (; submit_count < work_item_.size(); ++submit_count)
+        {
+            const auto& item = work_item_[submit_count];
+            auto& payload = work_payload_[submit_count];
+
+            // コピーのみの要求.
+            if (0 == payload.byte_size)
+            {
+                payload.copy_func(p_command_list, nullptr, 0);
+                continue;
+            }
+
+            rhi::BufferDep* p_src = ring_buffer_.Get();
+            u64 src_offset = item.ring_offset;
+            u8* p_dst_memory = p_ring_memory_ + item.ring_offset;
+            if (item.use_dedicated_buffer)
+            {
+                rhi::RefBufferDep dedicated_buffer;
+                dedicated_buffer.Reset(new rhi::BufferDep());
+                rhi::BufferDep::Desc upload_desc = {};
+                upload_desc.heap_type = rhi::EResourceHeapType::Upload;
+                upload_desc.initial_state = rhi::EResourceState::General;
+                upload_desc.element_byte_size = static_cast<u32>(payload.byte_size);
+                upload_desc.element_count = 1;
+                if (!dedicated_buffer->Initialize(p_device_, upload_desc))
+                {
+                    // 以降の要求と共に次フレームで再試行する. 順序を保つため後続の要求もここでは記録しない.
+                    std::cout << "[ERROR] UploadManager: Failed to create dedicated upload buffer. Retry next frame." << std::endl;
+                    break;
+                }
+                p_src = dedicated_buffer.Get();
+                src_offset = 0;
+                p_dst_memory = dedicated_buffer->MapAs<u8>();
+                batch.dedicated_buffer_array.push_back(dedicated_buffer);
+            }
+
+            payload.write_func(p_dst_memory);
+            // 書き込み元のデータは不要.
+            payload.write_func = {};
+            if (item.use_dedicated_buffer)
+                p_src->Unmap();
+
+            payload.copy_func(p_command_list, p_src, src_offset);
+        }
+        p_command_list->End();
+
+        RequeueWorkPayload(submit_count);
+
+        rhi::CommandListBaseDep* submit_list[] = { p_command_list };
+        copy_queue_.ExecuteCommandLists(static_cast<unsigned int>(std::size(submit_list)), submit_list);
+        ++copy_fence_value_;
+        copy_queue_.Signal(&copy_fence_, copy_fence_value_);
+
+        for (auto& e : command_list_pool_)
+        {
+            if (e.command_list.get() == p_command_list)
+                e.fence_value = copy_fence_value_;
+        }
+
+        {
+            std::scoped_lock<std::mutex> lock(mutex_);
+            // 選択時に確保したリング領域は再試行分も含めてこのFence値で回収する.
+            scheduler_.EndFrame(copy_fence_value_);
+        }
+        // FIFOで選択されるため, このFence値の完了で最後の要求以前は全て完了する.
+        batch.fence_value = copy_fence_value_;
+        batch.last_ticket = (work_payload_.empty()) ? 0 : work_payload_.back().ticket;
+        batch.payload_array = std::move(work_payload_);
+        submitted_batch_.push_back(std::move(batch));
+        work_payload_.clear();
+    }
+
+    void UploadManager::WaitIdle()
+    {
+        if (!p_device_ || 0 == copy_fence_value_)
+            return;
+        copy_wait_signal_.Wait(&copy_fence_, copy_fence_value_);
+        RetireSubmittedBatch(copy_fence_value_);
+    }
+
+    void UploadManager::SetMaxUploadBytePerFrame(u64 byte_size)
+    {
+        std::scoped_lock<std::mutex> lock(mutex_);
+        scheduler_.SetMaxUploadBytePerFrame(byte_size);
+    }
+
+    UploadManager::Statistics UploadManager::GetStatistics() const
+    {
+        std::scoped_lock<std::mutex> lock(mutex_);
+        Statistics stat = {};
+        stat.scheduler = scheduler_.GetStatistics();
+        stat.ring_byte_size = scheduler_.GetDesc().ring_byte_size;
+        return stat;
+    }
+}
+}
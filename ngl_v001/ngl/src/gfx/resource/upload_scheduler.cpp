@@ -0,0 +1,295 @@
+﻿#include "gfx/resource/upload_scheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace ngl
+{
+namespace gfx
+{
+    namespace
+    {
+        u64 AlignUp(u64 v, u64 align)
+        {
+            return (v + align - 1) & ~(align - 1);
+        }
+    }
+
+    void UploadRingAllocator::Initialize(u64 capacity_byte)
+    {
+        capacity_ = capacity_byte;
+        head_ = 0;
+        tail_ = 0;
+        used_ = 0;
+        open_byte_ = 0;
+        batch_.clear();
+    }
+
+    bool UploadRingAllocator::Allocate(u64 byte_size, u64 alignment, u64& out_offset)
+    {
+        assert(0 < alignment && 0 == (alignment & (alignment - 1)));
+        if (0 == byte_size || capacity_ < byte_size)
+            return false;
+
+        // 空の場合は先頭から.
+        if (0 == used_)
+        {
+            head_ = 0;
+            tail_ = 0;
+        }
+
+        u64 offset = AlignUp(tail_, alignment);
+        u64 padding = offset - tail_;
+        if (head_ < tail_ || 0 == used_)
+        {
+            // 空きは [tail_, capacity_) と [0, head_).
+            if (offset + byte_size > capacity_)
+            {
+                // 末尾の余りを捨てて先頭へ折り返す.
+                if (byte_size > head_)
+                    return false;
+                padding = capacity_ - tail_;
+                offset = 0;
+            }
+        }
+        else
+        {
+            // 空きは [tail_, head_). tail_ == head_ は満杯.
+            if (offset + byte_size > head_)
+                return false;
+        }
+
+        const u64 consume = padding + byte_size;
+        used_ += consume;
+        open_byte_ += consume;
+        tail_ = offset + byte_size;
+        out_offset = offset;
+        return true;
+    }
+
+    void UploadRingAllocator::Close(u64 fence_value)
+    {
+        if (0 == open_byte_)
+            return;
+        assert((batch_.empty() || batch_.back().fence_value <= fence_value) && "fence_value が単調増加でない.");
+        batch_.push_back({ tail_, open_byte_, fence_value });
+        open_byte_ = 0;
+    }
+
+    void UploadRingAllocator::Reclaim(u64 completed_fence_value)
+    {
+        while (!batch_.empty() && batch_.front().fence_value <= completed_fence_value)
+        {
+            const auto& batch = batch_.front();
+            head_ = batch.end_offset;
+            used_ -= batch.byte_size;
+            batch_.pop_front();
+        }
+    }
+
+
+    void UploadScheduler::Initialize(const Desc& desc)
+    {
+        desc_ = desc;
+        desc_.max_upload_per_frame = std::max(1u, desc_.max_upload_per_frame);
+
+        ring_.Initialize(desc_.ring_byte_size);
+        pending_.clear();
+        pending_byte_ = 0;
+        stat_ = {};
+    }
+
+    void UploadScheduler::Enqueue(const UploadRequest& request)
+    {
+        pending_.push_back(request);
+        pending_byte_ += request.byte_size;
+    }
+
+    void UploadScheduler::Requeue(const std::vector<UploadRequest>& request_array)
+    {
+        pending_.insert(pending_.begin(), request_array.begin(), request_array.end());
+        for (const auto& e : request_array)
+            pending_byte_ += e.byte_size;
+        stat_.pending_byte = pending_byte_;
+        stat_.pending_count = static_cast<u32>(pending_.size());
+    }
+
+    void UploadScheduler::BeginFrame(u64 completed_fence_value, std::vector<UploadItem>& out_item)
+    {
+        out_item.clear();
+        ring_.Reclaim(completed_fence_value);
+
+        u64 frame_byte = 0;
+        u32 dedicated_count = 0;
+        while (!pending_.empty() && desc_.max_upload_per_frame > out_item.size())
+        {
+            const auto& req = pending_.front();
+            // フレーム最初の要求は予算超過でも選択する.
+            if (!out_item.empty() && desc_.max_upload_byte_per_frame < frame_byte + req.byte_size)
+                break;
+
+            UploadItem item = {};
+            item.id = req.id;
+            if (0 == req.byte_size)
+            {
+                // コピーのみ. リングを確保しない.
+            }
+            else if (ring_.GetCapacity() < req.byte_size)
+            {
+                item.use_dedicated_buffer = true;
+                ++dedicated_count;
+            }
+            else if (!ring_.Allocate(req.byte_size, std::max<u64>(req.alignment, 1), item.ring_offset))
+            {
+                // リングの空き待ち. 順序を保つため以降の要求も次フレーム以降.
+                break;
+            }
+
+            frame_byte += req.byte_size;
+            pending_byte_ -= req.byte_size;
+            out_item.push_back(item);
+            pending_.pop_front();
+        }
+
+        stat_.upload_byte_this_frame = frame_byte;
+        stat_.upload_count_this_frame = static_cast<u32>(out_item.size());
+        stat_.dedicated_count_this_frame = dedicated_count;
+        stat_.pending_byte = pending_byte_;
+        stat_.pending_count = static_cast<u32>(pending_.size());
+        stat_.ring_used_byte = ring_.GetUsedByte();
+        stat_.total_upload_byte += frame_byte;
+    }
+
+    void UploadScheduler::EndFrame(u64 submit_fence_value)
+    {
+        ring_.Close(submit_fence_value);
+    }
+
+
+    void TestUploadScheduler()
+    {
+        bool is_ok = true;
+
+        // リングの折り返しと回収.
+        {
+            UploadRingAllocator ring;
+            ring.Initialize(1024);
+            u64 offset = 0;
+
+            is_ok &= ring.Allocate(300, 256, offset) && (0 == offset);
+            is_ok &= ring.Allocate(300, 256, offset) && (512 == offset);
+            ring.Close(1);
+            // [812, 1024) に収まらず, 先頭も未解放のため失敗.
+            is_ok &= !ring.Allocate(300, 16, offset);
+            is_ok &= (812 == ring.GetUsedByte());
+
+            // Fence未完了では解放されない.
+            ring.Reclaim(0);
+            is_ok &= (812 == ring.GetUsedByte()) && (1 == ring.NumBatch());
+            ring.Reclaim(1);
+            is_ok &= (0 == ring.GetUsedByte()) && (0 == ring.NumBatch());
+
+            // 空になると先頭から.
+            is_ok &= ring.Allocate(600, 16, offset) && (0 == offset);
+            ring.Close(2);
+            is_ok &= ring.Allocate(300, 16, offset) && (608 == offset);
+            ring.Close(3);
+            ring.Reclaim(2);
+            // 末尾 [908, 1024) に収まらないため折り返す. 末尾の余りは使用量に含む.
+            is_ok &= ring.Allocate(500, 16, offset) && (0 == offset);
+            is_ok &= (8 + 300 + 116 + 500 == ring.GetUsedByte());
+            // 先頭側 [500, 600) の空き.
+            is_ok &= ring.Allocate(80, 16, offset) && (512 == offset);
+            is_ok &= !ring.Allocate(16, 16, offset);
+            ring.Close(4);
+
+            ring.Reclaim(3);
+            is_ok &= (116 + 500 + 12 + 80 == ring.GetUsedByte());
+            ring.Reclaim(4);
+            is_ok &= (0 == ring.GetUsedByte());
+
+            // 容量超過.
+            is_ok &= !ring.Allocate(2048, 16, offset);
+        }
+
+        // 予算による選択.
+        {
+            UploadScheduler::Desc desc = {};
+            desc.ring_byte_size = 1024;
+            desc.max_upload_byte_per_frame = 512;
+            desc.max_upload_per_frame = 3;
+            UploadScheduler scheduler;
+            scheduler.Initialize(desc);
+
+            for (u32 i = 0; i < 6; ++i)
+                scheduler.Enqueue({ i, 200, 16 });
+            scheduler.Enqueue({ 6, 4096, 16 });// リング容量超過.
+            scheduler.Enqueue({ 7, 100, 16 });
+
+            std::vector<UploadItem> item;
+            u64 fence = 0;
+            u64 completed = 0;
+
+            // バイト数上限で2つ.
+            scheduler.BeginFrame(completed, item);
+            is_ok &= (2 == item.size()) && (0 == item[0].id) && (1 == item[1].id) && (0 == item[0].ring_offset) && (208 == item[1].ring_offset);
+            scheduler.EndFrame(++fence);
+
+            // GPU未完了. リングの残りで2つ.
+            scheduler.BeginFrame(completed, item);
+            is_ok &= (2 == item.size()) && (2 == item[0].id) && (3 == item[1].id);
+            scheduler.EndFrame(++fence);
+
+            // リングの空き待ちで選択無し.
+            scheduler.BeginFrame(completed, item);
+            is_ok &= item.empty() && (4 == scheduler.NumPending());
+            scheduler.EndFrame(++fence);
+
+            // 回収後に再開.
+            completed = fence;
+            scheduler.BeginFrame(completed, item);
+            is_ok &= (2 == item.size()) && (4 == item[0].id) && (5 == item[1].id);
+            scheduler.EndFrame(++fence);
+
+            // 予算とリング容量を超える要求はフレーム先頭で専用バッファ.
+            scheduler.BeginFrame(completed, item);
+            is_ok &= (1 == item.size()) && (6 == item[0].id) && item[0].use_dedicated_buffer;
+            scheduler.EndFrame(++fence);
+
+            scheduler.BeginFrame(completed, item);
+            is_ok &= (1 == item.size()) && (7 == item[0].id) && !item[0].use_dedicated_buffer;
+            scheduler.EndFrame(++fence);
+
+            is_ok &= (0 == scheduler.NumPending()) && (0 == scheduler.GetStatistics().pending_byte);
+            is_ok &= (200 * 6 + 4096 + 100 == scheduler.GetStatistics().total_upload_byte);
+
+            // 要求数上限.
+            for (u32 i = 0; i < 5; ++i)
+                scheduler.Enqueue({ i, 1, 1 });
+            completed = fence;
+            scheduler.BeginFrame(completed, item);
+            is_ok &= (3 == item.size());
+            scheduler.EndFrame(++fence);
+
+            // ステージングを利用しないコピーのみの要求はリングの空き待ちにならない.
+            scheduler.Enqueue({ 10, 0, 1 });
+            completed = fence;
+            scheduler.BeginFrame(completed, item);
+            is_ok &= (3 == item.size()) && (3 == item[0].id) && (4 == item[1].id) && (10 == item[2].id) && !item[2].use_dedicated_buffer;
+            scheduler.EndFrame(++fence);
+
+            // Submitできなかった要求は保留の先頭へ戻り, 順序を保って再選択される.
+            scheduler.Requeue({ { 1, 1, 1 }, { 2, 1, 1 } });
+            is_ok &= (2 == scheduler.NumPending()) && (2 == scheduler.GetStatistics().pending_byte);
+            scheduler.BeginFrame(completed, item);
+            is_ok &= (2 == item.size()) && (1 == item[0].id) && (2 == item[1].id);
+            scheduler.EndFrame(++fence);
+        }
+
+        std::cout << "[TestUploadScheduler]";
+        std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+        assert(is_ok);
+    }
+}
+}
@@ -3,6 +3,8 @@
 #include "gfx/rtg/graph_builder.h"
 
 #include "rhi/d3d12/command_list.d3d12.h"
+#include "util/time/profiler.h"
+#include <chrono>
 #include <unordered_set>
 
 
@@ -31,6 +33,21 @@ namespace ngl
 		}
 
 		
+		// アクセスタイプから要求するrhiステートを決定.
+		static rhi::EResourceState RtgAccessTypeToResourceState(AccessTypeValue access_type)
+		{
+			if(AccessType::RENDER_TARGET == access_type)
+				return rhi::EResourceState::RenderTarget;
+			if(AccessType::DEPTH_TARGET == access_type)
+				return rhi::EResourceState::DepthWrite;
+			if(AccessType::UAV == access_type)
+				return rhi::EResourceState::UnorderedAccess;
+			if(AccessType::SHADER_READ == access_type)
+				return rhi::EResourceState::ShaderRead;
+			assert(false);
+			return {};
+		}
+		
 		// リソースハンドルを生成.
 		RtgResourceHandle RenderTaskGraphBuilder::CreateResource(RtgResourceDesc2D res_desc)
 		{
@@ -43,6 +60,14 @@ namespace ngl
 			RtgResourceHandle handle{};
 			handle.detail.unique_id = new_handle_id;// ユニークID割当.
 
+			// Setupジョブ中はローカル記録へ登録し, ジョブ完了時にマージする.
+			if(auto* p_record = GetCurrentSetupRecord())
+			{
+				p_record->created_resource.push_back(std::pair(handle, res_desc));
+				return handle;
+			}
+			assert(!is_setup_job_running_);
+
 			if(handle_2_desc_.end() != handle_2_desc_.find(handle))
 			{
 				assert(false);
@@ -62,6 +87,8 @@ namespace ngl
 		{
 			// Compile前のRecordフェーズでのみ許可.
 			assert(IsRecordable());
+			// Setupジョブ実行中は不可.
+			assert(!is_setup_job_running_);
 			
 			propagate_next_handle_[handle] = 0;
 
@@ -73,6 +100,9 @@ namespace ngl
 			rhi::RefTextureDep tex, rhi::RhiRef<rhi::SwapChainDep> swapchain, rhi::RefRtvDep rtv, rhi::RefDsvDep dsv, rhi::RefSrvDep srv, rhi::RefUavDep uav,
 			rhi::EResourceState curr_state, rhi::EResourceState nesesary_end_state)
 		{	
+			// Setupジョブ実行中は不可.
+			assert(!is_setup_job_running_);
+
 			// 無効なリソースチェック.
 			if (!swapchain.IsValid() && !tex.IsValid())
 			{
@@ -195,6 +225,16 @@ namespace ngl
 		// Descを取得.
 		RtgResourceDesc2D RenderTaskGraphBuilder::GetResourceHandleDesc(RtgResourceHandle handle) const
 		{
+			// Setupジョブ中は自身が生成した未マージのハンドルも対象.
+			if(const auto* p_record = GetCurrentSetupRecord())
+			{
+				for(const auto& e : p_record->created_resource)
+				{
+					if(e.first == handle.data)
+						return e.second;
+				}
+			}
+			
 			const auto find_it = handle_2_desc_.find(handle);
 			if(handle_2_desc_.end() == find_it)
 			{
@@ -242,7 +282,28 @@ namespace ngl
 					}
 				}
 			}
-				
+
+			// Setupジョブ中はローカル記録へ登録し, ジョブ完了時にNodeシーケンス順でマージする.
+			if(auto* p_record = GetCurrentSetupRecord())
+			{
+				// Setupジョブは登録したNode自身のアクセスのみ記録する.
+				assert(p_record->node == &node);
+				NodeHandleUsageInfo push_info = {};
+				push_info.handle = res_handle;
+				push_info.access = AccessType;
+				p_record->handle_usage.push_back(push_info);
+				return res_handle;
+			}
+			assert(!is_setup_job_running_);
+
+			RegisterNodeHandleUsage(node, res_handle, AccessType);
+			
+			// Passメンバに保持するコードを短縮するためHandleをそのままリターン.
+			return res_handle;
+		}
+		// NodeのHandleアクセスをBuilder本体へ登録する.
+		void RenderTaskGraphBuilder::RegisterNodeHandleUsage(const ITaskNode& node, const RtgResourceHandle res_handle, const AccessTypeValue AccessType)
+		{
 			// Node->Handle&AccessTypeのMap登録.
 			{
 				if(node_handle_usage_list_.end() == node_handle_usage_list_.find(&node))
@@ -289,14 +350,19 @@ namespace ngl
 				handle_2_debug_name_[res_handle.data] = debug_name_buf;
 			}
 #endif
-			// Passメンバに保持するコードを短縮するためHandleをそのままリターン.
-			return res_handle;
 		}
 
 
 		// GraphicsTask用のRender処理登録. IGraphicsTaskNode派生Taskはこの関数で自身のRender処理を登録する.
 		void RenderTaskGraphBuilder::RegisterTaskNodeRenderFunction(const IGraphicsTaskNode* node, const TaskNodeRenderFunctionType_Graphics& render_function)
 		{
+			if(auto* p_record = GetCurrentSetupRecord())
+			{
+				assert(p_record->node == node && !p_record->render_function_graphics);
+				p_record->render_function_graphics = render_function;
+				return;
+			}
+			assert(!is_setup_job_running_);
 			// 念の為二重登録チェック.
 			assert(node_function_graphics_.end() == node_function_graphics_.find(node));
 			node_function_graphics_.insert(std::pair(node, render_function));
@@ -304,15 +370,117 @@ namespace ngl
 		// AsyncComputeTask用のRender処理登録. IComputeTaskNode派生Taskはこの関数で自身の非同期Compute Render処理を登録する.
 		void RenderTaskGraphBuilder::RegisterTaskNodeRenderFunction(const IComputeTaskNode* node, const TaskNodeRenderFunctionType_Compute& render_function)
 		{
+			if(auto* p_record = GetCurrentSetupRecord())
+			{
+				assert(p_record->node == node && !p_record->render_function_compute);
+				p_record->render_function_compute = render_function;
+				return;
+			}
+			assert(!is_setup_job_running_);
 			// 念の為二重登録チェック.
 			assert(node_function_compute_.end() == node_function_compute_.find(node));
 			node_function_compute_.insert(std::pair(node, render_function));
 		}
+
+		// 実行中のSetupジョブの記録.
+		thread_local RenderTaskGraphBuilder::NodeSetupRecord* RenderTaskGraphBuilder::s_current_setup_record_ = nullptr;
+		RenderTaskGraphBuilder::NodeSetupRecord* RenderTaskGraphBuilder::GetCurrentSetupRecord() const
+		{
+			// 別のBuilderのSetupジョブ内から呼ばれた場合は対象外.
+			if(s_current_setup_record_ && (this == s_current_setup_record_->p_builder))
+				return s_current_setup_record_;
+			return nullptr;
+		}
+
+		// TaskNodeのSetup処理をジョブとして登録する.
+		void RenderTaskGraphBuilder::AddTaskNodeSetupJob(const ITaskNode* node, const std::function<void(void)>& setup_function)
+		{
+			// Compile前のRecordフェーズでのみ許可.
+			assert(IsRecordable());
+			assert(!is_setup_job_running_);
+			assert(0 <= GetNodeSequencePosition(node));
+			
+			NodeSetupRecord record{};
+			record.p_builder = this;
+			record.node = node;
+			record.setup_function = setup_function;
+			setup_job_array_.push_back(std::move(record));
+		}
+		// 登録済みのSetupジョブを実行してマージする.
+		void RenderTaskGraphBuilder::ExecuteTaskNodeSetupJob(thread::JobSystem* p_job_system)
+		{
+			NGL_PROFILE_SCOPE("RenderTaskGraphBuilder::ExecuteTaskNodeSetupJob");
+			assert(IsRecordable());
+			if(setup_job_array_.empty())
+				return;
+
+			// 実行中は setup_job_array_ の要素を移動しないこと.
+			is_setup_job_running_ = true;
+			{
+				auto run_setup = [](NodeSetupRecord* p_record)
+				{
+					s_current_setup_record_ = p_record;
+					p_record->setup_function();
+					s_current_setup_record_ = nullptr;
+				};
+				if(p_job_system && (1 < setup_job_array_.size()))
+				{
+					for(auto& e : setup_job_array_)
+					{
+						NodeSetupRecord* p_record = &e;
+						p_job_system->Add([run_setup, p_record]()
+						{
+							run_setup(p_record);
+						});
+					}
+					p_job_system->WaitAll();
+				}
+				else
+				{
+					for(auto& e : setup_job_array_)
+						run_setup(&e);
+				}
+			}
+			is_setup_job_running_ = false;
+
+			// ローカル記録をNodeシーケンス順でマージ. ジョブの完了順に依らず結果(デバッグ名を含む)を決定的にする.
+			std::sort(setup_job_array_.begin(), setup_job_array_.end(),
+				[this](const NodeSetupRecord& a, const NodeSetupRecord& b)
+				{
+					return GetNodeSequencePosition(a.node) < GetNodeSequencePosition(b.node);
+				});
+			for(auto& e : setup_job_array_)
+			{
+				for(const auto& res : e.created_resource)
+				{
+					assert(handle_2_desc_.end() == handle_2_desc_.find(res.first));
+					handle_2_desc_[res.first] = res.second;
+				}
+				for(const auto& usage : e.handle_usage)
+				{
+					RegisterNodeHandleUsage(*e.node, usage.handle, usage.access);
+				}
+				if(e.render_function_graphics)
+				{
+					assert(node_function_graphics_.end() == node_function_graphics_.find(e.node));
+					node_function_graphics_.insert(std::pair(e.node, std::move(e.render_function_graphics)));
+				}
+				if(e.render_function_compute)
+				{
+					assert(node_function_compute_.end() == node_function_compute_.find(e.node));
+					node_function_compute_.insert(std::pair(e.node, std::move(e.render_function_compute)));
+				}
+			}
+			setup_job_array_.clear();
+		}
 		
 		// グラフからリソース割当と状態遷移を確定.
 		// CompileされたGraphは必ずExecuteが必要.
 		bool RenderTaskGraphBuilder::Compile(RenderTaskGraphManager& manager)
 		{
+			NGL_PROFILE_SCOPE("RenderTaskGraphBuilder::Compile");
+			// キャッシュ統計用のCompile時間計測.
+			const auto compile_begin = std::chrono::steady_clock::now();
 			// Compile可能チェック.
 			if(!IsCompilable())
 			{
@@ -320,6 +488,8 @@ namespace ngl
 				assert(false);
 				return false;
 			}
+			// 未実行のSetupジョブは直列に実行してマージする.
+			ExecuteTaskNodeSetupJob(nullptr);
 			
 			// 状態遷移.
 			state_ = EBuilderState::COMPILED;
@@ -354,126 +524,44 @@ namespace ngl
 
 			// リセット.
 			compiled_ = {};
-			
-			// ------------------------------------------------------------------------
-			// Nodeの依存関係(Graphics-Compute).
-			compiled_.node_dependency_fence_.resize(node_sequence_.size());
-			std::fill(compiled_.node_dependency_fence_.begin(), compiled_.node_dependency_fence_.end(), CompiledBuilder::NodeDependency{});// fill -1
-			{
-				std::vector<ETaskType> task_type = {};
-				std::vector<CompiledBuilder::NodeDependency> task_dependency = {};
-				task_type.resize(node_sequence_.size());
-				task_dependency.resize(node_sequence_.size());
-				std::fill(task_dependency.begin(), task_dependency.end(), CompiledBuilder::NodeDependency{});// fill -1
-				// NodeのTaskTypeにアクセスしやすくするための配列セットアップ.
-				for(int i = 0; i < node_sequence_.size(); ++i)
-				{
-					task_type[i] = node_sequence_[i]->TaskType();
-				}
-				// 先にGraphics-Computeの依存関係をリストアップする.
-				for(int i = 1; i < node_sequence_.size(); ++i)
-				{
-					const auto* p_node_i = node_sequence_[i];
-					const auto task_type_i = p_node_i->TaskType();
-					// リソースのRecordをしないTaskも存在する場合がある.
-					if(node_handle_usage_list_.end() == node_handle_usage_list_.find(p_node_i))
-						continue;
 
-					int nearest_dependency_index = -1;
-					// 前段のNodeを近い順に探索.
-					for(int j = i - 1; j >= 0; --j)
-					{
-						const auto* p_node_j = node_sequence_[j];
-						const auto task_type_j = p_node_j->TaskType();
-						// リソースのRecordをしないTaskも存在する場合がある.
-						if(node_handle_usage_list_.end() == node_handle_usage_list_.find(p_node_j))
-							continue;
+			// 出力に到達しないNodeのカリングと実行Queueの決定. 以降はカリング後のシーケンスで処理する.
+			ScheduleNode();
 
-						// 異なるTypeのNodeで同一Handleへアクセスしているものを探す
-						if(task_type_i == task_type_j)
-							continue;
-				
-						for(auto& res_access_i : node_handle_usage_list_[p_node_i])
-						{
-							const bool cur_node_access_write = RtgIsWriteAccess(res_access_i.access);
-							
-							for(auto& res_access_j : node_handle_usage_list_[p_node_j])
-							{
-								const bool prev_node_access_write = RtgIsWriteAccess(res_access_j.access);
-
-								// 注目ノードと同じハンドルを先行ノードが参照している.
-								const bool is_same_handle = res_access_i.handle == res_access_j.handle;
-								// 注目ノードと先行ノードの両方のアクセスタイプを考慮.
-								const bool is_need_wait_dependency_access = !(!prev_node_access_write && !cur_node_access_write);
-								
-								// 現状ではGraphicsとComputeで Read-Read のアクセスでは依存は発生しないものとしている.
-								//	これで問題が出る場合はアクセスタイプの組み合わせに限らず同じハンドルアクセスは依存と判断することを検討.
-								if(
-									is_same_handle
-									&& is_need_wait_dependency_access
-									)
-								{
-									// 最も近い前段のNodeからの依存のみで十分なので, 最大値で探索する.
-									nearest_dependency_index = std::max(nearest_dependency_index, j);
-									break;
-								}
-							}
-							if(0 <= nearest_dependency_index)
-								break;// 早期break.
-						}
-						if(0 <= nearest_dependency_index)
-							break;// 早期break.
-					}
-					if(0 <= nearest_dependency_index)
+			// ハンドル値に依存しない正規化Graph. ハンドルの線形インデックスもここで決まる.
+			RtgCanonicalGraph canonical_graph = {};
+			BuildCanonicalGraph(canonical_graph);
+			compiled_.handle_2_linear_index_ = canonical_graph.GetHandleIndexMap();
+			compiled_.linear_handle_array_.assign(canonical_graph.GetHandleArray().begin(), canonical_graph.GetHandleArray().end());
+
+			// 同一構造のGraphのCompile済みスケジュールが現在のリソース状態に適用可能であれば再利用する.
+			auto& compile_cache = manager.compile_cache_;
+			RtgCompiledSchedule verify_schedule = {};
+			bool is_verify_cached_schedule = false;
+			if(compile_cache.IsEnable())
+			{
+				const RtgCompiledSchedule* p_cached_schedule = compile_cache.Find(canonical_graph,
+					[this, &canonical_graph](const RtgCompiledSchedule& schedule)
 					{
-						// 近い依存のみを更新.
-						// 前方からそれより前方への依存を近い順に探索しているため, node_iからみたnearest_dependency_indexは最短距離にある依存作のはず.
-						if(0 > task_dependency[nearest_dependency_index].to
-							|| i < task_dependency[nearest_dependency_index].to)
-						{
-							task_dependency[i].from = nearest_dependency_index;
-							task_dependency[nearest_dependency_index].to = i;
-						}
-					}
-				}
-				// リストアップした依存関係からFenceを張るべき有効な関係を抽出する.
-				//	依存元と依存先の位置関係から意味のない依存関係を除外して有効な依存関係のみ抽出.
-				int fence_count = 0;
-				for(int type_i = 0; type_i < 2; ++type_i)
+						return IsApplicableCompiledSchedule(canonical_graph, schedule);
+					});
+				if(p_cached_schedule)
 				{
-					const int other_type_i = 1 - type_i;// 0 or 1.
-					
-					for(int i = 0; i < node_sequence_.size(); ++i)
+					if(!compile_cache.IsVerifyEnable())
 					{
-						if((int)task_type[i] != type_i)
-							continue;// 処理対象のTypeのみ.
-
-						// 前段のNodeを探索.
-						bool is_valid_dependency = true;
-						for(int j = i-1; j >= 0 && is_valid_dependency; --j)
-						{
-							if((int)task_type[j] != type_i)
-								continue;// 処理対象のTypeのみ.
-							// 前方のNodeからの依存先は, 自身の依存先よりも前方であるはず. 同じか後方にあるような依存先の場合はこの依存関係iは意味が無いものとして除去する.
-							if(task_dependency[i].from <= task_dependency[j].from)
-							{
-								is_valid_dependency = false;
-							}
-						}
-						if(is_valid_dependency)
-						{
-							if(0 <= task_dependency[i].from)
-							{
-								compiled_.node_dependency_fence_[i].from = task_dependency[i].from;
-								compiled_.node_dependency_fence_[task_dependency[i].from].to = i;
-
-								compiled_.node_dependency_fence_[i].fence_id = fence_count;
-								++fence_count;
-							}
-						}
+						ApplyCompiledSchedule(canonical_graph, *p_cached_schedule);
+						compile_cache.ReportCompile(true, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compile_begin).count());
+						return true;
 					}
+					// 検証モードでは通常のCompileを実行して比較する.
+					verify_schedule = *p_cached_schedule;
+					is_verify_cached_schedule = true;
 				}
 			}
+			
+			// ------------------------------------------------------------------------
+			// Nodeの依存関係(Graphics-Compute).
+			RtgScheduleNodeDependency(canonical_graph, compiled_.node_dependency_fence_);
 			// ------------------------------------------------------------------------
 			
 			
@@ -490,25 +578,6 @@ namespace ngl
 				}
 			}
 
-			// 存在するハンドル毎に仮の線形インデックスを割り振る. ランダムアクセスのため.
-			for(int node_i = 0; node_i < node_sequence_.size(); ++node_i)
-			{
-				const ITaskNode* p_node = node_sequence_[node_i];
-				// リソースのRecordをしないTaskも存在する場合がある.
-				if(node_handle_usage_list_.end() == node_handle_usage_list_.find(p_node))
-					continue;
-				
-				// このNodeのリソースアクセス情報を巡回.
-				for(auto& res_access : node_handle_usage_list_[p_node])
-				{
-					if(compiled_.handle_2_linear_index_.end() == compiled_.handle_2_linear_index_.find(res_access.handle))
-					{
-						// このResourceHandleの要素が未登録なら新規.
-						compiled_.handle_2_linear_index_[res_access.handle] = static_cast<int>(compiled_.linear_handle_array_.size());
-						compiled_.linear_handle_array_.push_back(res_access.handle);
-					}
-				}
-			}
 			int handle_count = static_cast<int>(compiled_.linear_handle_array_.size());
 
 			
@@ -715,157 +784,54 @@ namespace ngl
 				}
 			}
 			
-			// Graph上で割り当てられた有効なリソースIDから密なリニアインデックスへのマップ. 有効リソースID毎の情報をワークバッファ上で操作するため.
-			std::unordered_map<CompiledBuilder::CompiledResourceInfoKeyType, int> res_id_2_linear_map = {};
-			// 有効リソースリニアインデックスからリソースIDへのマッピングをする配列.
-			std::vector<CompiledBuilder::CompiledResourceInfo> res_linear_2_id_array = {};
-			// Graph上で有効な実リソース数.
-			int valid_res_count = 0;
-			for(const auto& res_id : compiled_.linear_handle_resource_id_)
+			// リソース割当を確定したのでステート遷移を決定する.
+			//	各Nodeの各Handleがその時点でどのようにステート遷移すべきかの情報を構築.
+			RtgCompiledSchedule schedule = {};
 			{
-				if(res_id_2_linear_map.end() == res_id_2_linear_map.find(res_id))
+				schedule.node_dependency = compiled_.node_dependency_fence_;
+				schedule.handle_assign.resize(handle_count);
+				for(int handle_index = 0; handle_index < handle_count; ++handle_index)
 				{
-					res_id_2_linear_map[res_id] = valid_res_count;
-					res_linear_2_id_array.push_back(res_id);
-					++valid_res_count;
+					schedule.handle_assign[handle_index].resource_id = compiled_.linear_handle_resource_id_[handle_index].detail.resource_id;
+					schedule.handle_assign[handle_index].is_external = compiled_.linear_handle_resource_id_[handle_index].detail.is_external;
 				}
-			}
-			
-			// 時系列順で実リソースへのアクセスNodeをリストアップ.
-			std::vector<std::vector<const ITaskNode*>> res_access_node_array(valid_res_count);
-			for(const auto* p_node : node_sequence_)
-			{
-				// リソースのRecordをしないTaskも存在する場合がある.
-				if(node_handle_usage_list_.end() == node_handle_usage_list_.find(p_node))
-					continue;
 				
-				const auto& node_handles = node_handle_usage_list_[p_node];
-				for(const auto& access_info : node_handles)
-				{
-					// access_info.access;
-					const auto handle_id = compiled_.handle_2_linear_index_[access_info.handle];
-					const auto res_id = compiled_.linear_handle_resource_id_[handle_id];
-
-					const auto res_index = res_id_2_linear_map[res_id];
-
-					// リソースに対して時系列でのアクセスNodeリスト.
-					res_access_node_array[res_index].push_back(p_node);
-				}
-			}
-
-			// リソース割当を確定したのでステート遷移を決定する.
-			//	各Nodeの各Handleがその時点でどのようにステート遷移すべきかの情報を構築.
-			for(int res_index = 0; res_index < res_access_node_array.size(); ++res_index)
-			{
-				const CompiledBuilder::CompiledResourceInfo res_id = res_linear_2_id_array[res_index];
-
-				// 初回フレームの伝搬リソース等は無効なリソースIDとなっているためチェック.
-				if(0 <= res_id.detail.resource_id)
+				auto get_begin_state = [this](const RtgResourceAssign& resource) -> rhi::EResourceState
 				{
-					rhi::EResourceState begin_state = {};
-					if(!res_id.detail.is_external)
+					if(!resource.is_external)
 					{
 						// 内部リソースの場合はキャッシュされたステートから開始.
-						auto* p_resource = p_compiled_manager_->GetInternalResourcePtr(res_id.detail.resource_id);
-						begin_state = p_resource->cached_state_;// 実リソースのCompile時点のステートから開始.
-					}
-					else
-					{
-						// 外部リソースの場合は登録された開始ステートから開始.
-						begin_state = imported_resource_[res_id.detail.resource_id].cached_state_;
-					}
-				
-					rhi::EResourceState curr_state = begin_state;
-					for(const auto* p_node : res_access_node_array[res_index])
-					{
-						// リソースのRecordをしないTaskも存在する場合がある.
-						if(node_handle_usage_list_.end() == node_handle_usage_list_.find(p_node))
-							continue;
-						
-						for(const auto handle : node_handle_usage_list_[p_node])
-						{
-							const int handle_index = compiled_.handle_2_linear_index_[handle.handle];
-							if(res_id == compiled_.linear_handle_resource_id_[handle_index])
-							{
-								// Handleへのアクセスタイプから次のrhiステートを決定.
-								rhi::EResourceState next_state = {};
-								if(AccessType::RENDER_TARGET == handle.access)
-								{
-									next_state = rhi::EResourceState::RenderTarget;
-								}
-								else if(AccessType::DEPTH_TARGET == handle.access)
-								{
-									next_state = rhi::EResourceState::DepthWrite;
-								}
-								else if(AccessType::UAV == handle.access)
-								{
-									next_state = rhi::EResourceState::UnorderedAccess;
-								}
-								else if(AccessType::SHADER_READ == handle.access)
-								{
-									next_state = rhi::EResourceState::ShaderRead;
-								}
-								else
-								{
-									assert(false);
-								}
-							
-								// このリソースに対してこのnode時点では cur_state -> next_state となる.
-								CompiledBuilder::NodeHandleState node_handle_state = {};
-								{
-									node_handle_state.prev_ = curr_state;
-									node_handle_state.curr_ = next_state;
-								}
-								// Node毎のHandle時点での前回ステートと現在ステートを確定.
-								compiled_.node_handle_state_[p_node][handle.handle] = node_handle_state;
-							
-								// 次へ.
-								curr_state = next_state;
-								break;
-							}
-						}
-					}
-
-					// 最終ステートを保存.
-					if(!res_id.detail.is_external)
-					{
-						auto* p_resource = p_compiled_manager_->GetInternalResourcePtr(res_id.detail.resource_id);
-						// Compile前のステートを保持.
-						p_resource->prev_cached_state_ = p_resource->cached_state_;
-						// Compile後のステートに更新.
-						p_resource->cached_state_ = curr_state;
-					}
-					else
-					{
-						// Compile前のステートを保持.
-						imported_resource_[res_id.detail.resource_id].prev_cached_state_
-						= imported_resource_[res_id.detail.resource_id].cached_state_;
-					
-						// Compile後のステートに更新.
-						imported_resource_[res_id.detail.resource_id].cached_state_ = curr_state;
+						return p_compiled_manager_->GetInternalResourcePtr(resource.resource_id)->cached_state_;
 					}
+					// 外部リソースの場合は登録された開始ステートから開始.
+					return imported_resource_[resource.resource_id].cached_state_;
+				};
+				RtgScheduleResourceState(canonical_graph, schedule.handle_assign, get_begin_state, schedule.resource_state, schedule.access_state);
+				for(auto& e : schedule.resource_state)
+				{
+					if(!e.resource.is_external)
+						e.resource_serial = p_compiled_manager_->GetInternalResourcePtr(e.resource.resource_id)->serial_;
 				}
+
+				ApplyResourceStateSchedule(canonical_graph, schedule.resource_state, schedule.access_state);
 			}
 
 			// Managerに次フレームへ伝搬するリソースを指示する.
-			for(auto e : propagate_next_handle_)
+			PropagateCompiledResourceToNextFrame();
+
+			// スケジュールをキャッシュに登録.
+			if(compile_cache.IsEnable())
 			{
-				const RtgResourceHandle handle(e.first);
-				if(compiled_.handle_2_linear_index_.end() == compiled_.handle_2_linear_index_.find(handle))
-				{
-					// ありえないのでassert.
-					assert(false);
-					continue;
-				}
-				const int handle_id = compiled_.handle_2_linear_index_[handle];
-				if(compiled_.linear_handle_resource_id_[handle_id].detail.is_external)
+				if(is_verify_cached_schedule)
 				{
-					// フレーム伝搬は内部リソースのみ許可.
-					assert(false);
-					continue;
+					const bool is_equivalent = RtgIsEquivalentSchedule(verify_schedule, schedule);
+					if(!is_equivalent)
+					{
+						std::cout << "[RenderTaskGraphBuilder][CompileCache] キャッシュされたスケジュールが通常のCompile結果と一致しません." << std::endl;
+					}
+					compile_cache.ReportVerify(is_equivalent);
 				}
-				// Handleと割当リソースIDをマネージャにフレーム伝搬指示.
-				p_compiled_manager_->PropagateResourceToNextFrame(handle, compiled_.linear_handle_resource_id_[handle_id].detail.resource_id);
+				compile_cache.Store(canonical_graph, schedule);
 			}
 			
 			// デバッグ表示.
@@ -944,9 +910,282 @@ namespace ngl
 			}
 #endif
 			
+			compile_cache.ReportCompile(false, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compile_begin).count());
 			return true;
 		}
 
+		// 出力に到達しないNodeをシーケンスから除外し, 残ったNodeの実行Queueを決定する.
+		void RenderTaskGraphBuilder::ScheduleNode()
+		{
+			auto& manager = *p_compiled_manager_;
+			
+			// シーケンスからNode毎のスケジュール用情報とアクセスを収集.
+			RtgCanonicalGraph schedule_graph = {};
+			std::vector<RtgNodeScheduleInfo> node_info = {};
+			auto build_schedule_graph = [this, &schedule_graph, &node_info]()
+			{
+				schedule_graph.Reset();
+				node_info.clear();
+				for(const auto* p_node : node_sequence_)
+				{
+					RtgNodeScheduleInfo info = {};
+					info.is_compute = (ETaskType::COMPUTE == p_node->TaskType());
+					info.is_async_eligible = info.is_compute && static_cast<const IComputeTaskNode*>(p_node)->IsAsyncComputeEligible();
+					info.is_side_effect = p_node->IsSideEffect();
+					info.cost_hint = p_node->GetGpuCostHint();
+					node_info.push_back(info);
+
+					schedule_graph.AddNode(info.is_compute);
+					// リソースのRecordをしないTaskも存在する場合がある.
+					const auto find_it = node_handle_usage_list_.find(p_node);
+					if(node_handle_usage_list_.end() == find_it)
+						continue;
+					for(const auto& res_access : find_it->second)
+					{
+						schedule_graph.AddAccess(res_access.handle, res_access.access, RtgIsWriteAccess(res_access.access), RtgAccessTypeToResourceState(res_access.access));
+					}
+				}
+			};
+			build_schedule_graph();
+			const int num_record_node = static_cast<int>(node_sequence_.size());
+
+			// カリング. 外部リソースへの書き込みと次フレームへ伝搬するハンドルへのアクセスを出力とする.
+			if(manager.is_node_culling_enable_)
+			{
+				std::vector<ERtgHandleCullType> handle_cull_type(schedule_graph.NumHandle(), ERtgHandleCullType::Transient);
+				for(int handle_index = 0; handle_index < schedule_graph.NumHandle(); ++handle_index)
+				{
+					const RtgResourceHandle handle(schedule_graph.GetHandle(handle_index));
+					if(propagate_next_handle_.end() != propagate_next_handle_.find(handle))
+						handle_cull_type[handle_index] = ERtgHandleCullType::Persistent;
+					else if(handle.detail.is_external || handle.detail.is_swapchain)
+						handle_cull_type[handle_index] = ERtgHandleCullType::Output;
+				}
+				
+				std::vector<u8> node_alive = {};
+				if(RtgCullNode(schedule_graph, node_info, handle_cull_type, node_alive) < num_record_node)
+				{
+					std::vector<ITaskNode*> alive_sequence = {};
+					for(int node_i = 0; node_i < num_record_node; ++node_i)
+					{
+						if(node_alive[node_i])
+							alive_sequence.push_back(node_sequence_[node_i]);
+						else
+							culled_node_array_.push_back(node_sequence_[node_i]);// Render処理は実行されない.
+					}
+					node_sequence_ = std::move(alive_sequence);
+					build_schedule_graph();
+				}
+			}
+
+			// 実行Queue. 自動配置が無効であればComputeのNodeは全てAsyncCompute.
+			std::vector<u8> node_async = {};
+			if(manager.is_async_compute_placement_enable_)
+			{
+				RtgAssignNodeQueue(schedule_graph, node_info, manager.queue_placement_desc_, node_async);
+			}
+			compiled_.node_queue_.resize(node_sequence_.size(), ETaskType::GRAPHICS);
+			for(int node_i = 0; node_i < node_sequence_.size(); ++node_i)
+			{
+				const bool is_async = node_info[node_i].is_compute && (node_async.empty() || node_async[node_i]);
+				compiled_.node_queue_[node_i] = is_async? ETaskType::COMPUTE : ETaskType::GRAPHICS;
+			}
+
+			// 統計.
+			{
+				std::scoped_lock lock(manager.node_schedule_stat_mutex_);
+				auto& stat = manager.node_schedule_stat_;
+				stat.num_node += num_record_node;
+				stat.num_culled += num_record_node - static_cast<int>(node_sequence_.size());
+				stat.num_compute += static_cast<u32>(std::count_if(node_info.begin(), node_info.end(), [](const RtgNodeScheduleInfo& e){ return e.is_compute; }));
+				stat.num_async_compute += static_cast<u32>(std::count(compiled_.node_queue_.begin(), compiled_.node_queue_.end(), ETaskType::COMPUTE));
+			}
+		}
+
+		// Compileキャッシュ用の正規化Graphを構築.
+		//	構造(Nodeの実行Queueと順序, Node毎のハンドルアクセス)に加えて, Compile結果に影響するリソース定義と外部リソースのステートをシグネチャに含める.
+		void RenderTaskGraphBuilder::BuildCanonicalGraph(RtgCanonicalGraph& out_graph) const
+		{
+			out_graph.Reset();
+			for(int node_i = 0; node_i < node_sequence_.size(); ++node_i)
+			{
+				const auto* p_node = node_sequence_[node_i];
+				// Nodeのタイプではなく実行Queueで依存関係が決まる.
+				out_graph.AddNode(ETaskType::COMPUTE == compiled_.node_queue_[node_i]);
+				
+				// リソースのRecordをしないTaskも存在する場合がある.
+				const auto find_it = node_handle_usage_list_.find(p_node);
+				if(node_handle_usage_list_.end() == find_it)
+					continue;
+				for(const auto& res_access : find_it->second)
+				{
+					out_graph.AddAccess(res_access.handle, res_access.access, RtgIsWriteAccess(res_access.access), RtgAccessTypeToResourceState(res_access.access));
+				}
+			}
+
+			// ハンドル毎の種別とリソース定義. 上位2bitが種別(0:内部, 1:外部, 2:他Graphからの伝搬), 次の1bitが次フレームへの伝搬指定.
+			for(int handle_index = 0; handle_index < out_graph.NumHandle(); ++handle_index)
+			{
+				const RtgResourceHandle handle(out_graph.GetHandle(handle_index));
+				const u64 propagate_bit = (propagate_next_handle_.end() != propagate_next_handle_.find(handle))? (1ull << 61) : 0;
+				
+				if(handle.detail.is_external || handle.detail.is_swapchain)
+				{
+					const auto find_it = imported_handle_2_index_.find(handle);
+					const int ex_res_index = (imported_handle_2_index_.end() != find_it)? find_it->second : -1;
+					out_graph.AddSignature((1ull << 62) | propagate_bit | static_cast<u32>(ex_res_index));
+					if(0 <= ex_res_index)
+					{
+						const auto& ex_res = imported_resource_[ex_res_index];
+						out_graph.AddSignature((static_cast<u64>(ex_res.require_begin_state_) << 32) | static_cast<u64>(ex_res.require_end_state_));
+					}
+				}
+				else if(const auto find_it = handle_2_desc_.find(handle); handle_2_desc_.end() != find_it)
+				{
+					out_graph.AddSignature(propagate_bit);
+					out_graph.AddSignature(find_it->second.storage.a);
+					out_graph.AddSignature(find_it->second.storage.b);
+				}
+				else
+				{
+					out_graph.AddSignature((2ull << 62) | propagate_bit);
+				}
+			}
+			out_graph.AddSignature((static_cast<u64>(res_base_width_) << 32) | static_cast<u32>(res_base_height_));
+			out_graph.AddSignature(imported_resource_.size());
+			out_graph.AddSignature(propagate_next_handle_.size());
+			
+			out_graph.Finalize();
+		}
+
+		// キャッシュされたスケジュールが現在のリソースプールと伝搬リソースの状態に適用可能か.
+		bool RenderTaskGraphBuilder::IsApplicableCompiledSchedule(const RtgCanonicalGraph& graph, const RtgCompiledSchedule& schedule) const
+		{
+			if(graph.NumHandle() != static_cast<int>(schedule.handle_assign.size()))
+				return false;
+
+			// 他のGraphから伝搬されたハンドルは現在の伝搬リソースと同じ割当であること. ヒストリバッファのフリップ等で毎フレーム変わり得る.
+			std::vector<int> propagated_resource_id = {};
+			for(int handle_index = 0; handle_index < graph.NumHandle(); ++handle_index)
+			{
+				const RtgResourceHandle handle(graph.GetHandle(handle_index));
+				if(handle.detail.is_external || handle.detail.is_swapchain || (handle_2_desc_.end() != handle_2_desc_.find(handle)))
+					continue;
+
+				const auto& assign = schedule.handle_assign[handle_index];
+				const int resource_id = p_compiled_manager_->FindPropagatedResourceId(handle);
+				if(assign.is_external || assign.resource_id != resource_id)
+					return false;
+				if(0 <= resource_id)
+					propagated_resource_id.push_back(resource_id);
+			}
+
+			// 割当リソースが存在し, Compile時点のステートがキャッシュと同じであること.
+			for(const auto& e : schedule.resource_state)
+			{
+				if(e.resource.is_external)
+				{
+					if(static_cast<int>(imported_resource_.size()) <= e.resource.resource_id || imported_resource_[e.resource.resource_id].cached_state_ != e.begin_state)
+						return false;
+					continue;
+				}
+				
+				const auto* p_resource = p_compiled_manager_->GetInternalResourcePtr(e.resource.resource_id);
+				if(!p_resource || !p_resource->IsValid() || p_resource->serial_ != e.resource_serial || p_resource->cached_state_ != e.begin_state)
+					return false;
+				// 伝搬リソースとして予約されているリソースは, そのハンドル以外には割り当てられない.
+				if(TaskStage::k_endmost_stage().step_ == p_resource->last_access_stage_.step_
+					&& propagated_resource_id.end() == std::find(propagated_resource_id.begin(), propagated_resource_id.end(), e.resource.resource_id))
+					return false;
+			}
+			return true;
+		}
+
+		// キャッシュされたスケジュールでCompile結果を構築する.
+		//	依存関係解析, リソース割当, ステート遷移の決定をスキップし, このGraphのハンドルと外部リソース, 伝搬リソースへの再バインドのみ行う.
+		void RenderTaskGraphBuilder::ApplyCompiledSchedule(const RtgCanonicalGraph& graph, const RtgCompiledSchedule& schedule)
+		{
+			compiled_.node_dependency_fence_ = schedule.node_dependency;
+			
+			compiled_.linear_handle_resource_id_.resize(graph.NumHandle(), CompiledBuilder::CompiledResourceInfo::k_invalid());
+			for(int handle_index = 0; handle_index < graph.NumHandle(); ++handle_index)
+			{
+				compiled_.linear_handle_resource_id_[handle_index].detail.resource_id = schedule.handle_assign[handle_index].resource_id;
+				compiled_.linear_handle_resource_id_[handle_index].detail.is_external = schedule.handle_assign[handle_index].is_external;
+			}
+
+			ApplyResourceStateSchedule(graph, schedule.resource_state, schedule.access_state);
+			PropagateCompiledResourceToNextFrame();
+		}
+		
+		// スケジュールのステート遷移をNode毎のHandle状態とリソースのキャッシュステートへ反映.
+		void RenderTaskGraphBuilder::ApplyResourceStateSchedule(const RtgCanonicalGraph& graph, const std::vector<RtgResourceStateSchedule>& resource_state, const std::vector<RtgAccessState>& access_state)
+		{
+			// Node毎のHandle時点での前回ステートと現在ステートを確定.
+			for(int node_i = 0; node_i < graph.NumNode(); ++node_i)
+			{
+				const ITaskNode* p_node = node_sequence_[node_i];
+				for(int access_i = graph.GetNodeAccessBegin(node_i); access_i < graph.GetNodeAccessEnd(node_i); ++access_i)
+				{
+					if(!access_state[access_i].is_valid)
+						continue;
+
+					CompiledBuilder::NodeHandleState node_handle_state = {};
+					{
+						node_handle_state.prev_ = access_state[access_i].prev;
+						node_handle_state.curr_ = access_state[access_i].curr;
+					}
+					compiled_.node_handle_state_[p_node][graph.GetHandle(graph.GetAccess(access_i).handle_index)] = node_handle_state;
+				}
+			}
+
+			// 最終ステートを保存.
+			for(const auto& e : resource_state)
+			{
+				if(!e.resource.is_external)
+				{
+					auto* p_resource = p_compiled_manager_->GetInternalResourcePtr(e.resource.resource_id);
+					// Compile前のステートを保持.
+					p_resource->prev_cached_state_ = p_resource->cached_state_;
+					// Compile後のステートに更新.
+					p_resource->cached_state_ = e.end_state;
+				}
+				else
+				{
+					// Compile前のステートを保持.
+					imported_resource_[e.resource.resource_id].prev_cached_state_
+					= imported_resource_[e.resource.resource_id].cached_state_;
+				
+					// Compile後のステートに更新.
+					imported_resource_[e.resource.resource_id].cached_state_ = e.end_state;
+				}
+			}
+		}
+
+		// 次フレームへ伝搬するハンドルの割当リソースをManagerに登録.
+		void RenderTaskGraphBuilder::PropagateCompiledResourceToNextFrame()
+		{
+			for(auto e : propagate_next_handle_)
+			{
+				const RtgResourceHandle handle(e.first);
+				if(compiled_.handle_2_linear_index_.end() == compiled_.handle_2_linear_index_.find(handle))
+				{
+					// ありえないのでassert.
+					assert(false);
+					continue;
+				}
+				const int handle_id = compiled_.handle_2_linear_index_[handle];
+				if(compiled_.linear_handle_resource_id_[handle_id].detail.is_external)
+				{
+					// フレーム伝搬は内部リソースのみ許可.
+					assert(false);
+					continue;
+				}
+				// Handleと割当リソースIDをマネージャにフレーム伝搬指示.
+				p_compiled_manager_->PropagateResourceToNextFrame(handle, compiled_.linear_handle_resource_id_[handle_id].detail.resource_id);
+			}
+		}
+
 		RtgAllocatedResourceInfo RenderTaskGraphBuilder::GetAllocatedResource(const ITaskNode* node, RtgResourceHandle res_handle) const
 		{	
 			// Compileされていないかチェック.
@@ -1031,6 +1270,7 @@ namespace ngl
 			RtgSubmitCommandSet* out_command_set,
 			thread::JobSystem* p_job_system)
 		{
+			NGL_PROFILE_SCOPE("RenderTaskGraphBuilder::Execute");
 			// Compileされていないチェック.
 			if(!IsExecutable())
 			{
@@ -1124,11 +1364,32 @@ namespace ngl
 			std::vector<std::vector<rhi::CommandListBaseDep*>> node_commandlists = {};
 			node_commandlists.resize(node_sequence_.size());
 
+			// Node毎のGPUタイムスタンプの開始クエリ. 計測しない場合は k_rtg_gpu_timestamp_invalid_query.
+			auto& gpu_timestamp_tracker = p_compiled_manager_->gpu_timestamp_tracker_;
+			auto& gpu_timestamp_backend = p_compiled_manager_->gpu_timestamp_backend_;
+			const u32 gpu_timestamp_slot = gpu_timestamp_tracker.GetCurrentFrameSlot();
+			const u32 gpu_timestamp_query_begin[k_rtg_gpu_timestamp_queue_count] =
+			{
+				gpu_timestamp_tracker.NumAllocatedQuery(ERtgGpuTimestampQueue::Graphics),
+				gpu_timestamp_tracker.NumAllocatedQuery(ERtgGpuTimestampQueue::Compute),
+			};
+			std::vector<u32> node_timestamp_query(node_sequence_.size(), k_rtg_gpu_timestamp_invalid_query);
+			auto write_node_begin_timestamp = [&](const ITaskNode* p_node, int node_index, ERtgGpuTimestampQueue queue, rhi::CommandListBaseDep* p_command_list)
+			{
+				node_timestamp_query[node_index] = gpu_timestamp_tracker.AllocateNodeQuery(queue, p_node->GetDebugNodeName().Get());
+				if(k_rtg_gpu_timestamp_invalid_query != node_timestamp_query[node_index])
+				{
+					gpu_timestamp_backend.WriteTimestamp(p_command_list, queue, gpu_timestamp_slot, node_timestamp_query[node_index]);
+				}
+			};
+
 			// TaskのレンダリングタスクのJob実行リスト.
 			std::vector< std::function<void(void)> > render_jobs{}; 
 			for (const auto& e : node_sequence_)
 			{
 				const int node_index = GetNodeSequencePosition(e);
+				// Compileで決定した実行Queue. ComputeのNodeがGraphicsに配置される場合がある.
+				const bool is_compute_queue = (ETaskType::COMPUTE == compiled_.node_queue_[node_index]);
 
 				if(ETaskType::GRAPHICS == e->TaskType())
 				{
@@ -1143,6 +1404,8 @@ namespace ngl
 						p_compiled_manager_->GetNewFrameCommandList(p_cmdlist);
 						node_commandlists[node_index].push_back(p_cmdlist);// Node別CommandListArrayに登録.
 						p_cmdlist->Begin();// CommandLList Begin. Endは別途実行.
+						// Node開始のタイムスタンプ. 状態遷移も含めて計測する.
+						write_node_begin_timestamp(e, node_index, ERtgGpuTimestampQueue::Graphics, p_cmdlist);
 
 						// Task用の先頭CommandListに自動解決ステート遷移コマンド積み込み.
 						generate_barrier_command(e, p_cmdlist);
@@ -1154,6 +1417,47 @@ namespace ngl
 							// TaskNodeはそれぞれ自身のポインタをキーとして適切なシグネチャのLambdaを登録する.
 							if(auto render_func = node_function_graphics_.find(e); render_func != node_function_graphics_.end())
 							{
+								NGL_PROFILE_SCOPE_DYNAMIC(e->GetDebugNodeName().Get());
+								render_func->second(*this, task_command_list_allocator);// 登録されていれば実行.
+							}
+						};
+						// JobリストにTaskのレンダリング処理を登録.
+						render_jobs.push_back(render_func);
+					}
+				}
+				else if(ETaskType::COMPUTE == e->TaskType() && !is_compute_queue)
+				{
+					// Graphics Queueへ配置されたCompute.
+					//	同一Queueのため状態遷移はそのまま先行するGraphicsCommandListで発行し, Fenceは不要.
+					{
+						rhi::GraphicsCommandListDep* p_cmdlist = {};
+						p_compiled_manager_->GetNewFrameCommandList(p_cmdlist);
+						node_commandlists[node_index].push_back(p_cmdlist);// Node別CommandListArrayに登録.
+						p_cmdlist->Begin();// CommandLList Begin. Endは別途実行.
+						// Node開始のタイムスタンプ. 状態遷移も含めて計測する.
+						write_node_begin_timestamp(e, node_index, ERtgGpuTimestampQueue::Graphics, p_cmdlist);
+
+						// Task用の先頭CommandListに自動解決ステート遷移コマンド積み込み.
+						generate_barrier_command(e, p_cmdlist);
+					}
+					{
+						const auto num_pre_system_commandlist = node_commandlists[node_index].size();// ステート遷移コマンド用のGraphicsCommandList分の 1.
+						
+						// ComputeTask用にDirectタイプのCompute CommandListを取得.
+						rhi::DirectComputeCommandListDep* p_cmdlist = {};
+						p_compiled_manager_->GetNewFrameCommandList(p_cmdlist);
+						node_commandlists[node_index].push_back(p_cmdlist);// Node別CommandListArrayに登録.
+						p_cmdlist->Begin();// CommandLList Begin. Endは別途実行.
+						
+						// Task用CommandList確保用のアロケータセットアップ. 追加のCommandListもDirectタイプで確保する.
+						TaskComputeCommandListAllocator task_command_list_allocator(&node_commandlists[node_index], (int)num_pre_system_commandlist, p_compiled_manager_, true);
+					
+						auto render_func = [this, e, task_command_list_allocator]()
+						{
+							// TaskNodeはそれぞれ自身のポインタをキーとして適切なシグネチャのLambdaを登録する.
+							if(auto render_func = node_function_compute_.find(e); render_func != node_function_compute_.end())
+							{
+								NGL_PROFILE_SCOPE_DYNAMIC(e->GetDebugNodeName().Get());
 								render_func->second(*this, task_command_list_allocator);// 登録されていれば実行.
 							}
 						};
@@ -1186,6 +1490,8 @@ namespace ngl
 						p_compiled_manager_->GetNewFrameCommandList(p_cmdlist);
 						node_commandlists[node_index].push_back(p_cmdlist);// Node別CommandListArrayに登録.
 						p_cmdlist->Begin();// CommandLList Begin. Endは別途実行.
+						// Node開始のタイムスタンプ. Graphics側の状態遷移は含まない.
+						write_node_begin_timestamp(e, node_index, ERtgGpuTimestampQueue::Compute, p_cmdlist);
 						
 						// Task用CommandList確保用のアロケータセットアップ. Task毎のCommandList配列を割り当てて必要であれば内部で追加する.
 						TaskComputeCommandListAllocator task_command_list_allocator(&node_commandlists[node_index], (int)num_pre_system_commandlist, p_compiled_manager_);
@@ -1195,6 +1501,7 @@ namespace ngl
 							// TaskNodeはそれぞれ自身のポインタをキーとして適切なシグネチャのLambdaを登録する.
 							if(auto render_func = node_function_compute_.find(e); render_func != node_function_compute_.end())
 							{
+								NGL_PROFILE_SCOPE_DYNAMIC(e->GetDebugNodeName().Get());
 								render_func->second(*this, task_command_list_allocator);// 登録されていれば実行.
 							}
 						};
@@ -1209,6 +1516,7 @@ namespace ngl
 			}
 
 			// Task群のジョブ実行.
+			execute_job_system_ = p_job_system;
 			if(p_job_system)
 			{
 				// Parallel.
@@ -1225,7 +1533,26 @@ namespace ngl
 					job();
 				}
 			}
+			execute_job_system_ = {};
 
+			// Node終了のタイムスタンプ. Nodeの最後のCommandListに積む. ComputeのNodeでも末尾は必ずCompute CommandList.
+			for(int node_index = 0; node_index < node_commandlists.size(); ++node_index)
+			{
+				if(k_rtg_gpu_timestamp_invalid_query == node_timestamp_query[node_index])
+					continue;
+
+				const auto queue = (ETaskType::GRAPHICS == compiled_.node_queue_[node_index])? ERtgGpuTimestampQueue::Graphics : ERtgGpuTimestampQueue::Compute;
+				const auto& per_node_list = node_commandlists[node_index];
+				for(auto it = per_node_list.rbegin(); it != per_node_list.rend(); ++it)
+				{
+					if(*it)
+					{
+						gpu_timestamp_backend.WriteTimestamp(*it, queue, gpu_timestamp_slot, node_timestamp_query[node_index] + 1);
+						break;
+					}
+				}
+			}
+			
 			// Taskが積み込みをした全CommandListをEnd.
 			for(auto& per_node_list : node_commandlists)
 			{
@@ -1239,15 +1566,44 @@ namespace ngl
 				}
 			}
 
+			// このExecuteで記録したタイムスタンプをリードバックバッファへ解決するコマンドを積む.
+			//	解決完了の判定用に, このCommandListの後でQueueが発行するSignalを返す. 記録が無い場合は無効.
+			auto resolve_gpu_timestamp = [&](ERtgGpuTimestampQueue queue, rhi::CommandListBaseDep* p_command_list) -> RtgSubmitCommandSequenceElem
+			{
+				RtgSubmitCommandSequenceElem signal_elem = {};
+				const u32 query_begin = gpu_timestamp_query_begin[static_cast<int>(queue)];
+				const u32 query_end = gpu_timestamp_tracker.NumAllocatedQuery(queue);
+				if(query_end <= query_begin)
+					return signal_elem;
+
+				signal_elem.type = ERtgSubmitCommandType::Signal;
+				signal_elem.fence = gpu_timestamp_backend.GetResolveFence(queue);
+				signal_elem.fence_value = gpu_timestamp_backend.ResolveTimestamp(p_command_list, queue, gpu_timestamp_slot, query_begin, query_end - query_begin);
+				return signal_elem;
+			};
+
 			// 外部リソースの必須最終ステートの解決.
 			rhi::GraphicsCommandListDep* ref_cmdlist_final = {};
+			RtgSubmitCommandSequenceElem gpu_timestamp_signal_graphics = {};
 			p_compiled_manager_->GetNewFrameCommandList(ref_cmdlist_final);
 			{
 				ref_cmdlist_final->Begin();
 				// 外部リソースの最終リソース解決バリア発行.
 				generate_final_barrier_for_imported_resource(imported_resource_, ref_cmdlist_final);
+				// Graphicsのタイムスタンプ解決.
+				gpu_timestamp_signal_graphics = resolve_gpu_timestamp(ERtgGpuTimestampQueue::Graphics, ref_cmdlist_final);
 				ref_cmdlist_final->End();
 			}
+			// Computeのタイムスタンプ解決. Compute Queueの末尾で実行する.
+			rhi::ComputeCommandListDep* ref_cmdlist_compute_final = {};
+			RtgSubmitCommandSequenceElem gpu_timestamp_signal_compute = {};
+			if(gpu_timestamp_query_begin[static_cast<int>(ERtgGpuTimestampQueue::Compute)] < gpu_timestamp_tracker.NumAllocatedQuery(ERtgGpuTimestampQueue::Compute))
+			{
+				p_compiled_manager_->GetNewFrameCommandList(ref_cmdlist_compute_final);
+				ref_cmdlist_compute_final->Begin();
+				gpu_timestamp_signal_compute = resolve_gpu_timestamp(ERtgGpuTimestampQueue::Compute, ref_cmdlist_compute_final);
+				ref_cmdlist_compute_final->End();
+			}
 
 			// Fence込のSubmit可能シーケンスを生成.
 			out_command_set->graphics.clear();
@@ -1279,7 +1635,7 @@ namespace ngl
 				}
 				for(int i = 0; i < node_commandlists.size(); ++i)
 				{
-					const auto queue_type = node_sequence_[i]->TaskType();
+					const auto queue_type = compiled_.node_queue_[i];
 
 					// 別のQueueを待機する.
 					if(0 <= compiled_.node_dependency_fence_[i].from)
@@ -1393,6 +1749,21 @@ namespace ngl
 				command_elem.command_list = ref_cmdlist_final;
 
 				out_command_set->graphics.push_back(command_elem);
+
+				// タイムスタンプ解決完了のSignal.
+				if(gpu_timestamp_signal_graphics.fence.IsValid())
+				{
+					out_command_set->graphics.push_back(gpu_timestamp_signal_graphics);
+				}
+			}
+			if(ref_cmdlist_compute_final)
+			{
+				RtgSubmitCommandSequenceElem command_elem = {};
+				command_elem.type = ERtgSubmitCommandType::CommandList;
+				command_elem.command_list = ref_cmdlist_compute_final;
+
+				out_command_set->compute.push_back(command_elem);
+				out_command_set->compute.push_back(gpu_timestamp_signal_compute);
 			}
 			
 			// ExecuteしたBuilderは使い捨てとすることで状態リセットの実装ミス等を回避する.
@@ -1421,6 +1792,11 @@ namespace ngl
 				}
 			}
 			node_sequence_.clear();
+			for (auto* p : culled_node_array_)
+			{
+				delete p;
+			}
+			culled_node_array_.clear();
 
 			node_function_graphics_.clear();
 			node_function_compute_.clear();
@@ -1504,7 +1880,7 @@ namespace ngl
 			submit_sequence(command_set->compute, compute_queue);
 		}
 		// --------------------------------------------------------------------------------------------------------------------
-		uint32_t RenderTaskGraphManager::s_res_handle_id_counter_ = 0;
+		std::atomic<uint32_t> RenderTaskGraphManager::s_res_handle_id_counter_ = 0;
 
 		// 破棄.
 		RenderTaskGraphManager::~RenderTaskGraphManager()
@@ -1539,9 +1915,35 @@ namespace ngl
 			// 内部用JobSystem.
 			assert(0 < job_thread_count);
 			job_system_.Init(job_thread_count);
+
+			// 内部リソースプール. 実体の生成と破棄.
+			resource_pool_.SetFunction(
+				[this](int resource_id, const RtgPoolResourceKey& key, u64& out_bytes)
+				{
+					return CreateInternalResource(resource_id, key, out_bytes);
+				},
+				[this](int resource_id)
+				{
+					// 参照カウンタをクリアして解放.
+					internal_resource_pool_[resource_id] = {};
+				});
 			
 			return true;
 		}
+
+		// TaskNode毎のGPUタイムスタンプ計測の初期化.
+		bool RenderTaskGraphManager::InitGpuTimestamp(rhi::GraphicsCommandQueueDep* p_graphics_queue, rhi::ComputeCommandQueueDep* p_compute_queue)
+		{
+			assert(nullptr != p_device_);
+			gpu_timestamp_tracker_.Finalize();
+			if(!gpu_timestamp_backend_.Initialize(p_device_, p_graphics_queue, p_compute_queue, {}))
+			{
+				std::cout << "[ERROR] RenderTaskGraphManager InitGpuTimestamp." << std::endl;
+				return false;
+			}
+			gpu_timestamp_tracker_.Initialize(&gpu_timestamp_backend_);
+			return true;
+		}
 		
 		//	フレーム開始通知. Game-Render同期中に呼び出す.
 		//		内部リソースプールの中で一定フレームアクセスされていないものを破棄するなどの処理.
@@ -1556,31 +1958,33 @@ namespace ngl
 				propagate_next_handle_temporal_.clear();
 			}
 
-			// 未使用リソースの破棄.
+			// Nodeスケジュール統計を前回フレーム分として確定.
 			{
-				// 破棄する未使用フレーム数. 1以上. 数フレームは猶予を持たせたほうが良い場合もある.
-				constexpr int unused_internal_resource_delete_frame = 1;
-				for(auto& e : internal_resource_pool_)
-				{
-					if(!e.IsValid())
-						continue;
-
-					// カウンタ加算.
-					++e.unused_frame_counter_;
+				std::scoped_lock lock(node_schedule_stat_mutex_);
+				node_schedule_stat_prev_ = node_schedule_stat_;
+				node_schedule_stat_ = {};
+			}
 
-					// 使用されずに一定フレーム経過したリソースは破棄.
-					if(unused_internal_resource_delete_frame < e.unused_frame_counter_)
-					{
-						// 参照カウンタをクリアして解放.
-						e = {};
-					}
+			// 未使用リソースと予算超過分の破棄.
+			//	前回フレームから伝搬されたリソースはこのフレームで利用されるため保持する.
+			{
+				std::vector<int> keep_resource = {};
+				for(const auto& e : propagate_next_handle_[1 - flip_propagate_next_handle_next_])
+				{
+					keep_resource.push_back(e.second);
 				}
+				resource_pool_.BeginFrame(keep_resource);
 			}
 
 			// CommandListPoolの更新.
 			{
 				commandlist_pool_.BeginFrame();
 			}
+
+			// 解決済みのGPUタイムスタンプ回収と記録用フレームスロットの切り替え.
+			{
+				gpu_timestamp_tracker_.BeginFrame();
+			}
 		}
 		
 		// タスクグラフを構築したbuilderをCompileしてリソース割当を確定する.
@@ -1588,6 +1992,7 @@ namespace ngl
 		// また, 複数のbuilderをCompileした場合はCompileした順序でExecuteが必要(確定したリソースの状態遷移コマンド実行を正しい順序で実行するために).
 		bool RenderTaskGraphManager::Compile(RenderTaskGraphBuilder& builder)
 		{
+			NGL_PROFILE_SCOPE("RenderTaskGraphManager::Compile");
 			assert(nullptr != p_device_);
 			// Compile可能チェック.
 			if(!builder.IsCompilable())
@@ -1630,15 +2035,13 @@ namespace ngl
 			// Compile実行.
 			const bool result = builder.Compile(*this);
 
-			// Compileで割り当てられた内部リソースの未使用カウンタをリセット. 外部リソースは無視すること.
+			// Compileで割り当てられた内部リソースの利用を記録. 外部リソースは無視すること.
 			{
 				for(auto& e : builder.compiled_.linear_handle_resource_id_)
 				{
 					if(!e.detail.is_external)
 					{
-						auto* p_resource = GetInternalResourcePtr(e.detail.resource_id);
-						assert(p_resource);
-						p_resource->unused_frame_counter_ = 0;// リセット.
+						resource_pool_.Touch(e.detail.resource_id);
 					}
 				}
 			}
@@ -1647,16 +2050,17 @@ namespace ngl
 		
 		uint32_t RenderTaskGraphManager::GetNewHandleId()
 		{
-			++s_res_handle_id_counter_;
-			if (0 == s_res_handle_id_counter_)
+			// 並列Setupから呼ばれるため加算結果をそのまま利用する.
+			uint32_t new_id = ++s_res_handle_id_counter_;
+			if (0 == new_id)
 			{
 				// IDが一周したことを一応チェックする.
 				std::cout << "[RenderTaskGraphManager] HandleIDが一周." << std::endl;
 				
-				++s_res_handle_id_counter_;// 0は無効ID扱いのためスキップ.
+				new_id = ++s_res_handle_id_counter_;// 0は無効ID扱いのためスキップ.
 			}
 			
-			return s_res_handle_id_counter_;
+			return new_id;
 		}
 		// Poolからリソース検索または新規生成. この関数はCompileから呼ばれるため排他.
 		int RenderTaskGraphManager::GetOrCreateResourceFromPool(ResourceSearchKey key, const TaskStage* p_access_stage_for_reuse)
@@ -1667,196 +2071,170 @@ namespace ngl
 			assert(nullptr != p_device_);
 			
 			// keyで既存リソースから検索または新規生成.
-					
-			// poolから検索.
-			int res_id = -1;
-			int empty_index = -1;
-			for(int i = 0; i < internal_resource_pool_.size(); ++i)
+			//	形式とサイズが一致し, 要求する用途(RTV,DSV,UAV,SRV)を包含するリソースが対象.
+			RtgPoolResourceKey pool_key = {};
 			{
-				// 内部リソースが未登録スロットはスキップ.
-				if(!internal_resource_pool_[i].IsValid())
-				{
-					// 後段で生成した新規リソースの登録先として空のインデックスを保持.
-					if(0 > empty_index)
-						empty_index = i;
-					
-					continue;
-				}
-				
-				// 要求アクセスステージに対してアクセス期間が終わっていなければ再利用不可能.
-				//	MEMO. 新規生成した実リソースの last_access_stage_ を負のstageで初期化しておくこと.
-				if(internal_resource_pool_[i].last_access_stage_ >= require_access_stage)
-					continue;
-				
-				// フォーマットチェック.
-				if(internal_resource_pool_[i].tex_->GetFormat() != key.format)
-					continue;
-				// 要求サイズを格納できるならOK.
-				if(internal_resource_pool_[i].tex_->GetWidth() < static_cast<uint32_t>(key.require_width_))
-					continue;
-				// 要求サイズを格納できるならOK.
-				if(internal_resource_pool_[i].tex_->GetHeight() < static_cast<uint32_t>(key.require_height_))
-					continue;
-				// RTV要求している場合.
-				if(key.usage_ & AccessTypeMask::RENDER_TARGET)
-				{
-					if(!internal_resource_pool_[i].rtv_.IsValid())
-						continue;
-				}
-				// DSV要求している場合.
-				if(key.usage_ & AccessTypeMask::DEPTH_TARGET)
-				{
-					if(!internal_resource_pool_[i].dsv_.IsValid())
-						continue;
-				}
-				// UAV要求している場合.
-				if(key.usage_ & AccessTypeMask::UAV)
-				{
-					if(!internal_resource_pool_[i].uav_.IsValid())
-						continue;
-				}
-				// SRV要求している場合.
-				if(key.usage_ & AccessTypeMask::SHADER_READ)
+				pool_key.format = key.format;
+				pool_key.width = key.require_width_;
+				pool_key.height = key.require_height_;
+				pool_key.usage = key.usage_;
+			}
+			const int res_id = resource_pool_.Acquire(pool_key,
+				[this, require_access_stage](int resource_id)
 				{
-					if(!internal_resource_pool_[i].srv_.IsValid())
-						continue;
-				}
-
-				// 再利用可能なリソース発見.
-				res_id = i;
-				break;
+					// 要求アクセスステージに対してアクセス期間が終わっていなければ再利用不可能.
+					//	MEMO. 新規生成した実リソースの last_access_stage_ を負のstageで初期化しておくこと.
+					return internal_resource_pool_[resource_id].last_access_stage_ < require_access_stage;
+				});
+			if(0 > res_id)
+			{
+				return -1;
 			}
 
-			// 新規生成.
-			if(0 > res_id)
+			// チェック
+			if(p_access_stage_for_reuse)
 			{
-				rhi::TextureDep::Desc desc = {};
-				rhi::EResourceState init_state = rhi::EResourceState::Common;
-				{
-					desc.type = rhi::ETextureType::Texture2D;// 現状2D固定.
-					desc.initial_state = init_state;
-					desc.array_size = 1;
-					desc.mip_count = 1;
-					desc.sample_count = 1;
-					desc.heap_type = rhi::EResourceHeapType::Default;
+				// アクセス期間による再利用を有効にしている場合は, 最終アクセスステージリソースは必ず引数のアクセスステージよりも前のもののはず.
+				assert(internal_resource_pool_[res_id].last_access_stage_ < (*p_access_stage_for_reuse));
+			}
+
+			return res_id;
+		}
+		// 内部リソースの実体を生成. resource_pool_ から呼ばれる.
+		bool RenderTaskGraphManager::CreateInternalResource(int resource_id, const RtgPoolResourceKey& key, u64& out_bytes)
+		{
+			rhi::TextureDep::Desc desc = {};
+			rhi::EResourceState init_state = rhi::EResourceState::Common;
+			{
+				desc.type = rhi::ETextureType::Texture2D;// 現状2D固定.
+				desc.initial_state = init_state;
+				desc.array_size = 1;
+				desc.mip_count = 1;
+				desc.sample_count = 1;
+				desc.heap_type = rhi::EResourceHeapType::Default;
+					
+				desc.format = key.format;
+				desc.width = key.width;	// MEMO 相対サイズの場合はここには縮小サイズ等が来てしまうので無駄がありそう.
+				desc.height = key.height;
+				desc.depth = 1;
 						
-					desc.format = key.format;
-					desc.width = key.require_width_;	// MEMO 相対サイズの場合はここには縮小サイズ等が来てしまうので無駄がありそう.
-					desc.height = key.require_height_;
-					desc.depth = 1;
-							
-					desc.bind_flag = 0;
-					{
-						if(key.usage_ & AccessTypeMask::RENDER_TARGET)
-							desc.bind_flag |= rhi::ResourceBindFlag::RenderTarget;
-						if(key.usage_ & AccessTypeMask::DEPTH_TARGET)
-							desc.bind_flag |= rhi::ResourceBindFlag::DepthStencil;
-						if(key.usage_ & AccessTypeMask::UAV)
-							desc.bind_flag |= rhi::ResourceBindFlag::UnorderedAccess;
-						if(key.usage_ & AccessTypeMask::SHADER_READ)
-							desc.bind_flag |= rhi::ResourceBindFlag::ShaderResource;
-					}
+				desc.bind_flag = 0;
+				{
+					if(key.usage & AccessTypeMask::RENDER_TARGET)
+						desc.bind_flag |= rhi::ResourceBindFlag::RenderTarget;
+					if(key.usage & AccessTypeMask::DEPTH_TARGET)
+						desc.bind_flag |= rhi::ResourceBindFlag::DepthStencil;
+					if(key.usage & AccessTypeMask::UAV)
+						desc.bind_flag |= rhi::ResourceBindFlag::UnorderedAccess;
+					if(key.usage & AccessTypeMask::SHADER_READ)
+						desc.bind_flag |= rhi::ResourceBindFlag::ShaderResource;
 				}
-				
-				rhi::RefTextureDep new_tex = {};
-				rhi::RefRtvDep new_rtv = {};
-				rhi::RefDsvDep new_dsv = {};
-				rhi::RefUavDep new_uav = {};
-				rhi::RefSrvDep new_srv = {};
-
-				// Texture.
-				new_tex.Reset(new rhi::TextureDep());
+			}
+			
+			rhi::RefTextureDep new_tex = {};
+			rhi::RefRtvDep new_rtv = {};
+			rhi::RefDsvDep new_dsv = {};
+			rhi::RefUavDep new_uav = {};
+			rhi::RefSrvDep new_srv = {};
+
+			// Texture.
+			new_tex.Reset(new rhi::TextureDep());
 #if defined(_DEBUG)
-				// プールインデックスを事前計算してデバッグ名を生成する.
-				const int dbg_new_res_id_ = (0 <= empty_index) ? empty_index : static_cast<int>(internal_resource_pool_.size());
-				char dbg_tex_name_[64];
-				snprintf(dbg_tex_name_, sizeof(dbg_tex_name_), "rtg_tex_%d_%dx%d", dbg_new_res_id_, key.require_width_, key.require_height_);
-				const char* dbg_tex_name_ptr_ = dbg_tex_name_;
+			// プールインデックスからデバッグ名を生成する.
+			char dbg_tex_name_[64];
+			snprintf(dbg_tex_name_, sizeof(dbg_tex_name_), "rtg_tex_%d_%dx%d", resource_id, key.width, key.height);
+			const char* dbg_tex_name_ptr_ = dbg_tex_name_;
 #else
-				const char* dbg_tex_name_ptr_ = nullptr;
+			const char* dbg_tex_name_ptr_ = nullptr;
 #endif
-				if (!new_tex->Initialize(p_device_, desc, dbg_tex_name_ptr_))
+			if (!new_tex->Initialize(p_device_, desc, dbg_tex_name_ptr_))
+			{
+				assert(false);
+				return false;
+			}
+			// Rtv.
+			if(key.usage & AccessTypeMask::RENDER_TARGET)
+			{
+				new_rtv.Reset(new rhi::RenderTargetViewDep());
+				if (!new_rtv->Initialize(p_device_, new_tex.Get(), 0, 0, 1))
 				{
 					assert(false);
-					return -1;
-				}
-				// Rtv.
-				if(key.usage_ & AccessTypeMask::RENDER_TARGET)
-				{
-					new_rtv.Reset(new rhi::RenderTargetViewDep());
-					if (!new_rtv->Initialize(p_device_, new_tex.Get(), 0, 0, 1))
-					{
-						assert(false);
-						return -1;
-					}
+					return false;
 				}
-				// Dsv.
-				if(key.usage_ & AccessTypeMask::DEPTH_TARGET)
+			}
+			// Dsv.
+			if(key.usage & AccessTypeMask::DEPTH_TARGET)
+			{
+				new_dsv.Reset(new rhi::DepthStencilViewDep());
+				if (!new_dsv->Initialize(p_device_, new_tex.Get(), 0, 0, 1))
 				{
-					new_dsv.Reset(new rhi::DepthStencilViewDep());
-					if (!new_dsv->Initialize(p_device_, new_tex.Get(), 0, 0, 1))
-					{
-						assert(false);
-						return -1;
-					}
+					assert(false);
+					return false;
 				}
-				// Uav.
-				if(key.usage_ & AccessTypeMask::UAV)
+			}
+			// Uav.
+			if(key.usage & AccessTypeMask::UAV)
+			{
+				new_uav.Reset(new rhi::UnorderedAccessViewDep());
+				if (!new_uav->InitializeRwTexture(p_device_, new_tex.Get(), 0, 0, 1))
 				{
-					new_uav.Reset(new rhi::UnorderedAccessViewDep());
-					if (!new_uav->InitializeRwTexture(p_device_, new_tex.Get(), 0, 0, 1))
-					{
-						assert(false);
-						return -1;
-					}
+					assert(false);
+					return false;
 				}
-				// Srv.
-				if(key.usage_ & AccessTypeMask::SHADER_READ)
+			}
+			// Srv.
+			if(key.usage & AccessTypeMask::SHADER_READ)
+			{
+				new_srv.Reset(new rhi::ShaderResourceViewDep());
+				if (!new_srv->InitializeAsTexture(p_device_, new_tex.Get(), 0, 1, 0, 1))
 				{
-					new_srv.Reset(new rhi::ShaderResourceViewDep());
-					if (!new_srv->InitializeAsTexture(p_device_, new_tex.Get(), 0, 1, 0, 1))
-					{
-						assert(false);
-						return -1;
-					}
+					assert(false);
+					return false;
 				}
+			}
 
-				InternalResourceInstanceInfo new_pool_elem = {};
-				{
-					// 新規生成した実リソースは最終アクセスステージを負の最大にしておく(ステージ0のリクエストに割当できるように).
-					new_pool_elem.last_access_stage_ = TaskStage::k_frontmost_stage();
-					
-					new_pool_elem.tex_ = new_tex;
-					new_pool_elem.rtv_ = new_rtv;
-					new_pool_elem.dsv_ = new_dsv;
-					new_pool_elem.uav_ = new_uav;
-					new_pool_elem.srv_ = new_srv;
-						
-					new_pool_elem.cached_state_ = new_tex->GetDesc().initial_state;// Enhanced Barrier有効時はCommonに変更済みの初期状態を取得.
-					new_pool_elem.prev_cached_state_ = new_tex->GetDesc().initial_state;
-				}
+			InternalResourceInstanceInfo new_pool_elem = {};
+			{
+				// 新規生成した実リソースは最終アクセスステージを負の最大にしておく(ステージ0のリクエストに割当できるように).
+				new_pool_elem.last_access_stage_ = TaskStage::k_frontmost_stage();
 				
-				if(0 <= empty_index)
-				{
-					res_id = empty_index;// 空きインデックスがあるためそこを利用.
-				}
-				else
-				{
-					res_id = static_cast<int>(internal_resource_pool_.size());// 新規要素ID.
-					internal_resource_pool_.push_back({});// 要素増加.
-				}
-				// 登録.
-				internal_resource_pool_[res_id] = new_pool_elem;
+				new_pool_elem.tex_ = new_tex;
+				new_pool_elem.rtv_ = new_rtv;
+				new_pool_elem.dsv_ = new_dsv;
+				new_pool_elem.uav_ = new_uav;
+				new_pool_elem.srv_ = new_srv;
+					
+				new_pool_elem.serial_ = ++internal_resource_serial_counter_;
+				new_pool_elem.cached_state_ = new_tex->GetDesc().initial_state;// Enhanced Barrier有効時はCommonに変更済みの初期状態を取得.
+				new_pool_elem.prev_cached_state_ = new_tex->GetDesc().initial_state;
 			}
-
-			// チェック
-			if(p_access_stage_for_reuse)
+			
+			// 登録. インデックスはプールのスロット番号.
+			if(internal_resource_pool_.size() <= static_cast<size_t>(resource_id))
 			{
-				// アクセス期間による再利用を有効にしている場合は, 最終アクセスステージリソースは必ず引数のアクセスステージよりも前のもののはず.
-				assert(internal_resource_pool_[res_id].last_access_stage_ < (*p_access_stage_for_reuse));
+				internal_resource_pool_.resize(resource_id + 1);// 要素増加.
 			}
+			internal_resource_pool_[resource_id] = new_pool_elem;
 
-			return res_id;
+			// 予算管理用の確保サイズ.
+			{
+				const D3D12_RESOURCE_DESC res_desc = new_tex->GetD3D12Resource()->GetDesc();
+				const D3D12_RESOURCE_ALLOCATION_INFO alloc_info = p_device_->GetD3D12Device()->GetResourceAllocationInfo(0, 1, &res_desc);
+				out_bytes = alloc_info.SizeInBytes;
+			}
+			return true;
+		}
+		// 内部リソースプールのVRAM予算と未使用リソースの破棄設定.
+		void RenderTaskGraphManager::SetResourcePoolDesc(const RtgResourcePoolDesc& desc)
+		{
+			std::scoped_lock<std::mutex> lock(compile_mutex_);
+			resource_pool_.SetDesc(desc);
+		}
+		// このフレームで未使用の内部リソースを target_bytes 以下になるまで破棄する.
+		void RenderTaskGraphManager::TrimResourcePool(u64 target_bytes)
+		{
+			std::scoped_lock<std::mutex> lock(compile_mutex_);
+			resource_pool_.Trim(target_bytes);
 		}
 		void RenderTaskGraphManager::SetInternalResourceLastAccess(int resource_id, TaskStage last_access_stage)
 		{
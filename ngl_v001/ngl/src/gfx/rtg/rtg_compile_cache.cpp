@@ -0,0 +1,582 @@
+﻿
+#include "gfx/rtg/rtg_compile_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace ngl::rtg
+{
+    namespace
+    {
+        u64 MixHash(u64 h, u64 v)
+        {
+            h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+            h ^= h >> 31;
+            h *= 0xbf58476d1ce4e5b9ull;
+            return h ^ (h >> 29);
+        }
+    }
+
+    bool RtgIsEquivalentSchedule(const RtgCompiledSchedule& a, const RtgCompiledSchedule& b)
+    {
+        if (a.node_dependency != b.node_dependency || a.access_state != b.access_state)
+            return false;
+        if (a.handle_assign.size() != b.handle_assign.size() || a.resource_state.size() != b.resource_state.size())
+            return false;
+
+        // 内部リソースはハンドル間の共有関係が一対一に対応すれば等価.
+        std::unordered_map<u64, u64> a_2_b = {};
+        std::unordered_map<u64, u64> b_2_a = {};
+        for (size_t i = 0; i < a.handle_assign.size(); ++i)
+        {
+            const auto& ra = a.handle_assign[i];
+            const auto& rb = b.handle_assign[i];
+            if (ra.IsValid() != rb.IsValid() || ra.is_external != rb.is_external)
+                return false;
+            if (!ra.IsValid())
+                continue;
+            if (ra.is_external && ra.resource_id != rb.resource_id)
+                return false;
+
+            const auto it_a = a_2_b.find(ra.Key());
+            const auto it_b = b_2_a.find(rb.Key());
+            if ((a_2_b.end() == it_a) != (b_2_a.end() == it_b))
+                return false;
+            if (a_2_b.end() == it_a)
+            {
+                a_2_b[ra.Key()] = rb.Key();
+                b_2_a[rb.Key()] = ra.Key();
+            }
+            else if (it_a->second != rb.Key())
+            {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < a.resource_state.size(); ++i)
+        {
+            const auto& ra = a.resource_state[i];
+            const auto& rb = b.resource_state[i];
+            const auto it = a_2_b.find(ra.resource.Key());
+            if (a_2_b.end() == it || it->second != rb.resource.Key())
+                return false;
+            if (ra.begin_state != rb.begin_state || ra.end_state != rb.end_state)
+                return false;
+        }
+        return true;
+    }
+
+    // --------------------------------------------------------------------------------------------------------------------
+    void RtgCanonicalGraph::Reset()
+    {
+        node_is_compute_.clear();
+        node_access_offset_.clear();
+        access_array_.clear();
+        handle_array_.clear();
+        handle_2_index_.clear();
+        user_signature_.clear();
+        signature_.clear();
+        hash_ = 0;
+    }
+
+    int RtgCanonicalGraph::AddNode(bool is_compute)
+    {
+        node_is_compute_.push_back(is_compute ? 1 : 0);
+        node_access_offset_.push_back(NumAccess());
+        return NumNode() - 1;
+    }
+
+    int RtgCanonicalGraph::AddAccess(u64 handle, int access_type, bool is_write, rhi::EResourceState state)
+    {
+        assert(0 < NumNode());
+
+        int handle_index = -1;
+        if (const auto it = handle_2_index_.find(handle); handle_2_index_.end() != it)
+        {
+            handle_index = it->second;
+        }
+        else
+        {
+            // 初出のハンドル.
+            handle_index = NumHandle();
+            handle_2_index_[handle] = handle_index;
+            handle_array_.push_back(handle);
+        }
+
+        Access access = {};
+        access.handle_index = handle_index;
+        access.access_type = access_type;
+        access.is_write = is_write;
+        access.state = state;
+        access_array_.push_back(access);
+        return handle_index;
+    }
+
+    void RtgCanonicalGraph::AddSignature(u64 value)
+    {
+        user_signature_.push_back(value);
+    }
+
+    void RtgCanonicalGraph::Finalize()
+    {
+        signature_.clear();
+        signature_.reserve(3 + node_is_compute_.size() + access_array_.size() + user_signature_.size());
+        signature_.push_back(static_cast<u64>(NumNode()));
+        signature_.push_back(static_cast<u64>(NumHandle()));
+        signature_.push_back(static_cast<u64>(NumAccess()));
+        // Node毎のタイプとアクセス数.
+        for (int i = 0; i < NumNode(); ++i)
+        {
+            signature_.push_back((static_cast<u64>(node_is_compute_[i]) << 32) | static_cast<u32>(GetNodeAccessEnd(i) - GetNodeAccessBegin(i)));
+        }
+        // アクセス毎の線形ハンドルとアクセスタイプ. ステートと書き込みはアクセスタイプから決まる.
+        for (const auto& e : access_array_)
+        {
+            signature_.push_back((static_cast<u64>(e.handle_index) << 32) | static_cast<u32>(e.access_type));
+        }
+        signature_.insert(signature_.end(), user_signature_.begin(), user_signature_.end());
+
+        u64 h = 0xcbf29ce484222325ull;
+        for (const auto v : signature_)
+            h = MixHash(h, v);
+        hash_ = h;
+    }
+
+    // --------------------------------------------------------------------------------------------------------------------
+    void RtgScheduleNodeDependency(const RtgCanonicalGraph& graph, std::vector<RtgNodeDependency>& out_dependency)
+    {
+        const int num_node = graph.NumNode();
+        out_dependency.clear();
+        out_dependency.resize(num_node);// fill -1
+
+        std::vector<RtgNodeDependency> task_dependency(num_node);// fill -1
+        // 先にGraphics-Computeの依存関係をリストアップする.
+        for (int i = 1; i < num_node; ++i)
+        {
+            const bool task_type_i = graph.IsComputeNode(i);
+
+            int nearest_dependency_index = -1;
+            // 前段のNodeを近い順に探索.
+            for (int j = i - 1; j >= 0; --j)
+            {
+                // 異なるTypeのNodeで同一Handleへアクセスしているものを探す
+                if (task_type_i == graph.IsComputeNode(j))
+                    continue;
+
+                for (int access_i = graph.GetNodeAccessBegin(i); access_i < graph.GetNodeAccessEnd(i); ++access_i)
+                {
+                    const auto& res_access_i = graph.GetAccess(access_i);
+                    for (int access_j = graph.GetNodeAccessBegin(j); access_j < graph.GetNodeAccessEnd(j); ++access_j)
+                    {
+                        const auto& res_access_j = graph.GetAccess(access_j);
+
+                        // 現状ではGraphicsとComputeで Read-Read のアクセスでは依存は発生しないものとしている.
+                        if (res_access_i.handle_index == res_access_j.handle_index
+                            && (res_access_i.is_write || res_access_j.is_write))
+                        {
+                            // 最も近い前段のNodeからの依存のみで十分なので, 最大値で探索する.
+                            nearest_dependency_index = std::max(nearest_dependency_index, j);
+                            break;
+                        }
+                    }
+                    if (0 <= nearest_dependency_index)
+                        break;// 早期break.
+                }
+                if (0 <= nearest_dependency_index)
+                    break;// 早期break.
+            }
+            if (0 <= nearest_dependency_index)
+            {
+                // 近い依存のみを更新.
+                if (0 > task_dependency[nearest_dependency_index].to
+                    || i < task_dependency[nearest_dependency_index].to)
+                {
+                    task_dependency[i].from = nearest_dependency_index;
+                    task_dependency[nearest_dependency_index].to = i;
+                }
+            }
+        }
+        // リストアップした依存関係からFenceを張るべき有効な関係を抽出する.
+        //  依存元と依存先の位置関係から意味のない依存関係を除外して有効な依存関係のみ抽出.
+        int fence_count = 0;
+        for (int type_i = 0; type_i < 2; ++type_i)
+        {
+            for (int i = 0; i < num_node; ++i)
+            {
+                if (static_cast<int>(graph.IsComputeNode(i)) != type_i)
+                    continue;// 処理対象のTypeのみ.
+
+                // 前段のNodeを探索.
+                bool is_valid_dependency = true;
+                for (int j = i - 1; j >= 0 && is_valid_dependency; --j)
+                {
+                    if (static_cast<int>(graph.IsComputeNode(j)) != type_i)
+                        continue;// 処理対象のTypeのみ.
+                    // 前方のNodeからの依存先は, 自身の依存先よりも前方であるはず. 同じか後方にあるような依存先の場合はこの依存関係iは意味が無いものとして除去する.
+                    if (task_dependency[i].from <= task_dependency[j].from)
+                    {
+                        is_valid_dependency = false;
+                    }
+                }
+                if (is_valid_dependency && 0 <= task_dependency[i].from)
+                {
+                    out_dependency[i].from = task_dependency[i].from;
+                    out_dependency[task_dependency[i].from].to = i;
+
+                    out_dependency[i].fence_id = fence_count;
+                    ++fence_count;
+                }
+            }
+        }
+    }
+
+    void RtgScheduleResourceState(const RtgCanonicalGraph& graph, const std::vector<RtgResourceAssign>& handle_assign,
+        const std::function<rhi::EResourceState(const RtgResourceAssign&)>& get_begin_state,
+        std::vector<RtgResourceStateSchedule>& out_resource_state, std::vector<RtgAccessState>& out_access_state)
+    {
+        assert(static_cast<int>(handle_assign.size()) == graph.NumHandle());
+
+        out_access_state.clear();
+        out_access_state.resize(graph.NumAccess());
+        out_resource_state.clear();
+
+        // Graph上の有効リソースをハンドル順の初出順でリストアップ.
+        std::unordered_map<u64, int> resource_2_index = {};
+        for (const auto& e : handle_assign)
+        {
+            if (!e.IsValid() || resource_2_index.end() != resource_2_index.find(e.Key()))
+                continue;
+            resource_2_index[e.Key()] = static_cast<int>(out_resource_state.size());
+
+            RtgResourceStateSchedule res_state = {};
+            res_state.resource = e;
+            res_state.begin_state = get_begin_state(e);
+            res_state.end_state = res_state.begin_state;
+            out_resource_state.push_back(res_state);
+        }
+
+        // NodeSequence順にリソース毎のステートを進める.
+        std::vector<int> last_access_node(out_resource_state.size(), -1);
+        for (int node_i = 0; node_i < graph.NumNode(); ++node_i)
+        {
+            for (int access_i = graph.GetNodeAccessBegin(node_i); access_i < graph.GetNodeAccessEnd(node_i); ++access_i)
+            {
+                const auto& access = graph.GetAccess(access_i);
+                const auto& assign = handle_assign[access.handle_index];
+                // 初回フレームの伝搬リソース等は無効なリソース.
+                if (!assign.IsValid())
+                    continue;
+
+                const int res_index = resource_2_index[assign.Key()];
+                if (node_i == last_access_node[res_index])
+                    continue;
+                last_access_node[res_index] = node_i;
+
+                // このリソースに対してこのnode時点では cur_state -> next_state となる.
+                auto& access_state = out_access_state[access_i];
+                access_state.prev = out_resource_state[res_index].end_state;
+                access_state.curr = access.state;
+                access_state.is_valid = true;
+
+                out_resource_state[res_index].end_state = access.state;
+            }
+        }
+    }
+
+    // --------------------------------------------------------------------------------------------------------------------
+    void RtgCompileCache::SetCapacity(u32 capacity)
+    {
+        capacity_ = std::max(1u, capacity);
+        while (capacity_ < entry_array_.size())
+        {
+            const auto it = std::min_element(entry_array_.begin(), entry_array_.end(), [](const Entry& a, const Entry& b) { return a.last_use_tick < b.last_use_tick; });
+            entry_array_.erase(it);
+        }
+    }
+
+    const RtgCompiledSchedule* RtgCompileCache::Find(const RtgCanonicalGraph& graph, const std::function<bool(const RtgCompiledSchedule&)>& is_applicable)
+    {
+        ++tick_;
+        bool is_rejected = false;
+        for (auto& e : entry_array_)
+        {
+            if (e.hash != graph.GetHash() || e.signature != graph.GetSignature())
+                continue;
+            if (!is_applicable(e.schedule))
+            {
+                is_rejected = true;
+                continue;
+            }
+            e.last_use_tick = tick_;
+            return &e.schedule;
+        }
+        if (is_rejected)
+        {
+            std::scoped_lock lock(stat_mutex_);
+            ++stat_.num_reject;
+        }
+        return nullptr;
+    }
+
+    void RtgCompileCache::Store(const RtgCanonicalGraph& graph, const RtgCompiledSchedule& schedule)
+    {
+        auto is_same_resource = [&schedule](const RtgCompiledSchedule& v)
+        {
+            if (v.resource_state.size() != schedule.resource_state.size())
+                return false;
+            for (size_t i = 0; i < v.resource_state.size(); ++i)
+            {
+                const auto& a = v.resource_state[i];
+                const auto& b = schedule.resource_state[i];
+                if (a.resource.Key() != b.resource.Key() || a.resource_serial != b.resource_serial || a.begin_state != b.begin_state)
+                    return false;
+            }
+            return true;
+        };
+
+        ++tick_;
+        Entry* p_entry = nullptr;
+        for (auto& e : entry_array_)
+        {
+            if (e.hash == graph.GetHash() && e.signature == graph.GetSignature() && is_same_resource(e.schedule))
+            {
+                p_entry = &e;
+                break;
+            }
+        }
+        if (!p_entry)
+        {
+            if (capacity_ <= entry_array_.size())
+            {
+                // 最も古く使われたエントリを置き換える.
+                p_entry = &*std::min_element(entry_array_.begin(), entry_array_.end(), [](const Entry& a, const Entry& b) { return a.last_use_tick < b.last_use_tick; });
+
+                std::scoped_lock lock(stat_mutex_);
+                ++stat_.num_evict;
+            }
+            else
+            {
+                entry_array_.push_back({});
+                p_entry = &entry_array_.back();
+            }
+        }
+        p_entry->hash = graph.GetHash();
+        p_entry->signature = graph.GetSignature();
+        p_entry->schedule = schedule;
+        p_entry->last_use_tick = tick_;
+
+        std::scoped_lock lock(stat_mutex_);
+        stat_.num_entry = static_cast<u32>(entry_array_.size());
+    }
+
+    void RtgCompileCache::Clear()
+    {
+        entry_array_.clear();
+
+        std::scoped_lock lock(stat_mutex_);
+        stat_.num_entry = 0;
+    }
+
+    void RtgCompileCache::ReportCompile(bool is_hit, double elapsed_ms)
+    {
+        std::scoped_lock lock(stat_mutex_);
+        ++stat_.num_compile;
+        if (is_hit)
+        {
+            ++stat_.num_hit;
+            stat_.hit_time_ms += elapsed_ms;
+            // ヒットしなかった場合のCompile時間はミス時の平均で推定する.
+            if (0 < stat_.num_miss)
+                stat_.saved_time_ms += std::max(0.0, stat_.miss_time_ms / static_cast<double>(stat_.num_miss) - elapsed_ms);
+        }
+        else
+        {
+            ++stat_.num_miss;
+            stat_.miss_time_ms += elapsed_ms;
+        }
+    }
+
+    void RtgCompileCache::ReportVerify(bool is_equivalent)
+    {
+        std::scoped_lock lock(stat_mutex_);
+        ++stat_.num_verify;
+        if (!is_equivalent)
+            ++stat_.num_verify_mismatch;
+    }
+
+    RtgCompileCache::Statistics RtgCompileCache::GetStatistics() const
+    {
+        std::scoped_lock lock(stat_mutex_);
+        return stat_;
+    }
+
+    // --------------------------------------------------------------------------------------------------------------------
+    void TestRtgCompileCache()
+    {
+        using rhi::EResourceState;
+        constexpr int k_rt = 1, k_ds = 2, k_srv = 3, k_uav = 4;
+
+        // G0: h0 RT, h1 DS / C1: h0 SRV, h2 UAV / G2: h2 SRV, h3(外部) RT / G3: h1 SRV.
+        //  ハンドル値はフレーム毎に異なる. desc_word はリソース定義の代わり.
+        auto build_graph = [&](RtgCanonicalGraph& graph, u64 handle_base, u64 desc_word)
+        {
+            graph.Reset();
+            graph.AddNode(false);
+            graph.AddAccess(handle_base + 0, k_rt, true, EResourceState::RenderTarget);
+            graph.AddAccess(handle_base + 1, k_ds, true, EResourceState::DepthWrite);
+            graph.AddNode(true);
+            graph.AddAccess(handle_base + 0, k_srv, false, EResourceState::ShaderRead);
+            graph.AddAccess(handle_base + 2, k_uav, true, EResourceState::UnorderedAccess);
+            graph.AddNode(false);
+            graph.AddAccess(handle_base + 2, k_srv, false, EResourceState::ShaderRead);
+            graph.AddAccess(handle_base + 3, k_rt, true, EResourceState::RenderTarget);
+            graph.AddNode(false);
+            graph.AddAccess(handle_base + 1, k_srv, false, EResourceState::ShaderRead);
+            for (int i = 0; i < graph.NumHandle(); ++i)
+                graph.AddSignature(desc_word + i);
+            graph.Finalize();
+        };
+
+        // 内部リソースプールと外部リソースの模擬.
+        std::vector<EResourceState> pool_state(8, EResourceState::Common);
+        std::vector<u64> pool_serial = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        const EResourceState external_begin_state = EResourceState::Present;
+        auto get_begin_state = [&](const RtgResourceAssign& e) { return e.is_external ? external_begin_state : pool_state[e.resource_id]; };
+        auto is_applicable = [&](const std::vector<RtgResourceAssign>& require_assign, const RtgCompiledSchedule& s)
+        {
+            if (s.handle_assign.size() != require_assign.size())
+                return false;
+            for (size_t i = 0; i < require_assign.size(); ++i)
+            {
+                // 伝搬リソースの割当は現在のものと一致する必要がある.
+                if (s.handle_assign[i].Key() != require_assign[i].Key())
+                    return false;
+            }
+            for (const auto& r : s.resource_state)
+            {
+                if (r.begin_state != get_begin_state(r.resource))
+                    return false;
+                if (!r.resource.is_external && r.resource_serial != pool_serial[r.resource.resource_id])
+                    return false;
+            }
+            return true;
+        };
+        auto compile_fresh = [&](const RtgCanonicalGraph& graph, const std::vector<RtgResourceAssign>& assign, RtgCompiledSchedule& out)
+        {
+            RtgScheduleNodeDependency(graph, out.node_dependency);
+            out.handle_assign = assign;
+            RtgScheduleResourceState(graph, assign, get_begin_state, out.resource_state, out.access_state);
+            for (auto& r : out.resource_state)
+                r.resource_serial = r.resource.is_external ? 0 : pool_serial[r.resource.resource_id];
+        };
+
+        RtgCompileCache cache = {};
+        int num_verify = 0;
+        // 1フレーム分のCompile. 戻り値はヒットしたか.
+        auto compile_frame = [&](u64 handle_base, u64 desc_word, const std::vector<RtgResourceAssign>& assign)
+        {
+            RtgCanonicalGraph graph = {};
+            build_graph(graph, handle_base, desc_word);
+
+            RtgCompiledSchedule fresh = {};
+            compile_fresh(graph, assign, fresh);
+
+            const auto* p_cached = cache.Find(graph, [&](const RtgCompiledSchedule& s) { return is_applicable(assign, s); });
+            if (p_cached)
+            {
+                // キャッシュと通常Compileの比較.
+                const bool is_equivalent = RtgIsEquivalentSchedule(*p_cached, fresh);
+                assert(is_equivalent);
+                assert(p_cached->node_dependency == fresh.node_dependency);
+                assert(p_cached->access_state == fresh.access_state);
+                cache.ReportVerify(is_equivalent);
+                ++num_verify;
+            }
+            else
+            {
+                cache.Store(graph, fresh);
+            }
+            cache.ReportCompile(nullptr != p_cached, 0.0);
+
+            const auto& applied = p_cached ? *p_cached : fresh;
+            for (const auto& r : applied.resource_state)
+            {
+                if (!r.resource.is_external)
+                    pool_state[r.resource.resource_id] = r.end_state;
+            }
+            return nullptr != p_cached;
+        };
+
+        const std::vector<RtgResourceAssign> assign_a = { {0, false}, {1, false}, {2, false}, {0, true} };
+        const std::vector<RtgResourceAssign> assign_b = { {3, false}, {1, false}, {2, false}, {0, true} };
+
+        // 依存関係. C1 は G0 の h0 書き込みを待ち, G2 は C1 の h2 書き込みを待つ.
+        {
+            RtgCanonicalGraph graph = {};
+            build_graph(graph, 100, 0);
+            assert(4 == graph.NumHandle() && 7 == graph.NumAccess());
+            std::vector<RtgNodeDependency> dependency = {};
+            RtgScheduleNodeDependency(graph, dependency);
+            assert(0 == dependency[1].from && 1 == dependency[0].to);
+            assert(1 == dependency[2].from && 2 == dependency[1].to);
+            assert(0 == dependency[2].fence_id && 1 == dependency[1].fence_id);
+            assert(0 > dependency[3].from && 0 > dependency[3].fence_id);
+
+            // ハンドル値が違っても同じ構造なら同じシグネチャ.
+            RtgCanonicalGraph graph_other = {};
+            build_graph(graph_other, 5000, 0);
+            assert(graph.GetHash() == graph_other.GetHash() && graph.GetSignature() == graph_other.GetSignature());
+            build_graph(graph_other, 5000, 1);
+            assert(graph.GetSignature() != graph_other.GetSignature());
+        }
+
+        // 初回はCommonから開始し, 2回目は前回の終了ステートから開始するためミス. 以降はヒット.
+        bool hit = false;
+        hit = compile_frame(1000, 0, assign_a); assert(!hit);
+        hit = compile_frame(1100, 0, assign_a); assert(!hit);
+        for (int frame = 2; frame < 8; ++frame)
+        {
+            hit = compile_frame(1000 + frame * 100, 0, assign_a); assert(hit);
+        }
+        // リソース定義の変更はミス.
+        hit = compile_frame(2000, 1, assign_a); assert(!hit);
+        // プールのリソースが再生成された場合は適用不可.
+        pool_serial[1] = 100;
+        hit = compile_frame(2100, 0, assign_a); assert(!hit);
+        hit = compile_frame(2200, 0, assign_a); assert(hit);
+        // 伝搬リソースのフリップで割当が交互に変わる場合も両方のエントリがヒットする.
+        int num_flip_hit = 0;
+        for (int frame = 0; frame < 8; ++frame)
+        {
+            if (compile_frame(3000 + frame * 100, 0, (frame & 1) ? assign_b : assign_a))
+                ++num_flip_hit;
+        }
+        assert(6 <= num_flip_hit);
+        (void)hit;
+
+        // 等価判定. 内部リソースIDの付け替えは等価, ステート遷移の違いは非等価.
+        {
+            RtgCanonicalGraph graph = {};
+            build_graph(graph, 100, 0);
+            RtgCompiledSchedule a = {};
+            compile_fresh(graph, assign_a, a);
+            RtgCompiledSchedule b = a;
+            for (auto& e : b.handle_assign)
+                if (!e.is_external) e.resource_id += 4;
+            for (auto& e : b.resource_state)
+                if (!e.resource.is_external) e.resource.resource_id += 4;
+            assert(RtgIsEquivalentSchedule(a, b));
+            b.handle_assign[1].resource_id = b.handle_assign[0].resource_id;// 共有関係の変化.
+            assert(!RtgIsEquivalentSchedule(a, b));
+            b = a;
+            b.access_state[2].curr = EResourceState::Common;
+            assert(!RtgIsEquivalentSchedule(a, b));
+        }
+
+        const auto stat = cache.GetStatistics();
+        const bool is_ok = (0 < num_verify) && (0 == stat.num_verify_mismatch) && (stat.num_hit == static_cast<u64>(num_verify));
+        std::cout << "[TestRtgCompileCache] hit " << stat.num_hit << "/" << stat.num_compile << " reject " << stat.num_reject << " entry " << stat.num_entry
+                  << " : " << (is_ok ? "OK" : "NG") << std::endl;
+        assert(is_ok);
+    }
+}
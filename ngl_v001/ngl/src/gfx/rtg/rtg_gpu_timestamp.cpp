@@ -0,0 +1,387 @@
+﻿
+#include "gfx/rtg/rtg_gpu_timestamp.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <utility>
+
+namespace ngl::rtg
+{
+    namespace
+    {
+        using Interval = std::pair<double, double>;
+
+        // 区間の和集合. 入力はソートされて結合される.
+        void MergeInterval(std::vector<Interval>& inout_interval)
+        {
+            std::sort(inout_interval.begin(), inout_interval.end());
+            size_t num_merged = 0;
+            for (size_t i = 0; i < inout_interval.size(); ++i)
+            {
+                if (0 < num_merged && inout_interval[i].first <= inout_interval[num_merged - 1].second)
+                {
+                    inout_interval[num_merged - 1].second = std::max(inout_interval[num_merged - 1].second, inout_interval[i].second);
+                }
+                else
+                {
+                    inout_interval[num_merged++] = inout_interval[i];
+                }
+            }
+            inout_interval.resize(num_merged);
+        }
+        double SumInterval(const std::vector<Interval>& interval)
+        {
+            double sum = 0.0;
+            for (const auto& e : interval)
+                sum += e.second - e.first;
+            return sum;
+        }
+        // 結合済みの区間同士の重なり.
+        double OverlapInterval(const std::vector<Interval>& a, const std::vector<Interval>& b)
+        {
+            double sum = 0.0;
+            size_t ia = 0, ib = 0;
+            while (ia < a.size() && ib < b.size())
+            {
+                const double begin = std::max(a[ia].first, b[ib].first);
+                const double end = std::min(a[ia].second, b[ib].second);
+                if (begin < end)
+                    sum += end - begin;
+                // 先に終わる方を進める.
+                if (a[ia].second < b[ib].second)
+                    ++ia;
+                else
+                    ++ib;
+            }
+            return sum;
+        }
+
+        // テスト用の偽バックエンド. タイムスタンプと解決完了はテスト側から設定する.
+        class RtgGpuTimestampBackendFake : public IRtgGpuTimestampBackend
+        {
+        public:
+            RtgGpuTimestampBackendFake(u32 num_frame_slot, u32 num_query_per_slot)
+                : num_frame_slot_(num_frame_slot), num_query_per_slot_(num_query_per_slot)
+            {
+                for (auto& e : timestamp_)
+                    e.resize(num_frame_slot_ * num_query_per_slot_, 0);
+                is_resolved_.resize(num_frame_slot_, false);
+
+                // Queue毎に周波数と基準の異なるクロック. 共通の時間軸はCPU時刻.
+                calibration_[static_cast<int>(ERtgGpuTimestampQueue::Graphics)] = { 1000, 1000000, 5000000 };   // 1tick = 1us.
+                calibration_[static_cast<int>(ERtgGpuTimestampQueue::Compute)] = { 70000, 2000000, 4000000 };   // 1tick = 0.5us.
+            }
+
+            u32 NumFrameSlot() const override { return num_frame_slot_; }
+            u32 NumQueryPerSlot() const override { return num_query_per_slot_; }
+            void ResetFrameSlot(u32 frame_slot) override
+            {
+                is_resolved_[frame_slot] = false;
+                ++num_reset_;
+            }
+            bool IsFrameSlotResolved(u32 frame_slot) override { return is_resolved_[frame_slot]; }
+            bool ReadTimestamp(u32 frame_slot, ERtgGpuTimestampQueue queue, u32 query_begin, u32 query_count, u64* out_timestamp) override
+            {
+                if (!is_resolved_[frame_slot] || num_query_per_slot_ < query_begin + query_count)
+                    return false;
+                const auto& src = timestamp_[static_cast<int>(queue)];
+                std::copy_n(src.begin() + frame_slot * num_query_per_slot_ + query_begin, query_count, out_timestamp);
+                return true;
+            }
+            bool GetClockCalibration(ERtgGpuTimestampQueue queue, RtgGpuClockCalibration& out_calibration) override
+            {
+                out_calibration = calibration_[static_cast<int>(queue)];
+                return true;
+            }
+
+            // CPU時刻[us]に相当するタイムスタンプをクエリに書き込む.
+            void WriteTimestamp(u32 frame_slot, ERtgGpuTimestampQueue queue, u32 query_index, double cpu_time_us)
+            {
+                const auto& c = calibration_[static_cast<int>(queue)];
+                const double tick = (cpu_time_us * 1000.0 - static_cast<double>(c.cpu_timestamp_ns)) * static_cast<double>(c.gpu_frequency) / 1.0e9;
+                timestamp_[static_cast<int>(queue)][frame_slot * num_query_per_slot_ + query_index] = c.gpu_timestamp + static_cast<u64>(static_cast<s64>(std::llround(tick)));
+            }
+            void SetResolved(u32 frame_slot) { is_resolved_[frame_slot] = true; }
+            u32 NumReset() const { return num_reset_; }
+
+        private:
+            u32 num_frame_slot_ = 0;
+            u32 num_query_per_slot_ = 0;
+            std::vector<u64> timestamp_[k_rtg_gpu_timestamp_queue_count] = {};
+            std::vector<bool> is_resolved_ = {};
+            RtgGpuClockCalibration calibration_[k_rtg_gpu_timestamp_queue_count] = {};
+            u32 num_reset_ = 0;
+        };
+    }
+
+    void RtgGpuTimestampTracker::Initialize(IRtgGpuTimestampBackend* p_backend)
+    {
+        std::scoped_lock<std::mutex> lock(mutex_);
+        p_backend_ = p_backend;
+        slot_array_.clear();
+        if (p_backend_)
+        {
+            assert(0 < p_backend_->NumFrameSlot());
+            slot_array_.resize(p_backend_->NumFrameSlot());
+        }
+        current_slot_ = 0;
+        frame_serial_ = 0;
+        num_dropped_frame_ = 0;
+        latest_result_ = {};
+    }
+    void RtgGpuTimestampTracker::Finalize()
+    {
+        Initialize(nullptr);
+    }
+
+    void RtgGpuTimestampTracker::BeginFrame()
+    {
+        if (!p_backend_)
+            return;
+
+        std::scoped_lock<std::mutex> lock(mutex_);
+        const u32 num_slot = static_cast<u32>(slot_array_.size());
+
+        // 記録していたスロットを確定.
+        {
+            auto& slot = slot_array_[current_slot_];
+            slot.is_pending = (0 < slot.frame_serial) && !slot.node_array.empty();
+        }
+
+        // 古いスロットから順に解決済みのものを回収する. 最新の結果が最後に残る.
+        for (u32 i = 1; i <= num_slot; ++i)
+        {
+            const u32 slot_index = (current_slot_ + i) % num_slot;
+            auto& slot = slot_array_[slot_index];
+            if (slot.is_pending && p_backend_->IsFrameSlotResolved(slot_index))
+            {
+                CollectFrameSlot(slot_index);
+                slot.is_pending = false;
+            }
+        }
+
+        // 次のスロットを記録用にする. 未回収の場合はそのフレームの結果を破棄.
+        current_slot_ = (current_slot_ + 1) % num_slot;
+        auto& next_slot = slot_array_[current_slot_];
+        if (next_slot.is_pending)
+            ++num_dropped_frame_;
+        next_slot.is_pending = false;
+        next_slot.frame_serial = ++frame_serial_;
+        next_slot.node_array.clear();
+        std::fill(std::begin(next_slot.num_query), std::end(next_slot.num_query), 0u);
+        next_slot.num_dropped_node = 0;
+        p_backend_->ResetFrameSlot(current_slot_);
+    }
+
+    u32 RtgGpuTimestampTracker::AllocateNodeQuery(ERtgGpuTimestampQueue queue, const char* node_name)
+    {
+        // 最初のBeginFrameまでは記録しない.
+        if (!p_backend_ || !is_enable_ || 0 == frame_serial_)
+            return k_rtg_gpu_timestamp_invalid_query;
+
+        std::scoped_lock<std::mutex> lock(mutex_);
+        auto& slot = slot_array_[current_slot_];
+        u32& num_query = slot.num_query[static_cast<int>(queue)];
+        if (p_backend_->NumQueryPerSlot() < num_query + 2)
+        {
+            ++slot.num_dropped_node;
+            return k_rtg_gpu_timestamp_invalid_query;
+        }
+
+        NodeRecord record = {};
+        record.name = node_name;
+        record.queue = queue;
+        record.query_index = num_query;
+        slot.node_array.push_back(record);
+
+        num_query += 2;
+        return record.query_index;
+    }
+
+    u32 RtgGpuTimestampTracker::NumAllocatedQuery(ERtgGpuTimestampQueue queue) const
+    {
+        if (slot_array_.empty())
+            return 0;
+        return slot_array_[current_slot_].num_query[static_cast<int>(queue)];
+    }
+
+    void RtgGpuTimestampTracker::CollectFrameSlot(u32 frame_slot)
+    {
+        const auto& slot = slot_array_[frame_slot];
+
+        // Queue毎のタイムスタンプを共通のCPU時刻[ns]に変換する.
+        RtgGpuClockCalibration calibration[k_rtg_gpu_timestamp_queue_count] = {};
+        for (int q = 0; q < k_rtg_gpu_timestamp_queue_count; ++q)
+        {
+            const auto queue = static_cast<ERtgGpuTimestampQueue>(q);
+            if (0 == slot.num_query[q])
+                continue;
+
+            work_timestamp_[q].resize(slot.num_query[q]);
+            if (!p_backend_->ReadTimestamp(frame_slot, queue, 0, slot.num_query[q], work_timestamp_[q].data())
+                || !p_backend_->GetClockCalibration(queue, calibration[q])
+                || 0 == calibration[q].gpu_frequency)
+            {
+                return;
+            }
+        }
+        auto to_cpu_ns = [&](int q, u64 timestamp) -> double
+        {
+            const auto& c = calibration[q];
+            const double delta_tick = static_cast<double>(static_cast<s64>(timestamp - c.gpu_timestamp));
+            return static_cast<double>(c.cpu_timestamp_ns) + delta_tick * (1.0e9 / static_cast<double>(c.gpu_frequency));
+        };
+
+        RtgGpuTimestampFrameResult result = {};
+        result.is_valid = true;
+        result.frame_serial = slot.frame_serial;
+        result.num_dropped_node = slot.num_dropped_node;
+        result.node_array.resize(slot.node_array.size());
+
+        std::vector<Interval> queue_interval[k_rtg_gpu_timestamp_queue_count];
+        double base_ns = 0.0;
+        double last_ns = 0.0;
+        for (size_t i = 0; i < slot.node_array.size(); ++i)
+        {
+            const auto& record = slot.node_array[i];
+            const int q = static_cast<int>(record.queue);
+            const double begin_ns = to_cpu_ns(q, work_timestamp_[q][record.query_index]);
+            // 異常値で終了が開始より前になった場合は長さ0とする.
+            const double end_ns = std::max(begin_ns, to_cpu_ns(q, work_timestamp_[q][record.query_index + 1]));
+
+            base_ns = (0 == i) ? begin_ns : std::min(base_ns, begin_ns);
+            last_ns = (0 == i) ? end_ns : std::max(last_ns, end_ns);
+            queue_interval[q].push_back({ begin_ns, end_ns });
+
+            auto& node = result.node_array[i];
+            node.name = record.name;
+            node.queue = record.queue;
+            node.begin_ms = begin_ns;
+            node.end_ms = end_ns;
+        }
+
+        constexpr double k_ns_to_ms = 1.0 / 1000000.0;
+        for (auto& node : result.node_array)
+        {
+            node.begin_ms = (node.begin_ms - base_ns) * k_ns_to_ms;
+            node.end_ms = (node.end_ms - base_ns) * k_ns_to_ms;
+            node.duration_ms = node.end_ms - node.begin_ms;
+        }
+        result.frame_span_ms = (last_ns - base_ns) * k_ns_to_ms;
+
+        for (int q = 0; q < k_rtg_gpu_timestamp_queue_count; ++q)
+        {
+            MergeInterval(queue_interval[q]);
+            result.queue_busy_ms[q] = SumInterval(queue_interval[q]) * k_ns_to_ms;
+        }
+        result.queue_overlap_ms = OverlapInterval(queue_interval[static_cast<int>(ERtgGpuTimestampQueue::Graphics)], queue_interval[static_cast<int>(ERtgGpuTimestampQueue::Compute)]) * k_ns_to_ms;
+
+        latest_result_ = std::move(result);
+    }
+
+    void TestRtgGpuTimestamp()
+    {
+        bool is_ok = true;
+        const auto is_near = [](double a, double b) { return std::abs(a - b) < 1.0e-6; };
+        constexpr auto k_graphics = ERtgGpuTimestampQueue::Graphics;
+        constexpr auto k_compute = ERtgGpuTimestampQueue::Compute;
+
+        // 3スロットのリング, スロット毎Queue毎に4Node分のクエリ.
+        RtgGpuTimestampBackendFake backend(3, 8);
+        RtgGpuTimestampTracker tracker;
+        tracker.Initialize(&backend);
+
+        // 最初のBeginFrameまでは割り当てない.
+        is_ok &= (k_rtg_gpu_timestamp_invalid_query == tracker.AllocateNodeQuery(k_graphics, "Early"));
+
+        // フレーム1. Queue毎に0から2つずつ割り当て, 不足分は計測無しとする.
+        tracker.BeginFrame();
+        const u32 slot1 = tracker.GetCurrentFrameSlot();
+        is_ok &= (1 == slot1) && (1 == backend.NumReset());
+        {
+            struct NodeDesc
+            {
+                const char* name;
+                ERtgGpuTimestampQueue queue;
+                double begin_us;
+                double end_us;
+                u32 expect_query;
+            };
+            const NodeDesc node_desc[] =
+            {
+                { "GBuffer", k_graphics, 100.0, 400.0, 0 },
+                { "Ssao", k_compute, 300.0, 700.0, 0 },
+                { "Lighting", k_graphics, 500.0, 900.0, 2 },
+                { "Blur", k_compute, 800.0, 1000.0, 2 },
+                { "Post", k_graphics, 900.0, 950.0, 4 },
+                { "Ui", k_graphics, 950.0, 1000.0, 6 },
+            };
+            for (const auto& e : node_desc)
+            {
+                const u32 query = tracker.AllocateNodeQuery(e.queue, e.name);
+                is_ok &= (e.expect_query == query);
+                backend.WriteTimestamp(slot1, e.queue, query, e.begin_us);
+                backend.WriteTimestamp(slot1, e.queue, query + 1, e.end_us);
+            }
+            is_ok &= (k_rtg_gpu_timestamp_invalid_query == tracker.AllocateNodeQuery(k_graphics, "Overflow"));
+            is_ok &= (8 == tracker.NumAllocatedQuery(k_graphics)) && (4 == tracker.NumAllocatedQuery(k_compute));
+
+            // 無効時は割り当てない.
+            tracker.SetEnable(false);
+            is_ok &= (k_rtg_gpu_timestamp_invalid_query == tracker.AllocateNodeQuery(k_compute, "Disabled"));
+            is_ok &= (4 == tracker.NumAllocatedQuery(k_compute));
+            tracker.SetEnable(true);
+        }
+
+        // フレーム2. フレーム1のスロットは未解決のため結果はまだ無い.
+        tracker.BeginFrame();
+        is_ok &= (2 == tracker.GetCurrentFrameSlot()) && (0 == tracker.NumAllocatedQuery(k_graphics));
+        is_ok &= !tracker.GetLatestResult().is_valid;
+
+        // フレーム3. GPU上でフレーム1の解決が完了した後に回収される.
+        backend.SetResolved(slot1);
+        tracker.BeginFrame();
+        const u32 slot3 = tracker.GetCurrentFrameSlot();
+        is_ok &= (0 == slot3);
+        {
+            const auto& result = tracker.GetLatestResult();
+            is_ok &= result.is_valid && (1 == result.frame_serial) && (6 == result.node_array.size()) && (1 == result.num_dropped_node);
+
+            // Node毎の時間. 最初のNodeの開始が基準で, Queue間のクロック差は吸収される.
+            const double expect_node[][2] =
+            {
+                { 0.0, 0.3 }, { 0.2, 0.6 }, { 0.4, 0.8 }, { 0.7, 0.9 }, { 0.8, 0.85 }, { 0.85, 0.9 },
+            };
+            for (size_t i = 0; i < result.node_array.size() && i < std::size(expect_node); ++i)
+            {
+                const auto& node = result.node_array[i];
+                is_ok &= is_near(expect_node[i][0], node.begin_ms) && is_near(expect_node[i][1], node.end_ms);
+                is_ok &= is_near(expect_node[i][1] - expect_node[i][0], node.duration_ms);
+            }
+            is_ok &= (text::HashText<64>("Lighting") == result.node_array[2].name) && (k_compute == result.node_array[3].queue);
+
+            // Graphicsは [100,400] [500,1000], Computeは [300,700] [800,1000] で稼働.
+            is_ok &= is_near(0.9, result.frame_span_ms);
+            is_ok &= is_near(0.8, result.queue_busy_ms[static_cast<int>(k_graphics)]) && is_near(0.6, result.queue_busy_ms[static_cast<int>(k_compute)]);
+            is_ok &= is_near(0.5, result.queue_overlap_ms);
+        }
+
+        // フレーム3は解決されないままリングを一周すると破棄され, 結果はフレーム1のまま.
+        tracker.AllocateNodeQuery(k_compute, "Lost");
+        tracker.BeginFrame();
+        tracker.BeginFrame();
+        is_ok &= (0 == tracker.NumDroppedFrame());
+        tracker.BeginFrame();
+        is_ok &= (slot3 == tracker.GetCurrentFrameSlot()) && (1 == tracker.NumDroppedFrame());
+        is_ok &= (1 == tracker.GetLatestResult().frame_serial) && (6 == backend.NumReset());
+
+        tracker.Finalize();
+        is_ok &= !tracker.IsValid() && (k_rtg_gpu_timestamp_invalid_query == tracker.AllocateNodeQuery(k_graphics, "Finalized"));
+
+        std::cout << "[TestRtgGpuTimestamp]";
+        std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+        assert(is_ok);
+    }
+}
@@ -0,0 +1,147 @@
+﻿
+#include "gfx/rtg/rtg_gpu_timestamp_dep.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace ngl::rtg
+{
+    RtgGpuTimestampBackendDep::~RtgGpuTimestampBackendDep()
+    {
+        Finalize();
+    }
+
+    bool RtgGpuTimestampBackendDep::Initialize(rhi::DeviceDep* p_device, rhi::GraphicsCommandQueueDep* p_graphics_queue, rhi::ComputeCommandQueueDep* p_compute_queue, const Desc& desc)
+    {
+        assert(p_device && p_graphics_queue && p_compute_queue);
+        desc_ = desc;
+        desc_.num_frame_slot = std::max(desc_.num_frame_slot, 2u);
+        desc_.num_query_per_slot = std::max(desc_.num_query_per_slot, 2u);
+
+        const u32 num_query_total = desc_.num_frame_slot * desc_.num_query_per_slot;
+        for (int q = 0; q < k_rtg_gpu_timestamp_queue_count; ++q)
+        {
+            auto& res = queue_resource_[q];
+            res.p_command_queue = (static_cast<int>(ERtgGpuTimestampQueue::Graphics) == q) ? p_graphics_queue->GetD3D12CommandQueue() : p_compute_queue->GetD3D12CommandQueue();
+
+            // TimestampクエリはDirectとComputeのどちらのCommandListでも利用可能.
+            D3D12_QUERY_HEAP_DESC heap_desc = {};
+            heap_desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+            heap_desc.Count = num_query_total;
+            heap_desc.NodeMask = 0;
+            if (FAILED(p_device->GetD3D12Device()->CreateQueryHeap(&heap_desc, IID_PPV_ARGS(&res.query_heap))))
+            {
+                std::cout << "[ERROR] Create Rtg Timestamp QueryHeap" << std::endl;
+                assert(false);
+                return false;
+            }
+
+            rhi::BufferDep::Desc readback_desc = {};
+            readback_desc.initial_state = rhi::EResourceState::CopyDst;
+            readback_desc.heap_type = rhi::EResourceHeapType::Readback;
+            readback_desc.element_byte_size = sizeof(u64);
+            readback_desc.element_count = num_query_total;
+            res.readback_buffer.Reset(new rhi::BufferDep());
+            if (!res.readback_buffer->Initialize(p_device, readback_desc))
+            {
+                std::cout << "[ERROR] Initialize Rtg Timestamp Readback Buffer" << std::endl;
+                assert(false);
+                return false;
+            }
+
+            resolve_fence_[q].Reset(new rhi::FenceDep());
+            if (!resolve_fence_[q]->Initialize(p_device))
+            {
+                std::cout << "[ERROR] Initialize Rtg Timestamp Fence" << std::endl;
+                assert(false);
+                return false;
+            }
+        }
+
+        slot_resolve_fence_value_.assign(desc_.num_frame_slot, {});
+        return true;
+    }
+
+    void RtgGpuTimestampBackendDep::Finalize()
+    {
+        for (auto& e : queue_resource_)
+            e = {};
+        for (auto& e : resolve_fence_)
+            e = {};
+        slot_resolve_fence_value_.clear();
+    }
+
+    void RtgGpuTimestampBackendDep::ResetFrameSlot(u32 frame_slot)
+    {
+        slot_resolve_fence_value_[frame_slot] = {};
+    }
+
+    bool RtgGpuTimestampBackendDep::IsFrameSlotResolved(u32 frame_slot)
+    {
+        for (int q = 0; q < k_rtg_gpu_timestamp_queue_count; ++q)
+        {
+            const u64 fence_value = slot_resolve_fence_value_[frame_slot][q];
+            if (0 == fence_value)
+                continue;
+            if (resolve_fence_[q]->GetD3D12Fence()->GetCompletedValue() < fence_value)
+                return false;
+        }
+        return true;
+    }
+
+    bool RtgGpuTimestampBackendDep::ReadTimestamp(u32 frame_slot, ERtgGpuTimestampQueue queue, u32 query_begin, u32 query_count, u64* out_timestamp)
+    {
+        auto& res = queue_resource_[static_cast<int>(queue)];
+        assert(query_begin + query_count <= desc_.num_query_per_slot);
+
+        const u64* p_mapped = res.readback_buffer->MapAs<u64>();
+        if (!p_mapped)
+            return false;
+        const u32 offset = frame_slot * desc_.num_query_per_slot + query_begin;
+        std::copy(p_mapped + offset, p_mapped + offset + query_count, out_timestamp);
+        res.readback_buffer->Unmap();
+        return true;
+    }
+
+    bool RtgGpuTimestampBackendDep::GetClockCalibration(ERtgGpuTimestampQueue queue, RtgGpuClockCalibration& out_calibration)
+    {
+        auto* p_command_queue = queue_resource_[static_cast<int>(queue)].p_command_queue;
+        UINT64 gpu_frequency = 0;
+        UINT64 gpu_timestamp = 0;
+        UINT64 cpu_timestamp = 0;
+        if (FAILED(p_command_queue->GetTimestampFrequency(&gpu_frequency)) || FAILED(p_command_queue->GetClockCalibration(&gpu_timestamp, &cpu_timestamp)))
+            return false;
+
+        // CPU側はQueryPerformanceCounter.
+        LARGE_INTEGER cpu_frequency = {};
+        QueryPerformanceFrequency(&cpu_frequency);
+
+        out_calibration.gpu_frequency = gpu_frequency;
+        out_calibration.gpu_timestamp = gpu_timestamp;
+        out_calibration.cpu_timestamp_ns = static_cast<u64>(static_cast<double>(cpu_timestamp) * (1.0e9 / static_cast<double>(cpu_frequency.QuadPart)));
+        return true;
+    }
+
+    void RtgGpuTimestampBackendDep::WriteTimestamp(rhi::CommandListBaseDep* p_command_list, ERtgGpuTimestampQueue queue, u32 frame_slot, u32 query_index)
+    {
+        assert(query_index < desc_.num_query_per_slot);
+        auto& res = queue_resource_[static_cast<int>(queue)];
+        p_command_list->GetD3D12GraphicsCommandList()->EndQuery(res.query_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frame_slot * desc_.num_query_per_slot + query_index);
+    }
+
+    u64 RtgGpuTimestampBackendDep::ResolveTimestamp(rhi::CommandListBaseDep* p_command_list, ERtgGpuTimestampQueue queue, u32 frame_slot, u32 query_begin, u32 query_count)
+    {
+        assert(query_begin + query_count <= desc_.num_query_per_slot);
+        const int q = static_cast<int>(queue);
+        auto& res = queue_resource_[q];
+
+        const u32 offset = frame_slot * desc_.num_query_per_slot + query_begin;
+        p_command_list->GetD3D12GraphicsCommandList()->ResolveQueryData(res.query_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, offset, query_count,
+            res.readback_buffer->GetD3D12Resource(), static_cast<UINT64>(offset) * sizeof(u64));
+
+        // 同じフレームスロットに複数回解決する場合は最後のSignalで完了判定する.
+        const u64 fence_value = resolve_fence_[q]->IncrementHelperFenceValue();
+        slot_resolve_fence_value_[frame_slot][q] = fence_value;
+        return fence_value;
+    }
+}
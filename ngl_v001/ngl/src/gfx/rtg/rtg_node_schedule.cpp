@@ -0,0 +1,375 @@
+﻿#include "gfx/rtg/rtg_node_schedule.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <numeric>
+
+namespace ngl::rtg
+{
+    namespace
+    {
+        // Node間の依存関係. 同一ハンドルへのアクセスで一方が書き込みであれば依存.
+        void BuildNodeDependencyList(const RtgCanonicalGraph& graph, std::vector<std::vector<int>>& out_pred, std::vector<std::vector<int>>& out_succ)
+        {
+            const int num_node = graph.NumNode();
+            out_pred.assign(num_node, {});
+            out_succ.assign(num_node, {});
+
+            // ハンドル毎のアクセス列(Node順).
+            std::vector<std::vector<std::pair<int, bool>>> handle_access(graph.NumHandle());
+            for (int node_i = 0; node_i < num_node; ++node_i)
+            {
+                for (int access_i = graph.GetNodeAccessBegin(node_i); access_i < graph.GetNodeAccessEnd(node_i); ++access_i)
+                {
+                    const auto& access = graph.GetAccess(access_i);
+                    handle_access[access.handle_index].push_back({ node_i, access.is_write });
+                }
+            }
+            for (const auto& list : handle_access)
+            {
+                for (size_t i = 0; i < list.size(); ++i)
+                {
+                    for (size_t j = i + 1; j < list.size(); ++j)
+                    {
+                        if (list[i].first == list[j].first || !(list[i].second || list[j].second))
+                            continue;
+                        out_pred[list[j].first].push_back(list[i].first);
+                        out_succ[list[i].first].push_back(list[j].first);
+                    }
+                }
+            }
+            auto make_unique = [](std::vector<int>& v)
+            {
+                std::sort(v.begin(), v.end());
+                v.erase(std::unique(v.begin(), v.end()), v.end());
+            };
+            for (auto& v : out_pred)
+                make_unique(v);
+            for (auto& v : out_succ)
+                make_unique(v);
+        }
+    }
+
+    int RtgCullNode(const RtgCanonicalGraph& graph, const std::vector<RtgNodeScheduleInfo>& node_info,
+        const std::vector<ERtgHandleCullType>& handle_cull_type, std::vector<u8>& out_node_alive)
+    {
+        const int num_node = graph.NumNode();
+        assert(static_cast<int>(node_info.size()) == num_node);
+        assert(static_cast<int>(handle_cull_type.size()) == graph.NumHandle());
+
+        out_node_alive.assign(num_node, 0);
+        // 後段の生存Nodeがアクセスするハンドル.
+        std::vector<u8> handle_required(graph.NumHandle(), 0);
+        int num_alive = 0;
+        // 終端から逆順に, 出力又は後段の生存Nodeへ書き込みが到達するかを判定.
+        for (int node_i = num_node - 1; node_i >= 0; --node_i)
+        {
+            bool is_alive = node_info[node_i].is_side_effect;
+            bool has_write = false;
+            for (int access_i = graph.GetNodeAccessBegin(node_i); access_i < graph.GetNodeAccessEnd(node_i) && !is_alive; ++access_i)
+            {
+                const auto& access = graph.GetAccess(access_i);
+                const auto cull_type = handle_cull_type[access.handle_index];
+                if (ERtgHandleCullType::Persistent == cull_type)
+                    is_alive = true;
+                if (!access.is_write)
+                    continue;
+                has_write = true;
+                if (ERtgHandleCullType::Output == cull_type || handle_required[access.handle_index])
+                    is_alive = true;
+            }
+            // RTGで記録された書き込みが無いNodeは外部への副作用があるものとする.
+            if (!is_alive && has_write)
+                continue;
+
+            out_node_alive[node_i] = 1;
+            ++num_alive;
+            for (int access_i = graph.GetNodeAccessBegin(node_i); access_i < graph.GetNodeAccessEnd(node_i); ++access_i)
+            {
+                handle_required[graph.GetAccess(access_i).handle_index] = 1;
+            }
+        }
+        return num_alive;
+    }
+
+    int RtgAssignNodeQueue(const RtgCanonicalGraph& graph, const std::vector<RtgNodeScheduleInfo>& node_info,
+        const RtgQueuePlacementDesc& desc, std::vector<u8>& out_node_async)
+    {
+        const int num_node = graph.NumNode();
+        assert(static_cast<int>(node_info.size()) == num_node);
+
+        out_node_async.assign(num_node, 0);
+
+        std::vector<std::vector<int>> pred = {};
+        std::vector<std::vector<int>> succ = {};
+        BuildNodeDependencyList(graph, pred, succ);
+
+        auto is_candidate = [&](int node_i) { return node_info[node_i].is_compute && node_info[node_i].is_async_eligible; };
+
+        // 依存関係で連結したAsyncCompute可能Nodeのグループ. グループ内の依存はCompute Queue内で完結するためFence不要.
+        std::vector<int> group_root(num_node);
+        std::iota(group_root.begin(), group_root.end(), 0);
+        auto find_root = [&](int i)
+        {
+            while (group_root[i] != i)
+            {
+                group_root[i] = group_root[group_root[i]];
+                i = group_root[i];
+            }
+            return i;
+        };
+        for (int node_i = 0; node_i < num_node; ++node_i)
+        {
+            if (!is_candidate(node_i))
+                continue;
+            for (const int p : pred[node_i])
+            {
+                if (is_candidate(p))
+                    group_root[find_root(node_i)] = find_root(p);
+            }
+        }
+
+        // 先頭のNode順にグループ単位で判定. 判定済みのグループの配置を以降の判定に反映する. 未判定のNodeはGraphicsとして見積もる.
+        std::vector<u8> is_decided(num_node, 0);
+        std::vector<int> group_member = {};
+        std::vector<u8> is_member(num_node, 0);
+        int num_async = 0;
+        for (int head_i = 0; head_i < num_node; ++head_i)
+        {
+            if (!is_candidate(head_i) || is_decided[head_i])
+                continue;
+
+            const int root = find_root(head_i);
+            group_member.clear();
+            for (int node_i = head_i; node_i < num_node; ++node_i)
+            {
+                if (is_candidate(node_i) && root == find_root(node_i))
+                {
+                    group_member.push_back(node_i);
+                    is_member[node_i] = 1;
+                    is_decided[node_i] = 1;
+                }
+            }
+
+            // グループ外のGraphics上のNodeとの依存からFence数と並行実行可能な範囲を求める.
+            auto is_graphics = [&](int node_i) { return !is_member[node_i] && !out_node_async[node_i]; };
+            float group_cost = 0.0f;
+            int num_fence = 0;
+            int window_begin = -1;      // 最後に待つGraphics Node.
+            int window_end = num_node;  // 最初に待たせるGraphics Node.
+            for (const int m : group_member)
+            {
+                group_cost += node_info[m].cost_hint;
+
+                bool need_wait = false;
+                for (const int p : pred[m])
+                {
+                    if (!is_graphics(p))
+                        continue;
+                    need_wait = true;
+                    window_begin = std::max(window_begin, p);
+                }
+                bool need_signal = false;
+                for (const int s : succ[m])
+                {
+                    if (!is_graphics(s))
+                        continue;
+                    need_signal = true;
+                    window_end = std::min(window_end, s);
+                }
+                num_fence += (need_wait ? 1 : 0) + (need_signal ? 1 : 0);
+            }
+            float overlap_cost = 0.0f;
+            for (int node_i = window_begin + 1; node_i < window_end; ++node_i)
+            {
+                if (is_graphics(node_i))
+                    overlap_cost += node_info[node_i].cost_hint;
+            }
+
+            // Graphics側と重なって隠蔽できる負荷がFenceのコストを上回る場合のみAsyncCompute.
+            const float benefit = std::min(group_cost, overlap_cost) - desc.fence_cost * static_cast<float>(num_fence);
+            const bool is_async = (0.0f < benefit);
+            for (const int m : group_member)
+            {
+                out_node_async[m] = is_async ? 1 : 0;
+                is_member[m] = 0;
+            }
+            if (is_async)
+                num_async += static_cast<int>(group_member.size());
+        }
+        return num_async;
+    }
+
+    // --------------------------------------------------------------------------------------------------------------------
+    void TestRtgNodeSchedule()
+    {
+        using rhi::EResourceState;
+        constexpr int k_rt = 1, k_srv = 3, k_uav = 4;
+
+        struct TestAccess
+        {
+            int     handle = 0;
+            bool    is_write = false;
+        };
+        struct TestNode
+        {
+            RtgNodeScheduleInfo     info = {};
+            std::vector<TestAccess> access = {};
+        };
+        auto graphics_node = [](float cost, std::vector<TestAccess> access) { TestNode n = {}; n.info.cost_hint = cost; n.access = access; return n; };
+        auto compute_node = [](float cost, bool is_eligible, std::vector<TestAccess> access)
+        {
+            TestNode n = {};
+            n.info.is_compute = true;
+            n.info.is_async_eligible = is_eligible;
+            n.info.cost_hint = cost;
+            n.access = access;
+            return n;
+        };
+        // node_async が空でなければその配置でGraphを構築する.
+        auto build_graph = [&](RtgCanonicalGraph& graph, std::vector<RtgNodeScheduleInfo>& info, const std::vector<TestNode>& node, const std::vector<u8>& node_async)
+        {
+            graph.Reset();
+            info.clear();
+            for (size_t i = 0; i < node.size(); ++i)
+            {
+                graph.AddNode(node_async.empty() ? node[i].info.is_compute : (0 != node_async[i]));
+                for (const auto& a : node[i].access)
+                {
+                    const int access_type = a.is_write ? (node[i].info.is_compute ? k_uav : k_rt) : k_srv;
+                    const EResourceState state = a.is_write ? (node[i].info.is_compute ? EResourceState::UnorderedAccess : EResourceState::RenderTarget) : EResourceState::ShaderRead;
+                    graph.AddAccess(static_cast<u64>(a.handle), access_type, a.is_write, state);
+                }
+                info.push_back(node[i].info);
+            }
+            graph.Finalize();
+        };
+        auto cull = [&](const std::vector<TestNode>& node, const std::vector<std::pair<int, ERtgHandleCullType>>& special_handle)
+        {
+            RtgCanonicalGraph graph = {};
+            std::vector<RtgNodeScheduleInfo> info = {};
+            build_graph(graph, info, node, {});
+            std::vector<ERtgHandleCullType> handle_type(graph.NumHandle(), ERtgHandleCullType::Transient);
+            for (const auto& e : special_handle)
+                handle_type[graph.GetHandleIndexMap().at(static_cast<u64>(e.first))] = e.second;
+            std::vector<u8> alive = {};
+            RtgCullNode(graph, info, handle_type, alive);
+            return alive;
+        };
+        // キュー配置と, その配置でのQueue間Fence数.
+        auto assign = [&](const std::vector<TestNode>& node, std::vector<u8>& out_async, int& out_num_fence)
+        {
+            RtgCanonicalGraph graph = {};
+            std::vector<RtgNodeScheduleInfo> info = {};
+            build_graph(graph, info, node, {});
+            const int num_async = RtgAssignNodeQueue(graph, info, RtgQueuePlacementDesc{}, out_async);
+
+            build_graph(graph, info, node, out_async);
+            std::vector<RtgNodeDependency> dependency = {};
+            RtgScheduleNodeDependency(graph, dependency);
+            out_num_fence = static_cast<int>(std::count_if(dependency.begin(), dependency.end(), [](const RtgNodeDependency& e) { return 0 <= e.from; }));
+            return num_async;
+        };
+
+        // ハンドル. 10:外部出力, 11:次フレームへ伝搬, その他は内部.
+        constexpr int h_out = 10, h_history = 11;
+        bool is_ok = true;
+        auto check = [&](bool result, const char* name)
+        {
+            if (!result)
+                std::cout << "[TestRtgNodeSchedule] NG : " << name << std::endl;
+            is_ok = is_ok && result;
+        };
+
+        // カリング.
+        {
+            // G0:0 / G1:0->1 (未使用) / G2:1->2 (未使用) / G3:0->out / G4:読み込みのみ / G5:3 (副作用) / G6:4 (未使用) / G7:0->history.
+            std::vector<TestNode> node = {
+                graphics_node(1, { {0, true} }),
+                graphics_node(1, { {0, false}, {1, true} }),
+                graphics_node(1, { {1, false}, {2, true} }),
+                graphics_node(1, { {0, false}, {h_out, true} }),
+                graphics_node(1, { {0, false} }),
+                graphics_node(1, { {3, true} }),
+                graphics_node(1, { {4, true} }),
+                graphics_node(1, { {0, false}, {h_history, true} }),
+            };
+            node[5].info.is_side_effect = true;
+            const auto alive = cull(node, { {h_out, ERtgHandleCullType::Output}, {h_history, ERtgHandleCullType::Persistent} });
+            check(alive == std::vector<u8>({ 1, 0, 0, 1, 1, 1, 0, 1 }), "cull chain");
+
+            // 後段の生存Nodeが読む前段の書き込みは連鎖して生存. 出力への書き込みでも前段の内容をロードし得るため維持.
+            node = {
+                graphics_node(1, { {0, true} }),
+                graphics_node(1, { {0, false}, {1, true} }),
+                graphics_node(1, { {h_out, true} }),
+                graphics_node(1, { {1, false}, {h_out, true} }),
+            };
+            check(cull(node, { {h_out, ERtgHandleCullType::Output} }) == std::vector<u8>({ 1, 1, 1, 1 }), "cull keep producer");
+
+            // 伝搬ハンドルは読み込みのみのアクセスでも生存.
+            node = {
+                graphics_node(1, { {h_history, false}, {1, true} }),
+            };
+            check(cull(node, { {h_history, ERtgHandleCullType::Persistent} }) == std::vector<u8>({ 1 }), "cull persistent");
+        }
+
+        // キュー配置.
+        {
+            std::vector<u8> async = {};
+            int num_fence = 0;
+
+            // G0:depth / C1:depth->ao (コスト2) / G2,G3: ao と独立 (コスト1ずつ) / G4: ao読み込み. G2,G3と重なるためAsync.
+            std::vector<TestNode> node = {
+                graphics_node(1, { {0, true} }),
+                compute_node(2, true, { {0, false}, {1, true} }),
+                graphics_node(1, { {2, true} }),
+                graphics_node(1, { {3, true} }),
+                graphics_node(1, { {1, false}, {2, false}, {3, false}, {h_out, true} }),
+            };
+            check(1 == assign(node, async, num_fence) && 1 == async[1] && 2 == num_fence, "async overlap");
+
+            // 直後のNodeが結果を待つ場合は重なる負荷が無いためGraphics.
+            node = {
+                graphics_node(1, { {0, true} }),
+                compute_node(2, true, { {0, false}, {1, true} }),
+                graphics_node(1, { {1, false}, {h_out, true} }),
+                graphics_node(1, { {2, true} }),
+            };
+            check(0 == assign(node, async, num_fence) && 0 == num_fence, "no overlap");
+
+            // AsyncCompute可能の指定が無いComputeはGraphics.
+            node = {
+                graphics_node(1, { {0, true} }),
+                compute_node(2, false, { {0, false}, {1, true} }),
+                graphics_node(4, { {2, true} }),
+                graphics_node(1, { {1, false}, {h_out, true} }),
+            };
+            check(0 == assign(node, async, num_fence), "not eligible");
+
+            // 重なる負荷がFenceのコストより小さい場合はGraphics.
+            node = {
+                graphics_node(1, { {0, true} }),
+                compute_node(0.1f, true, { {0, false}, {1, true} }),
+                graphics_node(4, { {2, true} }),
+                graphics_node(1, { {1, false}, {h_out, true} }),
+            };
+            check(0 == assign(node, async, num_fence), "fence cost");
+
+            // 依存するCompute同士はまとめてAsyncに配置し, 間のFenceを発生させない.
+            node = {
+                graphics_node(1, { {0, true} }),
+                compute_node(1, true, { {0, false}, {1, true} }),
+                graphics_node(2, { {2, true} }),
+                compute_node(1, true, { {1, false}, {4, true} }),
+                graphics_node(2, { {3, true} }),
+                graphics_node(1, { {4, false}, {2, false}, {3, false}, {h_out, true} }),
+            };
+            check(2 == assign(node, async, num_fence) && 1 == async[1] && 1 == async[3] && 2 == num_fence, "async chain");
+        }
+
+        std::cout << "[TestRtgNodeSchedule] : " << (is_ok ? "OK" : "NG") << std::endl;
+        assert(is_ok);
+    }
+}
@@ -0,0 +1,343 @@
+﻿#include "gfx/rtg/rtg_resource_pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace ngl::rtg
+{
+    void RtgResourcePool::SetFunction(const CreateFunction& create_function, const ReleaseFunction& release_function)
+    {
+        create_function_ = create_function;
+        release_function_ = release_function;
+    }
+    void RtgResourcePool::SetDesc(const RtgResourcePoolDesc& desc)
+    {
+        desc_ = desc;
+        desc_.max_unused_frame = std::max(1, desc_.max_unused_frame);
+        UpdateStatistics();
+    }
+
+    u64 RtgResourcePool::CalcBucketHash(const RtgPoolResourceKey& key)
+    {
+        u64 h = static_cast<u64>(static_cast<u32>(key.format));
+        h = (h * 0x100000001b3ull) ^ static_cast<u32>(key.width);
+        h = (h * 0x100000001b3ull) ^ static_cast<u32>(key.height);
+        h ^= h >> 31;
+        h *= 0xbf58476d1ce4e5b9ull;
+        return h ^ (h >> 29);
+    }
+
+    int RtgResourcePool::Acquire(const RtgPoolResourceKey& key, const ReusableFunction& is_reusable)
+    {
+        const u64 bucket_hash = CalcBucketHash(key);
+
+        // バケットから検索. 用途が一致するものを優先し, 無ければ用途を包含するもの.
+        if (const auto find_it = bucket_.find(bucket_hash); bucket_.end() != find_it)
+        {
+            int reuse_slot = -1;
+            for (const int slot : find_it->second)
+            {
+                const auto& e = slot_array_[slot];
+                // ハッシュ衝突.
+                if (e.key.format != key.format || e.key.width != key.width || e.key.height != key.height)
+                    continue;
+                if (0 != (key.usage & ~e.key.usage))
+                    continue;
+                if (is_reusable && !is_reusable(slot))
+                    continue;
+
+                if (e.key.usage == key.usage)
+                {
+                    reuse_slot = slot;
+                    break;
+                }
+                if (0 > reuse_slot)
+                    reuse_slot = slot;
+            }
+            if (0 <= reuse_slot)
+            {
+                Touch(reuse_slot);
+                std::scoped_lock lock(stat_mutex_);
+                ++stat_.num_hit;
+                return reuse_slot;
+            }
+        }
+
+        // 新規生成. 空きスロットは若い番号から利用する.
+        int slot = -1;
+        if (!free_slot_.empty())
+        {
+            const auto min_it = std::min_element(free_slot_.begin(), free_slot_.end());
+            slot = *min_it;
+            free_slot_.erase(min_it);
+        }
+        else
+        {
+            slot = NumSlot();
+            slot_array_.push_back({});
+        }
+
+        u64 bytes = 0;
+        if (!create_function_ || !create_function_(slot, key, bytes))
+        {
+            free_slot_.push_back(slot);
+            assert(false);
+            return -1;
+        }
+        {
+            auto& e = slot_array_[slot];
+            e.key = key;
+            e.bytes = bytes;
+            e.last_use_frame = frame_;
+            e.is_valid = true;
+        }
+        bucket_[bucket_hash].push_back(slot);
+        pool_bytes_ += bytes;
+        {
+            std::scoped_lock lock(stat_mutex_);
+            ++stat_.num_miss;
+        }
+
+        // 予算超過分はこのフレームで未使用のものから破棄.
+        if (0 < desc_.budget_bytes && desc_.budget_bytes < pool_bytes_)
+            EvictLeastRecentlyUsed(desc_.budget_bytes, true);
+
+        UpdateStatistics();
+        return slot;
+    }
+
+    void RtgResourcePool::Touch(int slot)
+    {
+        if (!IsValid(slot))
+        {
+            assert(false);
+            return;
+        }
+        slot_array_[slot].last_use_frame = frame_;
+    }
+
+    void RtgResourcePool::BeginFrame(const std::vector<int>& keep_slot)
+    {
+        ++frame_;
+        for (const int slot : keep_slot)
+        {
+            if (IsValid(slot))
+                slot_array_[slot].last_use_frame = frame_;
+        }
+
+        // 一定フレーム未使用のリソースを破棄.
+        for (int slot = 0; slot < NumSlot(); ++slot)
+        {
+            const auto& e = slot_array_[slot];
+            if (e.is_valid && static_cast<u64>(desc_.max_unused_frame) < (frame_ - e.last_use_frame))
+                Evict(slot, false);
+        }
+        // 予算超過分を破棄.
+        if (0 < desc_.budget_bytes)
+            EvictLeastRecentlyUsed(desc_.budget_bytes, true);
+
+        UpdateStatistics();
+    }
+
+    void RtgResourcePool::Trim(u64 target_bytes)
+    {
+        EvictLeastRecentlyUsed(target_bytes, false);
+        UpdateStatistics();
+    }
+
+    void RtgResourcePool::Evict(int slot, bool is_budget)
+    {
+        auto& e = slot_array_[slot];
+        assert(e.is_valid);
+
+        if (release_function_)
+            release_function_(slot);
+
+        const u64 bucket_hash = CalcBucketHash(e.key);
+        if (auto find_it = bucket_.find(bucket_hash); bucket_.end() != find_it)
+        {
+            auto& bucket = find_it->second;
+            bucket.erase(std::remove(bucket.begin(), bucket.end(), slot), bucket.end());
+            if (bucket.empty())
+                bucket_.erase(find_it);
+        }
+        pool_bytes_ -= e.bytes;
+        {
+            std::scoped_lock lock(stat_mutex_);
+            ++stat_.num_evict;
+            if (is_budget)
+                ++stat_.num_evict_budget;
+            stat_.evict_bytes += e.bytes;
+        }
+
+        e = {};
+        free_slot_.push_back(slot);
+    }
+
+    void RtgResourcePool::EvictLeastRecentlyUsed(u64 target_bytes, bool is_budget)
+    {
+        if (pool_bytes_ <= target_bytes)
+            return;
+
+        // このフレームで未使用のものが候補. 古い順, 同じフレームなら大きい順.
+        std::vector<int> candidate = {};
+        for (int slot = 0; slot < NumSlot(); ++slot)
+        {
+            const auto& e = slot_array_[slot];
+            if (e.is_valid && e.last_use_frame < frame_)
+                candidate.push_back(slot);
+        }
+        std::sort(candidate.begin(), candidate.end(), [this](int a, int b)
+            {
+                const auto& ea = slot_array_[a];
+                const auto& eb = slot_array_[b];
+                if (ea.last_use_frame != eb.last_use_frame)
+                    return ea.last_use_frame < eb.last_use_frame;
+                if (ea.bytes != eb.bytes)
+                    return ea.bytes > eb.bytes;
+                return a < b;
+            });
+        for (const int slot : candidate)
+        {
+            if (pool_bytes_ <= target_bytes)
+                break;
+            Evict(slot, is_budget);
+        }
+    }
+
+    void RtgResourcePool::UpdateStatistics()
+    {
+        u32 num_resource = 0;
+        for (const auto& e : slot_array_)
+        {
+            if (e.is_valid)
+                ++num_resource;
+        }
+        std::scoped_lock lock(stat_mutex_);
+        stat_.pool_bytes = pool_bytes_;
+        stat_.peak_bytes = std::max(stat_.peak_bytes, pool_bytes_);
+        stat_.budget_bytes = desc_.budget_bytes;
+        stat_.num_resource = num_resource;
+    }
+
+    RtgResourcePool::Statistics RtgResourcePool::GetStatistics() const
+    {
+        std::scoped_lock lock(stat_mutex_);
+        return stat_;
+    }
+
+    // --------------------------------------------------------------------------------------------------------------------
+    void TestRtgResourcePool()
+    {
+        using rhi::EResourceFormat;
+        constexpr int k_rt = 1 << 0, k_srv = 1 << 2, k_uav = 1 << 3;
+        constexpr u64 k_mb = 1024 * 1024;
+
+        // 偽のテクスチャ. 1ピクセル4byte.
+        std::vector<u64> fake_texture = {};// スロット毎のサイズ. 0は未生成.
+        int num_create = 0;
+        int num_release = 0;
+        RtgResourcePool pool = {};
+        pool.SetFunction(
+            [&](int slot, const RtgPoolResourceKey& key, u64& out_bytes)
+            {
+                if (fake_texture.size() <= static_cast<size_t>(slot))
+                    fake_texture.resize(slot + 1, 0);
+                assert(0 == fake_texture[slot]);
+                out_bytes = static_cast<u64>(key.width) * static_cast<u64>(key.height) * 4;
+                fake_texture[slot] = out_bytes;
+                ++num_create;
+                return true;
+            },
+            [&](int slot)
+            {
+                assert(0 != fake_texture[slot]);
+                fake_texture[slot] = 0;
+                ++num_release;
+            });
+        RtgResourcePoolDesc desc = {};
+        desc.budget_bytes = 0;
+        desc.max_unused_frame = 2;
+        pool.SetDesc(desc);
+
+        // 1024x1024 4byte = 4MB.
+        const RtgPoolResourceKey key_rt = { EResourceFormat::Format_R8G8B8A8_UNORM, 1024, 1024, k_rt | k_srv };
+        const RtgPoolResourceKey key_srv = { EResourceFormat::Format_R8G8B8A8_UNORM, 1024, 1024, k_srv };
+        const RtgPoolResourceKey key_uav = { EResourceFormat::Format_R8G8B8A8_UNORM, 1024, 1024, k_uav | k_srv };
+        const RtgPoolResourceKey key_half = { EResourceFormat::Format_R8G8B8A8_UNORM, 512, 512, k_rt | k_srv };
+        auto reusable_all = [](int) { return true; };
+
+        // 同一キーと用途を包含するリソースは再利用, 用途やサイズが異なるものは新規.
+        int reuse = -1;
+        const int s0 = pool.Acquire(key_rt, reusable_all);
+        reuse = pool.Acquire(key_rt, reusable_all); assert(s0 == reuse);
+        reuse = pool.Acquire(key_srv, reusable_all); assert(s0 == reuse);
+        const int s1 = pool.Acquire(key_uav, reusable_all);
+        const int s2 = pool.Acquire(key_half, reusable_all);
+        assert(s0 != s1 && s0 != s2 && s1 != s2);
+        // アクセス期間の重なり等で再利用できない場合は新規.
+        const int s3 = pool.Acquire(key_rt, [&](int slot) { return slot != s0; });
+        assert(s3 != s0);
+        // 用途を包含するリソースの再利用.
+        reuse = pool.Acquire(key_srv, [&](int slot) { return slot != s0 && slot != s3; }); assert(s1 == reuse);
+        // 用途が一致するものを包含するものより優先.
+        const int s_exact = pool.Acquire(key_srv, [](int) { return false; });
+        reuse = pool.Acquire(key_srv, reusable_all); assert(s_exact == reuse);
+        {
+            auto stat = pool.GetStatistics();
+            assert(4 == stat.num_hit && 5 == stat.num_miss);
+            assert(5 == stat.num_resource && 4 * 4 * k_mb + 1 * k_mb == stat.pool_bytes);
+            (void)stat;
+        }
+
+        // 未使用フレーム数による破棄. s0 のみ利用し続ける.
+        for (int frame = 0; frame < 3; ++frame)
+        {
+            pool.BeginFrame({});
+            pool.Touch(s0);
+        }
+        assert(pool.IsValid(s0) && !pool.IsValid(s1) && !pool.IsValid(s2) && !pool.IsValid(s3) && !pool.IsValid(s_exact));
+        assert(4 * k_mb == pool.GetStatistics().pool_bytes && 4 == num_release);
+
+        // 空きスロットは若い番号から利用.
+        const int s4 = pool.Acquire(key_half, reusable_all);
+        assert(s4 == std::min({ s1, s2, s3, s_exact }));
+
+        // 予算超過はこのフレームで未使用のものから古い順に破棄.
+        desc.budget_bytes = 10 * k_mb;
+        desc.max_unused_frame = 100;
+        pool.SetDesc(desc);
+        pool.BeginFrame({});
+        const int a = pool.Acquire(key_uav, nullptr);// 4MB. 計9MB.
+        pool.BeginFrame({});
+        pool.Touch(s4);
+        const int b = pool.Acquire(key_rt, [&](int slot) { return slot != s0; });// 4MB. 計13MB となり最も古い s0 を破棄.
+        assert(!pool.IsValid(s0) && pool.IsValid(s4) && pool.IsValid(a) && pool.IsValid(b));
+        assert(9 * k_mb == pool.GetStatistics().pool_bytes);
+        // このフレームで利用中のものは予算超過でも破棄しない.
+        pool.Touch(a);
+        const int c = pool.Acquire(key_rt, [&](int slot) { return slot != b; });
+        assert(pool.IsValid(s4) && pool.IsValid(a) && pool.IsValid(b) && pool.IsValid(c));
+        assert(13 * k_mb == pool.GetStatistics().pool_bytes);
+
+        // 次のフレーム開始で予算内に戻す. 同じフレームで最後に利用されたものは大きい順. 伝搬リソースは保持.
+        pool.BeginFrame({ c });
+        assert(!pool.IsValid(a) && pool.IsValid(b) && pool.IsValid(c) && pool.IsValid(s4));
+        assert(9 * k_mb == pool.GetStatistics().pool_bytes);
+        // 解像度変更時のTrim. このフレームで利用中以外を全て破棄.
+        pool.Trim(0);
+        assert(pool.IsValid(c) && !pool.IsValid(b) && !pool.IsValid(s4));
+        {
+            auto stat = pool.GetStatistics();
+            assert(1 == stat.num_resource && 4 * k_mb == stat.pool_bytes);
+            assert(stat.num_evict == static_cast<u64>(num_release) && 2 == stat.num_evict_budget);
+            assert(17 * k_mb == stat.peak_bytes);
+            assert(stat.num_evict + stat.num_resource == stat.num_miss && stat.num_miss == static_cast<u64>(num_create));
+            (void)stat;
+        }
+        (void)reuse; (void)s1; (void)s2; (void)s3; (void)s_exact; (void)a; (void)num_create;
+
+        std::cout << "[TestRtgResourcePool] : OK" << std::endl;
+    }
+}
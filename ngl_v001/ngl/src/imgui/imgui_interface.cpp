@@ -245,6 +245,8 @@ namespace  ngl::imgui
                             // RTV設定.
                             d3d_command_list->OMSetRenderTargets(1, &rtv_desc_handle_cpu, FALSE, nullptr);
                             d3d_command_list->SetDescriptorHeaps(1, &d3d_desc_heap);
+                            // DescriptorHeapを直接変更したため, CommandListが保持する設定状態を破棄.
+                            command_list->InvalidateDescriptorBindingState();
 
                             // ------------------------------------------------------------------------------------------
                             // Snapshotを利用して安全にRenderThreadでImGui描画.
@@ -8,124 +8,285 @@
 #include <cassert>
 #include <cstring>
 
+// BMI1/BMI2 (pdep/tzcnt) によるワード内のビット選択. MSVCでは /arch:AVX2 指定時に有効とする.
+#if ((defined(__BMI__) && defined(__BMI2__)) || (defined(_MSC_VER) && defined(__AVX2__))) && (defined(_M_X64) || defined(__x86_64__))
+#define NGL_CBT_USE_BMI2 1
+#endif
+
+#include <emmintrin.h>
+#if defined(__AVX2__) || defined(NGL_CBT_USE_BMI2)
+#include <immintrin.h>
+#endif
+
+#include "thread/job_thread.h"
+
 namespace ngl::render::app
 {
-    void ConcurrentBinaryTreeU32::Initialize(uint32_t require_leaf_count)
+    namespace
     {
-        // 以上の最小の2の冪
-        const uint32_t min_large_power_of_2 = 1u << (ngl::MostSignificantBit32(require_leaf_count-1)+1);
-        // require_leaf_countのリーフの完全二分木のノードを格納するためのサイズ.   
-        const auto required_packed_leaf_count = std::max(1u, min_large_power_of_2 >> LeafTypePackedIndexShift);
-        // 全ノードを格納可能なサイズの木の深さ と インデックス計算簡易化のため1ベースインデックスのために +2
-        const auto packed_node_depth = ngl::MostSignificantBit32(required_packed_leaf_count) + 1;
+        // 並列SumReductionの部分木あたりの最小リーフ数.
+        constexpr uint32_t k_parallel_packed_leaf_min_count = 16 * 1024;
+        // 並列SumReductionの最大分割数.
+        constexpr uint32_t k_parallel_chunk_max_count = 64;
 
-        const auto packed_node_count = 1u << packed_node_depth;
-        
-        packed_leaf_count_ = (1 << (packed_node_depth-1));
-        packed_leaf_offset_ = packed_node_count >> 1;
+        // [0, chunk_count) を実行. p_job_system が無効または1分割の場合はその場で実行.
+        template <typename FUNC>
+        void ParallelForChunk(thread::JobSystem* p_job_system, int chunk_count, const FUNC& func)
+        {
+            if (p_job_system && 1 < chunk_count)
+            {
+                for (int i = 0; i < chunk_count; ++i)
+                {
+                    p_job_system->Add([&func, i]() { func(i); });
+                }
+                p_job_system->WaitAll();
+            }
+            else
+            {
+                for (int i = 0; i < chunk_count; ++i)
+                    func(i);
+            }
+        }
+
+        // 下位から index番目 (0-based) の 1 のビット位置. 存在しなければ-1.
+        //  BMI2が有効な場合は pdep, それ以外はバイト毎のビット数の累積で対象バイトを特定してからバイト内を探索する.
+        int SelectBit1InWord(uint64_t value, uint32_t index)
+        {
+#if defined(NGL_CBT_USE_BMI2)
+            const uint64_t select_bit = (64 > index) ? _pdep_u64(uint64_t(1) << index, value) : 0;
+            return (0 != select_bit) ? static_cast<int>(_tzcnt_u64(select_bit)) : -1;
+#else
+            uint64_t count = value - ((value >> 1) & 0x5555555555555555ull);
+            count = (count & 0x3333333333333333ull) + ((count >> 2) & 0x3333333333333333ull);
+            count = (count + (count >> 4)) & 0x0f0f0f0f0f0f0f0full;
+            // 各バイトに下位バイトからの累積ビット数.
+            const uint64_t prefix_count = count * 0x0101010101010101ull;
+            if (index >= static_cast<uint32_t>(prefix_count >> 56))
+                return -1;
+
+            uint32_t byte_pos = 0;
+            uint32_t lower_count = 0;
+            for (; byte_pos < 8; ++byte_pos)
+            {
+                const uint32_t acc_count = static_cast<uint32_t>(prefix_count >> (byte_pos * 8)) & 0xff;
+                if (index < acc_count)
+                    break;
+                lower_count = acc_count;
+            }
+            index -= lower_count;
+            const uint32_t byte_value = static_cast<uint32_t>(value >> (byte_pos * 8)) & 0xff;
+            for (uint32_t bit = 0; bit < 8; ++bit)
+            {
+                if ((byte_value >> bit) & 0x1)
+                {
+                    if (0 == index)
+                        return static_cast<int>(byte_pos * 8 + bit);
+                    --index;
+                }
+            }
+            return -1;
+#endif
+        }
+
+        // SSE2のSWARによるバイト毎のビット数.
+        inline __m128i PopcountPerByte(__m128i v)
+        {
+            const __m128i mask1 = _mm_set1_epi8(0x55);
+            const __m128i mask2 = _mm_set1_epi8(0x33);
+            const __m128i mask4 = _mm_set1_epi8(0x0f);
+            v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi16(v, 1), mask1));
+            v = _mm_add_epi8(_mm_and_si128(v, mask2), _mm_and_si128(_mm_srli_epi16(v, 2), mask2));
+            return _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi16(v, 4)), mask4);
+        }
+#if defined(__AVX2__)
+        // pshufbのニブルテーブルによるバイト毎のビット数.
+        inline __m256i PopcountPerByte(__m256i v)
+        {
+            const __m256i nibble_table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                          0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+            const __m256i mask4 = _mm256_set1_epi8(0x0f);
+            const __m256i lo = _mm256_shuffle_epi8(nibble_table, _mm256_and_si256(v, mask4));
+            const __m256i hi = _mm256_shuffle_epi8(nibble_table, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask4));
+            return _mm256_add_epi8(lo, hi);
+        }
+#endif
+
+        // リーフ毎のビット数を dst に書き込む.
+        void PopcountLeaf(const uint32_t* src, uint32_t* dst, uint32_t count)
+        {
+            uint32_t i = 0;
+#if defined(__AVX2__)
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m256i byte_count = PopcountPerByte(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+                const __m256i leaf_count = _mm256_madd_epi16(_mm256_maddubs_epi16(byte_count, _mm256_set1_epi8(1)), _mm256_set1_epi16(1));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), leaf_count);
+            }
+#endif
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128i v = PopcountPerByte(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+                v = _mm_add_epi8(v, _mm_srli_epi32(v, 8));
+                v = _mm_add_epi8(v, _mm_srli_epi32(v, 16));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_and_si128(v, _mm_set1_epi32(0x3f)));
+            }
+            for (; i < count; ++i)
+                dst[i] = static_cast<uint32_t>(ngl::Count32bit(src[i]));
+        }
+        void PopcountLeaf(const uint64_t* src, uint32_t* dst, uint32_t count)
+        {
+            uint32_t i = 0;
+#if defined(__AVX2__)
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m256i byte_count = PopcountPerByte(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+                const __m256i leaf_count = _mm256_sad_epu8(byte_count, _mm256_setzero_si256());
+                const __m256i packed = _mm256_permutevar8x32_epi32(leaf_count, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_castsi256_si128(packed));
+            }
+#endif
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m128i count01 = _mm_sad_epu8(PopcountPerByte(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))), _mm_setzero_si128());
+                const __m128i count23 = _mm_sad_epu8(PopcountPerByte(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 2))), _mm_setzero_si128());
+                // 64bitレーンの下位32bitを詰める.
+                const __m128 packed = _mm_shuffle_ps(_mm_castsi128_ps(count01), _mm_castsi128_ps(count23), _MM_SHUFFLE(2, 0, 2, 0));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_castps_si128(packed));
+            }
+            for (; i < count; ++i)
+                dst[i] = static_cast<uint32_t>(ngl::Count64bit(src[i]));
+        }
+
+        // 子ノードのペアの和. dst[i] = src[2i] + src[2i+1].
+        void ReduceNodePair(const uint32_t* src, uint32_t* dst, uint32_t count)
+        {
+            uint32_t i = 0;
+#if defined(__AVX2__)
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 2));
+                const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 2 + 8));
+                // hadd は128bitレーン毎のため64bit単位で並べ直す.
+                const __m256i sum = _mm256_permute4x64_epi64(_mm256_hadd_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), sum);
+            }
+#endif
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m128 a = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2)));
+                const __m128 b = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2 + 4)));
+                const __m128i even = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                const __m128i odd = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_add_epi32(even, odd));
+            }
+            for (; i < count; ++i)
+                dst[i] = src[i * 2] + src[i * 2 + 1];
+        }
+    }  // namespace
+
+    template <typename LEAF_TYPE>
+    void ConcurrentBinaryTree<LEAF_TYPE>::Initialize(uint32_t require_leaf_count)
+    {
+        // 以上の最小の2の冪
+        const uint32_t min_large_power_of_2 = 1u << (ngl::MostSignificantBit32(std::max(1u, require_leaf_count) - 1) + 1);
+        // require_leaf_countのビットを格納するためのリーフ数.
+        packed_leaf_count_ = std::max(1u, min_large_power_of_2 >> LeafTypePackedIndexShift);
 
-        cbt_node_.resize(packed_node_count);
+        // インデックス計算簡易化のため1ベース. リーフのビット数を保持する段まで含む.
+        cbt_node_.resize(packed_leaf_count_ * 2);
+        cbt_leaf_.resize(packed_leaf_count_);
             
         Clear();
     }
 
-    void ConcurrentBinaryTreeU32::Clear()
+    template <typename LEAF_TYPE>
+    void ConcurrentBinaryTree<LEAF_TYPE>::Clear()
     {
-        // Leafの範囲のみクリア
-        memset(&(cbt_node_[packed_leaf_offset_]), 0, packed_leaf_count_ * sizeof(LeafType));
-        
-        // 合計値クリア.
-        cbt_node_[SumValueLocation] = 0;
+        std::fill(cbt_leaf_.begin(), cbt_leaf_.end(), LeafType(0));
+        std::fill(cbt_node_.begin(), cbt_node_.end(), 0u);
     }
 
-    void ConcurrentBinaryTreeU32::SetBit(uint32_t index, uint32_t bit)
+    template <typename LEAF_TYPE>
+    void ConcurrentBinaryTree<LEAF_TYPE>::SetBit(uint32_t index, uint32_t bit)
     {
         const uint32_t packed_leaf_node_index = (index >> LeafTypePackedIndexShift);
         const uint32_t packed_leaf_bit_location = (LeafTypeBitLocalIndexMask & index);
-        const uint32_t packed_leaf_node_location = packed_leaf_offset_ + packed_leaf_node_index;
-        const uint32_t bit_pattern = (1 << packed_leaf_bit_location);
+        const LeafType bit_pattern = (LeafType(1) << packed_leaf_bit_location);
 
         if(0 != bit)
         {
-            cbt_node_[packed_leaf_node_location] |= bit_pattern;
+            cbt_leaf_[packed_leaf_node_index] |= bit_pattern;
         }
         else
         {
-            cbt_node_[packed_leaf_node_location] &= ~bit_pattern;
+            cbt_leaf_[packed_leaf_node_index] &= ~bit_pattern;
         }
     }
 
-    uint32_t ConcurrentBinaryTreeU32::GetBit(uint32_t index) const
+    template <typename LEAF_TYPE>
+    uint32_t ConcurrentBinaryTree<LEAF_TYPE>::GetBit(uint32_t index) const
     {
         const uint32_t packed_leaf_node_index = (index >> LeafTypePackedIndexShift);
         const uint32_t packed_leaf_bit_location = (LeafTypeBitLocalIndexMask & index);
-        const uint32_t packed_leaf_node_location = packed_leaf_offset_ + packed_leaf_node_index;
 
-        return (cbt_node_[packed_leaf_node_location] >> packed_leaf_bit_location) & 0x01;
+        return static_cast<uint32_t>(cbt_leaf_[packed_leaf_node_index] >> packed_leaf_bit_location) & 0x01;
     }
 
-    uint32_t ConcurrentBinaryTreeU32::GetSum() const
+    template <typename LEAF_TYPE>
+    uint32_t ConcurrentBinaryTree<LEAF_TYPE>::GetSum() const
     {
         return cbt_node_[SumValueLocation];// 1ベースのインデックス付け.
     }
 
-    void ConcurrentBinaryTreeU32::SumReduction()
+    template <typename LEAF_TYPE>
+    void ConcurrentBinaryTree<LEAF_TYPE>::SumReduction(thread::JobSystem* p_job_system)
     {
+        uint32_t* node = cbt_node_.data();
+
+        // リーフ [leaf_begin, leaf_begin + leaf_count) の部分木をその根まで集計. leaf_count は2の冪.
+        auto reduce_subtree = [this, node](uint32_t leaf_begin, uint32_t leaf_count)
         {
-            // Leafのbitカウント.
-            const auto leaf_parent_start = packed_leaf_offset_ >> 1;
-            for(uint32_t i = 0; i < (packed_leaf_count_ >> 1); ++i)
+            uint32_t begin = packed_leaf_count_ + leaf_begin;
+            PopcountLeaf(cbt_leaf_.data() + leaf_begin, node + begin, leaf_count);
+            for (uint32_t count = leaf_count; 1 < count; count >>= 1)
             {
-                const auto target_node_location = leaf_parent_start + i;
-                const auto bit_count_leaf_2 = ngl::Count32bit(cbt_node_[((target_node_location) << 1) + 0]) + ngl::Count32bit(cbt_node_[(target_node_location << 1) + 1]);
-                cbt_node_[target_node_location] = bit_count_leaf_2;
+                ReduceNodePair(node + begin, node + (begin >> 1), count >> 1);
+                begin >>= 1;
             }
-        }
+        };
 
-        // bitカウントよりも親の通常バイナリツリー合計.
-        for(int d = 2; d <= ngl::MostSignificantBit32(packed_leaf_count_); ++d)
+        // 部分木分割数. 2の冪.
+        uint32_t chunk_count = 1;
+        if (p_job_system)
         {
-            const auto leaf_parent_start = packed_leaf_offset_ >> d;
-            for(uint32_t i = 0; i < (packed_leaf_count_ >> d); ++i)
-            {
-                const auto target_node_location = leaf_parent_start + i;
-                const auto bit_count_leaf_2 = cbt_node_[((target_node_location) << 1) + 0] + cbt_node_[(target_node_location << 1) + 1];
-                cbt_node_[target_node_location] = bit_count_leaf_2;
-            }
+            while ((chunk_count < k_parallel_chunk_max_count) && (chunk_count * 2 * k_parallel_packed_leaf_min_count <= packed_leaf_count_))
+                chunk_count <<= 1;
         }
-    }
+        const uint32_t chunk_leaf_count = packed_leaf_count_ / chunk_count;
+        ParallelForChunk(p_job_system, static_cast<int>(chunk_count), [&](int chunk)
+        {
+            reduce_subtree(static_cast<uint32_t>(chunk) * chunk_leaf_count, chunk_leaf_count);
+        });
 
-    // uint32_tの値とインデックス値を引数に取り, uint32_tの下位からインデックス番目に現れる 1 のビットの位置を返す関数
-    int Find_ith_Bit1_in_u32(uint32_t value, int index)
-    {
-        // value: 検索対象のu32値
-        // index: 下位からi番目の1（0-based）
-        // 戻り値: ビット位置（0-based, 存在しなければ-1）
-        int count = 0;
-        for (int bit = 0; bit < 32; ++bit)
+        // 部分木の根より上の段をシリアルに集計.
+        for (uint32_t count = chunk_count; 1 < count; count >>= 1)
         {
-            if ((value >> bit) & 0x1)
-            {
-                if (count == index)
-                    return bit;
-                ++count;
-            }
+            ReduceNodePair(node + count, node + (count >> 1), count >> 1);
         }
-        return -1;
     }
 
     // 下位から i番目 の 1 の位置を検索. SumReduction後に使用可能.
-    int ConcurrentBinaryTreeU32::Find_ith_Bit1(uint32_t index)
+    template <typename LEAF_TYPE>
+    int ConcurrentBinaryTree<LEAF_TYPE>::Find_ith_Bit1(uint32_t index) const
     {
-        if(0 == GetSum())
-        return -1;
-
-        // CBT: 完全二分木のノード配列（cbt_node_）
         // index: i番目の1（0-based）
         // 戻り値: ビット位置（0-based, 存在しなければ-1）
-        const uint32_t D = ngl::MostSignificantBit32(packed_leaf_count_); // 木の深さ
+        if(GetSum() <= index)
+            return -1;
+
+        // リーフのビット数の段まで降りる.
         uint32_t bitID = 1; // 1ベース
-        while (bitID < (1u << D))
+        while (bitID < packed_leaf_count_)
         {
             bitID = bitID << 1;
             if (index >= cbt_node_[bitID])
@@ -134,31 +295,25 @@ namespace ngl::render::app
                 bitID += 1;
             }
         }
-        const int leaf_pos = static_cast<int>(bitID - (1u << D));
-        const LeafType bit_field = (cbt_node_[packed_leaf_offset_ + leaf_pos]);
-        if(0 <= leaf_pos && 0 != bit_field)
-        {
-            const int local_bit_pos = Find_ith_Bit1_in_u32(bit_field, index);
-            assert(0 <= local_bit_pos);
-            return local_bit_pos + (leaf_pos * LeafTypeBitWidth);
-        }
-
-        return -1;
+        const uint32_t leaf_pos = bitID - packed_leaf_count_;
+        const int local_bit_pos = SelectBit1InWord(cbt_leaf_[leaf_pos], index);
+        assert(0 <= local_bit_pos);
+        return local_bit_pos + static_cast<int>(leaf_pos * LeafTypeBitWidth);
     }
 
     // 下位から i番目 の 0 の位置を検索. SumReduction後に使用可能.
-    int ConcurrentBinaryTreeU32::Find_ith_Bit0(uint32_t index)
+    template <typename LEAF_TYPE>
+    int ConcurrentBinaryTree<LEAF_TYPE>::Find_ith_Bit0(uint32_t index) const
     {
-        if(NumLeaf() == GetSum())
-            return -1;
-        
-        // CBT: 完全二分木のノード配列（cbt_node_）
         // index: i番目の0（0-based）
         // 戻り値: ビット位置（0-based, 存在しなければ-1）
-        const uint32_t D = ngl::MostSignificantBit32(packed_leaf_count_); // 木の深さ
+        if(NumLeaf() - GetSum() <= index)
+            return -1;
+        
+        // リーフのビット数の段まで降りる. c は子の部分木のビット総数.
         uint32_t bitID = 1; // 1ベース
-        uint32_t c = NumLeaf() >> 1;//1u << (D - 1);
-        while (bitID < (1u << D))
+        uint32_t c = NumLeaf() >> 1;
+        while (bitID < packed_leaf_count_)
         {
             bitID = bitID << 1;
             if (index >= (c - cbt_node_[bitID]))
@@ -168,80 +323,139 @@ namespace ngl::render::app
             }
             c = c >> 1;
         }
-        const int leaf_pos = static_cast<int>(bitID - (1u << D));
+        const uint32_t leaf_pos = bitID - packed_leaf_count_;
         // 反転ビットで1を探す.
-        const LeafType bit_field = ~(cbt_node_[packed_leaf_offset_ + leaf_pos]);
-        if(0 <= leaf_pos && 0 != bit_field)
-        {
-            const int local_bit_pos = Find_ith_Bit1_in_u32(bit_field, index);
-            assert(0 <= local_bit_pos);
-            return local_bit_pos + (leaf_pos * LeafTypeBitWidth);
-        }
-        return -1;
+        const int local_bit_pos = SelectBit1InWord(static_cast<LeafType>(~cbt_leaf_[leaf_pos]), index);
+        assert(0 <= local_bit_pos);
+        return local_bit_pos + static_cast<int>(leaf_pos * LeafTypeBitWidth);
     }
 
-    uint32_t ConcurrentBinaryTreeU32::NumLeaf() const
+    template <typename LEAF_TYPE>
+    uint32_t ConcurrentBinaryTree<LEAF_TYPE>::NumLeaf() const
     {
         return packed_leaf_count_ * LeafTypeBitWidth;
     }
 
     // テストコード.
-    void ConcurrentBinaryTreeU32::Test()
+    template <typename LEAF_TYPE>
+    void ConcurrentBinaryTree<LEAF_TYPE>::Test(thread::JobSystem* p_job_system)
     {
-        ConcurrentBinaryTreeU32 cbt;
-        cbt.Initialize(513);
-        
-        cbt.SetBit(0, 1);
-        cbt.SetBit(1, 1);
-        cbt.SetBit(3, 1);
-        cbt.SetBit(513, 1);
-        assert(1 == cbt.GetBit(0));
-        assert(1 == cbt.GetBit(1));
-        assert(0 == cbt.GetBit(2));
-        assert(1 == cbt.GetBit(3));
-        assert(0 == cbt.GetBit(4));
-        assert(1 == cbt.GetBit(513));
-        cbt.SumReduction();
-        assert(4 == cbt.GetSum());
+        {
+            ConcurrentBinaryTree cbt;
+            cbt.Initialize(513);
+            
+            cbt.SetBit(0, 1);
+            cbt.SetBit(1, 1);
+            cbt.SetBit(3, 1);
+            cbt.SetBit(513, 1);
+            assert(1 == cbt.GetBit(0));
+            assert(1 == cbt.GetBit(1));
+            assert(0 == cbt.GetBit(2));
+            assert(1 == cbt.GetBit(3));
+            assert(0 == cbt.GetBit(4));
+            assert(1 == cbt.GetBit(513));
+            cbt.SumReduction();
+            assert(4 == cbt.GetSum());
 
-        
-        // i番目の1の位置.
-        const auto bit1_location_0 = cbt.Find_ith_Bit1(0);
-        const auto bit1_location_1 = cbt.Find_ith_Bit1(1);
-        const auto bit1_location_2 = cbt.Find_ith_Bit1(2);
-        const auto bit1_location_3 = cbt.Find_ith_Bit1(3);
-        const auto bit1_location_4 = cbt.Find_ith_Bit1(4);
-        assert(0 == bit1_location_0);
-        assert(1 == bit1_location_1);
-        assert(3 == bit1_location_2);
-        assert(513 == bit1_location_3);
-        assert(-1 == bit1_location_4);
-
-        // i番目の0の位置.
-        const auto bit0_location_0 = cbt.Find_ith_Bit0(0);
-        const auto bit0_location_1 = cbt.Find_ith_Bit0(1);
-        const auto bit0_location_2 = cbt.Find_ith_Bit0(2);
-        const auto bit0_location_3 = cbt.Find_ith_Bit0(3);
-        const auto bit0_location_4 = cbt.Find_ith_Bit0(4);
-        const auto bit0_location_5 = cbt.Find_ith_Bit0(512);
-        assert(2 == bit0_location_0);
-        assert(4 == bit0_location_1);
-        assert(5 == bit0_location_2);
-        assert(6 == bit0_location_3);
-        assert(7 == bit0_location_4);
-        assert(516 == bit0_location_5);
-        
-        cbt.Clear();
+            
+            // i番目の1の位置.
+            const auto bit1_location_0 = cbt.Find_ith_Bit1(0);
+            const auto bit1_location_1 = cbt.Find_ith_Bit1(1);
+            const auto bit1_location_2 = cbt.Find_ith_Bit1(2);
+            const auto bit1_location_3 = cbt.Find_ith_Bit1(3);
+            const auto bit1_location_4 = cbt.Find_ith_Bit1(4);
+            assert(0 == bit1_location_0);
+            assert(1 == bit1_location_1);
+            assert(3 == bit1_location_2);
+            assert(513 == bit1_location_3);
+            assert(-1 == bit1_location_4);
+
+            // i番目の0の位置.
+            const auto bit0_location_0 = cbt.Find_ith_Bit0(0);
+            const auto bit0_location_1 = cbt.Find_ith_Bit0(1);
+            const auto bit0_location_2 = cbt.Find_ith_Bit0(2);
+            const auto bit0_location_3 = cbt.Find_ith_Bit0(3);
+            const auto bit0_location_4 = cbt.Find_ith_Bit0(4);
+            const auto bit0_location_5 = cbt.Find_ith_Bit0(512);
+            assert(2 == bit0_location_0);
+            assert(4 == bit0_location_1);
+            assert(5 == bit0_location_2);
+            assert(6 == bit0_location_3);
+            assert(7 == bit0_location_4);
+            assert(516 == bit0_location_5);
+            
+            cbt.Clear();
+
+            for(uint32_t i = 0; i < cbt.NumLeaf(); ++i)
+            {
+                cbt.SetBit(i, 1);
+            }
+            cbt.SumReduction();
+            assert(cbt.NumLeaf() == cbt.GetSum());
+            assert(-1 == cbt.Find_ith_Bit0(0));
+            
+            cbt.Clear();
+        }
 
-        const auto num_leaf = cbt.NumLeaf();
-        for(uint32_t i = 0; i < cbt.NumLeaf(); ++i)
+        // 乱数ビット列に対してナイーブな走査結果と比較.
+        uint32_t rand_state = 12345;
+        auto rand_u32 = [&rand_state]()
         {
-            cbt.SetBit(i, 1);
+            rand_state = rand_state * 1664525u + 1013904223u;
+            return rand_state >> 8;
+        };
+        {
+            const uint32_t test_leaf_count_array[] = {1, 31, 64, 1000, 4097, 1u << 16};
+            const uint32_t test_density_array[] = {1, 8, 50, 99};
+            for (const auto leaf_count : test_leaf_count_array)
+            {
+                for (const auto density : test_density_array)
+                {
+                    ConcurrentBinaryTree cbt;
+                    cbt.Initialize(leaf_count);
+
+                    std::vector<int> bit1_location;
+                    std::vector<int> bit0_location;
+                    for (uint32_t i = 0; i < cbt.NumLeaf(); ++i)
+                    {
+                        const uint32_t bit = ((rand_u32() % 100) < density) ? 1 : 0;
+                        cbt.SetBit(i, bit);
+                        (bit ? bit1_location : bit0_location).push_back(static_cast<int>(i));
+                    }
+                    cbt.SumReduction();
+                    assert(bit1_location.size() == cbt.GetSum());
+
+                    for (uint32_t i = 0; i < bit1_location.size(); ++i)
+                        assert(bit1_location[i] == cbt.Find_ith_Bit1(i));
+                    for (uint32_t i = 0; i < bit0_location.size(); ++i)
+                        assert(bit0_location[i] == cbt.Find_ith_Bit0(i));
+                    assert(-1 == cbt.Find_ith_Bit1(static_cast<uint32_t>(bit1_location.size())));
+                    assert(-1 == cbt.Find_ith_Bit0(static_cast<uint32_t>(bit0_location.size())));
+                }
+            }
+        }
+
+        // 並列SumReductionとシリアル実行の比較. 8分割される大きさの木で確認する.
+        if (p_job_system)
+        {
+            const uint32_t leaf_count = k_parallel_packed_leaf_min_count * 8 * LeafTypeBitWidth;
+            ConcurrentBinaryTree cbt_serial;
+            ConcurrentBinaryTree cbt_parallel;
+            cbt_serial.Initialize(leaf_count);
+            cbt_parallel.Initialize(leaf_count);
+            for (uint32_t i = 0; i < leaf_count; ++i)
+            {
+                const uint32_t bit = rand_u32() & 0x1;
+                cbt_serial.SetBit(i, bit);
+                cbt_parallel.SetBit(i, bit);
+            }
+            cbt_serial.SumReduction();
+            cbt_parallel.SumReduction(p_job_system);
+            assert(cbt_serial.cbt_node_ == cbt_parallel.cbt_node_);
         }
-        cbt.SumReduction();
-        assert(cbt.NumLeaf() == cbt.GetSum());
-        
-        cbt.Clear();
     }
 
+    template class ConcurrentBinaryTree<uint32_t>;
+    template class ConcurrentBinaryTree<uint64_t>;
+
 }  // namespace ngl::render::app
@@ -0,0 +1,866 @@
+﻿/*
+    cpu_cbt_tessellation.cpp
+    CBTテッセレーションのCPUリファレンス実装
+*/
+
+#include "render/app/sw_tess/cpu_cbt_tessellation.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+namespace ngl::render::app
+{
+    namespace
+    {
+        // シェーダ側 ResetBisector と同じ初期化.
+        void ResetBisector(Bisector& bisector, uint32_t bisector_id, uint32_t bisector_depth)
+        {
+            bisector.bs_depth = bisector_depth;
+            bisector.bs_id = bisector_id;
+            bisector.command = 0;
+            bisector.next = -1;
+            bisector.prev = -1;
+            bisector.twin = -1;
+            for (int i = 0; i < BISECTOR_ALLOC_PTR_SIZE; ++i)
+            {
+                bisector.alloc_ptr[i] = -1;
+            }
+            bisector.debug_value = 0.0f;
+            bisector.padding1 = 0;
+            bisector.padding2 = 0;
+            bisector.padding3 = 0;
+        }
+
+        math::Vec3 TransformPoint(const math::Mat34& m, const math::Vec3& p)
+        {
+            return math::Vec3(
+                m.m[0][0] * p.x + m.m[0][1] * p.y + m.m[0][2] * p.z + m.m[0][3],
+                m.m[1][0] * p.x + m.m[1][1] * p.y + m.m[1][2] * p.z + m.m[1][3],
+                m.m[2][0] * p.x + m.m[2][1] * p.y + m.m[2][2] * p.z + m.m[2][3]);
+        }
+
+        // 行列積 out = a * b (3x3).
+        void Mul33(const float a[3][3], const float b[3][3], float out[3][3])
+        {
+            for (int r = 0; r < 3; ++r)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    out[r][c] = a[r][0] * b[0][c] + a[r][1] * b[1][c] + a[r][2] * b[2][c];
+                }
+            }
+        }
+
+        double TriangleArea(const math::Vec3& v0, const math::Vec3& v1, const math::Vec3& v2)
+        {
+            const double e1[3] = {double(v1.x) - v0.x, double(v1.y) - v0.y, double(v1.z) - v0.z};
+            const double e2[3] = {double(v2.x) - v0.x, double(v2.y) - v0.y, double(v2.z) - v0.z};
+            const double c[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            return 0.5 * std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+        }
+
+        // Bisectorのリンク毎の辺. twin: v0-v1, next: v1-v2, prev: v2-v0.
+        constexpr int k_link_edge_vertex[3][2] = {{0, 1}, {1, 2}, {2, 0}};
+        int GetLink(const Bisector& bisector, int link)
+        {
+            return (0 == link) ? bisector.twin : ((1 == link) ? bisector.next : bisector.prev);
+        }
+    }  // namespace
+
+    bool CpuCbtTessellation::Initialize(const HalfEdgeMesh& half_edge_mesh, const math::Vec3* vertex_position, uint32_t vertex_count, uint32_t average_subdivision_level)
+    {
+        const uint32_t shape_half_edges = static_cast<uint32_t>(half_edge_mesh.half_edge_.size());
+        if (0 == shape_half_edges || nullptr == vertex_position)
+            return false;
+
+        // CBTGpuResources::Initialize と同じ深さ.
+        const uint32_t minimum_tree_depth = static_cast<uint32_t>(std::ceil(std::log2(std::max(1u, shape_half_edges))));
+        const uint32_t tree_depth = minimum_tree_depth + average_subdivision_level;
+        if (31 <= tree_depth)
+            return false;
+
+        half_edge_ = half_edge_mesh.half_edge_;
+        vertex_position_ = vertex_position;
+        vertex_count_ = vertex_count;
+        cbt_mesh_minimum_tree_depth_ = minimum_tree_depth;
+        cbt_tree_depth_ = tree_depth;
+        bisector_pool_max_size_ = 1u << tree_depth;
+
+        Reset();
+
+        total_area_ = 0.0;
+        for (uint32_t i = 0; i < shape_half_edges; ++i)
+        {
+            math::Vec3 pos[3];
+            CalcBisectorPosition(bisector_pool_[i], pos);
+            total_area_ += TriangleArea(pos[0], pos[1], pos[2]);
+        }
+        return true;
+    }
+
+    void CpuCbtTessellation::Reset()
+    {
+        const uint32_t shape_half_edges = static_cast<uint32_t>(half_edge_.size());
+
+        cbt_.Initialize(bisector_pool_max_size_);
+        bisector_pool_.assign(bisector_pool_max_size_, Bisector{});
+        index_cache_.assign(bisector_pool_max_size_, -1);
+        alloc_counter_ = 0;
+
+        // cbt_tess_init_leaf と同様. HalfEdge数分のBisectorを有効化してHalfEdgeのリンクをコピー.
+        for (uint32_t i = 0; i < shape_half_edges; ++i)
+        {
+            cbt_.SetBit(i, 1);
+            ResetBisector(bisector_pool_[i], i, cbt_mesh_minimum_tree_depth_);
+            bisector_pool_[i].next = half_edge_[i].next;
+            bisector_pool_[i].prev = half_edge_[i].prev;
+            bisector_pool_[i].twin = half_edge_[i].twin;
+        }
+        cbt_.SumReduction();
+        active_bisector_count_ = cbt_.GetSum();
+    }
+
+    void CpuCbtTessellation::CalcBisectorPosition(const Bisector& bisector, math::Vec3 out_position[3]) const
+    {
+        // CalcRootBisectorBaseVertex.
+        const uint32_t root_index = bisector.bs_id >> (bisector.bs_depth - cbt_mesh_minimum_tree_depth_);
+        const HalfEdge& half_edge = half_edge_[root_index];
+        const math::Vec3 base[3] = {
+            vertex_position_[half_edge.vertex],
+            vertex_position_[half_edge_[half_edge.next].vertex],
+            vertex_position_[half_edge_[half_edge.prev].vertex]};
+
+        // CalcBisectorAttributeMatrix.
+        float m[3][3] = {
+            {1.0f, 0.0f, 0.0f},
+            {0.0f, 1.0f, 0.0f},
+            {1.0f / 3.0f, 1.0f / 3.0f, 1.0f / 3.0f}};
+        static constexpr float k_split_matrix[2][3][3] = {
+            {{1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.5f, 0.5f, 0.0f}},
+            {{0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}, {0.5f, 0.5f, 0.0f}}};
+        for (int effective_depth = static_cast<int>(bisector.bs_depth - cbt_mesh_minimum_tree_depth_); effective_depth >= 1; --effective_depth)
+        {
+            const int bit = ((1u << (effective_depth - 1)) & bisector.bs_id) ? 1 : 0;
+            float tmp[3][3];
+            Mul33(k_split_matrix[bit], m, tmp);
+            std::copy(&tmp[0][0], &tmp[0][0] + 9, &m[0][0]);
+        }
+
+        for (int r = 0; r < 3; ++r)
+        {
+            out_position[r] = base[0] * m[r][0] + base[1] * m[r][1] + base[2] * m[r][2];
+        }
+    }
+
+    CpuCbtTessellation::UpdateStatistics CpuCbtTessellation::Update(const UpdateParam& param, thread::JobSystem* p_job_system)
+    {
+        UpdateStatistics stat{};
+        if (bisector_pool_.empty())
+            return stat;
+
+        // begin_update.
+        alloc_counter_ = 0;
+        active_bisector_count_ = cbt_.GetSum();
+
+        CacheIndex();
+
+        // reset_command.
+        for (uint32_t i = 0; i < active_bisector_count_; ++i)
+        {
+            Bisector& bisector = bisector_pool_[index_cache_[i]];
+            bisector.debug_value = 0.0f;
+            bisector.command = 0;
+            for (int k = 0; k < BISECTOR_ALLOC_PTR_SIZE; ++k)
+                bisector.alloc_ptr[k] = -1;
+        }
+
+        GenerateCommand(param);
+        ReserveBlock();
+        FillNewBlock();
+        UpdateNeighbor();
+        UpdateCbtBitfield(stat);
+
+        cbt_.SumReduction(p_job_system);
+
+        stat.active_bisector_count = cbt_.GetSum();
+        for (uint32_t i = 0; i < bisector_pool_max_size_; ++i)
+        {
+            if (cbt_.GetBit(i))
+                stat.max_depth = std::max(stat.max_depth, bisector_pool_[i].bs_depth - cbt_mesh_minimum_tree_depth_);
+        }
+        return stat;
+    }
+
+    // cache_index.
+    void CpuCbtTessellation::CacheIndex()
+    {
+        const uint32_t available_slots = bisector_pool_max_size_ - active_bisector_count_;
+        for (uint32_t i = 0; i < active_bisector_count_; ++i)
+        {
+            index_cache_[i] = cbt_.Find_ith_Bit1(i);
+        }
+        for (uint32_t i = 0; i < available_slots; ++i)
+        {
+            index_cache_[bisector_pool_max_size_ - 1 - i] = cbt_.Find_ith_Bit0(i);
+        }
+    }
+
+    bool CpuCbtTessellation::TryReserve(int alloc_count, int& out_counter)
+    {
+        out_counter = alloc_counter_;
+        alloc_counter_ -= alloc_count;
+        if (out_counter < alloc_count)
+        {
+            // 要求数が確保できない：カウンタを元に戻す.
+            alloc_counter_ += alloc_count;
+            return false;
+        }
+        return true;
+    }
+
+    // generate_command.
+    void CpuCbtTessellation::GenerateCommand(const UpdateParam& param)
+    {
+        const int current_used = static_cast<int>(active_bisector_count_);
+        const int pool_max_size = static_cast<int>(bisector_pool_max_size_);
+
+        // SetSplitCommands. Twin連鎖を辿って末端の1つまたはTwinペアの2つを分割する.
+        auto set_split_commands = [&](int bisector_index)
+        {
+            int current_index = bisector_index;
+            int terminate_twin_index = -1;
+            for (uint32_t chain = 0; chain < bisector_pool_max_size_; ++chain)
+            {
+                const int twin_index = bisector_pool_[current_index].twin;
+                if (twin_index < 0)
+                    break;
+                if (bisector_pool_[twin_index].twin == current_index)
+                {
+                    terminate_twin_index = twin_index;
+                    break;
+                }
+                current_index = twin_index;
+            }
+
+            const int alloc_count = (0 <= terminate_twin_index) ? 4 : 2;
+            const int old_counter = alloc_counter_;
+            alloc_counter_ += alloc_count;
+            if (current_used + old_counter + alloc_count <= pool_max_size)
+            {
+                bisector_pool_[current_index].command |= k_bisector_cmd_twin_split;
+                if (0 <= terminate_twin_index)
+                    bisector_pool_[terminate_twin_index].command |= k_bisector_cmd_twin_split;
+            }
+            else
+            {
+                alloc_counter_ -= alloc_count;
+            }
+        };
+
+        // CalcMergeCommands.
+        auto calc_merge_commands = [&](int bisector_index) -> uint32_t
+        {
+            const Bisector& bj1 = bisector_pool_[bisector_index];
+            const uint32_t j1 = bj1.bs_id;
+            const uint32_t depth_j1 = bj1.bs_depth;
+            if (depth_j1 <= cbt_mesh_minimum_tree_depth_)
+                return 0;
+
+            const uint32_t bit_value = j1 & 1;
+            const int bj2_index = bit_value ? bj1.prev : bj1.next;
+            const int bj3_index = bit_value ? bj1.next : bj1.prev;
+            if (bj2_index < 0)
+                return 0;
+
+            const uint32_t j2 = bisector_pool_[bj2_index].bs_id;
+            uint32_t out_command = 0;
+            if ((j1 >> 1) == (j2 >> 1))
+            {
+                if (bj3_index < 0)
+                {
+                    // 境界統合.
+                    out_command = k_bisector_cmd_boundary_merge;
+                    if (j1 < j2)
+                        out_command |= k_bisector_cmd_merge_representative;
+                }
+                else
+                {
+                    const Bisector& bj3 = bisector_pool_[bj3_index];
+                    if (depth_j1 == bj3.bs_depth)
+                    {
+                        const uint32_t j3 = bj3.bs_id;
+                        const int bj4_index = bit_value ? bj3.next : bj3.prev;
+                        if (bj4_index >= 0)
+                        {
+                            const uint32_t j4 = bisector_pool_[bj4_index].bs_id;
+                            if ((j3 >> 1) == (j4 >> 1))
+                            {
+                                // 非境界統合.
+                                out_command = k_bisector_cmd_interior_merge;
+                                const uint32_t min_bs_id = std::min(std::min(j1, j2), std::min(j3, j4));
+                                if (j1 == min_bs_id)
+                                    out_command |= k_bisector_cmd_merge_representative;
+                            }
+                        }
+                    }
+                }
+            }
+            return out_command;
+        };
+
+        // SetMergeCommands. 代表のみ必要分のアロケーションチェックをする.
+        auto set_merge_commands = [&](int bisector_index)
+        {
+            const uint32_t merge_command = calc_merge_commands(bisector_index);
+            if (0 == merge_command)
+                return;
+            if (k_bisector_cmd_merge_representative & merge_command)
+            {
+                const int alloc_count = (k_bisector_cmd_boundary_merge & merge_command) ? 1 : 2;
+                const int old_counter = alloc_counter_;
+                alloc_counter_ += alloc_count;
+                if (current_used + old_counter + alloc_count <= pool_max_size)
+                    bisector_pool_[bisector_index].command |= merge_command;
+                else
+                    alloc_counter_ -= alloc_count;
+            }
+            else
+            {
+                bisector_pool_[bisector_index].command |= merge_command;
+            }
+        };
+
+        const float merge_threshold = param.tessellation_split_threshold * param.tessellation_merge_factor;
+        for (uint32_t i = 0; i < active_bisector_count_; ++i)
+        {
+            const int bisector_index = index_cache_[i];
+            const Bisector& bisector = bisector_pool_[bisector_index];
+
+            bool do_subdivision = false;
+            bool do_merge = false;
+            if (0 <= param.fixed_subdivision_level)
+            {
+                const int effective_depth = static_cast<int>(bisector.bs_depth) - static_cast<int>(cbt_mesh_minimum_tree_depth_);
+                do_subdivision = (effective_depth < param.fixed_subdivision_level);
+                do_merge = (effective_depth > param.fixed_subdivision_level);
+            }
+            else
+            {
+                // 最長辺長さベース.
+                math::Vec3 pos[3];
+                CalcBisectorPosition(bisector, pos);
+                const math::Vec3 v0_world = TransformPoint(param.object_to_world, pos[0]);
+                const math::Vec3 v1_world = TransformPoint(param.object_to_world, pos[1]);
+                const math::Vec3 v2_world = TransformPoint(param.object_to_world, pos[2]);
+                const math::Vec3 triangle_center = (v0_world + v1_world + v2_world) / 3.0f;
+
+                const math::Vec3 edge0 = v1_world - v0_world;
+                const math::Vec3 edge1 = v2_world - v1_world;
+                const math::Vec3 edge2 = v0_world - v2_world;
+                const float lesq = std::max(math::Vec3::Dot(edge0, edge0), std::max(math::Vec3::Dot(edge1, edge1), math::Vec3::Dot(edge2, edge2)));
+                const float size_factor = std::sqrt(lesq);
+                const float distance_to_important = math::Vec3::Length(triangle_center - param.important_point);
+
+                const float subdivision_value = size_factor / std::max(distance_to_important, 0.5f);
+                if (subdivision_value >= param.tessellation_split_threshold)
+                    do_subdivision = true;
+                else if (subdivision_value < merge_threshold)
+                    do_merge = true;
+            }
+
+            if (do_subdivision)
+                set_split_commands(bisector_index);
+            else if (do_merge)
+                set_merge_commands(bisector_index);
+        }
+    }
+
+    // reserve_block.
+    void CpuCbtTessellation::ReserveBlock()
+    {
+        const int pool_last = static_cast<int>(bisector_pool_max_size_) - 1;
+
+        // 統合代表から見て, 境界統合は next の兄弟, 内部統合は next を辿る4つのBisector.
+        auto check_boundary_merge = [&](int bisector_index)
+        {
+            const Bisector& bj1 = bisector_pool_[bisector_index];
+            const int bj2_index = bj1.next;
+            if (bj2_index < 0)
+                return false;
+            const Bisector& bj2 = bisector_pool_[bj2_index];
+            if ((bj1.command & k_bisector_cmd_any_split) || (bj2.command & k_bisector_cmd_any_split))
+                return false;
+            if (!(bj2.command & k_bisector_cmd_boundary_merge))
+                return false;
+            if (bj1.twin >= 0 && (bisector_pool_[bj1.twin].command & k_bisector_cmd_any_split))
+                return false;
+            if (bj2.twin >= 0 && (bisector_pool_[bj2.twin].command & k_bisector_cmd_any_split))
+                return false;
+            return true;
+        };
+        auto check_interior_merge = [&](int bisector_index)
+        {
+            int bj_index[4] = {bisector_index, -1, -1, -1};
+            for (int k = 1; k < 4; ++k)
+            {
+                bj_index[k] = bisector_pool_[bj_index[k - 1]].next;
+                if (bj_index[k] < 0)
+                    return false;
+            }
+            for (int k = 0; k < 4; ++k)
+            {
+                const Bisector& bj = bisector_pool_[bj_index[k]];
+                if (bj.command & k_bisector_cmd_any_split)
+                    return false;
+                if (0 < k && !(bj.command & k_bisector_cmd_interior_merge))
+                    return false;
+            }
+            for (int k = 0; k < 4; ++k)
+            {
+                const int neighbor = bisector_pool_[bj_index[k]].twin;
+                if (neighbor >= 0 && (bisector_pool_[neighbor].command & k_bisector_cmd_any_split))
+                    return false;
+            }
+            return true;
+        };
+
+        for (uint32_t i = 0; i < active_bisector_count_; ++i)
+        {
+            const int bisector_index = index_cache_[i];
+            const uint32_t command = bisector_pool_[bisector_index].command;
+
+            if (command & k_bisector_cmd_any_split)
+            {
+                // Twin分割のみ実行.
+                if (command & k_bisector_cmd_twin_split)
+                {
+                    const int alloc_count = 2;
+                    int counter;
+                    if (!TryReserve(alloc_count, counter))
+                        continue;
+                    bisector_pool_[bisector_index].alloc_ptr[0] = index_cache_[pool_last - (counter - alloc_count)];
+                    bisector_pool_[bisector_index].alloc_ptr[1] = index_cache_[pool_last - (counter - alloc_count + 1)];
+                }
+            }
+            else if ((command & (k_bisector_cmd_boundary_merge | k_bisector_cmd_interior_merge)) && (command & k_bisector_cmd_merge_representative))
+            {
+                const bool is_boundary = (0 != (command & k_bisector_cmd_boundary_merge));
+                const bool merge_allowed = is_boundary ? check_boundary_merge(bisector_index) : check_interior_merge(bisector_index);
+                if (!merge_allowed)
+                    continue;
+
+                const int alloc_count = is_boundary ? 1 : 2;
+                int counter;
+                if (!TryReserve(alloc_count, counter))
+                    continue;
+
+                const int first_parent_index = index_cache_[pool_last - (counter - alloc_count)];
+                bisector_pool_[bisector_index].alloc_ptr[0] = first_parent_index;
+                if (is_boundary)
+                {
+                    bisector_pool_[bisector_index].command |= k_bisector_cmd_merge_consent;
+                    bisector_pool_[bisector_pool_[bisector_index].next].command |= k_bisector_cmd_merge_consent;
+                }
+                else
+                {
+                    const int second_parent_index = index_cache_[pool_last - (counter - alloc_count + 1)];
+                    bisector_pool_[bisector_index].alloc_ptr[1] = second_parent_index;
+
+                    const int bj2_index = bisector_pool_[bisector_index].next;
+                    const int bj3_index = bisector_pool_[bj2_index].next;
+                    const int bj4_index = bisector_pool_[bj3_index].next;
+                    // 第2ペアの代表(bj3)には自身のペアが使用する親を先頭に入れる.
+                    bisector_pool_[bj3_index].alloc_ptr[0] = second_parent_index;
+                    bisector_pool_[bj3_index].alloc_ptr[1] = first_parent_index;
+
+                    bisector_pool_[bisector_index].command |= k_bisector_cmd_merge_consent;
+                    bisector_pool_[bj2_index].command |= k_bisector_cmd_merge_consent;
+                    bisector_pool_[bj3_index].command |= k_bisector_cmd_merge_consent;
+                    bisector_pool_[bj4_index].command |= k_bisector_cmd_merge_consent;
+                }
+            }
+        }
+    }
+
+    // fill_new_block.
+    void CpuCbtTessellation::FillNewBlock()
+    {
+        for (uint32_t i = 0; i < active_bisector_count_; ++i)
+        {
+            const int bisector_index = index_cache_[i];
+            const Bisector bisector = bisector_pool_[bisector_index];
+            const uint32_t command = bisector.command;
+
+            if (command & k_bisector_cmd_any_split)
+            {
+                if (!(command & k_bisector_cmd_twin_split) || 0 > bisector.alloc_ptr[0])
+                    continue;
+
+                const int first_child_index = bisector.alloc_ptr[0];
+                const int second_child_index = bisector.alloc_ptr[1];
+                const uint32_t first_child_id = bisector.bs_id << 1;
+                const uint32_t child_depth = bisector.bs_depth + 1;
+
+                Bisector& first_child = bisector_pool_[first_child_index];
+                ResetBisector(first_child, first_child_id, child_depth);
+                first_child.twin = bisector.prev;
+                first_child.next = second_child_index;
+                // 親にtwinがいれば, そちらも分割されているはずなのでその2つ目の子.
+                first_child.prev = (bisector.twin >= 0) ? bisector_pool_[bisector.twin].alloc_ptr[1] : -1;
+
+                Bisector& second_child = bisector_pool_[second_child_index];
+                ResetBisector(second_child, first_child_id + 1, child_depth);
+                second_child.twin = bisector.next;
+                second_child.prev = first_child_index;
+                second_child.next = (bisector.twin >= 0) ? bisector_pool_[bisector.twin].alloc_ptr[0] : -1;
+            }
+            else if ((command & (k_bisector_cmd_boundary_merge | k_bisector_cmd_interior_merge)) &&
+                     (command & k_bisector_cmd_merge_consent) && (command & k_bisector_cmd_merge_representative))
+            {
+                if (command & k_bisector_cmd_boundary_merge)
+                {
+                    const int parent_index = bisector.alloc_ptr[0];
+                    const Bisector& merge_partner = bisector_pool_[bisector.next];
+
+                    Bisector& parent = bisector_pool_[parent_index];
+                    ResetBisector(parent, bisector.bs_id >> 1, bisector.bs_depth - 1);
+                    parent.next = merge_partner.twin;
+                    parent.prev = bisector.twin;
+                    parent.twin = bisector.prev;
+                }
+                else
+                {
+                    const int first_parent_index = bisector.alloc_ptr[0];
+                    const int second_parent_index = bisector.alloc_ptr[1];
+
+                    const Bisector& bj1 = bisector;
+                    const Bisector& bj2 = bisector_pool_[bj1.next];
+                    const Bisector& bj3 = bisector_pool_[bj2.next];
+                    const Bisector& bj4 = bisector_pool_[bj3.next];
+
+                    Bisector& first_parent = bisector_pool_[first_parent_index];
+                    ResetBisector(first_parent, bj1.bs_id >> 1, bj1.bs_depth - 1);
+                    first_parent.next = bj2.twin;
+                    first_parent.prev = bj1.twin;
+                    first_parent.twin = second_parent_index;
+
+                    Bisector& second_parent = bisector_pool_[second_parent_index];
+                    ResetBisector(second_parent, bj3.bs_id >> 1, bj3.bs_depth - 1);
+                    second_parent.next = bj4.twin;
+                    second_parent.prev = bj3.twin;
+                    second_parent.twin = first_parent_index;
+                }
+            }
+        }
+    }
+
+    // update_neighbor.
+    void CpuCbtTessellation::UpdateNeighbor()
+    {
+        // RefinePointers. 分割による隣接Bisectorのリンク更新.
+        auto refine_pointers = [&](int bisector_index)
+        {
+            const int first_child_index = bisector_pool_[bisector_index].alloc_ptr[0];
+            const int second_child_index = bisector_pool_[bisector_index].alloc_ptr[1];
+            const int next_index = bisector_pool_[bisector_index].next;
+            const int prev_index = bisector_pool_[bisector_index].prev;
+
+            if (next_index >= 0)
+            {
+                Bisector& next = bisector_pool_[next_index];
+                if (next.command & k_bisector_cmd_twin_split)
+                    bisector_pool_[next.alloc_ptr[0]].twin = second_child_index;
+                else if (next.prev == bisector_index)
+                    next.prev = second_child_index;
+                else
+                    next.twin = second_child_index;
+            }
+            if (prev_index >= 0)
+            {
+                Bisector& prev = bisector_pool_[prev_index];
+                if (prev.command & k_bisector_cmd_twin_split)
+                    bisector_pool_[prev.alloc_ptr[1]].twin = first_child_index;
+                else if (prev.next == bisector_index)
+                    prev.next = first_child_index;
+                else
+                    prev.twin = first_child_index;
+            }
+        };
+
+        // DecimatePointers. 統合されるペアの外側の隣接を親に付け替える.
+        //  隣接も統合される場合はそのペアの1つ目の確保ポインタの0番目が親となる.
+        auto decimate_pointers = [&](int first_child_index, int second_child_index, int parent_index)
+        {
+            auto resolve_neighbor = [&](int neighbor_index)
+            {
+                const Bisector& neighbor = bisector_pool_[neighbor_index];
+                if (neighbor.command & k_bisector_cmd_merge_consent)
+                    return (0 == (neighbor.bs_id & 0x01)) ? neighbor.alloc_ptr[0] : bisector_pool_[neighbor.prev].alloc_ptr[0];
+                return neighbor_index;
+            };
+
+            const int next_index = bisector_pool_[second_child_index].twin;
+            const int prev_index = bisector_pool_[first_child_index].twin;
+            if (next_index >= 0)
+            {
+                Bisector& edit_neighbor = bisector_pool_[resolve_neighbor(next_index)];
+                if (edit_neighbor.prev == second_child_index)
+                    edit_neighbor.prev = parent_index;
+                else
+                    edit_neighbor.twin = parent_index;
+            }
+            if (prev_index >= 0)
+            {
+                Bisector& edit_neighbor = bisector_pool_[resolve_neighbor(prev_index)];
+                if (edit_neighbor.next == first_child_index)
+                    edit_neighbor.next = parent_index;
+                else
+                    edit_neighbor.twin = parent_index;
+            }
+        };
+
+        for (uint32_t i = 0; i < active_bisector_count_; ++i)
+        {
+            const int bisector_index = index_cache_[i];
+            const Bisector bisector = bisector_pool_[bisector_index];
+            const uint32_t command = bisector.command;
+
+            if (command & k_bisector_cmd_any_split)
+            {
+                if ((command & k_bisector_cmd_twin_split) && 0 <= bisector.alloc_ptr[0])
+                    refine_pointers(bisector_index);
+            }
+            else if ((command & (k_bisector_cmd_boundary_merge | k_bisector_cmd_interior_merge)) &&
+                     (command & k_bisector_cmd_merge_representative) && (command & k_bisector_cmd_merge_consent))
+            {
+                if (command & k_bisector_cmd_boundary_merge)
+                {
+                    decimate_pointers(bisector_index, bisector.next, bisector.alloc_ptr[0]);
+                }
+                else
+                {
+                    const int bj2_index = bisector.next;
+                    const int bj3_index = bisector_pool_[bj2_index].next;
+                    const int bj4_index = bisector_pool_[bj3_index].next;
+                    decimate_pointers(bisector_index, bj2_index, bisector.alloc_ptr[0]);
+                    decimate_pointers(bj3_index, bj4_index, bisector.alloc_ptr[1]);
+                }
+            }
+        }
+    }
+
+    // update_cbt_bitfield.
+    void CpuCbtTessellation::UpdateCbtBitfield(UpdateStatistics& out_stat)
+    {
+        for (uint32_t i = 0; i < active_bisector_count_; ++i)
+        {
+            const int bisector_index = index_cache_[i];
+            const Bisector& bisector = bisector_pool_[bisector_index];
+            const uint32_t command = bisector.command;
+            if (0 == command)
+                continue;
+
+            const bool is_split = (0 != (command & k_bisector_cmd_any_split));
+            const bool is_merge = !is_split && (command & (k_bisector_cmd_boundary_merge | k_bisector_cmd_interior_merge)) &&
+                                  (command & k_bisector_cmd_merge_representative) && (command & k_bisector_cmd_merge_consent);
+            if (!is_split && !is_merge)
+                continue;
+
+            // 新規Bisectorを有効化.
+            for (int k = 0; k < BISECTOR_ALLOC_PTR_SIZE; ++k)
+            {
+                if (0 <= bisector.alloc_ptr[k])
+                    cbt_.SetBit(static_cast<uint32_t>(bisector.alloc_ptr[k]), 1);
+            }
+            // 必要分確保できていなければすべて -1 なので0番目のみチェック.
+            if (0 > bisector.alloc_ptr[0])
+                continue;
+
+            if (is_split)
+            {
+                cbt_.SetBit(bisector_index, 0);
+                ++out_stat.split_count;
+            }
+            else if (command & k_bisector_cmd_boundary_merge)
+            {
+                cbt_.SetBit(bisector_index, 0);
+                cbt_.SetBit(bisector.next, 0);
+                ++out_stat.boundary_merge_count;
+            }
+            else
+            {
+                const int bj2_index = bisector.next;
+                const int bj3_index = bisector_pool_[bj2_index].next;
+                const int bj4_index = bisector_pool_[bj3_index].next;
+                cbt_.SetBit(bisector_index, 0);
+                cbt_.SetBit(bj2_index, 0);
+                cbt_.SetBit(bj3_index, 0);
+                cbt_.SetBit(bj4_index, 0);
+                ++out_stat.interior_merge_count;
+            }
+        }
+    }
+
+    CpuCbtTessellation::ValidationResult CpuCbtTessellation::Validate() const
+    {
+        ValidationResult result{};
+        if (bisector_pool_.empty())
+            return result;
+
+        std::vector<int> active_index;
+        active_index.reserve(cbt_.GetSum());
+        for (uint32_t i = 0; i < bisector_pool_max_size_; ++i)
+        {
+            if (cbt_.GetBit(i))
+                active_index.push_back(static_cast<int>(i));
+        }
+        result.is_cbt_sum_match = (active_index.size() == cbt_.GetSum());
+
+        double area = 0.0;
+        for (const int bisector_index : active_index)
+        {
+            const Bisector& bisector = bisector_pool_[bisector_index];
+            math::Vec3 pos[3];
+            CalcBisectorPosition(bisector, pos);
+            area += TriangleArea(pos[0], pos[1], pos[2]);
+
+            for (int link = 0; link < 3; ++link)
+            {
+                const int neighbor_index = GetLink(bisector, link);
+                if (0 > neighbor_index)
+                    continue;
+                if (static_cast<int>(bisector_pool_max_size_) <= neighbor_index || !cbt_.GetBit(neighbor_index))
+                {
+                    ++result.invalid_link_count;
+                    continue;
+                }
+
+                // 相手側のいずれかのリンクが自身を指し, その辺の端点が一致すること.
+                const Bisector& neighbor = bisector_pool_[neighbor_index];
+                math::Vec3 neighbor_pos[3];
+                CalcBisectorPosition(neighbor, neighbor_pos);
+                const math::Vec3& e0 = pos[k_link_edge_vertex[link][0]];
+                const math::Vec3& e1 = pos[k_link_edge_vertex[link][1]];
+                const float tolerance_sq = std::max(math::Vec3::LengthSq(e1 - e0), 1e-12f) * 1e-6f;
+
+                bool is_reciprocated = false;
+                for (int neighbor_link = 0; neighbor_link < 3 && !is_reciprocated; ++neighbor_link)
+                {
+                    if (GetLink(neighbor, neighbor_link) != bisector_index)
+                        continue;
+                    const math::Vec3& n0 = neighbor_pos[k_link_edge_vertex[neighbor_link][0]];
+                    const math::Vec3& n1 = neighbor_pos[k_link_edge_vertex[neighbor_link][1]];
+                    is_reciprocated = (math::Vec3::LengthSq(e0 - n1) <= tolerance_sq && math::Vec3::LengthSq(e1 - n0) <= tolerance_sq) ||
+                                      (math::Vec3::LengthSq(e0 - n0) <= tolerance_sq && math::Vec3::LengthSq(e1 - n1) <= tolerance_sq);
+                }
+                if (!is_reciprocated)
+                    ++result.unreciprocated_link_count;
+            }
+        }
+        result.area_error = (0.0 < total_area_) ? std::abs(area - total_area_) / total_area_ : 0.0;
+
+        std::vector<uint64_t> key_array;
+        CollectBisectorKey(bisector_pool_.data(), active_index.data(), static_cast<uint32_t>(active_index.size()), key_array);
+        for (size_t i = 1; i < key_array.size(); ++i)
+        {
+            if (key_array[i - 1] == key_array[i])
+                ++result.duplicate_bisector_count;
+        }
+        return result;
+    }
+
+    void CpuCbtTessellation::CollectBisectorKey(std::vector<uint64_t>& out_key_array) const
+    {
+        const uint32_t active_count = cbt_.GetSum();
+        std::vector<int> active_index(active_count);
+        for (uint32_t i = 0; i < active_count; ++i)
+            active_index[i] = cbt_.Find_ith_Bit1(i);
+        CollectBisectorKey(bisector_pool_.data(), active_index.data(), active_count, out_key_array);
+    }
+
+    void CpuCbtTessellation::CollectBisectorKey(const Bisector* bisector_pool, const int* active_index, uint32_t active_count, std::vector<uint64_t>& out_key_array)
+    {
+        out_key_array.resize(active_count);
+        for (uint32_t i = 0; i < active_count; ++i)
+        {
+            const Bisector& bisector = bisector_pool[active_index[i]];
+            out_key_array[i] = (static_cast<uint64_t>(bisector.bs_depth) << 32) | bisector.bs_id;
+        }
+        std::sort(out_key_array.begin(), out_key_array.end());
+    }
+
+
+    CpuCbtTessellationSelfTestResult RunCpuCbtTessellationSelfTest(int grid_resolution, uint32_t average_subdivision_level, thread::JobSystem* p_job_system)
+    {
+        CpuCbtTessellationSelfTestResult result{};
+
+        std::vector<uint32_t> index_list;
+        MakeHalfEdgeMeshBenchmarkGrid(grid_resolution, index_list);
+        if (index_list.empty())
+            return result;
+        const uint32_t row = static_cast<uint32_t>(grid_resolution) + 1;
+        std::vector<math::Vec3> position(row * row);
+        for (uint32_t y = 0; y < row; ++y)
+        {
+            for (uint32_t x = 0; x < row; ++x)
+                position[y * row + x] = math::Vec3(static_cast<float>(x), 0.0f, static_cast<float>(y));
+        }
+
+        HalfEdgeMesh half_edge_mesh;
+        half_edge_mesh.Initialize(index_list.data(), static_cast<int>(index_list.size()), p_job_system);
+        result.half_edge_count = static_cast<uint32_t>(half_edge_mesh.half_edge_.size());
+
+        CpuCbtTessellation tess;
+        if (!tess.Initialize(half_edge_mesh, position.data(), static_cast<uint32_t>(position.size()), average_subdivision_level))
+            return result;
+
+        double total_ms = 0.0;
+        auto run_frame = [&](const CpuCbtTessellation::UpdateParam& param)
+        {
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            const auto stat = tess.Update(param, p_job_system);
+            total_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+
+            ++result.frame_count;
+            result.max_active_bisector_count = std::max(result.max_active_bisector_count, stat.active_bisector_count);
+            if (!tess.Validate().IsValid())
+                ++result.invalid_frame_count;
+        };
+
+        // 固定分割レベルで段階的に細分化.
+        const uint32_t frame_per_phase = 4 * (average_subdivision_level + 2);
+        for (int level = 1; level <= static_cast<int>(average_subdivision_level); ++level)
+        {
+            CpuCbtTessellation::UpdateParam param{};
+            param.fixed_subdivision_level = level;
+            for (uint32_t f = 0; f < frame_per_phase; ++f)
+                run_frame(param);
+        }
+        // 重視座標を格子上で移動させて適応分割.
+        {
+            CpuCbtTessellation::UpdateParam param{};
+            param.tessellation_split_threshold = 0.2f;
+            const float extent = static_cast<float>(grid_resolution);
+            for (uint32_t f = 0; f < frame_per_phase * 4; ++f)
+            {
+                const float t = static_cast<float>(f) / static_cast<float>(frame_per_phase * 4);
+                param.important_point = math::Vec3(extent * t, 0.5f, extent * (0.5f + 0.4f * std::sin(t * 6.2831853f)));
+                run_frame(param);
+            }
+        }
+        // 固定分割レベル0に戻して統合.
+        {
+            CpuCbtTessellation::UpdateParam param{};
+            param.fixed_subdivision_level = 0;
+            for (uint32_t f = 0; f < frame_per_phase * 2; ++f)
+                run_frame(param);
+        }
+
+        result.final_active_bisector_count = tess.GetActiveBisectorCount();
+        result.update_ms = (0 < result.frame_count) ? total_ms / result.frame_count : 0.0;
+        return result;
+    }
+
+}  // namespace ngl::render::app
@@ -4,17 +4,255 @@
 */
 
 #include "render/app/sw_tess/half_edge_mesh.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <thread>
 #include <unordered_map>
 
+#include "thread/job_thread.h"
+
 namespace ngl::render::app
 {
+    namespace
+    {
+        // 並列処理の最小分割サイズ.
+        constexpr int k_parallel_chunk_min_size = 64 * 1024;
+        // RadixSortの桁.
+        constexpr int k_radix_bits = 11;
+        constexpr int k_radix_size = 1 << k_radix_bits;
+
+        // [0, count) をchunk_count分割して実行. p_job_system が無効または1分割の場合はその場で実行.
+        template <typename FUNC>
+        void ParallelForChunk(thread::JobSystem* p_job_system, int chunk_count, const FUNC& func)
+        {
+            if (p_job_system && 1 < chunk_count)
+            {
+                for (int i = 0; i < chunk_count; ++i)
+                {
+                    p_job_system->Add([&func, i]() { func(i); });
+                }
+                p_job_system->WaitAll();
+            }
+            else
+            {
+                for (int i = 0; i < chunk_count; ++i)
+                    func(i);
+            }
+        }
+
+        int BitWidth(uint32_t v)
+        {
+            int n = 0;
+            while (v)
+            {
+                ++n;
+                v >>= 1;
+            }
+            return n;
+        }
+    }  // namespace
+
     // IndexListからHalfEdge構造を生成する関数
-    void HalfEdgeMesh::Initialize(const uint32_t* index_list, int index_count)
+    void HalfEdgeMesh::Initialize(const uint32_t* index_list, int index_count, thread::JobSystem* p_job_system)
+    {
+        // 三角形メッシュを仮定
+        const int face_count      = index_count / 3;
+        const int half_edge_count = face_count * 3;
+        half_edge_.clear();
+        half_edge_.resize(half_edge_count);
+        build_stat_ = {};
+        if (0 >= half_edge_count)
+            return;
+
+        const int chunk_count = (p_job_system) ? std::clamp(half_edge_count / k_parallel_chunk_min_size, 1, std::max(1, static_cast<int>(std::thread::hardware_concurrency()))) : 1;
+        const int chunk_size  = (half_edge_count + chunk_count - 1) / chunk_count;
+        // 分割は三角形単位に揃える.
+        const int chunk_face_size = (face_count + chunk_count - 1) / chunk_count;
+
+        // 各HalfEdgeの無向エッジキー. キーは (min << vertex_bits) | max として必要なビット数のみソートする.
+        std::vector<uint64_t> key_array(half_edge_count);
+        std::vector<uint32_t> value_array(half_edge_count);
+        std::vector<uint32_t> chunk_max_vertex(chunk_count, 0);
+
+        // HalfEdge生成とキー生成.
+        ParallelForChunk(p_job_system, chunk_count, [&](int chunk)
+        {
+            const int f_begin = std::min(face_count, chunk * chunk_face_size);
+            const int f_end   = std::min(face_count, f_begin + chunk_face_size);
+            uint32_t max_vertex = 0;
+            for (int f = f_begin; f < f_end; ++f)
+            {
+                const uint32_t idx[3] = {index_list[f * 3 + 0], index_list[f * 3 + 1], index_list[f * 3 + 2]};
+                const int he_base = f * 3;
+                // Triangle単位でHalfEdgeループを追加. twinは未定として後処理.
+                half_edge_[he_base + 0] = {-1, he_base + 1, he_base + 2, static_cast<int>(idx[0])};  // 0→1
+                half_edge_[he_base + 1] = {-1, he_base + 2, he_base + 0, static_cast<int>(idx[1])};  // 1→2
+                half_edge_[he_base + 2] = {-1, he_base + 0, he_base + 1, static_cast<int>(idx[2])};  // 2→0
+                max_vertex = std::max({max_vertex, idx[0], idx[1], idx[2]});
+            }
+            chunk_max_vertex[chunk] = max_vertex;
+        });
+        const int vertex_bits = BitWidth(*std::max_element(chunk_max_vertex.begin(), chunk_max_vertex.end()));
+        const int key_bits    = vertex_bits * 2;
+
+        ParallelForChunk(p_job_system, chunk_count, [&](int chunk)
+        {
+            const int f_begin = std::min(face_count, chunk * chunk_face_size);
+            const int f_end   = std::min(face_count, f_begin + chunk_face_size);
+            for (int he = f_begin * 3; he < f_end * 3; ++he)
+            {
+                const uint32_t v0 = static_cast<uint32_t>(half_edge_[he].vertex);
+                const uint32_t v1 = static_cast<uint32_t>(half_edge_[half_edge_[he].next].vertex);
+                key_array[he]     = (static_cast<uint64_t>(std::min(v0, v1)) << vertex_bits) | std::max(v0, v1);
+                value_array[he]   = static_cast<uint32_t>(he);
+            }
+        });
+
+        // LSD RadixSort. 安定ソートのため同一キー内はHalfEdgeインデックス順になる.
+        //  チャンク毎のヒストグラムからチャンク毎の書き込み先を決めて並列にスキャッタする.
+        {
+            std::vector<uint64_t> key_tmp(half_edge_count);
+            std::vector<uint32_t> value_tmp(half_edge_count);
+            std::vector<std::array<uint32_t, k_radix_size>> chunk_hist(chunk_count);
+
+            for (int shift = 0; shift < key_bits; shift += k_radix_bits)
+            {
+                ParallelForChunk(p_job_system, chunk_count, [&](int chunk)
+                {
+                    auto& hist = chunk_hist[chunk];
+                    hist.fill(0);
+                    const int begin = std::min(half_edge_count, chunk * chunk_size);
+                    const int end   = std::min(half_edge_count, begin + chunk_size);
+                    for (int i = begin; i < end; ++i)
+                        ++hist[(key_array[i] >> shift) & (k_radix_size - 1)];
+                });
+
+                // 全要素が同じ桁の場合はスキップ.
+                bool is_single_bucket = false;
+                {
+                    std::array<uint32_t, k_radix_size> total{};
+                    for (const auto& hist : chunk_hist)
+                        for (int d = 0; d < k_radix_size; ++d)
+                            total[d] += hist[d];
+                    is_single_bucket = (total.end() != std::find(total.begin(), total.end(), static_cast<uint32_t>(half_edge_count)));
+                }
+                if (is_single_bucket)
+                    continue;
+
+                // 桁毎, チャンク毎の書き込み開始位置.
+                {
+                    uint32_t offset = 0;
+                    for (int d = 0; d < k_radix_size; ++d)
+                    {
+                        for (int chunk = 0; chunk < chunk_count; ++chunk)
+                        {
+                            const uint32_t count   = chunk_hist[chunk][d];
+                            chunk_hist[chunk][d]   = offset;
+                            offset                += count;
+                        }
+                    }
+                }
+
+                ParallelForChunk(p_job_system, chunk_count, [&](int chunk)
+                {
+                    auto& dst_offset = chunk_hist[chunk];
+                    const int begin  = std::min(half_edge_count, chunk * chunk_size);
+                    const int end    = std::min(half_edge_count, begin + chunk_size);
+                    for (int i = begin; i < end; ++i)
+                    {
+                        const uint32_t dst = dst_offset[(key_array[i] >> shift) & (k_radix_size - 1)]++;
+                        key_tmp[dst]       = key_array[i];
+                        value_tmp[dst]     = value_array[i];
+                    }
+                });
+                key_array.swap(key_tmp);
+                value_array.swap(value_tmp);
+            }
+        }
+
+        // twin決定. ソート済み配列で同じキーが連続する範囲が同じ無向エッジを共有するHalfEdge.
+        //  範囲の先頭がチャンク内にあるものをそのチャンクで処理する.
+        std::vector<BuildStatistics> chunk_stat(chunk_count);
+        ParallelForChunk(p_job_system, chunk_count, [&](int chunk)
+        {
+            auto& stat      = chunk_stat[chunk];
+            const int begin = std::min(half_edge_count, chunk * chunk_size);
+            const int end   = std::min(half_edge_count, begin + chunk_size);
+
+            int i = begin;
+            // 前チャンクから続く範囲はスキップ.
+            while (0 < i && i < end && key_array[i - 1] == key_array[i])
+                ++i;
+            while (i < end)
+            {
+                int run_end = i + 1;
+                while (run_end < half_edge_count && key_array[run_end] == key_array[i])
+                    ++run_end;
+                const int run_count = run_end - i;
+
+                ++stat.edge_count;
+                const uint32_t v_min = static_cast<uint32_t>(key_array[i] >> vertex_bits);
+                const uint32_t v_max = static_cast<uint32_t>(key_array[i] & ((uint64_t(1) << vertex_bits) - 1));
+                if (v_min == v_max)
+                {
+                    // 縮退エッジはTwin無し.
+                    ++stat.degenerate_edge_count;
+                }
+                else if (1 == run_count)
+                {
+                    ++stat.boundary_edge_count;
+                }
+                else
+                {
+                    // 向き毎に最後のHalfEdgeをTwinとする. 多様体であれば各向きに1つずつ.
+                    int forward  = -1;
+                    int backward = -1;
+                    int forward_count = 0;
+                    for (int k = i; k < run_end; ++k)
+                    {
+                        const int he = static_cast<int>(value_array[k]);
+                        if (static_cast<uint32_t>(half_edge_[he].vertex) == v_min)
+                        {
+                            forward = he;
+                            ++forward_count;
+                        }
+                        else
+                        {
+                            backward = he;
+                        }
+                    }
+                    if (0 <= forward && 0 <= backward)
+                    {
+                        half_edge_[forward].twin  = backward;
+                        half_edge_[backward].twin = forward;
+                    }
+                    if (2 != run_count || 1 != forward_count)
+                        ++stat.non_manifold_edge_count;
+                }
+                i = run_end;
+            }
+        });
+        for (const auto& stat : chunk_stat)
+        {
+            build_stat_.edge_count              += stat.edge_count;
+            build_stat_.boundary_edge_count     += stat.boundary_edge_count;
+            build_stat_.non_manifold_edge_count += stat.non_manifold_edge_count;
+            build_stat_.degenerate_edge_count   += stat.degenerate_edge_count;
+        }
+    }
+
+    // ハッシュマップによる従来の生成.
+    void HalfEdgeMesh::InitializeReference(const uint32_t* index_list, int index_count)
     {
         // 三角形メッシュを仮定
         int face_count = index_count / 3;
         half_edge_.clear();
         half_edge_.reserve(index_count);
+        build_stat_ = {};
 
         // 各エッジを一意に識別するためのキー
         using EdgeKey    = uint64_t;
@@ -65,4 +303,130 @@ namespace ngl::render::app
         }
     }
 
+    HalfEdgeMeshBenchmarkResult RunHalfEdgeMeshBenchmark(const uint32_t* index_list, int index_count, thread::JobSystem* p_job_system)
+    {
+        using Clock = std::chrono::high_resolution_clock;
+        auto ElapsedMs = [](const Clock::time_point& begin)
+        {
+            return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        };
+
+        HalfEdgeMeshBenchmarkResult result{};
+        result.triangle_count = index_count / 3;
+
+        HalfEdgeMesh reference;
+        {
+            const auto begin    = Clock::now();
+            reference.InitializeReference(index_list, index_count);
+            result.reference_ms = ElapsedMs(begin);
+        }
+        HalfEdgeMesh sorted;
+        {
+            const auto begin = Clock::now();
+            sorted.Initialize(index_list, index_count, nullptr);
+            result.sort_ms   = ElapsedMs(begin);
+        }
+        HalfEdgeMesh sorted_parallel;
+        if (p_job_system)
+        {
+            const auto begin        = Clock::now();
+            sorted_parallel.Initialize(index_list, index_count, p_job_system);
+            result.sort_parallel_ms = ElapsedMs(begin);
+        }
+        result.build_stat = sorted.GetBuildStatistics();
+
+        // 比較.
+        auto IsSameHalfEdge = [](const HalfEdge& a, const HalfEdge& b, int he_index)
+        {
+            // 従来実装は縮退エッジで自身をTwinとするため無効として扱う.
+            const int a_twin = (a.twin == he_index) ? -1 : a.twin;
+            return a_twin == b.twin && a.next == b.next && a.prev == b.prev && a.vertex == b.vertex;
+        };
+        result.is_match = (reference.half_edge_.size() == sorted.half_edge_.size());
+        for (int i = 0; result.is_match && i < static_cast<int>(reference.half_edge_.size()); ++i)
+        {
+            result.is_match = IsSameHalfEdge(reference.half_edge_[i], sorted.half_edge_[i], i);
+            if (p_job_system)
+                result.is_match = result.is_match && IsSameHalfEdge(reference.half_edge_[i], sorted_parallel.half_edge_[i], i);
+        }
+        return result;
+    }
+
+    void MakeHalfEdgeMeshBenchmarkGrid(int resolution, std::vector<uint32_t>& out_index_list)
+    {
+        out_index_list.clear();
+        if (0 >= resolution)
+            return;
+        out_index_list.reserve(static_cast<size_t>(resolution) * resolution * 6);
+        const uint32_t row = static_cast<uint32_t>(resolution) + 1;
+        for (uint32_t y = 0; y < static_cast<uint32_t>(resolution); ++y)
+        {
+            for (uint32_t x = 0; x < static_cast<uint32_t>(resolution); ++x)
+            {
+                const uint32_t v00 = y * row + x;
+                const uint32_t v10 = v00 + 1;
+                const uint32_t v01 = v00 + row;
+                const uint32_t v11 = v01 + 1;
+                out_index_list.insert(out_index_list.end(), {v00, v01, v10});
+                out_index_list.insert(out_index_list.end(), {v10, v01, v11});
+            }
+        }
+    }
+
+
+    void TestHalfEdgeMesh()
+    {
+        bool is_ok = true;
+
+        // 4x4格子 (32三角形, 境界16エッジ) に非多様体エッジと縮退エッジを追加.
+        std::vector<uint32_t> index_list;
+        MakeHalfEdgeMeshBenchmarkGrid(4, index_list);
+        const int grid_half_edge_count = static_cast<int>(index_list.size());
+        // 格子の対角エッジ 5->1 (HalfEdge 1) と 1->5 (HalfEdge 3) に 1->5 を追加して3つで共有.
+        index_list.insert(index_list.end(), {1, 5, 100});
+        // 同じ向きの 200->201 のみ2つで共有.
+        index_list.insert(index_list.end(), {200, 201, 202});
+        index_list.insert(index_list.end(), {200, 201, 203});
+        // 縮退三角形. 300->300 は縮退エッジ, 300->301 と 301->300 は互いにTwin.
+        index_list.insert(index_list.end(), {300, 300, 301});
+        const int index_count = static_cast<int>(index_list.size());
+
+        // 従来実装と全HalfEdgeが一致する. 縮退エッジのみ従来実装は自身をTwinとするため除外.
+        const HalfEdgeMeshBenchmarkResult result = RunHalfEdgeMeshBenchmark(index_list.data(), index_count, nullptr);
+        is_ok &= result.is_match;
+
+        HalfEdgeMesh mesh;
+        mesh.Initialize(index_list.data(), index_count);
+        const auto& he = mesh.half_edge_;
+        is_ok &= (index_count == static_cast<int>(he.size()));
+
+        // 非多様体エッジは向き毎に最後のHalfEdge同士をTwinとする.
+        const int fin_he        = grid_half_edge_count;
+        const int same_dir_he0  = grid_half_edge_count + 3;
+        const int same_dir_he1  = grid_half_edge_count + 6;
+        const int degenerate_he = grid_half_edge_count + 9;
+        is_ok &= (fin_he == he[1].twin) && (1 == he[fin_he].twin) && (-1 == he[3].twin);
+        is_ok &= (-1 == he[same_dir_he0].twin) && (-1 == he[same_dir_he1].twin);
+        is_ok &= (-1 == he[degenerate_he].twin) && (degenerate_he + 2 == he[degenerate_he + 1].twin) && (degenerate_he + 1 == he[degenerate_he + 2].twin);
+
+        // Twinは対称.
+        for (int i = 0; i < static_cast<int>(he.size()); ++i)
+        {
+            if (0 <= he[i].twin)
+                is_ok &= (i == he[he[i].twin].twin);
+        }
+
+        // 格子 56 + 追加三角形 (2 + 5 + 2) の無向エッジ.
+        const auto& stat = mesh.GetBuildStatistics();
+        is_ok &= (65 == stat.edge_count) && (22 == stat.boundary_edge_count) && (2 == stat.non_manifold_edge_count) && (1 == stat.degenerate_edge_count);
+
+        // 複数桁のRadixSortとなる頂点数でも一致する.
+        MakeHalfEdgeMeshBenchmarkGrid(64, index_list);
+        is_ok &= RunHalfEdgeMeshBenchmark(index_list.data(), static_cast<int>(index_list.size()), nullptr).is_match;
+
+        std::cout << "[TestHalfEdgeMesh]";
+        std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+        assert(is_ok);
+    }
+
 }  // namespace ngl::render::app
@@ -136,26 +136,60 @@ namespace ngl::test
 #endif
 
 				// ----------------------------------------
-				// Raytrace Pass.
-				rtg::RtgResourceHandle h_rt_result = {};
+				// Nodeの生成. Nodeシーケンス上の順序がGPU実行順となるため, Setupを並列実行する前に直列に確定しておく.
+				render::task::TaskRtDispatch* task_rt_test = {};
 				if(render_frame_desc.p_rt_scene)
 				{
 					// 外部からRaytraceSceneが渡されていればPassを生成する.
-					auto* task_rt_test = rtg_builder.AppendTaskNode<render::task::TaskRtDispatch>();
+					task_rt_test = rtg_builder.AppendTaskNode<render::task::TaskRtDispatch>();
+				}
+				auto* task_depth = rtg_builder.AppendTaskNode<ngl::render::task::TaskDepthPass>();
+				auto* task_linear_depth = rtg_builder.AppendTaskNode<ngl::render::task::TaskLinearDepthPass>();
+				auto* task_ss_depth_technique = rtg_builder.AppendTaskNode<ngl::render::task::TaskScreenSpaceDepthTechniquePass>();
+#if ASYNC_COMPUTE_TEST1
+				auto* task_test_compute1 = rtg_builder.AppendTaskNode<ngl::render::task::TaskComputeTest>();
+#endif
+				auto* task_gbuffer = rtg_builder.AppendTaskNode<ngl::render::task::TaskGBufferPass>();
+				auto* task_after_gbuffer_injection = rtg_builder.AppendTaskNode<ngl::render::task::TaskAfterGBufferInjection>();
+				auto* task_skybox = rtg_builder.AppendTaskNode<ngl::render::task::PassSkybox>();
+				auto* task_d_shadow = rtg_builder.AppendTaskNode<ngl::render::task::TaskDirectionalShadowPass>();
+				auto* task_srvs_begin = rtg_builder.AppendTaskNode<ngl::render::app::RenderTaskSrvsBegin>();
+				auto* task_srvs_view_voxel_injection = rtg_builder.AppendTaskNode<ngl::render::app::RenderTaskSrvsViewVoxelInjection>();
+				auto* task_srvs_update = rtg_builder.AppendTaskNode<ngl::render::app::RenderTaskSrvsUpdate>();
+				auto* task_light = rtg_builder.AppendTaskNode<ngl::render::task::TaskLightPass>();
+				auto* task_srvs_view_voxel_radiance_injection = rtg_builder.AppendTaskNode<ngl::render::app::RenderTaskSrvsViewVoxelRadianceInjection>();
+				auto* task_after_light = rtg_builder.AppendTaskNode<ngl::render::task::TaskAfterLightPass>();
+				ngl::render::task::TaskFinalPass* task_final = {};
+				if(!h_swapchain.IsInvalid())
+				{
+					// Swapchainが指定されている場合のみ最終Passを登録.
+					task_final = rtg_builder.AppendTaskNode<ngl::render::task::TaskFinalPass>();
+				}
+
+				// Setupは依存関係の段階毎にジョブとして登録して実行する.
+				//	同じ段階のSetup同士は互いの出力ハンドルを参照できないため, 前段の出力を入力とするSetupは後の段階に登録する.
+				thread::JobSystem* p_setup_job_system = (render_frame_desc.debug_multithread_setup_pass)? rtg_manager.GetJobSystem() : nullptr;
+
+				// ========================================
+				// Setup段階1. 入力ハンドルを持たないPass.
+				
+				// ----------------------------------------
+				// Raytrace Pass.
+				if(task_rt_test)
+				{
+					rtg_builder.AddTaskNodeSetupJob(task_rt_test, [&]()
 					{
 						render::task::TaskRtDispatch::SetupDesc setup_desc{};
 						{
 							setup_desc.p_rt_scene = render_frame_desc.p_rt_scene;
 						}
 						task_rt_test->Setup(rtg_builder, p_device, view_info, setup_desc);
-
-						h_rt_result = task_rt_test->h_rt_result_;
-					}
+					});
 				}
 
 				// ----------------------------------------
 				// PreZ Pass.
-				auto* task_depth = rtg_builder.AppendTaskNode<ngl::render::task::TaskDepthPass>();
+				rtg_builder.AddTaskNodeSetupJob(task_depth, [&]()
 				{
 					ngl::render::task::TaskDepthPass::SetupDesc setup_desc{};
 					{
@@ -166,69 +200,81 @@ namespace ngl::test
 
 						setup_desc.gfx_scene = p_scene->gfx_scene_;
 						setup_desc.p_mesh_proxy_id_array = &p_scene->mesh_proxy_id_array_;
+						
+						setup_desc.draw_split.max_chunk = render_frame_desc.debug_mesh_pass_max_split;
 					}
 					task_depth->Setup(rtg_builder, p_device, view_info, setup_desc);
 					// Renderをスキップテスト.
 					task_depth->is_render_skip_debug_ = k_force_skip_all_pass_render;
-				}
-					
+				});
+
 				// ----------------------------------------
-				// Linear Depth Pass.
-				auto* task_linear_depth = rtg_builder.AppendTaskNode<ngl::render::task::TaskLinearDepthPass>();
+				// DirectionalShadow Pass.
+				rtg_builder.AddTaskNodeSetupJob(task_d_shadow, [&]()
 				{
-					ngl::render::task::TaskLinearDepthPass::SetupDesc setup_desc{};
+					ngl::render::task::TaskDirectionalShadowPass::SetupDesc setup_desc{};
 					{
-						setup_desc.w = screen_w;
-						setup_desc.h = screen_h;
-						
 						setup_desc.scene_cbv = scene_cb_h;
+						
+						setup_desc.gfx_scene = p_scene->gfx_scene_;
+						setup_desc.p_mesh_proxy_id_array = &p_scene->mesh_proxy_id_array_;
+						
+						// Directionalのライト方向テスト.
+						setup_desc.directional_light_dir = ngl::math::Vec3::Normalize(render_frame_desc.feature_config.lighting.directional_light_dir);
+
+						setup_desc.dbg_per_cascade_multithread = render_frame_desc.debug_multithread_cascade_shadow;
+						setup_desc.draw_split.max_chunk = render_frame_desc.debug_mesh_pass_max_split;
 					}
-					task_linear_depth->Setup(rtg_builder, p_device, view_info, task_depth->h_depth_, async_compute_tex0, setup_desc);
+					task_d_shadow->Setup(rtg_builder, p_device, view_info, setup_desc);
 					// Renderをスキップテスト.
-					task_linear_depth->is_render_skip_debug_ = k_force_skip_all_pass_render;
-				}
+					task_d_shadow->is_render_skip_debug_ = k_force_skip_all_pass_render;
+				});
 
+				// ----------------------------------------
+				// Srvs Begin Pass.
+				rtg_builder.AddTaskNodeSetupJob(task_srvs_begin, [&]()
+				{
+					ngl::render::app::RenderTaskSrvsBegin::SetupDesc setup_desc{};
+					{
+						setup_desc.w = screen_w;
+						setup_desc.h = screen_h;
+						
+						setup_desc.scene_cbv = scene_cb_h;
 
-                // ----------------------------------------
-                // Screen Space Depth Technique Pass.
-                auto* task_ss_depth_technique = rtg_builder.AppendTaskNode<ngl::render::task::TaskScreenSpaceDepthTechniquePass>();
-                {
-                    ngl::render::task::TaskScreenSpaceDepthTechniquePass::SetupDesc setup_desc{};
-                    {
-                        setup_desc.w = screen_w;
-                        setup_desc.h = screen_h;
-                        setup_desc.scene_cbv = scene_cb_h;
+						setup_desc.p_srvs = render_frame_desc.feature_config.gi.p_srvs;
+					}
+					task_srvs_begin->Setup(rtg_builder, p_device, view_info, setup_desc);
+				});
+				rtg_builder.ExecuteTaskNodeSetupJob(p_setup_job_system);
 
-                        setup_desc.enable_gtao_demo = render_frame_desc.feature_config.gtao_demo.enable;
-                    }
-					task_ss_depth_technique->Setup(rtg_builder, p_device, view_info, setup_desc, task_depth->h_depth_, task_linear_depth->h_linear_depth_);
-                }
+				rtg::RtgResourceHandle h_rt_result = {};
+				if(task_rt_test)
+				{
+					h_rt_result = task_rt_test->h_rt_result_;
+				}
 
+				// ========================================
+				// Setup段階2. Depth, ShadowDepthを入力とするPass.
 				
-				ngl::rtg::RtgResourceHandle async_compute_tex1 = {};
-#if ASYNC_COMPUTE_TEST1
 				// ----------------------------------------
-				// AsyncCompute Pass.
-				auto* task_test_compute1 = rtg_builder.AppendTaskNode<ngl::render::task::TaskComputeTest>();
+				// Linear Depth Pass.
+				rtg_builder.AddTaskNodeSetupJob(task_linear_depth, [&]()
 				{
-					ngl::render::task::TaskComputeTest::SetupDesc setup_desc{};
+					ngl::render::task::TaskLinearDepthPass::SetupDesc setup_desc{};
 					{
 						setup_desc.w = screen_w;
 						setup_desc.h = screen_h;
 						
 						setup_desc.scene_cbv = scene_cb_h;
 					}
-					task_test_compute1->Setup(rtg_builder, p_device, view_info, task_linear_depth->h_linear_depth_, setup_desc);
+					task_linear_depth->Setup(rtg_builder, p_device, view_info, task_depth->h_depth_, async_compute_tex0, setup_desc);
 					// Renderをスキップテスト.
-					task_test_compute1->is_render_skip_debug_ = k_force_skip_all_pass_render;
+					task_linear_depth->is_render_skip_debug_ = k_force_skip_all_pass_render;
+				});
 
-					async_compute_tex1 = task_test_compute1->h_work_tex_;
-				}
-#endif
-					
 				// ----------------------------------------
 				// GBuffer Pass.
-				auto* task_gbuffer = rtg_builder.AppendTaskNode<ngl::render::task::TaskGBufferPass>();
+				rtg_builder.AddTaskNodeSetupJob(task_gbuffer, [&]()
 				{
 					ngl::render::task::TaskGBufferPass::SetupDesc setup_desc{};
 					{
@@ -239,28 +285,31 @@ namespace ngl::test
 						
 						setup_desc.gfx_scene = p_scene->gfx_scene_;
 						setup_desc.p_mesh_proxy_id_array = &p_scene->mesh_proxy_id_array_;
+						
+						setup_desc.draw_split.max_chunk = render_frame_desc.debug_mesh_pass_max_split;
 					}
 					task_gbuffer->Setup(rtg_builder, p_device, view_info, task_depth->h_depth_, async_compute_tex0, setup_desc);
 					// Renderをスキップテスト.
 					task_gbuffer->is_render_skip_debug_ = k_force_skip_all_pass_render;
-				}
+				});
 
-                // After GBuffer Injection Pass.
-                auto* task_after_gbuffer_injection = rtg_builder.AppendTaskNode<ngl::render::task::TaskAfterGBufferInjection>();
-                {
-                    ngl::render::task::TaskAfterGBufferInjection::SetupDesc setup_desc{};
-                    {
-                        setup_desc.w = screen_w;
-                        setup_desc.h = screen_h;
-                        
-                        setup_desc.scene_cbv = scene_cb_h;
-                    }
+				// ----------------------------------------
+				// After GBuffer Injection Pass.
+				rtg_builder.AddTaskNodeSetupJob(task_after_gbuffer_injection, [&]()
+				{
+					ngl::render::task::TaskAfterGBufferInjection::SetupDesc setup_desc{};
+					{
+						setup_desc.w = screen_w;
+						setup_desc.h = screen_h;
+						
+						setup_desc.scene_cbv = scene_cb_h;
+					}
 					task_after_gbuffer_injection->Setup(rtg_builder, p_device, view_info, task_depth->h_depth_, setup_desc);
-                }
+				});
 				
 				// ----------------------------------------
 				// Skybox Pass.
-				auto* task_skybox = rtg_builder.AppendTaskNode<ngl::render::task::PassSkybox>();
+				rtg_builder.AddTaskNodeSetupJob(task_skybox, [&]()
 				{
 					ngl::render::task::PassSkybox::SetupDesc setup_desc{};
 					{
@@ -306,112 +355,121 @@ namespace ngl::test
 					}
 					
 					task_skybox->Setup(rtg_builder, p_device, view_info, setup_desc, task_depth->h_depth_, {});
-				}
-				
-					
+				});
+
 				// ----------------------------------------
-				// DirectionalShadow Pass.
-				auto* task_d_shadow = rtg_builder.AppendTaskNode<ngl::render::task::TaskDirectionalShadowPass>();
+				// Srvs View Voxel Injection Pass.
+				rtg_builder.AddTaskNodeSetupJob(task_srvs_view_voxel_injection, [&]()
 				{
-					ngl::render::task::TaskDirectionalShadowPass::SetupDesc setup_desc{};
+					ngl::render::app::RenderTaskSrvsViewVoxelInjection::SetupDesc setup_desc{};
 					{
-						setup_desc.scene_cbv = scene_cb_h;
+						setup_desc.w = screen_w;
+						setup_desc.h = screen_h;
 						
-						setup_desc.gfx_scene = p_scene->gfx_scene_;
-						setup_desc.p_mesh_proxy_id_array = &p_scene->mesh_proxy_id_array_;
+						setup_desc.scene_cbv = scene_cb_h;
+						setup_desc.p_srvs = render_frame_desc.feature_config.gi.p_srvs;
+
+						// main view DepthBuffer登録.
+						{
+							setup_desc.depth_buffer_info.primary.view_mat = view_info.view_mat;
+							setup_desc.depth_buffer_info.primary.proj_mat = view_info.proj_mat;
+							setup_desc.depth_buffer_info.primary.atlas_offset = math::Vec2i(0,0);
+							setup_desc.depth_buffer_info.primary.atlas_resolution = math::Vec2i(screen_w, screen_h);
+							setup_desc.depth_buffer_info.primary.h_depth = task_depth->h_depth_;
+
+							setup_desc.depth_buffer_info.primary.is_enable_injection_pass = (render_frame_desc.feature_config.gi.enable_srvs_injection_pass) && true;// Voxel充填利用するか.
+							setup_desc.depth_buffer_info.primary.is_enable_removal_pass = (render_frame_desc.feature_config.gi.enable_srvs_rejection_pass) && true;// Voxel除去に利用するか.
+						}
+
+						// ShadowMapのDepthBuffer登録. 高速化のためにフレーム毎にカスケードスキップするのもありかもしれない.
+						for( int cascade_idx = 0; cascade_idx < task_d_shadow->csm_param_.k_cascade_count; ++cascade_idx )
+						{
+							ngl::render::app::InjectionSourceDepthBufferViewInfo shadow_depth_info{};
+							{
+								shadow_depth_info.view_mat = task_d_shadow->csm_param_.light_view_mtx[cascade_idx];
+								shadow_depth_info.proj_mat = task_d_shadow->csm_param_.light_ortho_mtx[cascade_idx];
+								shadow_depth_info.atlas_offset = math::Vec2i(task_d_shadow->csm_param_.cascade_tile_offset_x[cascade_idx], task_d_shadow->csm_param_.cascade_tile_offset_y[cascade_idx]);
+								shadow_depth_info.atlas_resolution = math::Vec2i(task_d_shadow->csm_param_.cascade_tile_size_x[cascade_idx], task_d_shadow->csm_param_.cascade_tile_size_y[cascade_idx]);
+								shadow_depth_info.h_depth = task_d_shadow->h_shadow_depth_atlas_;
+								
+								shadow_depth_info.is_enable_injection_pass = (render_frame_desc.feature_config.gi.enable_srvs_injection_pass) && true;// Voxel充填に利用するか.
+								shadow_depth_info.is_enable_removal_pass = (render_frame_desc.feature_config.gi.enable_srvs_rejection_pass) && true;// Voxel除去に利用するか.
+							}
+
+							setup_desc.depth_buffer_info.sub_array.push_back(shadow_depth_info);
+						}
+					}
+					task_srvs_view_voxel_injection->Setup(rtg_builder, p_device, view_info, setup_desc);
+				});
+
+				// ----------------------------------------
+				// Srvs Update.
+				rtg_builder.AddTaskNodeSetupJob(task_srvs_update, [&]()
+				{
+					ngl::render::app::RenderTaskSrvsUpdate::SetupDesc setup_desc{};
+					{
+						setup_desc.w = screen_w;
+						setup_desc.h = screen_h;
 						
-						// Directionalのライト方向テスト.
-						setup_desc.directional_light_dir = ngl::math::Vec3::Normalize(render_frame_desc.feature_config.lighting.directional_light_dir);
+						setup_desc.scene_cbv = scene_cb_h;
 
-						setup_desc.dbg_per_cascade_multithread = render_frame_desc.debug_multithread_cascade_shadow;
+						setup_desc.p_srvs = render_frame_desc.feature_config.gi.p_srvs;
+						
+						// main view.
+						setup_desc.h_depth = task_depth->h_depth_;
 					}
-					task_d_shadow->Setup(rtg_builder, p_device, view_info, setup_desc);
-					// Renderをスキップテスト.
-					task_d_shadow->is_render_skip_debug_ = k_force_skip_all_pass_render;
-				}
-					
-                
-                    
-                    // Srvs Begin Pass.
-                    auto* task_srvs_begin = rtg_builder.AppendTaskNode<ngl::render::app::RenderTaskSrvsBegin>();
-                    {
-                        ngl::render::app::RenderTaskSrvsBegin::SetupDesc setup_desc{};
-                        {
-							setup_desc.w = screen_w;
-							setup_desc.h = screen_h;
-                            
-							setup_desc.scene_cbv = scene_cb_h;
+					task_srvs_update->Setup(rtg_builder, p_device, view_info, setup_desc);
+				});
+				rtg_builder.ExecuteTaskNodeSetupJob(p_setup_job_system);
 
-							setup_desc.p_srvs = render_frame_desc.feature_config.gi.p_srvs;
-                        }
-                        task_srvs_begin->Setup(rtg_builder, p_device, view_info, setup_desc);
-                    }
-                    // Srvs View Voxel Injection Pass.
-                    auto* task_srvs_view_voxel_injection = rtg_builder.AppendTaskNode<ngl::render::app::RenderTaskSrvsViewVoxelInjection>();
-                    {
-                        ngl::render::app::RenderTaskSrvsViewVoxelInjection::SetupDesc setup_desc{};
-                        {
-							setup_desc.w = screen_w;
-							setup_desc.h = screen_h;
-                            
-							setup_desc.scene_cbv = scene_cb_h;
-							setup_desc.p_srvs = render_frame_desc.feature_config.gi.p_srvs;
-
-                            // main view DepthBuffer登録.
-                            {
-								setup_desc.depth_buffer_info.primary.view_mat = view_info.view_mat;
-								setup_desc.depth_buffer_info.primary.proj_mat = view_info.proj_mat;
-								setup_desc.depth_buffer_info.primary.atlas_offset = math::Vec2i(0,0);
-								setup_desc.depth_buffer_info.primary.atlas_resolution = math::Vec2i(screen_w, screen_h);
-								setup_desc.depth_buffer_info.primary.h_depth = task_depth->h_depth_;
-
-								setup_desc.depth_buffer_info.primary.is_enable_injection_pass = (render_frame_desc.feature_config.gi.enable_srvs_injection_pass) && true;// Voxel充填利用するか.
-								setup_desc.depth_buffer_info.primary.is_enable_removal_pass = (render_frame_desc.feature_config.gi.enable_srvs_rejection_pass) && true;// Voxel除去に利用するか.
-                            }
-
-                            // ShadowMapのDepthBuffer登録. 高速化のためにフレーム毎にカスケードスキップするのもありかもしれない.
-							for( int cascade_idx = 0; cascade_idx < task_d_shadow->csm_param_.k_cascade_count; ++cascade_idx )
-                            {
-                                ngl::render::app::InjectionSourceDepthBufferViewInfo shadow_depth_info{};
-                                {
-									shadow_depth_info.view_mat = task_d_shadow->csm_param_.light_view_mtx[cascade_idx];
-									shadow_depth_info.proj_mat = task_d_shadow->csm_param_.light_ortho_mtx[cascade_idx];
-									shadow_depth_info.atlas_offset = math::Vec2i(task_d_shadow->csm_param_.cascade_tile_offset_x[cascade_idx], task_d_shadow->csm_param_.cascade_tile_offset_y[cascade_idx]);
-									shadow_depth_info.atlas_resolution = math::Vec2i(task_d_shadow->csm_param_.cascade_tile_size_x[cascade_idx], task_d_shadow->csm_param_.cascade_tile_size_y[cascade_idx]);
-									shadow_depth_info.h_depth = task_d_shadow->h_shadow_depth_atlas_;
-                                    
-									shadow_depth_info.is_enable_injection_pass = (render_frame_desc.feature_config.gi.enable_srvs_injection_pass) && true;// Voxel充填に利用するか.
-									shadow_depth_info.is_enable_removal_pass = (render_frame_desc.feature_config.gi.enable_srvs_rejection_pass) && true;// Voxel除去に利用するか.
-                                }
-
-									setup_desc.depth_buffer_info.sub_array.push_back(shadow_depth_info);
-                            }   
-                        }
-                        task_srvs_view_voxel_injection->Setup(rtg_builder, p_device, view_info, setup_desc);
-                    }
-                    // Srvs Update.
-                    auto* task_srvs_update = rtg_builder.AppendTaskNode<ngl::render::app::RenderTaskSrvsUpdate>();
-                    {
-                        ngl::render::app::RenderTaskSrvsUpdate::SetupDesc setup_desc{};
-                        {
-							setup_desc.w = screen_w;
-							setup_desc.h = screen_h;
-                            
-							setup_desc.scene_cbv = scene_cb_h;
+				// ========================================
+				// Setup段階3. LinearDepthを入力とするPass.
 
-							setup_desc.p_srvs = render_frame_desc.feature_config.gi.p_srvs;
-                            
-                            // main view.
-							setup_desc.h_depth = task_depth->h_depth_;
-                        }
-                        task_srvs_update->Setup(rtg_builder, p_device, view_info, setup_desc);
-                    }
+				// ----------------------------------------
+				// Screen Space Depth Technique Pass.
+				rtg_builder.AddTaskNodeSetupJob(task_ss_depth_technique, [&]()
+				{
+					ngl::render::task::TaskScreenSpaceDepthTechniquePass::SetupDesc setup_desc{};
+					{
+						setup_desc.w = screen_w;
+						setup_desc.h = screen_h;
+						setup_desc.scene_cbv = scene_cb_h;
+
+						setup_desc.enable_gtao_demo = render_frame_desc.feature_config.gtao_demo.enable;
+					}
+					task_ss_depth_technique->Setup(rtg_builder, p_device, view_info, setup_desc, task_depth->h_depth_, task_linear_depth->h_linear_depth_);
+				});
 
+#if ASYNC_COMPUTE_TEST1
+				// ----------------------------------------
+				// AsyncCompute Pass.
+				rtg_builder.AddTaskNodeSetupJob(task_test_compute1, [&]()
+				{
+					ngl::render::task::TaskComputeTest::SetupDesc setup_desc{};
+					{
+						setup_desc.w = screen_w;
+						setup_desc.h = screen_h;
+						
+						setup_desc.scene_cbv = scene_cb_h;
+					}
+					task_test_compute1->Setup(rtg_builder, p_device, view_info, task_linear_depth->h_linear_depth_, setup_desc);
+					// Renderをスキップテスト.
+					task_test_compute1->is_render_skip_debug_ = k_force_skip_all_pass_render;
+				});
+#endif
+				rtg_builder.ExecuteTaskNodeSetupJob(p_setup_job_system);
+
+				ngl::rtg::RtgResourceHandle async_compute_tex1 = {};
+#if ASYNC_COMPUTE_TEST1
+				async_compute_tex1 = task_test_compute1->h_work_tex_;
+#endif
 
+				// ========================================
+				// Setup段階4. Lighting.
 
 				// ----------------------------------------
 				// Deferred Lighting Pass.
-				auto* task_light = rtg_builder.AppendTaskNode<ngl::render::task::TaskLightPass>();
+				rtg_builder.AddTaskNodeSetupJob(task_light, [&]()
 				{
 					ngl::render::task::TaskLightPass::SetupDesc setup_desc{};
 					{
@@ -424,16 +482,16 @@ namespace ngl::test
 						setup_desc.scene = p_scene->gfx_scene_;
 						setup_desc.skybox_proxy_id = p_scene->skybox_proxy_id_;
 						
-                        setup_desc.d_lit_intensity = render_frame_desc.feature_config.lighting.directional_light_intensity;
-                        setup_desc.sky_lit_intensity = render_frame_desc.feature_config.lighting.sky_light_intensity;
-
-                        setup_desc.p_srvs = render_frame_desc.feature_config.gi.p_srvs;
-                        setup_desc.is_enable_gi_lighting = render_frame_desc.feature_config.gi.enable_gi_lighting;
-                        setup_desc.probe_sample_offset_view = render_frame_desc.feature_config.gi.probe_sample_offset_view;
-                        setup_desc.probe_sample_offset_surface_normal = render_frame_desc.feature_config.gi.probe_sample_offset_surface_normal;
-                        setup_desc.probe_sample_offset_bent_normal = render_frame_desc.feature_config.gi.probe_sample_offset_bent_normal;
-                        setup_desc.dbg_view_srvs_sky_visibility = render_frame_desc.debugview_srvs_sky_visibility;
-                        
+						setup_desc.d_lit_intensity = render_frame_desc.feature_config.lighting.directional_light_intensity;
+						setup_desc.sky_lit_intensity = render_frame_desc.feature_config.lighting.sky_light_intensity;
+
+						setup_desc.p_srvs = render_frame_desc.feature_config.gi.p_srvs;
+						setup_desc.is_enable_gi_lighting = render_frame_desc.feature_config.gi.enable_gi_lighting;
+						setup_desc.probe_sample_offset_view = render_frame_desc.feature_config.gi.probe_sample_offset_view;
+						setup_desc.probe_sample_offset_surface_normal = render_frame_desc.feature_config.gi.probe_sample_offset_surface_normal;
+						setup_desc.probe_sample_offset_bent_normal = render_frame_desc.feature_config.gi.probe_sample_offset_bent_normal;
+						setup_desc.dbg_view_srvs_sky_visibility = render_frame_desc.debugview_srvs_sky_visibility;
+						
 						setup_desc.enable_feedback_blur_test = render_frame_desc.debugview_enable_feedback_blur_test;
 					}
 					task_light->Setup(rtg_builder, p_device, view_info,
@@ -446,32 +504,36 @@ namespace ngl::test
 						setup_desc);
 					// Renderをスキップテスト.
 					task_light->is_render_skip_debug_ = k_force_skip_all_pass_render;
-				}
+				});
+				rtg_builder.ExecuteTaskNodeSetupJob(p_setup_job_system);
+
+				// ========================================
+				// Setup段階5. Lighting結果を入力とするPass.
 
 				// ----------------------------------------
 				// After Lighting Pass.
-                    auto* task_srvs_view_voxel_radiance_injection = rtg_builder.AppendTaskNode<ngl::render::app::RenderTaskSrvsViewVoxelRadianceInjection>();
-                    {
-                        ngl::render::app::RenderTaskSrvsViewVoxelRadianceInjection::SetupDesc setup_desc{};
-                        {
-                            setup_desc.w = screen_w;
-                            setup_desc.h = screen_h;
-
-                            setup_desc.scene_cbv = scene_cb_h;
-                            setup_desc.p_srvs = render_frame_desc.feature_config.gi.p_srvs;
-
-                            setup_desc.view_info.view_mat = view_info.view_mat;
-                            setup_desc.view_info.proj_mat = view_info.proj_mat;
-                            setup_desc.view_info.atlas_offset = math::Vec2i(0, 0);
-                            setup_desc.view_info.atlas_resolution = math::Vec2i(screen_w, screen_h);
-                            setup_desc.view_info.h_depth = task_depth->h_depth_;
-                            setup_desc.view_info.h_color = task_light->h_light_;
-                            setup_desc.view_info.is_enable_radiance_injection_pass = (render_frame_desc.feature_config.gi.enable_srvs_injection_pass) && true;
-                        }
-                        task_srvs_view_voxel_radiance_injection->Setup(rtg_builder, p_device, view_info, setup_desc);
-                    }
+				rtg_builder.AddTaskNodeSetupJob(task_srvs_view_voxel_radiance_injection, [&]()
+				{
+					ngl::render::app::RenderTaskSrvsViewVoxelRadianceInjection::SetupDesc setup_desc{};
+					{
+						setup_desc.w = screen_w;
+						setup_desc.h = screen_h;
 
-				auto* task_after_light = rtg_builder.AppendTaskNode<ngl::render::task::TaskAfterLightPass>();
+						setup_desc.scene_cbv = scene_cb_h;
+						setup_desc.p_srvs = render_frame_desc.feature_config.gi.p_srvs;
+
+						setup_desc.view_info.view_mat = view_info.view_mat;
+						setup_desc.view_info.proj_mat = view_info.proj_mat;
+						setup_desc.view_info.atlas_offset = math::Vec2i(0, 0);
+						setup_desc.view_info.atlas_resolution = math::Vec2i(screen_w, screen_h);
+						setup_desc.view_info.h_depth = task_depth->h_depth_;
+						setup_desc.view_info.h_color = task_light->h_light_;
+						setup_desc.view_info.is_enable_radiance_injection_pass = (render_frame_desc.feature_config.gi.enable_srvs_injection_pass) && true;
+					}
+					task_srvs_view_voxel_radiance_injection->Setup(rtg_builder, p_device, view_info, setup_desc);
+				});
+
+				rtg_builder.AddTaskNodeSetupJob(task_after_light, [&]()
 				{
 					ngl::render::task::TaskAfterLightPass::SetupDesc setup_desc{};
 					{
@@ -480,21 +542,20 @@ namespace ngl::test
 						
 						setup_desc.scene_cbv = scene_cb_h;
 
-                        setup_desc.p_srvs = render_frame_desc.feature_config.gi.p_srvs;
+						setup_desc.p_srvs = render_frame_desc.feature_config.gi.p_srvs;
 					}
 					task_after_light->Setup(rtg_builder, p_device, view_info,
 					task_light->h_light_, task_depth->h_depth_,
 						setup_desc);
 					// Renderをスキップテスト.
 					task_after_light->is_render_skip_debug_ = k_force_skip_all_pass_render;
-				}
+				});
 
 				// ----------------------------------------
 				// Final Composite to Swapchain.
-				if(!h_swapchain.IsInvalid())
+				if(task_final)
 				{
-					// Swapchainが指定されている場合のみ最終Passを登録.
-					auto* task_final = rtg_builder.AppendTaskNode<ngl::render::task::TaskFinalPass>();
+					rtg_builder.AddTaskNodeSetupJob(task_final, [&]()
 					{
 						// GBufferデバッグ表示用のリソース.
 						rtg::RtgResourceHandle debug_gbuffer0 = {};
@@ -528,50 +589,50 @@ namespace ngl::test
 							setup_desc.debugview_gbuffer = render_frame_desc.debugview_gbuffer;
 							setup_desc.debugview_dshadow = render_frame_desc.debugview_dshadow;
 
-                            setup_desc.debugview_general_debug_buffer = render_frame_desc.debugview_general_debug_buffer;
-                            setup_desc.debugview_general_debug_channel = render_frame_desc.debugview_general_debug_channel;
-                            setup_desc.debugview_general_debug_rate = render_frame_desc.debugview_general_debug_rate;
+							setup_desc.debugview_general_debug_buffer = render_frame_desc.debugview_general_debug_buffer;
+							setup_desc.debugview_general_debug_channel = render_frame_desc.debugview_general_debug_channel;
+							setup_desc.debugview_general_debug_rate = render_frame_desc.debugview_general_debug_rate;
 						}
 						
-                        rtg::RtgResourceHandle general_debug_tex = {};
-                        {
-                            // 汎用デバッグテクスチャ指定.
-                            switch(render_frame_desc.debugview_general_debug_buffer)
-                            {
-                            case EDebugBufferMode::GBuffer0:
-                                general_debug_tex = debug_gbuffer0;
-                                break;
-                            case EDebugBufferMode::GBuffer1:
-                                general_debug_tex = debug_gbuffer1;
-                                break;
-                            case EDebugBufferMode::GBuffer2:
-                                general_debug_tex = debug_gbuffer2;
-                                break;
-                            case EDebugBufferMode::GBuffer3:
-                                general_debug_tex = debug_gbuffer3;
-                                break;
-                            case EDebugBufferMode::HardwareDepth:
+						rtg::RtgResourceHandle general_debug_tex = {};
+						{
+							// 汎用デバッグテクスチャ指定.
+							switch(render_frame_desc.debugview_general_debug_buffer)
+							{
+							case EDebugBufferMode::GBuffer0:
+								general_debug_tex = debug_gbuffer0;
+								break;
+							case EDebugBufferMode::GBuffer1:
+								general_debug_tex = debug_gbuffer1;
+								break;
+							case EDebugBufferMode::GBuffer2:
+								general_debug_tex = debug_gbuffer2;
+								break;
+							case EDebugBufferMode::GBuffer3:
+								general_debug_tex = debug_gbuffer3;
+								break;
+							case EDebugBufferMode::HardwareDepth:
 								general_debug_tex = task_depth->h_depth_;
-                                break;
+								break;
 
-                            case EDebugBufferMode::DirectionalShadowAtlas:
-                                general_debug_tex = debug_dshadow;
-                                break;
-                                
-                            case EDebugBufferMode::GtaoDemo:
+							case EDebugBufferMode::DirectionalShadowAtlas:
+								general_debug_tex = debug_dshadow;
+								break;
+								
+							case EDebugBufferMode::GtaoDemo:
 								general_debug_tex = task_ss_depth_technique->h_gtao_bent_normal_;
-                                break;
-                            case EDebugBufferMode::BentNormalTest:
+								break;
+							case EDebugBufferMode::BentNormalTest:
 								general_debug_tex = task_ss_depth_technique->h_bent_normal_;
-                                break;
-                            case EDebugBufferMode::SrvsDebugTexture:
-                                general_debug_tex = task_srvs_update->h_work_;
-                                break;
-                            default:
-                                break;
-                            }
-                        }
-                        
+								break;
+							case EDebugBufferMode::SrvsDebugTexture:
+								general_debug_tex = task_srvs_update->h_work_;
+								break;
+							default:
+								break;
+							}
+						}
+						
 
 						task_final->Setup(rtg_builder, p_device, view_info, h_swapchain,
 							task_gbuffer->h_depth_, task_linear_depth->h_linear_depth_, task_light->h_light_,
@@ -579,15 +640,16 @@ namespace ngl::test
 							debug_gbuffer0, debug_gbuffer1, debug_gbuffer2, debug_gbuffer3,
 							debug_dshadow,
 
-                            general_debug_tex,
+							general_debug_tex,
 
 							render_frame_desc.ref_test_tex_srv,
 
 							setup_desc);
 						// Renderをスキップテスト.
 						task_final->is_render_skip_debug_ = k_force_skip_all_pass_render;
-					}
+					});
 				}
+				rtg_builder.ExecuteTaskNodeSetupJob(p_setup_job_system);
 
 				// ImGuiの描画用Taskを登録.
 				if(!h_swapchain.IsInvalid())
@@ -11,12 +11,14 @@
 
 #include "file/file.h"
 #include "gfx/resource/mesh_loader_assimp.h"
+#include "gfx/resource/texture_cooker_directxtex.h"
 #include "gfx/resource/texture_loader_directxtex.h"
+#include "gfx/resource/texture_streaming_system.h"
 
 namespace
 {
 	constexpr char k_mesh_cache_magic[4] = {'N', 'G', 'L', 'M'};
-	constexpr ngl::u32 k_mesh_cache_version = 1;
+	constexpr ngl::u32 k_mesh_cache_version = 4;// 2: 頂点キャッシュ/オーバードロー/頂点フェッチ最適化済み. 3: Meshlet追加. 4: 量子化頂点ストリーム追加.
 	constexpr const char* k_mesh_cache_dir = "../ngl/data/cache";
 
 	struct MeshCacheHeader
@@ -92,6 +94,14 @@ namespace
 		for (int i = 0; i < layout.offset_uv.size(); ++i)
 			WritePod(out, layout.offset_uv[i]);
 		WritePod(out, layout.offset_index);
+		WritePod(out, layout.vertex_format);
+		WritePod(out, layout.offset_position_q);
+		WritePod(out, layout.offset_normal_q);
+		WritePod(out, layout.offset_tangent_q);
+		for (int i = 0; i < layout.offset_uv_q.size(); ++i)
+			WritePod(out, layout.offset_uv_q[i]);
+		WritePod(out, layout.position_dequant_scale);
+		WritePod(out, layout.position_dequant_offset);
 	}
 
 	bool ReadLayout(const std::vector<ngl::u8>& data, size_t& offset, ngl::gfx::MeshShapeLayout& out_layout)
@@ -126,6 +136,67 @@ namespace
 		}
 		if (!ReadPod(data, offset, out_layout.offset_index))
 			return false;
+		if (!ReadPod(data, offset, out_layout.vertex_format))
+			return false;
+		if (!ReadPod(data, offset, out_layout.offset_position_q))
+			return false;
+		if (!ReadPod(data, offset, out_layout.offset_normal_q))
+			return false;
+		if (!ReadPod(data, offset, out_layout.offset_tangent_q))
+			return false;
+		for (int i = 0; i < out_layout.offset_uv_q.size(); ++i)
+		{
+			if (!ReadPod(data, offset, out_layout.offset_uv_q[i]))
+				return false;
+		}
+		if (!ReadPod(data, offset, out_layout.position_dequant_scale))
+			return false;
+		if (!ReadPod(data, offset, out_layout.position_dequant_offset))
+			return false;
+		return true;
+	}
+
+	template<typename T>
+	void WriteArray(std::vector<ngl::u8>& out, const std::vector<T>& arr)
+	{
+		const ngl::u32 count = static_cast<ngl::u32>(arr.size());
+		WritePod(out, count);
+		if (count > 0)
+			WriteBytes(out, arr.data(), sizeof(T) * count);
+	}
+
+	template<typename T>
+	bool ReadArray(const std::vector<ngl::u8>& data, size_t& offset, std::vector<T>& out_arr)
+	{
+		ngl::u32 count = 0;
+		if (!ReadPod(data, offset, count))
+			return false;
+		if (offset + sizeof(T) * count > data.size())
+			return false;
+		out_arr.resize(count);
+		return ReadBytes(data, offset, out_arr.data(), sizeof(T) * count);
+	}
+
+	void WriteMeshlet(std::vector<ngl::u8>& out, const ngl::gfx::MeshletShapeData& meshlet_data)
+	{
+		WriteArray(out, meshlet_data.meshlet);
+		WriteArray(out, meshlet_data.bounds);
+		WriteArray(out, meshlet_data.vertex_index);
+		WriteArray(out, meshlet_data.triangle_index);
+	}
+
+	bool ReadMeshlet(const std::vector<ngl::u8>& data, size_t& offset, ngl::gfx::MeshletShapeData& out_meshlet_data)
+	{
+		if (!ReadArray(data, offset, out_meshlet_data.meshlet))
+			return false;
+		if (!ReadArray(data, offset, out_meshlet_data.bounds))
+			return false;
+		if (!ReadArray(data, offset, out_meshlet_data.vertex_index))
+			return false;
+		if (!ReadArray(data, offset, out_meshlet_data.triangle_index))
+			return false;
+		if (out_meshlet_data.meshlet.size() != out_meshlet_data.bounds.size())
+			return false;
 		return true;
 	}
 
@@ -243,6 +314,14 @@ namespace
 		if (!ReadBytes(file_data, offset, out_mesh.raw_data_mem_.data(), header.raw_data_size))
 			return false;
 
+		out_mesh.shape_meshlet_array_.clear();
+		out_mesh.shape_meshlet_array_.resize(header.shape_count);
+		for (ngl::u32 i = 0; i < header.shape_count; ++i)
+		{
+			if (!ReadMeshlet(file_data, offset, out_mesh.shape_meshlet_array_[i]))
+				return false;
+		}
+
 		return true;
 	}
 
@@ -291,6 +370,13 @@ namespace
 
 		WriteBytes(out_data, mesh.raw_data_mem_.data(), mesh.raw_data_mem_.size());
 
+		// Meshlet. 未構築のShapeは空で書き出す.
+		for (ngl::u32 i = 0; i < header.shape_count; ++i)
+		{
+			const ngl::gfx::MeshletShapeData empty_meshlet = {};
+			WriteMeshlet(out_data, (i < mesh.shape_meshlet_array_.size()) ? mesh.shape_meshlet_array_[i] : empty_meshlet);
+		}
+
 		return ngl::file::WriteFileFromBuffer(cache_path.string().c_str(), out_data);
 	}
 }
@@ -323,7 +409,14 @@ namespace res
 		std::vector<int> shape_material_index_array = {};
 		std::vector<gfx::MeshShapeLayout> shape_layout_array = {};
 
-		const u64 src_hash = file::CalcFileHashFNV1a64(p_res->GetFileName());
+		const bool enable_vertex_quantize = p_desc && p_desc->enable_vertex_quantize;
+		// キャッシュキーはソースの内容とロードオプションから決定する.
+		u64 src_hash = file::CalcFileHashFNV1a64(p_res->GetFileName());
+		if (0 != src_hash && enable_vertex_quantize)
+		{
+			constexpr u64 k_fnv1a64_prime = 1099511628211ull;
+			src_hash = (src_hash ^ static_cast<u64>(gfx::EMeshVertexFormat::QUANTIZED)) * k_fnv1a64_prime;
+		}
 		std::filesystem::path cache_path;
 		bool cache_hit = false;
 		if (BuildMeshCachePath(p_res->GetFileName(), src_hash, cache_path))
@@ -338,7 +431,7 @@ namespace res
 		}
 		else
 		{
-			const bool result_load_mesh = assimp::LoadMeshData(p_res->data_, material_array, shape_material_index_array, shape_layout_array, p_device, p_res->GetFileName());
+			const bool result_load_mesh = assimp::LoadMeshData(p_res->data_, material_array, shape_material_index_array, shape_layout_array, p_device, p_res->GetFileName(), enable_vertex_quantize);
 			if (!result_load_mesh)
 				return false;
 
@@ -418,6 +511,8 @@ namespace res
 	bool ResourceManager::LoadResourceImpl(rhi::DeviceDep* p_device, gfx::ResTexture* p_res, gfx::ResTexture::LoadDesc* p_desc)
 	{
 		rhi::TextureDep::Desc load_img_desc = {};
+		// Cook済みキャッシュファイル. ストリーミングでMipを再読み込みする.
+		directxtex::TextureCookCacheFile cook_cache_file = {};
 		
 		if(p_desc && gfx::ResTexture::ECreateMode::FROM_FILE ==  p_desc->mode)
 		{
@@ -447,7 +542,15 @@ namespace res
 				is_hdr = CheckExt(hdr_ext, file_name, file_name_length);
 			}
 
-			if(is_dds)
+			if (directxtex::ETextureCookUsage::None != p_desc->cook_usage)
+			{
+				// Cook済みキャッシュからロード. キャッシュが無ければソースからMip生成とブロック圧縮を行ってキャッシュする.
+				directxtex::TextureCookDesc cook_desc = {};
+				cook_desc.usage = p_desc->cook_usage;
+				if (!directxtex::LoadImageData_Cooked(image_data, meta_data, p_res->GetFileName(), cook_desc, &cook_cache_file))
+					return false;
+			}
+			else if(is_dds)
 			{
 				// DDS ロード.
 				if(!directxtex::LoadImageData_DDS(image_data, meta_data, p_device, p_res->GetFileName()))
@@ -556,6 +659,7 @@ namespace res
 
 		
 		// resにオブジェクト生成.
+		p_res->is_upload_immediate_ = p_desc && p_desc->upload_immediate;
 		p_res->ref_texture_.Reset(new rhi::TextureDep());
 		p_res->ref_view_.Reset(new rhi::ShaderResourceViewDep());
 		{
@@ -565,9 +669,82 @@ namespace res
 				load_img_desc.heap_type = rhi::EResourceHeapType::Default;// GPU読み取り用.
 				load_img_desc.bind_flag = rhi::ResourceBindFlag::ShaderResource;// シェーダリソース用途.
 			}
-			// 生成.
-			p_res->ref_texture_->Initialize(p_device, load_img_desc);
-			p_res->ref_view_->InitializeAsTexture(p_device, p_res->ref_texture_.Get(), 0, load_img_desc.mip_count, 0, load_img_desc.array_size);
+			// Cook済みの2Dテクスチャはストリーミング対象とし, Mip TailのみのTextureで開始する.
+			//	常駐Mipの変化ではTextureを再生成するため, 先頭になり得る全てのMipがブロック圧縮の4の倍数のサイズである必要がある.
+			auto& streaming_system = gfx::TextureStreamingSystem::Instance();
+			const u32 mip_count = static_cast<u32>(load_img_desc.mip_count);
+			const u32 tail_top_mip = streaming_system.IsValid() ? streaming_system.CalcTailTopMip(mip_count) : 0;
+			bool is_streaming = streaming_system.IsValid() && gfx::UploadManager::Instance().IsValid()
+				&& p_desc && gfx::ResTexture::ECreateMode::FROM_FILE == p_desc->mode && directxtex::ETextureCookUsage::None != p_desc->cook_usage && !p_desc->upload_immediate
+				&& cook_cache_file.IsValid()
+				&& rhi::ETextureType::Texture2D == load_img_desc.type && rhi::EResourceState::Common == load_img_desc.initial_state
+				&& 0 < tail_top_mip;
+			for (u32 mip = 0; is_streaming && mip <= tail_top_mip; ++mip)
+				is_streaming = (0 == ((load_img_desc.width >> mip) & 3)) && (0 == ((load_img_desc.height >> mip) & 3));
+
+			if (!is_streaming)
+			{
+				// 生成.
+				p_res->ref_texture_->Initialize(p_device, load_img_desc);
+				p_res->ref_view_->InitializeAsTexture(p_device, p_res->ref_texture_.Get(), 0, mip_count, 0, load_img_desc.array_size);
+			}
+			else
+			{
+				// キャッシュファイル上の各Subresourceの位置. ピクセル以外の情報はストリーミングで再読み込みするために保持する.
+				auto source = std::make_shared<gfx::TextureStreamingSource>();
+				source->cache_file_path = cook_cache_file.path;
+				source->desc = load_img_desc;
+				source->subresource_info_array = p_res->upload_subresource_info_array;
+				source->file_offset_array.resize(source->subresource_info_array.size());
+				// キャッシュファイルのピクセル部は作業メモリと同じ配置.
+				for (size_t i = 0; i < source->subresource_info_array.size(); ++i)
+				{
+					source->file_offset_array[i] = cook_cache_file.pixel_byte_offset + static_cast<u64>(source->subresource_info_array[i].pixels - p_res->upload_pixel_memory_.data());
+					source->subresource_info_array[i].pixels = nullptr;
+				}
+
+				// Mip TailのみのTexture.
+				const rhi::TextureDep::Desc tail_desc = gfx::MakeStreamingTextureDesc(load_img_desc, tail_top_mip);
+				const u32 tail_mip_count = static_cast<u32>(tail_desc.mip_count);
+				p_res->ref_texture_->Initialize(p_device, tail_desc);
+				p_res->ref_view_->InitializeAsTexture(p_device, p_res->ref_texture_.Get(), 0, tail_mip_count, 0, tail_desc.array_size);
+
+				// Mip Tailのピクセルのみを抜き出してアップロードする. 全Mipのピクセルはここで破棄する.
+				auto tail_source = std::make_shared<gfx::TextureUploadSource>();
+				{
+					u64 tail_byte_size = 0;
+					for (u32 array_index = 0; array_index < static_cast<u32>(load_img_desc.array_size); ++array_index)
+						for (u32 mip = tail_top_mip; mip < mip_count; ++mip)
+							tail_byte_size += static_cast<u64>(p_res->upload_subresource_info_array[mip + array_index * mip_count].slicePitch);
+					tail_source->pixel_memory.resize(tail_byte_size);
+
+					u64 offset = 0;
+					for (u32 array_index = 0; array_index < static_cast<u32>(load_img_desc.array_size); ++array_index)
+					{
+						for (u32 mip = tail_top_mip; mip < mip_count; ++mip)
+						{
+							auto info = p_res->upload_subresource_info_array[mip + array_index * mip_count];
+							memcpy(tail_source->pixel_memory.data() + offset, info.pixels, info.slicePitch);
+							info.mip_index = static_cast<s32>(mip - tail_top_mip);
+							info.pixels = tail_source->pixel_memory.data() + offset;
+							offset += static_cast<u64>(info.slicePitch);
+							tail_source->subresource_info_array.push_back(info);
+						}
+					}
+					tail_source->dst_layout.resize(p_res->ref_texture_->NumSubresource());
+					p_res->ref_texture_->GetSubresourceLayoutInfo(tail_source->dst_layout.data(), tail_source->dst_byte_size);
+				}
+				p_res->upload_pixel_memory_ = {};
+				p_res->upload_subresource_info_array = {};
+				p_res->streaming_source_ = source;
+
+				// Mip Tailはここでアップロード要求する. 以降のストリーミング要求より必ず先にコピーされる.
+				//	Mip Tailの完了までは描画側でデフォルトテクスチャに代替される.
+				p_res->upload_ticket_ = gfx::EnqueueTextureUpload(p_res->ref_texture_, tail_source, 0, tail_mip_count);
+				p_res->streaming_id_ = streaming_system.Register(p_res);
+			}
+			// Bindless有効時はマテリアルテーブルから参照するためのインデックスを割り当てる.
+			p_res->ref_view_->RegisterBindless();
 		}
 		
 		return true;
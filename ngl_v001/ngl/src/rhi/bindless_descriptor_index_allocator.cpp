@@ -0,0 +1,219 @@
+﻿
+#include "rhi/bindless_descriptor_index_allocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+
+namespace ngl
+{
+namespace rhi
+{
+	BindlessDescriptorIndexAllocator::BindlessDescriptorIndexAllocator()
+	{
+	}
+	BindlessDescriptorIndexAllocator::~BindlessDescriptorIndexAllocator()
+	{
+		Finalize();
+	}
+
+	bool BindlessDescriptorIndexAllocator::Initialize(u32 capacity, u32 num_reserved)
+	{
+		if (capacity <= num_reserved)
+		{
+			assert(false);
+			return false;
+		}
+
+		std::scoped_lock lock(mutex_);
+		capacity_ = capacity;
+		num_reserved_ = num_reserved;
+		next_unused_ = num_reserved;
+		free_list_.clear();
+		pending_free_.clear();
+		allocated_flag_.assign(capacity, 0);
+		// 予約領域は常に確保済み扱い.
+		std::fill_n(allocated_flag_.begin(), num_reserved, u8(1));
+
+		num_allocated_ = 0;
+		peak_allocated_ = 0;
+		num_allocate_failed_ = 0;
+		return true;
+	}
+	void BindlessDescriptorIndexAllocator::Finalize()
+	{
+		std::scoped_lock lock(mutex_);
+		capacity_ = 0;
+		num_reserved_ = 0;
+		next_unused_ = 0;
+		free_list_.clear();
+		pending_free_.clear();
+		allocated_flag_.clear();
+		num_allocated_ = 0;
+	}
+
+	u32 BindlessDescriptorIndexAllocator::Allocate()
+	{
+		std::scoped_lock lock(mutex_);
+
+		u32 index = k_invalid_index;
+		if (!free_list_.empty())
+		{
+			index = free_list_.back();
+			free_list_.pop_back();
+		}
+		else if (next_unused_ < capacity_)
+		{
+			index = next_unused_++;
+		}
+		else
+		{
+			++num_allocate_failed_;
+			return k_invalid_index;
+		}
+
+		allocated_flag_[index] = 1;
+		++num_allocated_;
+		peak_allocated_ = std::max(peak_allocated_, num_allocated_);
+		return index;
+	}
+
+	void BindlessDescriptorIndexAllocator::Free(u32 index, u64 frame_index)
+	{
+		std::scoped_lock lock(mutex_);
+		if (index < num_reserved_ || index >= capacity_ || !allocated_flag_[index])
+		{
+			// 予約領域, 範囲外, 二重解放.
+			assert(false);
+			return;
+		}
+
+		allocated_flag_[index] = 0;
+		--num_allocated_;
+		// フレームインデックスは単調増加のため末尾追加で順序を保つ.
+		assert(pending_free_.empty() || pending_free_.back().frame_index <= frame_index);
+		pending_free_.push_back({ frame_index, index });
+	}
+
+	void BindlessDescriptorIndexAllocator::ReadyToNewFrame(u64 completed_frame_index)
+	{
+		std::scoped_lock lock(mutex_);
+		while (!pending_free_.empty() && pending_free_.front().frame_index <= completed_frame_index)
+		{
+			free_list_.push_back(pending_free_.front().index);
+			pending_free_.pop_front();
+		}
+	}
+
+	bool BindlessDescriptorIndexAllocator::IsAllocated(u32 index) const
+	{
+		std::scoped_lock lock(mutex_);
+		return (index < capacity_) && (0 != allocated_flag_[index]);
+	}
+
+	BindlessDescriptorIndexAllocator::Statistics BindlessDescriptorIndexAllocator::GetStatistics() const
+	{
+		std::scoped_lock lock(mutex_);
+		Statistics stat = {};
+		stat.capacity = capacity_;
+		stat.num_allocated = num_allocated_;
+		stat.num_pending_free = static_cast<u32>(pending_free_.size());
+		stat.peak_allocated = peak_allocated_;
+		stat.num_allocate_failed = num_allocate_failed_;
+		return stat;
+	}
+
+
+	void TestBindlessDescriptorIndexAllocator()
+	{
+		bool is_ok = true;
+
+		// 予約領域を除いた範囲で重複無く確保され, 解放依頼したインデックスは完了フレームまで再利用されない.
+		{
+			BindlessDescriptorIndexAllocator allocator;
+			is_ok &= allocator.Initialize(8, 2);
+
+			u32 index[6] = {};
+			for (auto& v : index)
+				v = allocator.Allocate();
+			for (u32 i = 0; i < 6; ++i)
+				is_ok &= (i + 2 == index[i]) && allocator.IsAllocated(index[i]);
+			is_ok &= allocator.IsAllocated(0) && allocator.IsAllocated(1);
+
+			// 容量超過.
+			is_ok &= (BindlessDescriptorIndexAllocator::k_invalid_index == allocator.Allocate());
+			is_ok &= (1 == allocator.GetStatistics().num_allocate_failed);
+
+			allocator.Free(index[1], 10);
+			allocator.Free(index[4], 11);
+			is_ok &= !allocator.IsAllocated(index[1]);
+			is_ok &= (2 == allocator.GetStatistics().num_pending_free);
+
+			// フレーム10未完了の間は再利用されない.
+			allocator.ReadyToNewFrame(9);
+			is_ok &= (BindlessDescriptorIndexAllocator::k_invalid_index == allocator.Allocate());
+
+			// フレーム10完了で index[1] のみ再利用可能.
+			allocator.ReadyToNewFrame(10);
+			is_ok &= (index[1] == allocator.Allocate());
+			is_ok &= (BindlessDescriptorIndexAllocator::k_invalid_index == allocator.Allocate());
+
+			allocator.ReadyToNewFrame(11);
+			is_ok &= (index[4] == allocator.Allocate());
+
+			// 他のインデックスは確保されたまま不変.
+			is_ok &= allocator.IsAllocated(index[0]) && allocator.IsAllocated(index[2]) && allocator.IsAllocated(index[3]) && allocator.IsAllocated(index[5]);
+
+			const auto stat = allocator.GetStatistics();
+			is_ok &= (6 == stat.num_allocated) && (0 == stat.num_pending_free) && (6 == stat.peak_allocated);
+		}
+
+		// 模擬フレームでの確保解放の繰り返し. 確保済みインデックスの重複が無いこと.
+		{
+			constexpr u32 k_capacity = 256;
+			constexpr u64 k_frame_latency = 2;
+			BindlessDescriptorIndexAllocator allocator;
+			allocator.Initialize(k_capacity, 1);
+
+			std::vector<u32> live;
+			std::vector<u8> owner(k_capacity, 0);
+			u32 seed = 12345;
+			for (u64 frame = 1; frame <= 200; ++frame)
+			{
+				allocator.ReadyToNewFrame((k_frame_latency <= frame) ? (frame - k_frame_latency) : 0);
+				for (u32 i = 0; i < 8; ++i)
+				{
+					seed = seed * 1664525u + 1013904223u;
+					if ((0 != ((seed >> 16) & 1)) && !live.empty())
+					{
+						const u32 pick = (seed >> 8) % static_cast<u32>(live.size());
+						owner[live[pick]] = 0;
+						allocator.Free(live[pick], frame);
+						live[pick] = live.back();
+						live.pop_back();
+					}
+					else
+					{
+						const u32 v = allocator.Allocate();
+						if (BindlessDescriptorIndexAllocator::k_invalid_index == v)
+							continue;
+						is_ok &= (0 != v) && (0 == owner[v]);
+						owner[v] = 1;
+						live.push_back(v);
+					}
+				}
+			}
+			const auto stat = allocator.GetStatistics();
+			is_ok &= (live.size() == stat.num_allocated);
+
+			std::cout << "[TestBindlessDescriptorIndexAllocator] live=" << stat.num_allocated
+				<< " pending=" << stat.num_pending_free
+				<< " peak=" << stat.peak_allocated << "/" << stat.capacity;
+		}
+
+		std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+		assert(is_ok);
+	}
+}
+}
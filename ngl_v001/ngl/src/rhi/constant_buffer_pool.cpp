@@ -165,16 +165,20 @@ namespace ngl::rhi
         }
 
         // フレーム処理. 返却アイテムのGPU参照可能性フレームの管理など.
-        void ReadyToNewFrame()
+        //  返却リストは返却されたフレームで区別し, そのフレームのGPU処理が完了したリストからPoolに戻す. Frames In Flight の数によらない.
+        void ReadyToNewFrame(u64 frame_index, u64 completed_frame_index)
         {
-            //  フレームでの返却スタックからの取り込みや, GPU参照フレーム経過アイテムのPoolへの実際の返却などをする.
-            frame_return_index_ = (frame_return_index_ + 1) % frame_return_list_.size();
-            // 新規フレームの返却リストにあるアイテムをPoolに移動.
+            // シンプルにロック.
+            std::scoped_lock<std::mutex> lock(frame_return_mutex_);
+
+            // GPU処理が完了したフレームの返却リストにあるアイテムをPoolに移動.
+            for(int i = 0; i < static_cast<int>(frame_return_list_.size()); ++i)
             {
-                // シンプルにロック.
-                std::scoped_lock<std::mutex> lock(frame_return_list_[frame_return_index_].mutex_);
-                
-                for(auto* item : frame_return_list_[frame_return_index_].list_)
+                auto& return_buffer = frame_return_list_[i];
+                if(i == frame_return_index_ || return_buffer.list_.empty() || return_buffer.frame_index_ > completed_frame_index)
+                    continue;
+
+                for(auto* item : return_buffer.list_)
                 {
                     const int bucket_index = CalcMatchBacketIndex(item->buffer.GetElementByteSize());
                     assert( 0 <= bucket_index && "バケットインデックス計算が不正.");
@@ -191,8 +195,21 @@ namespace ngl::rhi
                 }
 
                 // クリア.
-                frame_return_list_[frame_return_index_].list_.clear();
+                return_buffer.list_.clear();
+            }
+
+            // 新規フレームの返却リストを空きリストから選択.
+            for(int offset = 1; offset < static_cast<int>(frame_return_list_.size()); ++offset)
+            {
+                const int next_index = (frame_return_index_ + offset) % static_cast<int>(frame_return_list_.size());
+                if(frame_return_list_[next_index].list_.empty())
+                {
+                    frame_return_index_ = next_index;
+                    break;
+                }
             }
+            // 空きが無い場合 (GPUがリスト数以上遅れている) は現在のリストを継続利用する. 含まれるアイテムの再利用は新しいフレームの完了まで遅らせる.
+            frame_return_list_[frame_return_index_].frame_index_ = frame_index;
         }
 
         // ConstantBufferPooledHandleを生成.
@@ -230,7 +247,7 @@ namespace ngl::rhi
                 
                 {
                     // シンプルにロック.
-                    std::scoped_lock<std::mutex> lock(frame_return_list_[frame_return_index_].mutex_);
+                    std::scoped_lock<std::mutex> lock(frame_return_mutex_);
                     // Push.
                     frame_return_list_[frame_return_index_].list_.push_back(item);
                 }
@@ -244,10 +261,12 @@ namespace ngl::rhi
 
             struct ReturnBuffer
             {
-                std::mutex mutex_{};// シンプルにmutex.
                 std::vector<ConstantBufferPoolItem*> list_{};
+                u64 frame_index_ = 0;// 返却を受け付けたフレーム.
             };
-            std::array<ReturnBuffer, 3> frame_return_list_{};
+            std::mutex frame_return_mutex_{};// シンプルにmutex.
+            // Frames In Flight の最大数に対して余裕を持ったリスト数.
+            std::array<ReturnBuffer, 8> frame_return_list_{};
             int frame_return_index_ = {};
 
         private:
@@ -301,10 +320,10 @@ namespace ngl::rhi
         }
     }
     
-    void ConstantBufferPool::ReadyToNewFrame()
+    void ConstantBufferPool::ReadyToNewFrame(u64 frame_index, u64 completed_frame_index)
     {
         assert(impl_ != nullptr && "初期化時にimplが確保されていない");
-        impl_->ReadyToNewFrame();
+        impl_->ReadyToNewFrame(frame_index, completed_frame_index);
     }
 
     ConstantBufferPooledHandle ConstantBufferPool::Alloc(int byte_size)
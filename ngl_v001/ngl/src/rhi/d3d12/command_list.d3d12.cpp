@@ -6,13 +6,16 @@
 #include "rhi/d3d12/shader.d3d12.h"
 #include "rhi/d3d12/resource.d3d12.h"
 #include "rhi/d3d12/resource_view.d3d12.h"
+#include "rhi/rhi_command_stream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdio.h>
+#include <stdarg.h>
 
 #if defined(NGL_ENABLE_GPU_EVENT_MARKER)
 // PIX
 #include <pix3.h>
-
-#include <stdio.h>
-#include <stdarg.h>
 #endif
 
 namespace ngl
@@ -123,6 +126,8 @@ namespace ngl
 				return false;
 			}
 
+			descriptor_table_cache_.Initialize(DescriptorTableCache::Desc{});
+
 			// Create CommandSignature for DispatchIndirect
 			D3D12_INDIRECT_ARGUMENT_DESC dispatch_indirect_arg_desc = {};
 			dispatch_indirect_arg_desc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
@@ -151,6 +156,15 @@ namespace ngl
 			p_command_list_->Reset(p_command_allocator_.Get(), nullptr);
 			is_open_ = true;
 
+			// キャプチャ中であればコマンドを記録.
+			p_record_stream_ = parent_device_->GetCommandCapture().BeginCommandList();
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::Begin);
+
+			// 前回の記録のDescriptorテーブルとHeap設定状態は引き継がない.
+			descriptor_table_cache_.Reset();
+			InvalidateDescriptorBindingState();
+
 #if !NGL_RHI_COMMANDLIST_DESCRIPTOR_RESET_ON_END
 			// 新しいフレームのためのFrameDescriptorの準備.
 			// インデックスはDeviceから取得するグローバルなフレームインデックス.
@@ -174,6 +188,11 @@ namespace ngl
 			FlushPendingBarriers();
 
 			p_command_list_->Close();
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::End);
+
+			parent_device_->AddDescriptorTableCacheStatistics(descriptor_table_cache_.GetStatistics());
+			descriptor_table_cache_.ResetStatistics();
 
 #if NGL_RHI_COMMANDLIST_DESCRIPTOR_RESET_ON_END
 			// 新しいフレームのためのFrameDescriptorの準備.
@@ -188,6 +207,8 @@ namespace ngl
 		{
 			FlushPendingBarriers();
 			p_command_list_->Dispatch(x, y, z);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::Dispatch, {}, std::array<u32, 3>{ x, y, z });
 		}
 		void CommandListBaseDep::DispatchIndirect(BufferDep* p_arg_buffer)
 		{
@@ -208,6 +229,8 @@ namespace ngl
 				nullptr,                // CountBuffer (not used)
 				0                       // CountBufferOffset
 			);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::DispatchIndirect, { p_arg_buffer });
 		}
 
 #if defined(__ID3D12GraphicsCommandList4_INTERFACE_DEFINED__)
@@ -220,6 +243,21 @@ namespace ngl
 				return;
 			FlushPendingBarriers();
 			p_command_list4_->BuildRaytracingAccelerationStructure(p_desc, num_postbuild_info_descs, p_postbuild_info_descs);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::BuildAccelerationStructure, {}, std::array<u32, 3>{ static_cast<u32>(p_desc->Inputs.Type), static_cast<u32>(p_desc->Inputs.Flags), p_desc->Inputs.NumDescs });
+		}
+
+		void CommandListBaseDep::CopyRaytracingAccelerationStructure(
+			D3D12_GPU_VIRTUAL_ADDRESS dst,
+			D3D12_GPU_VIRTUAL_ADDRESS src,
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE mode)
+		{
+			if (0 == dst || 0 == src)
+				return;
+			FlushPendingBarriers();
+			p_command_list4_->CopyRaytracingAccelerationStructure(dst, src, mode);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::CopyAccelerationStructure, {}, static_cast<u32>(mode));
 		}
 
 		void CommandListBaseDep::DispatchRays(const D3D12_DISPATCH_RAYS_DESC* p_desc)
@@ -228,6 +266,8 @@ namespace ngl
 				return;
 			FlushPendingBarriers();
 			p_command_list4_->DispatchRays(p_desc);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::DispatchRays, {}, std::array<u32, 3>{ p_desc->Width, p_desc->Height, p_desc->Depth });
 		}
 #endif // __ID3D12GraphicsCommandList4_INTERFACE_DEFINED__
 
@@ -237,6 +277,19 @@ namespace ngl
 				return;
 			FlushPendingBarriers();
 			p_command_list_->CopyResource(p_dst->GetD3D12Resource(), p_src->GetD3D12Resource());
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::CopyResource, { p_dst, p_src });
+		}
+
+		// Buffer の指定範囲を別の Buffer へコピー.
+		void CommandListBaseDep::CopyBufferRegion(const BufferDep* p_dst, u64 dst_offset, const BufferDep* p_src, u64 src_offset, u64 byte_size)
+		{
+			if (!p_dst || !p_src || 0 == byte_size)
+				return;
+			FlushPendingBarriers();
+			p_command_list_->CopyBufferRegion(p_dst->GetD3D12Resource(), dst_offset, p_src->GetD3D12Resource(), src_offset, byte_size);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::CopyBufferRegion, { p_dst, p_src }, std::array<u64, 3>{ dst_offset, src_offset, byte_size });
 		}
 
 		// Upload Buffer のサブリソースデータを Texture の指定サブリソースへコピー.
@@ -264,6 +317,60 @@ namespace ngl
 				copy_dst.SubresourceIndex = dst_subresource;
 			}
 			p_command_list_->CopyTextureRegion(&copy_dst, 0, 0, 0, &copy_src, nullptr);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::CopyTextureRegion, { p_dst, p_src_buffer }, std::array<u32, 4>{ static_cast<u32>(dst_subresource), src_layout.width, src_layout.height, src_layout.depth });
+		}
+		void CommandListBaseDep::CopyTextureToBufferRegion(const BufferDep* p_dst_buffer, const TextureSubresourceLayoutInfo& dst_layout, const TextureDep* p_src, int src_subresource)
+		{
+			if (!p_dst_buffer || !p_src)
+				return;
+			FlushPendingBarriers();
+
+			D3D12_TEXTURE_COPY_LOCATION copy_dst = {};
+			{
+				copy_dst.pResource                          = p_dst_buffer->GetD3D12Resource();
+				copy_dst.Type                               = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+				copy_dst.PlacedFootprint.Offset             = dst_layout.byte_offset;
+				copy_dst.PlacedFootprint.Footprint.Format   = ConvertResourceFormat(dst_layout.format);
+				copy_dst.PlacedFootprint.Footprint.Width    = dst_layout.width;
+				copy_dst.PlacedFootprint.Footprint.Height   = dst_layout.height;
+				copy_dst.PlacedFootprint.Footprint.Depth    = dst_layout.depth;
+				copy_dst.PlacedFootprint.Footprint.RowPitch = dst_layout.row_pitch;
+			}
+			D3D12_TEXTURE_COPY_LOCATION copy_src = {};
+			{
+				copy_src.pResource        = p_src->GetD3D12Resource();
+				copy_src.Type             = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				copy_src.SubresourceIndex = src_subresource;
+			}
+			p_command_list_->CopyTextureRegion(&copy_dst, 0, 0, 0, &copy_src, nullptr);
+			// 記録上は CopyTextureRegion として扱う. 参照オブジェクトはコピー先, コピー元の順.
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::CopyTextureRegion, { p_dst_buffer, p_src }, std::array<u32, 4>{ static_cast<u32>(src_subresource), dst_layout.width, dst_layout.height, dst_layout.depth });
+		}
+
+		void CommandListBaseDep::CopyTextureSubresource(const TextureDep* p_dst, int dst_subresource, const TextureDep* p_src, int src_subresource)
+		{
+			if (!p_dst || !p_src)
+				return;
+			FlushPendingBarriers();
+
+			D3D12_TEXTURE_COPY_LOCATION copy_dst = {};
+			{
+				copy_dst.pResource        = p_dst->GetD3D12Resource();
+				copy_dst.Type             = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				copy_dst.SubresourceIndex = dst_subresource;
+			}
+			D3D12_TEXTURE_COPY_LOCATION copy_src = {};
+			{
+				copy_src.pResource        = p_src->GetD3D12Resource();
+				copy_src.Type             = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				copy_src.SubresourceIndex = src_subresource;
+			}
+			p_command_list_->CopyTextureRegion(&copy_dst, 0, 0, 0, &copy_src, nullptr);
+			// 記録上は CopyTextureRegion として扱う. 参照オブジェクトはコピー先, コピー元の順.
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::CopyTextureRegion, { p_dst, p_src }, std::array<u32, 4>{ static_cast<u32>(dst_subresource), static_cast<u32>(src_subresource), 0, 0 });
 		}
 
 		// UAV Barrier.
@@ -461,6 +568,8 @@ namespace ngl
 		// UAV同期Barrier.
 		void CommandListBaseDep::ResourceUavBarrier(TextureDep* p_texture)
 		{
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::UavBarrier, { p_texture });
 #if defined(__ID3D12GraphicsCommandList7_INTERFACE_DEFINED__)
 			if (p_command_list7_ && parent_device_->IsEnhancedBarrierSupported())
 			{
@@ -486,6 +595,8 @@ namespace ngl
 		// UAV同期Barrier.
 		void CommandListBaseDep::ResourceUavBarrier(BufferDep* p_buffer)
 		{
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::UavBarrier, { p_buffer });
 #if defined(__ID3D12GraphicsCommandList7_INTERFACE_DEFINED__)
 			if (p_command_list7_ && parent_device_->IsEnhancedBarrierSupported())
 			{
@@ -550,136 +661,321 @@ namespace ngl
 		{
 			p_command_list_->SetPipelineState(pso->GetD3D12PipelineState());
 			p_command_list_->SetComputeRootSignature(pso->GetD3D12RootSignature());
+			InvalidateRootDescriptorTableState(true);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::SetComputePipelineState, { pso });
 		}
 		void CommandListBaseDep::SetDescriptorSet(const ComputePipelineStateDep* p_pso, const DescriptorSetDep* p_desc_set)
 		{
 			assert(p_pso);
 			assert(p_desc_set);
+			// DescriptorSetは一時オブジェクトの場合が多いため参照はPSOのみ記録.
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::SetComputeDescriptorSet, { p_pso });
 
-			// cbv, srv, uav用デフォルトDescriptor取得.
-			const auto def_descriptor = parent_device_->GetPersistentDescriptorAllocator()->GetDefaultPersistentDescriptor();
 			const auto& resource_table = p_pso->GetPipelineResourceViewLayout()->GetResourceTable();
 
-			const auto& cs_sampler_desc_set_handle_array = p_desc_set->GetCsSampler();
-			const auto cs_sampler_table = resource_table.cs_sampler_table;
-			// Sampler用のFrameDescriptorHeapに必要な数. 設定された最大のレジスタ番号+1を個数とする.
-			const auto total_samp_count = cs_sampler_desc_set_handle_array.max_use_register_index + 1;
+			// Samplerのコミット. DescriptorHeapの設定もここで実行される.
+			{
+				const DescriptorTableRequest sampler_request =
+				{
+					static_cast<u32>(p_desc_set->GetCsSampler().max_use_register_index + 1), p_desc_set->GetCsSampler().cpu_handles, resource_table.cs_sampler_table
+				};
+				CommitSamplerDescriptorTable(true, &sampler_request, 1);
+			}
+
+			// CBV, SRV, UAVのコミット.
+			// 各ステージ毎各リソースタイプ毎に0番から設定された最大レジスタ番号までの範囲でFrameDescriptorから確保してコピー,CommandListへ設定する.
+			CommitViewDescriptorTable(true, { static_cast<u32>(p_desc_set->GetCsCbv().max_use_register_index + 1), p_desc_set->GetCsCbv().cpu_handles, resource_table.cs_cbv_table });
+			CommitViewDescriptorTable(true, { static_cast<u32>(p_desc_set->GetCsSrv().max_use_register_index + 1), p_desc_set->GetCsSrv().cpu_handles, resource_table.cs_srv_table });
+			CommitViewDescriptorTable(true, { static_cast<u32>(p_desc_set->GetCsUav().max_use_register_index + 1), p_desc_set->GetCsUav().cpu_handles, resource_table.cs_uav_table });
+
+			CommitBindlessDescriptorTable(true, resource_table.bindless_srv_table);
+		}
+		void CommandListBaseDep::SetRootConstant(const ComputePipelineStateDep* p_pso, const void* p_data, u32 byte_size)
+		{
+			assert(p_pso);
+			const auto& resource_table = p_pso->GetPipelineResourceViewLayout()->GetResourceTable();
+			SetRootConstantImpl(true, p_pso, resource_table.root_constant_param, resource_table.root_constant_count, p_data, byte_size);
+		}
+
+		// DescriptorTableCacheのキーとしてCPUハンドル列をそのままu64列として扱う.
+		static_assert(sizeof(D3D12_CPU_DESCRIPTOR_HANDLE) == sizeof(u64));
+
+		void CommandListBaseDep::CommitSamplerDescriptorTable(bool is_compute, const DescriptorTableRequest* p_request, u32 num_request)
+		{
+			constexpr u32 k_max_request = 8;
+			assert(num_request <= k_max_request);
+			const auto heap_type = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
+
+			#if NGL_DEBUG_DESCRIPTOR_SET_OPTIMIZATION
+				// 事前に歯抜けにデフォルトのDescriptorを埋めておく場合は一時バッファ不要.
+			#else
+				// cbv, srv, uav用デフォルトDescriptor取得.
+				const auto def_descriptor = parent_device_->GetPersistentDescriptorAllocator()->GetDefaultPersistentDescriptor();
+				D3D12_CPU_DESCRIPTOR_HANDLE tmp[k_max_request][k_sampler_table_size];
+			#endif
+
+			const D3D12_CPU_DESCRIPTOR_HANDLE* src_handle_buffer[k_max_request] = {};
+			u64 hash[k_max_request] = {};
+			D3D12_GPU_DESCRIPTOR_HANDLE table_gpu_handle[k_max_request] = {};
+			bool is_cached[k_max_request] = {};
+
+			// キャッシュ検索. ヒットしなかったテーブルの総数をFrameDescriptorから確保する.
+			ID3D12DescriptorHeap* p_sampler_heap = frame_desc_page_interface_for_sampler_.GetD3D12DescriptorHeap();
+			u32 total_count = 0;
+			u32 miss_count = 0;
+			for (u32 i = 0; i < num_request; ++i)
+			{
+				const auto& req = p_request[i];
+				if (0 > req.table_index || 0 >= req.count)
+					continue;
+
+				#if NGL_DEBUG_DESCRIPTOR_SET_OPTIMIZATION
+					// 最適化案.
+					//	DescriptorSetへの設定時点でそのバッファの歯抜け部にデフォルトDescriptorを詰めておくことで, ここでの一時バッファへのコピーを省略する.
+					src_handle_buffer[i] = req.p_src_handle;
+				#else
+					// Copy時に無効なDescriptorがあるとエラーになるため, 無効要素にはダミーのDesctirptorを詰めたバッファを作る.
+					for (u32 j = 0; j < req.count; j++)
+					{
+						tmp[i][j] = (req.p_src_handle[j].ptr > 0) ? req.p_src_handle[j] : def_descriptor.cpu_handle;
+					}
+					src_handle_buffer[i] = tmp[i];
+				#endif
+
+				const u64* p_key = reinterpret_cast<const u64*>(src_handle_buffer[i]);
+				hash[i] = DescriptorTableCache::ComputeHash(heap_type, p_key, req.count);
+				DescriptorTableCache::Range range = {};
+				if (descriptor_table_cache_.Find(heap_type, p_key, req.count, hash[i], reinterpret_cast<u64>(p_sampler_heap), range))
+				{
+					is_cached[i] = true;
+					table_gpu_handle[i].ptr = range.gpu_handle;
+				}
+				else
+				{
+					miss_count += req.count;
+				}
+				total_count += req.count;
+			}
 
 			// Sampler用のFrameDescriptor確保. ここでPageが足りなければ新規Pageが確保されてHeapが切り替わるので, SetDescriptorHeaps() の前に実行する必要がある.
-			const auto sampler_desc_heap_type = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
-			D3D12_CPU_DESCRIPTOR_HANDLE cpu_sampler_handle_start;
-			D3D12_GPU_DESCRIPTOR_HANDLE gpu_sampler_handle_start;
-			// Heap確保. 現在のPageで必要分確保できなければ新規Page(Heap)に自動で切り替わる.
-			frame_desc_page_interface_for_sampler_.Allocate(total_samp_count, cpu_sampler_handle_start, gpu_sampler_handle_start);
-			const u64 sampler_handle_increment_size = frame_desc_page_interface_for_sampler_.GetPool()->GetHandleIncrementSize(sampler_desc_heap_type);
+			D3D12_CPU_DESCRIPTOR_HANDLE cpu_sampler_handle_start = {};
+			D3D12_GPU_DESCRIPTOR_HANDLE gpu_sampler_handle_start = {};
+			// 全てヒットした場合も, Pageが未確保であればHeap設定のために確保する.
+			if (0 < miss_count || nullptr == p_sampler_heap)
+			{
+				// Heap確保. 現在のPageで必要分確保できなければ新規Page(Heap)に自動で切り替わる.
+				frame_desc_page_interface_for_sampler_.Allocate(miss_count, cpu_sampler_handle_start, gpu_sampler_handle_start);
+				if (p_sampler_heap != frame_desc_page_interface_for_sampler_.GetD3D12DescriptorHeap())
+				{
+					// Pageが切り替わった場合はキャッシュ済みの範囲は旧Heap上にあり使えないため, 全テーブルを新Pageへコピーし直す.
+					descriptor_table_cache_.Reset();
+					if (miss_count < total_count)
+					{
+						frame_desc_page_interface_for_sampler_.Allocate(total_count, cpu_sampler_handle_start, gpu_sampler_handle_start);
+						for (u32 i = 0; i < num_request; ++i)
+							is_cached[i] = false;
+					}
+				}
+			}
+			const u64 sampler_handle_increment_size = frame_desc_page_interface_for_sampler_.GetPool()->GetHandleIncrementSize(heap_type);
 
 			// DescriptorHeapの設定.
 			// Cbv Srv Uav用とSampler用.
 			// これ以前にFrameDescriptorから確保して必要ならばHeap切り替えが完了した後にCommandListにHeapを設定する.
 			// CommandListにHeapを設定した後にそのHeap上のDescriptorをDescriptorTableに設定する必要がある(設定されているHeapと異なるHeap上のDescriptorをセットするとD3Dエラーとなる.)
 			// CbvSrvUavのHeapは巨大な単一Heap上で確保するためアプリケーション実行中に変化しないのでSamplerとは異なりいつ設定しても良い.
+			// 設定済みのHeapと同一であれば省略する. Heapを変更した場合は設定済みのRootDescriptorTableも無効とする.
 			ID3D12DescriptorHeap* heaps[] =
 			{
 				frame_desc_interface_.GetManager()->GetD3D12DescriptorHeap(),
 				frame_desc_page_interface_for_sampler_.GetD3D12DescriptorHeap()
 			};
-			p_command_list_->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
-
+			if (heaps[0] != bound_descriptor_heap_[0] || heaps[1] != bound_descriptor_heap_[1])
+			{
+				p_command_list_->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
+				bound_descriptor_heap_[0] = heaps[0];
+				bound_descriptor_heap_[1] = heaps[1];
+				InvalidateRootDescriptorTableState(false);
+				InvalidateRootDescriptorTableState(true);
+			}
 
-			// Samplerのコミット.
+			for (u32 i = 0; i < num_request; ++i)
 			{
-				// 各ステージのSamplerを設定.
-				#if NGL_DEBUG_DESCRIPTOR_SET_OPTIMIZATION
-					// 事前に歯抜けにデフォルトのDescriptorを埋めておく場合は一時バッファ不要.
-				#else
-					D3D12_CPU_DESCRIPTOR_HANDLE tmp[k_sampler_table_size];
-				#endif
-				auto SetSamplerDescriptor = [&](
-					D3D12_DESCRIPTOR_HEAP_TYPE heap_type,
-					D3D12_CPU_DESCRIPTOR_HANDLE dst_cpu_handle_start,
-					D3D12_GPU_DESCRIPTOR_HANDLE dst_gpu_handle_start,
-					u32 src_count, const D3D12_CPU_DESCRIPTOR_HANDLE* src_handle,
-					u8 table_index)
+				const auto& req = p_request[i];
+				if (0 > req.table_index || 0 >= req.count)
+					continue;
+
+				if (!is_cached[i])
 				{
-					if (0 > table_index || 0 >= src_count)
-						return;
-
-					#if NGL_DEBUG_DESCRIPTOR_SET_OPTIMIZATION
-						// 最適化案.
-						//	DescriptorSetへの設定時点でそのバッファの歯抜け部にデフォルトDescriptorを詰めておくことで, ここでの一時バッファへのコピーを省略する.
-						const D3D12_CPU_DESCRIPTOR_HANDLE* src_handle_buffer = src_handle;
-					#else
-						// Copy時に無効なDescriptorがあるとエラーになるため, 無効要素にはダミーのDesctirptorを詰めたバッファを作る.
-						//	DescriptorSetDep側で歯抜けの部分にダミーDescriptorを詰めて置くことでそのままコピーできるはずなので, 高速化のため検討.
-						for (u32 i = 0; i < src_count; i++)
-						{
-							tmp[i] = (src_handle[i].ptr > 0) ? src_handle[i] : def_descriptor.cpu_handle;
-						}
-						const D3D12_CPU_DESCRIPTOR_HANDLE* src_handle_buffer = tmp;
-					#endif
-
-					// FrameDescriptorHeapから連続したDescriptorを確保してコピー,CommandListへセットする.
+					// 指定のFrameDescriptor開始位置から始まる範囲にDescriptorをコピー.
+					u32 copy_count = req.count;
 					parent_device_->GetD3D12Device()->CopyDescriptors(
-						1, &dst_cpu_handle_start, &src_count,
-						src_count, src_handle_buffer, nullptr,
+						1, &cpu_sampler_handle_start, &copy_count,
+						copy_count, src_handle_buffer[i], nullptr,
 						heap_type);
-					p_command_list_->SetComputeRootDescriptorTable(table_index, dst_gpu_handle_start);
-				};
 
-				// 指定のFrameDescriptor開始位置から始まる範囲にDescriptorをコピーしてCommandListに設定.
-				SetSamplerDescriptor(sampler_desc_heap_type, cpu_sampler_handle_start, gpu_sampler_handle_start, total_samp_count, cs_sampler_desc_set_handle_array.cpu_handles, cs_sampler_table);
+					DescriptorTableCache::Range range = {};
+					range.cpu_handle = cpu_sampler_handle_start.ptr;
+					range.gpu_handle = gpu_sampler_handle_start.ptr;
+					range.heap_id = reinterpret_cast<u64>(heaps[1]);
+					descriptor_table_cache_.Insert(heap_type, reinterpret_cast<const u64*>(src_handle_buffer[i]), req.count, hash[i], range);
+					table_gpu_handle[i] = gpu_sampler_handle_start;
+
+					// FrameDescriptor上のポインタを進行.
+					const auto offset_size = sampler_handle_increment_size * static_cast<u64>(req.count);
+					cpu_sampler_handle_start.ptr += offset_size;
+					gpu_sampler_handle_start.ptr += offset_size;
+				}
+
+				if (p_record_stream_)
+				{
+					RhiCommandSetDescriptorTableParam param = {};
+					param.root_parameter_index = static_cast<u32>(req.table_index);
+					param.heap_type = static_cast<u8>(heap_type);
+					param.is_compute = is_compute ? 1 : 0;
+					p_record_stream_->Write(ERhiCommandOp::SetDescriptorTable, reinterpret_cast<const void* const*>(src_handle_buffer[i]), req.count, &param, sizeof(param));
+				}
+				SetRootDescriptorTable(is_compute, req.table_index, table_gpu_handle[i]);
 			}
+		}
 
-			// CBV, SRV, UAVのコミット.
+		void CommandListBaseDep::CommitViewDescriptorTable(bool is_compute, const DescriptorTableRequest& request)
+		{
+			if (0 > request.table_index || 0 >= request.count)
+				return;
+
+			const auto heap_type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+			u32 count = request.count;
+
+			#if NGL_DEBUG_DESCRIPTOR_SET_OPTIMIZATION
+				// 最適化案.
+				//	DescriptorSetへの設定時点でそのバッファの歯抜け部にデフォルトDescriptorを詰めておくことで, ここでの一時バッファへのコピーを省略する.
+				const D3D12_CPU_DESCRIPTOR_HANDLE* src_handle_buffer = request.p_src_handle;
+			#else
+				// Copy時に無効なDescriptorがあるとエラーになるため, 無効要素にはダミーのDesctirptorを詰めたバッファを作る.
+				const auto def_descriptor = parent_device_->GetPersistentDescriptorAllocator()->GetDefaultPersistentDescriptor();
+				D3D12_CPU_DESCRIPTOR_HANDLE tmp[k_srv_table_size];// cbv, srv, uav のテーブルサイズで最大の k_srv_table_size でワーク確保.
+				for (u32 i = 0; i < count; i++)
+				{
+					tmp[i] = (request.p_src_handle[i].ptr > 0) ? request.p_src_handle[i] : def_descriptor.cpu_handle;
+				}
+				const D3D12_CPU_DESCRIPTOR_HANDLE* src_handle_buffer = tmp;
+			#endif
+
+			if (p_record_stream_)
 			{
-				const auto cvbsrvuav_desc_heap_type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+				RhiCommandSetDescriptorTableParam param = {};
+				param.root_parameter_index = static_cast<u32>(request.table_index);
+				param.heap_type = static_cast<u8>(heap_type);
+				param.is_compute = is_compute ? 1 : 0;
+				p_record_stream_->Write(ERhiCommandOp::SetDescriptorTable, reinterpret_cast<const void* const*>(src_handle_buffer), count, &param, sizeof(param));
+			}
 
-				#if NGL_DEBUG_DESCRIPTOR_SET_OPTIMIZATION
-					// 事前に歯抜けにデフォルトのDescriptorを埋めておく場合は一時バッファ不要.
-				#else
-					D3D12_CPU_DESCRIPTOR_HANDLE tmp[k_srv_table_size];// cbv, srv, uav のテーブルサイズで最大の k_srv_table_size でワーク確保して再利用.
-				#endif
-				auto SetViewDescriptor = [&](u32 count, const D3D12_CPU_DESCRIPTOR_HANDLE* handles, u8 table_index)
+			// 同一内容のテーブルがこのCommandList内で既にコピー済みであれば再利用する.
+			// CbvSrvUavのHeapは単一のため範囲はEndまで有効.
+			ID3D12DescriptorHeap* p_heap = frame_desc_interface_.GetManager()->GetD3D12DescriptorHeap();
+			const u64* p_key = reinterpret_cast<const u64*>(src_handle_buffer);
+			const u64 hash = DescriptorTableCache::ComputeHash(heap_type, p_key, count);
+			DescriptorTableCache::Range range = {};
+			if (descriptor_table_cache_.Find(heap_type, p_key, count, hash, reinterpret_cast<u64>(p_heap), range))
+			{
+				SetRootDescriptorTable(is_compute, request.table_index, D3D12_GPU_DESCRIPTOR_HANDLE{ range.gpu_handle });
+				return;
+			}
+
+			D3D12_CPU_DESCRIPTOR_HANDLE dst_cpu;
+			D3D12_GPU_DESCRIPTOR_HANDLE dst_gpu;
+			frame_desc_interface_.Allocate(count, dst_cpu, dst_gpu);
+
+			// FrameDescriptorHeapから連続したDescriptorを確保してコピー,CommandListへセットする.
+			parent_device_->GetD3D12Device()->CopyDescriptors(
+				1, &dst_cpu, &count,
+				count, src_handle_buffer, nullptr,
+				heap_type);
+
+			range.cpu_handle = dst_cpu.ptr;
+			range.gpu_handle = dst_gpu.ptr;
+			range.heap_id = reinterpret_cast<u64>(p_heap);
+			descriptor_table_cache_.Insert(heap_type, p_key, count, hash, range);
+
+			SetRootDescriptorTable(is_compute, request.table_index, dst_gpu);
+		}
+
+		void CommandListBaseDep::CommitBindlessDescriptorTable(bool is_compute, int table_index)
+		{
+			if (0 > table_index)
+				return;
+			// RootSignature生成時にBindless有効であることは確認済み. Heapは CbvSrvUav のFrameDescriptorと同一.
+			assert(parent_device_->IsBindlessEnabled());
+			SetRootDescriptorTable(is_compute, table_index, parent_device_->GetBindlessDescriptorTableGpuHandle());
+		}
+
+		void CommandListBaseDep::SetRootConstantImpl(bool is_compute, const void* p_pso, int param_index, u32 num_constant, const void* p_data, u32 byte_size)
+		{
+			if (0 > param_index || 0 >= num_constant)
+				return;
+
+			u32 constant[k_max_root_constant_count] = {};
+			assert(num_constant <= k_max_root_constant_count);
+			std::memcpy(constant, p_data, std::min<u32>(byte_size, num_constant * sizeof(u32)));
+
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::SetRootConstant, &p_pso, 1, constant, num_constant * sizeof(u32));
+
+			if (is_compute)
+				p_command_list_->SetComputeRoot32BitConstants(param_index, num_constant, constant, 0);
+			else
+				p_command_list_->SetGraphicsRoot32BitConstants(param_index, num_constant, constant, 0);
+		}
+
+		void CommandListBaseDep::SetRootDescriptorTable(bool is_compute, int table_index, D3D12_GPU_DESCRIPTOR_HANDLE handle)
+		{
+			const bool is_tracked = (0 <= table_index) && (static_cast<u32>(table_index) < k_max_tracked_root_table);
+			if (is_tracked)
+			{
+				u64& bound = bound_root_table_[is_compute ? 1 : 0][table_index];
+				if (bound == handle.ptr)
 				{
-					if (0 > table_index || 0 >= count)
-						return;
-
-					#if NGL_DEBUG_DESCRIPTOR_SET_OPTIMIZATION
-						// 最適化案.
-						//	DescriptorSetへの設定時点でそのバッファの歯抜け部にデフォルトDescriptorを詰めておくことで, ここでの一時バッファへのコピーを省略する.
-						const D3D12_CPU_DESCRIPTOR_HANDLE* src_handle_buffer = handles;
-					#else
-						// Copy時に無効なDescriptorがあるとエラーになるため, 無効要素にはダミーのDesctirptorを詰めたバッファを作る.
-						//	DescriptorSetDep側で歯抜けの部分にダミーDescriptorを詰めて置くことでそのままコピーできるはずなので, 高速化のため検討.
-						for (u32 i = 0; i < count; i++)
-						{
-							tmp[i] = (handles[i].ptr > 0) ? handles[i] : def_descriptor.cpu_handle;
-						}
-						const D3D12_CPU_DESCRIPTOR_HANDLE* src_handle_buffer = tmp;
-					#endif
-
-					D3D12_CPU_DESCRIPTOR_HANDLE dst_cpu;
-					D3D12_GPU_DESCRIPTOR_HANDLE dst_gpu;
-					frame_desc_interface_.Allocate(count, dst_cpu, dst_gpu);
-
-					// FrameDescriptorHeapから連続したDescriptorを確保してコピー,CommandListへセットする.
-					parent_device_->GetD3D12Device()->CopyDescriptors(
-						1, &dst_cpu, &count,
-						count, src_handle_buffer, nullptr,
-						cvbsrvuav_desc_heap_type);
-					p_command_list_->SetComputeRootDescriptorTable(table_index, dst_gpu);
-				};
-				// 各ステージの各リソースタイプ別に連続Descriptorを確保,コピーしてテーブルにをセットしていく
-				// 各ステージ毎各リソースタイプ毎に0番から設定された最大レジスタ番号までの範囲でFrameDescriptorから確保してコピー,CommandListへ設定する.
-				SetViewDescriptor(p_desc_set->GetCsCbv().max_use_register_index + 1, p_desc_set->GetCsCbv().cpu_handles, resource_table.cs_cbv_table);
-				SetViewDescriptor(p_desc_set->GetCsSrv().max_use_register_index + 1, p_desc_set->GetCsSrv().cpu_handles, resource_table.cs_srv_table);
-				SetViewDescriptor(p_desc_set->GetCsUav().max_use_register_index + 1, p_desc_set->GetCsUav().cpu_handles, resource_table.cs_uav_table);
+					descriptor_table_cache_.CountSkippedRootSet();
+					return;
+				}
+				bound = handle.ptr;
 			}
+
+			if (is_compute)
+				p_command_list_->SetComputeRootDescriptorTable(table_index, handle);
+			else
+				p_command_list_->SetGraphicsRootDescriptorTable(table_index, handle);
+		}
+
+		void CommandListBaseDep::InvalidateRootDescriptorTableState(bool is_compute)
+		{
+			auto& bound = bound_root_table_[is_compute ? 1 : 0];
+			std::fill(std::begin(bound), std::end(bound), 0);
+		}
+
+		void CommandListBaseDep::InvalidateDescriptorBindingState()
+		{
+			bound_descriptor_heap_[0] = nullptr;
+			bound_descriptor_heap_[1] = nullptr;
+			InvalidateRootDescriptorTableState(false);
+			InvalidateRootDescriptorTableState(true);
 		}
 
 		
 		void CommandListBaseDep::BeginMarker(const char* format, ...)
 		{
+			if (p_record_stream_)
+			{
+				char record_buf[256];
+				va_list record_args;
+				va_start(record_args, format);
+				vsnprintf(record_buf, sizeof(record_buf), format, record_args);
+				va_end(record_args);
+				p_record_stream_->WriteString(ERhiCommandOp::BeginMarker, record_buf);
+			}
 #if defined(NGL_ENABLE_GPU_EVENT_MARKER)
 			// ここで全て展開.
 			char buf[256];
@@ -694,6 +990,8 @@ namespace ngl
 		}
 		void CommandListBaseDep::EndMarker()
 		{
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::EndMarker);
 #if defined(NGL_ENABLE_GPU_EVENT_MARKER)
 			PIXEndEvent(GetD3D12GraphicsCommandList());
 #endif
@@ -721,6 +1019,24 @@ namespace ngl
 			
 		}
 		
+		bool CopyCommandListDep::Initialize(DeviceDep* p_device)
+		{
+			CommandListBaseDep::Desc base_desc = {};
+			{
+				base_desc.type = D3D12_COMMAND_LIST_TYPE_COPY;
+			}
+			return CommandListBaseDep::Initialize(p_device, base_desc);
+		}
+		
+		bool DirectComputeCommandListDep::Initialize(DeviceDep* p_device)
+		{
+			CommandListBaseDep::Desc base_desc = {};
+			{
+				base_desc.type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+			}
+			return CommandListBaseDep::Initialize(p_device, base_desc);
+		}
+		
 		// -------------------------------------------------------------------------------------------------------------------------------------------------
 		GraphicsCommandListDep::GraphicsCommandListDep()
 		{
@@ -772,12 +1088,24 @@ namespace ngl
 			D3D12_CPU_DESCRIPTOR_HANDLE dsv_handle = (p_dsv) ? p_dsv->GetD3D12DescriptorHandle() : D3D12_CPU_DESCRIPTOR_HANDLE();
 			const D3D12_CPU_DESCRIPTOR_HANDLE* p_dsv_handle = (p_dsv) ? &dsv_handle : nullptr;
 			GetD3D12GraphicsCommandList()->OMSetRenderTargets(num_rtv, rtvs, false, p_dsv_handle);
+			if (p_record_stream_)
+			{
+				// RTV x8 と DSV.
+				const void* record_object[9] = {};
+				for (auto i = 0; i < num_rtv && i < 8; ++i)
+					record_object[i] = pp_rtv[i];
+				record_object[8] = p_dsv;
+				const u32 record_num_rtv = static_cast<u32>(num_rtv);
+				p_record_stream_->Write(ERhiCommandOp::SetRenderTargets, record_object, static_cast<u32>(std::size(record_object)), &record_num_rtv, sizeof(record_num_rtv));
+			}
 		};
 		void GraphicsCommandListDep::ClearRenderTarget(const RenderTargetViewDep* p_rtv, const float(color)[4])
 		{
 			FlushPendingBarriers();
 			auto rtv = p_rtv->GetD3D12DescriptorHandle();
 			p_command_list_->ClearRenderTargetView(rtv, color, 0u, nullptr);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::ClearRenderTarget, { p_rtv }, std::array<float, 4>{ color[0], color[1], color[2], color[3] });
 		}
 		void GraphicsCommandListDep::ClearDepthTarget(const DepthStencilViewDep* p_dsv, float depth, uint8_t stencil, bool clearDepth, bool clearStencil)
 		{
@@ -786,6 +1114,16 @@ namespace ngl
 			flags |= clearStencil ? D3D12_CLEAR_FLAG_STENCIL : 0;
 
 			GetD3D12GraphicsCommandList()->ClearDepthStencilView(p_dsv->GetD3D12DescriptorHandle(), D3D12_CLEAR_FLAGS(flags), depth, stencil, 0, nullptr);
+			if (p_record_stream_)
+			{
+				struct RecordParam
+				{
+					float	depth;
+					u32		stencil;
+					u32		flags;
+				};
+				p_record_stream_->Write(ERhiCommandOp::ClearDepthTarget, { p_dsv }, RecordParam{ depth, stencil, flags });
+			}
 		};
 
 		// State Transition Barrier関連共通部.
@@ -812,6 +1150,8 @@ namespace ngl
 			if (!p_swapchain || prev == next)
 				return;
 			auto* resource = p_swapchain->GetD3D12Resource(buffer_index);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::ResourceBarrier, { p_swapchain }, std::array<u32, 3>{ buffer_index, static_cast<u32>(prev), static_cast<u32>(next) });
 			// Swapchain は Texture として扱う.
 #if defined(__ID3D12GraphicsCommandList7_INTERFACE_DEFINED__)
 			// SwapchainバッファはPresent後にCommon状態が保証されるため常にEnhancedを使用可.
@@ -842,6 +1182,8 @@ namespace ngl
 			if (!p_texture || prev == next)
 				return;
 			auto* resource = p_texture->GetD3D12Resource();
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::ResourceBarrier, { p_texture }, std::array<u32, 3>{ 0u, static_cast<u32>(prev), static_cast<u32>(next) });
 #if defined(__ID3D12GraphicsCommandList7_INTERFACE_DEFINED__)
 			if (p_command_list7_ && parent_device_->IsEnhancedBarrierSupported())
 			{
@@ -870,6 +1212,8 @@ namespace ngl
 			if (!p_buffer || prev == next)
 				return;
 			auto* resource = p_buffer->GetD3D12Resource();
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::ResourceBarrier, { p_buffer }, std::array<u32, 3>{ 0u, static_cast<u32>(prev), static_cast<u32>(next) });
 #if defined(__ID3D12GraphicsCommandList7_INTERFACE_DEFINED__)
 			if (p_command_list7_ && parent_device_->IsEnhancedBarrierSupported())
 			{
@@ -898,35 +1242,50 @@ namespace ngl
 			assert(p_viewports);
 			assert(num);
 			p_command_list_->RSSetViewports( num, p_viewports );
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::SetViewports, {}, std::array<float, 7>{ static_cast<float>(num), p_viewports[0].TopLeftX, p_viewports[0].TopLeftY, p_viewports[0].Width, p_viewports[0].Height, p_viewports[0].MinDepth, p_viewports[0].MaxDepth });
 		}
 		void GraphicsCommandListDep::SetScissor(u32 num, const  D3D12_RECT* p_rects)
 		{
 			assert(p_rects);
 			assert(num);
 			p_command_list_->RSSetScissorRects(num, p_rects);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::SetScissor, {}, std::array<s32, 5>{ static_cast<s32>(num), static_cast<s32>(p_rects[0].left), static_cast<s32>(p_rects[0].top), static_cast<s32>(p_rects[0].right), static_cast<s32>(p_rects[0].bottom) });
 		}
 		void GraphicsCommandListDep::SetPrimitiveTopology(EPrimitiveTopology topology)
 		{
 			p_command_list_->IASetPrimitiveTopology(ConvertPrimitiveTopology(topology));
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::SetPrimitiveTopology, {}, static_cast<u32>(topology));
 		}
 		void GraphicsCommandListDep::SetVertexBuffers(u32 slot, u32 num, const D3D12_VERTEX_BUFFER_VIEW* p_views)
 		{
 			p_command_list_->IASetVertexBuffers( slot, num, p_views );
+			// GPUアドレスは実行毎に変わるためサイズとストライドのみ記録.
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::SetVertexBuffers, {}, std::array<u32, 4>{ slot, num, (p_views && 0 < num) ? p_views[0].SizeInBytes : 0u, (p_views && 0 < num) ? p_views[0].StrideInBytes : 0u });
 		}
 		void GraphicsCommandListDep::SetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* p_view)
 		{
 			p_command_list_->IASetIndexBuffer(p_view);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::SetIndexBuffer, {}, std::array<u32, 2>{ (p_view) ? p_view->SizeInBytes : 0u, (p_view) ? static_cast<u32>(p_view->Format) : 0u });
 		}
 		
 		void GraphicsCommandListDep::DrawInstanced(u32 num_vtx, u32 num_instance, u32 offset_vtx, u32 offset_instance)
 		{
 			FlushPendingBarriers();
 			p_command_list_->DrawInstanced(num_vtx, num_instance, offset_vtx, offset_instance);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::DrawInstanced, {}, std::array<u32, 4>{ num_vtx, num_instance, offset_vtx, offset_instance });
 		}
 		void GraphicsCommandListDep::DrawIndexedInstanced(u32 index_count_per_instance, u32 instance_count, u32 start_index_location, s32  base_vertex_location, u32 start_instance_location)
 		{
 			FlushPendingBarriers();
 			p_command_list_->DrawIndexedInstanced(index_count_per_instance, instance_count, start_index_location, base_vertex_location, start_instance_location);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::DrawIndexedInstanced, {}, std::array<u32, 5>{ index_count_per_instance, instance_count, start_index_location, static_cast<u32>(base_vertex_location), start_instance_location });
 		}
 		void GraphicsCommandListDep::DrawIndirect(BufferDep* p_arg_buffer)
 		{
@@ -951,161 +1310,46 @@ namespace ngl
 				nullptr,                // CountBuffer (not used)
 				0                       // CountBufferOffset
 			);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::DrawIndirect, { p_arg_buffer });
 		}
 
 		void GraphicsCommandListDep::SetPipelineState(GraphicsPipelineStateDep* pso)
 		{
 			p_command_list_->SetPipelineState(pso->GetD3D12PipelineState());
 			p_command_list_->SetGraphicsRootSignature(pso->GetD3D12RootSignature());
+			InvalidateRootDescriptorTableState(false);
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::SetGraphicsPipelineState, { pso });
 		}
 		void GraphicsCommandListDep::SetDescriptorSet(const GraphicsPipelineStateDep* p_pso, const DescriptorSetDep* p_desc_set)
 		{
 			assert(p_pso);
 			assert(p_desc_set);
+			// DescriptorSetは一時オブジェクトの場合が多いため参照はPSOのみ記録.
+			if (p_record_stream_)
+				p_record_stream_->Write(ERhiCommandOp::SetGraphicsDescriptorSet, { p_pso });
 
-			// cbv, srv, uav用デフォルトDescriptor取得.
-			const auto def_descriptor = parent_device_->GetPersistentDescriptorAllocator()->GetDefaultPersistentDescriptor();
 			const auto& resource_table = p_pso->GetPipelineResourceViewLayout()->GetResourceTable();
 
-			struct DescriptorSetInfo
-			{
-				DescriptorSetInfo(int max_register, const D3D12_CPU_DESCRIPTOR_HANDLE* p_handle, s8 table_index)
-					: max_register_(max_register)
-					, p_src_handle_(p_handle)
-					, table_index_(table_index)
-				{
-				}
-				int max_register_;
-				const D3D12_CPU_DESCRIPTOR_HANDLE* p_src_handle_;
-				int table_index_;
-			};
-			const DescriptorSetInfo sampler_set_info[] =
-			{
-				DescriptorSetInfo(p_desc_set->GetVsSampler().max_use_register_index, p_desc_set->GetVsSampler().cpu_handles, resource_table.vs_sampler_table),
-				DescriptorSetInfo(p_desc_set->GetPsSampler().max_use_register_index, p_desc_set->GetPsSampler().cpu_handles, resource_table.ps_sampler_table),
-				DescriptorSetInfo(p_desc_set->GetGsSampler().max_use_register_index, p_desc_set->GetGsSampler().cpu_handles, resource_table.gs_sampler_table),
-				DescriptorSetInfo(p_desc_set->GetHsSampler().max_use_register_index, p_desc_set->GetHsSampler().cpu_handles, resource_table.hs_sampler_table),
-				DescriptorSetInfo(p_desc_set->GetDsSampler().max_use_register_index, p_desc_set->GetDsSampler().cpu_handles, resource_table.ds_sampler_table),
-			};
-
-			// Sampler用のFrameDescriptorHeapに必要分確保するため総数計算.
-			auto total_samp_count = 0;
-			for (const auto& e : sampler_set_info)
-				total_samp_count += e.max_register_ + 1;
-
-			// Sampler用のFrameDescriptor確保. ここでPageが足りなければ新規Pageが確保されてHeapが切り替わるので, SetDescriptorHeaps() の前に実行する必要がある.
-			const auto sampler_desc_heap_type = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
-			D3D12_CPU_DESCRIPTOR_HANDLE cpu_sampler_handle_start;
-			D3D12_GPU_DESCRIPTOR_HANDLE gpu_sampler_handle_start;
-			// Heap確保. 現在のPageで必要分確保できなければ新規Page(Heap)に自動で切り替わる.
-			frame_desc_page_interface_for_sampler_.Allocate(total_samp_count, cpu_sampler_handle_start, gpu_sampler_handle_start);
-			const u64 sampler_handle_increment_size = frame_desc_page_interface_for_sampler_.GetPool()->GetHandleIncrementSize(sampler_desc_heap_type);
-
-
-			// DescriptorHeapの設定.
-			// Cbv Srv Uav用とSampler用.
-			// これ以前にFrameDescriptorから確保して必要ならばHeap切り替えが完了した後にCommandListにHeapを設定する.
-			// CommandListにHeapを設定した後にそのHeap上のDescriptorをDescriptorTableに設定する必要がある(設定されているHeapと異なるHeap上のDescriptorをセットするとD3Dエラーとなる.)
-			// CbvSrvUavのHeapは巨大な単一Heap上で確保するためアプリケーション実行中に変化しないのでSamplerとは異なりいつ設定しても良い.
-			ID3D12DescriptorHeap* heaps[] =
-			{
-				frame_desc_interface_.GetManager()->GetD3D12DescriptorHeap(),
-				frame_desc_page_interface_for_sampler_.GetD3D12DescriptorHeap()
-			};
-			p_command_list_->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
-
-
-			// Samplerのコミット.
+			// Samplerのコミット. DescriptorHeapの設定もここで実行される.
 			{
-				// 各ステージのSamplerを設定.
-				#if NGL_DEBUG_DESCRIPTOR_SET_OPTIMIZATION
-					// 事前に歯抜けにデフォルトのDescriptorを埋めておく場合は一時バッファ不要.
-				#else
-					D3D12_CPU_DESCRIPTOR_HANDLE tmp[k_sampler_table_size];
-				#endif
-				
-				auto SetSamplerDescriptor = [&](
-					D3D12_DESCRIPTOR_HEAP_TYPE heap_type,
-					D3D12_CPU_DESCRIPTOR_HANDLE dst_cpu_handle_start,
-					D3D12_GPU_DESCRIPTOR_HANDLE dst_gpu_handle_start,
-					u32 src_count, const D3D12_CPU_DESCRIPTOR_HANDLE* src_handle,
-					u8 table_index)
+				const DescriptorTableRequest sampler_request[] =
 				{
-					if (0 > table_index || 0 >= src_count)
-						return;
-
-					#if NGL_DEBUG_DESCRIPTOR_SET_OPTIMIZATION
-						// 最適化案.
-						//	DescriptorSetへの設定時点でそのバッファの歯抜け部にデフォルトDescriptorを詰めておくことで, ここでの一時バッファへのコピーを省略する.
-						const D3D12_CPU_DESCRIPTOR_HANDLE* src_handle_buffer = src_handle;
-					#else
-						for (u32 i = 0; i < src_count; i++)
-						{
-							tmp[i] = (src_handle[i].ptr > 0) ? src_handle[i] : def_descriptor.cpu_handle;
-						}
-						const D3D12_CPU_DESCRIPTOR_HANDLE* src_handle_buffer = tmp;
-					#endif
-
-					// FrameDescriptorHeapから連続したDescriptorを確保してコピー,CommandListへセットする.
-					parent_device_->GetD3D12Device()->CopyDescriptors(
-						1, &dst_cpu_handle_start, &src_count,
-						src_count, src_handle_buffer, nullptr,
-						heap_type);
-					p_command_list_->SetGraphicsRootDescriptorTable(table_index, dst_gpu_handle_start);
+					{ static_cast<u32>(p_desc_set->GetVsSampler().max_use_register_index + 1), p_desc_set->GetVsSampler().cpu_handles, resource_table.vs_sampler_table },
+					{ static_cast<u32>(p_desc_set->GetPsSampler().max_use_register_index + 1), p_desc_set->GetPsSampler().cpu_handles, resource_table.ps_sampler_table },
+					{ static_cast<u32>(p_desc_set->GetGsSampler().max_use_register_index + 1), p_desc_set->GetGsSampler().cpu_handles, resource_table.gs_sampler_table },
+					{ static_cast<u32>(p_desc_set->GetHsSampler().max_use_register_index + 1), p_desc_set->GetHsSampler().cpu_handles, resource_table.hs_sampler_table },
+					{ static_cast<u32>(p_desc_set->GetDsSampler().max_use_register_index + 1), p_desc_set->GetDsSampler().cpu_handles, resource_table.ds_sampler_table },
 				};
-
-				for (const auto& e : sampler_set_info)
-				{
-					const auto copy_count = e.max_register_ + 1;
-					// 指定のFrameDescriptor開始位置から始まる範囲にDescriptorをコピーしてCommandListに設定.
-					SetSamplerDescriptor(sampler_desc_heap_type, cpu_sampler_handle_start, gpu_sampler_handle_start, copy_count, e.p_src_handle_, e.table_index_);
-
-					// FrameDescriptor上のポインタを進行.
-					const auto offset_size = sampler_handle_increment_size * static_cast<u64>(copy_count);
-					cpu_sampler_handle_start.ptr += offset_size;
-					gpu_sampler_handle_start.ptr += offset_size;
-				}
+				CommitSamplerDescriptorTable(false, sampler_request, static_cast<u32>(std::size(sampler_request)));
 			}
 
 			// CBV, SRV, UAVのコミット.
 			{
-				const auto cvbsrvuav_desc_heap_type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-
-				#if NGL_DEBUG_DESCRIPTOR_SET_OPTIMIZATION
-					// 事前に歯抜けにデフォルトのDescriptorを埋めておく場合は一時バッファ不要.
-				#else
-					D3D12_CPU_DESCRIPTOR_HANDLE tmp[k_srv_table_size];
-				#endif
-
-				auto SetViewDescriptor = [&](u32 count, const D3D12_CPU_DESCRIPTOR_HANDLE* handles, u8 table_index)
+				auto SetViewDescriptor = [&](int count, const D3D12_CPU_DESCRIPTOR_HANDLE* handles, s8 table_index)
 				{
-					if (0 > table_index || 0 >= count)
-						return;
-
-					#if NGL_DEBUG_DESCRIPTOR_SET_OPTIMIZATION
-						// 最適化案.
-						//	DescriptorSetへの設定時点でそのバッファの歯抜け部にデフォルトDescriptorを詰めておくことで, ここでの一時バッファへのコピーを省略する.
-						const D3D12_CPU_DESCRIPTOR_HANDLE* src_handle_buffer = handles;
-					#else
-						// 歯抜けで設定されていない要素はデフォルトDescriptorを詰める.
-						for (u32 i = 0; i < count; i++)
-						{
-							tmp[i] = (handles[i].ptr > 0) ? handles[i] : def_descriptor.cpu_handle;
-						}
-						const D3D12_CPU_DESCRIPTOR_HANDLE* src_handle_buffer = tmp;
-					#endif
-
-
-					D3D12_CPU_DESCRIPTOR_HANDLE dst_cpu;
-					D3D12_GPU_DESCRIPTOR_HANDLE dst_gpu;
-					frame_desc_interface_.Allocate(count, dst_cpu, dst_gpu);
-
-					// FrameDescriptorHeapから連続したDescriptorを確保してコピー,CommandListへセットする.
-					parent_device_->GetD3D12Device()->CopyDescriptors(
-						1, &dst_cpu, &count,
-						count, src_handle_buffer, nullptr,
-						cvbsrvuav_desc_heap_type);
-					p_command_list_->SetGraphicsRootDescriptorTable(table_index, dst_gpu);
+					CommitViewDescriptorTable(false, { static_cast<u32>(count), handles, table_index });
 				};
 				// 各ステージの各リソースタイプ別に連続Descriptorを確保,コピーしてテーブルにをセットしていく
 				
@@ -1138,6 +1382,14 @@ namespace ngl
 					SetViewDescriptor(p_desc_set->GetDsSrv().max_use_register_index + 1, p_desc_set->GetDsSrv().cpu_handles, resource_table.ds_srv_table);
 				}
 			}
+
+			CommitBindlessDescriptorTable(false, resource_table.bindless_srv_table);
+		}
+		void GraphicsCommandListDep::SetRootConstant(const GraphicsPipelineStateDep* p_pso, const void* p_data, u32 byte_size)
+		{
+			assert(p_pso);
+			const auto& resource_table = p_pso->GetPipelineResourceViewLayout()->GetResourceTable();
+			SetRootConstantImpl(false, p_pso, resource_table.root_constant_param, resource_table.root_constant_count, p_data, byte_size);
 		}
 		// -------------------------------------------------------------------------------------------------------------------------------------------------
 
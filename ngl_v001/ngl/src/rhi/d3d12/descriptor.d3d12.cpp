@@ -681,7 +681,7 @@ namespace ngl
 		}
 
 		// frame_index はグローバルに加算され続けるインデックスであり, Deviceから供給される.
-		void DynamicDescriptorManager::ReadyToNewFrame(u32 frame_index)
+		void DynamicDescriptorManager::ReadyToNewFrame(u64 completed_frame_index)
 		{
 			// ロック
 			std::lock_guard<std::mutex> lock(mutex_);
@@ -691,17 +691,10 @@ namespace ngl
 				if (!deferred_deallocate_list_[i]->used)
 					continue;
 
+				// 解放リクエストしたフレームのGPU処理が完了していれば破棄.
+				//	Frames In Flight の数によらず, GPUがそのフレームのコマンドを処理し終えるまで再利用しない.
 				const auto elem_frame_index = deferred_deallocate_list_[i]->frame;
-				u32 frame_diff = (frame_index > elem_frame_index) ? frame_index - elem_frame_index : elem_frame_index - frame_index;
-#if NGL_RHI_COMMANDLIST_DESCRIPTOR_RESET_ON_END
-				// CommandListのDynamicDescriptor解放をEnd()で行う場合はここは2F待機.
-				constexpr u32 k_frame_descriptor_reset_frame = 2;
-#else
-				constexpr u32 k_frame_descriptor_reset_frame = 1;
-#endif
-				
-				// フレーム差分が十分以上なら破棄.
-				if (k_frame_descriptor_reset_frame <= frame_diff)
+				if (static_cast<u64>(elem_frame_index) <= completed_frame_index)
 				{
 					// ロック中なので自身のDeallocateメソッドではなく, range_allocatorの関数を直接呼んでいる.
 					for (auto h : deferred_deallocate_list_[i]->handles)
@@ -1038,15 +1031,10 @@ namespace ngl
 
 			// タイミングで返却リストのものを処理する.
 			{
+				// 返却したフレームのGPU処理が完了していれば再利用可能. Frames In Flight の数によらない.
 				const auto func_check_fence_complete = [](DeviceDep* p_device, u64 retired_frame)
 				{
-					const auto frame_index = p_device->GetDeviceFrameIndex();
-					if (frame_index == retired_frame)
-						return false;
-
-					const auto max_index = ~u64(0);
-					const auto frame_diff = (frame_index > retired_frame) ? (frame_index - retired_frame) : (max_index - retired_frame + (frame_index + 1));
-					return (2 <= frame_diff);
+					return retired_frame <= p_device->GetCompletedFrameIndex();
 				};
 
 				// 返却Queueの先頭から経過フレームチェックで再利用可能なものをAvailableに移動.
@@ -264,6 +264,38 @@ namespace ngl
 				}
 			}
 
+			// Bindless領域の確保. 以降は解放せずデバイスの寿命まで固定.
+			if (desc_.enable_bindless)
+			{
+				// 非有界のDescriptorテーブルはResourceBindingTier2以上.
+				D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+				const bool is_supported = SUCCEEDED(p_device_->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)))
+					&& (D3D12_RESOURCE_BINDING_TIER_2 <= options.ResourceBindingTier);
+				if (!is_supported)
+				{
+					std::cout << "[WARN] Bindless was requested (enable_bindless=true) but ResourceBindingTier2 is not supported. Bindless is disabled." << std::endl;
+				}
+				else
+				{
+					bindless_descriptor_handle_ = p_dynamic_descriptor_manager_->AllocateDescriptorArray(desc_.bindless_descriptor_count);
+					if (!bindless_descriptor_handle_.IsValid() || !bindless_index_allocator_.Initialize(desc_.bindless_descriptor_count, 1))
+					{
+						std::cout << "[ERROR] Allocate Bindless Descriptor" << std::endl;
+						return false;
+					}
+					p_dynamic_descriptor_manager_->GetDescriptor(bindless_descriptor_handle_, bindless_cpu_handle_start_, bindless_gpu_handle_start_);
+
+					// 全域をデフォルトDescriptorで埋めておく. インデックス0はデフォルト用の予約.
+					const auto def_descriptor = p_persistent_descriptor_allocator_->GetDefaultPersistentDescriptor();
+					const u32 increment = p_dynamic_descriptor_manager_->GetHandleIncrementSize();
+					for (u32 i = 0; i < desc_.bindless_descriptor_count; ++i)
+					{
+						p_device_->CopyDescriptorsSimple(1, { bindless_cpu_handle_start_.ptr + static_cast<SIZE_T>(i) * increment }, def_descriptor.cpu_handle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+					}
+					bindless_enabled_ = true;
+				}
+			}
+
 			// FrameDescriptorHeapPagePool初期化
 			{
 				p_frame_descriptor_page_pool_.reset(new FrameDescriptorHeapPagePool());
@@ -276,7 +308,7 @@ namespace ngl
 
 			// Gabage Collector.
 			{
-				if (!gb_.Initialize())
+				if (!gb_.Initialize(desc_.gabage_collector_desc))
 				{
 					std::cout << "[ERROR] Initialize RHI GabageCollector" << std::endl;
 					return false;
@@ -311,24 +343,83 @@ namespace ngl
 			cb_pool_.Finalize();
 			gb_.Finalize();
 
+			if (bindless_enabled_)
+			{
+				p_dynamic_descriptor_manager_->Deallocate(bindless_descriptor_handle_);
+				bindless_descriptor_handle_ = {};
+				bindless_index_allocator_.Finalize();
+				bindless_enabled_ = false;
+			}
+			p_frame_completion_fence_ = nullptr;
+
 			p_device_ = nullptr;
 			p_factory_ = nullptr;
 		}
 
 		void DeviceDep::ReadyToNewFrame()
 		{
+			// ここまでに破棄依頼されたオブジェクトは今回のフレーム番号まで参照され得る.
+			// フレーム番号を進める前に受付を締める.
+			gb_.ReadyToNewFrame(frame_index_);
+
 			++frame_index_;
 
+			// コマンドキャプチャの確定と開始.
+			command_capture_.ReadyToNewFrame(frame_index_);
+
+			{
+				std::scoped_lock lock(descriptor_table_cache_statistics_mutex_);
+				descriptor_table_cache_statistics_ = descriptor_table_cache_statistics_accum_;
+				descriptor_table_cache_statistics_accum_ = {};
+			}
+
 			buffer_index_ = (buffer_index_ + 1) % desc_.swapchain_buffer_count;
 
-			p_dynamic_descriptor_manager_->ReadyToNewFrame((u32)frame_index_);
+			// GPUの完了フレーム. フレーム単位のリソースの再利用と遅延破棄の判定に利用する.
+			//	完了Fence未設定の場合は GameThread->RenderThread->GPU という構成での最大である2フレーム前を完了済みとみなす.
+			constexpr u64 k_fallback_frame_latency = 2;
+			const u64 completed_frame_index = std::min<u64>((p_frame_completion_fence_) ?
+				p_frame_completion_fence_->GetD3D12Fence()->GetCompletedValue() :
+				((k_fallback_frame_latency <= frame_index_) ? (frame_index_ - k_fallback_frame_latency) : 0), frame_index_ - 1);
+			completed_frame_index_ = completed_frame_index;
+
+			p_dynamic_descriptor_manager_->ReadyToNewFrame(completed_frame_index);
 
-			cb_pool_.ReadyToNewFrame();
-			gb_.ReadyToNewFrame();
+			cb_pool_.ReadyToNewFrame(frame_index_, completed_frame_index);
+
+			// ガベコレ. GPUの完了フレームまでの破棄依頼を処理する.
+			gb_.Execute(completed_frame_index);
+			// 破棄されたViewのBindlessインデックスも同じ完了フレームで再利用可能とする.
+			bindless_index_allocator_.ReadyToNewFrame(completed_frame_index);
+		}
+
+		void DeviceDep::AddDescriptorTableCacheStatistics(const DescriptorTableCache::Statistics& v)
+		{
+			std::scoped_lock lock(descriptor_table_cache_statistics_mutex_);
+			descriptor_table_cache_statistics_accum_.Add(v);
+		}
 
+		u32 DeviceDep::AllocateBindlessDescriptor(D3D12_CPU_DESCRIPTOR_HANDLE src_cpu_handle)
+		{
+			if (!bindless_enabled_)
+				return BindlessDescriptorIndexAllocator::k_invalid_index;
 
-			// ガベコレ. 実際にはここを別スレッドに逃がすことも考えられる.
-			gb_.Execute();
+			const u32 index = bindless_index_allocator_.Allocate();
+			if (BindlessDescriptorIndexAllocator::k_invalid_index == index)
+			{
+				std::cout << "[ERROR] Bindless Descriptor is full." << std::endl;
+				return index;
+			}
+			const D3D12_CPU_DESCRIPTOR_HANDLE dst = { bindless_cpu_handle_start_.ptr + static_cast<SIZE_T>(index) * p_dynamic_descriptor_manager_->GetHandleIncrementSize() };
+			p_device_->CopyDescriptorsSimple(1, dst, src_cpu_handle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+			return index;
+		}
+		void DeviceDep::DeallocateBindlessDescriptor(u32 index)
+		{
+			if (!bindless_enabled_ || BindlessDescriptorIndexAllocator::k_invalid_index == index)
+				return;
+			// Descriptorの書き換えは再確保時に行う.
+			bindless_index_allocator_.Free(index, frame_index_);
 		}
 
 		// 派生Deviceクラスで実装.
@@ -516,6 +607,8 @@ namespace ngl
 				std::cout << "[ERROR] Create Command Queue" << std::endl;
 				return false;
 			}
+			InitializeRhiObject(p_device);
+			capture_queue_type_ = (D3D12_COMMAND_LIST_TYPE_DIRECT == type) ? 0 : (D3D12_COMMAND_LIST_TYPE_COPY == type) ? 2 : 1;
 
 			return true;
 		}
@@ -526,6 +619,7 @@ namespace ngl
 				return;
 			// Signal発行.
 			p_command_queue_->Signal( p_fence->GetD3D12Fence(), fence_value);
+			GetParentDevice()->GetCommandCapture().OnSignal(capture_queue_type_, p_fence);
 		}
 		// FenceでWait.
 		void CommandQueueBaseDep::Wait(FenceDep* p_fence, ngl::types::u64 wait_value)
@@ -533,6 +627,20 @@ namespace ngl
 			if (!p_fence)
 				return;
 			p_command_queue_->Wait( p_fence->GetD3D12Fence(), wait_value);
+			GetParentDevice()->GetCommandCapture().OnWait(capture_queue_type_, p_fence);
+		}
+
+		void CommandQueueBaseDep::NotifyExecuteToCapture(unsigned int num_command_list, CommandListBaseDep** p_command_lists)
+		{
+			auto& capture = GetParentDevice()->GetCommandCapture();
+			for (auto i = 0u; i < num_command_list; ++i)
+			{
+				if (auto* p_stream = p_command_lists[i]->GetRecordStream())
+				{
+					capture.OnExecute(capture_queue_type_, p_stream);
+					p_command_lists[i]->ClearRecordStream();
+				}
+			}
 		}
 
 		ID3D12CommandQueue* CommandQueueBaseDep::GetD3D12CommandQueue()
@@ -578,6 +686,7 @@ namespace ngl
 				std::cout << "[ngl][GraphicsCommandQueueDep] ExecuteCommandLists: catch exception." << std::endl;
 				OutputDebugString(_T("[ngl][GraphicsCommandQueueDep] ExecuteCommandLists: catch exception."));
 			}
+			NotifyExecuteToCapture(num_command_list, p_command_lists);
 		}
 		// -------------------------------------------------------------------------------------------------------------------------------------------------
 		// -------------------------------------------------------------------------------------------------------------------------------------------------
@@ -617,6 +726,46 @@ namespace ngl
 				std::cout << "[ngl][ComputeCommandQueueDep] ExecuteCommandLists: catch exception." << std::endl;
 				OutputDebugString(_T("[ngl][ComputeCommandQueueDep] ExecuteCommandLists: catch exception."));
 			}
+			NotifyExecuteToCapture(num_command_list, p_command_lists);
+		}
+		// -------------------------------------------------------------------------------------------------------------------------------------------------
+		// -------------------------------------------------------------------------------------------------------------------------------------------------
+		CopyCommandQueueDep::CopyCommandQueueDep()
+		{
+		}
+		CopyCommandQueueDep::~CopyCommandQueueDep()
+		{
+			Finalize();
+		}
+
+		bool CopyCommandQueueDep::Initialize(DeviceDep* p_device)
+		{
+			return CommandQueueBaseDep::Initialize(p_device, D3D12_COMMAND_LIST_TYPE::D3D12_COMMAND_LIST_TYPE_COPY);
+		}
+
+		void CopyCommandQueueDep::Finalize()
+		{
+		}
+
+		void CopyCommandQueueDep::ExecuteCommandLists(unsigned int num_command_list, CommandListBaseDep** p_command_lists)
+		{
+			// 一時バッファに詰める
+			std::vector<ID3D12CommandList*> p_command_list_array = {};
+			for (auto i = 0u; i < num_command_list; ++i)
+			{
+				p_command_list_array.push_back(p_command_lists[i]->GetD3D12GraphicsCommandList());
+			}
+			try
+			{
+				p_command_queue_->ExecuteCommandLists(num_command_list, &(p_command_list_array[0]));
+			}
+			catch (...)
+			{
+				// D3D12で稀に発生するcom_errorをキャッチ
+				std::cout << "[ngl][CopyCommandQueueDep] ExecuteCommandLists: catch exception." << std::endl;
+				OutputDebugString(_T("[ngl][CopyCommandQueueDep] ExecuteCommandLists: catch exception."));
+			}
+			NotifyExecuteToCapture(num_command_list, p_command_lists);
 		}
 		// -------------------------------------------------------------------------------------------------------------------------------------------------
 
@@ -947,8 +947,27 @@ namespace ngl
 			return _Initialize(p_device, p_buffer, desc, view_);
 		}
 
+		bool ShaderResourceViewDep::RegisterBindless()
+		{
+			auto* p_device = GetParentDevice();
+			if (!p_device || !p_device->IsBindlessEnabled() || !view_.IsValid())
+				return false;
+			if (k_invalid_bindless_index != bindless_index_)
+				return true;
+
+			bindless_index_ = p_device->AllocateBindlessDescriptor(view_.cpu_handle);
+			return k_invalid_bindless_index != bindless_index_;
+		}
+
 		void ShaderResourceViewDep::Finalize()
 		{
+			if (k_invalid_bindless_index != bindless_index_)
+			{
+				if (auto* p_device = GetParentDevice())
+					p_device->DeallocateBindlessDescriptor(bindless_index_);
+				bindless_index_ = k_invalid_bindless_index;
+			}
+
 			auto&& descriptor_allocator = view_.allocator;
 			if (descriptor_allocator)
 			{
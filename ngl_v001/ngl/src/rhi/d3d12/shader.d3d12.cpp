@@ -709,6 +709,7 @@ namespace rhi
 						{
 							resource_slot_[valid_slot_count].type = paramType;
 							resource_slot_[valid_slot_count].bind_point = bd.BindPoint;
+							resource_slot_[valid_slot_count].register_space = bd.Space;
 							resource_slot_[valid_slot_count].name.Set(bd.Name, static_cast<unsigned int>(std::strlen(bd.Name)));
 
 							++valid_slot_count;
@@ -803,8 +804,16 @@ namespace rhi
 			return false;
 
 
+		// 固定テーブル外(register space0以外)のリソース利用情報.
+		struct ExtraParameterUsage
+		{
+			bool	use_bindless_srv = false;
+			u32		root_constant_count = 0;
+		};
+		ExtraParameterUsage extra_usage = {};
+
 		// Layout情報取得
-		auto func_setup_slot = [](EShaderStage stage, DeviceDep* p_device, const ShaderReflectionDep& p_reflection, std::unordered_map<ResourceViewName, Slot>& slot_map)
+		auto func_setup_slot = [&extra_usage](EShaderStage stage, DeviceDep* p_device, const ShaderReflectionDep& p_reflection, std::unordered_map<ResourceViewName, Slot>& slot_map)
 		{
 			auto SetRegisterIndex = [](Slot& slot, u32 bind_point, ERootParameterType type, EShaderStage shader_stage)
 			{
@@ -824,6 +833,37 @@ namespace rhi
 			{
 				if (const auto* slot_info = p_reflection.GetResourceSlotInfo(i))
 				{
+					// space0以外は名前によるDescriptorSet設定の対象外.
+					if (0 != slot_info->register_space)
+					{
+						if (k_bindless_srv_register_space == slot_info->register_space && ERootParameterType::ShaderResource == slot_info->type)
+						{
+							extra_usage.use_bindless_srv = true;
+						}
+						else if (k_root_constant_register_space == slot_info->register_space && ERootParameterType::ConstantBuffer == slot_info->type && 0 == slot_info->bind_point)
+						{
+							// サイズはConstantBuffer情報から取得.
+							for (auto cbi = 0u; cbi < p_reflection.NumCbInfo(); ++cbi)
+							{
+								const auto* cb_info = p_reflection.GetCbInfo(cbi);
+								if (cb_info && 0 == std::strncmp(cb_info->name, slot_info->name.Get(), sizeof(cb_info->name)))
+								{
+									extra_usage.root_constant_count = std::max<u32>(extra_usage.root_constant_count, (cb_info->size + 3) / 4);
+								}
+							}
+							if (k_max_root_constant_count < extra_usage.root_constant_count)
+							{
+								std::cout << "[ERROR] RootConstant size over. " << slot_info->name.Get() << std::endl;
+								return false;
+							}
+						}
+						else
+						{
+							std::cout << "[ERROR] Unsupported register space. " << slot_info->name.Get() << " space" << slot_info->register_space << std::endl;
+						}
+						continue;
+					}
+
 					auto itr = slot_map.find(slot_info->name);
 					if (itr != slot_map.end())
 					{
@@ -913,8 +953,9 @@ namespace rhi
 			p_param_array[table].ShaderVisibility = ConvertShaderVisibility(stage);
 		};
 
-		std::array<D3D12_DESCRIPTOR_RANGE, num_shader_stage* fixed_range_infos.size()> ranges;
-		std::array<D3D12_ROOT_PARAMETER, num_shader_stage* fixed_range_infos.size()>  rootParameters;
+		// 固定テーブルに加えてBindless SRVテーブルとRootConstantの分.
+		std::array<D3D12_DESCRIPTOR_RANGE, num_shader_stage* fixed_range_infos.size() + 1> ranges;
+		std::array<D3D12_ROOT_PARAMETER, num_shader_stage* fixed_range_infos.size() + 2>  rootParameters;
 		{
 			// フラグ初期化. 全シェーダステージ無視フラグで初期化しておき, 有効なシェーダステージがあれば無視フラグを除去していく.
 			root_signature_desc.Flags =
@@ -1039,6 +1080,31 @@ namespace rhi
 
 					root_signature_desc.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
 				}
+
+				// Bindless SRV配列. DynamicDescriptorManager上のDeviceのBindless領域全体を指す非有界テーブル.
+				if (extra_usage.use_bindless_srv)
+				{
+					assert(p_device->IsBindlessEnabled());
+					resource_table_.bindless_srv_table = root_table_index;
+					ranges[root_table_index] = { D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, k_bindless_srv_register_space, 0 };
+					rootParameters[root_table_index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+					rootParameters[root_table_index].DescriptorTable.NumDescriptorRanges = 1;
+					rootParameters[root_table_index].DescriptorTable.pDescriptorRanges = &ranges[root_table_index];
+					rootParameters[root_table_index].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+					++root_table_index;
+				}
+				// RootConstant.
+				if (0 < extra_usage.root_constant_count)
+				{
+					resource_table_.root_constant_param = root_table_index;
+					resource_table_.root_constant_count = static_cast<u8>(extra_usage.root_constant_count);
+					rootParameters[root_table_index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+					rootParameters[root_table_index].Constants.ShaderRegister = 0;
+					rootParameters[root_table_index].Constants.RegisterSpace = k_root_constant_register_space;
+					rootParameters[root_table_index].Constants.Num32BitValues = extra_usage.root_constant_count;
+					rootParameters[root_table_index].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+					++root_table_index;
+				}
 			}
 			root_signature_desc.NumParameters = root_table_index;
 			root_signature_desc.pParameters = rootParameters.data();
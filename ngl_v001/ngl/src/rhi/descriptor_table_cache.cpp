@@ -0,0 +1,347 @@
+﻿
+#include "rhi/descriptor_table_cache.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include "rhi/rhi_command_capture.h"
+
+
+namespace ngl
+{
+namespace rhi
+{
+	namespace
+	{
+		constexpr u64 Mix64(u64 v)
+		{
+			v ^= v >> 33;
+			v *= 0xff51afd7ed558ccdull;
+			v ^= v >> 33;
+			v *= 0xc4ceb9fe1a85ec53ull;
+			v ^= v >> 33;
+			return v;
+		}
+
+		u32 CeilPow2(u32 v)
+		{
+			u32 n = 1;
+			while (n < v)
+				n <<= 1;
+			return n;
+		}
+	}
+
+	void DescriptorTableCache::Statistics::Add(const Statistics& v)
+	{
+		num_lookup += v.num_lookup;
+		num_hit += v.num_hit;
+		num_flush += v.num_flush;
+		num_saved_descriptor += v.num_saved_descriptor;
+		num_skipped_root_set += v.num_skipped_root_set;
+	}
+
+
+	DescriptorTableCache::DescriptorTableCache()
+	{
+	}
+	DescriptorTableCache::~DescriptorTableCache()
+	{
+	}
+
+	void DescriptorTableCache::Initialize(const Desc& desc)
+	{
+		desc_ = desc;
+		// 負荷率を1/2以下に保つため2倍のスロットを用意する.
+		const u32 num_slot = CeilPow2(std::max(desc_.max_entry, 1u) * 2);
+		entry_array_.assign(num_slot, Entry{});
+		entry_mask_ = num_slot - 1;
+		num_entry_ = 0;
+		handle_pool_.clear();
+		handle_pool_.reserve(desc_.max_handle);
+		statistics_ = {};
+	}
+
+	void DescriptorTableCache::Reset()
+	{
+		if (0 == num_entry_)
+			return;
+		for (auto& e : entry_array_)
+			e.is_valid = 0;
+		num_entry_ = 0;
+		handle_pool_.clear();
+	}
+
+	u64 DescriptorTableCache::ComputeHash(u32 heap_type, const u64* p_handle, u32 count)
+	{
+		u64 h = Mix64((static_cast<u64>(heap_type) << 32) | count);
+		for (u32 i = 0; i < count; ++i)
+		{
+			h ^= Mix64(p_handle[i] + 0x9e3779b97f4a7c15ull * (i + 1));
+			h = (h << 27) | (h >> 37);
+		}
+		return Mix64(h);
+	}
+
+	bool DescriptorTableCache::IsSameKey(const Entry& e, u32 heap_type, const u64* p_handle, u32 count, u64 hash) const
+	{
+		return (e.hash == hash) && (e.heap_type == heap_type) && (e.count == count)
+			&& (0 == std::memcmp(handle_pool_.data() + e.handle_offset, p_handle, sizeof(u64) * count));
+	}
+
+	bool DescriptorTableCache::Find(u32 heap_type, const u64* p_handle, u32 count, u64 hash, u64 heap_id, Range& out_range)
+	{
+		++statistics_.num_lookup;
+		if (entry_array_.empty())
+			return false;
+
+		for (u32 i = static_cast<u32>(hash) & entry_mask_; ; i = (i + 1) & entry_mask_)
+		{
+			const Entry& e = entry_array_[i];
+			if (!e.is_valid)
+				return false;
+			if (IsSameKey(e, heap_type, p_handle, count, hash))
+			{
+				if (e.range.heap_id != heap_id)
+					return false;
+				out_range = e.range;
+				++statistics_.num_hit;
+				statistics_.num_saved_descriptor += count;
+				return true;
+			}
+		}
+	}
+
+	void DescriptorTableCache::Insert(u32 heap_type, const u64* p_handle, u32 count, u64 hash, const Range& range)
+	{
+		if (entry_array_.empty() || 0 == count || 0xffff < count || desc_.max_handle < count)
+			return;
+
+		// 同一キーの上書き.
+		u32 slot = static_cast<u32>(hash) & entry_mask_;
+		for (; entry_array_[slot].is_valid; slot = (slot + 1) & entry_mask_)
+		{
+			if (IsSameKey(entry_array_[slot], heap_type, p_handle, count, hash))
+			{
+				entry_array_[slot].range = range;
+				return;
+			}
+		}
+
+		// 容量超過時は全破棄.
+		if (desc_.max_entry <= num_entry_ || desc_.max_handle < handle_pool_.size() + count)
+		{
+			Reset();
+			++statistics_.num_flush;
+			slot = static_cast<u32>(hash) & entry_mask_;
+		}
+
+		Entry& e = entry_array_[slot];
+		e.hash = hash;
+		e.handle_offset = static_cast<u32>(handle_pool_.size());
+		e.count = static_cast<u16>(count);
+		e.heap_type = static_cast<u8>(heap_type);
+		e.is_valid = 1;
+		e.range = range;
+		handle_pool_.insert(handle_pool_.end(), p_handle, p_handle + count);
+		++num_entry_;
+	}
+
+
+	DescriptorTableCacheReplayResult ReplayDescriptorTableCache(const RhiCommandCaptureResult& capture, const DescriptorTableCache::Desc& desc, u32 num_iteration)
+	{
+		DescriptorTableCacheReplayResult result = {};
+		if (!capture.is_valid)
+			return result;
+
+		DescriptorTableCache cache;
+		cache.Initialize(desc);
+
+		constexpr u32 k_max_root_parameter = 64;
+		// 設定済みの範囲. [0]:Graphics, [1]:Compute.
+		std::array<std::array<u64, k_max_root_parameter>, 2> bound_table = {};
+		std::vector<u64> handle_array;
+		// 範囲の割り当てを模倣する. 実際の確保は行わない.
+		u64 alloc_cursor = 0;
+
+		const auto begin_time = std::chrono::high_resolution_clock::now();
+		for (u32 iteration = 0; iteration < std::max(num_iteration, 1u); ++iteration)
+		{
+			for (const auto& stream : capture.stream_array)
+			{
+				stream->ForEach([&](const RhiCommandStream::CommandView& cmd)
+					{
+						switch (cmd.op)
+						{
+						case ERhiCommandOp::Begin:
+						{
+							cache.Reset();
+							bound_table = {};
+							break;
+						}
+						case ERhiCommandOp::SetGraphicsPipelineState:
+						case ERhiCommandOp::SetComputePipelineState:
+						{
+							// RootSignatureの再設定でRootDescriptorTableは未定義になる.
+							bound_table = {};
+							break;
+						}
+						case ERhiCommandOp::SetDescriptorTable:
+						{
+							RhiCommandSetDescriptorTableParam param = {};
+							std::memcpy(&param, cmd.p_param, std::min<u32>(cmd.param_size, sizeof(param)));
+
+							handle_array.resize(cmd.num_object);
+							for (u32 i = 0; i < cmd.num_object; ++i)
+								handle_array[i] = cmd.GetObject(i);
+
+							const u64 hash = DescriptorTableCache::ComputeHash(param.heap_type, handle_array.data(), cmd.num_object);
+							DescriptorTableCache::Range range = {};
+							if (!cache.Find(param.heap_type, handle_array.data(), cmd.num_object, hash, 0, range))
+							{
+								range.cpu_handle = range.gpu_handle = ++alloc_cursor;
+								cache.Insert(param.heap_type, handle_array.data(), cmd.num_object, hash, range);
+							}
+
+							if (param.root_parameter_index < k_max_root_parameter)
+							{
+								auto& bound = bound_table[param.is_compute ? 1 : 0][param.root_parameter_index];
+								if (bound == range.gpu_handle)
+									cache.CountSkippedRootSet();
+								bound = range.gpu_handle;
+							}
+
+							++result.num_table;
+							result.num_descriptor += cmd.num_object;
+							break;
+						}
+						default:
+							break;
+						}
+					});
+			}
+		}
+		const auto end_time = std::chrono::high_resolution_clock::now();
+
+		result.statistics = cache.GetStatistics();
+		result.elapsed_ms = std::chrono::duration<double, std::milli>(end_time - begin_time).count();
+		return result;
+	}
+
+
+	// -------------------------------------------------------------------------------------------------------------------------------------------------
+	namespace
+	{
+		// 1テーブル分の SetDescriptorTable を記録.
+		void WriteTestDescriptorTable(RhiCommandStream& stream, u32 root_parameter_index, u8 heap_type, const std::vector<u64>& handle_array)
+		{
+			std::vector<const void*> object_array(handle_array.size());
+			for (size_t i = 0; i < handle_array.size(); ++i)
+				object_array[i] = reinterpret_cast<const void*>(handle_array[i]);
+
+			RhiCommandSetDescriptorTableParam param = {};
+			param.root_parameter_index = root_parameter_index;
+			param.heap_type = heap_type;
+			stream.Write(ERhiCommandOp::SetDescriptorTable, object_array.data(), static_cast<u32>(object_array.size()), &param, sizeof(param));
+		}
+	}
+
+	void TestDescriptorTableCache()
+	{
+		bool is_ok = true;
+
+		// 一致判定. 内容, 個数, ヒープ種別, Heapのいずれかが異なればヒットしない.
+		{
+			DescriptorTableCache cache;
+			cache.Initialize(DescriptorTableCache::Desc{});
+
+			const u64 handle_a[] = { 0x1000, 0x1020, 0x1040 };
+			const u64 handle_b[] = { 0x1000, 0x1040, 0x1020 };
+			DescriptorTableCache::Range range = {};
+			range.gpu_handle = 100;
+			range.heap_id = 1;
+			cache.Insert(0, handle_a, 3, DescriptorTableCache::ComputeHash(0, handle_a, 3), range);
+
+			DescriptorTableCache::Range found = {};
+			is_ok &= cache.Find(0, handle_a, 3, DescriptorTableCache::ComputeHash(0, handle_a, 3), 1, found) && (100 == found.gpu_handle);
+			is_ok &= !cache.Find(0, handle_b, 3, DescriptorTableCache::ComputeHash(0, handle_b, 3), 1, found);
+			is_ok &= !cache.Find(0, handle_a, 2, DescriptorTableCache::ComputeHash(0, handle_a, 2), 1, found);
+			is_ok &= !cache.Find(1, handle_a, 3, DescriptorTableCache::ComputeHash(1, handle_a, 3), 1, found);
+			is_ok &= !cache.Find(0, handle_a, 3, DescriptorTableCache::ComputeHash(0, handle_a, 3), 2, found);
+			// ハッシュが衝突しても内容で判定する.
+			is_ok &= !cache.Find(0, handle_b, 3, DescriptorTableCache::ComputeHash(0, handle_a, 3), 1, found);
+
+			cache.Reset();
+			is_ok &= !cache.Find(0, handle_a, 3, DescriptorTableCache::ComputeHash(0, handle_a, 3), 1, found);
+		}
+
+		// 容量超過時の全破棄.
+		{
+			DescriptorTableCache::Desc desc = {};
+			desc.max_entry = 16;
+			DescriptorTableCache cache;
+			cache.Initialize(desc);
+			for (u64 i = 0; i < 100; ++i)
+			{
+				const u64 handle[] = { i * 32, i * 32 + 32 };
+				const u64 hash = DescriptorTableCache::ComputeHash(0, handle, 2);
+				DescriptorTableCache::Range range = {};
+				range.gpu_handle = i + 1;
+				cache.Insert(0, handle, 2, hash, range);
+				DescriptorTableCache::Range found = {};
+				is_ok &= cache.Find(0, handle, 2, hash, 0, found) && (i + 1 == found.gpu_handle);
+			}
+			is_ok &= (desc.max_entry >= cache.NumEntry()) && (0 < cache.GetStatistics().num_flush);
+		}
+
+		// 模擬フレーム. 少数のマテリアルを共有する多数のDrawで, Drawごとに固有のCBVとマテリアルのSRV, Samplerを設定する.
+		{
+			constexpr u32 k_num_command_list = 8;
+			constexpr u32 k_num_draw = 512;
+			constexpr u32 k_num_material = 16;
+
+			RhiCommandCaptureResult capture;
+			for (u32 ci = 0; ci < k_num_command_list; ++ci)
+			{
+				auto stream = std::make_unique<RhiCommandStream>();
+				stream->Write(ERhiCommandOp::Begin);
+				for (u32 di = 0; di < k_num_draw; ++di)
+				{
+					const u64 material = (di / 8) % k_num_material;
+					if (0 == (di % 64))
+						stream->Write(ERhiCommandOp::SetGraphicsPipelineState, { reinterpret_cast<const void*>(0x100 + di / 64) });
+
+					WriteTestDescriptorTable(*stream, 0, 0, { 0x10000 + (ci * k_num_draw + di) * 32ull });
+					WriteTestDescriptorTable(*stream, 1, 0, { 0x80000 + material * 256, 0x80000 + material * 256 + 32, 0x80000 + material * 256 + 64 });
+					WriteTestDescriptorTable(*stream, 2, 1, { 0x4000, 0x4020 });
+					stream->Write(ERhiCommandOp::DrawIndexedInstanced);
+				}
+				stream->Write(ERhiCommandOp::End);
+				capture.stream_array.push_back(std::move(stream));
+			}
+			capture.is_valid = true;
+
+			const auto result = ReplayDescriptorTableCache(capture, DescriptorTableCache::Desc{}, 16);
+			const auto& stat = result.statistics;
+			// CBVは毎回ミス, マテリアルとSamplerはCommandList毎の初回以外ヒット.
+			const u64 num_table_per_iteration = k_num_command_list * k_num_draw * 3;
+			const u64 expect_hit_per_iteration = k_num_command_list * ((k_num_draw - k_num_material) + (k_num_draw - 1));
+			is_ok &= (num_table_per_iteration * 16 == result.num_table) && (expect_hit_per_iteration * 16 == stat.num_hit);
+
+			std::cout << "[TestDescriptorTableCache] table=" << result.num_table
+				<< " hit_rate=" << stat.HitRate()
+				<< " saved_descriptor=" << stat.num_saved_descriptor << "/" << result.num_descriptor
+				<< " skipped_root_set=" << stat.num_skipped_root_set
+				<< " " << (result.elapsed_ms * 1000000.0 / static_cast<double>(std::max<u64>(result.num_table, 1))) << "[ns/table]";
+		}
+
+		std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+		assert(is_ok);
+	}
+}
+}
@@ -0,0 +1,586 @@
+﻿
+#include "rhi/rhi_command_capture.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "file/file.h"
+
+namespace ngl
+{
+namespace rhi
+{
+	namespace
+	{
+		template<typename T>
+		void AppendValue(std::vector<u8>& out, const T& v)
+		{
+			const auto pos = out.size();
+			out.resize(pos + sizeof(T));
+			std::memcpy(out.data() + pos, &v, sizeof(T));
+		}
+		template<typename T>
+		bool ReadValue(const std::vector<u8>& data, size_t& pos, T& out)
+		{
+			if (data.size() < pos + sizeof(T))
+				return false;
+			std::memcpy(&out, data.data() + pos, sizeof(T));
+			pos += sizeof(T);
+			return true;
+		}
+
+		// 保存ファイル識別子.
+		constexpr u32 k_rhi_command_capture_file_magic = 0x5343524e;	// 'NRCS'.
+		constexpr u32 k_rhi_command_capture_file_version = 3;
+	}
+
+	// -------------------------------------------------------------------------------------------------------------------------------------------------
+	void RhiCommandCaptureResult::Reset()
+	{
+		is_valid = false;
+		begin_frame_index = 0;
+		num_frame = 0;
+		stream_array.clear();
+		queue_event_array.clear();
+		statistics = {};
+		num_object = 0;
+	}
+
+	void DumpRhiCommandCapture(const RhiCommandCaptureResult& result, std::ostream& os)
+	{
+		const auto& stat = result.statistics;
+		os << "RhiCommandCapture frame=" << result.begin_frame_index << " num_frame=" << result.num_frame
+			<< " stream=" << result.stream_array.size() << " object=" << result.num_object << "\n";
+		os << "  command=" << stat.NumTotalCommand() << " draw=" << stat.NumDraw() << " dispatch=" << stat.NumDispatch()
+			<< " barrier=" << stat.NumBarrier() << " copy=" << stat.NumCopy() << " pso=" << stat.NumPipelineStateChange()
+			<< " byte=" << stat.byte_size << "\n";
+
+		for (const auto& e : result.queue_event_array)
+		{
+			const char* queue_name = (0 == e.queue_type) ? "Graphics" : (2 == e.queue_type) ? "Copy" : "Compute";
+			switch (e.type)
+			{
+			case RhiCommandQueueEvent::EType::Execute:
+			{
+				os << queue_name << " Execute stream[" << e.stream_index << "]\n";
+				if (e.stream_index < result.stream_array.size())
+					DumpRhiCommandStream(*result.stream_array[e.stream_index], os);
+				break;
+			}
+			case RhiCommandQueueEvent::EType::Signal:
+				os << queue_name << " Signal fence#" << e.fence << "\n";
+				break;
+			case RhiCommandQueueEvent::EType::Wait:
+				os << queue_name << " Wait fence#" << e.fence << "\n";
+				break;
+			}
+		}
+	}
+
+	bool CompareRhiCommandCapture(const RhiCommandCaptureResult& a, const RhiCommandCaptureResult& b, u32& out_stream_index, RhiCommandStreamDiff& out_diff)
+	{
+		out_stream_index = 0;
+		out_diff = {};
+
+		const size_t num_stream = std::min(a.stream_array.size(), b.stream_array.size());
+		for (size_t i = 0; i < num_stream; ++i)
+		{
+			out_diff = CompareRhiCommandStream(*a.stream_array[i], *b.stream_array[i]);
+			if (!out_diff.is_equal)
+			{
+				out_stream_index = static_cast<u32>(i);
+				return false;
+			}
+		}
+		if (a.stream_array.size() != b.stream_array.size())
+		{
+			out_stream_index = static_cast<u32>(num_stream);
+			out_diff.is_equal = false;
+			return false;
+		}
+
+		// Queueの同期構造.
+		const bool is_same_event = (a.queue_event_array.size() == b.queue_event_array.size()) &&
+			std::equal(a.queue_event_array.begin(), a.queue_event_array.end(), b.queue_event_array.begin(),
+				[](const RhiCommandQueueEvent& ea, const RhiCommandQueueEvent& eb)
+				{
+					return ea.type == eb.type && ea.queue_type == eb.queue_type && ea.stream_index == eb.stream_index && ea.fence == eb.fence;
+				});
+		if (!is_same_event)
+		{
+			out_stream_index = static_cast<u32>(num_stream);
+			out_diff.is_equal = false;
+			return false;
+		}
+		return true;
+	}
+
+	bool SaveRhiCommandCapture(const RhiCommandCaptureResult& result, const char* file_path)
+	{
+		if (!result.is_valid)
+			return false;
+
+		std::vector<u8> buf;
+		AppendValue(buf, k_rhi_command_capture_file_magic);
+		AppendValue(buf, k_rhi_command_capture_file_version);
+		AppendValue(buf, result.begin_frame_index);
+		AppendValue(buf, result.num_frame);
+		AppendValue(buf, result.num_object);
+
+		AppendValue(buf, static_cast<u32>(result.stream_array.size()));
+		for (const auto& s : result.stream_array)
+		{
+			const auto& data = s->GetData();
+			AppendValue(buf, static_cast<u32>(data.size()));
+			buf.insert(buf.end(), data.begin(), data.end());
+		}
+
+		AppendValue(buf, static_cast<u32>(result.queue_event_array.size()));
+		for (const auto& e : result.queue_event_array)
+		{
+			AppendValue(buf, static_cast<u8>(e.type));
+			AppendValue(buf, e.queue_type);
+			AppendValue(buf, static_cast<u16>(0));
+			AppendValue(buf, e.stream_index);
+			AppendValue(buf, e.fence);
+		}
+
+		return file::WriteFileFromBuffer(file_path, buf);
+	}
+
+	bool LoadRhiCommandCapture(const char* file_path, RhiCommandCaptureResult& out_result)
+	{
+		out_result.Reset();
+
+		std::vector<u8> buf;
+		if (!file::ReadFileToBuffer(file_path, buf))
+			return false;
+
+		size_t pos = 0;
+		u32 magic = 0;
+		u32 version = 0;
+		if (!ReadValue(buf, pos, magic) || !ReadValue(buf, pos, version))
+			return false;
+		if (k_rhi_command_capture_file_magic != magic || k_rhi_command_capture_file_version != version)
+			return false;
+
+		u32 num_stream = 0;
+		if (!ReadValue(buf, pos, out_result.begin_frame_index) || !ReadValue(buf, pos, out_result.num_frame) || !ReadValue(buf, pos, out_result.num_object)
+			|| !ReadValue(buf, pos, num_stream))
+			return false;
+
+		for (u32 i = 0; i < num_stream; ++i)
+		{
+			u32 size = 0;
+			if (!ReadValue(buf, pos, size) || buf.size() < pos + size)
+			{
+				out_result.Reset();
+				return false;
+			}
+			auto stream = std::make_unique<RhiCommandStream>();
+			if (!stream->SetData(buf.data() + pos, size, true))
+			{
+				out_result.Reset();
+				return false;
+			}
+			pos += size;
+			out_result.statistics.Add(stream->GetStatistics());
+			out_result.stream_array.push_back(std::move(stream));
+		}
+
+		u32 num_event = 0;
+		if (!ReadValue(buf, pos, num_event))
+		{
+			out_result.Reset();
+			return false;
+		}
+		for (u32 i = 0; i < num_event; ++i)
+		{
+			u8 type = 0;
+			u16 reserved = 0;
+			RhiCommandQueueEvent e = {};
+			if (!ReadValue(buf, pos, type) || !ReadValue(buf, pos, e.queue_type) || !ReadValue(buf, pos, reserved)
+				|| !ReadValue(buf, pos, e.stream_index) || !ReadValue(buf, pos, e.fence))
+			{
+				out_result.Reset();
+				return false;
+			}
+			e.type = static_cast<RhiCommandQueueEvent::EType>(type);
+			out_result.queue_event_array.push_back(e);
+		}
+
+		out_result.is_valid = true;
+		return true;
+	}
+
+	// -------------------------------------------------------------------------------------------------------------------------------------------------
+	void RhiCommandCapture::RequestCapture(u32 num_frame)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		request_num_frame_ = std::max(1u, num_frame);
+	}
+
+	void RhiCommandCapture::ReadyToNewFrame(u64 frame_index)
+	{
+		if (is_capturing_.load())
+		{
+			assert(0 < remain_num_frame_);
+			--remain_num_frame_;
+			if (0 == remain_num_frame_)
+				FinishCapture();
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!is_capturing_.load() && 0 < request_num_frame_)
+		{
+			recording_result_.Reset();
+			recording_result_.begin_frame_index = frame_index;
+			recording_result_.num_frame = request_num_frame_;
+			remain_num_frame_ = request_num_frame_;
+			request_num_frame_ = 0;
+
+			recording_stream_array_.clear();
+			stream_submit_index_.clear();
+			is_capturing_.store(true);
+		}
+	}
+
+	RhiCommandStream* RhiCommandCapture::BeginCommandList()
+	{
+		if (!IsCapturing())
+			return nullptr;
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!IsCapturing())
+			return nullptr;
+
+		auto stream = std::make_unique<RhiCommandStream>();
+		auto* p_stream = stream.get();
+		recording_stream_array_.push_back(std::move(stream));
+		stream_submit_index_[p_stream] = ~0u;
+		return p_stream;
+	}
+
+	void RhiCommandCapture::OnExecute(u8 queue_type, const RhiCommandStream* p_stream)
+	{
+		if (!p_stream || !IsCapturing())
+			return;
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		// 今回のキャプチャで記録したストリームのみ.
+		auto it = stream_submit_index_.find(p_stream);
+		if (stream_submit_index_.end() == it)
+			return;
+
+		if (~0u == it->second)
+		{
+			it->second = static_cast<u32>(recording_result_.stream_array.size());
+			// 所有権は確定時に移す. ここでは順序確保のみ.
+			recording_result_.stream_array.push_back(nullptr);
+		}
+
+		RhiCommandQueueEvent e = {};
+		e.type = RhiCommandQueueEvent::EType::Execute;
+		e.queue_type = queue_type;
+		e.stream_index = it->second;
+		recording_result_.queue_event_array.push_back(e);
+	}
+
+	void RhiCommandCapture::OnSignal(u8 queue_type, const void* p_fence)
+	{
+		if (!IsCapturing())
+			return;
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		RhiCommandQueueEvent e = {};
+		e.type = RhiCommandQueueEvent::EType::Signal;
+		e.queue_type = queue_type;
+		e.fence = reinterpret_cast<u64>(p_fence);
+		recording_result_.queue_event_array.push_back(e);
+	}
+
+	void RhiCommandCapture::OnWait(u8 queue_type, const void* p_fence)
+	{
+		if (!IsCapturing())
+			return;
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		RhiCommandQueueEvent e = {};
+		e.type = RhiCommandQueueEvent::EType::Wait;
+		e.queue_type = queue_type;
+		e.fence = reinterpret_cast<u64>(p_fence);
+		recording_result_.queue_event_array.push_back(e);
+	}
+
+	void RhiCommandCapture::FinishCapture()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		is_capturing_.store(false);
+
+		// 前回確定時の未Submitストリームはここで解放.
+		retired_stream_array_.clear();
+
+		// Submit順に所有権を移す.
+		for (auto& stream : recording_stream_array_)
+		{
+			const u32 submit_index = stream_submit_index_[stream.get()];
+			if (~0u != submit_index)
+				recording_result_.stream_array[submit_index] = std::move(stream);
+			else
+				retired_stream_array_.push_back(std::move(stream));
+		}
+		recording_stream_array_.clear();
+		stream_submit_index_.clear();
+
+		// 参照オブジェクトとFenceをSubmit順の出現順で通し番号に置き換える.
+		std::unordered_map<u64, u32> object_table;
+		for (auto& stream : recording_result_.stream_array)
+		{
+			stream->RemapObject(object_table);
+			recording_result_.statistics.Add(stream->GetStatistics());
+		}
+		recording_result_.num_object = static_cast<u32>(object_table.size());
+
+		std::unordered_map<u64, u32> fence_table;
+		for (auto& e : recording_result_.queue_event_array)
+		{
+			if (RhiCommandQueueEvent::EType::Execute == e.type)
+				continue;
+			const auto it = fence_table.find(e.fence);
+			if (fence_table.end() != it)
+			{
+				e.fence = it->second;
+			}
+			else
+			{
+				const u32 id = static_cast<u32>(fence_table.size()) + 1;
+				fence_table[e.fence] = id;
+				e.fence = id;
+			}
+		}
+
+		recording_result_.is_valid = true;
+		latest_result_ = std::move(recording_result_);
+		recording_result_.Reset();
+		++num_captured_result_;
+	}
+
+	// -------------------------------------------------------------------------------------------------------------------------------------------------
+	void TestRhiCommandCapture()
+	{
+		bool is_ok = true;
+
+		// 記録対象オブジェクトの代わり. 2組を用意してアドレスの違いが比較に影響しないことを確認する.
+		int object_set[2][4] = {};
+		int fence_set[2][2] = {};
+		struct DrawParam
+		{
+			u32 vertex_count_per_instance;
+			u32 instance_count;
+			u32 start_vertex_location;
+			u32 start_instance_location;
+		};
+
+		const auto RecordGraphics = [](RhiCommandStream& stream, const int* p_object, u32 vertex_count)
+		{
+			stream.Write(ERhiCommandOp::Begin);
+			stream.WriteString(ERhiCommandOp::BeginMarker, "Pass");
+			stream.Write(ERhiCommandOp::ResourceBarrier, { &p_object[2] }, std::array<u32, 2>{ 1, 2 });
+			stream.Write(ERhiCommandOp::SetGraphicsPipelineState, { &p_object[0] });
+			stream.Write(ERhiCommandOp::SetVertexBuffers, { &p_object[1], nullptr });
+			stream.Write(ERhiCommandOp::DrawInstanced, {}, DrawParam{ vertex_count, 1, 0, 0 });
+			stream.Write(ERhiCommandOp::EndMarker);
+			stream.Write(ERhiCommandOp::End);
+		};
+		const auto RecordCompute = [](RhiCommandStream& stream, const int* p_object)
+		{
+			stream.Write(ERhiCommandOp::Begin);
+			stream.Write(ERhiCommandOp::SetComputePipelineState, { &p_object[3] });
+			stream.Write(ERhiCommandOp::Dispatch, {}, std::array<u32, 3>{ 8, 8, 1 });
+			stream.Write(ERhiCommandOp::UavBarrier, { &p_object[2] });
+			stream.Write(ERhiCommandOp::End);
+		};
+
+		// ストリームの記録と読み出し. パラメータは4byte境界にゼロ埋めされる.
+		{
+			RhiCommandStream stream;
+			RecordGraphics(stream, object_set[0], 3);
+			const u8 odd_param[5] = { 1, 2, 3, 4, 5 };
+			stream.Write(ERhiCommandOp::SetRootConstant, nullptr, 0, odd_param, sizeof(odd_param));
+
+			const auto& stat = stream.GetStatistics();
+			is_ok &= (9 == stream.NumCommand()) && (9 == stat.NumTotalCommand());
+			is_ok &= (1 == stat.NumDraw()) && (1 == stat.NumBarrier()) && (1 == stat.NumPipelineStateChange()) && (0 == stat.NumDispatch());
+			is_ok &= (stream.GetData().size() == stat.byte_size);
+
+			std::vector<RhiCommandStream::CommandView> command;
+			stream.ForEach([&](const RhiCommandStream::CommandView& v) { command.push_back(v); });
+			is_ok &= (9 == command.size());
+			if (9 == command.size())
+			{
+				is_ok &= (ERhiCommandOp::BeginMarker == command[1].op) && (0 == std::strcmp("Pass", reinterpret_cast<const char*>(command[1].p_param)));
+				is_ok &= (2 == command[4].num_object) && (reinterpret_cast<u64>(&object_set[0][1]) == command[4].GetObject(0)) && (0 == command[4].GetObject(1));
+				DrawParam draw = {};
+				std::memcpy(&draw, command[5].p_param, sizeof(draw));
+				is_ok &= (ERhiCommandOp::DrawInstanced == command[5].op) && (sizeof(draw) == command[5].param_size) && (3 == draw.vertex_count_per_instance);
+				is_ok &= (8 == command[8].param_size) && (5 == command[8].p_param[4]) && (0 == command[8].p_param[5]) && (0 == command[8].p_param[7]);
+			}
+
+			// シリアライズ済みデータからの復元. 途中で切れたデータは失敗する.
+			RhiCommandStream restored;
+			is_ok &= restored.SetData(stream.GetData().data(), stream.GetData().size(), false);
+			is_ok &= (stream.NumCommand() == restored.NumCommand()) && CompareRhiCommandStream(stream, restored).is_equal;
+			is_ok &= !restored.SetData(stream.GetData().data(), stream.GetData().size() - 2, false) && (0 == restored.NumCommand());
+		}
+
+		// 通し番号への置き換え後はアドレスが異なっても同じコマンド列であれば一致する.
+		{
+			RhiCommandStream stream_a;
+			RhiCommandStream stream_b;
+			RecordGraphics(stream_a, object_set[0], 3);
+			RecordGraphics(stream_b, object_set[1], 3);
+			is_ok &= !CompareRhiCommandStream(stream_a, stream_b).is_equal;
+
+			std::unordered_map<u64, u32> table_a;
+			std::unordered_map<u64, u32> table_b;
+			stream_a.RemapObject(table_a);
+			stream_b.RemapObject(table_b);
+			is_ok &= stream_a.IsRemapped() && (3 == table_a.size()) && CompareRhiCommandStream(stream_a, stream_b).is_equal;
+
+			// パラメータの差異はそのコマンドの位置で報告される.
+			RhiCommandStream stream_c;
+			RecordGraphics(stream_c, object_set[1], 6);
+			std::unordered_map<u64, u32> table_c;
+			stream_c.RemapObject(table_c);
+			const auto diff = CompareRhiCommandStream(stream_a, stream_c);
+			is_ok &= !diff.is_equal && (5 == diff.command_index) && (ERhiCommandOp::DrawInstanced == diff.op_a) && (ERhiCommandOp::DrawInstanced == diff.op_b);
+
+			// 一方が短い場合は短い側のコマンド数.
+			RhiCommandStream stream_d;
+			stream_d.Write(ERhiCommandOp::Begin);
+			const auto diff_short = CompareRhiCommandStream(stream_a, stream_d);
+			is_ok &= !diff_short.is_equal && (1 == diff_short.command_index) && (ERhiCommandOp::_Max == diff_short.op_b);
+		}
+
+		// 2フレームのキャプチャ. ストリームはSubmit順に並び, Submitされなかったものは含まない.
+		const auto CaptureFrame = [&](RhiCommandCapture& capture, int set_index)
+		{
+			const int* p_object = object_set[set_index];
+			const int* p_fence = fence_set[set_index];
+
+			capture.RequestCapture(2);
+			is_ok &= (nullptr == capture.BeginCommandList());
+			capture.ReadyToNewFrame(10);
+			is_ok &= capture.IsCapturing();
+
+			// フレーム0. Computeを先にSubmitし, Graphicsはその完了を待つ.
+			RhiCommandStream* p_graphics = capture.BeginCommandList();
+			RhiCommandStream* p_compute = capture.BeginCommandList();
+			RhiCommandStream* p_unused = capture.BeginCommandList();
+			is_ok &= p_graphics && p_compute && p_unused;
+			if (!p_graphics || !p_compute || !p_unused)
+				return;
+			RecordGraphics(*p_graphics, p_object, 3);
+			RecordCompute(*p_compute, p_object);
+			p_unused->Write(ERhiCommandOp::Begin);
+
+			capture.OnWait(1, &p_fence[0]);
+			capture.OnExecute(1, p_compute);
+			capture.OnSignal(1, &p_fence[1]);
+			capture.OnWait(0, &p_fence[1]);
+			capture.OnExecute(0, p_graphics);
+			capture.OnSignal(0, &p_fence[0]);
+
+			capture.ReadyToNewFrame(11);
+			is_ok &= capture.IsCapturing();
+
+			// フレーム1.
+			RhiCommandStream* p_graphics1 = capture.BeginCommandList();
+			is_ok &= (nullptr != p_graphics1);
+			if (!p_graphics1)
+				return;
+			RecordGraphics(*p_graphics1, p_object, 4);
+			capture.OnExecute(0, p_graphics1);
+
+			capture.ReadyToNewFrame(12);
+			is_ok &= !capture.IsCapturing() && (nullptr == capture.BeginCommandList());
+		};
+
+		RhiCommandCapture capture_a;
+		RhiCommandCapture capture_b;
+		CaptureFrame(capture_a, 0);
+		CaptureFrame(capture_b, 1);
+		{
+			const auto& result = capture_a.GetLatestResult();
+			is_ok &= result.is_valid && (1 == capture_a.NumCapturedResult()) && (10 == result.begin_frame_index) && (2 == result.num_frame);
+			is_ok &= (3 == result.stream_array.size()) && (7 == result.queue_event_array.size()) && (4 == result.num_object);
+			if (3 == result.stream_array.size() && 7 == result.queue_event_array.size())
+			{
+				// Submit順. Compute, Graphics, 次フレームのGraphics.
+				is_ok &= (1 == result.stream_array[0]->GetStatistics().NumDispatch()) && (1 == result.stream_array[1]->GetStatistics().NumDraw());
+				is_ok &= (2 == result.statistics.NumDraw()) && (1 == result.statistics.NumDispatch()) && (3 == result.statistics.NumBarrier());
+
+				// Fenceは出現順の通し番号.
+				const auto& ev = result.queue_event_array;
+				is_ok &= (RhiCommandQueueEvent::EType::Wait == ev[0].type) && (1 == ev[0].queue_type) && (1 == ev[0].fence);
+				is_ok &= (RhiCommandQueueEvent::EType::Execute == ev[1].type) && (0 == ev[1].stream_index);
+				is_ok &= (RhiCommandQueueEvent::EType::Signal == ev[2].type) && (2 == ev[2].fence) && (2 == ev[3].fence) && (1 == ev[5].fence);
+				is_ok &= (RhiCommandQueueEvent::EType::Execute == ev[6].type) && (0 == ev[6].queue_type) && (2 == ev[6].stream_index);
+			}
+
+			// 別のオブジェクトで同じ構造のキャプチャとは一致する.
+			u32 diff_stream = 0;
+			RhiCommandStreamDiff diff = {};
+			is_ok &= CompareRhiCommandCapture(result, capture_b.GetLatestResult(), diff_stream, diff) && diff.is_equal;
+
+			// 保存と読み込み.
+			const char* k_file_path = "ngl_test_rhi_command_capture.nrcs";
+			RhiCommandCaptureResult loaded;
+			is_ok &= SaveRhiCommandCapture(result, k_file_path) && LoadRhiCommandCapture(k_file_path, loaded);
+			is_ok &= loaded.is_valid && (result.begin_frame_index == loaded.begin_frame_index) && (result.num_object == loaded.num_object);
+			is_ok &= (result.statistics.NumTotalCommand() == loaded.statistics.NumTotalCommand()) && CompareRhiCommandCapture(result, loaded, diff_stream, diff);
+			std::remove(k_file_path);
+		}
+
+		// Queueの同期構造の差異も検出する.
+		{
+			RhiCommandCapture capture_c;
+			capture_c.RequestCapture(1);
+			capture_c.ReadyToNewFrame(20);
+			RhiCommandStream* p_compute = capture_c.BeginCommandList();
+			RhiCommandStream* p_graphics = capture_c.BeginCommandList();
+			if (p_compute && p_graphics)
+			{
+				RecordCompute(*p_compute, object_set[0]);
+				RecordGraphics(*p_graphics, object_set[0], 3);
+				capture_c.OnExecute(1, p_compute);
+				capture_c.OnExecute(0, p_graphics);
+			}
+			capture_c.ReadyToNewFrame(21);
+			RhiCommandCaptureResult frame0_only;
+			frame0_only.is_valid = true;
+			for (u32 i = 0; i < 2 && i < capture_a.GetLatestResult().stream_array.size(); ++i)
+			{
+				const auto& src = *capture_a.GetLatestResult().stream_array[i];
+				auto stream = std::make_unique<RhiCommandStream>();
+				stream->SetData(src.GetData().data(), src.GetData().size(), true);
+				frame0_only.stream_array.push_back(std::move(stream));
+			}
+			u32 diff_stream = 0;
+			RhiCommandStreamDiff diff = {};
+			// ストリームは一致し, Wait/Signalの有無のみ異なる.
+			is_ok &= capture_c.GetLatestResult().is_valid && (2 == capture_c.GetLatestResult().stream_array.size());
+			is_ok &= !CompareRhiCommandCapture(frame0_only, capture_c.GetLatestResult(), diff_stream, diff) && (2 == diff_stream);
+			frame0_only.queue_event_array = capture_c.GetLatestResult().queue_event_array;
+			is_ok &= CompareRhiCommandCapture(frame0_only, capture_c.GetLatestResult(), diff_stream, diff);
+		}
+
+		std::cout << "[TestRhiCommandCapture]";
+		std::cout << (is_ok ? " : OK" : " : FAILED") << std::endl;
+		assert(is_ok);
+	}
+}
+}
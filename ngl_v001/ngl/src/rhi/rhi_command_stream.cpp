@@ -0,0 +1,332 @@
+﻿
+#include "rhi/rhi_command_stream.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iomanip>
+
+namespace ngl
+{
+namespace rhi
+{
+	namespace
+	{
+		constexpr const char* k_rhi_command_op_name[] =
+		{
+			"Begin",
+			"End",
+
+			"SetGraphicsPipelineState",
+			"SetComputePipelineState",
+			"SetGraphicsDescriptorSet",
+			"SetComputeDescriptorSet",
+			"SetDescriptorTable",
+			"SetRootConstant",
+			"SetRenderTargets",
+			"SetViewports",
+			"SetScissor",
+			"SetPrimitiveTopology",
+			"SetVertexBuffers",
+			"SetIndexBuffer",
+
+			"DrawInstanced",
+			"DrawIndexedInstanced",
+			"DrawIndirect",
+			"Dispatch",
+			"DispatchIndirect",
+			"DispatchRays",
+			"BuildAccelerationStructure",
+			"CopyAccelerationStructure",
+
+			"CopyResource",
+			"CopyBufferRegion",
+			"CopyTextureRegion",
+
+			"ClearRenderTarget",
+			"ClearDepthTarget",
+
+			"ResourceBarrier",
+			"UavBarrier",
+
+			"BeginMarker",
+			"EndMarker",
+		};
+		static_assert(std::size(k_rhi_command_op_name) == k_rhi_command_op_count);
+
+		constexpr u32 AlignParamSize(u32 v)
+		{
+			return (v + 3u) & ~3u;
+		}
+	}
+
+	const char* GetRhiCommandOpName(ERhiCommandOp op)
+	{
+		const u32 index = static_cast<u32>(op);
+		return (index < k_rhi_command_op_count) ? k_rhi_command_op_name[index] : "Unknown";
+	}
+
+	// -------------------------------------------------------------------------------------------------------------------------------------------------
+	u32 RhiCommandStreamStatistics::NumTotalCommand() const
+	{
+		u32 sum = 0;
+		for (auto v : num_command)
+			sum += v;
+		return sum;
+	}
+	u32 RhiCommandStreamStatistics::NumDraw() const
+	{
+		return NumCommand(ERhiCommandOp::DrawInstanced) + NumCommand(ERhiCommandOp::DrawIndexedInstanced) + NumCommand(ERhiCommandOp::DrawIndirect);
+	}
+	u32 RhiCommandStreamStatistics::NumDispatch() const
+	{
+		return NumCommand(ERhiCommandOp::Dispatch) + NumCommand(ERhiCommandOp::DispatchIndirect) + NumCommand(ERhiCommandOp::DispatchRays);
+	}
+	u32 RhiCommandStreamStatistics::NumBarrier() const
+	{
+		return NumCommand(ERhiCommandOp::ResourceBarrier) + NumCommand(ERhiCommandOp::UavBarrier);
+	}
+	u32 RhiCommandStreamStatistics::NumCopy() const
+	{
+		return NumCommand(ERhiCommandOp::CopyResource) + NumCommand(ERhiCommandOp::CopyBufferRegion) + NumCommand(ERhiCommandOp::CopyTextureRegion);
+	}
+	u32 RhiCommandStreamStatistics::NumPipelineStateChange() const
+	{
+		return NumCommand(ERhiCommandOp::SetGraphicsPipelineState) + NumCommand(ERhiCommandOp::SetComputePipelineState);
+	}
+	void RhiCommandStreamStatistics::Add(const RhiCommandStreamStatistics& v)
+	{
+		for (u32 i = 0; i < k_rhi_command_op_count; ++i)
+			num_command[i] += v.num_command[i];
+		byte_size += v.byte_size;
+	}
+
+	// -------------------------------------------------------------------------------------------------------------------------------------------------
+	u64 RhiCommandStream::CommandView::GetObject(u32 index) const
+	{
+		assert(index < num_object);
+		u64 v = 0;
+		std::memcpy(&v, p_object + sizeof(u64) * index, sizeof(u64));
+		return v;
+	}
+
+	void RhiCommandStream::Reset()
+	{
+		data_.clear();
+		num_command_ = 0;
+		statistics_ = {};
+		is_remapped_ = false;
+	}
+
+	void RhiCommandStream::Write(ERhiCommandOp op, const void* const* pp_object, u32 num_object, const void* p_param, u32 param_size)
+	{
+		assert(num_object <= 0xff);
+		const u32 aligned_param_size = AlignParamSize(param_size);
+		assert(aligned_param_size <= k_max_param_size);
+
+		const size_t pos = data_.size();
+		data_.resize(pos + sizeof(CommandHeader) + sizeof(u64) * num_object + aligned_param_size);
+		u8* p = data_.data() + pos;
+
+		CommandHeader header = {};
+		header.op = static_cast<u8>(op);
+		header.num_object = static_cast<u8>(num_object);
+		header.param_size = static_cast<u16>(aligned_param_size);
+		std::memcpy(p, &header, sizeof(header));
+		p += sizeof(header);
+
+		for (u32 i = 0; i < num_object; ++i)
+		{
+			const u64 v = reinterpret_cast<u64>(pp_object[i]);
+			std::memcpy(p, &v, sizeof(v));
+			p += sizeof(v);
+		}
+		if (0 < param_size)
+		{
+			std::memcpy(p, p_param, param_size);
+			// パディングはゼロ埋めしてバイト比較を安定させる.
+			std::memset(p + param_size, 0, aligned_param_size - param_size);
+		}
+
+		++num_command_;
+		++statistics_.num_command[static_cast<u32>(op)];
+		statistics_.byte_size = data_.size();
+	}
+
+	void RhiCommandStream::WriteString(ERhiCommandOp op, const char* str)
+	{
+		const size_t len = (str) ? std::min<size_t>(std::strlen(str), k_max_param_size - 1) : 0;
+		// 終端込み.
+		std::vector<char> buf(len + 1, 0);
+		if (0 < len)
+			std::memcpy(buf.data(), str, len);
+		Write(op, nullptr, 0, buf.data(), static_cast<u32>(buf.size()));
+	}
+
+	size_t RhiCommandStream::ReadCommand(size_t pos, CommandView& out_view) const
+	{
+		CommandHeader header = {};
+		std::memcpy(&header, data_.data() + pos, sizeof(header));
+		pos += sizeof(header);
+
+		out_view.op = static_cast<ERhiCommandOp>(header.op);
+		out_view.num_object = header.num_object;
+		out_view.p_object = data_.data() + pos;
+		pos += sizeof(u64) * header.num_object;
+		out_view.param_size = header.param_size;
+		out_view.p_param = data_.data() + pos;
+		pos += header.param_size;
+		return pos;
+	}
+
+	void RhiCommandStream::RemapObject(std::unordered_map<u64, u32>& table)
+	{
+		if (is_remapped_)
+			return;
+
+		size_t pos = 0;
+		while (pos + sizeof(CommandHeader) <= data_.size())
+		{
+			CommandHeader header = {};
+			std::memcpy(&header, data_.data() + pos, sizeof(header));
+			pos += sizeof(header);
+
+			for (u32 i = 0; i < header.num_object; ++i)
+			{
+				u64 v = 0;
+				std::memcpy(&v, data_.data() + pos, sizeof(v));
+				// nullptrは0のまま. それ以外は1からの出現順.
+				if (0 != v)
+				{
+					const auto it = table.find(v);
+					if (table.end() != it)
+					{
+						v = it->second;
+					}
+					else
+					{
+						const u32 id = static_cast<u32>(table.size()) + 1;
+						table[v] = id;
+						v = id;
+					}
+				}
+				std::memcpy(data_.data() + pos, &v, sizeof(v));
+				pos += sizeof(v);
+			}
+			pos += header.param_size;
+		}
+		is_remapped_ = true;
+	}
+
+	bool RhiCommandStream::SetData(const u8* p_data, size_t size, bool is_remapped)
+	{
+		Reset();
+		data_.assign(p_data, p_data + size);
+
+		// 検証と統計の再計算.
+		size_t pos = 0;
+		while (pos < data_.size())
+		{
+			if (data_.size() < pos + sizeof(CommandHeader))
+			{
+				Reset();
+				return false;
+			}
+			CommandHeader header = {};
+			std::memcpy(&header, data_.data() + pos, sizeof(header));
+			pos += sizeof(header) + sizeof(u64) * header.num_object + header.param_size;
+			if (data_.size() < pos || k_rhi_command_op_count <= header.op)
+			{
+				Reset();
+				return false;
+			}
+			++num_command_;
+			++statistics_.num_command[header.op];
+		}
+		statistics_.byte_size = data_.size();
+		is_remapped_ = is_remapped;
+		return true;
+	}
+
+	void DumpRhiCommandStream(const RhiCommandStream& stream, std::ostream& os)
+	{
+		u32 index = 0;
+		stream.ForEach([&](const RhiCommandStream::CommandView& cmd)
+			{
+				os << "  [" << std::setw(5) << index << "] " << GetRhiCommandOpName(cmd.op);
+				if (0 < cmd.num_object)
+				{
+					os << " obj(";
+					for (u32 i = 0; i < cmd.num_object; ++i)
+					{
+						if (0 < i)
+							os << ",";
+						if (stream.IsRemapped())
+							os << "#" << cmd.GetObject(i);
+						else
+							os << "0x" << std::hex << cmd.GetObject(i) << std::dec;
+					}
+					os << ")";
+				}
+				if (ERhiCommandOp::BeginMarker == cmd.op)
+				{
+					os << " \"" << reinterpret_cast<const char*>(cmd.p_param) << "\"";
+				}
+				else if (0 < cmd.param_size)
+				{
+					// パラメータは4byte単位で出力.
+					os << " param(";
+					for (u32 i = 0; i < cmd.param_size / 4; ++i)
+					{
+						u32 v = 0;
+						std::memcpy(&v, cmd.p_param + i * 4, sizeof(v));
+						if (0 < i)
+							os << ",";
+						os << v;
+					}
+					os << ")";
+				}
+				os << "\n";
+				++index;
+			});
+	}
+
+	RhiCommandStreamDiff CompareRhiCommandStream(const RhiCommandStream& a, const RhiCommandStream& b)
+	{
+		RhiCommandStreamDiff diff = {};
+		const auto& data_a = a.GetData();
+		const auto& data_b = b.GetData();
+		if (data_a == data_b)
+			return diff;
+
+		diff.is_equal = false;
+
+		// コマンド単位で先頭から比較.
+		std::vector<RhiCommandStream::CommandView> cmd_a;
+		std::vector<RhiCommandStream::CommandView> cmd_b;
+		a.ForEach([&](const RhiCommandStream::CommandView& v) { cmd_a.push_back(v); });
+		b.ForEach([&](const RhiCommandStream::CommandView& v) { cmd_b.push_back(v); });
+
+		const size_t num = std::min(cmd_a.size(), cmd_b.size());
+		for (size_t i = 0; i < num; ++i)
+		{
+			const auto& va = cmd_a[i];
+			const auto& vb = cmd_b[i];
+			const bool is_same = (va.op == vb.op) && (va.num_object == vb.num_object) && (va.param_size == vb.param_size)
+				&& (0 == std::memcmp(va.p_object, vb.p_object, sizeof(u64) * va.num_object))
+				&& (0 == std::memcmp(va.p_param, vb.p_param, va.param_size));
+			if (!is_same)
+			{
+				diff.command_index = static_cast<u32>(i);
+				diff.op_a = va.op;
+				diff.op_b = vb.op;
+				return diff;
+			}
+		}
+		diff.command_index = static_cast<u32>(num);
+		diff.op_a = (num < cmd_a.size()) ? cmd_a[num].op : ERhiCommandOp::_Max;
+		diff.op_b = (num < cmd_b.size()) ? cmd_b[num].op : ERhiCommandOp::_Max;
+		return diff;
+	}
+}
+}
@@ -2,6 +2,12 @@
 #include "rhi/rhi_object_garbage_collect.h"
 
 #include "rhi/d3d12/device.d3d12.h"
+#include "util/time/profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
 
 namespace ngl
 {
@@ -41,45 +47,289 @@ namespace rhi
 		Finalize();
 	}
 
-	bool GabageCollector::Initialize()
+	bool GabageCollector::Initialize(const Desc& desc)
 	{
+		desc_ = desc;
+
+		if (desc_.enable_background_destroy && !background_thread_.joinable())
+		{
+			background_terminate_ = false;
+			background_thread_ = std::thread([this]() { BackgroundThreadFunc(); });
+		}
 		return true;
 	}
 	void GabageCollector::Finalize()
 	{
-		const int max_frame = (int)frame_stack_.size();
-		for (int i = 0; i < max_frame; ++i)
+		// バックグラウンド破棄の停止.
+		if (background_thread_.joinable())
+		{
+			WaitBackgroundDestroy();
+			{
+				std::unique_lock<std::mutex> lock(background_mutex_);
+				background_terminate_ = true;
+				background_cv_.notify_all();
+			}
+			background_thread_.join();
+		}
+
+		// 残りをすべて破棄. 破棄したオブジェクトが保持していた参照から更にEnqueueされる場合があるため空になるまで繰り返す.
+		for (const auto& e : pending_queue_)
+		{
+			delete e.p_obj;
+		}
+		pending_queue_.clear();
+		while (0 < incoming_stack_.PopAll([](IRhiObject* e) { delete e; }))
 		{
-			ReadyToNewFrame();
-			Execute();
 		}
 	}
 
+	void GabageCollector::SetDestroyBudget(u32 max_destroy_count_per_frame, u32 max_destroy_micro_sec_per_frame)
+	{
+		desc_.max_destroy_count_per_frame = max_destroy_count_per_frame;
+		desc_.max_destroy_micro_sec_per_frame = max_destroy_micro_sec_per_frame;
+	}
+
 	// フレーム開始同期処理.
-	void GabageCollector::ReadyToNewFrame()
+	void GabageCollector::ReadyToNewFrame(u64 retire_frame_index)
 	{
-		const int max_frame = (int)frame_stack_.size();
-		const int index = (flip_index_.load() + 1) % max_frame;
-		flip_index_.store(index);
+		// 受付済みのオブジェクトに破棄可能となるフレーム番号を付与して破棄待ちへ.
+		// 付与するフレーム番号は単調増加のため pending_queue_ は常にソート済み.
+		assert(pending_queue_.empty() || pending_queue_.back().retire_frame_index <= retire_frame_index);
+		statistics_.num_enqueued = incoming_stack_.PopAll([this, retire_frame_index](IRhiObject* e)
+			{
+				pending_queue_.push_back({ e, retire_frame_index });
+			});
 	}
 
 	// 破棄の実行.
-	void GabageCollector::Execute()
+	void GabageCollector::Execute(u64 completed_frame_index)
 	{
-		const int max_frame = (int)frame_stack_.size();
+		NGL_PROFILE_SCOPE("GabageCollector::Execute");
+
+		statistics_.num_destroyed = 0;
+
+		const bool is_background = background_thread_.joinable();
+		if (is_background)
+		{
+			// 前回の依頼が完了していなければ今回は持ち越し.
+			std::unique_lock<std::mutex> lock(background_mutex_);
+			if (background_request_)
+			{
+				statistics_.num_pending = static_cast<u32>(pending_queue_.size());
+				statistics_.num_deferred = 0;
+				return;
+			}
+		}
 
-		const int oldest_index = (flip_index_.load() + 1) % max_frame;
+		// GPU完了済みの数.
+		const auto ready_end = std::upper_bound(pending_queue_.begin(), pending_queue_.end(), completed_frame_index,
+			[](u64 v, const PendingObject& e) { return v < e.retire_frame_index; });
+		const u32 num_ready = static_cast<u32>(std::distance(pending_queue_.begin(), ready_end));
+		const u32 max_count = (0 < desc_.max_destroy_count_per_frame) ? std::min(num_ready, desc_.max_destroy_count_per_frame) : num_ready;
 
-		while (auto* e = frame_stack_[oldest_index].Pop())
+		u32 num_destroy = 0;
+		if (is_background)
 		{
-			delete e;
+			destroy_array_.clear();
+			for (; num_destroy < max_count; ++num_destroy)
+			{
+				destroy_array_.push_back(pending_queue_.front().p_obj);
+				pending_queue_.pop_front();
+			}
+			if (!destroy_array_.empty())
+			{
+				std::unique_lock<std::mutex> lock(background_mutex_);
+				std::swap(destroy_array_, background_destroy_array_);
+				background_request_ = true;
+				background_cv_.notify_all();
+			}
 		}
+		else
+		{
+			const bool is_time_limit = (0 < desc_.max_destroy_micro_sec_per_frame);
+			const auto begin_time = std::chrono::steady_clock::now();
+			const auto time_limit = std::chrono::microseconds(desc_.max_destroy_micro_sec_per_frame);
+			// 時刻取得の頻度.
+			constexpr u32 k_time_check_interval = 32;
+			while (num_destroy < max_count)
+			{
+				delete pending_queue_.front().p_obj;
+				pending_queue_.pop_front();
+				++num_destroy;
+
+				if (is_time_limit && (0 == (num_destroy % k_time_check_interval)))
+				{
+					if (time_limit <= std::chrono::steady_clock::now() - begin_time)
+						break;
+				}
+			}
+		}
+
+		statistics_.num_destroyed = num_destroy;
+		statistics_.num_pending = static_cast<u32>(pending_queue_.size());
+		statistics_.num_deferred = num_ready - num_destroy;
 	}
 
 	// 新規破棄オブジェクトのPush.
 	void GabageCollector::Enqueue(IRhiObject* p_obj)
 	{
-		frame_stack_[flip_index_.load()].Push(p_obj);
+		incoming_stack_.Push(p_obj);
+	}
+
+	void GabageCollector::WaitBackgroundDestroy()
+	{
+		std::unique_lock<std::mutex> lock(background_mutex_);
+		background_cv_.wait(lock, [this]() { return !background_request_; });
+	}
+
+	void GabageCollector::BackgroundThreadFunc()
+	{
+		NGL_PROFILE_THREAD_NAME("RhiGabageCollectThread");
+
+		std::vector<IRhiObject*> work_array;
+		std::unique_lock<std::mutex> lock(background_mutex_);
+		while (true)
+		{
+			background_cv_.wait(lock, [this]() { return background_request_ || background_terminate_; });
+
+			if (background_request_)
+			{
+				// 破棄中はロックを解放してEnqueue側の依頼判定をブロックしない.
+				std::swap(work_array, background_destroy_array_);
+				lock.unlock();
+				{
+					NGL_PROFILE_SCOPE("GabageCollector::BackgroundDestroy");
+					for (auto* e : work_array)
+					{
+						delete e;
+					}
+					work_array.clear();
+				}
+				lock.lock();
+				background_request_ = false;
+				background_cv_.notify_all();
+				continue;
+			}
+
+			if (background_terminate_)
+				break;
+		}
+	}
+
+
+	// -------------------------------------------------------------------------------------------------------------------------------------------------
+	namespace
+	{
+		struct TestGabageCollectorState
+		{
+			std::atomic_uint64_t	current_frame_index = 0;
+			std::atomic_uint64_t	completed_frame_index = 0;
+			std::atomic_uint32_t	num_destroyed = 0;
+			std::atomic_uint32_t	num_early_destroyed = 0;
+		};
+
+		// 最後に参照されたフレーム番号を保持し, 破棄時点でGPU完了済みかを検証するテスト用オブジェクト.
+		class TestGabageCollectorObject : public IRhiObject
+		{
+		public:
+			TestGabageCollectorObject(TestGabageCollectorState* p_state, u64 last_use_frame_index)
+				: p_state_(p_state), last_use_frame_index_(last_use_frame_index)
+			{
+			}
+			~TestGabageCollectorObject()
+			{
+				if (p_state_->completed_frame_index.load() < last_use_frame_index_)
+					++p_state_->num_early_destroyed;
+				++p_state_->num_destroyed;
+			}
+			IDevice* GetParentDeviceInreface() override { return nullptr; }
+			const IDevice* GetParentDeviceInreface() const override { return nullptr; }
+
+		private:
+			TestGabageCollectorState*	p_state_ = nullptr;
+			u64							last_use_frame_index_ = 0;
+		};
+
+		bool TestGabageCollectorImpl(bool enable_background_destroy)
+		{
+			constexpr u32 k_num_producer = 8;
+			constexpr u32 k_num_object_per_producer = 20000;
+			constexpr u32 k_num_total_object = k_num_producer * k_num_object_per_producer;
+			constexpr u32 k_budget = 1000;
+			// GPUの遅延フレーム数.
+			constexpr u64 k_gpu_latency = 2;
+
+			TestGabageCollectorState state = {};
+			GabageCollector gc;
+			{
+				GabageCollector::Desc desc = {};
+				desc.max_destroy_count_per_frame = k_budget;
+				desc.enable_background_destroy = enable_background_destroy;
+				gc.Initialize(desc);
+			}
+
+			std::atomic_uint32_t num_finished_producer = 0;
+			std::vector<std::thread> producer_array;
+			for (u32 ti = 0; ti < k_num_producer; ++ti)
+			{
+				producer_array.emplace_back([&gc, &state, &num_finished_producer]()
+					{
+						for (u32 i = 0; i < k_num_object_per_producer; ++i)
+						{
+							// Enqueue時点のフレームで最後に参照されたものとする.
+							gc.Enqueue(new TestGabageCollectorObject(&state, state.current_frame_index.load()));
+							if (0 == (i % 512))
+								std::this_thread::yield();
+						}
+						++num_finished_producer;
+					});
+			}
+
+			// フレームの模擬. Device::ReadyToNewFrame と同様に受付を締めてからフレーム番号を進める.
+			bool is_budget_ok = true;
+			u32 num_frame = 0;
+			while (num_finished_producer.load() < k_num_producer || state.num_destroyed.load() < k_num_total_object)
+			{
+				const u64 retire_frame_index = state.current_frame_index.load();
+				gc.ReadyToNewFrame(retire_frame_index);
+				++state.current_frame_index;
+
+				const u64 current = state.current_frame_index.load();
+				state.completed_frame_index = (k_gpu_latency <= current) ? (current - k_gpu_latency) : 0;
+				gc.Execute(state.completed_frame_index.load());
+
+				if (k_budget < gc.GetStatistics().num_destroyed)
+					is_budget_ok = false;
+
+				++num_frame;
+				if (num_frame > 100000)
+					break;
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			}
+
+			for (auto& t : producer_array)
+				t.join();
+
+			// GPUの完了を模擬してから終了.
+			state.completed_frame_index = state.current_frame_index.load();
+			gc.Finalize();
+
+			const bool is_ok = (k_num_total_object == state.num_destroyed.load()) && (0 == state.num_early_destroyed.load()) && is_budget_ok;
+			std::cout << "[TestGabageCollector] background=" << enable_background_destroy
+				<< " frame=" << num_frame
+				<< " destroyed=" << state.num_destroyed.load() << "/" << k_num_total_object
+				<< " early_destroyed=" << state.num_early_destroyed.load()
+				<< " budget=" << (is_budget_ok ? "ok" : "over")
+				<< (is_ok ? " : OK" : " : FAILED") << std::endl;
+			return is_ok;
+		}
+	}
+
+	void TestGabageCollector()
+	{
+		const bool result0 = TestGabageCollectorImpl(false);
+		const bool result1 = TestGabageCollectorImpl(true);
+		assert(result0 && result1);
 	}
 }
 }
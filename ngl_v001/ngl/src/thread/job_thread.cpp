@@ -3,6 +3,8 @@
 
 #include <iostream>
 
+#include "util/time/profiler.h"
+
 
 namespace ngl
 {
@@ -35,11 +37,12 @@ namespace thread
 
     JobSystemWorker::JobSystemWorker()
     {
-        thread_instance_ = std::thread([&](){Execute();});
     }
     void JobSystemWorker::Init(JobSystem* p_system)
     {
         p_system_ = p_system;
+        // p_system_ 設定後に起動する. コンストラクタで起動すると未設定の p_system_ を参照する場合がある.
+        thread_instance_ = std::thread([&](){Execute();});
     }
     JobSystemWorker::~JobSystemWorker()
     {
@@ -69,6 +72,7 @@ namespace thread
     }
     void JobSystemWorker::Execute()
     {
+        NGL_PROFILE_THREAD_NAME("JobSystemWorker");
         while (true)
         {
             // Job実行リクエストか終了通知が来るまで待機.
@@ -96,7 +100,10 @@ namespace thread
             // Job実行.
             if(job_enable_)
             {
-                func_();
+                {
+                    NGL_PROFILE_SCOPE("JobSystem::Job");
+                    func_();
+                }
                 
                 std::unique_lock<std::mutex> lock(p_system_->condition_mutex_);
                 job_enable_ = false;
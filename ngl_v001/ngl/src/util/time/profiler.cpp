@@ -0,0 +1,400 @@
+﻿
+#include "util/time/profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+
+namespace ngl
+{
+namespace time
+{
+	// 呼び出しスレッドのバッファ. 初回のZoneで登録し, スレッド終了時に返却する.
+	struct ProfileThreadBufferHolder
+	{
+		~ProfileThreadBufferHolder()
+		{
+			if (p_buffer)
+				Profiler::Instance().UnregisterThread(p_buffer);
+		}
+		ProfileThreadBuffer* p_buffer = nullptr;
+		// 登録前に設定されたスレッド名.
+		std::string pending_name = {};
+	};
+
+	namespace
+	{
+		thread_local ProfileThreadBufferHolder t_thread_buffer = {};
+
+		u32 RoundUpPow2(u32 v)
+		{
+			u32 n = 1;
+			while (n < v)
+				n <<= 1;
+			return n;
+		}
+
+		void AppendJsonString(std::string& out, const char* str)
+		{
+			out += '"';
+			for (const char* p = str; *p; ++p)
+			{
+				const char c = *p;
+				if ('"' == c || '\\' == c)
+				{
+					out += '\\';
+					out += c;
+				}
+				else if (0x20 > static_cast<unsigned char>(c))
+				{
+					char buf[8];
+					std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+					out += buf;
+				}
+				else
+				{
+					out += c;
+				}
+			}
+			out += '"';
+		}
+		// [ns] -> [us]. Chrome Traceのtsとdurの単位.
+		void AppendMicroSec(std::string& out, u64 ns)
+		{
+			char buf[32];
+			std::snprintf(buf, sizeof(buf), "%llu.%03llu", static_cast<unsigned long long>(ns / 1000), static_cast<unsigned long long>(ns % 1000));
+			out += buf;
+		}
+	}
+
+	u64 GetProfilerTick()
+	{
+		return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+
+	ProfileThreadBuffer::ProfileThreadBuffer(u32 thread_index, u32 capacity)
+	{
+		thread_index_ = thread_index;
+		event_array_.resize(RoundUpPow2(std::max(capacity, 16u)));
+		mask_ = static_cast<u32>(event_array_.size()) - 1;
+	}
+
+	bool ProfileThreadBuffer::Push(const ProfileEvent& e, u32 reserve)
+	{
+		const u32 head = head_.load(std::memory_order_relaxed);
+		const u32 tail = tail_.load(std::memory_order_acquire);
+		const u32 num_free = static_cast<u32>(event_array_.size()) - (head - tail);
+		if (num_free < 1 + reserve)
+			return false;
+
+		event_array_[head & mask_] = e;
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	void ProfileThreadBuffer::Begin(const char* name)
+	{
+		// 破棄中のZoneの内側は全て破棄してEndとの対応を保つ.
+		//	記録する場合は自身と外側のZoneの終了イベント分の空きを確保する.
+		if (0 < skip_depth_ || !Push({ name, GetProfilerTick() }, open_depth_ + 1))
+		{
+			++skip_depth_;
+			dropped_count_.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		++open_depth_;
+	}
+	void ProfileThreadBuffer::End()
+	{
+		if (0 < skip_depth_)
+		{
+			--skip_depth_;
+			dropped_count_.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		if (0 == open_depth_)
+			return;
+
+		const bool result = Push({ nullptr, GetProfilerTick() | k_profile_event_end_bit }, 0);
+		assert(result);
+		(void)result;
+		--open_depth_;
+	}
+
+
+	Profiler::Profiler()
+	{
+	}
+	Profiler::~Profiler()
+	{
+	}
+
+	void Profiler::Initialize(const Desc& desc)
+	{
+		desc_ = desc;
+		desc_.statistics_frame_count = std::max(desc_.statistics_frame_count, 1u);
+		zone_accumulate_.clear();
+	}
+
+	ProfileThreadBuffer* Profiler::GetThreadBuffer()
+	{
+		if (!t_thread_buffer.p_buffer)
+			t_thread_buffer.p_buffer = RegisterThread();
+		return t_thread_buffer.p_buffer;
+	}
+	ProfileThreadBuffer* Profiler::RegisterThread()
+	{
+		std::lock_guard<std::mutex> lock(thread_mutex_);
+		// 終了したスレッドのバッファを再利用する. 未回収のイベントはそのまま残り, 次のEndFrameで回収される.
+		if (!free_thread_buffer_array_.empty())
+		{
+			auto* p_buffer = free_thread_buffer_array_.back();
+			free_thread_buffer_array_.pop_back();
+			p_buffer->thread_name_ = t_thread_buffer.pending_name.empty() ? "Thread " + std::to_string(p_buffer->GetThreadIndex()) : t_thread_buffer.pending_name;
+			return p_buffer;
+		}
+
+		const u32 thread_index = static_cast<u32>(thread_buffer_array_.size());
+		thread_buffer_array_.push_back(std::make_unique<ProfileThreadBuffer>(thread_index, desc_.thread_buffer_capacity));
+		thread_buffer_array_.back()->thread_name_ = t_thread_buffer.pending_name.empty() ? "Thread " + std::to_string(thread_index) : t_thread_buffer.pending_name;
+		return thread_buffer_array_.back().get();
+	}
+
+	void Profiler::UnregisterThread(ProfileThreadBuffer* p_buffer)
+	{
+		std::lock_guard<std::mutex> lock(thread_mutex_);
+		free_thread_buffer_array_.push_back(p_buffer);
+	}
+
+	void Profiler::SetThreadName(const char* name)
+	{
+		// バッファは最初のZoneまで確保しない.
+		t_thread_buffer.pending_name = name;
+		if (auto* p_buffer = t_thread_buffer.p_buffer)
+		{
+			std::lock_guard<std::mutex> lock(thread_mutex_);
+			p_buffer->thread_name_ = name;
+		}
+	}
+
+	const char* Profiler::InternName(std::string_view name)
+	{
+		std::lock_guard<std::mutex> lock(intern_mutex_);
+		// unordered_setの要素は再ハッシュでも移動しないため, c_str()はプログラム終了まで有効.
+		return intern_set_.emplace(name).first->c_str();
+	}
+
+	void Profiler::BeginZone(const char* name)
+	{
+		GetThreadBuffer()->Begin(name);
+	}
+	void Profiler::EndZone()
+	{
+		GetThreadBuffer()->End();
+	}
+
+	void Profiler::EndFrame()
+	{
+		const u64 frame_end_tick = GetProfilerTick();
+
+		auto on_zone = [this](const ProfileZone& zone)
+		{
+			auto& acc = zone_accumulate_[zone.name];
+			acc.frame_tick += zone.end_tick - zone.begin_tick;
+			++acc.frame_call_count;
+
+			if (is_capturing_ && capture_zone_array_.size() < desc_.max_capture_zone)
+				capture_zone_array_.push_back(zone);
+		};
+
+		// 全スレッドのイベントを回収してZoneに復元する.
+		{
+			std::lock_guard<std::mutex> lock(thread_mutex_);
+			if (thread_open_zone_stack_.size() < thread_buffer_array_.size())
+				thread_open_zone_stack_.resize(thread_buffer_array_.size());
+
+			for (auto& buffer : thread_buffer_array_)
+			{
+				const u32 thread_index = buffer->GetThreadIndex();
+				// フレームを跨ぐZoneは開始イベントを保持しておき, 終了したフレームで集計する.
+				auto& open_stack = thread_open_zone_stack_[thread_index];
+				buffer->Consume([&](const ProfileEvent& e)
+				{
+					if (0 == (e.tick & k_profile_event_end_bit))
+					{
+						open_stack.push_back({ e.name, e.tick });
+						return;
+					}
+					if (open_stack.empty())
+						return;
+
+					ProfileZone zone = {};
+					zone.name = open_stack.back().name;
+					zone.begin_tick = open_stack.back().begin_tick;
+					zone.end_tick = e.tick & ~k_profile_event_end_bit;
+					zone.thread_index = thread_index;
+					open_stack.pop_back();
+					zone.depth = static_cast<u32>(open_stack.size());
+					on_zone(zone);
+				});
+			}
+		}
+
+		// Zone毎にフレームの合計を履歴に追加. 呼ばれなかったフレームは0.
+		for (auto& [name, acc] : zone_accumulate_)
+		{
+			if (acc.history.size() != desc_.statistics_frame_count)
+			{
+				acc.history.assign(desc_.statistics_frame_count, 0);
+				acc.history_pos = 0;
+				acc.history_count = 0;
+			}
+			acc.history[acc.history_pos] = acc.frame_tick;
+			acc.history_pos = (acc.history_pos + 1) % desc_.statistics_frame_count;
+			acc.history_count = std::min(acc.history_count + 1, desc_.statistics_frame_count);
+			acc.last_call_count = acc.frame_call_count;
+
+			acc.frame_tick = 0;
+			acc.frame_call_count = 0;
+		}
+
+		if (is_capturing_)
+			capture_frame_array_.push_back({ frame_index_, frame_end_tick });
+
+		++frame_index_;
+	}
+
+	void Profiler::BeginCapture()
+	{
+		capture_zone_array_.clear();
+		capture_frame_array_.clear();
+		// 開始位置の目印.
+		capture_frame_array_.push_back({ frame_index_, GetProfilerTick() });
+		is_capturing_ = true;
+	}
+	void Profiler::EndCapture()
+	{
+		is_capturing_ = false;
+	}
+
+	std::string Profiler::ExportChromeTraceString() const
+	{
+		std::vector<ProfileZone> zone_array = capture_zone_array_;
+		// 同一スレッドで開始時刻が同じ場合は外側(長い方)を先にして階層を正しく表示させる.
+		std::sort(zone_array.begin(), zone_array.end(), [](const ProfileZone& a, const ProfileZone& b)
+		{
+			if (a.thread_index != b.thread_index)
+				return a.thread_index < b.thread_index;
+			if (a.begin_tick != b.begin_tick)
+				return a.begin_tick < b.begin_tick;
+			return a.depth < b.depth;
+		});
+
+		u64 base_tick = capture_frame_array_.empty() ? 0 : capture_frame_array_.front().tick;
+		for (const auto& zone : zone_array)
+			base_tick = std::min(base_tick, zone.begin_tick);
+
+		std::string out;
+		out.reserve(256 + zone_array.size() * 96);
+		out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"ngl\"}}";
+
+		// スレッド名. tid 0 はフレーム境界用.
+		{
+			std::lock_guard<std::mutex> lock(thread_mutex_);
+			for (const auto& buffer : thread_buffer_array_)
+			{
+				const u32 tid = buffer->GetThreadIndex() + 1;
+				out += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(tid) + ",\"args\":{\"name\":";
+				AppendJsonString(out, buffer->thread_name_.c_str());
+				out += "}}";
+				out += ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(tid) + ",\"args\":{\"sort_index\":" + std::to_string(tid) + "}}";
+			}
+		}
+
+		for (const auto& zone : zone_array)
+		{
+			out += ",\n{\"name\":";
+			AppendJsonString(out, zone.name);
+			out += ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(zone.thread_index + 1) + ",\"ts\":";
+			AppendMicroSec(out, zone.begin_tick - base_tick);
+			out += ",\"dur\":";
+			AppendMicroSec(out, zone.end_tick - zone.begin_tick);
+			out += "}";
+		}
+
+		// フレーム境界はグローバルなインスタントイベント.
+		for (const auto& frame : capture_frame_array_)
+		{
+			out += ",\n{\"name\":\"Frame " + std::to_string(frame.frame_index) + "\",\"cat\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":";
+			AppendMicroSec(out, frame.tick - base_tick);
+			out += "}";
+		}
+
+		out += "\n]}\n";
+		return out;
+	}
+
+	bool Profiler::ExportChromeTrace(const char* file_path) const
+	{
+		std::ofstream ofs(file_path, std::ios::binary | std::ios::trunc);
+		if (!ofs)
+			return false;
+		const std::string json = ExportChromeTraceString();
+		ofs.write(json.data(), static_cast<std::streamsize>(json.size()));
+		return static_cast<bool>(ofs);
+	}
+
+	void Profiler::GetStatistics(std::vector<ProfileZoneStatistics>& out_stat_array) const
+	{
+		out_stat_array.clear();
+		out_stat_array.reserve(zone_accumulate_.size());
+		for (const auto& [name, acc] : zone_accumulate_)
+		{
+			if (0 == acc.history_count)
+				continue;
+
+			ProfileZoneStatistics stat = {};
+			stat.name = name.data();
+			stat.num_frame = acc.history_count;
+			stat.last_call_count = acc.last_call_count;
+
+			const u32 history_size = static_cast<u32>(acc.history.size());
+			const u32 last_pos = (acc.history_pos + history_size - 1) % history_size;
+			u64 sum = 0;
+			u64 min_tick = ~u64(0);
+			u64 max_tick = 0;
+			for (u32 i = 0; i < acc.history_count; ++i)
+			{
+				const u64 v = acc.history[(last_pos + history_size - i) % history_size];
+				sum += v;
+				min_tick = std::min(min_tick, v);
+				max_tick = std::max(max_tick, v);
+			}
+			constexpr double k_ns_to_ms = 1.0 / 1000000.0;
+			stat.last_ms = static_cast<double>(acc.history[last_pos]) * k_ns_to_ms;
+			stat.min_ms = static_cast<double>(min_tick) * k_ns_to_ms;
+			stat.max_ms = static_cast<double>(max_tick) * k_ns_to_ms;
+			stat.avg_ms = static_cast<double>(sum) * k_ns_to_ms / static_cast<double>(acc.history_count);
+			out_stat_array.push_back(stat);
+		}
+		std::sort(out_stat_array.begin(), out_stat_array.end(), [](const ProfileZoneStatistics& a, const ProfileZoneStatistics& b)
+		{
+			return std::string_view(a.name) < std::string_view(b.name);
+		});
+	}
+
+	u64 Profiler::GetDroppedEventCount() const
+	{
+		std::lock_guard<std::mutex> lock(thread_mutex_);
+		u64 count = 0;
+		for (const auto& buffer : thread_buffer_array_)
+			count += buffer->GetDroppedCount();
+		return count;
+	}
+}
+}
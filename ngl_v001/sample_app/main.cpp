@@ -1,5 +1,6 @@
 ﻿
 #include <array>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <thread>
@@ -10,8 +11,10 @@
 #include "file/file.h"
 #include "math/math.h"
 #include "platform/window.h"
+#include "thread/job_thread.h"
 #include "thread/test_lockfree_stack.h"
 #include "util/bit_operation.h"
+#include "util/time/profiler.h"
 #include "util/time/timer.h"
 
 // resource
@@ -22,23 +25,41 @@
 #include "rhi/d3d12/device.d3d12.h"
 #include "rhi/d3d12/resource.d3d12.h"
 #include "rhi/d3d12/resource_view.d3d12.h"
+#include "rhi/rhi_command_capture.h"
 
 // GraphicsFramework.
 #include "framework/gfx_framework.h"
+#include "framework/gfx_frame_pacer.h"
 
 // gfx
 #include "gfx/game_scene.h"
+#include "gfx/raytrace/cpu_bvh_scene_builder.h"
 #include "gfx/raytrace/raytrace_scene.h"
+#include "gfx/raytrace/rt_blas_build_scheduler.h"
+#include "gfx/raytrace/rt_shader_table_record.h"
+#include "gfx/raytrace/rt_tlas_instance_tracker.h"
+#include "gfx/rendering/global_render_resource.h"
+#include "gfx/rendering/ibl_bake_cache.h"
+#include "gfx/rendering/ibl_sh.h"
+#include "gfx/rendering/parallel_draw_record.h"
+#include "gfx/resource/mesh_meshlet.h"
+#include "gfx/resource/mesh_vertex_quantize.h"
+#include "gfx/resource/texture_cooker_directxtex.h"
+#include "gfx/resource/texture_streaming_system.h"
+#include "gfx/resource/upload_manager.h"
+#include "gfx/resource/upload_scheduler.h"
 #include "render/scene/scene_mesh.h"
 #include "render/scene/scene_skybox.h"
 
 // マテリアルシェーダ関連.
+#include "gfx/material/bindless_material_table.h"
 #include "gfx/material/material_shader_generator.h"
 #include "gfx/material/material_shader_manager.h"
 
 // Render Path
 #include "render/app/srvs/srvs.h"
 #include "render/app/sw_tess/sw_tessellation_mesh.h"
+#include "render/app/sw_tess/cpu_cbt_tessellation.h"
 #include "render/test_render_path.h"
 
 // imguiのシステム処理Wrapper.
@@ -90,13 +111,31 @@ static float dbgw_skylight_intensity = 2.0f;
 // 並列化.
 static bool dbgw_render_thread                    = true;
 static bool dbgw_multithread_render_pass          = true;
+static bool dbgw_multithread_setup_pass           = true;
 static bool dbgw_multithread_cascade_shadow       = true;
+static int  dbgw_mesh_pass_max_split             = 4;
+static int  dbgw_max_frames_in_flight            = 2;
+static int  dbgw_upload_budget_mb                = 32;
 static float dbgw_perf_main_thread_sleep_millisec = 0.0f;
 // Stat.
 static float dbgw_stat_primary_rtg_construct = {};
 static float dbgw_stat_primary_rtg_compile   = {};
 static float dbgw_stat_primary_rtg_execute   = {};
 
+// CPU BVH ベンチマーク. RenderThreadでリクエストを処理する.
+static bool dbgw_cpu_bvh_benchmark_request                  = false;
+static float dbgw_cpu_bvh_build_sec                         = {};
+static ngl::gfx::CpuBvhBenchmarkResult dbgw_cpu_bvh_result = {};
+// CPU Profiler.
+static bool dbgw_cpu_profiler_enable                        = false;
+static bool dbgw_cpu_profiler_export_result                 = false;
+// Rhi Command Capture.
+static bool dbgw_rhi_command_capture_export_result          = false;
+static int dbgw_rhi_command_capture_compare_result          = -1;   // -1:未比較, 0:差異あり, 1:一致, 2:読み込み失敗.
+static ngl::u32 dbgw_rhi_command_capture_diff_stream        = 0;
+static ngl::rhi::RhiCommandStreamDiff dbgw_rhi_command_capture_diff = {};
+static ngl::rhi::DescriptorTableCacheReplayResult dbgw_descriptor_table_cache_replay = {};
+
 // SwTessellation.
 static float sw_tess_important_point_offset_in_view  = 7.0;
 static int sw_tess_fixed_subdivision_level           = -1;     // -1で無効、0以上で固定分割レベルを指定
@@ -106,6 +145,9 @@ static float sw_tess_split_threshold                 = 0.5f;   // テッセレ
 static int sw_tess_debug_bisector_id                 = -1;     // デバッグ対象BisectorID（-1で無効）
 static int sw_tess_debug_bisector_depth              = -1;     // デバッグ対象BisectorDepth（-1で無効）
 static int sw_tess_debug_bisector_neighbor           = -1;
+// HalfEdgeMesh構築ベンチマーク.
+static ngl::render::app::HalfEdgeMeshBenchmarkResult sw_tess_half_edge_benchmark_result = {};
+static ngl::render::app::CpuCbtTessellationSelfTestResult sw_tess_cpu_reference_result = {};
 
 class PlayerController
 {
@@ -173,6 +215,9 @@ private:
     // Graphicsフレームワーク.
     ngl::fwk::GraphicsFramework gfxfw_{};
     std::vector<ngl::rhi::EResourceState> swapchain_resource_state_;
+    // RTG内部リソースプールのTrim判定用の前回解像度.
+    ngl::u32 rtg_pool_screen_width_  = 0;
+    ngl::u32 rtg_pool_screen_height_ = 0;
 
     // ngl::math::Vec3 camera_pos_   = {0.368f, 1.237f, 0.453f};//{0.0f, 2.0f, -5.0f};
     ngl::math::Vec3 camera_pos_   = {16.0f, 5.5f, -20.0f}; //{1.871f, 1.347f, 1.399f};
@@ -191,6 +236,8 @@ private:
 
     // RaytraceScene.
     ngl::gfx::RtSceneManager rt_scene_;
+    // CPU BVH. ベンチマーク用.
+    ngl::gfx::CpuBvhSceneBuilder cpu_bvh_scene_builder_;
 
     ngl::render::app::ScreenReconstructedVoxelStructure srvs_;
 
@@ -213,10 +260,33 @@ static void TestEntry()
     ngl::thread::TestLockFreeStackIntrusive();
     ngl::thread::TestFixedSizeLockFreeStack();
     ngl::thread::TestStaticSizeLockFreeStack();
+    ngl::rhi::TestGabageCollector();
+    ngl::rhi::TestRhiCommandCapture();
+    ngl::rhi::TestDescriptorTableCache();
+    ngl::rhi::TestBindlessDescriptorIndexAllocator();
+    ngl::gfx::TestBindlessMaterialTable();
+    ngl::gfx::TestParallelDrawRecord();
+    ngl::fwk::TestFramePacer();
+    ngl::gfx::TestUploadScheduler();
+    ngl::gfx::TestTextureStreaming();
+    ngl::directxtex::TestTextureCook();
+    ngl::gfx::TestMeshletBuild();
+    ngl::gfx::TestMeshVertexQuantize();
+    ngl::gfx::TestRtTlasInstanceTracker();
+    ngl::gfx::TestRtBlasBuildScheduler();
+    ngl::gfx::TestRtShaderTableRecord();
+    ngl::gfx::TestIblSh();
+    ngl::gfx::TestIblBakeCache();
+    ngl::rtg::TestRtgCompileCache();
+    ngl::rtg::TestRtgNodeSchedule();
+    ngl::rtg::TestRtgResourcePool();
+    ngl::rtg::TestRtgGpuTimestamp();
 
     ngl::math::math_test();
 
     ngl::render::app::ConcurrentBinaryTreeU32::Test();
+    ngl::render::app::ConcurrentBinaryTreeU64::Test();
+    ngl::render::app::TestHalfEdgeMesh();
 }
 
 AppGame::AppGame()
@@ -265,6 +335,8 @@ bool AppGame::Initialize()
     // グラフィックスフレームワーク初期化.
     ngl::fwk::GraphicsFramework::Desc gfxfw_desc{};
     gfxfw_desc.require_enhanced_barrier = true;
+    gfxfw_desc.enable_bindless = false;// trueで opaque_standard マテリアルを opaque_bindless に置き換える.
+    gfxfw_desc.max_frames_in_flight = dbgw_max_frames_in_flight;
     if (!gfxfw_.Initialize(&window_, gfxfw_desc))
     {
         assert(false && u8"Failed Initialize Rendering Framework.");
@@ -450,6 +522,7 @@ bool AppGame::Initialize()
                 mesh_entity_array_.push_back(mc);
 
                 ngl::gfx::ResMeshData::LoadDesc loaddesc{};
+                // loaddesc.enable_vertex_quantize = true;// 頂点属性を量子化してVertexFetchを削減する場合.
                 mc->Initialize(&device, &gfx_scene_, ResourceMan.LoadResource<ngl::gfx::ResMeshData>(&device, mesh_target_scene, &loaddesc));
                 // スケール設定.
                 ngl::math::Mat34 tr = ngl::math::Mat34::Identity();
@@ -643,6 +716,9 @@ bool AppGame::Initialize()
     // const char test_load_texture_file_name[] = "../ngl/data/texture/vgl/pisa/pisa.hdr";
     res_texture_ = ngl::res::ResourceManager::Instance().LoadResource<ngl::gfx::ResTexture>(&device, test_load_texture_file_name, &tex_load_desc);
 
+    // 起動時ロードでのTexture Cook統計.
+    ngl::directxtex::PrintTextureCookStatistics();
+
     ngl::time::Timer::Instance().StartTimer("app_frame_sec");
     return true;
 }
@@ -779,6 +855,17 @@ bool AppGame::ExecuteApp()
             ImGui::Text("Wait Gpu           : %f [ms]", static_cast<double>(prev_frame_gfx_stat.wait_gpu_fence_micro_sec) / (1000.0));
             ImGui::Text("Present Cpu Block  : %f [ms]", static_cast<double>(prev_frame_gfx_stat.wait_present_micro_sec) / (1000.0));
 
+            // CPU→GPU の Frames In Flight とSubmit間隔のペーシング.
+            if (ImGui::SliderInt("Frames In Flight", &dbgw_max_frames_in_flight, 1, ngl::fwk::FramePacer::k_max_frames_in_flight))
+            {
+                gfxfw_.SetMaxFramesInFlight(static_cast<ngl::u32>(dbgw_max_frames_in_flight));
+            }
+            const auto pacer_stat = gfxfw_.GetFramePacerStatistics();
+            ImGui::Text("In Flight          : %u / %u", prev_frame_gfx_stat.num_frames_in_flight, pacer_stat.max_frames_in_flight);
+            ImGui::Text("Submit Interval    : avg %f, jitter %f, max %f [ms]",
+                pacer_stat.avg_frame_interval_micro_sec / 1000.0, pacer_stat.frame_interval_jitter_micro_sec / 1000.0, static_cast<double>(pacer_stat.max_frame_interval_micro_sec) / 1000.0);
+            ImGui::Text("Wait Gpu (avg)     : %f [ms] (%llu waits)", pacer_stat.avg_wait_micro_sec / 1000.0, static_cast<unsigned long long>(pacer_stat.num_wait));
+
             ImGui::Text("Rtg Construct: %f [ms]", dbgw_stat_primary_rtg_construct * 1000.0f);
             ImGui::Text("Rtg Compile  : %f [ms]", dbgw_stat_primary_rtg_compile * 1000.0f);
             ImGui::Text("Rtg Execute  : %f [ms]", dbgw_stat_primary_rtg_execute * 1000.0f);
@@ -789,7 +876,206 @@ bool AppGame::ExecuteApp()
             ImGui::Separator();
             ImGui::Checkbox("Enable Render Thread", &dbgw_render_thread);
             ImGui::Checkbox("Enable MultiThread RenderPass", &dbgw_multithread_render_pass);
+            ImGui::Checkbox("Enable MultiThread RenderPass Setup", &dbgw_multithread_setup_pass);
             ImGui::Checkbox("Enable MultiThread CascadeShadow", &dbgw_multithread_cascade_shadow);
+            ImGui::SliderInt("MeshPass Max Split CommandList", &dbgw_mesh_pass_max_split, 1, 8);
+
+            ImGui::Separator();
+            // 現在のシーンとカメラでCPU BVHを構築して一次レイを計測.
+            if (ImGui::Button("CPU BVH Benchmark"))
+                dbgw_cpu_bvh_benchmark_request = true;
+            ImGui::Text("CPU BVH Build    : %f [ms]", dbgw_cpu_bvh_build_sec * 1000.0f);
+            ImGui::Text("CPU BVH Hit      : %llu / %llu", dbgw_cpu_bvh_result.num_hit, dbgw_cpu_bvh_result.num_ray);
+            ImGui::Text("CPU BVH Closest  : %.2f [Mrays/s]", dbgw_cpu_bvh_result.closest_mrays_per_sec);
+            ImGui::Text("CPU BVH Packet4  : %.2f [Mrays/s]", dbgw_cpu_bvh_result.packet_mrays_per_sec);
+            ImGui::Text("CPU BVH Occluded : %.2f [Mrays/s]", dbgw_cpu_bvh_result.occluded_mrays_per_sec);
+        }
+
+        // RTGのTaskNode毎のGPU時間. 数フレーム前の結果.
+        ImGui::SetNextItemOpen(false, ImGuiCond_Once);
+        if (ImGui::CollapsingHeader("Rtg Gpu Timestamp"))
+        {
+            NGL_IMGUI_SCOPED_INDENT(10.0f);
+            bool gpu_timestamp_enable = gfxfw_.rtg_manager_.IsGpuTimestampEnable();
+            if (ImGui::Checkbox("Enable", &gpu_timestamp_enable))
+                gfxfw_.rtg_manager_.SetGpuTimestampEnable(gpu_timestamp_enable);
+
+            const auto& gpu_timestamp = gfxfw_.rtg_manager_.GetGpuTimestampResult();
+            if (gpu_timestamp.is_valid)
+            {
+                ImGui::Text("Frame Span    : %f [ms]", gpu_timestamp.frame_span_ms);
+                ImGui::Text("Graphics Busy : %f [ms]", gpu_timestamp.queue_busy_ms[static_cast<int>(ngl::rtg::ERtgGpuTimestampQueue::Graphics)]);
+                ImGui::Text("Compute Busy  : %f [ms]", gpu_timestamp.queue_busy_ms[static_cast<int>(ngl::rtg::ERtgGpuTimestampQueue::Compute)]);
+                ImGui::Text("Queue Overlap : %f [ms]", gpu_timestamp.queue_overlap_ms);
+                if (0 < gpu_timestamp.num_dropped_node)
+                    ImGui::Text("Dropped Node  : %u", gpu_timestamp.num_dropped_node);
+                for (const auto& node : gpu_timestamp.node_array)
+                {
+                    ImGui::Text("%s %-32s %8.3f [ms] (%7.3f - %7.3f)", (ngl::rtg::ERtgGpuTimestampQueue::Graphics == node.queue) ? "G" : "C",
+                                node.name.Get(), node.duration_ms, node.begin_ms, node.end_ms);
+                }
+            }
+        }
+
+        // RTGのNodeカリングとAsyncCompute配置. 前回フレームの統計.
+        ImGui::SetNextItemOpen(false, ImGuiCond_Once);
+        if (ImGui::CollapsingHeader("Rtg Node Schedule"))
+        {
+            NGL_IMGUI_SCOPED_INDENT(10.0f);
+            bool node_culling_enable = gfxfw_.rtg_manager_.IsNodeCullingEnable();
+            if (ImGui::Checkbox("Node Culling", &node_culling_enable))
+                gfxfw_.rtg_manager_.SetNodeCullingEnable(node_culling_enable);
+            bool async_compute_placement_enable = gfxfw_.rtg_manager_.IsAsyncComputePlacementEnable();
+            if (ImGui::Checkbox("Async Compute Placement", &async_compute_placement_enable))
+                gfxfw_.rtg_manager_.SetAsyncComputePlacementEnable(async_compute_placement_enable);
+            auto placement_desc = gfxfw_.rtg_manager_.GetAsyncComputePlacementDesc();
+            if (ImGui::SliderFloat("Fence Cost", &placement_desc.fence_cost, 0.0f, 4.0f))
+                gfxfw_.rtg_manager_.SetAsyncComputePlacementDesc(placement_desc);
+
+            const auto node_schedule_stat = gfxfw_.rtg_manager_.GetNodeScheduleStatistics();
+            ImGui::Text("Node          : %u (culled %u)", node_schedule_stat.num_node, node_schedule_stat.num_culled);
+            ImGui::Text("Async Compute : %u / %u", node_schedule_stat.num_async_compute, node_schedule_stat.num_compute);
+        }
+
+        // RTGのCompile結果キャッシュ.
+        ImGui::SetNextItemOpen(false, ImGuiCond_Once);
+        if (ImGui::CollapsingHeader("Rtg Compile Cache"))
+        {
+            NGL_IMGUI_SCOPED_INDENT(10.0f);
+            bool compile_cache_enable = gfxfw_.rtg_manager_.IsCompileCacheEnable();
+            if (ImGui::Checkbox("Enable", &compile_cache_enable))
+                gfxfw_.rtg_manager_.SetCompileCacheEnable(compile_cache_enable);
+            bool compile_cache_verify = gfxfw_.rtg_manager_.IsCompileCacheVerifyEnable();
+            if (ImGui::Checkbox("Verify", &compile_cache_verify))
+                gfxfw_.rtg_manager_.SetCompileCacheVerifyEnable(compile_cache_verify);
+
+            const auto compile_cache_stat = gfxfw_.rtg_manager_.GetCompileCacheStatistics();
+            ImGui::Text("Hit Rate   : %.1f [%%]", compile_cache_stat.HitRate() * 100.0);
+            ImGui::Text("Hit / Miss : %llu / %llu", compile_cache_stat.num_hit, compile_cache_stat.num_miss);
+            ImGui::Text("Reject     : %llu", compile_cache_stat.num_reject);
+            ImGui::Text("Entry      : %u (evict %llu)", compile_cache_stat.num_entry, compile_cache_stat.num_evict);
+            if (0 < compile_cache_stat.num_verify)
+                ImGui::Text("Verify     : %llu (mismatch %llu)", compile_cache_stat.num_verify, compile_cache_stat.num_verify_mismatch);
+            ImGui::Text("Miss Time  : %f [ms]", compile_cache_stat.miss_time_ms);
+            ImGui::Text("Hit Time   : %f [ms]", compile_cache_stat.hit_time_ms);
+            ImGui::Text("Saved Time : %f [ms]", compile_cache_stat.saved_time_ms);
+        }
+
+        // RTGの内部リソースプール.
+        ImGui::SetNextItemOpen(false, ImGuiCond_Once);
+        if (ImGui::CollapsingHeader("Rtg Resource Pool"))
+        {
+            NGL_IMGUI_SCOPED_INDENT(10.0f);
+            constexpr float k_mb = 1024.0f * 1024.0f;
+            auto pool_desc      = gfxfw_.rtg_manager_.GetResourcePoolDesc();
+            int budget_mb       = static_cast<int>(pool_desc.budget_bytes / (1024 * 1024));
+            if (ImGui::SliderInt("Budget [MB] (0:Unlimited)", &budget_mb, 0, 4096))
+            {
+                pool_desc.budget_bytes = static_cast<ngl::u64>(budget_mb) * 1024 * 1024;
+                gfxfw_.rtg_manager_.SetResourcePoolDesc(pool_desc);
+            }
+            if (ImGui::SliderInt("Max Unused Frame", &pool_desc.max_unused_frame, 1, 600))
+                gfxfw_.rtg_manager_.SetResourcePoolDesc(pool_desc);
+
+            const auto pool_stat = gfxfw_.rtg_manager_.GetResourcePoolStatistics();
+            ImGui::Text("Pool       : %.1f / %.1f [MB] (peak %.1f)", pool_stat.pool_bytes / k_mb, pool_stat.budget_bytes / k_mb, pool_stat.peak_bytes / k_mb);
+            ImGui::Text("Resource   : %u", pool_stat.num_resource);
+            ImGui::Text("Hit Rate   : %.1f [%%]", pool_stat.HitRate() * 100.0);
+            ImGui::Text("Hit / Miss : %llu / %llu", pool_stat.num_hit, pool_stat.num_miss);
+            ImGui::Text("Evict      : %llu (budget %llu, %.1f [MB])", pool_stat.num_evict, pool_stat.num_evict_budget, pool_stat.evict_bytes / k_mb);
+        }
+
+        ImGui::SetNextItemOpen(false, ImGuiCond_Once);
+        if (ImGui::CollapsingHeader("CPU Profiler"))
+        {
+            NGL_IMGUI_SCOPED_INDENT(10.0f);
+            auto& profiler = ngl::time::Profiler::Instance();
+            if (ImGui::Checkbox("Enable", &dbgw_cpu_profiler_enable))
+                profiler.SetEnable(dbgw_cpu_profiler_enable);
+
+            // キャプチャしてChrome Trace JSONを出力. chrome://tracing または Perfetto で開く.
+            if (!profiler.IsCapturing())
+            {
+                if (ImGui::Button("Begin Capture"))
+                {
+                    dbgw_cpu_profiler_enable = true;
+                    profiler.SetEnable(true);
+                    profiler.BeginCapture();
+                }
+            }
+            else
+            {
+                if (ImGui::Button("End Capture and Export"))
+                {
+                    profiler.EndCapture();
+                    dbgw_cpu_profiler_export_result = profiler.ExportChromeTrace("ngl_cpu_trace.json");
+                }
+            }
+            ImGui::Text("Capture Zone : %u, Export : %s, Dropped Event : %llu", profiler.NumCaptureZone(), dbgw_cpu_profiler_export_result ? "ngl_cpu_trace.json" : "-", profiler.GetDroppedEventCount());
+
+            std::vector<ngl::time::ProfileZoneStatistics> zone_stat_array;
+            profiler.GetStatistics(zone_stat_array);
+            ImGui::Text("%-40s %6s %8s %8s %8s [ms]", "Zone", "Call", "Min", "Avg", "Max");
+            for (const auto& zone_stat : zone_stat_array)
+            {
+                ImGui::Text("%-40s %6u %8.3f %8.3f %8.3f", zone_stat.name, zone_stat.last_call_count, zone_stat.min_ms, zone_stat.avg_ms, zone_stat.max_ms);
+            }
+        }
+
+        ImGui::SetNextItemOpen(false, ImGuiCond_Once);
+        if (ImGui::CollapsingHeader("Rhi Command Capture"))
+        {
+            NGL_IMGUI_SCOPED_INDENT(10.0f);
+            auto& command_capture = gfxfw_.device_.GetCommandCapture();
+            if (ImGui::Button("Capture 1 Frame"))
+                command_capture.RequestCapture(1);
+
+            const auto& capture_result = command_capture.GetLatestResult();
+            if (capture_result.is_valid)
+            {
+                const auto& stat = capture_result.statistics;
+                ImGui::Text("Frame %llu, CommandList %u, Object %u, Stream %llu [byte]", capture_result.begin_frame_index, static_cast<ngl::u32>(capture_result.stream_array.size()), capture_result.num_object, stat.byte_size);
+                ImGui::Text("Command %u, Draw %u, Dispatch %u, Barrier %u, Copy %u, Pso %u", stat.NumTotalCommand(), stat.NumDraw(), stat.NumDispatch(), stat.NumBarrier(), stat.NumCopy(), stat.NumPipelineStateChange());
+
+                // テキストダンプとバイナリを出力. バイナリは回帰比較の基準として読み込める.
+                if (ImGui::Button("Export"))
+                {
+                    std::ofstream ofs("ngl_rhi_command_capture.txt");
+                    ngl::rhi::DumpRhiCommandCapture(capture_result, ofs);
+                    dbgw_rhi_command_capture_export_result = ofs.good() && ngl::rhi::SaveRhiCommandCapture(capture_result, "ngl_rhi_command_capture.nrcs");
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Compare with Exported"))
+                {
+                    ngl::rhi::RhiCommandCaptureResult baseline;
+                    if (ngl::rhi::LoadRhiCommandCapture("ngl_rhi_command_capture.nrcs", baseline))
+                        dbgw_rhi_command_capture_compare_result = ngl::rhi::CompareRhiCommandCapture(baseline, capture_result, dbgw_rhi_command_capture_diff_stream, dbgw_rhi_command_capture_diff) ? 1 : 0;
+                    else
+                        dbgw_rhi_command_capture_compare_result = 2;
+                }
+                ImGui::Text("Export : %s", dbgw_rhi_command_capture_export_result ? "ngl_rhi_command_capture.txt" : "-");
+                if (1 == dbgw_rhi_command_capture_compare_result)
+                    ImGui::Text("Compare : Equal");
+                else if (0 == dbgw_rhi_command_capture_compare_result)
+                    ImGui::Text("Compare : Stream %u Command %u (%s / %s)", dbgw_rhi_command_capture_diff_stream, dbgw_rhi_command_capture_diff.command_index,
+                        ngl::rhi::GetRhiCommandOpName(dbgw_rhi_command_capture_diff.op_a), ngl::rhi::GetRhiCommandOpName(dbgw_rhi_command_capture_diff.op_b));
+                else if (2 == dbgw_rhi_command_capture_compare_result)
+                    ImGui::Text("Compare : Load Failed");
+
+                // キャプチャしたDescriptorテーブル設定列でキャッシュ効果を計測.
+                if (ImGui::Button("Replay Descriptor Table Cache"))
+                    dbgw_descriptor_table_cache_replay = ngl::rhi::ReplayDescriptorTableCache(capture_result, ngl::rhi::DescriptorTableCache::Desc{}, 16);
+                {
+                    const auto& replay = dbgw_descriptor_table_cache_replay;
+                    ImGui::Text("Replay : Table %llu, Hit %.1f%%, Saved Descriptor %llu/%llu, Skipped RootSet %llu, %.3f [ms]",
+                        replay.num_table, replay.statistics.HitRate() * 100.0f, replay.statistics.num_saved_descriptor, replay.num_descriptor, replay.statistics.num_skipped_root_set, replay.elapsed_ms);
+                }
+            }
+
+            // 前フレームのDescriptorテーブルキャッシュ統計.
+            const auto& desc_cache_stat = gfxfw_.device_.GetDescriptorTableCacheStatistics();
+            ImGui::Text("DescriptorTableCache : Lookup %llu, Hit %.1f%%, Saved Descriptor %llu, Skipped RootSet %llu, Flush %llu",
+                desc_cache_stat.num_lookup, desc_cache_stat.HitRate() * 100.0f, desc_cache_stat.num_saved_descriptor, desc_cache_stat.num_skipped_root_set, desc_cache_stat.num_flush);
         }
 
         ImGui::SetNextItemOpen(false, ImGuiCond_Once);
@@ -855,13 +1141,10 @@ bool AppGame::ExecuteApp()
             if (ImGui::CollapsingHeader("IBL"))
             {
                 NGL_IMGUI_SCOPED_INDENT(10.0f);
-                bool param_prevent_aliasing_mode_diffuse  = skybox_.GetParam_PreventAliasingModeDiffuse();
                 bool param_prevent_aliasing_mode_specular = skybox_.GetParam_PreventAliasingModeSpecular();
 
-                ImGui::Checkbox("prevent aliasing mode diffuse", &param_prevent_aliasing_mode_diffuse);
                 ImGui::Checkbox("prevent aliasing mode specular", &param_prevent_aliasing_mode_specular);
 
-                skybox_.SetParam_PreventAliasingModeDiffuse(param_prevent_aliasing_mode_diffuse);
                 skybox_.SetParam_PreventAliasingModeSpecular(param_prevent_aliasing_mode_specular);
 
                 if (ImGui::Button("recalculate"))
@@ -900,6 +1183,37 @@ bool AppGame::ExecuteApp()
                 }
             }
 
+            // 格子メッシュで従来実装とソートベース実装のHalfEdge構築を計測, 比較.
+            if (ImGui::Button("HalfEdge Build Benchmark (1M Triangles)"))
+            {
+                std::vector<uint32_t> grid_index_list;
+                ngl::render::app::MakeHalfEdgeMeshBenchmarkGrid(708, grid_index_list);
+
+                ngl::thread::JobSystem job_system;
+                job_system.Init(std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+                sw_tess_half_edge_benchmark_result = ngl::render::app::RunHalfEdgeMeshBenchmark(grid_index_list.data(), static_cast<int>(grid_index_list.size()), &job_system);
+            }
+            ImGui::Text("HalfEdge Reference     : %.2f [ms]", sw_tess_half_edge_benchmark_result.reference_ms);
+            ImGui::Text("HalfEdge Sort          : %.2f [ms]", sw_tess_half_edge_benchmark_result.sort_ms);
+            ImGui::Text("HalfEdge Sort Parallel : %.2f [ms]", sw_tess_half_edge_benchmark_result.sort_parallel_ms);
+            ImGui::Text("HalfEdge Match         : %s", sw_tess_half_edge_benchmark_result.is_match ? "true" : "false");
+            ImGui::Text("Edge / Boundary / NonManifold : %d / %d / %d", sw_tess_half_edge_benchmark_result.build_stat.edge_count,
+                        sw_tess_half_edge_benchmark_result.build_stat.boundary_edge_count, sw_tess_half_edge_benchmark_result.build_stat.non_manifold_edge_count);
+
+            // CPUリファレンスで分割統合パイプラインを実行して毎フレーム構造を検証.
+            if (ImGui::Button("CPU CBT Tessellation Reference Test"))
+            {
+                ngl::thread::JobSystem job_system;
+                job_system.Init(std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+                ngl::render::app::ConcurrentBinaryTreeU32::Test(&job_system);
+                ngl::render::app::ConcurrentBinaryTreeU64::Test(&job_system);
+                sw_tess_cpu_reference_result = ngl::render::app::RunCpuCbtTessellationSelfTest(32, 6, &job_system);
+            }
+            ImGui::Text("CPU Reference Frame / Invalid : %u / %u", sw_tess_cpu_reference_result.frame_count, sw_tess_cpu_reference_result.invalid_frame_count);
+            ImGui::Text("CPU Reference Max Bisector    : %u", sw_tess_cpu_reference_result.max_active_bisector_count);
+            ImGui::Text("CPU Reference Final / HalfEdge: %u / %u", sw_tess_cpu_reference_result.final_active_bisector_count, sw_tess_cpu_reference_result.half_edge_count);
+            ImGui::Text("CPU Reference Update          : %.3f [ms]", sw_tess_cpu_reference_result.update_ms);
+
             ImGui::Separator();
             ImGui::SliderFloat("Important Point View Offset", &sw_tess_important_point_offset_in_view, 0.01f, 50.0f);
 
@@ -927,6 +1241,40 @@ bool AppGame::ExecuteApp()
             // Dynamic Descriptorの残量.
             ImGui::Text("DynamicDescriptor Free Count : %d / %d (%.2f)",
                         free_dynamic_descriptor_count, max_dynamic_descriptor_count, 100.0f * (float)free_dynamic_descriptor_count / (float)max_dynamic_descriptor_count);
+
+            if (rt_scene_.IsValid())
+            {
+                // TLAS差分更新の統計.
+                const auto tlas_stat = rt_scene_.GetTlasUpdateStatistics();
+                const char* build_mode_name[] = {"None", "Refit", "Rebuild"};
+                ImGui::Text("TLAS Instance : %u, Build : %s", tlas_stat.num_instance, build_mode_name[static_cast<int>(tlas_stat.build_mode)]);
+                ImGui::Text("TLAS Instance Upload : %u [byte] (%u instance, %u range)", tlas_stat.upload_byte_size, tlas_stat.num_upload_instance, tlas_stat.num_upload_range);
+
+                // BLASメモリ. コンパクション前後.
+                const auto blas_stat = rt_scene_.GetBlasStatistics();
+                ImGui::Text("BLAS : %u (pending build %u, pending compaction %u)", blas_stat.num_blas, blas_stat.num_pending_build, blas_stat.num_pending_compaction);
+                ImGui::Text("BLAS Memory : %.2f [MB] -> %.2f [MB] (scratch pool %.2f [MB])",
+                            static_cast<double>(blas_stat.result_max_byte) / (1024.0 * 1024.0), static_cast<double>(blas_stat.result_byte) / (1024.0 * 1024.0),
+                            static_cast<double>(blas_stat.scratch_pool_byte) / (1024.0 * 1024.0));
+            }
+
+            // メッシュとテクスチャのアップロード.
+            if (ImGui::SliderInt("Upload Budget [MB/frame]", &dbgw_upload_budget_mb, 1, 256))
+            {
+                ngl::gfx::UploadManager::Instance().SetMaxUploadBytePerFrame(static_cast<ngl::u64>(dbgw_upload_budget_mb) * 1024 * 1024);
+            }
+            const auto upload_stat = ngl::gfx::UploadManager::Instance().GetStatistics();
+            ImGui::Text("Upload : %.2f [MB] (%u request, %u dedicated)",
+                        static_cast<double>(upload_stat.scheduler.upload_byte_this_frame) / (1024.0 * 1024.0), upload_stat.scheduler.upload_count_this_frame, upload_stat.scheduler.dedicated_count_this_frame);
+            ImGui::Text("Upload Pending : %.2f [MB] (%u request)", static_cast<double>(upload_stat.scheduler.pending_byte) / (1024.0 * 1024.0), upload_stat.scheduler.pending_count);
+            ImGui::Text("Upload Ring : %.2f / %.2f [MB]",
+                        static_cast<double>(upload_stat.scheduler.ring_used_byte) / (1024.0 * 1024.0), static_cast<double>(upload_stat.ring_byte_size) / (1024.0 * 1024.0));
+
+            // テクスチャストリーミング.
+            const auto streaming_stat = ngl::gfx::TextureStreamingSystem::Instance().GetStatistics();
+            ImGui::Text("Texture Streaming : %.2f [MB] resident, %.2f [MB] pending%s",
+                        static_cast<double>(streaming_stat.resident_byte) / (1024.0 * 1024.0), static_cast<double>(streaming_stat.pending_byte) / (1024.0 * 1024.0), streaming_stat.is_over_budget ? " (over budget)" : "");
+            ImGui::Text("Texture Streaming Request : %u upload, %u evict, %u waiting", streaming_stat.upload_request_count, streaming_stat.evict_count, streaming_stat.waiting_request_count);
         }
 
         ImGui::PopItemWidth();
@@ -980,6 +1328,15 @@ bool AppGame::ExecuteApp()
     // 描画用シーン情報.
     ngl::gfx::SceneRepresentation frame_scene;
     {
+        // テクスチャストリーミングの必要Mip推定用ビュー情報.
+        {
+            ngl::gfx::TextureStreamingSystem::ViewParam streaming_view = {};
+            streaming_view.camera_pos = camera_pos_;
+            streaming_view.fov_y_radian = camera_fov_y;
+            streaming_view.screen_height = static_cast<float>(gfxfw_.swapchain_->GetHeight());
+            ngl::gfx::TextureStreamingSystem::Instance().SetViewParam(streaming_view);
+        }
+
         for (auto& e : mesh_entity_array_)
         {
             if (nullptr == e.get())
@@ -991,6 +1348,8 @@ bool AppGame::ExecuteApp()
             // 登録.
             frame_scene.mesh_proxy_id_array_.push_back(e->GetMeshProxyId());
         }
+        // メッシュからの要求を元にテクスチャストリーミングを更新.
+        ngl::gfx::TextureStreamingSystem::Instance().Update();
 
         // GfxScene.
         frame_scene.gfx_scene_ = &gfx_scene_;
@@ -1038,6 +1397,12 @@ void AppGame::RenderApp(ngl::fwk::RtgFrameRenderSubmitCommandBuffer& out_rtg_com
     ngl::u32 screen_width      = gfxfw_.swapchain_->GetWidth();
     ngl::u32 screen_height     = gfxfw_.swapchain_->GetHeight();
 
+    // 解像度変更時は旧解像度のRTG内部リソースを破棄.
+    if ((0 < rtg_pool_screen_width_) && (screen_width != rtg_pool_screen_width_ || screen_height != rtg_pool_screen_height_))
+        gfxfw_.rtg_manager_.TrimResourcePool();
+    rtg_pool_screen_width_  = screen_width;
+    rtg_pool_screen_height_ = screen_height;
+
     auto calc_view_proj = [](const ngl::math::Vec3& camera_pos, const ngl::math::Mat33& camera_pose, float camera_fov_y, float screen_aspect_ratio)
     {
         struct ViewProjPair
@@ -1072,6 +1437,29 @@ void AppGame::RenderApp(ngl::fwk::RtgFrameRenderSubmitCommandBuffer& out_rtg_com
         rt_scene_.UpdateOnRender(&gfxfw_.device_, gfxfw_.p_system_frame_begin_command_list_, render_param_->frame_scene);
     }
 
+    // CPU BVH ベンチマーク.
+    if (dbgw_cpu_bvh_benchmark_request)
+    {
+        dbgw_cpu_bvh_benchmark_request = false;
+
+        ngl::thread::JobSystem job_system;
+        job_system.Init(std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+
+        ngl::time::Timer::Instance().StartTimer("cpu_bvh_build");
+        cpu_bvh_scene_builder_.Build(render_param_->frame_scene, &job_system);
+        dbgw_cpu_bvh_build_sec = static_cast<float>(ngl::time::Timer::Instance().GetElapsedSec("cpu_bvh_build"));
+
+        ngl::gfx::CpuBvhBenchmarkDesc bench_desc{};
+        bench_desc.camera_pos     = render_param_->camera_pos;
+        bench_desc.camera_right   = render_param_->camera_pose.GetColumn0();
+        bench_desc.camera_up      = render_param_->camera_pose.GetColumn1();
+        bench_desc.camera_forward = render_param_->camera_pose.GetColumn2();
+        bench_desc.fov_y          = render_param_->camera_fov_y;
+        bench_desc.width          = screen_width;
+        bench_desc.height         = screen_height;
+        dbgw_cpu_bvh_result       = ngl::gfx::RunCpuBvhBenchmark(cpu_bvh_scene_builder_.GetScene(), bench_desc, &job_system);
+    }
+
     // SubViewの描画テスト.
     //	SubカメラでRTG描画をし, 伝搬指定した出力バッファをそのまま同一フレームのMainView描画で伝搬リソースとして利用するテスト.
     ngl::test::RenderFrameOut subview_render_frame_out{};
@@ -1099,7 +1487,9 @@ void AppGame::RenderApp(ngl::fwk::RtgFrameRenderSubmitCommandBuffer& out_rtg_com
 
             {
                 render_frame_desc.debug_multithread_render_pass    = dbgw_multithread_render_pass;
+                render_frame_desc.debug_multithread_setup_pass     = dbgw_multithread_setup_pass;
                 render_frame_desc.debug_multithread_cascade_shadow = dbgw_multithread_cascade_shadow;
+                render_frame_desc.debug_mesh_pass_max_split        = dbgw_mesh_pass_max_split;
             }
             // SubViewは最低限の設定.
         }
@@ -1171,14 +1561,16 @@ void AppGame::RenderApp(ngl::fwk::RtgFrameRenderSubmitCommandBuffer& out_rtg_com
                 render_frame_desc.p_rt_scene = &rt_scene_;
             }
 
-            render_frame_desc.ref_test_tex_srv      = res_texture_->ref_view_;
+            render_frame_desc.ref_test_tex_srv      = (res_texture_->IsUploadComplete()) ? res_texture_->ref_view_ : ngl::gfx::GlobalRenderResource::Instance().default_resource_.tex_black->ref_view_;
             render_frame_desc.h_prev_lit            = h_prev_light;  // MainViewはヒストリ有効.
             render_frame_desc.h_other_graph_out_tex = subview_render_frame_out.h_propagate_lit;
 
             // Debug.
             {
                 render_frame_desc.debug_multithread_render_pass    = dbgw_multithread_render_pass;
+                render_frame_desc.debug_multithread_setup_pass     = dbgw_multithread_setup_pass;
                 render_frame_desc.debug_multithread_cascade_shadow = dbgw_multithread_cascade_shadow;
+                render_frame_desc.debug_mesh_pass_max_split        = dbgw_mesh_pass_max_split;
 
                 render_frame_desc.debugview_halfdot_gray              = dbgw_view_half_dot_gray;
                 render_frame_desc.debugview_enable_feedback_blur_test = dbgw_enable_feedback_blur_test;